@@ -0,0 +1,438 @@
+/*
+  MapMatching - a demo program for libosmscout
+  Copyright (C) 2016  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+#include <osmscout/Database.h>
+#include <osmscout/MapMatchingService.h>
+#include <osmscout/RoutingService.h>
+
+#include <osmscout/util/Geometry.h>
+#include <osmscout/util/StopClock.h>
+
+/*
+  Benchmark for the MapMatchingService.
+
+  Synthetic GPS traces are generated from routes between random locations
+  calculated by the RoutingService: the route is sampled in regular
+  intervals and each sample is moved by normal distributed noise.
+
+  The traces are matched twice as one batch, the first time with empty
+  caches, the second time with the candidates and route nodes cached
+  during the first run. For each run the time and the number of points
+  matched per second is printed. The accuracy is the share of matched
+  points, that were matched to a way of the route the trace was generated
+  from or to a node of that route (a junction shared with a crossing way).
+
+  Example:
+
+  MapMatching --car --traces 1000 --noise 15 ../maps/nordrhein-westfalen
+*/
+
+struct Trace
+{
+  std::vector<osmscout::GeoCoord> points;
+  std::set<osmscout::FileOffset>  ways;   //!< Ways of the route the trace was generated from
+  std::set<osmscout::Id>          nodes;  //!< Nodes of the route the trace was generated from
+};
+
+static void SampleRoute(const std::list<osmscout::Point>& routePoints,
+                        double interval,
+                        double noise,
+                        std::mt19937& generator,
+                        std::vector<osmscout::GeoCoord>& points)
+{
+  std::normal_distribution<double> noiseDistribution(0.0,noise);
+  double                           nextSample=0.0;
+  double                           length=0.0;
+
+  for (auto current=routePoints.begin(); current!=routePoints.end(); ++current) {
+    auto next=current;
+
+    ++next;
+
+    if (next==routePoints.end()) {
+      break;
+    }
+
+    double segmentLength=osmscout::GetSphericalDistance(current->GetCoord(),
+                                                        next->GetCoord())*1000.0;
+
+    while (nextSample<=length+segmentLength) {
+      double fraction=segmentLength>0.0 ? (nextSample-length)/segmentLength : 0.0;
+      double lat=current->GetLat()+fraction*(next->GetLat()-current->GetLat());
+      double lon=current->GetLon()+fraction*(next->GetLon()-current->GetLon());
+
+      // Approximately 111.32 km per degree
+      lat+=noiseDistribution(generator)/111320.0;
+      lon+=noiseDistribution(generator)/(111320.0*cos(osmscout::DegToRad(lat)));
+
+      points.push_back(osmscout::GeoCoord(lat,lon));
+
+      nextSample+=interval;
+    }
+
+    length+=segmentLength;
+  }
+}
+
+static void GenerateTraces(const osmscout::DatabaseRef& database,
+                           osmscout::RoutingService& router,
+                           const osmscout::RoutingProfile& profile,
+                           size_t traceCount,
+                           double interval,
+                           double noise,
+                           std::vector<Trace>& traces)
+{
+  osmscout::GeoBox                       boundingBox;
+  std::mt19937                           generator(42);
+  std::uniform_real_distribution<double> latDistribution;
+  std::uniform_real_distribution<double> lonDistribution;
+  size_t                                 attempts=0;
+
+  database->GetBoundingBox(boundingBox);
+
+  latDistribution=std::uniform_real_distribution<double>(boundingBox.GetMinLat(),boundingBox.GetMaxLat());
+  lonDistribution=std::uniform_real_distribution<double>(boundingBox.GetMinLon(),boundingBox.GetMaxLon());
+
+  while (traces.size()<traceCount &&
+         attempts<10*traceCount) {
+    osmscout::RoutePosition start;
+    osmscout::RoutePosition target;
+    osmscout::RouteData     route;
+
+    attempts++;
+
+    if (!router.GetClosestRoutableNode(latDistribution(generator),
+                                       lonDistribution(generator),
+                                       profile.GetVehicle(),
+                                       1000.0,
+                                       start.object,
+                                       start.nodeIndex) ||
+        !router.GetClosestRoutableNode(latDistribution(generator),
+                                       lonDistribution(generator),
+                                       profile.GetVehicle(),
+                                       1000.0,
+                                       target.object,
+                                       target.nodeIndex) ||
+        !start.object.Valid() ||
+        !target.object.Valid()) {
+      continue;
+    }
+
+    if (!router.CalculateRoute(profile,
+                               start.object,
+                               start.nodeIndex,
+                               target.object,
+                               target.nodeIndex,
+                               route) ||
+        route.IsEmpty()) {
+      continue;
+    }
+
+    std::list<osmscout::Point> routePoints;
+    Trace                      trace;
+
+    router.TransformRouteDataToPoints(route,
+                                      routePoints);
+
+    for (const auto& point : routePoints) {
+      trace.nodes.insert(point.GetId());
+    }
+
+    for (const auto& entry : route.Entries()) {
+      if (entry.GetPathObject().Valid()) {
+        trace.ways.insert(entry.GetPathObject().GetFileOffset());
+      }
+    }
+
+    SampleRoute(routePoints,
+                interval,
+                noise,
+                generator,
+                trace.points);
+
+    if (trace.points.size()>=2) {
+      traces.push_back(trace);
+    }
+  }
+}
+
+static bool MatchTraces(const osmscout::DatabaseRef& database,
+                        osmscout::MapMatchingService& matcher,
+                        const osmscout::RoutingProfile& profile,
+                        const std::vector<Trace>& traces,
+                        const std::string& name)
+{
+  std::vector<std::vector<osmscout::GeoCoord>> points;
+  std::vector<osmscout::MatchedTrace>          results;
+  size_t                                       pointCount=0;
+  size_t                                       matchedCount=0;
+  size_t                                       correctCount=0;
+  size_t                                       breakCount=0;
+  size_t                                       gapCount=0;
+
+  for (const auto& trace : traces) {
+    points.push_back(trace.points);
+    pointCount+=trace.points.size();
+  }
+
+  osmscout::StopClock clock;
+
+  if (!matcher.MatchTraces(profile,
+                           points,
+                           results)) {
+    std::cerr << "Error while matching traces" << std::endl;
+    return false;
+  }
+
+  clock.Stop();
+
+  for (size_t t=0; t<traces.size(); t++) {
+    for (const auto& position : results[t].positions) {
+      if (!position.object.Valid()) {
+        continue;
+      }
+
+      matchedCount++;
+
+      osmscout::WayRef way;
+
+      if (traces[t].ways.find(position.object.GetFileOffset())!=traces[t].ways.end()) {
+        correctCount++;
+      }
+      else if (database->GetWayDataFile()->GetByOffset(position.object.GetFileOffset(),
+                                                       way) &&
+               traces[t].nodes.find(way->GetId(position.nodeIndex))!=traces[t].nodes.end()) {
+        correctCount++;
+      }
+    }
+
+    breakCount+=results[t].breakCount;
+    gapCount+=results[t].gapCount;
+  }
+
+  double seconds=clock.GetMilliseconds()/1000.0;
+
+  std::cout << name << ":";
+  std::cout << " time: " << clock;
+  std::cout << " points/s: " << std::fixed << std::setprecision(0) << (seconds>0.0 ? pointCount/seconds : 0.0);
+  std::cout << " matched: " << matchedCount << "/" << pointCount;
+  std::cout << " accuracy: " << std::setprecision(1) << (matchedCount>0 ? 100.0*correctCount/matchedCount : 0.0) << "%";
+  std::cout << " breaks: " << breakCount;
+  std::cout << " gaps: " << gapCount << std::endl;
+
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  std::string       routerFilenamebase=osmscout::RoutingService::DEFAULT_FILENAME_BASE;
+  osmscout::Vehicle vehicle=osmscout::vehicleCar;
+  std::string       mapDirectory;
+  size_t            traceCount=100;
+  double            interval=30.0;
+  double            noise=10.0;
+  size_t            threadCount=0;
+  bool              argumentError=false;
+
+  int currentArg=1;
+  while (currentArg<argc) {
+    if (strcmp(argv[currentArg],"--router")==0) {
+      currentArg++;
+
+      if (currentArg>=argc) {
+        argumentError=true;
+      }
+      else {
+        routerFilenamebase=argv[currentArg];
+        currentArg++;
+      }
+    }
+    else if (strcmp(argv[currentArg],"--foot")==0) {
+      vehicle=osmscout::vehicleFoot;
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--bicycle")==0) {
+      vehicle=osmscout::vehicleBicycle;
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--car")==0) {
+      vehicle=osmscout::vehicleCar;
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--traces")==0) {
+      currentArg++;
+
+      if (currentArg>=argc ||
+          sscanf(argv[currentArg],"%zu",&traceCount)!=1) {
+        argumentError=true;
+      }
+
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--interval")==0) {
+      currentArg++;
+
+      if (currentArg>=argc ||
+          sscanf(argv[currentArg],"%lf",&interval)!=1 ||
+          interval<=0.0) {
+        argumentError=true;
+      }
+
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--noise")==0) {
+      currentArg++;
+
+      if (currentArg>=argc ||
+          sscanf(argv[currentArg],"%lf",&noise)!=1 ||
+          noise<0.0) {
+        argumentError=true;
+      }
+
+      currentArg++;
+    }
+    else if (strcmp(argv[currentArg],"--threads")==0) {
+      currentArg++;
+
+      if (currentArg>=argc ||
+          sscanf(argv[currentArg],"%zu",&threadCount)!=1) {
+        argumentError=true;
+      }
+
+      currentArg++;
+    }
+    else {
+      // No more "special" arguments
+      break;
+    }
+  }
+
+  if (argumentError ||
+      argc-currentArg!=1) {
+    std::cout << "MapMatching" << std::endl;
+    std::cout << "  [--router <router filename base>]" << std::endl;
+    std::cout << "  [--foot | --bicycle | --car]" << std::endl;
+    std::cout << "  [--traces <number of traces>]" << std::endl;
+    std::cout << "  [--interval <distance between trace points in meter>]" << std::endl;
+    std::cout << "  [--noise <standard deviation of the GPS noise in meter>]" << std::endl;
+    std::cout << "  [--threads <number of threads>]" << std::endl;
+    std::cout << "  <map directory>" << std::endl;
+    return 1;
+  }
+
+  mapDirectory=argv[currentArg];
+
+  osmscout::DatabaseParameter databaseParameter;
+  osmscout::DatabaseRef       database=std::make_shared<osmscout::Database>(databaseParameter);
+
+  if (!database->Open(mapDirectory.c_str())) {
+    std::cerr << "Cannot open database" << std::endl;
+
+    return 1;
+  }
+
+  osmscout::RouterParameter routerParameter;
+
+  osmscout::RoutingServiceRef router=std::make_shared<osmscout::RoutingService>(database,
+                                                                                routerParameter,
+                                                                                routerFilenamebase);
+
+  if (!router->Open()) {
+    std::cerr << "Cannot open routing database" << std::endl;
+
+    return 1;
+  }
+
+  osmscout::TypeConfigRef             typeConfig=database->GetTypeConfig();
+  osmscout::FastestPathRoutingProfile routingProfile(typeConfig);
+  std::map<std::string,double>        carSpeedTable;
+
+  switch (vehicle) {
+  case osmscout::vehicleFoot:
+    routingProfile.ParametrizeForFoot(*typeConfig,
+                                      5.0);
+    break;
+  case osmscout::vehicleBicycle:
+    routingProfile.ParametrizeForBicycle(*typeConfig,
+                                         20.0);
+    break;
+  case osmscout::vehicleCar:
+    for (const auto &type : typeConfig->GetTypes()) {
+      if (!type->GetIgnore() &&
+          type->CanRouteCar()) {
+        carSpeedTable[type->GetName()]=80.0;
+      }
+    }
+
+    routingProfile.ParametrizeForCar(*typeConfig,
+                                     carSpeedTable,
+                                     160.0);
+    break;
+  }
+
+  std::vector<Trace> traces;
+  osmscout::StopClock generateClock;
+
+  GenerateTraces(database,
+                 *router,
+                 routingProfile,
+                 traceCount,
+                 interval,
+                 noise,
+                 traces);
+
+  generateClock.Stop();
+
+  size_t pointCount=0;
+
+  for (const auto& trace : traces) {
+    pointCount+=trace.points.size();
+  }
+
+  std::cout << "Generated " << traces.size() << " traces with " << pointCount << " points in " << generateClock << std::endl;
+
+  osmscout::MapMatchingParameter matcherParameter;
+
+  matcherParameter.SetGpsSigma(std::max(noise,1.0));
+  matcherParameter.SetSearchRadius(std::max(5*noise,25.0));
+  matcherParameter.SetThreadCount(threadCount);
+
+  osmscout::MapMatchingService matcher(database,
+                                       router,
+                                       matcherParameter);
+
+  bool result=MatchTraces(database,matcher,routingProfile,traces,"cold") &&
+              MatchTraces(database,matcher,routingProfile,traces,"warm");
+
+  router->Close();
+  database->Close();
+
+  return result ? 0 : 1;
+}
@@ -17,6 +17,8 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
 #include <limits>
@@ -78,12 +80,22 @@ struct LevelStats
   double drawMaxTime;
   double drawTotalTime;
   
+  double prepareTotalTime;
+  double renderTotalTime;
+  double labelLayoutTotalTime;
+  double labelsTotalTime;
+
   double allocMax;
   double allocSum;
 
   size_t nodeCount;
   size_t wayCount;
   size_t areaCount;
+  size_t coordCount;
+  size_t labelsPlaced;
+
+  size_t cacheHits;
+  size_t cacheMisses;
 
   size_t tileCount;
 
@@ -95,17 +107,113 @@ struct LevelStats
     drawMinTime(std::numeric_limits<double>::max()),
     drawMaxTime(0.0),
     drawTotalTime(0.0),
+    prepareTotalTime(0.0),
+    renderTotalTime(0.0),
+    labelLayoutTotalTime(0.0),
+    labelsTotalTime(0.0),
     allocMax(0.0),
     allocSum(0.0),
     nodeCount(0),
     wayCount(0),
     areaCount(0),
+    coordCount(0),
+    labelsPlaced(0),
+    cacheHits(0),
+    cacheMisses(0),
     tileCount(0)
   {
     // no code
   }
+
+  void AddDrawStatistics(const osmscout::MapPainter::DrawStatistics& statistics)
+  {
+    prepareTotalTime+=statistics.prepareAreasTime+
+                      statistics.prepareWaysTime;
+    renderTotalTime+=statistics.groundTime+
+                     statistics.areasTime+
+                     statistics.pathsTime+
+                     statistics.pathDecorationsTime+
+                     statistics.pathShieldLabelsTime+
+                     statistics.pathContourLabelsTime+
+                     statistics.nodesTime+
+                     statistics.areaLabelsTime+
+                     statistics.poisTime;
+    labelLayoutTotalTime+=statistics.labelLayoutTime;
+    labelsTotalTime+=statistics.labelsTime;
+    coordCount+=statistics.coordCount;
+    labelsPlaced+=statistics.labelsPlaced;
+  }
 };
 
+/**
+ * Write the statistics of all levels as JSON array, one object per level
+ */
+static void WriteJSON(std::ostream& out,
+                      const std::list<LevelStats>& statistics)
+{
+  bool first=true;
+
+  out << "[" << std::endl;
+
+  for (const auto& stats : statistics) {
+    if (!first) {
+      out << "," << std::endl;
+    }
+
+    first=false;
+
+    out << "  {";
+    out << "\"level\": " << stats.level << ", ";
+    out << "\"tiles\": " << stats.tileCount << ", ";
+    out << "\"nodes\": " << stats.nodeCount << ", ";
+    out << "\"ways\": " << stats.wayCount << ", ";
+    out << "\"areas\": " << stats.areaCount << ", ";
+    out << "\"coords\": " << stats.coordCount << ", ";
+    out << "\"labels\": " << stats.labelsPlaced << ", ";
+    out << "\"cacheHits\": " << stats.cacheHits << ", ";
+    out << "\"cacheMisses\": " << stats.cacheMisses << ", ";
+    out << "\"dbTime\": " << stats.dbTotalTime << ", ";
+    out << "\"drawTime\": " << stats.drawTotalTime << ", ";
+    out << "\"prepareTime\": " << stats.prepareTotalTime << ", ";
+    out << "\"renderTime\": " << stats.renderTotalTime << ", ";
+    out << "\"labelLayoutTime\": " << stats.labelLayoutTotalTime << ", ";
+    out << "\"labelsTime\": " << stats.labelsTotalTime << ", ";
+    out << "\"allocMax\": " << stats.allocMax;
+    out << "}";
+  }
+
+  out << std::endl << "]" << std::endl;
+}
+
+/**
+ * Write the statistics of all levels as CSV, one line per level
+ */
+static void WriteCSV(std::ostream& out,
+                     const std::list<LevelStats>& statistics)
+{
+  out << "level,tiles,nodes,ways,areas,coords,labels,cacheHits,cacheMisses,";
+  out << "dbTime,drawTime,prepareTime,renderTime,labelLayoutTime,labelsTime,allocMax" << std::endl;
+
+  for (const auto& stats : statistics) {
+    out << stats.level << ",";
+    out << stats.tileCount << ",";
+    out << stats.nodeCount << ",";
+    out << stats.wayCount << ",";
+    out << stats.areaCount << ",";
+    out << stats.coordCount << ",";
+    out << stats.labelsPlaced << ",";
+    out << stats.cacheHits << ",";
+    out << stats.cacheMisses << ",";
+    out << stats.dbTotalTime << ",";
+    out << stats.drawTotalTime << ",";
+    out << stats.prepareTotalTime << ",";
+    out << stats.renderTotalTime << ",";
+    out << stats.labelLayoutTotalTime << ",";
+    out << stats.labelsTotalTime << ",";
+    out << stats.allocMax << std::endl;
+  }
+}
+
 std::string formatAlloc(double size)
 {
     std::string units = " bytes";
@@ -132,6 +240,8 @@ int main(int argc, char* argv[])
   unsigned int  tileWidth;
   unsigned int  tileHeight;
   std::string   driver;
+  std::string   jsonFile;
+  std::string   csvFile;
 
 #if defined(HAVE_LIB_GPERFTOOLS)
   bool          heapProfile;
@@ -145,6 +255,7 @@ int main(int argc, char* argv[])
     std::cerr << "  <start zoom> <end zoom>" << std::endl;
     std::cerr << "  <tile width> <tile height>" << std::endl;
     std::cerr << "  <cairo|Qt|noop|none>" << std::endl;
+    std::cerr << "  [--json <file>] [--csv <file>]" << std::endl;
 #if defined(HAVE_LIB_GPERFTOOLS)    
     std::cerr << "  [heap profile prefix]" << std::endl;    
 #endif
@@ -153,12 +264,25 @@ int main(int argc, char* argv[])
 
 #if defined(HAVE_LIB_GPERFTOOLS)
   heapProfile = false;
+#endif
 
-  if (argc>12) {
+  for (int i=12; i<argc; i++) {
+    if (strcmp(argv[i],"--json")==0 && i+1<argc) {
+      jsonFile=argv[++i];
+    }
+    else if (strcmp(argv[i],"--csv")==0 && i+1<argc) {
+      csvFile=argv[++i];
+    }
+    else {
+#if defined(HAVE_LIB_GPERFTOOLS)
       heapProfile = true;
-      heapProfilePrefix = argv[12];
-  }
+      heapProfilePrefix = argv[i];
+#else
+      std::cerr << "Unknown option '" << argv[i] << "'" << std::endl;
+      return 1;
 #endif
+    }
+  }
   
   map=argv[1];
   style=argv[2];
@@ -310,6 +434,8 @@ int main(int argc, char* argv[])
 
     magnification.SetLevel(level);
 
+    mapService->ResetCacheStatistics();
+
     xTileStart=osmscout::LonToTileX(std::min(lonLeft,lonRight),
                                     magnification);
     xTileEnd=osmscout::LonToTileX(std::max(lonLeft,lonRight),
@@ -425,6 +551,7 @@ int main(int argc, char* argv[])
                                   drawParameter,
                                   data,
                                   cairo);
+          stats.AddDrawStatistics(cairoMapPainter.GetStatistics());
         }
 #endif
 #if defined(HAVE_LIB_OSMSCOUTMAPQT)
@@ -434,12 +561,14 @@ int main(int argc, char* argv[])
                                drawParameter,
                                data,
                                qtPainter);
+          stats.AddDrawStatistics(qtMapPainter.GetStatistics());
         }
 #endif
         if (driver=="noop") {
           noOpMapPainter.DrawMap(projection,
                                  drawParameter,
                                  data);
+          stats.AddDrawStatistics(noOpMapPainter.GetStatistics());
         }
         if (driver=="none") {
           // Do nothing
@@ -459,6 +588,11 @@ int main(int argc, char* argv[])
       }
     }
 
+    osmscout::MapService::CacheStatistics cacheStatistics=mapService->GetCacheStatistics();
+
+    stats.cacheHits=cacheStatistics.hitCount;
+    stats.cacheMisses=cacheStatistics.missCount;
+
     statistics.push_back(stats);
   }
   
@@ -500,6 +634,38 @@ int main(int argc, char* argv[])
     std::cout << "min: " << stats.drawMinTime << " ";
     std::cout << "avg: " << stats.drawTotalTime/stats.tileCount << " ";
     std::cout << "max: " << stats.drawMaxTime << std::endl;
+
+    std::cout << " Map phases : ";
+    std::cout << "prepare: " << stats.prepareTotalTime << " ";
+    std::cout << "render: " << stats.renderTotalTime << " ";
+    std::cout << "label layout: " << stats.labelLayoutTotalTime << " ";
+    std::cout << "labels: " << stats.labelsTotalTime << std::endl;
+
+    std::cout << " Cache      : ";
+    std::cout << "hits: " << stats.cacheHits << " ";
+    std::cout << "misses: " << stats.cacheMisses << std::endl;
+  }
+
+  if (!jsonFile.empty()) {
+    std::ofstream out(jsonFile.c_str());
+
+    WriteJSON(out,
+              statistics);
+
+    if (!out) {
+      std::cerr << "Cannot write JSON file '" << jsonFile << "'" << std::endl;
+    }
+  }
+
+  if (!csvFile.empty()) {
+    std::ofstream out(csvFile.c_str());
+
+    WriteCSV(out,
+             statistics);
+
+    if (!out) {
+      std::cerr << "Cannot write CSV file '" << csvFile << "'" << std::endl;
+    }
   }
 
   database->Close();
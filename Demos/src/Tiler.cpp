@@ -17,14 +17,22 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
+#include <fstream>
 #include <iostream>
 #include <iomanip>
 #include <limits>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <utility>
 
 #include <osmscout/Database.h>
 #include <osmscout/MapService.h>
+#include <osmscout/PersistentTileCache.h>
+#include <osmscout/TilePyramidRenderer.h>
 
 #include <osmscout/MapPainterAgg.h>
+#include <osmscout/TilePyramidWorkerAgg.h>
 
 #include <osmscout/util/StopClock.h>
 #include <osmscout/util/Tiling.h>
@@ -34,11 +42,18 @@
   level directory), drawing the "Ruhrgebiet":
 
   src/Tiler ../maps/nordrhein-westfalen ../stylesheets/standard.oss 51.2 6.5 51.7 8 10 13
+
+  Optional parameters define the number of render threads (default: 1),
+  the size of meta tiles (default: 1, no meta tiles) and a tile cache file.
+  Tiles found in the tile cache are not rendered again, as long as the
+  style sheet does not change.
 */
 
 static unsigned int tileWidth=256;
 static unsigned int tileHeight=256;
 static const double DPI=96.0;
+static const size_t metaTileMargin=128;
+static const size_t tileCacheSize=256*1024*1024;
 
 bool write_ppm(const agg::rendering_buffer& buffer,
                const char* file_name)
@@ -62,6 +77,174 @@ bool write_ppm(const agg::rendering_buffer& buffer,
   return false;
 }
 
+/**
+ * Image of all tiles of a level, including render statistics
+ */
+struct LevelImage
+{
+  int                                 xTileStart;
+  int                                 yTileStart;
+  int                                 xTileCount;
+  int                                 yTileCount;
+  std::vector<unsigned char>          buffer;
+
+  std::mutex                          mutex;
+  std::set<std::pair<size_t,size_t>>  cachedTiles; //!< Tiles (x,y) copied from the tile cache
+  size_t                              renderCount;
+  double                              minTime;
+  double                              maxTime;
+  double                              totalTime;
+};
+
+/**
+ * Write the tile to disk and copy it into the image of the level
+ */
+static bool OutputTile(LevelImage& image,
+                       const osmscout::Magnification& magnification,
+                       size_t x,
+                       size_t y,
+                       const agg::rendering_buffer& tile,
+                       const std::string& action)
+{
+  std::string output=osmscout::NumberToString(magnification.GetLevel())+"_"+osmscout::NumberToString(x)+"_"+osmscout::NumberToString(y)+".ppm";
+
+  if (!write_ppm(tile,output.c_str())) {
+    return false;
+  }
+
+  size_t lineSize=tileWidth*3;
+  size_t imageLineSize=image.xTileCount*lineSize;
+  size_t imageOffset=imageLineSize*(y-image.yTileStart)*tileHeight+
+                     (x-image.xTileStart)*lineSize;
+
+  for (size_t line=0; line<tileHeight; line++) {
+    const unsigned char* row=tile.row_ptr((int)line);
+
+    std::copy(row,
+              row+lineSize,
+              image.buffer.begin()+imageOffset+line*imageLineSize);
+  }
+
+  std::lock_guard<std::mutex> lock(image.mutex);
+
+  std::cout << action << " tile " << magnification.GetLevel() << "." << y << "." << x << std::endl;
+
+  return true;
+}
+
+/**
+ * Renders (meta) tiles of a level using its own painter and buffer. The tiles
+ * are written to disk, copied into the image of the level and stored in the
+ * tile cache.
+ */
+class TileWorker : public osmscout::TilePyramidWorkerAgg
+{
+private:
+  LevelImage&                    image;
+  osmscout::PersistentTileCache* tileCache;
+  uint64_t                       styleHash;
+
+private:
+  void AddTime(const osmscout::StopClock& timer)
+  {
+    std::lock_guard<std::mutex> lock(image.mutex);
+
+    double time=timer.GetMilliseconds();
+
+    image.renderCount++;
+    image.minTime=std::min(image.minTime,time);
+    image.maxTime=std::max(image.maxTime,time);
+    image.totalTime+=time;
+  }
+
+protected:
+  bool WriteTile(const osmscout::Magnification& magnification,
+                 size_t x,
+                 size_t y,
+                 const agg::rendering_buffer& tile)
+  {
+    {
+      std::lock_guard<std::mutex> lock(image.mutex);
+
+      // Meta tiles are rendered, if at least one of their tiles is not cached.
+      // The cached tiles have already been written and are unchanged.
+      if (image.cachedTiles.find(std::make_pair(x,y))!=image.cachedTiles.end()) {
+        return true;
+      }
+    }
+
+    if (!OutputTile(image,
+                    magnification,
+                    x,y,
+                    tile,
+                    "Drawing")) {
+      return false;
+    }
+
+    if (tileCache!=NULL) {
+      // Tiles of meta tiles are part of a larger buffer, so we copy line by line
+      size_t      lineSize=tileWidth*3;
+      std::string data;
+
+      data.reserve(lineSize*tileHeight);
+
+      for (size_t line=0; line<tileHeight; line++) {
+        const unsigned char* row=tile.row_ptr((int)line);
+
+        data.append((const char*)row,lineSize);
+      }
+
+      if (!tileCache->PutTile(osmscout::TileId(magnification,x,y),
+                              styleHash,
+                              data)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+public:
+  TileWorker(const osmscout::StyleConfigRef& styleConfig,
+             const osmscout::MapParameter& drawParameter,
+             LevelImage& image,
+             osmscout::PersistentTileCache* tileCache,
+             uint64_t styleHash)
+  : TilePyramidWorkerAgg(styleConfig,drawParameter),
+    image(image),
+    tileCache(tileCache),
+    styleHash(styleHash)
+  {
+    // no code
+  }
+
+  bool RenderTile(const osmscout::TileProjection& projection,
+                  size_t x,
+                  size_t y,
+                  const osmscout::MapData& data)
+  {
+    osmscout::StopClock timer;
+    bool                result=TilePyramidWorkerAgg::RenderTile(projection,x,y,data);
+
+    timer.Stop();
+    AddTime(timer);
+
+    return result;
+  }
+
+  bool RenderMetaTile(const osmscout::MetaTile& metaTile,
+                      const osmscout::MapData& data)
+  {
+    osmscout::StopClock timer;
+    bool                result=TilePyramidWorkerAgg::RenderMetaTile(metaTile,data);
+
+    timer.Stop();
+    AddTime(timer);
+
+    return result;
+  }
+};
+
 int main(int argc, char* argv[])
 {
   std::string  map;
@@ -69,13 +252,15 @@ int main(int argc, char* argv[])
   double       latTop,latBottom,lonLeft,lonRight;
   unsigned int startLevel;
   unsigned int endLevel;
+  unsigned int threadCount=1;
+  unsigned int metaTileSize=1;
+  std::string  tileCacheFile;
 
-  if (argc!=9) {
-    std::cerr << "DrawMap ";
+  if (argc<9 || argc>12) {
+    std::cerr << "Tiler ";
     std::cerr << "<map directory> <style-file> ";
     std::cerr << "<lat_top> <lon_left> <lat_bottom> <lon_right> ";
-    std::cerr << "<start_zoom>" << std::endl;
-    std::cerr << "<end_zoom>" << std::endl;
+    std::cerr << "<start_zoom> <end_zoom> [<threads> [<meta tile size> [<tile cache file>]]]" << std::endl;
     return 1;
   }
 
@@ -112,6 +297,22 @@ int main(int argc, char* argv[])
     return 1;
   }
 
+  if (argc>=10 &&
+      (sscanf(argv[9],"%u",&threadCount)!=1 || threadCount==0)) {
+    std::cerr << "thread count is not a positive number!" << std::endl;
+    return 1;
+  }
+
+  if (argc>=11 &&
+      (sscanf(argv[10],"%u",&metaTileSize)!=1 || metaTileSize==0)) {
+    std::cerr << "meta tile size is not a positive number!" << std::endl;
+    return 1;
+  }
+
+  if (argc>=12) {
+    tileCacheFile=argv[11];
+  }
+
   osmscout::DatabaseParameter databaseParameter;
   osmscout::DatabaseRef       database=std::make_shared<osmscout::Database>(databaseParameter);
   osmscout::MapServiceRef     mapService=std::make_shared<osmscout::MapService>(database);
@@ -128,10 +329,20 @@ int main(int argc, char* argv[])
     std::cerr << "Cannot open style" << std::endl;
   }
 
-  osmscout::TileProjection      projection;
-  osmscout::MapParameter        drawParameter;
-  osmscout::AreaSearchParameter searchParameter;
-  osmscout::MapData             data;
+  osmscout::TilePyramidRendererParameter rendererParameter;
+  osmscout::MapParameter                 drawParameter;
+  osmscout::AreaSearchParameter          searchParameter;
+
+  rendererParameter.SetThreadCount(threadCount);
+  rendererParameter.SetTileWidth(tileWidth);
+  rendererParameter.SetTileHeight(tileHeight);
+  rendererParameter.SetDPI(DPI);
+  rendererParameter.SetMetaTileSize(metaTileSize);
+
+  if (metaTileSize>1) {
+    // Labels crossing the border of the meta tile must be drawn consistently, too
+    rendererParameter.SetMetaTileMargin(metaTileMargin);
+  }
 
   // Change this, to match your system
   drawParameter.SetFontName("/usr/share/fonts/truetype/msttcorefonts/Verdana.ttf");
@@ -146,126 +357,131 @@ int main(int argc, char* argv[])
   searchParameter.SetUseLowZoomOptimization(false);
   searchParameter.SetMaximumAreaLevel(3);
 
-  osmscout::MapPainterAgg painter(styleConfig);
+  osmscout::PersistentTileCache tileCache(tileCacheSize);
+  uint64_t                      styleHash=0;
+
+  if (!tileCacheFile.empty()) {
+    std::ifstream     styleFile(style.c_str(),std::ios::in | std::ios::binary);
+    std::stringstream styleHashData;
+
+    // Tiles have to be rendered again, if the style or the render parameter change
+    styleHashData << styleFile.rdbuf();
+    styleHashData << tileWidth << "x" << tileHeight << "@" << DPI << " " << drawParameter.GetFontName() << " " << drawParameter.GetFontSize();
+
+    styleHash=osmscout::PersistentTileCache::CalculateHash(styleHashData.str());
+
+    if (!tileCache.Open(tileCacheFile)) {
+      std::cerr << "Cannot open tile cache" << std::endl;
+      database->Close();
+
+      return 1;
+    }
+  }
+
+  osmscout::TilePyramidRenderer renderer(mapService,
+                                         styleConfig,
+                                         rendererParameter);
+  osmscout::GeoBox              boundingBox(osmscout::GeoCoord(latTop,lonLeft),
+                                            osmscout::GeoCoord(latBottom,lonRight));
 
   for (size_t level=std::min(startLevel,endLevel);
        level<=std::max(startLevel,endLevel);
        level++) {
     osmscout::Magnification magnification;
-    int                     xTileStart,xTileEnd,xTileCount,yTileStart,yTileEnd,yTileCount;
+    LevelImage              image;
+    int                     xTileEnd,yTileEnd;
 
     magnification.SetLevel(level);
 
-    xTileStart=osmscout::LonToTileX(std::min(lonLeft,lonRight),
-                                    magnification);
-    xTileEnd=osmscout::LonToTileX(std::max(lonLeft,lonRight),
+    image.xTileStart=osmscout::LonToTileX(boundingBox.GetMinLon(),
+                                          magnification);
+    xTileEnd=osmscout::LonToTileX(boundingBox.GetMaxLon(),
                                   magnification);
-    xTileCount=xTileEnd-xTileStart+1;
+    image.xTileCount=xTileEnd-image.xTileStart+1;
 
-    yTileStart=osmscout::LatToTileY(std::max(latTop,latBottom),
-                                    magnification);
-    yTileEnd=osmscout::LatToTileY(std::min(latTop,latBottom),
+    image.yTileStart=osmscout::LatToTileY(boundingBox.GetMaxLat(),
+                                          magnification);
+    yTileEnd=osmscout::LatToTileY(boundingBox.GetMinLat(),
                                   magnification);
-
-    yTileCount=yTileEnd-yTileStart+1;
-
-    std::cout << "Drawing zoom " << level << ", " << (xTileCount)*(yTileCount) << " tiles [" << xTileStart << "," << yTileStart << " - " <<  xTileEnd << "," << yTileEnd << "]" << std::endl;
-
-    unsigned long bitmapSize=tileWidth*tileHeight*3*xTileCount*yTileCount;
-    unsigned char *buffer=new unsigned char[bitmapSize];
-
-
-    memset(buffer,0,bitmapSize);
-
-    agg::rendering_buffer rbuf(buffer,
-                               tileWidth*xTileCount,
-                               tileHeight*yTileCount,
-                               tileWidth*xTileCount*3);
-
-    double minTime=std::numeric_limits<double>::max();
-    double maxTime=0.0;
-    double totalTime=0.0;
-
-    osmscout::TypeInfoSet nodeTypes;
-    osmscout::TypeInfoSet wayTypes;
-    osmscout::TypeInfoSet areaTypes;
-
-    styleConfig->GetNodeTypesWithMaxMag(magnification,
-                                        nodeTypes);
-
-    styleConfig->GetWayTypesWithMaxMag(magnification,
-                                       wayTypes);
-
-    styleConfig->GetAreaTypesWithMaxMag(magnification,
-                                        areaTypes);
-
-    for (int y=yTileStart; y<=yTileEnd; y++) {
-      for (int x=xTileStart; x<=xTileEnd; x++) {
-        agg::pixfmt_rgb24   pf(rbuf);
-        osmscout::StopClock timer;
-        osmscout::GeoBox    boundingBox;
-
-        projection.Set(x,y,
-                       magnification,
-                       DPI,
-                       tileWidth,
-                       tileHeight);
-
-        projection.GetDimensions(boundingBox);
-
-        std::cout << "Drawing tile " << level << "." << y << "." << x << " " << boundingBox.GetDisplayText() << std::endl;
-
-        osmscout::GeoBox dataBoundingBox(osmscout::GeoCoord(osmscout::TileYToLat(y-1,magnification),osmscout::TileXToLon(x-1,magnification)),
-                                         osmscout::GeoCoord(osmscout::TileYToLat(y+1,magnification),osmscout::TileXToLon(x+1,magnification)));
-
-        std::list<osmscout::TileRef> tiles;
-
-        mapService->LookupTiles(magnification,dataBoundingBox,tiles);
-        mapService->LoadMissingTileData(searchParameter,*styleConfig,tiles);
-        mapService->ConvertTilesToMapData(tiles,data);
-
-        size_t bufferOffset=xTileCount*tileWidth*3*(y-yTileStart)*tileHeight+
-                            (x-xTileStart)*tileWidth*3;
-
-        rbuf.attach(buffer+bufferOffset,
-                    tileWidth,tileHeight,
-                    tileWidth*xTileCount*3);
-
-        painter.DrawMap(projection,
-                        drawParameter,
-                        data,
-                        &pf);
-
-        timer.Stop();
-
-        double time=timer.GetMilliseconds();
-
-        minTime=std::min(minTime,time);
-        maxTime=std::max(maxTime,time);
-        totalTime+=time;
-
-        std::string output=osmscout::NumberToString(level)+"_"+osmscout::NumberToString(x)+"_"+osmscout::NumberToString(y)+".ppm";
-
-        write_ppm(rbuf,output.c_str());
-      }
+    image.yTileCount=yTileEnd-image.yTileStart+1;
+
+    image.buffer.resize(tileWidth*tileHeight*3*image.xTileCount*image.yTileCount,0);
+    image.cachedTiles.clear();
+    image.renderCount=0;
+    image.minTime=std::numeric_limits<double>::max();
+    image.maxTime=0.0;
+    image.totalTime=0.0;
+
+    std::cout << "Drawing zoom " << level << ", " << (image.xTileCount)*(image.yTileCount) << " tiles [" << image.xTileStart << "," << image.yTileStart << " - " <<  xTileEnd << "," << yTileEnd << "]" << std::endl;
+
+    osmscout::StopClock levelTimer;
+
+    osmscout::PersistentTileCache* cache=tileCache.IsOpen() ? &tileCache : NULL;
+
+    if (!renderer.RenderTiles(boundingBox,
+                              magnification,
+                              searchParameter,
+                              [&styleConfig,&drawParameter,&image,cache,styleHash]() {
+                                return std::make_shared<TileWorker>(styleConfig,
+                                                                    drawParameter,
+                                                                    image,
+                                                                    cache,
+                                                                    styleHash);
+                              },
+                              [&image,cache,styleHash](const osmscout::Magnification& magnification,
+                                                       size_t x,
+                                                       size_t y) {
+                                std::string data;
+
+                                // Tiles found in the cache are copied to the output without rendering
+                                if (cache==NULL ||
+                                    !cache->GetTile(osmscout::TileId(magnification,x,y),styleHash,data) ||
+                                    data.length()!=tileWidth*tileHeight*3) {
+                                  return true;
+                                }
+
+                                agg::rendering_buffer tile((unsigned char*)&data[0],
+                                                           tileWidth,
+                                                           tileHeight,
+                                                           tileWidth*3);
+
+                                if (!OutputTile(image,
+                                                magnification,
+                                                x,y,
+                                                tile,
+                                                "Cached")) {
+                                  return true;
+                                }
+
+                                std::lock_guard<std::mutex> lock(image.mutex);
+
+                                image.cachedTiles.insert(std::make_pair(x,y));
+
+                                return false;
+                              })) {
+      std::cerr << "Error while rendering zoom " << level << std::endl;
+      database->Close();
+
+      return 1;
     }
 
-    rbuf.attach(buffer,
-                tileWidth*xTileCount,
-                tileHeight*yTileCount,
-                tileWidth*xTileCount*3);
+    levelTimer.Stop();
+
+    agg::rendering_buffer rbuf(image.buffer.data(),
+                               tileWidth*image.xTileCount,
+                               tileHeight*image.yTileCount,
+                               tileWidth*image.xTileCount*3);
 
     std::string output=osmscout::NumberToString(level)+"_full_map.ppm";
 
     write_ppm(rbuf,output.c_str());
 
-    delete[] buffer;
-
     std::cout << "=> Time: ";
-    std::cout << "total: " << totalTime << " msec ";
-    std::cout << "min: " << minTime << " msec ";
-    std::cout << "avg: " << totalTime/(xTileCount*yTileCount) << " msec ";
-    std::cout << "max: " << maxTime << " msec" << std::endl;
+    std::cout << "elapsed: " << levelTimer.GetMilliseconds() << " msec ";
+    std::cout << "total: " << image.totalTime << " msec ";
+    std::cout << "min: " << image.minTime << " msec ";
+    std::cout << "avg: " << image.totalTime/std::max(image.renderCount,(size_t)1) << " msec ";
+    std::cout << "max: " << image.maxTime << " msec" << std::endl;
   }
 
   database->Close();
@@ -0,0 +1,295 @@
+/*
+  VectorTiler - a demo program for libosmscout
+  Copyright (C) 2016  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include <osmscout/Database.h>
+#include <osmscout/MapService.h>
+#include <osmscout/TilePyramidRenderer.h>
+#include <osmscout/VectorTileEncoder.h>
+
+#include <osmscout/util/File.h>
+#include <osmscout/util/StopClock.h>
+#include <osmscout/util/String.h>
+#include <osmscout/util/Tiling.h>
+
+/*
+  Example for the nordrhein-westfalen.osm (to be executed in the Demos top
+  level directory), exporting the "Ruhrgebiet" as vector tiles to the directory
+  "tiles":
+
+  src/VectorTiler ../maps/nordrhein-westfalen ../stylesheets/standard.oss 51.2 6.5 51.7 8 10 14 tiles
+
+  The tiles are written as <zoom>_<x>_<y>.mvt, tiles without any objects are
+  skipped. The optional parameter defines the number of encoder threads
+  (default: number of cores).
+*/
+
+/**
+ * Statistics of all tiles of a level
+ */
+struct LevelStatistics
+{
+  std::mutex mutex;
+  size_t     tileCount;
+  size_t     emptyCount;
+  size_t     byteCount;
+  size_t     maxBytes;
+  double     totalTime;
+  double     maxTime;
+};
+
+/**
+ * Encodes the tiles using the shared encoder and writes them to the output
+ * directory.
+ */
+class TileWorker : public osmscout::TilePyramidWorker
+{
+private:
+  const osmscout::VectorTileEncoder& encoder;
+  std::string                        directory;
+  LevelStatistics&                   statistics;
+  std::string                        tile;
+
+private:
+  bool WriteTile(const std::string& filename)
+  {
+    std::ofstream file(filename.c_str(),std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!file) {
+      return false;
+    }
+
+    file.write(tile.data(),tile.length());
+    file.close();
+
+    return !file.fail();
+  }
+
+public:
+  TileWorker(const osmscout::VectorTileEncoder& encoder,
+             const std::string& directory,
+             LevelStatistics& statistics)
+  : encoder(encoder),
+    directory(directory),
+    statistics(statistics)
+  {
+    // no code
+  }
+
+  bool RenderTile(const osmscout::TileProjection& projection,
+                  size_t x,
+                  size_t y,
+                  const osmscout::MapData& data)
+  {
+    osmscout::StopClock timer;
+
+    if (!encoder.Encode(projection.GetMagnification(),
+                        x,y,
+                        data,
+                        tile)) {
+      return false;
+    }
+
+    timer.Stop();
+
+    if (!tile.empty()) {
+      std::string filename=osmscout::AppendFileToDir(directory,
+                                                     osmscout::NumberToString(projection.GetMagnification().GetLevel())+"_"+
+                                                     osmscout::NumberToString(x)+"_"+
+                                                     osmscout::NumberToString(y)+".mvt");
+
+      if (!WriteTile(filename)) {
+        std::cerr << "Cannot write tile '" << filename << "'" << std::endl;
+        return false;
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(statistics.mutex);
+
+    double time=timer.GetMilliseconds();
+
+    statistics.tileCount++;
+
+    if (tile.empty()) {
+      statistics.emptyCount++;
+    }
+
+    statistics.byteCount+=tile.length();
+    statistics.maxBytes=std::max(statistics.maxBytes,tile.length());
+    statistics.totalTime+=time;
+    statistics.maxTime=std::max(statistics.maxTime,time);
+
+    return true;
+  }
+};
+
+int main(int argc, char* argv[])
+{
+  std::string  map;
+  std::string  style;
+  double       latTop,latBottom,lonLeft,lonRight;
+  unsigned int startLevel;
+  unsigned int endLevel;
+  std::string  directory;
+  unsigned int threadCount=std::max(1u,std::thread::hardware_concurrency());
+
+  if (argc<10 || argc>11) {
+    std::cerr << "VectorTiler ";
+    std::cerr << "<map directory> <style-file> ";
+    std::cerr << "<lat_top> <lon_left> <lat_bottom> <lon_right> ";
+    std::cerr << "<start_zoom> <end_zoom> <output directory> [<threads>]" << std::endl;
+    return 1;
+  }
+
+  map=argv[1];
+  style=argv[2];
+
+  if (sscanf(argv[3],"%lf",&latTop)!=1) {
+    std::cerr << "lat is not numeric!" << std::endl;
+    return 1;
+  }
+
+  if (sscanf(argv[4],"%lf",&lonLeft)!=1) {
+    std::cerr << "lon is not numeric!" << std::endl;
+    return 1;
+  }
+
+  if (sscanf(argv[5],"%lf",&latBottom)!=1) {
+    std::cerr << "lat is not numeric!" << std::endl;
+    return 1;
+  }
+
+  if (sscanf(argv[6],"%lf",&lonRight)!=1) {
+    std::cerr << "lon is not numeric!" << std::endl;
+    return 1;
+  }
+
+  if (sscanf(argv[7],"%u",&startLevel)!=1) {
+    std::cerr << "start zoom is not numeric!" << std::endl;
+    return 1;
+  }
+
+  if (sscanf(argv[8],"%u",&endLevel)!=1) {
+    std::cerr << "end zoom is not numeric!" << std::endl;
+    return 1;
+  }
+
+  directory=argv[9];
+
+  if (!osmscout::ExistsInFilesystem(directory) ||
+      !osmscout::IsDirectory(directory)) {
+    std::cerr << "'" << directory << "' is not a directory!" << std::endl;
+    return 1;
+  }
+
+  if (argc>=11 &&
+      (sscanf(argv[10],"%u",&threadCount)!=1 || threadCount==0)) {
+    std::cerr << "thread count is not a positive number!" << std::endl;
+    return 1;
+  }
+
+  osmscout::DatabaseParameter databaseParameter;
+  osmscout::DatabaseRef       database=std::make_shared<osmscout::Database>(databaseParameter);
+  osmscout::MapServiceRef     mapService=std::make_shared<osmscout::MapService>(database);
+
+  if (!database->Open(map.c_str())) {
+    std::cerr << "Cannot open database" << std::endl;
+
+    return 1;
+  }
+
+  osmscout::StyleConfigRef styleConfig=std::make_shared<osmscout::StyleConfig>(database->GetTypeConfig());
+
+  if (!styleConfig->Load(style)) {
+    std::cerr << "Cannot open style" << std::endl;
+    database->Close();
+
+    return 1;
+  }
+
+  osmscout::TilePyramidRendererParameter rendererParameter;
+  osmscout::AreaSearchParameter          searchParameter;
+  osmscout::VectorTileEncoder            encoder(database->GetTypeConfig());
+
+  rendererParameter.SetThreadCount(threadCount);
+
+  searchParameter.SetUseLowZoomOptimization(false);
+  searchParameter.SetMaximumAreaLevel(3);
+
+  osmscout::TilePyramidRenderer renderer(mapService,
+                                         styleConfig,
+                                         rendererParameter);
+  osmscout::GeoBox              boundingBox(osmscout::GeoCoord(latTop,lonLeft),
+                                            osmscout::GeoCoord(latBottom,lonRight));
+
+  for (size_t level=std::min(startLevel,endLevel);
+       level<=std::max(startLevel,endLevel);
+       level++) {
+    osmscout::Magnification magnification;
+    LevelStatistics         statistics;
+
+    magnification.SetLevel(level);
+
+    statistics.tileCount=0;
+    statistics.emptyCount=0;
+    statistics.byteCount=0;
+    statistics.maxBytes=0;
+    statistics.totalTime=0.0;
+    statistics.maxTime=0.0;
+
+    std::cout << "Encoding zoom " << level << "..." << std::endl;
+
+    osmscout::StopClock levelTimer;
+
+    if (!renderer.RenderTiles(boundingBox,
+                              magnification,
+                              searchParameter,
+                              [&encoder,&directory,&statistics]() {
+                                return std::make_shared<TileWorker>(encoder,
+                                                                    directory,
+                                                                    statistics);
+                              })) {
+      std::cerr << "Error while encoding zoom " << level << std::endl;
+      database->Close();
+
+      return 1;
+    }
+
+    levelTimer.Stop();
+
+    std::cout << "=> Tiles: " << statistics.tileCount << " (" << statistics.emptyCount << " empty) ";
+    std::cout << "size: " << osmscout::ByteSizeToString(statistics.byteCount) << " ";
+    std::cout << "max: " << osmscout::ByteSizeToString(statistics.maxBytes) << std::endl;
+    std::cout << "=> Time: ";
+    std::cout << "elapsed: " << levelTimer.GetMilliseconds() << " msec ";
+    std::cout << "total: " << statistics.totalTime << " msec ";
+    std::cout << "avg: " << statistics.totalTime/std::max(statistics.tileCount,(size_t)1) << " msec ";
+    std::cout << "max: " << statistics.maxTime << " msec" << std::endl;
+  }
+
+  database->Close();
+
+  return 0;
+}
@@ -21,6 +21,7 @@
 #include <stdio.h>
 
 #include <iostream>
+#include <map>
 #include <memory>
 #include <sstream>
 #include <string>
@@ -87,7 +88,7 @@ static std::string VehcileMaskToString(osmscout::VehicleMask vehicleMask)
 
 void DumpHelp(osmscout::ImportParameter& parameter)
 {
-  std::cout << "Import -h -d -s <start step> -e <end step> [openstreetmapdata.osm|openstreetmapdata.osm.pbf]..." << std::endl;
+  std::cout << "Import -h -d -s <start step> -e <end step> [openstreetmapdata.osm|openstreetmapdata.osm.gz|openstreetmapdata.osm.bz2|openstreetmapdata.osm.pbf]..." << std::endl;
   std::cout << " -h|--help                            show this help" << std::endl;
   std::cout << " -d                                   show debug output" << std::endl;
   std::cout << " -s <start step>                      set starting step" << std::endl;
@@ -102,6 +103,8 @@ void DumpHelp(osmscout::ImportParameter& parameter)
 
   std::cout << " --numericIndexPageSize <number>      size of an numeric index page in bytes (default: " << parameter.GetNumericIndexPageSize() << ")" << std::endl;
 
+  std::cout << " --processingQueueSize <number>       maximum number of blocks in flight while parsing (default: " << parameter.GetProcessingQueueSize() << ")" << std::endl;
+
   std::cout << " --rawCoordBlockSize <number>         number of raw coords resolved in block (default: " << parameter.GetRawCoordBlockSize() << ")" << std::endl;
 
   std::cout << " --rawNodeDataMemoryMaped true|false  memory maped raw node data file access (default: " << BoolToString(parameter.GetRawNodeDataMemoryMaped()) << ")" << std::endl;
@@ -112,9 +115,10 @@ void DumpHelp(osmscout::ImportParameter& parameter)
   std::cout << " --rawWayBlockSize <number>           number of raw ways resolved in block (default: " << parameter.GetRawWayBlockSize() << ")" << std::endl;
 
   std::cout << " --noSort                             do not sort objects" << std::endl;
-  std::cout << " --sortBlockSize <number>             size of one data block during sorting (default: " << parameter.GetSortBlockSize() << ")" << std::endl;
+  std::cout << " --sortMemoryBudget <number>          memory in bytes used for buffering objects during sorting (default: " << parameter.GetSortMemoryBudget() << ")" << std::endl;
 
   std::cout << " --coordDataMemoryMaped true|false    memory maped coord data file access (default: " << BoolToString(parameter.GetCoordDataMemoryMaped()) << ")" << std::endl;
+  std::cout << " --coordDataDense true|false          store coords in a dense array indexed by node id (default: " << BoolToString(parameter.GetCoordDataDense()) << ")" << std::endl;
   std::cout << " --coordIndexCacheSize <number>       coord index cache size (default: " << parameter.GetCoordIndexCacheSize() << ")" << std::endl;
   std::cout << " --coordBlockSize <number>            number of coords resolved in block (default: " << parameter.GetCoordBlockSize() << ")" << std::endl;
 
@@ -125,6 +129,14 @@ void DumpHelp(osmscout::ImportParameter& parameter)
   std::cout << " --wayDataCacheSize <number>          way data cache size (default: " << parameter.GetWayDataCacheSize() << ")" << std::endl;
 
   std::cout << " --routeNodeBlockSize <number>        number of route nodes resolved in block (default: " << parameter.GetRouteNodeBlockSize() << ")" << std::endl;
+  std::cout << " --routeNodeMemoryBudget <number>     memory in bytes used for buffering node ids while collecting route nodes (default: " << parameter.GetRouteNodeMemoryBudget() << ")" << std::endl;
+  std::cout << " --routeCSR true|false                generate a compact route graph for faster routing (default: " << BoolToString(parameter.GetRouteCompactGraph()) << ")" << std::endl;
+  std::cout << " --routeCH true|false                 generate contraction hierarchies for faster routing (default: " << BoolToString(parameter.GetRouteContractionHierarchy()) << ")" << std::endl;
+  std::cout << " --routeCHCarSpeeds <type>=<km/h>[,<type>=<km/h>]..." << std::endl
+            << "                                      speed of all car routable types, the car contraction hierarchy is generated" << std::endl
+            << "                                      for the fastest route using these speeds (default: none, shortest route)" << std::endl;
+  std::cout << " --routeCHCarMaxSpeed <km/h>          maximum car speed for the car contraction hierarchy (default: " << parameter.GetRouteContractionHierarchyCarMaxSpeed() << ")" << std::endl;
+  std::cout << " --routeSegmentIndex true|false       generate an index of routable segments for finding the closest routable node (default: " << BoolToString(parameter.GetRouteSegmentIndex()) << ")" << std::endl;
   std::cout << " --langOrder <#|lang1[,#|lang2]..>    language order when parsing lang[:language] and place_name[:language] tags" << std::endl
             << "                                      # is the default language (no :language) (default: #)" << std::endl;
   std::cout << " --altLangOrder <#|lang1[,#|lang2]..> same as --langOrder for a second alternate language (default: none)" << std::endl;
@@ -271,6 +283,85 @@ osmscout::ImportParameter::RouterRef ParseRouterArgument(int argc,
   return std::make_shared<osmscout::ImportParameter::Router>(vehicleMask,filenamebase);
 }
 
+bool ParseDoubleArgument(int argc,
+                         char* argv[],
+                         int& currentIndex,
+                         double& value)
+{
+  int parameterIndex=currentIndex;
+  int argumentIndex=currentIndex+1;
+
+  currentIndex+=2;
+
+  if (argumentIndex>=argc) {
+    std::cerr << "Missing parameter after option '" << argv[parameterIndex] << "'" << std::endl;
+    return false;
+  }
+
+  if (!osmscout::StringToNumber(argv[argumentIndex],
+                                value) ||
+      value<=0.0) {
+    std::cerr << "Cannot parse argument for parameter '" << argv[parameterIndex] << "'" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * Parse a speed table of the form "<type>=<km/h>[,<type>=<km/h>]..."
+ */
+bool ParseSpeedTableArgument(int argc,
+                             char* argv[],
+                             int& currentIndex,
+                             std::map<std::string,double>& speeds)
+{
+  int parameterIndex=currentIndex;
+  int argumentIndex=currentIndex+1;
+
+  currentIndex+=2;
+
+  if (argumentIndex>=argc) {
+    std::cerr << "Missing parameter after option '" << argv[parameterIndex] << "'" << std::endl;
+    return false;
+  }
+
+  std::string argument=argv[argumentIndex];
+  size_t      start=0;
+
+  while (start<argument.length()) {
+    size_t devider=argument.find(',',start);
+
+    if (devider==std::string::npos) {
+      devider=argument.length();
+    }
+
+    std::string entry=argument.substr(start,devider-start);
+    size_t      pos=entry.find('=');
+    double      speed;
+
+    if (pos==std::string::npos ||
+        pos==0 ||
+        !osmscout::StringToNumber(entry.substr(pos+1),
+                                  speed) ||
+        speed<=0.0) {
+      std::cerr << "Cannot parse speed table entry '" << entry << "' for parameter '" << argv[parameterIndex] << "'" << std::endl;
+      return false;
+    }
+
+    speeds[entry.substr(0,pos)]=speed;
+
+    start=devider+1;
+  }
+
+  if (speeds.empty()) {
+    std::cerr << "Empty speed table for parameter '" << argv[parameterIndex] << "'" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
 std::vector<std::string> &split(const std::string &s, char delim, std::vector<std::string> &elems) {
     std::stringstream ss(s);
     std::string item;
@@ -345,6 +436,9 @@ static void DumpParameter(const osmscout::ImportParameter& parameter,
   progress.Info(std::string("NumericIndexPageSize: ")+
                 osmscout::NumberToString(parameter.GetNumericIndexPageSize()));
 
+  progress.Info(std::string("ProcessingQueueSize: ")+
+                osmscout::NumberToString(parameter.GetProcessingQueueSize()));
+
   progress.Info(std::string("RawCoordBlockSize: ")+
                 osmscout::NumberToString(parameter.GetRawCoordBlockSize()));
 
@@ -363,11 +457,13 @@ static void DumpParameter(const osmscout::ImportParameter& parameter,
 
   progress.Info(std::string("SortObjects: ")+
                 (parameter.GetSortObjects() ? "true" : "false"));
-  progress.Info(std::string("SortBlockSize: ")+
-                osmscout::NumberToString(parameter.GetSortBlockSize()));
+  progress.Info(std::string("SortMemoryBudget: ")+
+                osmscout::NumberToString(parameter.GetSortMemoryBudget()));
 
   progress.Info(std::string("CoordDataMemoryMaped: ")+
                 (parameter.GetCoordDataMemoryMaped() ? "true" : "false"));
+  progress.Info(std::string("CoordDataDense: ")+
+                (parameter.GetCoordDataDense() ? "true" : "false"));
   progress.Info(std::string("CoordIndexCacheSize: ")+
                 osmscout::NumberToString(parameter.GetCoordIndexCacheSize()));
   progress.Info(std::string("CoordBlockSize: ")+
@@ -385,6 +481,20 @@ static void DumpParameter(const osmscout::ImportParameter& parameter,
 
   progress.Info(std::string("RouteNodeBlockSize: ")+
                 osmscout::NumberToString(parameter.GetRouteNodeBlockSize()));
+  progress.Info(std::string("RouteNodeMemoryBudget: ")+
+                osmscout::NumberToString(parameter.GetRouteNodeMemoryBudget()));
+  progress.Info(std::string("RouteCompactGraph: ")+
+                (parameter.GetRouteCompactGraph() ? "true" : "false"));
+  progress.Info(std::string("RouteContractionHierarchy: ")+
+                (parameter.GetRouteContractionHierarchy() ? "true" : "false"));
+  for (const auto& speed : parameter.GetRouteContractionHierarchyCarSpeeds()) {
+    progress.Info(std::string("RouteContractionHierarchyCarSpeed: ")+
+                  speed.first+"="+osmscout::NumberToString((long)speed.second));
+  }
+  progress.Info(std::string("RouteContractionHierarchyCarMaxSpeed: ")+
+                osmscout::NumberToString((long)parameter.GetRouteContractionHierarchyCarMaxSpeed()));
+  progress.Info(std::string("RouteSegmentIndex: ")+
+                (parameter.GetRouteSegmentIndex() ? "true" : "false"));
 }
 
 bool DumpDataSize(const osmscout::ImportParameter& parameter,
@@ -598,6 +708,19 @@ int main(int argc, char* argv[])
         parameterError=true;
       }
     }
+    else if (strcmp(argv[i],"--processingQueueSize")==0) {
+      size_t processingQueueSize;
+
+      if (ParseSizeTArgument(argc,
+                             argv,
+                             i,
+                             processingQueueSize)) {
+        parameter.SetProcessingQueueSize(processingQueueSize);
+      }
+      else {
+        parameterError=true;
+      }
+    }
     else if (strcmp(argv[i],"--rawCoordBlockSize")==0) {
       size_t rawCoordBlockSize;
 
@@ -681,14 +804,14 @@ int main(int argc, char* argv[])
 
       i++;
     }
-    else if (strcmp(argv[i],"--sortBlockSize")==0) {
-      size_t sortBlockSize;
+    else if (strcmp(argv[i],"--sortMemoryBudget")==0) {
+      size_t sortMemoryBudget;
 
       if (ParseSizeTArgument(argc,
                              argv,
                              i,
-                             sortBlockSize)) {
-        parameter.SetSortBlockSize(sortBlockSize);
+                             sortMemoryBudget)) {
+        parameter.SetSortMemoryBudget(sortMemoryBudget);
       }
       else {
         parameterError=true;
@@ -707,6 +830,19 @@ int main(int argc, char* argv[])
         parameterError=true;
       }
     }
+    else if (strcmp(argv[i],"--coordDataDense")==0) {
+      bool coordDataDense;
+
+      if (ParseBoolArgument(argc,
+                            argv,
+                            i,
+                            coordDataDense)) {
+        parameter.SetCoordDataDense(coordDataDense);
+      }
+      else {
+        parameterError=true;
+      }
+    }
     else if (strcmp(argv[i],"--coordIndexCacheSize")==0) {
       size_t coordIndexCacheSize;
 
@@ -798,6 +934,86 @@ int main(int argc, char* argv[])
         parameterError=true;
       }
     }
+    else if (strcmp(argv[i],"--routeNodeMemoryBudget")==0) {
+      size_t routeNodeMemoryBudget;
+
+      if (ParseSizeTArgument(argc,
+                             argv,
+                             i,
+                             routeNodeMemoryBudget)) {
+        parameter.SetRouteNodeMemoryBudget(routeNodeMemoryBudget);
+      }
+      else {
+        parameterError=true;
+      }
+    }
+    else if (strcmp(argv[i],"--routeCSR")==0) {
+      bool routeCompactGraph;
+
+      if (ParseBoolArgument(argc,
+                            argv,
+                            i,
+                            routeCompactGraph)) {
+        parameter.SetRouteCompactGraph(routeCompactGraph);
+      }
+      else {
+        parameterError=true;
+      }
+    }
+    else if (strcmp(argv[i],"--routeCH")==0) {
+      bool routeContractionHierarchy;
+
+      if (ParseBoolArgument(argc,
+                            argv,
+                            i,
+                            routeContractionHierarchy)) {
+        parameter.SetRouteContractionHierarchy(routeContractionHierarchy);
+      }
+      else {
+        parameterError=true;
+      }
+    }
+    else if (strcmp(argv[i],"--routeCHCarSpeeds")==0) {
+      std::map<std::string,double> speeds;
+
+      if (ParseSpeedTableArgument(argc,
+                                  argv,
+                                  i,
+                                  speeds)) {
+        parameter.SetRouteContractionHierarchyCarSpeeds(speeds,
+                                                        parameter.GetRouteContractionHierarchyCarMaxSpeed());
+      }
+      else {
+        parameterError=true;
+      }
+    }
+    else if (strcmp(argv[i],"--routeCHCarMaxSpeed")==0) {
+      double maxSpeed;
+
+      if (ParseDoubleArgument(argc,
+                              argv,
+                              i,
+                              maxSpeed)) {
+        parameter.SetRouteContractionHierarchyCarSpeeds(parameter.GetRouteContractionHierarchyCarSpeeds(),
+                                                        maxSpeed);
+      }
+      else {
+        parameterError=true;
+      }
+    }
+    else if (strcmp(argv[i],"--routeSegmentIndex")==0) {
+      bool routeSegmentIndex;
+
+      if (ParseBoolArgument(argc,
+                            argv,
+                            i,
+                            routeSegmentIndex)) {
+        parameter.SetRouteSegmentIndex(routeSegmentIndex);
+      }
+      else {
+        parameterError=true;
+      }
+    }
     else if (strcmp(argv[i],"--langOrder")==0) {
         std::vector<std::string> langOrder;
         
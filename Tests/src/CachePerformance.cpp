@@ -18,10 +18,16 @@
 */
 
 #include <cstdlib>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
 #include <vector>
 
 #include <osmscout/util/Cache.h>
+#include <osmscout/util/ConcurrentCache.h>
 #include <osmscout/util/FileScanner.h>
 #include <osmscout/util/StopClock.h>
 
@@ -30,6 +36,8 @@
   * cache insertion
   * cache hit
   * cache miss
+  * multi-threaded hit/miss workloads of a mutex protected Cache
+    compared to the ConcurrentCache
 */
 
 /**
@@ -66,6 +74,14 @@ static const size_t cacheSize=2000000;
 
 typedef osmscout::Cache<osmscout::Id,Data>     DataCache;
 
+typedef std::shared_ptr<Data>                                       DataRef;
+typedef osmscout::Cache<osmscout::Id,DataRef>                       SharedDataCache;
+typedef osmscout::ConcurrentCache<osmscout::Id,DataRef>             ConcurrentDataCache;
+
+static const size_t threadedCacheSize=100000;
+static const size_t threadedLookupCount=1000000;
+static const size_t threadedMaxThreadCount=32;
+
 void TestData()
 {
   std::cout << "*** Caching of struct ***" << std::endl;
@@ -170,9 +186,159 @@ void TestData()
   std::cout << "Copy time: "  << copyTimer << std::endl;
 }
 
+/**
+ * Size of a cache value in bytes, used for memory budgeting
+ */
+struct DataValueSizer : public ConcurrentDataCache::ValueSizer
+{
+  size_t GetSize(const DataRef& value) const
+  {
+    return sizeof(Data)+value->value2.size()*sizeof(size_t);
+  }
+};
+
+/**
+ * Mimics the current usage pattern of Cache in the database: one cache
+ * protected by an outer mutex
+ */
+class LockedCache
+{
+private:
+  std::mutex      mutex;
+  SharedDataCache cache;
+
+public:
+  LockedCache(size_t size)
+  : cache(size)
+  {
+    // no code
+  }
+
+  bool GetEntry(osmscout::Id key,
+                DataRef& value)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    SharedDataCache::CacheRef   ref;
+
+    if (cache.GetEntry(key,ref)) {
+      value=ref->value;
+      return true;
+    }
+
+    return false;
+  }
+
+  void SetEntry(osmscout::Id key,
+                const DataRef& value)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    cache.SetEntry(SharedDataCache::CacheEntry(key,value));
+  }
+};
+
+/**
+ * Lookup random keys out of keyRange in the cache, inserting the value on
+ * a miss. With keyRange==threadedCacheSize (nearly) all lookups are hits,
+ * with a larger key range the given share of lookups misses.
+ */
+template<class C>
+void AccessCache(C& cache,
+                 size_t keyRange,
+                 size_t seed,
+                 size_t& hits)
+{
+  std::mt19937                          generator((unsigned int)seed);
+  std::uniform_int_distribution<size_t> distribution(0,keyRange-1);
+
+  hits=0;
+
+  for (size_t i=0; i<threadedLookupCount; i++) {
+    osmscout::Id key=distribution(generator);
+    DataRef      value;
+
+    if (cache.GetEntry(key,value)) {
+      hits++;
+    }
+    else {
+      value=std::make_shared<Data>();
+      value->value=key;
+
+      cache.SetEntry(key,value);
+    }
+  }
+}
+
+template<class C>
+double RunThreaded(C& cache,
+                   size_t threadCount,
+                   size_t keyRange,
+                   double& hitRate)
+{
+  std::vector<std::thread> threads(threadCount);
+  std::vector<size_t>      hits(threadCount);
+  size_t                   overallHits=0;
+
+  osmscout::StopClock timer;
+
+  for (size_t i=0; i<threads.size(); i++) {
+    threads[i]=std::thread(AccessCache<C>,
+                           std::ref(cache),
+                           keyRange,
+                           i,
+                           std::ref(hits[i]));
+  }
+
+  for (size_t i=0; i<threads.size(); i++) {
+    threads[i].join();
+    overallHits+=hits[i];
+  }
+
+  timer.Stop();
+
+  hitRate=100.0*overallHits/(threadCount*threadedLookupCount);
+
+  return threadCount*threadedLookupCount/(timer.GetMilliseconds()/1000.0);
+}
+
+void TestThreaded(const std::string& workload,
+                  size_t keyRange)
+{
+  DataValueSizer sizer;
+
+  std::cout << "*** Multi-threaded " << workload << " workload ***" << std::endl;
+  std::cout << "Threads  locked lookups/s  concurrent lookups/s  concurrent(bytes) lookups/s  hit rate" << std::endl;
+
+  for (size_t threadCount=1; threadCount<=threadedMaxThreadCount; threadCount*=2) {
+    LockedCache         lockedCache(threadedCacheSize);
+    ConcurrentDataCache concurrentCache(threadedCacheSize);
+    ConcurrentDataCache byteBudgetCache(threadedCacheSize*sizer.GetSize(std::make_shared<Data>()),
+                                        &sizer);
+    double              hitRate;
+
+    // Warm up
+    RunThreaded(lockedCache,1,threadedCacheSize,hitRate);
+    RunThreaded(concurrentCache,1,threadedCacheSize,hitRate);
+    RunThreaded(byteBudgetCache,1,threadedCacheSize,hitRate);
+
+    double lockedThroughput=RunThreaded(lockedCache,threadCount,keyRange,hitRate);
+    double concurrentThroughput=RunThreaded(concurrentCache,threadCount,keyRange,hitRate);
+    double byteBudgetThroughput=RunThreaded(byteBudgetCache,threadCount,keyRange,hitRate);
+
+    std::cout << std::setfill(' ') << std::setw(7) << threadCount << " ";
+    std::cout << std::setw(18) << std::fixed << std::setprecision(0) << lockedThroughput << " ";
+    std::cout << std::setw(21) << concurrentThroughput << " ";
+    std::cout << std::setw(28) << byteBudgetThroughput << " ";
+    std::cout << std::setw(8) << std::setprecision(1) << hitRate << "%" << std::endl;
+  }
+}
+
 int main(int /*argc*/, char* /*argv*/[])
 {
   TestData();
 
+  TestThreaded("hit",threadedCacheSize);
+  TestThreaded("miss",10*threadedCacheSize);
+
   return 0;
 }
@@ -0,0 +1,156 @@
+/*
+  GridOutline - a test program for libosmscout
+  Copyright (C) 2016  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <osmscout/GeoCoord.h>
+
+#include <osmscout/util/Geometry.h>
+
+typedef std::vector<std::pair<osmscout::GeoCoord,osmscout::GeoCoord>> Segments;
+
+static int CheckOutline(const std::string& name,
+                        const std::vector<osmscout::GeoCoord>& outline,
+                        const std::vector<osmscout::GeoCoord>& inside,
+                        const std::vector<osmscout::GeoCoord>& outside)
+{
+  int    errors=0;
+  double area=0.0;
+
+  for (size_t i=0; i<outline.size(); i++) {
+    const osmscout::GeoCoord& a=outline[i];
+    const osmscout::GeoCoord& b=outline[(i+1)%outline.size()];
+
+    if (a.GetLat()==b.GetLat() &&
+        a.GetLon()==b.GetLon()) {
+      std::cerr << name << ": Outline contains duplicate point " << a.GetDisplayText() << std::endl;
+      errors++;
+    }
+
+    area+=a.GetLon()*b.GetLat()-b.GetLon()*a.GetLat();
+  }
+
+  if (area<=0.0) {
+    std::cerr << name << ": Outline is not counter-clockwise" << std::endl;
+    errors++;
+  }
+
+  for (const auto& coord : inside) {
+    if (!osmscout::IsCoordInArea(coord,outline)) {
+      std::cerr << name << ": " << coord.GetDisplayText() << " should be inside the outline" << std::endl;
+      errors++;
+    }
+  }
+
+  for (const auto& coord : outside) {
+    if (osmscout::IsCoordInArea(coord,outline)) {
+      std::cerr << name << ": " << coord.GetDisplayText() << " should be outside the outline" << std::endl;
+      errors++;
+    }
+  }
+
+  std::cout << name << ": " << outline.size() << " points, " << (errors==0 ? "OK" : "FAILED") << std::endl;
+
+  return errors;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+  int                             errors=0;
+  std::vector<osmscout::GeoCoord> outline;
+
+  // A "U" shaped network: the concave gap between both arms is not reachable
+  Segments u;
+
+  u.push_back(std::make_pair(osmscout::GeoCoord(10.0,0.0),osmscout::GeoCoord(0.0,0.0)));
+  u.push_back(std::make_pair(osmscout::GeoCoord(0.0,0.0),osmscout::GeoCoord(0.0,10.0)));
+  u.push_back(std::make_pair(osmscout::GeoCoord(0.0,10.0),osmscout::GeoCoord(10.0,10.0)));
+
+  osmscout::GetGridOutline(u,1.0,1.0,outline);
+
+  errors+=CheckOutline("U",
+                       outline,
+                       {osmscout::GeoCoord(9.5,0.5),
+                        osmscout::GeoCoord(0.5,5.5),
+                        osmscout::GeoCoord(9.5,10.5)},
+                       {osmscout::GeoCoord(8.5,5.5),
+                        osmscout::GeoCoord(5.5,3.5),
+                        osmscout::GeoCoord(-1.5,5.5)});
+
+  // Nevertheless the outline covers the whole network
+  for (const auto& segment : u) {
+    osmscout::GeoCoord middle((segment.first.GetLat()+segment.second.GetLat())/2,
+                              (segment.first.GetLon()+segment.second.GetLon())/2);
+
+    for (const auto& coord : {segment.first,middle,segment.second}) {
+      if (!osmscout::IsCoordInArea(coord,outline)) {
+        std::cerr << "U: " << coord.GetDisplayText() << " of the network should be inside the outline" << std::endl;
+        errors++;
+      }
+    }
+  }
+
+  // A closed ring: the enclosed hole is filled
+  Segments ring;
+
+  ring.push_back(std::make_pair(osmscout::GeoCoord(0.0,0.0),osmscout::GeoCoord(0.0,10.0)));
+  ring.push_back(std::make_pair(osmscout::GeoCoord(0.0,10.0),osmscout::GeoCoord(10.0,10.0)));
+  ring.push_back(std::make_pair(osmscout::GeoCoord(10.0,10.0),osmscout::GeoCoord(10.0,0.0)));
+  ring.push_back(std::make_pair(osmscout::GeoCoord(10.0,0.0),osmscout::GeoCoord(0.0,0.0)));
+
+  osmscout::GetGridOutline(ring,1.0,1.0,outline);
+
+  errors+=CheckOutline("Ring",
+                       outline,
+                       {osmscout::GeoCoord(5.5,5.5)},
+                       {osmscout::GeoCoord(11.5,5.5)});
+
+  if (outline.size()!=4) {
+    std::cerr << "Ring: Outline should be a rectangle" << std::endl;
+    errors++;
+  }
+
+  // Diagonal lines result in cells touching only at their corners, which
+  // must still result in a single outline
+  Segments diagonal;
+
+  diagonal.push_back(std::make_pair(osmscout::GeoCoord(0.0,0.0),osmscout::GeoCoord(7.0,7.0)));
+  diagonal.push_back(std::make_pair(osmscout::GeoCoord(7.0,7.0),osmscout::GeoCoord(0.0,14.0)));
+
+  osmscout::GetGridOutline(diagonal,1.0,1.0,outline);
+
+  errors+=CheckOutline("Diagonal",
+                       outline,
+                       {osmscout::GeoCoord(0.5,0.5),
+                        osmscout::GeoCoord(7.5,7.5),
+                        osmscout::GeoCoord(0.5,14.5)},
+                       {osmscout::GeoCoord(0.5,7.5)});
+
+  if (errors>0) {
+    std::cerr << errors << " error(s)" << std::endl;
+    return 1;
+  }
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,191 @@
+/*
+  PersistentTileCache - a test program for libosmscout
+  Copyright (C) 2016  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include <osmscout/PersistentTileCache.h>
+
+#include <osmscout/util/File.h>
+
+static const char*    filename="PersistentTileCache.dat";
+static const uint64_t styleHash=42;
+static const size_t   tileSize=1000;
+
+static osmscout::TileId GetTileId(size_t i)
+{
+  osmscout::Magnification magnification;
+
+  magnification.SetLevel(15);
+
+  return osmscout::TileId(magnification,17000+i,11000);
+}
+
+static std::string GetTileData(size_t i)
+{
+  return std::string(tileSize,(char)('a'+i%26));
+}
+
+/**
+ * Check, that the tiles in the given range (and only these) are cached
+ */
+static int CheckTiles(osmscout::PersistentTileCache& cache,
+                      size_t start,
+                      size_t end,
+                      const std::string& context)
+{
+  int errors=0;
+
+  for (size_t i=0; i<20; i++) {
+    std::string data;
+    bool        expected=i>=start && i<=end;
+
+    if (cache.HasTile(GetTileId(i),styleHash)!=expected) {
+      std::cerr << context << ": Tile " << i << (expected ? " is missing" : " was not evicted") << std::endl;
+      errors++;
+    }
+    else if (expected &&
+             (!cache.GetTile(GetTileId(i),styleHash,data) ||
+              data!=GetTileData(i))) {
+      std::cerr << context << ": Tile " << i << " has wrong data" << std::endl;
+      errors++;
+    }
+  }
+
+  return errors;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+  int errors=0;
+
+  if (osmscout::ExistsInFilesystem(filename)) {
+    osmscout::RemoveFile(filename);
+  }
+
+  {
+    osmscout::PersistentTileCache cache(5*tileSize);
+
+    if (!cache.Open(filename)) {
+      std::cerr << "Cannot create cache" << std::endl;
+      return 1;
+    }
+
+    for (size_t i=0; i<10; i++) {
+      if (!cache.PutTile(GetTileId(i),styleHash,GetTileData(i))) {
+        std::cerr << "Cannot store tile " << i << std::endl;
+        errors++;
+      }
+    }
+
+    // Tiles 0-4 are evicted
+    errors+=CheckTiles(cache,5,9,"Eviction");
+
+    if (cache.HasTile(GetTileId(5),styleHash+1)) {
+      std::cerr << "Tile with different style hash found" << std::endl;
+      errors++;
+    }
+
+    cache.Close();
+  }
+
+  {
+    osmscout::PersistentTileCache cache(5*tileSize);
+
+    if (!cache.Open(filename)) {
+      std::cerr << "Cannot reopen cache" << std::endl;
+      return 1;
+    }
+
+    errors+=CheckTiles(cache,5,9,"Reopen");
+
+    // Access tile 5, so that tile 6 is the least recently used tile
+    std::string data;
+
+    cache.GetTile(GetTileId(5),styleHash,data);
+    cache.PutTile(GetTileId(10),styleHash,GetTileData(10));
+
+    if (!cache.HasTile(GetTileId(5),styleHash) ||
+        cache.HasTile(GetTileId(6),styleHash)) {
+      std::cerr << "Least recently used tile was not evicted" << std::endl;
+      errors++;
+    }
+
+    osmscout::FileOffset fileSize=cache.GetFileSize();
+
+    if (!cache.Compact() ||
+        cache.GetFileSize()>=fileSize ||
+        cache.GetTileCount()!=5) {
+      std::cerr << "Compacting failed" << std::endl;
+      errors++;
+    }
+
+    cache.RemoveTile(GetTileId(5),styleHash);
+    errors+=CheckTiles(cache,7,10,"Compact");
+
+    cache.Close();
+  }
+
+  // Simulate a crash while writing a tile
+  FILE* file=fopen(filename,"ab");
+
+  if (file!=NULL) {
+    fwrite("TILE garbage",1,12,file);
+    fclose(file);
+  }
+
+  {
+    osmscout::PersistentTileCache cache(5*tileSize);
+
+    if (!cache.Open(filename)) {
+      std::cerr << "Cannot open damaged cache" << std::endl;
+      return 1;
+    }
+
+    errors+=CheckTiles(cache,7,10,"Damaged");
+
+    cache.PutTile(GetTileId(11),styleHash,GetTileData(11));
+    cache.Close();
+  }
+
+  {
+    osmscout::PersistentTileCache cache(5*tileSize);
+
+    if (!cache.Open(filename)) {
+      std::cerr << "Cannot open repaired cache" << std::endl;
+      return 1;
+    }
+
+    errors+=CheckTiles(cache,7,11,"Repaired");
+
+    cache.Close();
+  }
+
+  osmscout::RemoveFile(filename);
+
+  if (errors>0) {
+    std::cerr << errors << " error(s)" << std::endl;
+    return 1;
+  }
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
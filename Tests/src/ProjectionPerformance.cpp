@@ -0,0 +1,215 @@
+/*
+  ProjectionPerformance - a test program for libosmscout
+  Copyright (C) 2016  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <osmscout/Point.h>
+
+#include <osmscout/util/Projection.h>
+#include <osmscout/util/StopClock.h>
+
+/**
+  Transform a number of random points within (and around) the visible area
+  of a projection by calling GeoToPixel() for each point and by the different
+  implementations of the Projection::ArrayTransformer. Checks that the results
+  are equal and prints the throughput of each variant.
+*/
+
+#define POINT_COUNT 1000000
+#define ITERATIONS  10
+
+static const double maxError=0.001;
+
+static void GeneratePoints(const osmscout::Projection& projection,
+                           std::vector<osmscout::Point>& points)
+{
+  double width=(double)projection.GetWidth();
+  double height=(double)projection.GetHeight();
+
+  srand(42);
+
+  points.resize(POINT_COUNT);
+
+  for (size_t i=0; i<points.size(); i++) {
+    // Also cover points outside the visible area
+    double x=-width+3*width*rand()/(RAND_MAX+1.0);
+    double y=-height+3*height*rand()/(RAND_MAX+1.0);
+    double lon;
+    double lat;
+
+    projection.PixelToGeo(x,y,lon,lat);
+
+    points[i].Set(0,osmscout::GeoCoord(lat,lon));
+  }
+}
+
+static std::string GetImplementationName(osmscout::Projection::ArrayTransformer::Implementation implementation)
+{
+  switch (implementation) {
+  case osmscout::Projection::ArrayTransformer::implementationScalar:
+    return "Scalar";
+  case osmscout::Projection::ArrayTransformer::implementationSSE2:
+    return "SSE2";
+  case osmscout::Projection::ArrayTransformer::implementationAVX2:
+    return "AVX2";
+  }
+
+  return "???";
+}
+
+static void PrintResult(const std::string& name,
+                        const osmscout::StopClock& stopClock)
+{
+  double pointsPerSecond=POINT_COUNT*ITERATIONS/(stopClock.GetMilliseconds()/1000.0);
+
+  std::cout << "  " << std::setw(10) << std::left << name << ": ";
+  std::cout << stopClock.ResultString() << " s, ";
+  std::cout << std::fixed << std::setprecision(1) << pointsPerSecond/1000000.0 << " Mpoints/s" << std::endl;
+}
+
+static int TestProjection(const std::string& name,
+                          const osmscout::Projection& projection)
+{
+  std::vector<osmscout::Point> points;
+  std::vector<double>          refX(POINT_COUNT);
+  std::vector<double>          refY(POINT_COUNT);
+  std::vector<double>          x(POINT_COUNT);
+  std::vector<double>          y(POINT_COUNT);
+  int                          errors=0;
+
+  GeneratePoints(projection,
+                 points);
+
+  std::cout << name << ":" << std::endl;
+
+  osmscout::StopClock geoToPixelTimer;
+
+  for (size_t iteration=0; iteration<ITERATIONS; iteration++) {
+    for (size_t i=0; i<points.size(); i++) {
+      projection.GeoToPixel(points[i].GetCoord(),
+                            refX[i],
+                            refY[i]);
+    }
+  }
+
+  geoToPixelTimer.Stop();
+
+  PrintResult("GeoToPixel",
+              geoToPixelTimer);
+
+  osmscout::Projection::ArrayTransformer transformer(projection);
+
+  for (size_t implementation=osmscout::Projection::ArrayTransformer::implementationScalar;
+       implementation<=osmscout::Projection::ArrayTransformer::GetBestImplementation();
+       implementation++) {
+    transformer.SetImplementation((osmscout::Projection::ArrayTransformer::Implementation)implementation);
+
+    osmscout::StopClock transformerTimer;
+
+    for (size_t iteration=0; iteration<ITERATIONS; iteration++) {
+      transformer.GeoToPixel(points.data(),
+                             points.size(),
+                             x.data(),
+                             y.data());
+    }
+
+    transformerTimer.Stop();
+
+    PrintResult(GetImplementationName(transformer.GetImplementation()),
+                transformerTimer);
+
+    double error=0.0;
+
+    for (size_t i=0; i<points.size(); i++) {
+      error=std::max(error,std::fabs(x[i]-refX[i]));
+      error=std::max(error,std::fabs(y[i]-refY[i]));
+    }
+
+    if (error>maxError) {
+      std::cerr << "  Maximum error of " << error << " pixel exceeds " << maxError << " pixel!" << std::endl;
+      errors++;
+    }
+  }
+
+  return errors;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+  osmscout::Magnification magnification;
+  int                     errors=0;
+
+  magnification.SetLevel(14);
+
+  osmscout::MercatorProjection mercator;
+
+  mercator.Set(osmscout::GeoCoord(50.094,8.49),
+               magnification,
+               96.0,
+               1024,768);
+
+  errors+=TestProjection("Mercator",
+                         mercator);
+
+  osmscout::MercatorProjection rotatedMercator;
+
+  rotatedMercator.Set(osmscout::GeoCoord(50.094,8.49),
+                      M_PI/6,
+                      magnification,
+                      96.0,
+                      1024,768);
+
+  errors+=TestProjection("Mercator (rotated)",
+                         rotatedMercator);
+
+  osmscout::MercatorProjection linearMercator;
+
+  linearMercator.Set(osmscout::GeoCoord(50.094,8.49),
+                     magnification,
+                     96.0,
+                     1024,768);
+  linearMercator.SetLinearInterpolationUsage(true);
+
+  errors+=TestProjection("Mercator (linear)",
+                         linearMercator);
+
+  osmscout::TileProjection tile;
+
+  tile.Set(8578,5546,
+           magnification,
+           96.0,
+           256,256);
+
+  errors+=TestProjection("Tile",
+                         tile);
+
+  if (errors>0) {
+    std::cerr << errors << " error(s)" << std::endl;
+    return 1;
+  }
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,238 @@
+/*
+  RoutableSegmentIndex - a test program for libosmscout
+  Copyright (C) 2016  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <osmscout/Database.h>
+#include <osmscout/RoutableSegmentIndex.h>
+#include <osmscout/RoutingService.h>
+
+#include <osmscout/util/File.h>
+
+/**
+  Searches the closest routable node for random locations using the routable
+  segment index generated by the importer (option "--routeSegmentIndex true")
+  and by loading ways and areas, and checks that both result in nodes with
+  the same distance. For each location the segments returned by the index
+  are checked to be consecutive nodes of the same object.
+*/
+
+static const size_t LOOKUP_COUNT=1000;
+static const double SEARCH_RADIUS=1000.0;
+
+static bool GetNodeCoord(const osmscout::DatabaseRef& database,
+                         const osmscout::ObjectFileRef& object,
+                         size_t nodeIndex,
+                         osmscout::GeoCoord& coord)
+{
+  if (object.GetType()==osmscout::refWay) {
+    osmscout::WayRef way;
+
+    if (!database->GetWayByOffset(object.GetFileOffset(),
+                                  way) ||
+        nodeIndex>=way->nodes.size()) {
+      return false;
+    }
+
+    coord=way->nodes[nodeIndex].GetCoord();
+
+    return true;
+  }
+
+  if (object.GetType()==osmscout::refArea) {
+    osmscout::AreaRef area;
+
+    if (!database->GetAreaByOffset(object.GetFileOffset(),
+                                   area) ||
+        area->rings.empty() ||
+        nodeIndex>=area->rings[0].nodes.size()) {
+      return false;
+    }
+
+    coord=area->rings[0].nodes[nodeIndex].GetCoord();
+
+    return true;
+  }
+
+  return false;
+}
+
+static double GetDistance(const osmscout::GeoCoord& a,
+                          const osmscout::GeoCoord& b)
+{
+  return sqrt((a.GetLat()-b.GetLat())*(a.GetLat()-b.GetLat())+
+              (a.GetLon()-b.GetLon())*(a.GetLon()-b.GetLon()));
+}
+
+static size_t CheckSegments(const osmscout::RoutableSegmentIndex& index,
+                            const osmscout::GeoCoord& coord,
+                            osmscout::Vehicle vehicle)
+{
+  std::vector<osmscout::RoutableSegmentIndex::Segment> segments;
+  size_t                                              errors=0;
+
+  if (!index.GetSegments(osmscout::GeoBox::BoxByCenterAndRadius(coord,SEARCH_RADIUS),
+                         vehicle,
+                         segments)) {
+    std::cerr << coord.GetDisplayText() << ": Cannot get segments" << std::endl;
+    return 1;
+  }
+
+  for (const auto& segment : segments) {
+    if (segment.from->type!=segment.to->type ||
+        segment.from->offset!=segment.to->offset ||
+        segment.from->nodeIndex+1!=segment.to->nodeIndex ||
+        (segment.from->vehicles & vehicle)==0) {
+      std::cerr << coord.GetDisplayText() << ": Invalid segment of object " << segment.from->offset;
+      std::cerr << " from node " << segment.from->nodeIndex << " to node " << segment.to->nodeIndex << std::endl;
+      errors++;
+    }
+  }
+
+  return errors;
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc!=2) {
+    std::cerr << "RoutableSegmentIndex <database directory>" << std::endl;
+
+    return 1;
+  }
+
+  osmscout::DatabaseParameter databaseParameter;
+  osmscout::DatabaseRef       database=std::make_shared<osmscout::Database>(databaseParameter);
+
+  if (!database->Open(argv[1])) {
+    std::cerr << "Cannot open database" << std::endl;
+
+    return 1;
+  }
+
+  osmscout::RoutableSegmentIndex index;
+
+  if (!index.Load(osmscout::AppendFileToDir(argv[1],
+                                            osmscout::RoutableSegmentIndex::ROUTABLE_SEGMENT_IDX))) {
+    std::cerr << "Cannot load routable segment index" << std::endl;
+
+    return 1;
+  }
+
+  std::cout << "Index has " << index.GetCellCount() << " cell(s) and " << index.GetEntryCount() << " entries" << std::endl;
+
+  osmscout::RouterParameter routerParameter;
+
+  routerParameter.SetUseRoutableSegmentIndex(false);
+
+  osmscout::RoutingService router(database,
+                                  routerParameter,
+                                  osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+
+  if (!router.Open()) {
+    std::cerr << "Cannot open routing database" << std::endl;
+
+    return 1;
+  }
+
+  osmscout::GeoBox boundingBox;
+  size_t           lookupCount=0;
+  size_t           errors=0;
+
+  database->GetBoundingBox(boundingBox);
+
+  std::srand(42);
+
+  for (size_t i=0; i<LOOKUP_COUNT; i++) {
+    osmscout::GeoCoord coord(boundingBox.GetMinLat()+boundingBox.GetHeight()*std::rand()/RAND_MAX,
+                             boundingBox.GetMinLon()+boundingBox.GetWidth()*std::rand()/RAND_MAX);
+
+    for (const auto vehicle : {osmscout::vehicleFoot,osmscout::vehicleBicycle,osmscout::vehicleCar}) {
+      osmscout::ObjectFileRef indexObject;
+      size_t                  indexNodeIndex;
+      osmscout::ObjectFileRef object;
+      size_t                  nodeIndex;
+
+      if (!index.GetClosestNode(coord,
+                                vehicle,
+                                SEARCH_RADIUS,
+                                indexObject,
+                                indexNodeIndex) ||
+          !router.GetClosestRoutableNode(coord.GetLat(),
+                                         coord.GetLon(),
+                                         vehicle,
+                                         SEARCH_RADIUS,
+                                         object,
+                                         nodeIndex)) {
+        std::cerr << "Error while searching for routable nodes" << std::endl;
+        return 1;
+      }
+
+      errors+=CheckSegments(index,
+                            coord,
+                            vehicle);
+
+      if (!object.Valid()) {
+        continue;
+      }
+
+      lookupCount++;
+
+      osmscout::GeoCoord indexNode;
+      osmscout::GeoCoord node;
+
+      if (!indexObject.Valid() ||
+          !GetNodeCoord(database,
+                        indexObject,
+                        indexNodeIndex,
+                        indexNode) ||
+          !GetNodeCoord(database,
+                        object,
+                        nodeIndex,
+                        node)) {
+        std::cerr << coord.GetDisplayText() << ": Index returns no valid node, expected node " << nodeIndex << " of " << object.GetName() << std::endl;
+        errors++;
+        continue;
+      }
+
+      if (std::fabs(GetDistance(coord,indexNode)-GetDistance(coord,node))>1e-9) {
+        std::cerr << coord.GetDisplayText() << ": Index returns node " << indexNodeIndex << " of " << indexObject.GetName();
+        std::cerr << ", expected node " << nodeIndex << " of " << object.GetName() << std::endl;
+        errors++;
+      }
+    }
+  }
+
+  router.Close();
+  index.Close();
+  database->Close();
+
+  std::cout << "Lookups: " << lookupCount << " errors: " << errors << std::endl;
+
+  if (errors>0) {
+    std::cout << "Test result: FAILED" << std::endl;
+    return 1;
+  }
+
+  std::cout << "Test result: OK" << std::endl;
+
+  return 0;
+}
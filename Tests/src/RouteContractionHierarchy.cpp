@@ -0,0 +1,359 @@
+/*
+  RouteContractionHierarchy - a test program for libosmscout
+  Copyright (C) 2016  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <map>
+
+#include <osmscout/Database.h>
+#include <osmscout/RoutingService.h>
+
+#include <osmscout/util/File.h>
+#include <osmscout/util/Geometry.h>
+#include <osmscout/util/StopClock.h>
+#include <osmscout/util/String.h>
+
+/**
+  Calculates routes between random locations with the A* router and using the
+  contraction hierarchy generated by the importer (option "--routeCH true")
+  and checks that both result in routes of the same length.
+
+  If the car contraction hierarchy was generated for the fastest route
+  (option "--routeCHCarSpeeds"), the same speed table and maximum speed
+  must be passed.
+*/
+
+static const size_t ROUTE_COUNT=100;
+static const double SEARCH_RADIUS=1000.0;
+
+static double GetRouteLength(osmscout::RoutingService& router,
+                             const osmscout::RouteData& data)
+{
+  std::list<osmscout::Point> points;
+  double                     length=0.0;
+
+  router.TransformRouteDataToPoints(data,
+                                    points);
+
+  for (auto current=points.begin(); current!=points.end(); ++current) {
+    auto next=current;
+
+    ++next;
+
+    if (next==points.end()) {
+      break;
+    }
+
+    length+=osmscout::GetSphericalDistance(current->GetCoord(),
+                                           next->GetCoord());
+  }
+
+  return length;
+}
+
+static bool TestVehicle(const osmscout::DatabaseRef& database,
+                        osmscout::RoutingService& aStarRouter,
+                        osmscout::RoutingService& hierarchyRouter,
+                        const osmscout::RoutingProfile& profile,
+                        const std::string& name)
+{
+  osmscout::GeoBox boundingBox;
+  size_t           routeCount=0;
+  size_t           errorCount=0;
+  double           aStarTime=0.0;
+  double           hierarchyTime=0.0;
+
+  // Make sure, that we actually test the contraction hierarchy and not A* against A*
+  if (!hierarchyRouter.HasContractionHierarchy(profile)) {
+    std::cerr << name << ": Contraction hierarchy does not match the routing profile and is not used" << std::endl;
+    return false;
+  }
+
+  if (aStarRouter.HasContractionHierarchy(profile)) {
+    std::cerr << name << ": A* router uses the contraction hierarchy" << std::endl;
+    return false;
+  }
+
+  database->GetBoundingBox(boundingBox);
+
+  std::srand(42);
+
+  for (size_t i=0; i<ROUTE_COUNT; i++) {
+    osmscout::GeoCoord      start(boundingBox.GetMinLat()+boundingBox.GetHeight()*std::rand()/RAND_MAX,
+                                  boundingBox.GetMinLon()+boundingBox.GetWidth()*std::rand()/RAND_MAX);
+    osmscout::GeoCoord      target(boundingBox.GetMinLat()+boundingBox.GetHeight()*std::rand()/RAND_MAX,
+                                   boundingBox.GetMinLon()+boundingBox.GetWidth()*std::rand()/RAND_MAX);
+    osmscout::ObjectFileRef startObject;
+    size_t                  startNodeIndex;
+    osmscout::ObjectFileRef targetObject;
+    size_t                  targetNodeIndex;
+
+    if (!aStarRouter.GetClosestRoutableNode(start.GetLat(),
+                                            start.GetLon(),
+                                            profile.GetVehicle(),
+                                            SEARCH_RADIUS,
+                                            startObject,
+                                            startNodeIndex) ||
+        !aStarRouter.GetClosestRoutableNode(target.GetLat(),
+                                            target.GetLon(),
+                                            profile.GetVehicle(),
+                                            SEARCH_RADIUS,
+                                            targetObject,
+                                            targetNodeIndex)) {
+      std::cerr << "Error while searching for routable nodes" << std::endl;
+      return false;
+    }
+
+    if (!startObject.Valid() ||
+        !targetObject.Valid()) {
+      continue;
+    }
+
+    osmscout::RouteData aStarRoute;
+    osmscout::RouteData hierarchyRoute;
+    osmscout::StopClock aStarClock;
+
+    if (!aStarRouter.CalculateRoute(profile,
+                                    startObject,
+                                    startNodeIndex,
+                                    targetObject,
+                                    targetNodeIndex,
+                                    aStarRoute)) {
+      std::cerr << "Error while calculating route using A*" << std::endl;
+      return false;
+    }
+
+    aStarClock.Stop();
+
+    osmscout::StopClock hierarchyClock;
+
+    if (!hierarchyRouter.CalculateRoute(profile,
+                                        startObject,
+                                        startNodeIndex,
+                                        targetObject,
+                                        targetNodeIndex,
+                                        hierarchyRoute)) {
+      std::cerr << "Error while calculating route using contraction hierarchy" << std::endl;
+      return false;
+    }
+
+    hierarchyClock.Stop();
+
+    aStarTime+=aStarClock.GetMilliseconds();
+    hierarchyTime+=hierarchyClock.GetMilliseconds();
+
+    double aStarLength=GetRouteLength(aStarRouter,aStarRoute);
+    double hierarchyLength=GetRouteLength(hierarchyRouter,hierarchyRoute);
+
+    routeCount++;
+
+    if (aStarRoute.IsEmpty()!=hierarchyRoute.IsEmpty() ||
+        std::fabs(aStarLength-hierarchyLength)>0.001) {
+      std::cerr << name << ": " << start.GetDisplayText() << " => " << target.GetDisplayText() << ": ";
+      std::cerr << "A* " << aStarLength << "km, contraction hierarchy " << hierarchyLength << "km" << std::endl;
+      errorCount++;
+    }
+  }
+
+  std::cout << std::setw(8) << std::left << name << std::right;
+  std::cout << " routes: " << std::setw(4) << routeCount;
+  std::cout << " errors: " << std::setw(4) << errorCount;
+  std::cout << " A*: " << std::fixed << std::setprecision(1) << std::setw(8) << aStarTime << "ms";
+  std::cout << " CH: " << std::fixed << std::setprecision(1) << std::setw(8) << hierarchyTime << "ms" << std::endl;
+
+  return errorCount==0;
+}
+
+/**
+ * Parse a speed table of the form "<type>=<km/h>[,<type>=<km/h>]..."
+ */
+static bool ParseSpeedTable(const std::string& argument,
+                            std::map<std::string,double>& speeds)
+{
+  size_t start=0;
+
+  while (start<argument.length()) {
+    size_t devider=argument.find(',',start);
+
+    if (devider==std::string::npos) {
+      devider=argument.length();
+    }
+
+    std::string entry=argument.substr(start,devider-start);
+    size_t      pos=entry.find('=');
+    double      speed;
+
+    if (pos==std::string::npos ||
+        !osmscout::StringToNumber(entry.substr(pos+1),
+                                  speed)) {
+      return false;
+    }
+
+    speeds[entry.substr(0,pos)]=speed;
+
+    start=devider+1;
+  }
+
+  return !speeds.empty();
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc<2 || argc>5) {
+    std::cerr << "RouteContractionHierarchy <database directory> [<router filename base> [<car speed table> [<car max speed>]]]" << std::endl;
+    std::cerr << "  car speed table: <type>=<km/h>[,<type>=<km/h>]..., as passed to the importer" << std::endl;
+
+    return 1;
+  }
+
+  std::string                  routerFilenamebase=osmscout::RoutingService::DEFAULT_FILENAME_BASE;
+  std::map<std::string,double> carSpeedTable;
+  double                       carMaxSpeed=160.0;
+
+  if (argc>=3) {
+    routerFilenamebase=argv[2];
+  }
+
+  if (argc>=4 &&
+      !ParseSpeedTable(argv[3],
+                       carSpeedTable)) {
+    std::cerr << "Cannot parse car speed table '" << argv[3] << "'" << std::endl;
+
+    return 1;
+  }
+
+  if (argc>=5 &&
+      !osmscout::StringToNumber(argv[4],
+                                carMaxSpeed)) {
+    std::cerr << "Cannot parse car max speed '" << argv[4] << "'" << std::endl;
+
+    return 1;
+  }
+
+  osmscout::DatabaseParameter databaseParameter;
+  osmscout::DatabaseRef       database=std::make_shared<osmscout::Database>(databaseParameter);
+
+  if (!database->Open(argv[1])) {
+    std::cerr << "Cannot open database" << std::endl;
+
+    return 1;
+  }
+
+  osmscout::RouterParameter aStarParameter;
+  osmscout::RouterParameter hierarchyParameter;
+
+  aStarParameter.SetUseContractionHierarchy(false);
+
+  osmscout::RoutingService aStarRouter(database,
+                                       aStarParameter,
+                                       routerFilenamebase);
+  osmscout::RoutingService hierarchyRouter(database,
+                                           hierarchyParameter,
+                                           routerFilenamebase);
+
+  if (!aStarRouter.Open() ||
+      !hierarchyRouter.Open()) {
+    std::cerr << "Cannot open routing database" << std::endl;
+
+    return 1;
+  }
+
+  osmscout::TypeConfigRef                  typeConfig=database->GetTypeConfig();
+  osmscout::FastestPathRoutingProfile      footProfile(typeConfig);
+  osmscout::FastestPathRoutingProfile      bicycleProfile(typeConfig);
+  osmscout::RoutingProfileRef              carProfile;
+
+  footProfile.ParametrizeForFoot(*typeConfig,
+                                 5.0);
+  bicycleProfile.ParametrizeForBicycle(*typeConfig,
+                                       20.0);
+
+  if (carSpeedTable.empty()) {
+    // Contraction hierarchy for the shortest route
+    osmscout::ShortestPathRoutingProfileRef profile=std::make_shared<osmscout::ShortestPathRoutingProfile>(typeConfig);
+
+    for (const auto &type : typeConfig->GetTypes()) {
+      if (!type->GetIgnore() &&
+          type->CanRouteCar()) {
+        carSpeedTable[type->GetName()]=carMaxSpeed;
+      }
+    }
+
+    profile->ParametrizeForCar(*typeConfig,
+                               carSpeedTable,
+                               carMaxSpeed);
+
+    carProfile=profile;
+  }
+  else {
+    // Contraction hierarchy for the fastest route
+    osmscout::FastestPathRoutingProfileRef profile=std::make_shared<osmscout::FastestPathRoutingProfile>(typeConfig);
+
+    if (!profile->ParametrizeForCar(*typeConfig,
+                                    carSpeedTable,
+                                    carMaxSpeed)) {
+      std::cerr << "Car speed table is incomplete" << std::endl;
+
+      return 1;
+    }
+
+    carProfile=profile;
+  }
+
+  bool result=true;
+
+  for (const auto vehicle : {osmscout::vehicleFoot,osmscout::vehicleBicycle,osmscout::vehicleCar}) {
+    std::string filename=osmscout::AppendFileToDir(argv[1],
+                                                   osmscout::RouteContractionHierarchy::GetFilename(routerFilenamebase,
+                                                                                                    vehicle));
+
+    if (!osmscout::ExistsInFilesystem(filename)) {
+      std::cout << "Contraction hierarchy '" << filename << "' does not exist, skipping vehicle" << std::endl;
+      continue;
+    }
+
+    switch (vehicle) {
+    case osmscout::vehicleFoot:
+      result=TestVehicle(database,aStarRouter,hierarchyRouter,footProfile,"foot") && result;
+      break;
+    case osmscout::vehicleBicycle:
+      result=TestVehicle(database,aStarRouter,hierarchyRouter,bicycleProfile,"bicycle") && result;
+      break;
+    case osmscout::vehicleCar:
+      result=TestVehicle(database,aStarRouter,hierarchyRouter,*carProfile,"car") && result;
+      break;
+    }
+  }
+
+  aStarRouter.Close();
+  hierarchyRouter.Close();
+  database->Close();
+
+  if (result) {
+    std::cout << "Test result: OK" << std::endl;
+    return 0;
+  }
+  else {
+    std::cout << "Test result: FAILED" << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,306 @@
+/*
+  RouteGraphPerformance - a test program for libosmscout
+  Copyright (C) 2016  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <map>
+#include <vector>
+
+#include <osmscout/Database.h>
+#include <osmscout/RoutingService.h>
+
+#include <osmscout/util/File.h>
+#include <osmscout/util/Geometry.h>
+#include <osmscout/util/StopClock.h>
+
+/**
+  Calculates the same set of routes between random locations with the A*
+  router reading route nodes from the routing graph and with the A* router
+  working on the compact route graph generated by the importer (option
+  "--routeCSR true"). Prints the time needed by both and checks that both
+  result in routes of the same length.
+
+  Contraction hierarchies are disabled for both routers.
+*/
+
+static const size_t ROUTE_COUNT=200;
+static const double SEARCH_RADIUS=1000.0;
+
+struct Position
+{
+  osmscout::ObjectFileRef object;
+  size_t                  nodeIndex;
+};
+
+struct Query
+{
+  Position start;
+  Position target;
+};
+
+static double GetRouteLength(osmscout::RoutingService& router,
+                             const osmscout::RouteData& data)
+{
+  std::list<osmscout::Point> points;
+  double                     length=0.0;
+
+  router.TransformRouteDataToPoints(data,
+                                    points);
+
+  for (auto current=points.begin(); current!=points.end(); ++current) {
+    auto next=current;
+
+    ++next;
+
+    if (next==points.end()) {
+      break;
+    }
+
+    length+=osmscout::GetSphericalDistance(current->GetCoord(),
+                                           next->GetCoord());
+  }
+
+  return length;
+}
+
+static bool GetQueries(const osmscout::DatabaseRef& database,
+                       osmscout::RoutingService& router,
+                       osmscout::Vehicle vehicle,
+                       std::vector<Query>& queries)
+{
+  osmscout::GeoBox boundingBox;
+
+  database->GetBoundingBox(boundingBox);
+
+  std::srand(42);
+
+  for (size_t i=0; i<ROUTE_COUNT; i++) {
+    Query query;
+
+    for (auto position : {&query.start,&query.target}) {
+      if (!router.GetClosestRoutableNode(boundingBox.GetMinLat()+boundingBox.GetHeight()*std::rand()/RAND_MAX,
+                                         boundingBox.GetMinLon()+boundingBox.GetWidth()*std::rand()/RAND_MAX,
+                                         vehicle,
+                                         SEARCH_RADIUS,
+                                         position->object,
+                                         position->nodeIndex)) {
+        std::cerr << "Error while searching for routable nodes" << std::endl;
+        return false;
+      }
+    }
+
+    if (query.start.object.Valid() &&
+        query.target.object.Valid()) {
+      queries.push_back(query);
+    }
+  }
+
+  return true;
+}
+
+static bool CalculateRoutes(osmscout::RoutingService& router,
+                            const osmscout::RoutingProfile& profile,
+                            const std::vector<Query>& queries,
+                            std::vector<double>& lengths,
+                            double& time)
+{
+  std::vector<osmscout::RouteData> routes(queries.size());
+  osmscout::StopClock              clock;
+
+  for (size_t i=0; i<queries.size(); i++) {
+    if (!router.CalculateRoute(profile,
+                               queries[i].start.object,
+                               queries[i].start.nodeIndex,
+                               queries[i].target.object,
+                               queries[i].target.nodeIndex,
+                               routes[i])) {
+      std::cerr << "Error while calculating route" << std::endl;
+      return false;
+    }
+  }
+
+  clock.Stop();
+
+  time=clock.GetMilliseconds();
+
+  lengths.clear();
+
+  for (auto& route : routes) {
+    lengths.push_back(route.IsEmpty() ? -1.0 : GetRouteLength(router,route));
+  }
+
+  return true;
+}
+
+static bool TestVehicle(const osmscout::DatabaseRef& database,
+                        osmscout::RoutingService& dataFileRouter,
+                        osmscout::RoutingService& compactRouter,
+                        const osmscout::RoutingProfile& profile,
+                        const std::string& name)
+{
+  std::vector<Query>  queries;
+  std::vector<double> dataFileLengths;
+  std::vector<double> compactLengths;
+  double              dataFileTime;
+  double              compactTime;
+  size_t              errorCount=0;
+
+  if (!GetQueries(database,
+                  dataFileRouter,
+                  profile.GetVehicle(),
+                  queries)) {
+    return false;
+  }
+
+  if (!CalculateRoutes(dataFileRouter,
+                       profile,
+                       queries,
+                       dataFileLengths,
+                       dataFileTime) ||
+      !CalculateRoutes(compactRouter,
+                       profile,
+                       queries,
+                       compactLengths,
+                       compactTime)) {
+    return false;
+  }
+
+  for (size_t i=0; i<queries.size(); i++) {
+    if (std::fabs(dataFileLengths[i]-compactLengths[i])>0.001) {
+      std::cerr << name << ": " << queries[i].start.object.GetName() << "[" << queries[i].start.nodeIndex << "]";
+      std::cerr << " => " << queries[i].target.object.GetName() << "[" << queries[i].target.nodeIndex << "]: ";
+      std::cerr << "route graph " << dataFileLengths[i] << "km, compact route graph " << compactLengths[i] << "km" << std::endl;
+      errorCount++;
+    }
+  }
+
+  std::cout << std::setw(8) << std::left << name << std::right;
+  std::cout << " routes: " << std::setw(4) << queries.size();
+  std::cout << " errors: " << std::setw(4) << errorCount;
+  std::cout << " route graph: " << std::fixed << std::setprecision(1) << std::setw(8) << dataFileTime << "ms";
+  std::cout << " compact route graph: " << std::fixed << std::setprecision(1) << std::setw(8) << compactTime << "ms";
+
+  if (compactTime>0.0) {
+    std::cout << " (x" << std::setprecision(1) << dataFileTime/compactTime << ")";
+  }
+
+  std::cout << std::endl;
+
+  return errorCount==0;
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc!=2 && argc!=3) {
+    std::cerr << "RouteGraphPerformance <database directory> [<router filename base>]" << std::endl;
+
+    return 1;
+  }
+
+  std::string routerFilenamebase=osmscout::RoutingService::DEFAULT_FILENAME_BASE;
+
+  if (argc==3) {
+    routerFilenamebase=argv[2];
+  }
+
+  std::string filename=osmscout::AppendFileToDir(argv[1],
+                                                 osmscout::CompactRouteGraph::GetFilename(routerFilenamebase));
+
+  if (!osmscout::ExistsInFilesystem(filename)) {
+    std::cerr << "Compact route graph '" << filename << "' does not exist" << std::endl;
+
+    return 1;
+  }
+
+  osmscout::DatabaseParameter databaseParameter;
+  osmscout::DatabaseRef       database=std::make_shared<osmscout::Database>(databaseParameter);
+
+  if (!database->Open(argv[1])) {
+    std::cerr << "Cannot open database" << std::endl;
+
+    return 1;
+  }
+
+  osmscout::RouterParameter dataFileParameter;
+  osmscout::RouterParameter compactParameter;
+
+  dataFileParameter.SetUseContractionHierarchy(false);
+  dataFileParameter.SetUseCompactRouteGraph(false);
+
+  compactParameter.SetUseContractionHierarchy(false);
+  compactParameter.SetUseCompactRouteGraph(true);
+
+  osmscout::RoutingService dataFileRouter(database,
+                                          dataFileParameter,
+                                          routerFilenamebase);
+  osmscout::RoutingService compactRouter(database,
+                                         compactParameter,
+                                         routerFilenamebase);
+
+  if (!dataFileRouter.Open() ||
+      !compactRouter.Open()) {
+    std::cerr << "Cannot open routing database" << std::endl;
+
+    return 1;
+  }
+
+  osmscout::TypeConfigRef                  typeConfig=database->GetTypeConfig();
+  osmscout::FastestPathRoutingProfile      footProfile(typeConfig);
+  osmscout::FastestPathRoutingProfile      bicycleProfile(typeConfig);
+  osmscout::FastestPathRoutingProfile      carProfile(typeConfig);
+  std::map<std::string,double>             carSpeedTable;
+
+  footProfile.ParametrizeForFoot(*typeConfig,
+                                 5.0);
+  bicycleProfile.ParametrizeForBicycle(*typeConfig,
+                                       20.0);
+
+  for (const auto &type : typeConfig->GetTypes()) {
+    if (!type->GetIgnore() &&
+        type->CanRouteCar()) {
+      carSpeedTable[type->GetName()]=80.0;
+    }
+  }
+
+  carProfile.ParametrizeForCar(*typeConfig,
+                               carSpeedTable,
+                               160.0);
+
+  bool result=true;
+
+  result=TestVehicle(database,dataFileRouter,compactRouter,footProfile,"foot") && result;
+  result=TestVehicle(database,dataFileRouter,compactRouter,bicycleProfile,"bicycle") && result;
+  result=TestVehicle(database,dataFileRouter,compactRouter,carProfile,"car") && result;
+
+  dataFileRouter.Close();
+  compactRouter.Close();
+  database->Close();
+
+  if (result) {
+    std::cout << "Test result: OK" << std::endl;
+    return 0;
+  }
+  else {
+    std::cout << "Test result: FAILED" << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,223 @@
+/*
+  RouteMatrix - a test program for libosmscout
+  Copyright (C) 2016  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <vector>
+
+#include <osmscout/Database.h>
+#include <osmscout/RoutingService.h>
+
+#include <osmscout/util/Geometry.h>
+#include <osmscout/util/StopClock.h>
+
+/**
+  Calculates a distance matrix between random locations using
+  RoutingService::CalculateMatrix() and compares it with the length of the
+  routes calculated one by one with RoutingService::CalculateRoute().
+
+  The matrix takes the cheaper of both route nodes next to the target into
+  account, while the A* router stops at the first one it reaches, so matrix
+  distances must never be longer than the route.
+*/
+
+static const size_t SOURCE_COUNT=10;
+static const size_t TARGET_COUNT=20;
+static const double SEARCH_RADIUS=1000.0;
+static const double TOLERANCE=0.001;
+
+static double GetRouteLength(osmscout::RoutingService& router,
+                             const osmscout::RouteData& data)
+{
+  std::list<osmscout::Point> points;
+  double                     length=0.0;
+
+  router.TransformRouteDataToPoints(data,
+                                    points);
+
+  for (auto current=points.begin(); current!=points.end(); ++current) {
+    auto next=current;
+
+    ++next;
+
+    if (next==points.end()) {
+      break;
+    }
+
+    length+=osmscout::GetSphericalDistance(current->GetCoord(),
+                                           next->GetCoord());
+  }
+
+  return length;
+}
+
+static bool GetRandomPositions(const osmscout::GeoBox& boundingBox,
+                               osmscout::RoutingService& router,
+                               osmscout::Vehicle vehicle,
+                               size_t count,
+                               std::vector<osmscout::RoutePosition>& positions)
+{
+  while (positions.size()<count) {
+    osmscout::RoutePosition position;
+
+    if (!router.GetClosestRoutableNode(boundingBox.GetMinLat()+boundingBox.GetHeight()*std::rand()/RAND_MAX,
+                                       boundingBox.GetMinLon()+boundingBox.GetWidth()*std::rand()/RAND_MAX,
+                                       vehicle,
+                                       SEARCH_RADIUS,
+                                       position.object,
+                                       position.nodeIndex)) {
+      std::cerr << "Error while searching for routable nodes" << std::endl;
+      return false;
+    }
+
+    if (position.object.Valid()) {
+      positions.push_back(position);
+    }
+  }
+
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc!=2) {
+    std::cerr << "RouteMatrix <database directory>" << std::endl;
+
+    return 1;
+  }
+
+  osmscout::DatabaseParameter databaseParameter;
+  osmscout::DatabaseRef       database=std::make_shared<osmscout::Database>(databaseParameter);
+
+  if (!database->Open(argv[1])) {
+    std::cerr << "Cannot open database" << std::endl;
+
+    return 1;
+  }
+
+  osmscout::RouterParameter routerParameter;
+
+  routerParameter.SetUseContractionHierarchy(false);
+
+  osmscout::RoutingService router(database,
+                                  routerParameter,
+                                  osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+
+  if (!router.Open()) {
+    std::cerr << "Cannot open routing database" << std::endl;
+
+    return 1;
+  }
+
+  osmscout::TypeConfigRef              typeConfig=database->GetTypeConfig();
+  osmscout::ShortestPathRoutingProfile profile(typeConfig);
+  osmscout::GeoBox                     boundingBox;
+
+  profile.ParametrizeForFoot(*typeConfig,
+                             5.0);
+
+  database->GetBoundingBox(boundingBox);
+
+  std::srand(42);
+
+  std::vector<osmscout::RoutePosition> sources;
+  std::vector<osmscout::RoutePosition> targets;
+
+  if (!GetRandomPositions(boundingBox,router,profile.GetVehicle(),SOURCE_COUNT,sources) ||
+      !GetRandomPositions(boundingBox,router,profile.GetVehicle(),TARGET_COUNT,targets)) {
+    return 1;
+  }
+
+  osmscout::RouteMatrix matrix;
+  osmscout::StopClock   matrixClock;
+
+  if (!router.CalculateMatrix(profile,
+                              sources,
+                              targets,
+                              matrix)) {
+    std::cerr << "Error while calculating matrix" << std::endl;
+    return 1;
+  }
+
+  matrixClock.Stop();
+
+  osmscout::StopClock routeClock;
+  size_t              errorCount=0;
+  size_t              equalCount=0;
+
+  for (size_t s=0; s<sources.size(); s++) {
+    for (size_t t=0; t<targets.size(); t++) {
+      osmscout::RouteData route;
+
+      if (!router.CalculateRoute(profile,
+                                 sources[s].object,
+                                 sources[s].nodeIndex,
+                                 targets[t].object,
+                                 targets[t].nodeIndex,
+                                 route)) {
+        std::cerr << "Error while calculating route" << std::endl;
+        return 1;
+      }
+
+      if (route.IsEmpty()) {
+        if (matrix.IsReachable(s,t)) {
+          std::cerr << s << " => " << t << ": no route, but matrix distance " << matrix.GetDistance(s,t) << "km" << std::endl;
+          errorCount++;
+        }
+
+        continue;
+      }
+
+      double length=GetRouteLength(router,route);
+
+      if (!matrix.IsReachable(s,t) ||
+          matrix.GetDistance(s,t)>length+TOLERANCE ||
+          std::fabs(matrix.GetDistance(s,t)-matrix.GetCost(s,t))>TOLERANCE) {
+        std::cerr << s << " => " << t << ": route " << length << "km, matrix distance " << matrix.GetDistance(s,t) << "km";
+        std::cerr << " cost " << matrix.GetCost(s,t) << std::endl;
+        errorCount++;
+      }
+      else if (std::fabs(matrix.GetDistance(s,t)-length)<=TOLERANCE) {
+        equalCount++;
+      }
+    }
+  }
+
+  routeClock.Stop();
+
+  std::cout << "Matrix:          " << sources.size() << "x" << targets.size() << std::endl;
+  std::cout << "CalculateMatrix: " << matrixClock.GetMilliseconds() << "ms" << std::endl;
+  std::cout << "CalculateRoute:  " << routeClock.GetMilliseconds() << "ms" << std::endl;
+  std::cout << "Equal distances: " << equalCount << "/" << sources.size()*targets.size() << std::endl;
+
+  router.Close();
+  database->Close();
+
+  if (errorCount==0) {
+    std::cout << "Test result: OK" << std::endl;
+    return 0;
+  }
+  else {
+    std::cout << "Test result: FAILED" << std::endl;
+    return 1;
+  }
+}
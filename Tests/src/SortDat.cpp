@@ -0,0 +1,327 @@
+/*
+  SortDat - a test program for libosmscout
+  Copyright (C) 2016  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <osmscout/Node.h>
+#include <osmscout/TypeConfig.h>
+#include <osmscout/TypeFeatures.h>
+
+#include <osmscout/util/File.h>
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
+#include <osmscout/util/Progress.h>
+#include <osmscout/util/String.h>
+
+#include <osmscout/import/SortDat.h>
+
+/**
+  Sorts the same nodes with the default memory budget (sorted in memory),
+  a small budget (a few runs merged at once) and a tiny budget (every node
+  in its own run, merged over several levels). Many nodes share the same
+  location, so all three results must be identical and keep the nodes of
+  each location in their original order. No run file may be left over.
+*/
+
+static const size_t      NODE_COUNT=5000;
+static const size_t      LOCATION_COUNT=37;
+static const std::string SOURCE_FILENAME="sortdat.tmp";
+static const std::string DATA_FILENAME="sortdat.dat";
+static const std::string MAP_FILENAME="sortdat.idmap";
+
+class TestSortDataGenerator : public osmscout::SortDataGenerator<osmscout::Node>
+{
+protected:
+  void GetTopLeftCoordinate(const osmscout::Node& data,
+                            osmscout::GeoCoord& coord)
+  {
+    coord=data.GetCoords();
+  }
+
+public:
+  TestSortDataGenerator()
+  : osmscout::SortDataGenerator<osmscout::Node>(DATA_FILENAME,MAP_FILENAME)
+  {
+    AddSource(SOURCE_FILENAME);
+  }
+};
+
+/**
+ * A sorted node together with the data written for it
+ */
+struct SortedNode
+{
+  osmscout::Id       id;
+  osmscout::GeoCoord coord;
+  std::string        name;
+};
+
+static osmscout::GeoCoord GetCoord(size_t i)
+{
+  size_t location=(i*7)%LOCATION_COUNT;
+
+  return osmscout::GeoCoord(50.0+0.01*(location%6),
+                            7.0+0.01*(location/6));
+}
+
+static std::string GetName(osmscout::Id id)
+{
+  return "Node "+osmscout::NumberToString(id);
+}
+
+static bool WriteSource(const osmscout::TypeConfig& typeConfig,
+                        const osmscout::TypeInfoRef& type)
+{
+  osmscout::NameFeatureValueReader nameReader(typeConfig);
+  osmscout::FileWriter             writer;
+
+  try {
+    writer.Open(SOURCE_FILENAME);
+
+    writer.Write((uint32_t)NODE_COUNT);
+
+    for (size_t i=0; i<NODE_COUNT; i++) {
+      osmscout::FeatureValueBuffer buffer;
+      osmscout::Node               node;
+      osmscout::Id                 id=i+1;
+      size_t                       index;
+
+      buffer.SetType(type);
+
+      if (nameReader.GetIndex(buffer,index)) {
+        dynamic_cast<osmscout::NameFeatureValue*>(buffer.AllocateValue(index))->SetName(GetName(id));
+      }
+
+      node.SetFeatures(buffer);
+      node.SetCoords(GetCoord(i));
+
+      writer.Write((uint8_t)osmscout::osmRefNode);
+      writer.Write(id);
+      node.Write(typeConfig,
+                 writer);
+    }
+
+    writer.Close();
+  }
+  catch (osmscout::IOException& e) {
+    std::cerr << e.GetDescription() << std::endl;
+    writer.CloseFailsafe();
+    return false;
+  }
+
+  return true;
+}
+
+static bool ReadResult(const osmscout::TypeConfig& typeConfig,
+                       std::vector<SortedNode>& nodes)
+{
+  osmscout::NameFeatureValueReader nameReader(typeConfig);
+  osmscout::FileScanner            dataScanner;
+  osmscout::FileScanner            mapScanner;
+
+  nodes.clear();
+
+  try {
+    uint32_t dataCount;
+    uint32_t mapCount;
+
+    dataScanner.Open(DATA_FILENAME,
+                     osmscout::FileScanner::Sequential,
+                     false);
+    mapScanner.Open(MAP_FILENAME,
+                    osmscout::FileScanner::Sequential,
+                    false);
+
+    dataScanner.Read(dataCount);
+    mapScanner.Read(mapCount);
+
+    if (dataCount!=NODE_COUNT ||
+        mapCount!=NODE_COUNT) {
+      std::cerr << "Expected " << NODE_COUNT << " nodes, but data file has " << dataCount << " and map file has " << mapCount << std::endl;
+      dataScanner.CloseFailsafe();
+      mapScanner.CloseFailsafe();
+      return false;
+    }
+
+    for (size_t i=0; i<NODE_COUNT; i++) {
+      SortedNode                  sortedNode;
+      osmscout::Node              node;
+      uint8_t                     type;
+      osmscout::FileOffset        offset;
+      osmscout::NameFeatureValue* name;
+
+      mapScanner.Read(sortedNode.id);
+      mapScanner.Read(type);
+      mapScanner.ReadFileOffset(offset);
+
+      if (dataScanner.GetPos()!=offset) {
+        std::cerr << "Node " << sortedNode.id << " is not stored at offset " << offset << std::endl;
+        dataScanner.CloseFailsafe();
+        mapScanner.CloseFailsafe();
+        return false;
+      }
+
+      node.Read(typeConfig,
+                dataScanner);
+
+      name=nameReader.GetValue(node.GetFeatureValueBuffer());
+
+      sortedNode.coord=node.GetCoords();
+
+      if (name!=NULL) {
+        sortedNode.name=name->GetName();
+      }
+
+      nodes.push_back(sortedNode);
+    }
+
+    dataScanner.Close();
+    mapScanner.Close();
+  }
+  catch (osmscout::IOException& e) {
+    std::cerr << e.GetDescription() << std::endl;
+    dataScanner.CloseFailsafe();
+    mapScanner.CloseFailsafe();
+    return false;
+  }
+
+  return true;
+}
+
+static int CheckResult(const std::string& name,
+                       const std::vector<SortedNode>& nodes,
+                       const std::vector<SortedNode>& expected)
+{
+  int                       errors=0;
+  std::vector<osmscout::Id> lastIds(LOCATION_COUNT,0);
+
+  for (const auto& node : nodes) {
+    if (node.id==0 ||
+        node.id>NODE_COUNT) {
+      std::cerr << name << ": Unexpected node id " << node.id << std::endl;
+      errors++;
+      continue;
+    }
+
+    size_t             location=((node.id-1)*7)%LOCATION_COUNT;
+    osmscout::GeoCoord coord=GetCoord(node.id-1);
+
+    // Coordinates are stored with limited precision
+    if (std::fabs(node.coord.GetLat()-coord.GetLat())>1e-5 ||
+        std::fabs(node.coord.GetLon()-coord.GetLon())>1e-5 ||
+        node.name!=GetName(node.id)) {
+      std::cerr << name << ": Node " << node.id << " has wrong data" << std::endl;
+      errors++;
+    }
+
+    if (node.id<lastIds[location]) {
+      std::cerr << name << ": Node " << node.id << " is sorted after node " << lastIds[location] << std::endl;
+      errors++;
+    }
+
+    lastIds[location]=node.id;
+  }
+
+  if (!expected.empty()) {
+    for (size_t i=0; i<nodes.size() && i<expected.size(); i++) {
+      if (nodes[i].id!=expected[i].id) {
+        std::cerr << name << ": Node " << nodes[i].id << " at position " << i << ", expected node " << expected[i].id << std::endl;
+        errors++;
+        break;
+      }
+    }
+  }
+
+  for (const auto& runFilename : {DATA_FILENAME+".0.run",
+                                  DATA_FILENAME+".1.0.run",
+                                  DATA_FILENAME+".2.0.run"}) {
+    if (osmscout::ExistsInFilesystem(runFilename)) {
+      std::cerr << name << ": Run file '" << runFilename << "' was not deleted" << std::endl;
+      errors++;
+    }
+  }
+
+  std::cout << name << ": " << nodes.size() << " nodes, " << (errors==0 ? "OK" : "FAILED") << std::endl;
+
+  return errors;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+  osmscout::TypeConfigRef   typeConfig=std::make_shared<osmscout::TypeConfig>();
+  osmscout::TypeInfoRef     nodeType=std::make_shared<osmscout::TypeInfo>("test_node");
+  osmscout::SilentProgress  progress;
+  std::vector<SortedNode>   expected;
+  int                       errors=0;
+
+  nodeType->CanBeNode(true);
+  nodeType->AddFeature(typeConfig->GetFeature(osmscout::NameFeature::NAME));
+  typeConfig->RegisterType(nodeType);
+
+  if (!WriteSource(*typeConfig,nodeType)) {
+    std::cerr << "Cannot write source file" << std::endl;
+    return 1;
+  }
+
+  osmscout::ImportParameter defaultParameter;
+
+  for (size_t budget : {defaultParameter.GetSortMemoryBudget(),(size_t)64*1024,(size_t)1}) {
+    osmscout::ImportParameter parameter;
+    TestSortDataGenerator     generator;
+    std::vector<SortedNode>   nodes;
+    std::string               name="Budget "+osmscout::NumberToString(budget);
+
+    parameter.SetDestinationDirectory(".");
+    parameter.SetSortMemoryBudget(budget);
+
+    if (!generator.Import(typeConfig,
+                          parameter,
+                          progress) ||
+        !ReadResult(*typeConfig,
+                    nodes)) {
+      std::cerr << name << ": Cannot sort nodes" << std::endl;
+      errors++;
+      continue;
+    }
+
+    errors+=CheckResult(name,
+                        nodes,
+                        expected);
+
+    if (expected.empty()) {
+      expected=nodes;
+    }
+  }
+
+  osmscout::RemoveFile(SOURCE_FILENAME);
+  osmscout::RemoveFile(DATA_FILENAME);
+  osmscout::RemoveFile(MAP_FILENAME);
+
+  if (errors>0) {
+    std::cerr << errors << " error(s)" << std::endl;
+    return 1;
+  }
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
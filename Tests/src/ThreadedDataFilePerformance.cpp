@@ -0,0 +1,226 @@
+/*
+  ThreadedDataFilePerformance - a test program for libosmscout
+  Copyright (C) 2016  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include <osmscout/Database.h>
+
+#include <osmscout/util/StopClock.h>
+
+/**
+  Check scaling of parallel object loading from the way and area data files
+  for 1 to 32 threads. Each thread loads the complete set of collected objects
+  by file offset, so the amount of work per thread is constant and the overall
+  throughput should ideally grow linear with the number of threads.
+*/
+
+static const size_t MAX_THREAD_COUNT=32;
+static const size_t ITERATION_COUNT=3;
+
+void LoadObjects(const osmscout::WayDataFileRef& wayDataFile,
+                 const osmscout::AreaDataFileRef& areaDataFile,
+                 const std::vector<osmscout::FileOffset>& wayOffsets,
+                 const std::vector<osmscout::DataBlockSpan>& areaSpans,
+                 bool& result)
+{
+  result=true;
+
+  for (size_t i=1; i<=ITERATION_COUNT; i++) {
+    std::vector<osmscout::WayRef>  ways;
+    std::vector<osmscout::AreaRef> areas;
+
+    if (!wayDataFile->GetByOffset(wayOffsets,
+                                  ways)) {
+      result=false;
+    }
+
+    if (!areaDataFile->GetByBlockSpans(areaSpans,
+                                       areas)) {
+      result=false;
+    }
+
+    if (ways.size()!=wayOffsets.size()) {
+      result=false;
+    }
+  }
+}
+
+bool TestScaling(const osmscout::DatabaseRef& database,
+                 const std::vector<osmscout::FileOffset>& wayOffsets,
+                 const std::vector<osmscout::DataBlockSpan>& areaSpans,
+                 size_t areaCount,
+                 size_t threadCount,
+                 double& throughput)
+{
+  osmscout::WayDataFileRef  wayDataFile=database->GetWayDataFile();
+  osmscout::AreaDataFileRef areaDataFile=database->GetAreaDataFile();
+
+  if (!wayDataFile ||
+      !areaDataFile) {
+    return false;
+  }
+
+  bool                     result=true;
+  std::vector<std::thread> threads(threadCount);
+  bool                     *results;
+
+  results=new bool[threadCount];
+
+  osmscout::StopClock timer;
+
+  for (size_t i=0; i<threads.size(); i++) {
+    threads[i]=std::thread(LoadObjects,
+                           std::cref(wayDataFile),
+                           std::cref(areaDataFile),
+                           std::cref(wayOffsets),
+                           std::cref(areaSpans),
+                           std::ref(results[i]));
+  }
+
+  for (size_t i=0; i<threads.size(); i++) {
+    threads[i].join();
+
+    if (!results[i]) {
+      result=false;
+    }
+  }
+
+  timer.Stop();
+
+  delete [] results;
+
+  double objectCount=(double)threadCount*ITERATION_COUNT*(wayOffsets.size()+areaCount);
+
+  throughput=objectCount/(timer.GetMilliseconds()/1000.0);
+
+  return result;
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc!=2) {
+    std::cerr << "ThreadedDataFilePerformance <database directory>" << std::endl;
+
+    return 1;
+  }
+
+  osmscout::DatabaseParameter parameter;
+  osmscout::DatabaseRef       database=std::make_shared<osmscout::Database>(parameter);
+
+  std::cout << "Opening database..." << std::endl;
+
+  if (!database->Open(argv[1])) {
+    std::cerr << "Cannot open database" << std::endl;
+
+    return 1;
+  }
+
+  std::cout << "Done." << std::endl;
+
+  osmscout::TypeConfigRef           typeConfig=database->GetTypeConfig();
+  osmscout::AreaWayIndexRef         areaWayIndex=database->GetAreaWayIndex();
+  osmscout::AreaAreaIndexRef        areaAreaIndex=database->GetAreaAreaIndex();
+
+  osmscout::GeoBox                     boundingBox;
+  osmscout::TypeInfoSet                wayTypes;
+  osmscout::TypeInfoSet                areaTypes;
+  osmscout::TypeInfoSet                loadedWayTypes;
+  osmscout::TypeInfoSet                loadedAreaTypes;
+  std::vector<osmscout::FileOffset>    wayOffsets;
+  std::vector<osmscout::DataBlockSpan> areaSpans;
+  size_t                               areaCount=0;
+
+  database->GetBoundingBox(boundingBox);
+
+  for (const auto& type : typeConfig->GetWayTypes()) {
+    wayTypes.Set(type);
+  }
+
+  for (const auto& type : typeConfig->GetAreaTypes()) {
+    areaTypes.Set(type);
+  }
+
+  std::cout << "Collecting test data..." << std::endl;
+
+  if (!areaWayIndex->GetOffsets(boundingBox,
+                                wayTypes,
+                                wayOffsets,
+                                loadedWayTypes)) {
+    std::cerr << "Cannot load way offsets" << std::endl;
+
+    return 1;
+  }
+
+  if (!areaAreaIndex->GetAreasInArea(*typeConfig,
+                                     boundingBox,
+                                     std::numeric_limits<size_t>::max(),
+                                     areaTypes,
+                                     areaSpans,
+                                     loadedAreaTypes)) {
+    std::cerr << "Cannot load area offsets" << std::endl;
+
+    return 1;
+  }
+
+  for (const auto& span : areaSpans) {
+    areaCount+=span.count;
+  }
+
+  std::cout << " - " << wayOffsets.size() << " way(s)" << std::endl;
+  std::cout << " - " << areaCount << " area(s)" << std::endl;
+
+  double singleThreadThroughput=0.0;
+
+  std::cout << "Threads     objects/s  speedup" << std::endl;
+
+  for (size_t threadCount=1; threadCount<=MAX_THREAD_COUNT; threadCount*=2) {
+    double throughput;
+
+    if (!TestScaling(database,
+                     wayOffsets,
+                     areaSpans,
+                     areaCount,
+                     threadCount,
+                     throughput)) {
+      std::cerr << "Error while loading data with " << threadCount << " thread(s)" << std::endl;
+
+      return 1;
+    }
+
+    if (threadCount==1) {
+      singleThreadThroughput=throughput;
+    }
+
+    std::cout << std::setw(7) << threadCount << " ";
+    std::cout << std::setw(13) << std::fixed << std::setprecision(0) << throughput << " ";
+    std::cout << std::setw(8) << std::fixed << std::setprecision(2) << throughput/singleThreadThroughput << std::endl;
+  }
+
+  std::cout << "Closing database..." << std::endl;
+  database->Close();
+  database=NULL;
+  std::cout << "Done." << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,199 @@
+/*
+  TransPolygon - a test program for libosmscout
+  Copyright (C) 2016  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <osmscout/GeoCoord.h>
+#include <osmscout/Point.h>
+
+#include <osmscout/util/Projection.h>
+#include <osmscout/util/Transformation.h>
+
+/**
+  Transforms ways and areas with and without optimization and clipping
+  and checks the number of resulting points and that start, end and length
+  match the drawn points.
+*/
+
+static const size_t WIDTH=800;
+static const size_t HEIGHT=800;
+
+static void AddPoints(const osmscout::Projection& projection,
+                      const std::vector<std::pair<double,double>>& pixels,
+                      std::vector<osmscout::Point>& nodes)
+{
+  for (const auto& pixel : pixels) {
+    double lon;
+    double lat;
+
+    projection.PixelToGeo(pixel.first,pixel.second,lon,lat);
+
+    nodes.push_back(osmscout::Point(0,osmscout::GeoCoord(lat,lon)));
+  }
+}
+
+static int CheckPolygon(const std::string& name,
+                        const osmscout::TransPolygon& polygon,
+                        size_t nodeCount,
+                        size_t expectedLength)
+{
+  int    errors=0;
+  size_t drawn=0;
+  size_t first=nodeCount;
+  size_t last=0;
+
+  for (size_t i=0; i<nodeCount; i++) {
+    if (polygon.points[i].draw) {
+      drawn++;
+
+      if (i<first) {
+        first=i;
+      }
+
+      last=i;
+    }
+  }
+
+  if (polygon.GetLength()!=drawn) {
+    std::cerr << name << ": Length " << polygon.GetLength() << " but " << drawn << " drawn points" << std::endl;
+    errors++;
+  }
+
+  if (drawn>0 &&
+      (polygon.GetStart()!=first ||
+       polygon.GetEnd()!=last)) {
+    std::cerr << name << ": Start/end " << polygon.GetStart() << "/" << polygon.GetEnd() << " but first/last drawn point " << first << "/" << last << std::endl;
+    errors++;
+  }
+
+  if (drawn!=expectedLength) {
+    std::cerr << name << ": " << drawn << " drawn points, expected " << expectedLength << std::endl;
+    errors++;
+  }
+
+  std::cout << name << ": " << drawn << "/" << nodeCount << " points, " << (errors==0 ? "OK" : "FAILED") << std::endl;
+
+  return errors;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+  osmscout::MercatorProjection projection;
+  osmscout::Magnification      magnification;
+  osmscout::TransPolygon       polygon;
+  int                          errors=0;
+
+  magnification.SetLevel(14);
+
+  projection.Set(osmscout::GeoCoord(50.0,7.0),
+                 magnification,
+                 96.0,
+                 WIDTH,HEIGHT);
+
+  // A straight way, that simplifies to its first and last point
+  std::vector<std::pair<double,double>> pixels;
+  std::vector<osmscout::Point>          line;
+
+  for (size_t i=0; i<50; i++) {
+    pixels.push_back(std::make_pair(100.0+10.0*i,400.0));
+  }
+
+  AddPoints(projection,pixels,line);
+
+  // A straight way, that leaves the visible area on both sides
+  std::vector<osmscout::Point> longLine;
+
+  pixels.clear();
+
+  for (size_t i=0; i<81; i++) {
+    pixels.push_back(std::make_pair(-390.0+20.0*i,400.0));
+  }
+
+  AddPoints(projection,pixels,longLine);
+
+  // A square with 10 nodes on each edge, that simplifies to its corners
+  std::vector<osmscout::Point> square;
+
+  pixels.clear();
+
+  for (size_t i=0; i<10; i++) {
+    pixels.push_back(std::make_pair(200.0+40.0*i,200.0));
+  }
+
+  for (size_t i=0; i<10; i++) {
+    pixels.push_back(std::make_pair(600.0,200.0+40.0*i));
+  }
+
+  for (size_t i=0; i<10; i++) {
+    pixels.push_back(std::make_pair(600.0-40.0*i,600.0));
+  }
+
+  for (size_t i=0; i<10; i++) {
+    pixels.push_back(std::make_pair(200.0,600.0-40.0*i));
+  }
+
+  AddPoints(projection,pixels,square);
+
+  for (size_t clip=0; clip<=1; clip++) {
+    std::string suffix;
+
+    if (clip==1) {
+      polygon.SetClipRect(0.0,0.0,(double)WIDTH,(double)HEIGHT);
+      suffix=" (clipped)";
+    }
+
+    polygon.TransformWay(projection,osmscout::TransPolygon::none,line,1.0);
+    errors+=CheckPolygon("Line none"+suffix,polygon,line.size(),line.size());
+
+    // The fast optimization drops at most every second point in one pass
+    polygon.TransformWay(projection,osmscout::TransPolygon::fast,line,1.0);
+    errors+=CheckPolygon("Line fast"+suffix,polygon,line.size(),26);
+
+    polygon.TransformWay(projection,osmscout::TransPolygon::quality,line,1.0);
+    errors+=CheckPolygon("Line quality"+suffix,polygon,line.size(),2);
+
+    polygon.TransformWay(projection,osmscout::TransPolygon::quality,longLine,1.0);
+    errors+=CheckPolygon("Long line quality"+suffix,polygon,longLine.size(),2);
+
+    polygon.TransformArea(projection,osmscout::TransPolygon::quality,square,1.0);
+    errors+=CheckPolygon("Square quality"+suffix,polygon,square.size(),4);
+  }
+
+  // Outside the visible area only the first and the last point and the points
+  // next to the visible area are kept
+  polygon.TransformWay(projection,osmscout::TransPolygon::none,longLine,1.0);
+  errors+=CheckPolygon("Long line none (clipped)",polygon,longLine.size(),44);
+
+  polygon.ResetClipRect();
+
+  polygon.TransformWay(projection,osmscout::TransPolygon::none,longLine,1.0);
+  errors+=CheckPolygon("Long line none",polygon,longLine.size(),longLine.size());
+
+  if (errors>0) {
+    std::cerr << errors << " error(s)" << std::endl;
+    return 1;
+  }
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,297 @@
+/*
+  VectorTileEncoder - a test program for libosmscout
+  Copyright (C) 2016  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <osmscout/TypeConfig.h>
+#include <osmscout/TypeFeatures.h>
+
+#include <osmscout/util/Projection.h>
+
+#include <osmscout/VectorTileEncoder.h>
+
+/**
+  Encodes single nodes, ways and areas with known tile coordinates and
+  compares the result byte by byte with the expected vector tile.
+
+  The expected tiles were assembled independently from the vector tile
+  specification. They cover zigzag encoding of negative deltas and of a
+  negative layer attribute, the MoveTo, LineTo and ClosePath command
+  integers, the winding order of outer and inner rings and the clipping
+  of lines and polygons against the tile including its buffer.
+*/
+
+static const size_t   TILE_X=8578;
+static const size_t   TILE_Y=5546;
+static const uint32_t EXTENT=256;
+static const uint32_t BUFFER=16;
+
+typedef std::vector<std::pair<double,double>> Pixels;
+
+// A node at (10,20), name "A"
+static const unsigned char nodeTile[]={
+  0x1a,0x2a,0x0a,0x09,0x74,0x65,0x73,0x74,0x5f,0x6e,0x6f,0x64,
+  0x65,0x12,0x0d,0x08,0x00,0x12,0x02,0x00,0x00,0x18,0x01,0x22,
+  0x03,0x09,0x14,0x28,0x1a,0x04,0x6e,0x61,0x6d,0x65,0x22,0x03,
+  0x0a,0x01,0x41,0x28,0x80,0x02,0x78,0x02
+};
+
+// A way (-16,100) (100,100) (100,-16) after clipping, name "B", layer -1
+static const unsigned char wayTile[]={
+  0x1a,0x3e,0x0a,0x08,0x74,0x65,0x73,0x74,0x5f,0x77,0x61,0x79,
+  0x12,0x17,0x08,0x00,0x12,0x04,0x00,0x00,0x01,0x01,0x18,0x02,
+  0x22,0x0b,0x09,0x1f,0xc8,0x01,0x12,0xe8,0x01,0x00,0x00,0xe7,
+  0x01,0x1a,0x04,0x6e,0x61,0x6d,0x65,0x1a,0x05,0x6c,0x61,0x79,
+  0x65,0x72,0x22,0x03,0x0a,0x01,0x42,0x22,0x02,0x30,0x01,0x28,
+  0x80,0x02,0x78,0x02
+};
+
+// A clockwise outer ring (150,50) (150,150) (50,150) (50,50) with a
+// counter-clockwise hole (80,120) (120,120) (120,80) (80,80), name "C"
+static const unsigned char areaTile[]={
+  0x1a,0x42,0x0a,0x09,0x74,0x65,0x73,0x74,0x5f,0x61,0x72,0x65,
+  0x61,0x12,0x25,0x08,0x00,0x12,0x02,0x00,0x00,0x18,0x03,0x22,
+  0x1b,0x09,0xac,0x02,0x64,0x1a,0x00,0xc8,0x01,0xc7,0x01,0x00,
+  0x00,0xc7,0x01,0x0f,0x09,0x3c,0x8c,0x01,0x1a,0x50,0x00,0x00,
+  0x4f,0x4f,0x00,0x0f,0x1a,0x04,0x6e,0x61,0x6d,0x65,0x22,0x03,
+  0x0a,0x01,0x43,0x28,0x80,0x02,0x78,0x02
+};
+
+// The ring (200,272) (200,200) (272,200) (272,272) after clipping
+static const unsigned char clippedAreaTile[]={
+  0x1a,0x28,0x0a,0x09,0x74,0x65,0x73,0x74,0x5f,0x61,0x72,0x65,
+  0x61,0x12,0x16,0x08,0x00,0x18,0x03,0x22,0x10,0x09,0x90,0x03,
+  0xa0,0x04,0x1a,0x00,0x8f,0x01,0x90,0x01,0x00,0x00,0x90,0x01,
+  0x0f,0x28,0x80,0x02,0x78,0x02
+};
+
+static std::vector<osmscout::Point> GetPoints(const osmscout::Projection& projection,
+                                              const Pixels& pixels)
+{
+  std::vector<osmscout::Point> points;
+
+  for (const auto& pixel : pixels) {
+    double lon;
+    double lat;
+
+    projection.PixelToGeo(pixel.first,pixel.second,lon,lat);
+
+    points.push_back(osmscout::Point(0,osmscout::GeoCoord(lat,lon)));
+  }
+
+  return points;
+}
+
+static osmscout::FeatureValueBuffer GetFeatures(const osmscout::TypeConfig& typeConfig,
+                                                const osmscout::TypeInfoRef& type,
+                                                const std::string& name,
+                                                int8_t layer)
+{
+  osmscout::NameFeatureValueReader  nameReader(typeConfig);
+  osmscout::LayerFeatureValueReader layerReader(typeConfig);
+  osmscout::FeatureValueBuffer      buffer;
+  size_t                            index;
+
+  buffer.SetType(type);
+
+  if (!name.empty() &&
+      nameReader.GetIndex(buffer,index)) {
+    dynamic_cast<osmscout::NameFeatureValue*>(buffer.AllocateValue(index))->SetName(name);
+  }
+
+  if (layer!=0 &&
+      layerReader.GetIndex(buffer,index)) {
+    dynamic_cast<osmscout::LayerFeatureValue*>(buffer.AllocateValue(index))->SetLayer(layer);
+  }
+
+  return buffer;
+}
+
+static std::string ToHex(const std::string& data)
+{
+  std::ostringstream stream;
+
+  for (size_t i=0; i<data.length(); i++) {
+    if (i>0) {
+      stream << (i%12==0 ? "\n  " : " ");
+    }
+
+    stream << std::hex << std::setw(2) << std::setfill('0') << (unsigned int)(unsigned char)data[i];
+  }
+
+  return stream.str();
+}
+
+static int CheckTile(const std::string& name,
+                     const osmscout::VectorTileEncoder& encoder,
+                     const osmscout::Magnification& magnification,
+                     const osmscout::MapData& data,
+                     const unsigned char* expected,
+                     size_t expectedLength)
+{
+  std::string tile;
+  std::string expectedTile((const char*)expected,expectedLength);
+
+  if (!encoder.Encode(magnification,
+                      TILE_X,TILE_Y,
+                      data,
+                      tile)) {
+    std::cerr << name << ": Cannot encode tile" << std::endl;
+    return 1;
+  }
+
+  if (tile!=expectedTile) {
+    size_t offset=0;
+
+    while (offset<tile.length() &&
+           offset<expectedTile.length() &&
+           tile[offset]==expectedTile[offset]) {
+      offset++;
+    }
+
+    std::cerr << name << ": Tile differs at byte " << offset << std::endl;
+    std::cerr << "Expected:" << std::endl << "  " << ToHex(expectedTile) << std::endl;
+    std::cerr << "Actual:" << std::endl << "  " << ToHex(tile) << std::endl;
+    std::cout << name << ": FAILED" << std::endl;
+
+    return 1;
+  }
+
+  std::cout << name << ": " << tile.length() << " bytes, OK" << std::endl;
+
+  return 0;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+  osmscout::TypeConfigRef  typeConfig=std::make_shared<osmscout::TypeConfig>();
+  osmscout::TypeInfoRef    nodeType=std::make_shared<osmscout::TypeInfo>("test_node");
+  osmscout::TypeInfoRef    wayType=std::make_shared<osmscout::TypeInfo>("test_way");
+  osmscout::TypeInfoRef    areaType=std::make_shared<osmscout::TypeInfo>("test_area");
+  osmscout::Magnification  magnification;
+  osmscout::TileProjection projection;
+  int                      errors=0;
+
+  nodeType->CanBeNode(true);
+  nodeType->AddFeature(typeConfig->GetFeature(osmscout::NameFeature::NAME));
+  typeConfig->RegisterType(nodeType);
+
+  wayType->CanBeWay(true);
+  wayType->AddFeature(typeConfig->GetFeature(osmscout::NameFeature::NAME));
+  typeConfig->RegisterType(wayType);
+
+  areaType->CanBeArea(true);
+  areaType->AddFeature(typeConfig->GetFeature(osmscout::NameFeature::NAME));
+  typeConfig->RegisterType(areaType);
+
+  osmscout::VectorTileEncoder encoder(typeConfig);
+
+  encoder.SetExtent(EXTENT);
+  encoder.SetBuffer(BUFFER);
+  encoder.SetOptimizeMethod(osmscout::TransPolygon::none);
+
+  magnification.SetLevel(14);
+
+  // Same projection as used by the encoder, to place the objects at known tile coordinates
+  projection.Set(TILE_X,TILE_Y,
+                 magnification,
+                 96.0,
+                 EXTENT,
+                 EXTENT);
+
+  // Point, attributes and zigzag encoding of positive coordinates
+  osmscout::MapData nodeData;
+  osmscout::NodeRef node=std::make_shared<osmscout::Node>();
+
+  node->SetFeatures(GetFeatures(*typeConfig,nodeType,"A",0));
+  node->SetCoords(GetPoints(projection,{{10.0,20.0}})[0].GetCoord());
+  nodeData.nodes.push_back(node);
+
+  errors+=CheckTile("Node",encoder,magnification,nodeData,nodeTile,sizeof(nodeTile));
+
+  // Line clipped at the left and the upper border of the buffer, negative
+  // deltas and a negative layer
+  osmscout::MapData wayData;
+  osmscout::WayRef  way=std::make_shared<osmscout::Way>();
+
+  way->SetFeatures(GetFeatures(*typeConfig,wayType,"B",-1));
+  way->nodes=GetPoints(projection,{{-100.0,100.0},{100.0,100.0},{100.0,-100.0}});
+  wayData.ways.push_back(way);
+
+  errors+=CheckTile("Way",encoder,magnification,wayData,wayTile,sizeof(wayTile));
+
+  // Both rings are passed with the wrong winding order for vector tiles
+  osmscout::MapData    areaData;
+  osmscout::AreaRef    area=std::make_shared<osmscout::Area>();
+  osmscout::Area::Ring outerRing;
+  osmscout::Area::Ring innerRing;
+
+  outerRing.SetFeatures(GetFeatures(*typeConfig,areaType,"C",0));
+  outerRing.MarkAsOuterRing();
+  outerRing.nodes=GetPoints(projection,{{50.0,50.0},{50.0,150.0},{150.0,150.0},{150.0,50.0}});
+
+  innerRing.SetType(typeConfig->GetTypeInfo(0));
+  innerRing.SetRing(osmscout::Area::outerRingId+1);
+  innerRing.nodes=GetPoints(projection,{{80.0,80.0},{120.0,80.0},{120.0,120.0},{80.0,120.0}});
+
+  area->rings.push_back(outerRing);
+  area->rings.push_back(innerRing);
+  areaData.areas.push_back(area);
+
+  errors+=CheckTile("Area",encoder,magnification,areaData,areaTile,sizeof(areaTile));
+
+  // Polygon clipped at the right and the lower border of the buffer
+  osmscout::MapData    clippedAreaData;
+  osmscout::AreaRef    clippedArea=std::make_shared<osmscout::Area>();
+  osmscout::Area::Ring clippedRing;
+
+  clippedRing.SetFeatures(GetFeatures(*typeConfig,areaType,"",0));
+  clippedRing.MarkAsOuterRing();
+  clippedRing.nodes=GetPoints(projection,{{200.0,200.0},{300.0,200.0},{300.0,300.0},{200.0,300.0}});
+
+  clippedArea->rings.push_back(clippedRing);
+  clippedAreaData.areas.push_back(clippedArea);
+
+  errors+=CheckTile("Clipped area",encoder,magnification,clippedAreaData,clippedAreaTile,sizeof(clippedAreaTile));
+
+  // Nothing inside the tile
+  osmscout::MapData emptyData;
+  osmscout::NodeRef outsideNode=std::make_shared<osmscout::Node>();
+
+  outsideNode->SetFeatures(GetFeatures(*typeConfig,nodeType,"",0));
+  outsideNode->SetCoords(GetPoints(projection,{{-20.0,300.0}})[0].GetCoord());
+  emptyData.nodes.push_back(outsideNode);
+
+  errors+=CheckTile("Empty",encoder,magnification,emptyData,nodeTile,0);
+
+  if (errors>0) {
+    std::cerr << errors << " error(s)" << std::endl;
+    return 1;
+  }
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,184 @@
+/*
+  WorkerPool - a test program for libosmscout
+  Copyright (C) 2016  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <osmscout/util/WorkerPool.h>
+
+/**
+ * Tasks wait at the rendezvous, until the given number of tasks arrived
+ */
+struct Rendezvous
+{
+  std::mutex                mutex;
+  std::condition_variable   condition;
+  size_t                    count;
+  size_t                    arrived;
+  std::set<std::thread::id> threads;
+
+  explicit Rendezvous(size_t count)
+  : count(count),
+    arrived(0)
+  {
+    // no code
+  }
+
+  /**
+   * Returns false, if not all tasks arrived. The timeout only prevents
+   * the test from hanging and is not part of the check.
+   */
+  bool Arrive()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    threads.insert(std::this_thread::get_id());
+    arrived++;
+
+    condition.notify_all();
+
+    return condition.wait_for(lock,
+                              std::chrono::seconds(60),
+                              [this]{return arrived>=count;});
+  }
+};
+
+static int Work(int a, int b)
+{
+  return a+b;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+  size_t                        workerCount=4;
+  osmscout::WorkerPool          pool(workerCount);
+  std::vector<std::future<int>> futures;
+  int                           errors=0;
+
+  std::cout << "Pushing 64 groups of 5 tasks to " << pool.GetWorkerCount() << " workers..." << std::endl;
+
+  for (int i=0; i<64; i++) {
+    osmscout::WorkerTaskGroup group;
+
+    for (int j=0; j<5; j++) {
+      futures.push_back(group.Add<int>(std::bind(Work,i,j)));
+    }
+
+    pool.Push(group,
+              i%2==0 ? osmscout::WorkerPool::priorityNormal : osmscout::WorkerPool::priorityLow);
+  }
+
+  for (size_t i=0; i<futures.size(); i++) {
+    int expected=(int)(i/5+i%5);
+
+    if (futures[i].get()!=expected) {
+      std::cerr << "Wrong result for task #" << i << std::endl;
+      errors++;
+    }
+  }
+
+  std::cout << "Checking stealing..." << std::endl;
+
+  // All tasks of a group are queued at the same worker, each task waits until
+  // all other tasks are running, so the other workers must steal them
+  Rendezvous                     rendezvous(workerCount);
+  osmscout::WorkerTaskGroup      stealGroup;
+  std::vector<std::future<bool>> stealFutures;
+
+  for (size_t i=0; i<workerCount; i++) {
+    stealFutures.push_back(stealGroup.Add<bool>([&rendezvous]() {
+      return rendezvous.Arrive();
+    }));
+  }
+
+  pool.Push(stealGroup);
+
+  for (auto& future : stealFutures) {
+    if (!future.get()) {
+      std::cerr << "Tasks of a group were not processed in parallel" << std::endl;
+      errors++;
+      break;
+    }
+  }
+
+  if (rendezvous.threads.size()!=workerCount) {
+    std::cerr << "Tasks of a group were processed by " << rendezvous.threads.size() << " instead of " << workerCount << " workers" << std::endl;
+    errors++;
+  }
+
+  std::cout << "Checking priorities..." << std::endl;
+
+  // A single, blocked worker, so that the following groups are queued
+  osmscout::WorkerPool      singlePool(1);
+  osmscout::WorkerTaskGroup blockerGroup;
+  std::atomic<bool>         blocked(true);
+
+  blockerGroup.Add<int>([&blocked]() {
+    while (blocked) {
+      std::this_thread::yield();
+    }
+
+    return 0;
+  });
+
+  singlePool.Push(blockerGroup);
+
+  std::vector<int>              order;
+  std::vector<std::future<int>> priorityFutures;
+
+  for (int i=0; i<3; i++) {
+    osmscout::WorkerTaskGroup group;
+
+    priorityFutures.push_back(group.Add<int>([i,&order]() {
+      order.push_back(i);
+
+      return i;
+    }));
+
+    // Push in order low, normal, high
+    singlePool.Push(group,
+                    (osmscout::WorkerPool::Priority)(2-i));
+  }
+
+  blocked=false;
+
+  for (auto& future : priorityFutures) {
+    future.get();
+  }
+
+  if (order!=std::vector<int>{2,1,0}) {
+    std::cerr << "Tasks were not processed by priority" << std::endl;
+    errors++;
+  }
+
+  if (errors>0) {
+    std::cerr << errors << " error(s)" << std::endl;
+    return 1;
+  }
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
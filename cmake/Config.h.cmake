@@ -327,6 +327,11 @@
 #cmakedefine HAVE_LIB_ZLIB 1
 #endif
 
+/* libbz2 detected */
+#ifndef HAVE_LIB_BZIP2
+#cmakedefine HAVE_LIB_BZIP2 1
+#endif
+
 /* libagg detected */
 #ifndef HAVE_LIB_AGG
 #cmakedefine HAVE_LIB_AGG 1
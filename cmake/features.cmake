@@ -91,6 +91,7 @@ find_package(Marisa QUIET)
 find_package(LibXml2 QUIET)
 find_package(MyProtobuf QUIET) # Modified FindProtobuf
 find_package(ZLIB QUIET)
+find_package(BZip2 QUIET)
 find_package(PNG QUIET)
 find_package(Cairo QUIET)
 find_package(Agg QUIET)
@@ -126,6 +127,7 @@ set(HAVE_LIB_MARISA ${MARISA_FOUND})
 set(HAVE_LIB_XML ${LIBXML2_FOUND})
 set(HAVE_LIB_PROTOBUF ${PROTOBUF_FOUND})
 set(HAVE_LIB_ZLIB ${ZLIB_FOUND})
+set(HAVE_LIB_BZIP2 ${BZIP2_FOUND})
 set(HAVE_LIB_CAIRO ${CAIRO_FOUND})
 set(HAVE_LIB_AGG ${LIBAGG_FOUND})
 set(HAVE_LIB_FREETYPE ${FREETYPE_FOUND})
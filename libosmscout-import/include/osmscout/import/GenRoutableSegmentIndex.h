@@ -0,0 +1,109 @@
+#ifndef OSMSCOUT_IMPORT_GENROUTABLESEGMENTINDEX_H
+#define OSMSCOUT_IMPORT_GENROUTABLESEGMENTINDEX_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <osmscout/Point.h>
+#include <osmscout/RoutableSegmentIndex.h>
+
+#include <osmscout/import/Import.h>
+
+namespace osmscout {
+
+  /**
+   * Generates the index of the nodes of all segments of routable ways and
+   * areas (see RoutableSegmentIndex for a description of the generated data).
+   *
+   * Entries are collected in a buffer limited by the sort memory budget.
+   * If the buffer is full, it is sorted by cell and written to a temporary
+   * run file. All runs are merged while writing the index.
+   */
+  class RoutableSegmentIndexGenerator : public ImportModule
+  {
+  public:
+    //! Magnification level defining the cell size of the index
+    static const uint32_t CELL_LEVEL=14;
+    //! Maximum number of runs merged at once
+    static const size_t   MAX_MERGE_RUNS=64;
+
+  private:
+    typedef RoutableSegmentIndex::Entry Entry;
+
+    /**
+     * An entry together with the cell it belongs to
+     */
+    struct CellEntry
+    {
+      uint32_t y;
+      uint32_t x;
+      Entry    entry;
+    };
+
+    /**
+     * A sorted run of entries in a temporary file
+     */
+    struct Run
+    {
+      std::string filename;
+      size_t      count;
+    };
+
+    typedef std::function<void(const CellEntry&)> CellEntryConsumer;
+
+  private:
+    void AddObject(std::vector<CellEntry>& buffer,
+                   const std::vector<Point>& nodes,
+                   FileOffset offset,
+                   RefType type,
+                   VehicleMask vehicles,
+                   bool closed) const;
+
+    void SortBuffer(std::vector<CellEntry>& buffer) const;
+
+    Run WriteRun(const std::string& filename,
+                 const std::vector<CellEntry>& buffer) const;
+
+    void MergeRuns(const std::vector<Run>& runs,
+                   size_t bufferSize,
+                   const CellEntryConsumer& consumer) const;
+
+    bool WriteIndex(const ImportParameter& parameter,
+                    Progress& progress,
+                    std::vector<CellEntry>& buffer,
+                    std::vector<Run>& runs,
+                    std::vector<std::string>& runFilenames,
+                    size_t& cellCount,
+                    size_t& entryCount) const;
+
+  public:
+    void GetDescription(const ImportParameter& parameter,
+                        ImportModuleDescription& description) const;
+
+    bool Import(const TypeConfigRef& typeConfig,
+                const ImportParameter& parameter,
+                Progress& progress);
+  };
+}
+
+#endif
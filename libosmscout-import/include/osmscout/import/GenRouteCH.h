@@ -0,0 +1,128 @@
+#ifndef OSMSCOUT_IMPORT_GENROUTECH_H
+#define OSMSCOUT_IMPORT_GENROUTECH_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <vector>
+
+#include <osmscout/RouteContractionHierarchy.h>
+#include <osmscout/RouteNode.h>
+#include <osmscout/RoutingProfile.h>
+
+#include <osmscout/import/Import.h>
+
+namespace osmscout {
+
+  /**
+   * Generates a contraction hierarchy for every vehicle of every router
+   * (see RouteContractionHierarchy for a description of the generated data).
+   *
+   * Nodes are contracted in the order of their edge difference (number of
+   * shortcuts that have to be added minus the number of edges removed)
+   * plus the number of already contracted neighbours. Shortcuts are only
+   * added if a local witness search does not find a path that is at least as
+   * cheap as the path over the contracted node.
+   */
+  class RouteContractionHierarchyGenerator : public ImportModule
+  {
+  private:
+    typedef RouteContractionHierarchy::Edge    Edge;
+    typedef RouteContractionHierarchy::Exclude Exclude;
+
+    struct Node
+    {
+      FileOffset            offset;       //!< FileOffset of the route node
+      std::vector<Exclude>  excludes;     //!< Turn restrictions at this node
+      std::vector<uint32_t> in;           //!< Incoming edges from not yet contracted nodes
+      std::vector<uint32_t> out;          //!< Outgoing edges to not yet contracted nodes
+      std::vector<uint32_t> forward;      //!< Outgoing edges to more important nodes
+      std::vector<uint32_t> backward;     //!< Incoming edges from more important nodes
+      uint32_t              contractedNeighbours;
+      bool                  core;         //!< Node must not be contracted
+      bool                  contracted;
+
+      Node()
+      : offset(0),
+        contractedNeighbours(0),
+        core(false),
+        contracted(false)
+      {
+        // no code
+      }
+    };
+
+    struct Shortcut
+    {
+      uint32_t from;
+      uint32_t to;
+      uint32_t firstChild;
+      uint32_t secondChild;
+    };
+
+  private:
+    std::vector<Node>     nodes;
+    std::vector<Edge>     edges;
+
+    // Data of the witness search, reused between searches
+    std::vector<double>   witnessCost;
+    std::vector<uint32_t> witnessTouched;
+
+  private:
+    RoutingProfileRef CreateProfile(const TypeConfigRef& typeConfig,
+                                    const ImportParameter& parameter,
+                                    Progress& progress,
+                                    Vehicle vehicle) const;
+
+    bool LoadGraph(const ImportParameter& parameter,
+                   Progress& progress,
+                   const std::string& dataFilename,
+                   const std::vector<ObjectVariantData>& objectVariantData,
+                   const RoutingProfile& profile);
+
+    void AddEdge(const Edge& edge);
+    void RemoveEdge(std::vector<uint32_t>& edgeList,
+                    uint32_t edge) const;
+
+    void WitnessSearch(uint32_t source,
+                       uint32_t ignoredNode,
+                       double maxCost);
+
+    void GetShortcuts(uint32_t node,
+                      std::vector<Shortcut>& shortcuts);
+    int GetPriority(uint32_t node);
+    void ContractNode(uint32_t node);
+    void Contract(Progress& progress);
+
+    bool WriteHierarchy(Progress& progress,
+                        const std::string& filename,
+                        Vehicle vehicle,
+                        const std::vector<double>& variantCosts) const;
+
+  public:
+    void GetDescription(const ImportParameter& parameter,
+                        ImportModuleDescription& description) const;
+
+    bool Import(const TypeConfigRef& typeConfig,
+                const ImportParameter& parameter,
+                Progress& progress);
+  };
+}
+
+#endif
@@ -38,7 +38,6 @@
 #include <osmscout/ObjectRef.h>
 
 #include <osmscout/util/FileWriter.h>
-#include <osmscout/util/NodeUseMap.h>
 
 #include <osmscout/import/Import.h>
 
@@ -68,7 +67,10 @@ namespace osmscout {
     };
 
     typedef std::unordered_map<Id, FileOffset>             NodeIdOffsetMap;
-    typedef std::map<Id,std::list<ObjectFileRef> >         NodeIdObjectsMap;
+    typedef std::pair<Id,std::vector<ObjectFileRef> >      NodeIdObjects;
+    typedef std::vector<NodeIdObjects>                     NodeIdObjectsList;          //!< Sorted by node id
+    typedef std::vector<std::pair<OSMId,FileOffset> >      OSMIdOffsetList;            //!< Sorted by OSM id
+    typedef std::vector<std::pair<OSMId,Id> >              OSMIdIdList;                //!< Sorted by OSM id
     typedef std::map<Id,std::list<PendingOffset> >         PendingRouteNodeOffsetsMap;
     typedef std::map<Id,std::vector<TurnRestrictionData> > ViaTurnRestrictionMap;
 
@@ -100,40 +102,40 @@ namespace osmscout {
                                             uint8_t grade);
 
     bool IsAnyRoutable(Progress& progress,
-                       const std::list<ObjectFileRef>& objects,
+                       const std::vector<ObjectFileRef>& objects,
                        const std::unordered_map<FileOffset,WayRef>& waysMap,
                        const std::unordered_map<FileOffset,AreaRef>&  areasMap,
                        VehicleMask vehicles) const;
 
     /**
-     * Read turn restrictions and return a map of OSM way ids and OSM node ids together with their (set to 0) file offset
+     * Read turn restrictions and return a list of OSM way ids and OSM node ids together with their (set to 0) file offset
      */
     bool ReadTurnRestrictionIds(const ImportParameter& parameter,
                                 Progress& progress,
-                                std::map<OSMId,FileOffset>& wayIdOffsetMap,
-                                std::map<OSMId,Id>& nodeMap);
+                                OSMIdOffsetList& wayIdOffsetList,
+                                OSMIdIdList& nodeIdList);
 
     /**
-     * Resove the file offsets for the way ids given in the wayIdOffsetMap
+     * Resove the file offsets for the way ids given in the wayIdOffsetList
      */
     bool ResolveWayIds(const ImportParameter& parameter,
                        Progress& progress,
-                       std::map<OSMId,FileOffset>& wayIdOffsetMap);
+                       OSMIdOffsetList& wayIdOffsetList);
 
     /**
-     * Resove the node ids from the OSM node ids given in the nodeIdMap
+     * Resove the node ids from the OSM node ids given in the nodeIdList
      */
     bool ResolveNodeIds(const ImportParameter& parameter,
                         Progress& progress,
-                        std::map<OSMId,Id>& nodeIdMap);
+                        OSMIdIdList& nodeIdList);
 
     /**
-     * Red the turn restriction again using the "way id to file offset" map and create a ViaTurnRestrictionMap.
+     * Red the turn restriction again using the "way id to file offset" list and create a ViaTurnRestrictionMap.
      */
     bool ReadTurnRestrictionData(const ImportParameter& parameter,
                                  Progress& progress,
-                                 const std::map<OSMId,Id>& nodeIdMap,
-                                 const std::map<OSMId,FileOffset>& wayIdOffsetMap,
+                                 const OSMIdIdList& nodeIdList,
+                                 const OSMIdOffsetList& wayIdOffsetList,
                                  ViaTurnRestrictionMap& restrictions);
 
     /**
@@ -153,12 +155,12 @@ namespace osmscout {
                  FileOffset to) const;
 
     /**
-     * Reads all relevant ways and areas and returns all nodes where these intersect.
+     * Reads all relevant ways and areas and returns the sorted ids of all nodes where these intersect.
      */
     bool ReadIntersections(const ImportParameter& parameter,
                            Progress& progress,
                            const TypeConfig& typeConfig,
-                           NodeUseMap& nodeUseMap);
+                           std::vector<Id>& junctionIds);
 
     /**
      * Builds up a list of ObjectFileRefs for every junction node.
@@ -166,12 +168,12 @@ namespace osmscout {
     bool ReadObjectsAtIntersections(const ImportParameter& parameter,
                                     Progress& progress,
                                     const TypeConfig& typeConfig,
-                                    const NodeUseMap& nodeUseMap,
-                                    NodeIdObjectsMap& nodeObjectsMap);
+                                    const std::vector<Id>& junctionIds,
+                                    NodeIdObjectsList& nodeObjectsList);
 
     bool WriteIntersections(const ImportParameter& parameter,
                             Progress& progress,
-                            NodeIdObjectsMap& nodeIdObjectsMap);
+                            NodeIdObjectsList& nodeIdObjectsList);
 
     /**
      * Loads ways based on their file offset.
@@ -179,7 +181,7 @@ namespace osmscout {
     bool LoadWays(const TypeConfig& typeConfig,
                   Progress& progress,
                   FileScanner& scanner,
-                  const std::set<FileOffset>& fileOffsets,
+                  const std::vector<FileOffset>& fileOffsets,
                   std::unordered_map<FileOffset,WayRef>& waysMap);
 
     /**
@@ -188,12 +190,12 @@ namespace osmscout {
     bool LoadAreas(const TypeConfig& typeConfig,
                    Progress& progress,
                    FileScanner& scanner,
-                   const std::set<FileOffset>& fileOffsets,
+                   const std::vector<FileOffset>& fileOffsets,
                    std::unordered_map<FileOffset,AreaRef>& areasMap);
 
     bool GetRouteNodePoint(Progress& progress,
                            Id id,
-                           const std::list<ObjectFileRef>& objects,
+                           const std::vector<ObjectFileRef>& objects,
                            std::unordered_map<FileOffset,WayRef>& waysMap,
                            std::unordered_map<FileOffset,AreaRef>& areasMap,
                            Point& point) const;
@@ -211,7 +213,7 @@ namespace osmscout {
                             const Area& area,
                             uint16_t objectVariantIndex,
                             FileOffset routeNodeOffset,
-                            const NodeIdObjectsMap& nodeObjectsMap,
+                            const NodeIdObjectsList& nodeObjectsList,
                             const NodeIdOffsetMap& nodeIdOffsetMap,
                             PendingRouteNodeOffsetsMap& pendingOffsetsMap);
 
@@ -222,7 +224,7 @@ namespace osmscout {
                                    const Way& way,
                                    uint16_t objectVariantIndex,
                                    FileOffset routeNodeOffset,
-                                   const NodeIdObjectsMap& nodeObjectsMap,
+                                   const NodeIdObjectsList& nodeObjectsList,
                                    const NodeIdOffsetMap& nodeIdOffsetMap,
                                    PendingRouteNodeOffsetsMap& pendingOffsetsMap);
 
@@ -233,7 +235,7 @@ namespace osmscout {
                            const Way& way,
                            uint16_t objectVariantIndex,
                            FileOffset routeNodeOffset,
-                           const NodeIdObjectsMap& nodeObjectsMap,
+                           const NodeIdObjectsList& nodeObjectsList,
                            const NodeIdOffsetMap& nodeIdOffsetMap,
                            PendingRouteNodeOffsetsMap& pendingOffsetsMap);
 
@@ -241,7 +243,7 @@ namespace osmscout {
      * Adds the result of the turn restriction evaluation to the route node.
      */
     void FillRoutePathExcludes(RouteNode& routeNode,
-                               const std::list<ObjectFileRef>& objects,
+                               const std::vector<ObjectFileRef>& objects,
                                const ViaTurnRestrictionMap& restrictions);
 
     /**
@@ -252,7 +254,7 @@ namespace osmscout {
                               const NodeIdOffsetMap& routeNodeIdOffsetMap,
                               PendingRouteNodeOffsetsMap& pendingOffsetsMap,
                               FileWriter& routeNodeWriter,
-                              const std::vector<NodeIdObjectsMap::const_iterator>& block,
+                              const std::vector<NodeIdObjectsList::const_iterator>& block,
                               size_t blockCount);
 
     bool WriteObjectVariantData(Progress& progress,
@@ -262,12 +264,18 @@ namespace osmscout {
     bool WriteRouteGraph(const ImportParameter& parameter,
                          Progress& progress,
                          const TypeConfig& typeConfig,
-                         const NodeIdObjectsMap& nodeObjectsMap,
+                         const NodeIdObjectsList& nodeObjectsList,
                          const ViaTurnRestrictionMap& restrictions,
                          VehicleMask vehicles,
                          const std::string& dataFilename,
                          const std::string& variantFilename);
 
+    bool WriteCompactRouteGraph(Progress& progress,
+                                VehicleMask vehicleMask,
+                                const std::string& dataFilename,
+                                const std::string& variantFilename,
+                                const std::string& compactFilename);
+
   public:
     RouteDataGenerator();
 
@@ -21,6 +21,7 @@
 */
 
 #include <list>
+#include <map>
 #include <mutex>
 #include <string>
 
@@ -103,11 +104,13 @@ namespace osmscout {
     bool                         strictAreas;              //<! Assure that areas conform to "simple" definition
 
     bool                         sortObjects;              //<! Sort all objects
-    size_t                       sortBlockSize;            //<! Number of entries loaded in one sort iteration
+    size_t                       sortMemoryBudget;         //<! Maximum number of bytes used for buffering objects while sorting
     size_t                       sortTileMag;              //<! Zoom level for individual sorting cells
 
     size_t                       numericIndexPageSize;     //<! Size of an numeric index page in bytes
 
+    size_t                       processingQueueSize;      //<! Maximum number of blocks in flight while parsing the import files
+
     size_t                       rawCoordBlockSize;        //<! Number of raw coords loaded during import in one go
 
     bool                         rawNodeDataMemoryMaped;   //<! Use memory mapping for raw node data file access
@@ -118,6 +121,7 @@ namespace osmscout {
     size_t                       rawWayBlockSize;          //<! Number of ways loaded during import until nodes get resolved
 
     bool                         coordDataMemoryMaped;     //<! Use memory mapping for coord data file access
+    bool                         coordDataDense;           //<! Store coordinates in a dense array indexed by node id
     size_t                       coordIndexCacheSize;      //<! Size of the coord index cache
     size_t                       coordBlockSize;           //<! Maximum number of node ids we resolve in one go
 
@@ -148,6 +152,12 @@ namespace osmscout {
     TransPolygon::OptimizeMethod optimizationWayMethod;    //<! what method to use to optimize ways
 
     size_t                       routeNodeBlockSize;       //<! Number of route nodes loaded during import until ways get resolved
+    size_t                       routeNodeMemoryBudget;    //<! Maximum number of bytes used for buffering node ids while collecting route nodes
+    bool                         routeCompactGraph;        //<! Generate a compact (CSR) copy of the routing graphs
+    bool                         routeContractionHierarchy; //<! Generate contraction hierarchies for the routing graphs
+    std::map<std::string,double> routeContractionHierarchyCarSpeeds; //<! Speed table used to generate the car contraction hierarchy
+    double                       routeContractionHierarchyCarMaxSpeed; //<! Maximum car speed used to generate the car contraction hierarchy
+    bool                         routeSegmentIndex;        //<! Generate the index of routable segments for finding the closest routable node
 
     bool                         assumeLand;               //<! During sea/land detection,we either trust coastlines only or make some
                                                            //<! assumptions which tiles are sea and which are land.
@@ -174,11 +184,13 @@ namespace osmscout {
     bool GetStrictAreas() const;
 
     bool GetSortObjects() const;
-    size_t GetSortBlockSize() const;
+    size_t GetSortMemoryBudget() const;
     size_t GetSortTileMag() const;
 
     size_t GetNumericIndexPageSize() const;
 
+    size_t GetProcessingQueueSize() const;
+
     size_t GetRawCoordBlockSize() const;
 
     bool GetRawNodeDataMemoryMaped() const;
@@ -189,6 +201,7 @@ namespace osmscout {
     size_t GetRawWayBlockSize() const;
 
     bool GetCoordDataMemoryMaped() const;
+    bool GetCoordDataDense() const;
     size_t GetCoordIndexCacheSize() const;
 
     size_t GetCoordBlockSize() const;
@@ -220,6 +233,12 @@ namespace osmscout {
     TransPolygon::OptimizeMethod GetOptimizationWayMethod() const;
 
     size_t GetRouteNodeBlockSize() const;
+    size_t GetRouteNodeMemoryBudget() const;
+    bool GetRouteCompactGraph() const;
+    bool GetRouteContractionHierarchy() const;
+    const std::map<std::string,double>& GetRouteContractionHierarchyCarSpeeds() const;
+    double GetRouteContractionHierarchyCarMaxSpeed() const;
+    bool GetRouteSegmentIndex() const;
 
     bool GetAssumeLand() const;
       
@@ -242,11 +261,13 @@ namespace osmscout {
     void SetStrictAreas(bool strictAreas);
 
     void SetSortObjects(bool sortObjects);
-    void SetSortBlockSize(size_t sortBlockSize);
+    void SetSortMemoryBudget(size_t sortMemoryBudget);
     void SetSortTileMag(size_t sortTileMag);
 
     void SetNumericIndexPageSize(size_t numericIndexPageSize);
 
+    void SetProcessingQueueSize(size_t processingQueueSize);
+
     void SetRawCoordBlockSize(size_t blockSize);
 
     void SetRawNodeDataMemoryMaped(bool memoryMaped);
@@ -259,6 +280,7 @@ namespace osmscout {
     void SetRawWayBlockSize(size_t blockSize);
 
     void SetCoordDataMemoryMaped(bool memoryMaped);
+    void SetCoordDataDense(bool coordDataDense);
     void SetCoordIndexCacheSize(size_t coordIndexCacheSize);
     void SetCoordBlockSize(size_t coordBlockSize);
 
@@ -289,6 +311,12 @@ namespace osmscout {
     void SetOptimizationWayMethod(TransPolygon::OptimizeMethod optimizationWayMethod);
 
     void SetRouteNodeBlockSize(size_t blockSize);
+    void SetRouteNodeMemoryBudget(size_t routeNodeMemoryBudget);
+    void SetRouteCompactGraph(bool routeCompactGraph);
+    void SetRouteContractionHierarchy(bool routeContractionHierarchy);
+    void SetRouteContractionHierarchyCarSpeeds(const std::map<std::string,double>& speeds,
+                                               double maxSpeed);
+    void SetRouteSegmentIndex(bool routeSegmentIndex);
 
     void SetAssumeLand(bool assumeLand);
 
@@ -20,14 +20,87 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
 */
 
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <osmscout/Types.h>
+
+#include <osmscout/util/WorkQueue.h>
+
 #include <osmscout/import/Preprocessor.h>
 
 namespace osmscout {
 
+  class OSMFileReader;
+
+  /**
+   * Parser for *.osm files (optionally compressed using gzip or bzip2).
+   *
+   * The file is read (and decompressed) by a separate thread. The calling thread
+   * splits the data at the boundaries of the top level elements (nodes, ways and
+   * relations) into chunks. The chunks are parsed in parallel by a number of
+   * worker threads (one for each core). The resulting blocks are passed
+   * to the PreprocessorCallback by a separate delivery thread in the order of the
+   * file, so the result is identical to parsing the file sequentially.
+   *
+   * The number of chunks in flight is limited by
+   * ImportParameter::GetProcessingQueueSize().
+   */
   class PreprocessOSM : public Preprocessor
   {
+  private:
+    /**
+     * The blocks of a parsed chunk together with the warnings and errors of the
+     * parser, which are reported by the delivery thread in the order of the file
+     */
+    struct ParsedChunk
+    {
+      std::vector<PreprocessorCallback::RawBlockDataRef> blocks;
+      std::vector<std::string>                           warnings;
+      std::vector<std::string>                           errors;
+      bool                                               success;  //!< False, if the chunk is not valid XML
+
+      ParsedChunk()
+      : success(false)
+      {
+        // no code
+      }
+    };
+
+    typedef std::shared_ptr<ParsedChunk>                       ParsedChunkRef;
+
+    typedef WorkQueue<ParsedChunkRef>                          ChunkWorkerQueue;
+    typedef WorkQueue<void>                                    DeliveryQueue;
+
   private:
     PreprocessorCallback& callback;
+    std::atomic<bool>     deliveryError;      //!< Delivery of a block failed, stop reading
+    std::string           deliveryErrorMessage;
+
+  private:
+    static ParsedChunkRef ParseChunk(const TypeConfigRef& typeConfig,
+                                     const std::string& filename,
+                                     std::shared_ptr<const std::string> header,
+                                     std::shared_ptr<const std::string> chunk,
+                                     const std::string& closingTag);
+
+    void DeliverBlocks(Progress& progress,
+                       const std::string& filename,
+                       std::shared_future<ParsedChunkRef> chunk);
+
+    static void ChunkWorkerLoop(ChunkWorkerQueue& queue);
+    static void DeliveryLoop(DeliveryQueue& queue);
+
+    bool ReadChunks(const TypeConfigRef& typeConfig,
+                    Progress& progress,
+                    const std::string& filename,
+                    OSMFileReader& reader,
+                    FileOffset fileSize,
+                    ChunkWorkerQueue& chunkWorkerQueue,
+                    DeliveryQueue& deliveryQueue);
 
   public:
     PreprocessOSM(PreprocessorCallback& callback);
@@ -20,13 +20,16 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
 */
 
+#include <atomic>
 #include <future>
+#include <memory>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 #include <osmscout/Types.h>
 
+#include <osmscout/util/WorkQueue.h>
+
 #include <osmscout/import/RawRelation.h>
 
 #include <osmscout/import/Preprocessor.h>
@@ -36,15 +39,34 @@
 
 namespace osmscout {
 
+  /**
+   * Parser for *.osm.pbf files.
+   *
+   * Parsing is done in a pipeline: The calling thread reads the raw (compressed)
+   * blobs from the file. A number of worker threads (one for each core) decompress
+   * and parse the blobs and convert the primitive blocks to RawBlockData.
+   * A separate delivery thread passes the resulting blocks to the
+   * PreprocessorCallback in the order of the file, so that the sorting of the
+   * objects (which is checked by the callback) is kept.
+   *
+   * The number of blocks in flight is limited by
+   * ImportParameter::GetProcessingQueueSize().
+   */
   class PreprocessPBF : public Preprocessor
   {
+  private:
+    //! Raw (still compressed) blob data as read from the file
+    typedef std::shared_ptr<std::string>                     BlobDataRef;
+
+    typedef WorkQueue<PreprocessorCallback::RawBlockDataRef> BlockWorkerQueue;
+    typedef WorkQueue<void>                                  DeliveryQueue;
+
   private:
     char                             *buffer;
     google::protobuf::int32          bufferSize;
     PreprocessorCallback&            callback;
-    TagMap                           tagMap;
-    std::vector<OSMId>               nodes;
-    std::vector<RawRelation::Member> members;
+    std::atomic<bool>                deliveryError;      //!< Delivery of a block failed, stop reading
+    std::string                      deliveryErrorMessage;
 
   private:
     bool GetPos(FILE* file,
@@ -62,33 +84,51 @@ namespace osmscout {
                          const PBF::BlockHeader& blockHeader,
                          PBF::HeaderBlock& headerBlock);
 
-    bool ReadPrimitiveBlock(Progress& progress,
-                            FILE* file,
-                            const PBF::BlockHeader& blockHeader,
-                            PBF::PrimitiveBlock& primitiveBlock);
-
-    void ReadNodes(const TypeConfig& typeConfig,
-                   const PBF::PrimitiveBlock& block,
-                   const PBF::PrimitiveGroup &group,
-                   PreprocessorCallback::RawBlockData& data);
-
-    void ReadDenseNodes(const TypeConfig& typeConfig,
-                        const PBF::PrimitiveBlock& block,
-                        const PBF::PrimitiveGroup &group,
-                        PreprocessorCallback::RawBlockData& data);
-
-    void ReadWays(const TypeConfig& typeConfig,
-                  const PBF::PrimitiveBlock& block,
-                  const PBF::PrimitiveGroup &group,
-                  PreprocessorCallback::RawBlockData& data);
-
-    void ReadRelations(const TypeConfig& typeConfig,
-                       const PBF::PrimitiveBlock& block,
-                       const PBF::PrimitiveGroup &group,
-                       PreprocessorCallback::RawBlockData& data);
-
-    void ProcessBlock(const TypeConfigRef& typeConfig,
-                      std::unique_ptr<PBF::PrimitiveBlock>&& block);
+    bool ReadBlob(Progress& progress,
+                  FILE* file,
+                  const PBF::BlockHeader& blockHeader,
+                  std::string& data);
+
+    static bool DecodeBlob(const std::string& data,
+                           std::string& content,
+                           std::string& error);
+
+    static void ReadNodes(const TypeConfig& typeConfig,
+                          const PBF::PrimitiveBlock& block,
+                          const PBF::PrimitiveGroup &group,
+                          PreprocessorCallback::RawBlockData& data);
+
+    static void ReadDenseNodes(const TypeConfig& typeConfig,
+                               const PBF::PrimitiveBlock& block,
+                               const PBF::PrimitiveGroup &group,
+                               PreprocessorCallback::RawBlockData& data);
+
+    static void ReadWays(const TypeConfig& typeConfig,
+                         const PBF::PrimitiveBlock& block,
+                         const PBF::PrimitiveGroup &group,
+                         PreprocessorCallback::RawBlockData& data);
+
+    static void ReadRelations(const TypeConfig& typeConfig,
+                              const PBF::PrimitiveBlock& block,
+                              const PBF::PrimitiveGroup &group,
+                              PreprocessorCallback::RawBlockData& data);
+
+    static PreprocessorCallback::RawBlockDataRef DecodeBlock(const TypeConfigRef& typeConfig,
+                                                             const std::string& filename,
+                                                             BlobDataRef blobData);
+
+    void DeliverBlock(std::shared_future<PreprocessorCallback::RawBlockDataRef> blockData);
+
+    static void BlockWorkerLoop(BlockWorkerQueue& queue);
+    static void DeliveryLoop(DeliveryQueue& queue);
+
+    bool ReadBlocks(const TypeConfigRef& typeConfig,
+                    Progress& progress,
+                    const std::string& filename,
+                    FILE* file,
+                    FileOffset fileSize,
+                    BlockWorkerQueue& blockWorkerQueue,
+                    DeliveryQueue& deliveryQueue);
 
   public:
     PreprocessPBF(PreprocessorCallback& callback);
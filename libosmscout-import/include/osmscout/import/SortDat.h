@@ -20,16 +20,26 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
 */
 
+#include <algorithm>
+#include <functional>
+#include <future>
 #include <list>
 #include <memory>
+#include <queue>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include <osmscout/import/Import.h>
 
 #include <osmscout/DataFile.h>
 #include <osmscout/ObjectRef.h>
 
+#include <osmscout/util/File.h>
+#include <osmscout/util/FileScanner.h>
 #include <osmscout/util/FileWriter.h>
+#include <osmscout/util/WorkQueue.h>
+
 #include <osmscout/system/Math.h>
 
 namespace osmscout {
@@ -46,34 +56,170 @@ namespace osmscout {
       FileScanner scanner;
     };
 
-    struct CellEntry
+    /**
+     * Sort criteria of an object. Objects are sorted by their cell, then by
+     * the hash of their top left coordinate and finally by their position
+     * in the sources, to make sorting stable.
+     */
+    struct SortKey
+    {
+      uint64_t cellIndex;
+      Id       sortId;
+      uint64_t sequence;
+
+      inline bool operator<(const SortKey& other) const
+      {
+        if (cellIndex!=other.cellIndex) {
+          return cellIndex<other.cellIndex;
+        }
+
+        if (sortId!=other.sortId) {
+          return sortId<other.sortId;
+        }
+
+        return sequence<other.sequence;
+      }
+    };
+
+    /**
+     * An object in a sort buffer
+     */
+    struct SortEntry
+    {
+      SortKey key;
+      size_t  dataOffset; //!< Offset of the raw object data in the buffer
+      size_t  dataLength; //!< Length of the raw object data
+
+      inline bool operator<(const SortEntry& other) const
+      {
+        return key<other.key;
+      }
+    };
+
+    /**
+     * Objects collected in memory, before they get sorted and written to a run
+     */
+    struct SortBuffer
+    {
+      std::vector<SortEntry> entries;
+      std::vector<char>      data;    //!< The raw data of all objects
+
+      /**
+       * Makes room for one more object with the given length of raw data.
+       * The buffer grows geometrically, but its capacity never exceeds the
+       * given budget. An empty buffer always accepts the object.
+       *
+       * @return false, if the object does not fit into the budget
+       */
+      bool Reserve(size_t dataLength,
+                   size_t budget)
+      {
+        size_t entriesSize=(entries.size()+1)*sizeof(SortEntry);
+        size_t dataSize=data.size()+dataLength;
+        size_t entriesCapacity=entries.capacity()*sizeof(SortEntry);
+        size_t dataCapacity=data.capacity();
+        bool   growEntries=entriesSize>entriesCapacity;
+        bool   growData=dataSize>dataCapacity;
+
+        if (!growEntries &&
+            !growData) {
+          return true;
+        }
+
+        entriesCapacity=std::max(entriesCapacity,entriesSize);
+        dataCapacity=std::max(dataCapacity,dataSize);
+
+        if (!entries.empty() &&
+            entriesCapacity+dataCapacity>budget) {
+          return false;
+        }
+
+        size_t free=budget>entriesCapacity+dataCapacity ? budget-entriesCapacity-dataCapacity : 0;
+
+        if (growEntries) {
+          size_t grow=std::min(entriesCapacity,growData ? free/2 : free);
+
+          entriesCapacity+=grow;
+          free-=grow;
+        }
+
+        if (growData) {
+          dataCapacity+=std::min(dataCapacity,free);
+        }
+
+        entries.reserve(entriesCapacity/sizeof(SortEntry));
+        data.reserve(dataCapacity);
+
+        return true;
+      }
+    };
+
+    typedef std::shared_ptr<SortBuffer> SortBufferRef;
+
+    /**
+     * A temporary file holding a sorted sequence of objects
+     */
+    struct Run
+    {
+      std::string filename;
+      uint64_t    entryCount;
+    };
+
+    /**
+     * An object read back from a run
+     */
+    struct MergeEntry
     {
-      uint8_t                              type;
-      Id                                   id;
-      typename std::list<Source>::iterator source;
-      FileOffset                           fileOffset;
-      Id                                   sortId;
-
-      inline CellEntry(uint8_t type,
-                       Id id,
-                       const typename std::list<Source>::iterator source,
-                       FileOffset fileOffset,
-                       Id sortId)
-      : type(type),
-        id(id),
-        source(source),
-        fileOffset(fileOffset),
-        sortId(sortId)
+      SortKey key;
+      uint8_t type;
+      Id      id;
+      N       data;
+    };
+
+    typedef std::vector<MergeEntry>     MergeBatch;
+    typedef std::shared_ptr<MergeBatch> MergeBatchRef;
+
+    /**
+     * Reads a run in batches. The next batch is read asynchronously while
+     * the current batch gets merged.
+     */
+    class RunReader
+    {
+    private:
+      const TypeConfig&          typeConfig;
+      FileScanner                scanner;
+      uint64_t                   remaining;
+      size_t                     batchSize;
+      MergeBatchRef              batch;
+      size_t                     current;
+      std::future<MergeBatchRef> nextBatch;
+
+    private:
+      MergeBatchRef ReadBatch();
+      void StartPrefetch();
+
+    public:
+      RunReader(const TypeConfig& typeConfig,
+                const Run& run,
+                size_t batchSize);
+      ~RunReader();
+
+      inline bool HasEntry() const
       {
-        // no code
+        return current<batch->size();
       }
 
-      inline bool operator<(const CellEntry& other) const
+      inline MergeEntry& GetEntry()
       {
-        return sortId<other.sortId;
+        return (*batch)[current];
       }
+
+      void Next();
+      void Close();
     };
 
+    typedef std::function<bool(MergeEntry& entry)> MergeCallback;
+
   public:
     class ProcessingFilter
     {
@@ -109,6 +255,37 @@ namespace osmscout {
     std::list<ProcessingFilterRef> filters;
 
   private:
+    SortKey GetSortKey(const N& data,
+                       size_t zoomLevel,
+                       uint64_t sequence);
+
+    static Run WriteRun(const TypeConfig& typeConfig,
+                        SortBufferRef buffer,
+                        const std::string& filename);
+    static void SortWorkerLoop(WorkQueue<Run>& queue);
+
+    bool GenerateRuns(const TypeConfig& typeConfig,
+                      const ImportParameter& parameter,
+                      Progress& progress,
+                      uint32_t& overallDataCount,
+                      SortBufferRef& buffer,
+                      std::vector<Run>& runs);
+    bool MergeRuns(const TypeConfig& typeConfig,
+                   const ImportParameter& parameter,
+                   Progress& progress,
+                   const std::vector<Run>& runs,
+                   uint64_t entryCount,
+                   const MergeCallback& callback);
+
+    bool WriteEntry(const TypeConfig& typeConfig,
+                    Progress& progress,
+                    FileWriter& dataWriter,
+                    FileWriter& mapWriter,
+                    uint8_t type,
+                    Id id,
+                    N& data,
+                    uint32_t& dataCopiedCount);
+
     bool Renumber(const TypeConfig& typeConfig,
                   const ImportParameter& parameter,
                   Progress& progress);
@@ -176,211 +353,660 @@ namespace osmscout {
   }
 
   template <class N>
-  bool SortDataGenerator<N>::Renumber(const TypeConfig& typeConfig,
-                                      const ImportParameter& parameter,
-                                      Progress& progress)
+  SortDataGenerator<N>::RunReader::RunReader(const TypeConfig& typeConfig,
+                                             const Run& run,
+                                             size_t batchSize)
+  : typeConfig(typeConfig),
+    remaining(run.entryCount),
+    batchSize(batchSize),
+    batch(std::make_shared<MergeBatch>()),
+    current(0)
   {
-    FileWriter dataWriter;
-    FileWriter mapWriter;
-    uint32_t   overallDataCount=0;
-    uint32_t   dataCopiedCount=0;
-    size_t     zoomLevel=Pow(2,parameter.GetSortTileMag());
-    size_t     cellCount=zoomLevel*zoomLevel;
-    size_t     minIndex=0;
-    size_t     maxIndex=cellCount-1;
+    scanner.Open(run.filename,
+                 FileScanner::Sequential,
+                 false);
 
-    progress.SetAction("Sorting data");
+    batch=ReadBatch();
+
+    StartPrefetch();
+  }
+
+  template <class N>
+  SortDataGenerator<N>::RunReader::~RunReader()
+  {
+    Close();
+  }
+
+  /**
+   * Reads the next entries from the run, until either the batch size is reached
+   * or the run is completely read.
+   *
+   * @throws IOException
+   */
+  template <class N>
+  typename SortDataGenerator<N>::MergeBatchRef SortDataGenerator<N>::RunReader::ReadBatch()
+  {
+    MergeBatchRef result=std::make_shared<MergeBatch>();
+    FileOffset    start=scanner.GetPos();
+
+    while (remaining>0 &&
+           scanner.GetPos()-start<batchSize) {
+      result->push_back(MergeEntry());
+
+      MergeEntry& entry=result->back();
+
+      scanner.Read(entry.key.cellIndex);
+      scanner.Read(entry.key.sortId);
+      scanner.Read(entry.key.sequence);
+      scanner.Read(entry.type);
+      scanner.Read(entry.id);
+
+      entry.data.Read(typeConfig,
+                      scanner);
+
+      remaining--;
+    }
+
+    return result;
+  }
+
+  template <class N>
+  void SortDataGenerator<N>::RunReader::StartPrefetch()
+  {
+    if (remaining>0) {
+      nextBatch=std::async(std::launch::async,
+                           &SortDataGenerator<N>::RunReader::ReadBatch,this);
+    }
+  }
+
+  /**
+   * Moves to the next entry of the run.
+   *
+   * @throws IOException
+   */
+  template <class N>
+  void SortDataGenerator<N>::RunReader::Next()
+  {
+    current++;
+
+    if (current<batch->size() ||
+        !nextBatch.valid()) {
+      return;
+    }
+
+    batch=nextBatch.get();
+    current=0;
+
+    StartPrefetch();
+  }
+
+  template <class N>
+  void SortDataGenerator<N>::RunReader::Close()
+  {
+    if (nextBatch.valid()) {
+      nextBatch.wait();
+    }
+
+    if (scanner.IsOpen()) {
+      scanner.CloseFailsafe();
+    }
+  }
+
+  /**
+   * Returns the sort key for the given object. Objects are sorted by the
+   * cell they are located in and within a cell by the hash value of their
+   * top left coordinate.
+   */
+  template <class N>
+  typename SortDataGenerator<N>::SortKey SortDataGenerator<N>::GetSortKey(const N& data,
+                                                                          size_t zoomLevel,
+                                                                          uint64_t sequence)
+  {
+    GeoCoord coord;
+    SortKey  key;
+
+    GetTopLeftCoordinate(data,
+                         coord);
+
+    size_t cellY=(size_t)((coord.GetLat()+90.0)/180.0*zoomLevel);
+    size_t cellX=(size_t)((coord.GetLon()+180.0)/360.0*zoomLevel);
+
+    key.cellIndex=cellY*zoomLevel+cellX;
+    key.sortId=coord.GetHash();
+    key.sequence=sequence;
+
+    return key;
+  }
+
+  /**
+   * Sorts the given buffer and writes it to a new run file.
+   * Executed in parallel by the sort worker threads.
+   *
+   * @throws IOException
+   */
+  template <class N>
+  typename SortDataGenerator<N>::Run SortDataGenerator<N>::WriteRun(const TypeConfig& /*typeConfig*/,
+                                                                    SortBufferRef buffer,
+                                                                    const std::string& filename)
+  {
+    FileWriter writer;
+    Run        run;
+
+    std::sort(buffer->entries.begin(),
+              buffer->entries.end());
+
+    writer.Open(filename);
+
+    for (const auto& entry : buffer->entries) {
+      writer.Write(entry.key.cellIndex);
+      writer.Write(entry.key.sortId);
+      writer.Write(entry.key.sequence);
+      writer.Write(buffer->data.data()+entry.dataOffset,
+                   entry.dataLength);
+    }
+
+    writer.Close();
+
+    run.filename=filename;
+    run.entryCount=buffer->entries.size();
+
+    return run;
+  }
+
+  template <class N>
+  void SortDataGenerator<N>::SortWorkerLoop(WorkQueue<Run>& queue)
+  {
+    std::packaged_task<Run()> task;
+
+    while (queue.PopTask(task)) {
+      task();
+    }
+  }
+
+  /**
+   * Reads all sources in one pass and copies the raw objects together with
+   * their sort key into sort buffers. If the next object does not fit into
+   * the share of the memory budget of a buffer, the buffer is sorted and
+   * written to a run file by one of the sort worker threads, while the next
+   * buffer gets filled.
+   *
+   * If all objects fit into the first buffer, no run is written and the buffer
+   * is returned instead.
+   */
+  template <class N>
+  bool SortDataGenerator<N>::GenerateRuns(const TypeConfig& typeConfig,
+                                          const ImportParameter& parameter,
+                                          Progress& progress,
+                                          uint32_t& overallDataCount,
+                                          SortBufferRef& buffer,
+                                          std::vector<Run>& runs)
+  {
+    size_t                                      zoomLevel=Pow(2,parameter.GetSortTileMag());
+    size_t                                      workerCount=std::max((unsigned int)1,std::thread::hardware_concurrency());
+    // The buffer currently filled, one waiting buffer and one buffer for each worker
+    size_t                                      bufferSize=std::max((size_t)1,parameter.GetSortMemoryBudget()/(workerCount+2));
+    WorkQueue<Run>                              sortQueue(0);
+    std::vector<std::thread>                    sortWorkerThreads;
+    std::vector<std::shared_future<Run>>        runResults;
+    uint64_t                                    sequence=0;
+    bool                                        success=true;
+
+    progress.Info("Using "+NumberToString(workerCount)+" sort worker threads with "+ByteSizeToString((double)bufferSize)+" buffers");
+
+    for (size_t t=1; t<=workerCount; t++) {
+      sortWorkerThreads.push_back(std::thread(&SortDataGenerator<N>::SortWorkerLoop,std::ref(sortQueue)));
+    }
+
+    buffer=std::make_shared<SortBuffer>();
 
     try {
-      for (auto& source : sources) {
+      for (typename std::list<Source>::iterator source=sources.begin();
+           source!=sources.end();
+           ++source) {
         uint32_t dataCount;
 
-        source.scanner.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
-                                            source.filename),
-                            FileScanner::Sequential,
-                            parameter.GetWayDataMemoryMaped());
+        source->scanner.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
+                                             source->filename),
+                             FileScanner::Sequential,
+                             parameter.GetWayDataMemoryMaped());
 
-        source.scanner.Read(dataCount);
+        source->scanner.Read(dataCount);
 
-        progress.Info(NumberToString(dataCount)+" entries in file '"+source.scanner.GetFilename()+"'");
+        progress.Info("Reading "+NumberToString(dataCount)+" entries from file '"+source->scanner.GetFilename()+"'");
 
         overallDataCount+=dataCount;
-      }
 
+        for (uint32_t current=1; current<=dataCount; current++) {
+          FileOffset fileOffset=source->scanner.GetPos();
+          uint8_t    type;
+          Id         id;
+          N          data;
 
-      dataWriter.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
-                                      dataFilename));
+          progress.SetProgress(current,dataCount);
 
-      dataWriter.Write(overallDataCount);
+          source->scanner.Read(type);
+          source->scanner.Read(id);
 
-      mapWriter.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
-                                     mapFilename));
+          data.Read(typeConfig,
+                    source->scanner);
 
-      mapWriter.Write(overallDataCount);
+          SortEntry entry;
+
+          entry.key=GetSortKey(data,
+                               zoomLevel,
+                               sequence);
+          entry.dataLength=(size_t)(source->scanner.GetPos()-fileOffset);
+
+          if (!buffer->Reserve(entry.dataLength,
+                               bufferSize)) {
+            std::string               filename=AppendFileToDir(parameter.GetDestinationDirectory(),
+                                                               dataFilename+"."+NumberToString(runResults.size())+".run");
+            std::packaged_task<Run()> sortTask(std::bind(&SortDataGenerator<N>::WriteRun,
+                                                         std::cref(typeConfig),
+                                                         buffer,
+                                                         filename));
 
-      while (true) {
-        progress.Info("Reading objects in cell range "+NumberToString(minIndex)+ "-"+NumberToString(maxIndex));
+            runResults.push_back(sortTask.get_future().share());
 
-        size_t                                 currentEntries=0;
-        std::map<size_t,std::list<CellEntry> > dataByCellMap;
+            sortQueue.PushTask(sortTask);
 
-        for (typename std::list<Source>::iterator source=sources.begin();
-             source!=sources.end();
-             ++source) {
-          uint32_t dataCount;
-          progress.Info("Reading objects from file '"+source->scanner.GetFilename()+"'");
+            buffer=std::make_shared<SortBuffer>();
+            buffer->Reserve(entry.dataLength,
+                            bufferSize);
+          }
+
+          entry.dataOffset=buffer->data.size();
 
-          source->scanner.GotoBegin();
+          // The object was just read, so copying its raw data is served from
+          // the mapped memory or the stream buffer of the same scanner
+          buffer->data.resize(entry.dataOffset+entry.dataLength);
+          source->scanner.SetPos(fileOffset);
+          source->scanner.Read(buffer->data.data()+entry.dataOffset,
+                               entry.dataLength);
 
-          source->scanner.Read(dataCount);
+          buffer->entries.push_back(entry);
+
+          sequence++;
+        }
+      }
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
+      success=false;
+    }
 
-          uint32_t current=1;
+    if (success &&
+        !runResults.empty() &&
+        !buffer->entries.empty()) {
+      std::string               filename=AppendFileToDir(parameter.GetDestinationDirectory(),
+                                                         dataFilename+"."+NumberToString(runResults.size())+".run");
+      std::packaged_task<Run()> sortTask(std::bind(&SortDataGenerator<N>::WriteRun,
+                                                   std::cref(typeConfig),
+                                                   buffer,
+                                                   filename));
 
-          while (current<=dataCount) {
-            uint8_t type;
-            Id      id;
-            N       data;
+      runResults.push_back(sortTask.get_future().share());
 
-            progress.SetProgress(current,dataCount);
+      sortQueue.PushTask(sortTask);
 
-            source->scanner.Read(type);
-            source->scanner.Read(id);
+      buffer.reset();
+    }
 
-            data.Read(typeConfig,
-                      source->scanner);
+    sortQueue.Stop();
 
-            GeoCoord coord;;
+    for (auto& thread : sortWorkerThreads) {
+      thread.join();
+    }
 
-            GetTopLeftCoordinate(data,
-                                 coord);
+    for (auto& runResult : runResults) {
+      try {
+        runs.push_back(runResult.get());
+      }
+      catch (IOException& e) {
+        progress.Error(e.GetDescription());
+        success=false;
+      }
+    }
 
-            size_t cellY=(size_t)((coord.GetLat()+90.0)/180.0*zoomLevel);
-            size_t cellX=(size_t)((coord.GetLon()+180.0)/360.0*zoomLevel);
-            size_t cellIndex=cellY*zoomLevel+cellX;
+    return success;
+  }
 
-            if (cellIndex>=minIndex &&
-                cellIndex<=maxIndex) {
-              dataByCellMap[cellIndex].push_back(CellEntry(type,
-                                                           id,
-                                                           source,
-                                                           data.GetFileOffset(),
-                                                           coord.GetHash()));
-              currentEntries++;
-            }
+  /**
+   * Merges the given runs and calls the callback for each entry in sort order.
+   * If there are more runs than can be merged at once, groups of runs are
+   * merged into bigger runs first.
+   */
+  template <class N>
+  bool SortDataGenerator<N>::MergeRuns(const TypeConfig& typeConfig,
+                                       const ImportParameter& parameter,
+                                       Progress& progress,
+                                       const std::vector<Run>& runs,
+                                       uint64_t entryCount,
+                                       const MergeCallback& callback)
+  {
+    // Maximum number of runs merged at once
+    const size_t     maxMergeRuns=64;
+    std::vector<Run> currentRuns(runs);
+    std::vector<Run> mergedRuns;
+    size_t           mergeLevel=1;
+    FileWriter       writer;
+    // Deletes the runs written by this merge, the given runs are deleted by the caller
+    auto             removeMergedRuns=[&currentRuns,&mergedRuns,&mergeLevel]() {
+                       for (const auto& run : mergedRuns) {
+                         RemoveFile(run.filename);
+                       }
+
+                       if (mergeLevel>1) {
+                         for (const auto& run : currentRuns) {
+                           RemoveFile(run.filename);
+                         }
+                       }
+                     };
 
-            // Reduce cell interval, deleting all already stored nodes beyond the new
-            // cell range end.
-            if (currentEntries>parameter.GetSortBlockSize() &&
-                dataByCellMap.size()>1) {
-              size_t                                                    count=0;
-              size_t                                                    cutLimit=parameter.GetSortBlockSize()*9/10;
-              typename std::map<size_t,std::list<CellEntry> >::iterator cutOff=dataByCellMap.end();
-
-              for (typename std::map<size_t,std::list<CellEntry> >::iterator iter=dataByCellMap.begin();
-                   iter!=dataByCellMap.end();
-                   ++iter) {
-                if (count<=cutLimit &&
-                    count+iter->second.size()>cutLimit) {
-                  cutOff=iter;
-                  break;
-                }
-                else {
-                  maxIndex=iter->first;
-                  count+=iter->second.size();
-                }
-              }
-
-              assert(cutOff!=dataByCellMap.end());
-
-              currentEntries=count;
-              dataByCellMap.erase(cutOff,dataByCellMap.end());
-            }
+    try {
+      while (currentRuns.size()>maxMergeRuns) {
+        progress.Info("Merging "+NumberToString(currentRuns.size())+" runs into bigger runs");
 
-            current++;
+        for (size_t start=0; start<currentRuns.size(); start+=maxMergeRuns) {
+          std::vector<Run> group(currentRuns.begin()+start,
+                                 currentRuns.begin()+std::min(start+maxMergeRuns,currentRuns.size()));
+          Run              run;
+
+          run.filename=AppendFileToDir(parameter.GetDestinationDirectory(),
+                                       dataFilename+"."+NumberToString(mergeLevel)+"."+NumberToString(mergedRuns.size())+".run");
+          run.entryCount=0;
+
+          for (const auto& groupRun : group) {
+            run.entryCount+=groupRun.entryCount;
+          }
+
+          // Registered before writing, so that a partially written run gets deleted, too
+          mergedRuns.push_back(run);
+
+          writer.Open(run.filename);
+
+          if (!MergeRuns(typeConfig,
+                         parameter,
+                         progress,
+                         group,
+                         run.entryCount,
+                         [&writer,&typeConfig](MergeEntry& entry) {
+                           writer.Write(entry.key.cellIndex);
+                           writer.Write(entry.key.sortId);
+                           writer.Write(entry.key.sequence);
+                           writer.Write(entry.type);
+                           writer.Write(entry.id);
+
+                           entry.data.Write(typeConfig,
+                                            writer);
+
+                           return true;
+                         })) {
+            writer.CloseFailsafe();
+            removeMergedRuns();
+            return false;
           }
+
+          writer.Close();
         }
 
-        if (maxIndex<cellCount-1) {
-          progress.Info("Cell range was reduced to "+NumberToString(minIndex)+ "-"+NumberToString(maxIndex));
+        currentRuns=mergedRuns;
+        mergedRuns.clear();
+        mergeLevel++;
+      }
+
+      // Memory is shared by the current and the prefetched batch of each run
+      size_t                                  batchSize=std::max((size_t)64*1024,
+                                                                 parameter.GetSortMemoryBudget()/(4*std::max((size_t)1,currentRuns.size())));
+      std::vector<std::unique_ptr<RunReader>> readers;
+      auto                                    greater=[&readers](size_t a, size_t b) {
+                                                return readers[b]->GetEntry().key<readers[a]->GetEntry().key;
+                                              };
+      std::priority_queue<size_t,
+                          std::vector<size_t>,
+                          decltype(greater)>  queue(greater);
+      uint64_t                                current=0;
+
+      for (const auto& run : currentRuns) {
+        readers.push_back(std::unique_ptr<RunReader>(new RunReader(typeConfig,
+                                                                   run,
+                                                                   batchSize)));
+
+        if (readers.back()->HasEntry()) {
+          queue.push(readers.size()-1);
         }
+      }
 
-        progress.Info(std::string("Copy renumbered data to '")+dataWriter.GetFilename()+"'");
+      while (!queue.empty()) {
+        size_t index=queue.top();
 
-        size_t copyCount=0;
-        for (typename std::map<size_t,std::list<CellEntry> >::iterator iter=dataByCellMap.begin();
-             iter!=dataByCellMap.end();
-             ++iter) {
+        queue.pop();
 
-          iter->second.sort();
+        progress.SetProgress(current,entryCount);
 
-          for (auto& entry : iter->second) {
-            progress.SetProgress(copyCount,currentEntries);
+        if (!callback(readers[index]->GetEntry())) {
+          for (auto& reader : readers) {
+            reader->Close();
+          }
 
-            copyCount++;
+          removeMergedRuns();
+          return false;
+        }
 
-            N data;
+        current++;
 
-            entry.source->scanner.SetPos(entry.fileOffset);
+        readers[index]->Next();
 
-            data.Read(typeConfig,
-                      entry.source->scanner);
+        if (readers[index]->HasEntry()) {
+          queue.push(index);
+        }
+      }
 
-            FileOffset fileOffset;
-            bool       save=true;
+      for (auto& reader : readers) {
+        reader->Close();
+      }
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
 
-            fileOffset=dataWriter.GetPos();
+      if (writer.IsOpen()) {
+        writer.CloseFailsafe();
+      }
 
-            for (const auto& filter : filters) {
-              if (!filter->Process(progress,
-                                   fileOffset,
-                                   data,
-                                   save)) {
-                progress.Error(std::string("Error while processing data entry to file '")+
-                               dataWriter.GetFilename()+"'");
+      removeMergedRuns();
+      return false;
+    }
 
-                return false;
-              }
+    for (const auto& run : currentRuns) {
+      RemoveFile(run.filename);
+    }
 
-              if (!save) {
-                break;
-              }
-            }
+    return true;
+  }
 
-            if (!save) {
-              continue;
-            }
+  /**
+   * Passes the given object to the filters and writes it to the data file,
+   * if it was not dropped by one of the filters.
+   *
+   * @throws IOException
+   */
+  template <class N>
+  bool SortDataGenerator<N>::WriteEntry(const TypeConfig& typeConfig,
+                                        Progress& progress,
+                                        FileWriter& dataWriter,
+                                        FileWriter& mapWriter,
+                                        uint8_t type,
+                                        Id id,
+                                        N& data,
+                                        uint32_t& dataCopiedCount)
+  {
+    FileOffset fileOffset;
+    bool       save=true;
 
-            data.Write(typeConfig,
-                       dataWriter);
+    fileOffset=dataWriter.GetPos();
 
-            mapWriter.Write(entry.id);
-            mapWriter.Write(entry.type);
-            mapWriter.WriteFileOffset(fileOffset);
+    for (const auto& filter : filters) {
+      if (!filter->Process(progress,
+                           fileOffset,
+                           data,
+                           save)) {
+        progress.Error(std::string("Error while processing data entry to file '")+
+                       dataWriter.GetFilename()+"'");
 
-            dataCopiedCount++;
-          }
-        }
+        return false;
+      }
 
-        if (currentEntries==0) {
-          progress.Info("No more entries found");
-          break;
-        }
+      if (!save) {
+        break;
+      }
+    }
 
-        if (maxIndex==cellCount-1) {
-          // We are finished
-          break;
-        }
+    if (!save) {
+      return true;
+    }
+
+    data.Write(typeConfig,
+               dataWriter);
+
+    mapWriter.Write(id);
+    mapWriter.Write(type);
+    mapWriter.WriteFileOffset(fileOffset);
+
+    dataCopiedCount++;
+
+    return true;
+  }
+
+  /**
+   * Sorts the objects of all sources by their location using an external
+   * merge sort, passes them to the filters and writes them to the data file.
+   */
+  template <class N>
+  bool SortDataGenerator<N>::Renumber(const TypeConfig& typeConfig,
+                                      const ImportParameter& parameter,
+                                      Progress& progress)
+  {
+    FileWriter       dataWriter;
+    FileWriter       mapWriter;
+    uint32_t         overallDataCount=0;
+    uint32_t         dataCopiedCount=0;
+    SortBufferRef    buffer;
+    std::vector<Run> runs;
 
-        minIndex=maxIndex+1;
-        maxIndex=cellCount-1;
+    progress.SetAction("Sorting data");
+
+    if (!GenerateRuns(typeConfig,
+                      parameter,
+                      progress,
+                      overallDataCount,
+                      buffer,
+                      runs)) {
+      for (auto& source : sources) {
+        source.scanner.CloseFailsafe();
       }
 
-      assert(overallDataCount>=dataCopiedCount);
+      for (const auto& run : runs) {
+        RemoveFile(run.filename);
+      }
+
+      return false;
+    }
+
+    try {
+      dataWriter.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
+                                      dataFilename));
+
+      dataWriter.Write(overallDataCount);
+
+      mapWriter.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
+                                     mapFilename));
+
+      mapWriter.Write(overallDataCount);
 
       for (auto& source : sources) {
         source.scanner.Close();
       }
 
+      if (runs.empty() &&
+          !buffer->entries.empty()) {
+        // Everything fits into memory, copy the objects directly from the buffer
+        FileScanner bufferScanner;
+
+        progress.Info(std::string("Copy sorted data to '")+dataWriter.GetFilename()+"'");
+
+        std::sort(buffer->entries.begin(),
+                  buffer->entries.end());
+
+        bufferScanner.Open(dataWriter.GetFilename()+" (sort buffer)",
+                           buffer->data.data(),
+                           buffer->data.size());
+
+        size_t copyCount=0;
+
+        for (const auto& entry : buffer->entries) {
+          uint8_t type;
+          Id      id;
+          N       data;
+
+          progress.SetProgress(copyCount,buffer->entries.size());
+
+          copyCount++;
+
+          bufferScanner.SetPos(entry.dataOffset);
+
+          bufferScanner.Read(type);
+          bufferScanner.Read(id);
+
+          data.Read(typeConfig,
+                    bufferScanner);
+
+          if (!WriteEntry(typeConfig,
+                          progress,
+                          dataWriter,
+                          mapWriter,
+                          type,
+                          id,
+                          data,
+                          dataCopiedCount)) {
+            bufferScanner.CloseFailsafe();
+            return false;
+          }
+        }
+
+        bufferScanner.Close();
+        buffer.reset();
+      }
+      else if (!runs.empty()) {
+        progress.Info("Merging "+NumberToString(runs.size())+" sorted runs into '"+dataWriter.GetFilename()+"'");
+
+        if (!MergeRuns(typeConfig,
+                       parameter,
+                       progress,
+                       runs,
+                       overallDataCount,
+                       [this,&typeConfig,&progress,&dataWriter,&mapWriter,&dataCopiedCount](MergeEntry& entry) {
+                         return WriteEntry(typeConfig,
+                                           progress,
+                                           dataWriter,
+                                           mapWriter,
+                                           entry.type,
+                                           entry.id,
+                                           entry.data,
+                                           dataCopiedCount);
+                       })) {
+          for (const auto& run : runs) {
+            RemoveFile(run.filename);
+          }
+
+          dataWriter.CloseFailsafe();
+          mapWriter.CloseFailsafe();
+
+          return false;
+        }
+      }
+
+      assert(overallDataCount>=dataCopiedCount);
+
       progress.Info(NumberToString(dataCopiedCount)+" of " +NumberToString(overallDataCount) + " object(s) written to file '"+dataWriter.GetFilename()+"'");
 
       dataWriter.SetPos(0);
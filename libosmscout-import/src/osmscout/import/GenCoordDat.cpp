@@ -34,6 +34,8 @@ namespace osmscout {
   static uint32_t coordSortPageSize=5000000;
   static uint32_t coordDiskPageSize=64;
   static uint32_t coordDiskSize=8;
+  // Gaps in a dense coord file bigger than this are skipped (creating a hole) instead of written
+  static size_t   coordDenseMaxGapSize=4096;
 
   static inline bool SortCoordsByOSMId(const RawCoord& a, const RawCoord& b)
   {
@@ -227,13 +229,36 @@ namespace osmscout {
 
     std::unordered_map<OSMId,FileOffset> pageIndex;
 
+    bool               dense=parameter.GetCoordDataDense();
+    OSMId              minNodeId=0;
+    OSMId              maxNodeId=-1;
+    bool               firstNode=true;
+    FileOffset         dataOffset=0;
+    FileOffset         currentOffset=0;
+    std::vector<char>  zeros;
+
     try {
       writer.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
                                   CoordDataFile::COORD_DAT));
 
-      writer.WriteFileOffset(0);
-      writer.Write(coordDiskPageSize);
-      writer.FlushCurrentBlockWithZeros(coordSortPageSize*coordDiskSize);
+      if (dense) {
+        // Header is written again at the end, when the id range is known
+        writer.WriteFileOffset(0);
+        writer.Write((uint32_t)0);
+        writer.Write(minNodeId);
+        writer.Write(maxNodeId);
+        writer.WriteFileOffset(dataOffset);
+        writer.FlushCurrentBlockWithZeros(coordDenseMaxGapSize);
+
+        dataOffset=writer.GetPos();
+        currentOffset=dataOffset;
+        zeros.resize(coordDenseMaxGapSize,0);
+      }
+      else {
+        writer.WriteFileOffset(0);
+        writer.Write(coordDiskPageSize);
+        writer.FlushCurrentBlockWithZeros(coordSortPageSize*coordDiskSize);
+      }
 
       scanner.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
                                    Preprocess::RAWCOORDS_DAT),
@@ -324,6 +349,34 @@ namespace osmscout {
               duplicateEntry->second++;
             }
 
+            if (dense) {
+              // Coordinates are written in the order of their ids, so the first id is the lowest one
+              if (firstNode) {
+                minNodeId=osmCoord.GetOSMId();
+                maxNodeId=minNodeId;
+                firstNode=false;
+              }
+
+              FileOffset offset=dataOffset+(FileOffset)(osmCoord.GetOSMId()-minNodeId)*coordDiskSize;
+
+              if (offset>currentOffset &&
+                  offset-currentOffset<=coordDenseMaxGapSize) {
+                writer.Write(zeros.data(),
+                             (size_t)(offset-currentOffset));
+              }
+              else if (offset!=currentOffset) {
+                writer.SetPos(offset);
+              }
+
+              writer.Write(serial);
+              writer.WriteCoord(osmCoord.GetCoord());
+
+              currentOffset=offset+coordDiskSize;
+              maxNodeId=std::max(maxNodeId,osmCoord.GetOSMId());
+
+              continue;
+            }
+
             PageId relatedId=osmCoord.GetOSMId()+std::numeric_limits<OSMId>::min();
             PageId pageId=relatedId/coordDiskPageSize;
 
@@ -348,12 +401,14 @@ namespace osmscout {
           }
         }
 
-        FileOffset pageOffset=writer.GetPos();
+        if (!dense) {
+          FileOffset pageOffset=writer.GetPos();
 
-        if (DumpCurrentPage(writer,
-                            isSetInPage,
-                            page)) {
-          pageIndex[currentPageId]=pageOffset;
+          if (DumpCurrentPage(writer,
+                              isSetInPage,
+                              page)) {
+            pageIndex[currentPageId]=pageOffset;
+          }
         }
 
         progress.Info("Loaded "+NumberToString(currentCoordCount)+" coords (" +NumberToString(loadedCoordCount)+"/"+NumberToString(coordCount)+")");
@@ -362,6 +417,22 @@ namespace osmscout {
         currentUpperLimit=maxId/coordSortPageSize;
       }
 
+      scanner.Close();
+
+      if (dense) {
+        progress.Info("Stored coordinates of node ids "+NumberToString(minNodeId)+"-"+NumberToString(maxNodeId)+" in dense array");
+
+        writer.GotoBegin();
+        writer.WriteFileOffset(0);
+        writer.Write((uint32_t)0);
+        writer.Write(minNodeId);
+        writer.Write(maxNodeId);
+        writer.WriteFileOffset(dataOffset);
+        writer.Close();
+
+        return true;
+      }
+
       FileOffset indexStartOffset=writer.GetPos();
 
       progress.SetAction("Writing "+NumberToString(pageIndex.size())+" index entries to disk");
@@ -373,9 +444,6 @@ namespace osmscout {
         writer.Write(entry.second);
       }
 
-
-      scanner.Close();
-
       writer.GotoBegin();
       writer.WriteFileOffset(indexStartOffset);
       writer.Close();
@@ -0,0 +1,637 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/import/GenRoutableSegmentIndex.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <list>
+#include <memory>
+#include <queue>
+
+#include <osmscout/Area.h>
+#include <osmscout/AreaDataFile.h>
+#include <osmscout/Way.h>
+#include <osmscout/WayDataFile.h>
+
+#include <osmscout/util/File.h>
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
+#include <osmscout/util/String.h>
+
+namespace osmscout {
+
+  void RoutableSegmentIndexGenerator::GetDescription(const ImportParameter& parameter,
+                                                     ImportModuleDescription& description) const
+  {
+    description.SetName("RoutableSegmentIndexGenerator");
+    description.SetDescription("Index nodes of routable ways and areas for finding the closest routable node");
+
+    description.AddRequiredFile(WayDataFile::WAYS_DAT);
+    description.AddRequiredFile(AreaDataFile::AREAS_DAT);
+
+    if (parameter.GetRouteSegmentIndex()) {
+      description.AddProvidedOptionalFile(RoutableSegmentIndex::ROUTABLE_SEGMENT_IDX);
+    }
+  }
+
+  static VehicleMask GetVehicleMask(const TypeInfo& type)
+  {
+    VehicleMask vehicles=0;
+
+    if (type.GetIgnore()) {
+      return vehicles;
+    }
+
+    for (const auto vehicle : {vehicleFoot,vehicleBicycle,vehicleCar}) {
+      if (type.CanRoute(vehicle)) {
+        vehicles|=vehicle;
+      }
+    }
+
+    return vehicles;
+  }
+
+  static bool HasNodeWithId(const std::vector<Point>& nodes)
+  {
+    for (const auto& node : nodes) {
+      if (node.IsRelevant()) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  static bool CellEntryLess(uint32_t ay, uint32_t ax, const RoutableSegmentIndex::Entry& a,
+                            uint32_t by, uint32_t bx, const RoutableSegmentIndex::Entry& b)
+  {
+    if (ay!=by) {
+      return ay<by;
+    }
+
+    if (ax!=bx) {
+      return ax<bx;
+    }
+
+    if (a.type!=b.type) {
+      return a.type<b.type;
+    }
+
+    if (a.offset!=b.offset) {
+      return a.offset<b.offset;
+    }
+
+    return a.nodeIndex<b.nodeIndex;
+  }
+
+  static bool CellEntryEqual(uint32_t ay, uint32_t ax, const RoutableSegmentIndex::Entry& a,
+                             uint32_t by, uint32_t bx, const RoutableSegmentIndex::Entry& b)
+  {
+    return ay==by &&
+           ax==bx &&
+           a.type==b.type &&
+           a.offset==b.offset &&
+           a.nodeIndex==b.nodeIndex;
+  }
+
+  /**
+   * Add both nodes of each segment of the object to all cells intersected
+   * by the bounding box of the segment.
+   */
+  void RoutableSegmentIndexGenerator::AddObject(std::vector<CellEntry>& buffer,
+                                                const std::vector<Point>& nodes,
+                                                FileOffset offset,
+                                                RefType type,
+                                                VehicleMask vehicles,
+                                                bool closed) const
+  {
+    double cellDimension=RoutableSegmentIndex::GetCellDimension(CELL_LEVEL);
+    size_t segmentCount=nodes.size()>1 ? nodes.size()-1 : nodes.size();
+
+    if (closed &&
+        nodes.size()>2) {
+      segmentCount++;
+    }
+
+    for (size_t s=0; s<segmentCount; s++) {
+      size_t   from=s;
+      size_t   to=(s+1)<nodes.size() ? s+1 : (nodes.size()>1 ? 0 : s);
+      uint32_t xStart=RoutableSegmentIndex::GetCellX(std::min(nodes[from].GetLon(),nodes[to].GetLon()),cellDimension);
+      uint32_t xEnd=RoutableSegmentIndex::GetCellX(std::max(nodes[from].GetLon(),nodes[to].GetLon()),cellDimension);
+      uint32_t yStart=RoutableSegmentIndex::GetCellY(std::min(nodes[from].GetLat(),nodes[to].GetLat()),cellDimension);
+      uint32_t yEnd=RoutableSegmentIndex::GetCellY(std::max(nodes[from].GetLat(),nodes[to].GetLat()),cellDimension);
+
+      for (uint32_t y=yStart; y<=yEnd; y++) {
+        for (uint32_t x=xStart; x<=xEnd; x++) {
+          for (const auto index : {from,to}) {
+            CellEntry cellEntry;
+
+            std::memset(&cellEntry,0,sizeof(cellEntry));
+
+            cellEntry.y=y;
+            cellEntry.x=x;
+            cellEntry.entry.lat=nodes[index].GetLat();
+            cellEntry.entry.lon=nodes[index].GetLon();
+            cellEntry.entry.offset=offset;
+            cellEntry.entry.nodeIndex=(uint32_t)index;
+            cellEntry.entry.type=(uint8_t)type;
+            cellEntry.entry.vehicles=vehicles;
+
+            buffer.push_back(cellEntry);
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * Sort the buffer by cell, type, object offset and node index and remove
+   * duplicate entries.
+   */
+  void RoutableSegmentIndexGenerator::SortBuffer(std::vector<CellEntry>& buffer) const
+  {
+    std::sort(buffer.begin(),
+              buffer.end(),
+              [](const CellEntry& a, const CellEntry& b) {
+                return CellEntryLess(a.y,a.x,a.entry,
+                                     b.y,b.x,b.entry);
+              });
+
+    buffer.erase(std::unique(buffer.begin(),
+                             buffer.end(),
+                             [](const CellEntry& a, const CellEntry& b) {
+                               return CellEntryEqual(a.y,a.x,a.entry,
+                                                     b.y,b.x,b.entry);
+                             }),
+                 buffer.end());
+  }
+
+  /**
+   * Write the (sorted) buffer to a run file.
+   *
+   * @throws IOException
+   */
+  RoutableSegmentIndexGenerator::Run RoutableSegmentIndexGenerator::WriteRun(const std::string& filename,
+                                                                             const std::vector<CellEntry>& buffer) const
+  {
+    FileWriter writer;
+    Run        run;
+
+    writer.Open(filename);
+
+    writer.Write((const char*)buffer.data(),
+                 buffer.size()*sizeof(CellEntry));
+
+    writer.Close();
+
+    run.filename=filename;
+    run.count=buffer.size();
+
+    return run;
+  }
+
+  /**
+   * Merge the given sorted runs and pass all entries in sort order, without
+   * duplicates, to the consumer. Each run is read in blocks of bufferSize
+   * entries.
+   *
+   * @throws IOException
+   */
+  void RoutableSegmentIndexGenerator::MergeRuns(const std::vector<Run>& runs,
+                                                size_t bufferSize,
+                                                const CellEntryConsumer& consumer) const
+  {
+    struct RunReader
+    {
+      FileScanner            scanner;
+      size_t                 remaining;
+      std::vector<CellEntry> buffer;
+      size_t                 current;
+
+      bool Next()
+      {
+        current++;
+
+        if (current<buffer.size()) {
+          return true;
+        }
+
+        if (remaining==0) {
+          return false;
+        }
+
+        buffer.resize(std::min(remaining,buffer.capacity()));
+        scanner.Read((char*)buffer.data(),
+                     buffer.size()*sizeof(CellEntry));
+
+        remaining-=buffer.size();
+        current=0;
+
+        return true;
+      }
+
+      const CellEntry& Get() const
+      {
+        return buffer[current];
+      }
+    };
+
+    typedef std::shared_ptr<RunReader> RunReaderRef;
+
+    auto greater=[](const RunReaderRef& a, const RunReaderRef& b) {
+      return CellEntryLess(b->Get().y,b->Get().x,b->Get().entry,
+                           a->Get().y,a->Get().x,a->Get().entry);
+    };
+
+    std::list<RunReaderRef>                     readers;
+    std::priority_queue<RunReaderRef,
+                        std::vector<RunReaderRef>,
+                        decltype(greater)>      queue(greater);
+
+    try {
+      for (const auto& run : runs) {
+        RunReaderRef reader=std::make_shared<RunReader>();
+
+        readers.push_back(reader);
+
+        reader->scanner.Open(run.filename,
+                             FileScanner::Sequential,
+                             false);
+        reader->remaining=run.count;
+        reader->buffer.reserve(std::max((size_t)1,bufferSize));
+        reader->current=0;
+
+        if (reader->Next()) {
+          queue.push(reader);
+        }
+      }
+
+      bool      hasLast=false;
+      CellEntry last;
+
+      while (!queue.empty()) {
+        RunReaderRef reader=queue.top();
+
+        queue.pop();
+
+        const CellEntry& cellEntry=reader->Get();
+
+        if (!hasLast ||
+            !CellEntryEqual(last.y,last.x,last.entry,
+                            cellEntry.y,cellEntry.x,cellEntry.entry)) {
+          consumer(cellEntry);
+
+          last=cellEntry;
+          hasLast=true;
+        }
+
+        if (reader->Next()) {
+          queue.push(reader);
+        }
+      }
+
+      for (auto& reader : readers) {
+        reader->scanner.Close();
+      }
+    }
+    catch (IOException& e) {
+      for (auto& reader : readers) {
+        reader->scanner.CloseFailsafe();
+      }
+
+      throw;
+    }
+  }
+
+  /**
+   * Write the index, either directly from the sorted buffer or by merging
+   * the buffer with all previously written runs. If there are more than
+   * MAX_MERGE_RUNS runs, runs are first merged into larger runs.
+   *
+   * The cells are collected while writing the entries and are written
+   * after the entries, followed by rewriting the header.
+   */
+  bool RoutableSegmentIndexGenerator::WriteIndex(const ImportParameter& parameter,
+                                                 Progress& progress,
+                                                 std::vector<CellEntry>& buffer,
+                                                 std::vector<Run>& runs,
+                                                 std::vector<std::string>& runFilenames,
+                                                 size_t& cellCount,
+                                                 size_t& entryCount) const
+  {
+    std::string filename=AppendFileToDir(parameter.GetDestinationDirectory(),
+                                         RoutableSegmentIndex::ROUTABLE_SEGMENT_IDX);
+    size_t      bufferCapacity=std::max((size_t)1,
+                                        parameter.GetSortMemoryBudget()/sizeof(CellEntry));
+    FileWriter  writer;
+
+    try {
+      SortBuffer(buffer);
+
+      if (!runs.empty()) {
+        runFilenames.push_back(filename+"."+NumberToString(runFilenames.size())+".run");
+        runs.push_back(WriteRun(runFilenames.back(),
+                                buffer));
+
+        buffer.clear();
+        buffer.shrink_to_fit();
+      }
+
+      while (runs.size()>MAX_MERGE_RUNS) {
+        std::vector<Run> mergedRuns;
+
+        progress.Info("Merging "+NumberToString(runs.size())+" runs");
+
+        for (size_t r=0; r<runs.size(); r+=MAX_MERGE_RUNS) {
+          std::vector<Run> group(runs.begin()+r,
+                                 runs.begin()+std::min(runs.size(),r+MAX_MERGE_RUNS));
+          FileWriter       runWriter;
+          Run              run;
+
+          runFilenames.push_back(filename+"."+NumberToString(runFilenames.size())+".run");
+
+          run.filename=runFilenames.back();
+          run.count=0;
+
+          runWriter.Open(run.filename);
+
+          MergeRuns(group,
+                    bufferCapacity/(group.size()+1),
+                    [&runWriter,&run](const CellEntry& cellEntry) {
+                      runWriter.Write((const char*)&cellEntry,
+                                      sizeof(cellEntry));
+                      run.count++;
+                    });
+
+          runWriter.Close();
+
+          for (const auto& groupRun : group) {
+            RemoveFile(groupRun.filename);
+          }
+
+          mergedRuns.push_back(run);
+        }
+
+        runs=mergedRuns;
+      }
+
+      std::vector<RoutableSegmentIndex::Cell> cells;
+      RoutableSegmentIndex::Header            header;
+
+      std::memset(&header,0,sizeof(header));
+
+      writer.Open(filename);
+
+      // Placeholder, rewritten after all entries have been written
+      writer.Write((const char*)&header,
+                   sizeof(header));
+
+      entryCount=0;
+
+      CellEntryConsumer consumer=[&writer,&cells,&entryCount](const CellEntry& cellEntry) {
+        if (cells.empty() ||
+            cells.back().y!=cellEntry.y ||
+            cells.back().x!=cellEntry.x) {
+          RoutableSegmentIndex::Cell cell;
+
+          cell.y=cellEntry.y;
+          cell.x=cellEntry.x;
+          cell.firstEntry=(uint32_t)entryCount;
+          cell.entryCount=0;
+
+          cells.push_back(cell);
+        }
+
+        writer.Write((const char*)&cellEntry.entry,
+                     sizeof(cellEntry.entry));
+
+        cells.back().entryCount++;
+        entryCount++;
+      };
+
+      if (runs.empty()) {
+        for (const auto& cellEntry : buffer) {
+          consumer(cellEntry);
+        }
+      }
+      else {
+        progress.Info("Merging "+NumberToString(runs.size())+" runs");
+
+        MergeRuns(runs,
+                  bufferCapacity/(runs.size()+1),
+                  consumer);
+      }
+
+      if (entryCount>std::numeric_limits<uint32_t>::max()) {
+        progress.Error("Too many entries for the routable segment index");
+        writer.CloseFailsafe();
+        RemoveFile(filename);
+        return false;
+      }
+
+      writer.Write((const char*)cells.data(),
+                   cells.size()*sizeof(RoutableSegmentIndex::Cell));
+
+      header.magic=RoutableSegmentIndex::FILE_MAGIC;
+      header.version=RoutableSegmentIndex::FILE_VERSION;
+      header.level=CELL_LEVEL;
+      header.cellCount=(uint32_t)cells.size();
+      header.entryCount=(uint32_t)entryCount;
+
+      writer.SetPos(0);
+      writer.Write((const char*)&header,
+                   sizeof(header));
+
+      writer.Close();
+
+      cellCount=cells.size();
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
+      writer.CloseFailsafe();
+      RemoveFile(filename);
+      return false;
+    }
+
+    return true;
+  }
+
+  bool RoutableSegmentIndexGenerator::Import(const TypeConfigRef& typeConfig,
+                                             const ImportParameter& parameter,
+                                             Progress& progress)
+  {
+    if (!parameter.GetRouteSegmentIndex()) {
+      progress.Info("Generation of the routable segment index is disabled");
+      return true;
+    }
+
+    std::string              filename=AppendFileToDir(parameter.GetDestinationDirectory(),
+                                                      RoutableSegmentIndex::ROUTABLE_SEGMENT_IDX);
+    size_t                   bufferCapacity=std::max((size_t)1,
+                                                     parameter.GetSortMemoryBudget()/sizeof(CellEntry));
+    std::vector<VehicleMask> typeVehicles(typeConfig->GetTypeCount());
+    std::vector<CellEntry>   buffer;
+    std::vector<Run>         runs;
+    std::vector<std::string> runFilenames;
+    size_t                   objectCount=0;
+    size_t                   cellCount=0;
+    size_t                   entryCount=0;
+    bool                     success=true;
+
+    for (const auto& type : typeConfig->GetTypes()) {
+      typeVehicles[type->GetIndex()]=GetVehicleMask(*type);
+    }
+
+    // Sort and write the buffer to a new run if it has reached its capacity
+    auto flushBuffer=[this,&buffer,&runs,&runFilenames,&filename,bufferCapacity]() {
+      if (buffer.size()<bufferCapacity) {
+        return;
+      }
+
+      SortBuffer(buffer);
+
+      runFilenames.push_back(filename+"."+NumberToString(runFilenames.size())+".run");
+      runs.push_back(WriteRun(runFilenames.back(),
+                              buffer));
+
+      buffer.clear();
+    };
+
+    try {
+      FileScanner scanner;
+      uint32_t    wayCount;
+
+      progress.SetAction("Scanning ways");
+
+      scanner.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
+                                   WayDataFile::WAYS_DAT),
+                   FileScanner::Sequential,
+                   parameter.GetWayDataMemoryMaped());
+
+      scanner.Read(wayCount);
+
+      Way way;
+
+      for (uint32_t w=1; w<=wayCount; w++) {
+        progress.SetProgress(w,wayCount);
+
+        way.Read(*typeConfig,
+                 scanner);
+
+        VehicleMask vehicles=typeVehicles[way.GetType()->GetIndex()];
+
+        if (vehicles==0 ||
+            way.nodes.empty() ||
+            !HasNodeWithId(way.nodes)) {
+          continue;
+        }
+
+        AddObject(buffer,
+                  way.nodes,
+                  way.GetFileOffset(),
+                  refWay,
+                  vehicles,
+                  false);
+
+        flushBuffer();
+
+        objectCount++;
+      }
+
+      scanner.Close();
+
+      uint32_t areaCount;
+
+      progress.SetAction("Scanning areas");
+
+      scanner.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
+                                   AreaDataFile::AREAS_DAT),
+                   FileScanner::Sequential,
+                   parameter.GetAreaDataMemoryMaped());
+
+      scanner.Read(areaCount);
+
+      Area area;
+
+      for (uint32_t a=1; a<=areaCount; a++) {
+        progress.SetProgress(a,areaCount);
+
+        area.Read(*typeConfig,
+                  scanner);
+
+        VehicleMask vehicles=typeVehicles[area.GetType()->GetIndex()];
+
+        // Like RoutingService, only the nodes of the first ring are used
+        if (vehicles==0 ||
+            area.rings.empty() ||
+            area.rings[0].nodes.empty() ||
+            !HasNodeWithId(area.rings[0].nodes)) {
+          continue;
+        }
+
+        AddObject(buffer,
+                  area.rings[0].nodes,
+                  area.GetFileOffset(),
+                  refArea,
+                  vehicles,
+                  true);
+
+        flushBuffer();
+
+        objectCount++;
+      }
+
+      scanner.Close();
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
+      success=false;
+    }
+
+    if (success) {
+      progress.SetAction("Writing '"+std::string(RoutableSegmentIndex::ROUTABLE_SEGMENT_IDX)+"'");
+
+      success=WriteIndex(parameter,
+                         progress,
+                         buffer,
+                         runs,
+                         runFilenames,
+                         cellCount,
+                         entryCount);
+    }
+
+    for (const auto& runFilename : runFilenames) {
+      if (ExistsInFilesystem(runFilename)) {
+        RemoveFile(runFilename);
+      }
+    }
+
+    if (!success) {
+      return false;
+    }
+
+    progress.Info(NumberToString(objectCount)+" object(s), "+
+                  NumberToString(cellCount)+" cell(s) and "+
+                  NumberToString(entryCount)+" entries written");
+
+    return true;
+  }
+}
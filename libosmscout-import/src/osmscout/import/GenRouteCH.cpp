@@ -0,0 +1,701 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/import/GenRouteCH.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+
+#include <osmscout/ObjectVariantDataFile.h>
+
+#include <osmscout/util/File.h>
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
+#include <osmscout/util/String.h>
+
+#include <osmscout/system/Assert.h>
+
+namespace osmscout {
+
+  //! Maximum number of nodes settled during a witness search
+  static const size_t MAX_WITNESS_SETTLED_NODES=500;
+
+  typedef std::pair<double,uint32_t>                  CostNodeEntry;
+  typedef std::priority_queue<CostNodeEntry,
+                              std::vector<CostNodeEntry>,
+                              std::greater<CostNodeEntry> > CostNodeQueue;
+
+  typedef std::pair<int,uint32_t>                     PriorityNodeEntry;
+  typedef std::priority_queue<PriorityNodeEntry,
+                              std::vector<PriorityNodeEntry>,
+                              std::greater<PriorityNodeEntry> > PriorityNodeQueue;
+
+  void RouteContractionHierarchyGenerator::GetDescription(const ImportParameter& parameter,
+                                                          ImportModuleDescription& description) const
+  {
+    description.SetName("RouteContractionHierarchyGenerator");
+    description.SetDescription("Generate contraction hierarchies for the routing graph(s)");
+
+    for (const auto& router : parameter.GetRouter()) {
+      description.AddRequiredFile(router.GetDataFilename());
+      description.AddRequiredFile(router.GetVariantFilename());
+
+      if (parameter.GetRouteContractionHierarchy()) {
+        for (const auto vehicle : {vehicleFoot,vehicleBicycle,vehicleCar}) {
+          if ((router.GetVehicleMask() & vehicle)!=0) {
+            description.AddProvidedOptionalFile(RouteContractionHierarchy::GetFilename(router.GetFilenamebase(),
+                                                                                       vehicle));
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * Create the profile the hierarchy is build for. For foot and bicycle all
+   * usable ways have the same speed, so the shortest route is also the
+   * fastest route. For cars the fastest route is used if a speed table has been
+   * passed, else the shortest route.
+   */
+  RoutingProfileRef RouteContractionHierarchyGenerator::CreateProfile(const TypeConfigRef& typeConfig,
+                                                                      const ImportParameter& parameter,
+                                                                      Progress& progress,
+                                                                      Vehicle vehicle) const
+  {
+    switch (vehicle) {
+    case vehicleFoot: {
+      ShortestPathRoutingProfileRef profile=std::make_shared<ShortestPathRoutingProfile>(typeConfig);
+
+      profile->ParametrizeForFoot(*typeConfig,
+                                  5.0);
+
+      return profile;
+    }
+    case vehicleBicycle: {
+      ShortestPathRoutingProfileRef profile=std::make_shared<ShortestPathRoutingProfile>(typeConfig);
+
+      profile->ParametrizeForBicycle(*typeConfig,
+                                     20.0);
+
+      return profile;
+    }
+    case vehicleCar:
+      if (!parameter.GetRouteContractionHierarchyCarSpeeds().empty()) {
+        FastestPathRoutingProfileRef profile=std::make_shared<FastestPathRoutingProfile>(typeConfig);
+
+        if (!profile->ParametrizeForCar(*typeConfig,
+                                        parameter.GetRouteContractionHierarchyCarSpeeds(),
+                                        parameter.GetRouteContractionHierarchyCarMaxSpeed())) {
+          progress.Error("Speed table for car is incomplete");
+          return NULL;
+        }
+
+        return profile;
+      }
+      else {
+        ShortestPathRoutingProfileRef profile=std::make_shared<ShortestPathRoutingProfile>(typeConfig);
+
+        profile->SetVehicle(vehicleCar);
+
+        for (const auto &type : typeConfig->GetTypes()) {
+          if (!type->GetIgnore() &&
+              type->CanRouteCar()) {
+            profile->AddType(type,
+                             parameter.GetRouteContractionHierarchyCarMaxSpeed());
+          }
+        }
+
+        return profile;
+      }
+    }
+
+    return NULL;
+  }
+
+  /**
+   * Read all route nodes and convert all paths usable by the profile into
+   * edges.
+   */
+  bool RouteContractionHierarchyGenerator::LoadGraph(const ImportParameter& parameter,
+                                                     Progress& progress,
+                                                     const std::string& dataFilename,
+                                                     const std::vector<ObjectVariantData>& objectVariantData,
+                                                     const RoutingProfile& profile)
+  {
+    struct PendingEdge
+    {
+      uint32_t      from;
+      FileOffset    to;
+      double        cost;
+      uint8_t       flags;
+      ObjectFileRef object;
+    };
+
+    FileScanner              scanner;
+    std::vector<PendingEdge> pendingEdges;
+    Vehicle                  vehicle=profile.GetVehicle();
+
+    nodes.clear();
+    edges.clear();
+
+    try {
+      uint32_t nodeCount;
+
+      scanner.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
+                                   dataFilename),
+                   FileScanner::Sequential,
+                   true);
+
+      scanner.Read(nodeCount);
+
+      nodes.resize(nodeCount);
+
+      for (uint32_t n=0; n<nodeCount; n++) {
+        RouteNode routeNode;
+
+        progress.SetProgress(n,nodeCount);
+
+        routeNode.Read(scanner);
+
+        nodes[n].offset=routeNode.GetFileOffset();
+
+        for (const auto& exclude : routeNode.excludes) {
+          Exclude data;
+
+          data.source=exclude.source;
+          data.target=routeNode.objects[routeNode.paths[exclude.targetIndex].objectIndex].object;
+
+          nodes[n].excludes.push_back(data);
+        }
+
+        if (!nodes[n].excludes.empty()) {
+          nodes[n].core=true;
+        }
+
+        for (size_t i=0; i<routeNode.paths.size(); i++) {
+          const RouteNode::Path& path=routeNode.paths[i];
+
+          if (path.offset==routeNode.GetFileOffset() ||
+              !profile.CanUse(routeNode,objectVariantData,i)) {
+            continue;
+          }
+
+          PendingEdge edge;
+
+          edge.from=n;
+          edge.to=path.offset;
+          edge.cost=profile.GetCosts(routeNode,objectVariantData,i);
+          edge.flags=path.IsRestricted(vehicle) ? RouteContractionHierarchy::restricted : 0;
+          edge.object=routeNode.objects[path.objectIndex].object;
+
+          pendingEdges.push_back(edge);
+        }
+      }
+
+      scanner.Close();
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
+      scanner.CloseFailsafe();
+      return false;
+    }
+
+    // Route nodes are written in the order of their file offset,
+    // so we can resolve target offsets using binary search
+
+    std::vector<FileOffset> offsets(nodes.size());
+
+    for (size_t n=0; n<nodes.size(); n++) {
+      offsets[n]=nodes[n].offset;
+    }
+
+    assert(std::is_sorted(offsets.begin(),offsets.end()));
+
+    for (const auto& pendingEdge : pendingEdges) {
+      auto target=std::lower_bound(offsets.begin(),
+                                   offsets.end(),
+                                   pendingEdge.to);
+
+      if (target==offsets.end() ||
+          *target!=pendingEdge.to) {
+        progress.Error("Cannot resolve route node at offset "+NumberToString(pendingEdge.to));
+        return false;
+      }
+
+      Edge edge;
+
+      edge.from=pendingEdge.from;
+      edge.to=(uint32_t)(target-offsets.begin());
+      edge.cost=pendingEdge.cost;
+      edge.flags=pendingEdge.flags;
+      edge.firstObject=pendingEdge.object;
+      edge.lastObject=pendingEdge.object;
+      edge.firstChild=RouteContractionHierarchy::INVALID_INDEX;
+      edge.secondChild=RouteContractionHierarchy::INVALID_INDEX;
+
+      // Access restrictions are only evaluated for core nodes
+      if (edge.IsRestricted()) {
+        nodes[edge.from].core=true;
+        nodes[edge.to].core=true;
+      }
+
+      AddEdge(edge);
+    }
+
+    progress.Info(NumberToString(nodes.size())+" node(s), "+NumberToString(edges.size())+" edge(s) loaded");
+
+    return true;
+  }
+
+  /**
+   * Add an edge to the graph. If there is already a parallel edge, only
+   * the cheaper one is kept. Parallel edges with different objects are kept
+   * if one of the nodes has turn restrictions.
+   */
+  void RouteContractionHierarchyGenerator::AddEdge(const Edge& edge)
+  {
+    Node& from=nodes[edge.from];
+    Node& to=nodes[edge.to];
+
+    for (const auto existingIndex : from.out) {
+      const Edge& existing=edges[existingIndex];
+
+      if (existing.to!=edge.to ||
+          existing.flags!=edge.flags) {
+        continue;
+      }
+
+      if ((!from.excludes.empty() || !to.excludes.empty()) &&
+          (existing.firstObject!=edge.firstObject ||
+           existing.lastObject!=edge.lastObject)) {
+        continue;
+      }
+
+      if (existing.cost<=edge.cost) {
+        return;
+      }
+
+      RemoveEdge(from.out,existingIndex);
+      RemoveEdge(to.in,existingIndex);
+      break;
+    }
+
+    uint32_t index=(uint32_t)edges.size();
+
+    edges.push_back(edge);
+
+    from.out.push_back(index);
+    to.in.push_back(index);
+  }
+
+  void RouteContractionHierarchyGenerator::RemoveEdge(std::vector<uint32_t>& edgeList,
+                                                      uint32_t edge) const
+  {
+    auto entry=std::find(edgeList.begin(),
+                         edgeList.end(),
+                         edge);
+
+    if (entry!=edgeList.end()) {
+      *entry=edgeList.back();
+      edgeList.pop_back();
+    }
+  }
+
+  /**
+   * Run a local Dijkstra from the given node, ignoring the given node, to find
+   * paths that are at least as cheap as the paths over the ignored node.
+   *
+   * Paths do not pass nodes with turn restrictions or restricted edges, since
+   * these may not be usable during routing.
+   */
+  void RouteContractionHierarchyGenerator::WitnessSearch(uint32_t source,
+                                                         uint32_t ignoredNode,
+                                                         double maxCost)
+  {
+    CostNodeQueue queue;
+    size_t        settledCount=0;
+
+    for (const auto node : witnessTouched) {
+      witnessCost[node]=std::numeric_limits<double>::infinity();
+    }
+
+    witnessTouched.clear();
+
+    witnessCost[source]=0.0;
+    witnessTouched.push_back(source);
+    queue.push(CostNodeEntry(0.0,source));
+
+    while (!queue.empty()) {
+      double   cost=queue.top().first;
+      uint32_t node=queue.top().second;
+
+      queue.pop();
+
+      if (cost>witnessCost[node]) {
+        continue;
+      }
+
+      if (cost>maxCost ||
+          settledCount>=MAX_WITNESS_SETTLED_NODES) {
+        break;
+      }
+
+      settledCount++;
+
+      if (node!=source &&
+          !nodes[node].excludes.empty()) {
+        continue;
+      }
+
+      for (const auto edgeIndex : nodes[node].out) {
+        const Edge& edge=edges[edgeIndex];
+
+        if (edge.to==ignoredNode ||
+            edge.IsRestricted()) {
+          continue;
+        }
+
+        double newCost=cost+edge.cost;
+
+        if (newCost<witnessCost[edge.to]) {
+          if (witnessCost[edge.to]==std::numeric_limits<double>::infinity()) {
+            witnessTouched.push_back(edge.to);
+          }
+
+          witnessCost[edge.to]=newCost;
+          queue.push(CostNodeEntry(newCost,edge.to));
+        }
+      }
+    }
+  }
+
+  /**
+   * Return the shortcuts that would be required if the given node gets
+   * contracted.
+   */
+  void RouteContractionHierarchyGenerator::GetShortcuts(uint32_t node,
+                                                        std::vector<Shortcut>& shortcuts)
+  {
+    const Node& current=nodes[node];
+    double      maxOutCost=0.0;
+
+    shortcuts.clear();
+
+    for (const auto outIndex : current.out) {
+      maxOutCost=std::max(maxOutCost,edges[outIndex].cost);
+    }
+
+    for (const auto inIndex : current.in) {
+      const Edge& in=edges[inIndex];
+
+      // Witness paths do not respect turn restrictions, so we always add the
+      // shortcut if it starts or ends at a node with turn restrictions
+      bool useWitness=nodes[in.from].excludes.empty();
+
+      if (useWitness) {
+        WitnessSearch(in.from,
+                      node,
+                      in.cost+maxOutCost);
+      }
+
+      for (const auto outIndex : current.out) {
+        const Edge& out=edges[outIndex];
+
+        if (out.to==in.from) {
+          continue;
+        }
+
+        if (useWitness &&
+            nodes[out.to].excludes.empty() &&
+            witnessCost[out.to]<=in.cost+out.cost) {
+          continue;
+        }
+
+        Shortcut shortcut;
+
+        shortcut.from=in.from;
+        shortcut.to=out.to;
+        shortcut.firstChild=inIndex;
+        shortcut.secondChild=outIndex;
+
+        shortcuts.push_back(shortcut);
+      }
+    }
+  }
+
+  int RouteContractionHierarchyGenerator::GetPriority(uint32_t node)
+  {
+    std::vector<Shortcut> shortcuts;
+
+    GetShortcuts(node,
+                 shortcuts);
+
+    return (int)shortcuts.size()-
+           (int)(nodes[node].in.size()+nodes[node].out.size())+
+           (int)nodes[node].contractedNeighbours;
+  }
+
+  /**
+   * Remove the node from the remaining graph and add the required
+   * shortcuts between its neighbours.
+   */
+  void RouteContractionHierarchyGenerator::ContractNode(uint32_t node)
+  {
+    std::vector<Shortcut> shortcuts;
+
+    GetShortcuts(node,
+                 shortcuts);
+
+    Node& current=nodes[node];
+
+    for (const auto inIndex : current.in) {
+      Node& neighbour=nodes[edges[inIndex].from];
+
+      current.backward.push_back(inIndex);
+      RemoveEdge(neighbour.out,inIndex);
+      neighbour.contractedNeighbours++;
+    }
+
+    for (const auto outIndex : current.out) {
+      Node& neighbour=nodes[edges[outIndex].to];
+
+      current.forward.push_back(outIndex);
+      RemoveEdge(neighbour.in,outIndex);
+      neighbour.contractedNeighbours++;
+    }
+
+    current.in.clear();
+    current.out.clear();
+    current.contracted=true;
+
+    for (const auto& shortcut : shortcuts) {
+      Edge edge;
+
+      edge.from=shortcut.from;
+      edge.to=shortcut.to;
+      edge.cost=edges[shortcut.firstChild].cost+edges[shortcut.secondChild].cost;
+      edge.flags=0;
+      edge.firstObject=edges[shortcut.firstChild].firstObject;
+      edge.lastObject=edges[shortcut.secondChild].lastObject;
+      edge.firstChild=shortcut.firstChild;
+      edge.secondChild=shortcut.secondChild;
+
+      AddEdge(edge);
+    }
+  }
+
+  void RouteContractionHierarchyGenerator::Contract(Progress& progress)
+  {
+    PriorityNodeQueue queue;
+    size_t            originalEdgeCount=edges.size();
+    size_t            candidateCount=0;
+    size_t            contractedCount=0;
+
+    witnessCost.assign(nodes.size(),std::numeric_limits<double>::infinity());
+    witnessTouched.clear();
+
+    progress.Info("Calculating initial node order");
+
+    for (uint32_t n=0; n<nodes.size(); n++) {
+      if (!nodes[n].core) {
+        queue.push(PriorityNodeEntry(GetPriority(n),n));
+        candidateCount++;
+      }
+    }
+
+    progress.Info("Contracting "+NumberToString(candidateCount)+" of "+NumberToString(nodes.size())+" node(s)");
+
+    // Priorities of neighbours change during contraction, we lazily
+    // update them when they reach the top of the queue
+    while (!queue.empty()) {
+      uint32_t node=queue.top().second;
+
+      queue.pop();
+
+      if (nodes[node].contracted) {
+        continue;
+      }
+
+      int priority=GetPriority(node);
+
+      if (!queue.empty() &&
+          priority>queue.top().first) {
+        queue.push(PriorityNodeEntry(priority,node));
+        continue;
+      }
+
+      ContractNode(node);
+
+      contractedCount++;
+      progress.SetProgress(contractedCount,candidateCount);
+    }
+
+    // Remaining nodes build the core, all their edges are usable in both directions
+
+    for (auto& node : nodes) {
+      if (!node.contracted) {
+        node.forward=node.out;
+        node.backward=node.in;
+      }
+    }
+
+    progress.Info(NumberToString(edges.size()-originalEdgeCount)+" shortcut(s) added");
+  }
+
+  bool RouteContractionHierarchyGenerator::WriteHierarchy(Progress& progress,
+                                                          const std::string& filename,
+                                                          Vehicle vehicle,
+                                                          const std::vector<double>& variantCosts) const
+  {
+    FileWriter writer;
+
+    try {
+      writer.Open(filename);
+
+      writer.Write((uint8_t)vehicle);
+
+      writer.Write((uint32_t)variantCosts.size());
+
+      for (const auto cost : variantCosts) {
+        writer.Write(RouteContractionHierarchy::EncodeCost(cost));
+      }
+
+      writer.Write((uint32_t)nodes.size());
+
+      for (const auto& node : nodes) {
+        writer.WriteFileOffset(node.offset);
+
+        writer.WriteNumber((uint32_t)node.excludes.size());
+
+        for (const auto& exclude : node.excludes) {
+          writer.Write(exclude.source);
+          writer.Write(exclude.target);
+        }
+
+        writer.WriteNumber((uint32_t)node.forward.size());
+
+        for (const auto edge : node.forward) {
+          writer.WriteNumber(edge);
+        }
+
+        writer.WriteNumber((uint32_t)node.backward.size());
+
+        for (const auto edge : node.backward) {
+          writer.WriteNumber(edge);
+        }
+      }
+
+      writer.Write((uint32_t)edges.size());
+
+      for (const auto& edge : edges) {
+        writer.WriteNumber(edge.from);
+        writer.WriteNumber(edge.to);
+        writer.Write(RouteContractionHierarchy::EncodeCost(edge.cost));
+        writer.Write(edge.flags);
+        writer.Write(edge.firstObject);
+        writer.Write(edge.lastObject);
+        writer.WriteNumber(edge.firstChild);
+        writer.WriteNumber(edge.secondChild);
+      }
+
+      writer.Close();
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
+      writer.CloseFailsafe();
+      return false;
+    }
+
+    return true;
+  }
+
+  bool RouteContractionHierarchyGenerator::Import(const TypeConfigRef& typeConfig,
+                                                  const ImportParameter& parameter,
+                                                  Progress& progress)
+  {
+    if (!parameter.GetRouteContractionHierarchy()) {
+      progress.Info("Generation of contraction hierarchies is disabled");
+      return true;
+    }
+
+    for (const auto& router : parameter.GetRouter()) {
+      ObjectVariantDataFile objectVariantDataFile;
+
+      if (!objectVariantDataFile.Load(*typeConfig,
+                                      AppendFileToDir(parameter.GetDestinationDirectory(),
+                                                      router.GetVariantFilename()))) {
+        progress.Error("Cannot load object variant data of router '"+router.GetFilenamebase()+"'");
+        return false;
+      }
+
+      for (const auto vehicle : {vehicleFoot,vehicleBicycle,vehicleCar}) {
+        if ((router.GetVehicleMask() & vehicle)==0) {
+          continue;
+        }
+
+        std::string filename=AppendFileToDir(parameter.GetDestinationDirectory(),
+                                             RouteContractionHierarchy::GetFilename(router.GetFilenamebase(),
+                                                                                    vehicle));
+
+        progress.SetAction("Generating contraction hierarchy '"+filename+"'");
+
+        RoutingProfileRef profile=CreateProfile(typeConfig,
+                                                parameter,
+                                                progress,
+                                                vehicle);
+
+        if (!profile) {
+          return false;
+        }
+
+        if (!LoadGraph(parameter,
+                       progress,
+                       router.GetDataFilename(),
+                       objectVariantDataFile.GetData(),
+                       *profile)) {
+          return false;
+        }
+
+        Contract(progress);
+
+        std::vector<double> variantCosts;
+
+        RouteContractionHierarchy::GetVariantCosts(*profile,
+                                                   objectVariantDataFile.GetData(),
+                                                   variantCosts);
+
+        if (!WriteHierarchy(progress,
+                            filename,
+                            vehicle,
+                            variantCosts)) {
+          return false;
+        }
+
+        nodes.clear();
+        edges.clear();
+        witnessCost.clear();
+        witnessTouched.clear();
+      }
+    }
+
+    return true;
+  }
+}
@@ -20,16 +20,24 @@
 #include <osmscout/import/GenRouteDat.h>
 
 #include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <queue>
 
 #include <osmscout/ObjectRef.h>
 
 #include <osmscout/CoordDataFile.h>
 
+#include <osmscout/CompactRouteGraph.h>
 #include <osmscout/RoutingService.h>
 
 #include <osmscout/system/Assert.h>
 #include <osmscout/system/Math.h>
 
+#include <osmscout/util/File.h>
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
 #include <osmscout/util/Geometry.h>
 #include <osmscout/util/StopClock.h>
 #include <osmscout/util/String.h>
@@ -40,6 +48,352 @@
 
 namespace osmscout {
 
+  /**
+   * Sort the given list of (id, value) pairs by id and remove duplicate ids
+   */
+  template<typename L>
+  static void SortIdList(L& list)
+  {
+    std::sort(list.begin(),
+              list.end(),
+              [](const typename L::value_type& a,
+                 const typename L::value_type& b) {
+      return a.first<b.first;
+    });
+
+    list.erase(std::unique(list.begin(),
+                           list.end(),
+                           [](const typename L::value_type& a,
+                              const typename L::value_type& b) {
+                 return a.first==b.first;
+               }),
+               list.end());
+  }
+
+  /**
+   * Return the entry with the given id from a list of (id, value) pairs sorted by id
+   * or list.end(), if there is no such entry
+   */
+  template<typename L, typename I>
+  static auto FindIdEntry(L& list,
+                          I id) -> decltype(list.begin())
+  {
+    auto entry=std::lower_bound(list.begin(),
+                                list.end(),
+                                id,
+                                [](const typename L::value_type& a,
+                                   I b) {
+      return a.first<b;
+    });
+
+    if (entry!=list.end() &&
+        entry->first==id) {
+      return entry;
+    }
+
+    return list.end();
+  }
+
+  /**
+   * Sort the given vector and remove duplicates
+   */
+  template<typename T>
+  static void SortUnique(std::vector<T>& values)
+  {
+    std::sort(values.begin(),
+              values.end());
+
+    values.erase(std::unique(values.begin(),
+                             values.end()),
+                 values.end());
+  }
+
+  /**
+   * Sorts a sequence of plain values, that does not need to fit into memory.
+   *
+   * Values are collected in a buffer limited by the given memory budget. If
+   * the buffer is full, it is sorted and written to a run file. Scan() merges
+   * the runs and passes all values in sort order to the consumer. Run files
+   * are named after the given filename and get deleted after merging.
+   */
+  template<typename T, typename Less>
+  class ExternalSorter
+  {
+  private:
+    static const size_t MAX_MERGE_RUNS=64;
+
+    struct Run
+    {
+      std::string filename;
+      size_t      count;
+    };
+
+    /**
+     * Reads the values of a run in blocks
+     */
+    struct RunReader
+    {
+      FileScanner    scanner;
+      size_t         remaining;
+      std::vector<T> buffer;
+      size_t         current;
+
+      bool Next()
+      {
+        current++;
+
+        if (current<buffer.size()) {
+          return true;
+        }
+
+        if (remaining==0) {
+          return false;
+        }
+
+        buffer.resize(std::min(remaining,buffer.capacity()));
+        scanner.Read((char*)buffer.data(),
+                     buffer.size()*sizeof(T));
+
+        remaining-=buffer.size();
+        current=0;
+
+        return true;
+      }
+
+      const T& Get() const
+      {
+        return buffer[current];
+      }
+    };
+
+    typedef std::shared_ptr<RunReader> RunReaderRef;
+
+  private:
+    std::string              filename;       //!< Base name of the run files
+    size_t                   bufferCapacity; //!< Maximum number of values in memory
+    Less                     less;
+    std::vector<T>           buffer;
+    std::vector<Run>         runs;
+    std::vector<std::string> runFilenames;   //!< All run files written so far
+
+  private:
+    /**
+     * Sorts the buffer and writes it to a new run file.
+     *
+     * @throws IOException
+     */
+    void WriteRun()
+    {
+      FileWriter writer;
+      Run        run;
+
+      std::sort(buffer.begin(),
+                buffer.end(),
+                less);
+
+      run.filename=filename+"."+NumberToString(runFilenames.size())+".run";
+      run.count=buffer.size();
+
+      runFilenames.push_back(run.filename);
+      runs.push_back(run);
+
+      writer.Open(run.filename);
+      writer.Write((const char*)buffer.data(),
+                   buffer.size()*sizeof(T));
+      writer.Close();
+
+      buffer.clear();
+    }
+
+    /**
+     * Merges the given runs and passes all values in sort order to the consumer.
+     * Each run is read in blocks of bufferSize values.
+     *
+     * @throws IOException
+     */
+    void MergeRuns(const std::vector<Run>& mergeRuns,
+                   size_t bufferSize,
+                   const std::function<void(const T&)>& consumer)
+    {
+      auto greater=[this](const RunReaderRef& a, const RunReaderRef& b) {
+        return less(b->Get(),a->Get());
+      };
+
+      std::vector<RunReaderRef>                   readers;
+      std::priority_queue<RunReaderRef,
+                          std::vector<RunReaderRef>,
+                          decltype(greater)>      queue(greater);
+
+      try {
+        for (const auto& run : mergeRuns) {
+          RunReaderRef reader=std::make_shared<RunReader>();
+
+          readers.push_back(reader);
+
+          reader->scanner.Open(run.filename,
+                               FileScanner::Sequential,
+                               false);
+          reader->remaining=run.count;
+          reader->buffer.reserve(std::max((size_t)1,bufferSize));
+          reader->current=0;
+
+          if (reader->Next()) {
+            queue.push(reader);
+          }
+        }
+
+        while (!queue.empty()) {
+          RunReaderRef reader=queue.top();
+
+          queue.pop();
+
+          consumer(reader->Get());
+
+          if (reader->Next()) {
+            queue.push(reader);
+          }
+        }
+
+        for (auto& reader : readers) {
+          reader->scanner.Close();
+        }
+      }
+      catch (IOException& e) {
+        for (auto& reader : readers) {
+          reader->scanner.CloseFailsafe();
+        }
+
+        throw;
+      }
+
+      for (const auto& run : mergeRuns) {
+        RemoveFile(run.filename);
+      }
+    }
+
+  public:
+    ExternalSorter(const std::string& filename,
+                   size_t memoryBudget,
+                   const Less& less)
+    : filename(filename),
+      bufferCapacity(std::max((size_t)1,memoryBudget/sizeof(T))),
+      less(less)
+    {
+      // no code
+    }
+
+    ~ExternalSorter()
+    {
+      for (const auto& runFilename : runFilenames) {
+        if (ExistsInFilesystem(runFilename)) {
+          RemoveFile(runFilename);
+        }
+      }
+    }
+
+    /**
+     * Adds a value. If the buffer is full, it is written to a run file first.
+     *
+     * @throws IOException
+     */
+    void Add(const T& value)
+    {
+      if (buffer.size()==bufferCapacity) {
+        WriteRun();
+      }
+
+      // Grow geometrically, but never beyond the memory budget
+      if (buffer.size()==buffer.capacity()) {
+        buffer.reserve(std::min(bufferCapacity,
+                                std::max((size_t)16,2*buffer.capacity())));
+      }
+
+      buffer.push_back(value);
+    }
+
+    /**
+     * Returns the number of run files written so far
+     */
+    size_t GetRunCount() const
+    {
+      return runFilenames.size();
+    }
+
+    /**
+     * Passes all values in sort order to the consumer. If there are more than
+     * MAX_MERGE_RUNS runs, runs are first merged into larger runs.
+     *
+     * @throws IOException
+     */
+    void Scan(const std::function<void(const T&)>& consumer)
+    {
+      if (runs.empty()) {
+        std::sort(buffer.begin(),
+                  buffer.end(),
+                  less);
+
+        for (const auto& value : buffer) {
+          consumer(value);
+        }
+
+        return;
+      }
+
+      if (!buffer.empty()) {
+        WriteRun();
+      }
+
+      buffer.shrink_to_fit();
+
+      while (runs.size()>MAX_MERGE_RUNS) {
+        std::vector<Run> currentRuns;
+
+        currentRuns.swap(runs);
+
+        for (size_t r=0; r<currentRuns.size(); r+=MAX_MERGE_RUNS) {
+          std::vector<Run> group(currentRuns.begin()+r,
+                                 currentRuns.begin()+std::min(currentRuns.size(),r+MAX_MERGE_RUNS));
+          FileWriter       writer;
+          Run              run;
+
+          run.filename=filename+"."+NumberToString(runFilenames.size())+".run";
+          run.count=0;
+
+          for (const auto& groupRun : group) {
+            run.count+=groupRun.count;
+          }
+
+          runFilenames.push_back(run.filename);
+
+          try {
+            writer.Open(run.filename);
+
+            MergeRuns(group,
+                      bufferCapacity/(group.size()+1),
+                      [&writer](const T& value) {
+                        writer.Write((const char*)&value,
+                                     sizeof(T));
+                      });
+
+            writer.Close();
+          }
+          catch (IOException& e) {
+            writer.CloseFailsafe();
+            throw;
+          }
+
+          runs.push_back(run);
+        }
+      }
+
+      MergeRuns(runs,
+                bufferCapacity/(runs.size()+1),
+                consumer);
+
+      runs.clear();
+    }
+  };
+
   RouteDataGenerator::RouteDataGenerator()
   {
     // no code
@@ -64,6 +418,10 @@ namespace osmscout {
       description.AddProvidedFile(router.GetDataFilename());
       description.AddProvidedFile(router.GetVariantFilename());
       description.AddProvidedFile(router.GetIndexFilename());
+
+      if (parameter.GetRouteCompactGraph()) {
+        description.AddProvidedFile(CompactRouteGraph::GetFilename(router.GetFilenamebase()));
+      }
     }
 
     description.AddProvidedFile(RoutingService::FILENAME_INTERSECTIONS_DAT);
@@ -237,7 +595,7 @@ namespace osmscout {
   }
 
   bool RouteDataGenerator::IsAnyRoutable(Progress& progress,
-                                         const std::list<ObjectFileRef>& objects,
+                                         const std::vector<ObjectFileRef>& objects,
                                          const std::unordered_map<FileOffset,WayRef>& waysMap,
                                          const std::unordered_map<FileOffset,AreaRef>&  areasMap,
                                          VehicleMask vehicles) const
@@ -279,8 +637,8 @@ namespace osmscout {
 
   bool RouteDataGenerator::ReadTurnRestrictionIds(const ImportParameter& parameter,
                                                   Progress& progress,
-                                                  std::map<OSMId,FileOffset>& wayIdOffsetMap,
-                                                  std::map<OSMId,Id>& nodeIdMap)
+                                                  OSMIdOffsetList& wayIdOffsetList,
+                                                  OSMIdIdList& nodeIdList)
   {
     FileScanner scanner;
     uint32_t    restrictionCount=0;
@@ -302,13 +660,16 @@ namespace osmscout {
 
         restriction->Read(scanner);
 
-        wayIdOffsetMap.insert(std::make_pair(restriction->GetFrom(),0));
-        wayIdOffsetMap.insert(std::make_pair(restriction->GetTo(),0));
+        wayIdOffsetList.push_back(std::make_pair(restriction->GetFrom(),0));
+        wayIdOffsetList.push_back(std::make_pair(restriction->GetTo(),0));
 
-        nodeIdMap.insert(std::make_pair(restriction->GetVia(),0));
+        nodeIdList.push_back(std::make_pair(restriction->GetVia(),0));
       }
 
       scanner.Close();
+
+      SortIdList(wayIdOffsetList);
+      SortIdList(nodeIdList);
     }
     catch (IOException& e) {
       progress.Error(e.GetDescription());
@@ -320,7 +681,7 @@ namespace osmscout {
 
   bool RouteDataGenerator::ResolveWayIds(const ImportParameter& parameter,
                                          Progress& progress,
-                                         std::map<OSMId,FileOffset>& wayIdOffsetMap)
+                                         OSMIdOffsetList& wayIdOffsetList)
   {
     FileScanner scanner;
     uint32_t    wayCount=0;
@@ -355,17 +716,16 @@ namespace osmscout {
           continue;
         }
 
-        std::map<OSMId,FileOffset>::iterator idOffsetEntry;
-
-        idOffsetEntry=wayIdOffsetMap.find(wayId);
+        auto idOffsetEntry=FindIdEntry(wayIdOffsetList,
+                                       wayId);
 
-        if (idOffsetEntry!=wayIdOffsetMap.end()) {
+        if (idOffsetEntry!=wayIdOffsetList.end()) {
           idOffsetEntry->second=wayOffset;
           resolveCount++;
         }
       }
 
-      progress.Info(NumberToString(wayIdOffsetMap.size())+" turn restriction way(s) found, "+NumberToString(resolveCount)+" way(s) resolved");
+      progress.Info(NumberToString(wayIdOffsetList.size())+" turn restriction way(s) found, "+NumberToString(resolveCount)+" way(s) resolved");
 
       scanner.Close();
     }
@@ -379,7 +739,7 @@ namespace osmscout {
 
   bool RouteDataGenerator::ResolveNodeIds(const ImportParameter& parameter,
                                           Progress& progress,
-                                          std::map<OSMId,Id>& nodeIdMap)
+                                          OSMIdIdList& nodeIdList)
   {
     progress.Info("Resolving turn restriction OSM node ids to node ids");
 
@@ -392,11 +752,13 @@ namespace osmscout {
       return false;
     }
 
-    std::set<OSMId>          nodeIds;
+    std::vector<OSMId>       nodeIds;
     CoordDataFile::ResultMap coordsMap;
 
-    for (const auto& entry : nodeIdMap) {
-      nodeIds.insert(entry.first);
+    nodeIds.reserve(nodeIdList.size());
+
+    for (const auto& entry : nodeIdList) {
+      nodeIds.push_back(entry.first);
     }
 
     if (!coordDataFile.Get(nodeIds,
@@ -406,9 +768,10 @@ namespace osmscout {
     }
 
     for (const auto& entry : coordsMap) {
-      auto nodeIdEntry=nodeIdMap.find(entry.first);
+      auto nodeIdEntry=FindIdEntry(nodeIdList,
+                                   entry.first);
 
-      if (nodeIdEntry!=nodeIdMap.end()) {
+      if (nodeIdEntry!=nodeIdList.end()) {
         nodeIdEntry->second=entry.second.GetOSMScoutId();
         resolveCount++;
       }
@@ -426,8 +789,8 @@ namespace osmscout {
 
   bool RouteDataGenerator::ReadTurnRestrictionData(const ImportParameter& parameter,
                                                    Progress& progress,
-                                                   const std::map<OSMId,Id>& nodeIdMap,
-                                                   const std::map<OSMId,FileOffset>& wayIdOffsetMap,
+                                                   const OSMIdIdList& nodeIdList,
+                                                   const OSMIdOffsetList& wayIdOffsetList,
                                                    ViaTurnRestrictionMap& restrictions)
   {
     FileScanner scanner;
@@ -450,14 +813,15 @@ namespace osmscout {
 
         restriction->Read(scanner);
 
-        TurnRestrictionData                        data;
-        std::map<OSMId,FileOffset>::const_iterator idOffsetEntry;
-        std::map<OSMId,Id>::const_iterator         nodeIdEntry;
+        TurnRestrictionData                     data;
+        OSMIdOffsetList::const_iterator         idOffsetEntry;
+        OSMIdIdList::const_iterator             nodeIdEntry;
 
 
-        idOffsetEntry=wayIdOffsetMap.find(restriction->GetFrom());
+        idOffsetEntry=FindIdEntry(wayIdOffsetList,
+                                  restriction->GetFrom());
 
-        if (idOffsetEntry==wayIdOffsetMap.end() || idOffsetEntry->second==0) {
+        if (idOffsetEntry==wayIdOffsetList.end() || idOffsetEntry->second==0) {
           progress.Error(std::string("Error while retrieving way offset for way id ")+
                          NumberToString(restriction->GetFrom()));
           continue;
@@ -465,9 +829,10 @@ namespace osmscout {
 
         data.fromWayOffset=idOffsetEntry->second;
 
-        nodeIdEntry=nodeIdMap.find(restriction->GetVia());
+        nodeIdEntry=FindIdEntry(nodeIdList,
+                                restriction->GetVia());
 
-        if (nodeIdEntry==nodeIdMap.end() || nodeIdEntry->second==0) {
+        if (nodeIdEntry==nodeIdList.end() || nodeIdEntry->second==0) {
           progress.Error(std::string("Error while retrieving node id for node OSM id ")+
                          NumberToString(restriction->GetVia()));
           continue;
@@ -475,9 +840,10 @@ namespace osmscout {
 
         data.viaNodeId=nodeIdEntry->second;
 
-        idOffsetEntry=wayIdOffsetMap.find(restriction->GetTo());
+        idOffsetEntry=FindIdEntry(wayIdOffsetList,
+                                  restriction->GetTo());
 
-        if (idOffsetEntry==wayIdOffsetMap.end() || idOffsetEntry->second==0) {
+        if (idOffsetEntry==wayIdOffsetList.end() || idOffsetEntry->second==0) {
           progress.Error(std::string("Error while retrieving way offset for way id ")+
                          NumberToString(restriction->GetTo()));
           continue;
@@ -513,8 +879,8 @@ namespace osmscout {
                                                 Progress& progress,
                                                 ViaTurnRestrictionMap& restrictions)
   {
-    std::map<OSMId,FileOffset> wayIdOffsetMap;
-    std::map<OSMId,Id>         nodeIdMap;
+    OSMIdOffsetList wayIdOffsetList;
+    OSMIdIdList     nodeIdList;
 
     //
     // Just read the way ids
@@ -522,8 +888,8 @@ namespace osmscout {
 
     if (!ReadTurnRestrictionIds(parameter,
                                 progress,
-                                wayIdOffsetMap,
-                                nodeIdMap)) {
+                                wayIdOffsetList,
+                                nodeIdList)) {
       return false;
     }
 
@@ -533,7 +899,7 @@ namespace osmscout {
 
     if (!ResolveWayIds(parameter,
                        progress,
-                       wayIdOffsetMap)) {
+                       wayIdOffsetList)) {
       return false;
     }
 
@@ -543,7 +909,7 @@ namespace osmscout {
 
     if (!ResolveNodeIds(parameter,
                         progress,
-                        nodeIdMap)) {
+                        nodeIdList)) {
       return false;
     }
 
@@ -553,8 +919,8 @@ namespace osmscout {
 
     if (!ReadTurnRestrictionData(parameter,
                                  progress,
-                                 nodeIdMap,
-                                 wayIdOffsetMap,
+                                 nodeIdList,
+                                 wayIdOffsetList,
                                  restrictions)) {
       return false;
     }
@@ -600,10 +966,17 @@ namespace osmscout {
   bool RouteDataGenerator::ReadIntersections(const ImportParameter& parameter,
                                              Progress& progress,
                                              const TypeConfig& typeConfig,
-                                             NodeUseMap& nodeUseMap)
+                                             std::vector<Id>& junctionIds)
   {
-    FileScanner scanner;
-    uint32_t    dataCount=0;
+    FileScanner                      scanner;
+    uint32_t                         dataCount=0;
+    std::vector<Id>                  nodeIds;
+    size_t                           nodeCount=0;
+    // The ids of the nodes of all objects, once per object
+    ExternalSorter<Id,std::less<Id>> objectNodeIds(AppendFileToDir(parameter.GetDestinationDirectory(),
+                                                                   "routenodeids"),
+                                                   parameter.GetRouteNodeMemoryBudget(),
+                                                   std::less<Id>());
 
     progress.Info("Scanning ways");
 
@@ -631,19 +1004,18 @@ namespace osmscout {
           continue;
         }
 
-        std::set<Id> nodeIds;
+        nodeIds.clear();
 
         for (const auto& node : way.nodes) {
-          if (!node.IsRelevant()) {
-            continue;
+          if (node.IsRelevant()) {
+            nodeIds.push_back(node.GetId());
           }
+        }
 
-          Id id=node.GetId();
+        SortUnique(nodeIds);
 
-          if (nodeIds.find(id)==nodeIds.end()) {
-            nodeUseMap.SetNodeUsed(id);
-            nodeIds.insert(id);
-          }
+        for (const auto id : nodeIds) {
+          objectNodeIds.Add(id);
         }
       }
 
@@ -679,46 +1051,102 @@ namespace osmscout {
           continue;
         }
 
-        std::set<Id> nodeIds;
+        nodeIds.clear();
 
         for (const auto& node : area.rings.front().nodes) {
-          if (!node.IsRelevant()) {
-            continue;
+          if (node.IsRelevant()) {
+            nodeIds.push_back(node.GetId());
           }
+        }
 
-          Id id=node.GetId();
-
-          if (nodeIds.find(id)==nodeIds.end()) {
-            nodeUseMap.SetNodeUsed(id);
+        SortUnique(nodeIds);
 
-            nodeIds.insert(id);
-          }
+        for (const auto id : nodeIds) {
+          objectNodeIds.Add(id);
         }
       }
 
       scanner.Close();
 
-      progress.Info("Found "+NumberToString(nodeUseMap.GetNodeUsedCount())+" possible routing nodes, "+
-                    NumberToString(nodeUseMap.GetDuplicateCount())+" at least used twice");
+      if (objectNodeIds.GetRunCount()>0) {
+        progress.Info("Merging "+NumberToString(objectNodeIds.GetRunCount())+" runs of node ids");
+      }
+
+      // A node is a junction, if it is used by at least two objects
+      bool hasLastId=false;
+      Id   lastId=0;
+
+      objectNodeIds.Scan([&junctionIds,&nodeCount,&hasLastId,&lastId](const Id& id) {
+        if (!hasLastId ||
+            id!=lastId) {
+          nodeCount++;
+        }
+        else if (junctionIds.empty() ||
+                 junctionIds.back()!=id) {
+          junctionIds.push_back(id);
+        }
+
+        lastId=id;
+        hasLastId=true;
+      });
     }
     catch (IOException& e) {
       progress.Error(e.GetDescription());
+      scanner.CloseFailsafe();
       return false;
     }
 
+    progress.Info("Found "+NumberToString(nodeCount)+" possible routing nodes, "+
+                  NumberToString(junctionIds.size())+" at least used twice");
+
     return true;
   }
 
+  /**
+   * An object using a junction node
+   */
+  struct JunctionObject
+  {
+    Id            id;
+    ObjectFileRef object;
+  };
+
+  /**
+   * Orders junction objects by node id, objects at the same node in scan order,
+   * which is ways before areas, both by increasing file offset
+   */
+  struct JunctionObjectLess
+  {
+    inline bool operator()(const JunctionObject& a,
+                           const JunctionObject& b) const
+    {
+      if (a.id!=b.id) {
+        return a.id<b.id;
+      }
+
+      if (a.object.type!=b.object.type) {
+        return a.object.type==refWay;
+      }
+
+      return a.object.offset<b.object.offset;
+    }
+  };
+
   bool RouteDataGenerator::ReadObjectsAtIntersections(const ImportParameter& parameter,
                                                       Progress& progress,
                                                       const TypeConfig& typeConfig,
-                                                      const NodeUseMap& nodeUseMap,
-                                                      NodeIdObjectsMap& nodeObjectsMap)
+                                                      const std::vector<Id>& junctionIds,
+                                                      NodeIdObjectsList& nodeObjectsList)
   {
-    FileScanner scanner;
-    uint32_t    dataCount=0;
-    uint32_t    junctionWayCount=0;
-    uint32_t    junctionAreaCount=0;
+    FileScanner                                       scanner;
+    uint32_t                                          dataCount=0;
+    uint32_t                                          junctionWayCount=0;
+    uint32_t                                          junctionAreaCount=0;
+    std::vector<Id>                                   nodeIds;
+    ExternalSorter<JunctionObject,JunctionObjectLess> nodeObjects(AppendFileToDir(parameter.GetDestinationDirectory(),
+                                                                                  "routenodeobjects"),
+                                                                  parameter.GetRouteNodeMemoryBudget(),
+                                                                  JunctionObjectLess());
 
     progress.Info("Scanning ways");
 
@@ -749,23 +1177,27 @@ namespace osmscout {
           continue;
         }
 
-        std::set<Id> nodeIds;
+        nodeIds.clear();
 
-        for (auto& node : way.nodes) {
-          if (!node.IsRelevant()) {
-            continue;
+        for (const auto& node : way.nodes) {
+          if (node.IsRelevant() &&
+              std::binary_search(junctionIds.begin(),
+                                 junctionIds.end(),
+                                 node.GetId())) {
+            nodeIds.push_back(node.GetId());
           }
+        }
 
-          Id id=node.GetId();
+        SortUnique(nodeIds);
 
-          if (nodeIds.find(id)==nodeIds.end()) {
-            if (nodeUseMap.IsNodeUsedAtLeastTwice(id)) {
-              nodeObjectsMap[id].push_back(ObjectFileRef(fileOffset,refWay));
-              junctionWayCount++;
-            }
+        for (const auto id : nodeIds) {
+          JunctionObject junctionObject;
 
-            nodeIds.insert(id);
-          }
+          junctionObject.id=id;
+          junctionObject.object.Set(fileOffset,refWay);
+
+          nodeObjects.Add(junctionObject);
+          junctionWayCount++;
         }
       }
 
@@ -804,42 +1236,61 @@ namespace osmscout {
           continue;
         }
 
-        std::set<Id> nodeIds;
+        nodeIds.clear();
 
-        for (auto& node : area.rings.front().nodes) {
-          if (!node.IsRelevant()) {
-            continue;
+        for (const auto& node : area.rings.front().nodes) {
+          if (node.IsRelevant() &&
+              std::binary_search(junctionIds.begin(),
+                                 junctionIds.end(),
+                                 node.GetId())) {
+            nodeIds.push_back(node.GetId());
           }
+        }
 
-          Id id=node.GetId();
+        SortUnique(nodeIds);
 
-          if (nodeIds.find(id)==nodeIds.end()) {
-            if (nodeUseMap.IsNodeUsedAtLeastTwice(id)) {
-              nodeObjectsMap[id].push_back(ObjectFileRef(fileOffset,refArea));
-              junctionAreaCount++;
-            }
+        for (const auto id : nodeIds) {
+          JunctionObject junctionObject;
 
-            nodeIds.insert(id);
-          }
+          junctionObject.id=id;
+          junctionObject.object.Set(fileOffset,refArea);
+
+          nodeObjects.Add(junctionObject);
+          junctionAreaCount++;
         }
       }
 
-      progress.Info("Found "+NumberToString(nodeObjectsMap.size())+" routing nodes, with in sum "+
-                    NumberToString(junctionWayCount)+" ways and "+NumberToString(junctionAreaCount)+" areas");
-
       scanner.Close();
+
+      if (nodeObjects.GetRunCount()>0) {
+        progress.Info("Merging "+NumberToString(nodeObjects.GetRunCount())+" runs of junction objects");
+      }
+
+      // Group the objects by node id
+      nodeObjects.Scan([&nodeObjectsList](const JunctionObject& junctionObject) {
+        if (nodeObjectsList.empty() ||
+            nodeObjectsList.back().first!=junctionObject.id) {
+          nodeObjectsList.push_back(std::make_pair(junctionObject.id,std::vector<ObjectFileRef>()));
+        }
+
+        nodeObjectsList.back().second.push_back(junctionObject.object);
+      });
     }
     catch (IOException& e) {
       progress.Error(e.GetDescription());
+      scanner.CloseFailsafe();
       return false;
     }
 
+    progress.Info("Found "+NumberToString(nodeObjectsList.size())+" routing nodes, with in sum "+
+                  NumberToString(junctionWayCount)+" ways and "+NumberToString(junctionAreaCount)+" areas");
+
     return true;
   }
 
   bool RouteDataGenerator::WriteIntersections(const ImportParameter& parameter,
                                               Progress& progress,
-                                              NodeIdObjectsMap& nodeIdObjectsMap)
+                                              NodeIdObjectsList& nodeIdObjectsList)
   {
     FileWriter writer;
 
@@ -847,9 +1298,9 @@ namespace osmscout {
       writer.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
                                   RoutingService::FILENAME_INTERSECTIONS_DAT));
 
-      writer.Write((uint32_t)nodeIdObjectsMap.size());
+      writer.Write((uint32_t)nodeIdObjectsList.size());
 
-      for (const auto& junction : nodeIdObjectsMap) {
+      for (const auto& junction : nodeIdObjectsList) {
 
         writer.WriteNumber(junction.first);
         writer.WriteNumber((uint32_t)junction.second.size());
@@ -874,7 +1325,7 @@ namespace osmscout {
   bool RouteDataGenerator::LoadWays(const TypeConfig& typeConfig,
                                     Progress& progress,
                                     FileScanner& scanner,
-                                    const std::set<FileOffset>& fileOffsets,
+                                    const std::vector<FileOffset>& fileOffsets,
                                     std::unordered_map<FileOffset,WayRef>& waysMap)
   {
     if (fileOffsets.empty()) {
@@ -911,7 +1362,7 @@ namespace osmscout {
   bool RouteDataGenerator::LoadAreas(const TypeConfig& typeConfig,
                                      Progress& progress,
                                      FileScanner& scanner,
-                                     const std::set<FileOffset>& fileOffsets,
+                                     const std::vector<FileOffset>& fileOffsets,
                                      std::unordered_map<FileOffset,AreaRef>& areasMap)
   {
     if (fileOffsets.empty()) {
@@ -947,7 +1398,7 @@ namespace osmscout {
 
   bool RouteDataGenerator::GetRouteNodePoint(Progress& progress,
                                              Id id,
-                                             const std::list<ObjectFileRef>& objects,
+                                             const std::vector<ObjectFileRef>& objects,
                                              std::unordered_map<FileOffset,WayRef>& waysMap,
                                              std::unordered_map<FileOffset,AreaRef>& areasMap,
                                              Point& point) const
@@ -1051,7 +1502,7 @@ namespace osmscout {
                                               const Area& area,
                                               uint16_t objectVariantIndex,
                                               FileOffset routeNodeOffset,
-                                              const NodeIdObjectsMap& nodeObjectsMap,
+                                              const NodeIdObjectsList& nodeObjectsList,
                                               const NodeIdOffsetMap& nodeIdOffsetMap,
                                               PendingRouteNodeOffsetsMap& pendingOffsetsMap)
   {
@@ -1082,7 +1533,7 @@ namespace osmscout {
                                   ring.nodes[nextNode].GetLat());
 
     while (nextNode!=currentNode &&
-           nodeObjectsMap.find(ring.GetId(nextNode))==nodeObjectsMap.end()) {
+           FindIdEntry(nodeObjectsList,ring.GetId(nextNode))==nodeObjectsList.end()) {
       int lastNode=nextNode;
       nextNode++;
 
@@ -1139,7 +1590,7 @@ namespace osmscout {
                                   ring.nodes[prevNode].GetLat());
 
     while (prevNode!=currentNode &&
-        nodeObjectsMap.find(ring.GetId(prevNode))==nodeObjectsMap.end()) {
+        FindIdEntry(nodeObjectsList,ring.GetId(prevNode))==nodeObjectsList.end()) {
       int lastNode=prevNode;
       prevNode--;
 
@@ -1189,7 +1640,7 @@ namespace osmscout {
                                                      const Way& way,
                                                      uint16_t objectVariantIndex,
                                                      FileOffset routeNodeOffset,
-                                                     const NodeIdObjectsMap& nodeObjectsMap,
+                                                     const NodeIdObjectsList& nodeObjectsList,
                                                      const NodeIdOffsetMap& nodeIdOffsetMap,
                                                      PendingRouteNodeOffsetsMap& pendingOffsetsMap)
   {
@@ -1220,7 +1671,7 @@ namespace osmscout {
                                     way.GetCoord(nextNode).GetLat());
 
       while (nextNode!=currentNode &&
-          nodeObjectsMap.find(way.GetId(nextNode))==nodeObjectsMap.end()) {
+          FindIdEntry(nodeObjectsList,way.GetId(nextNode))==nodeObjectsList.end()) {
         int lastNode=nextNode;
         nextNode++;
 
@@ -1278,7 +1729,7 @@ namespace osmscout {
                                     way.nodes[prevNode].GetLat());
 
       while (prevNode!=currentNode &&
-          nodeObjectsMap.find(way.GetId(prevNode))==nodeObjectsMap.end()) {
+          FindIdEntry(nodeObjectsList,way.GetId(prevNode))==nodeObjectsList.end()) {
         int lastNode=prevNode;
         prevNode--;
 
@@ -1327,7 +1778,7 @@ namespace osmscout {
                                              const Way& way,
                                              uint16_t objectVariantIndex,
                                              FileOffset routeNodeOffset,
-                                             const NodeIdObjectsMap& nodeObjectsMap,
+                                             const NodeIdObjectsList& nodeObjectsList,
                                              const NodeIdOffsetMap& nodeIdOffsetMap,
                                              PendingRouteNodeOffsetsMap& pendingOffsetsMap)
   {
@@ -1340,7 +1791,7 @@ namespace osmscout {
 
           // Search for previous routing node on way
           while (j>=0) {
-            if (nodeObjectsMap.find(way.GetId(j))!=nodeObjectsMap.end()) {
+            if (FindIdEntry(nodeObjectsList,way.GetId(j))!=nodeObjectsList.end()) {
               break;
             }
 
@@ -1390,7 +1841,7 @@ namespace osmscout {
 
           // Search for next routing node on way
           while (j<way.nodes.size()) {
-            if (nodeObjectsMap.find(way.GetId(j))!=nodeObjectsMap.end()) {
+            if (FindIdEntry(nodeObjectsList,way.GetId(j))!=nodeObjectsList.end()) {
               break;
             }
 
@@ -1438,7 +1889,7 @@ namespace osmscout {
   }
 
   void RouteDataGenerator::FillRoutePathExcludes(RouteNode& routeNode,
-                                                 const std::list<ObjectFileRef>& objects,
+                                                 const std::vector<ObjectFileRef>& objects,
                                                  const ViaTurnRestrictionMap& restrictions)
   {
     ViaTurnRestrictionMap::const_iterator turnConstraints=restrictions.find(routeNode.GetId());
@@ -1489,7 +1940,7 @@ namespace osmscout {
                                                 const NodeIdOffsetMap& routeNodeIdOffsetMap,
                                                 PendingRouteNodeOffsetsMap& pendingOffsetsMap,
                                                 FileWriter& routeNodeWriter,
-                                                const std::vector<NodeIdObjectsMap::const_iterator>& block,
+                                                const std::vector<NodeIdObjectsList::const_iterator>& block,
                                                 size_t blockCount)
   {
     std::map<FileOffset,RouteNodeRef> routeNodeOffsetMap;
@@ -1595,7 +2046,7 @@ namespace osmscout {
   bool RouteDataGenerator::WriteRouteGraph(const ImportParameter& parameter,
                                            Progress& progress,
                                            const TypeConfig& typeConfig,
-                                           const NodeIdObjectsMap& nodeObjectsMap,
+                                           const NodeIdObjectsList& nodeObjectsList,
                                            const ViaTurnRestrictionMap& restrictions,
                                            VehicleMask vehicles,
                                            const std::string& dataFilename,
@@ -1637,10 +2088,10 @@ namespace osmscout {
                        FileScanner::Sequential,
                        parameter.GetAreaDataMemoryMaped());
 
-      std::vector<NodeIdObjectsMap::const_iterator> block(parameter.GetRouteNodeBlockSize());
+      std::vector<NodeIdObjectsList::const_iterator> block(parameter.GetRouteNodeBlockSize());
 
-      NodeIdObjectsMap::const_iterator node=nodeObjectsMap.begin();
-      while (node!=nodeObjectsMap.end()) {
+      NodeIdObjectsList::const_iterator node=nodeObjectsList.begin();
+      while (node!=nodeObjectsList.end()) {
 
         // Fill the current block of nodes to be processed
 
@@ -1648,7 +2099,7 @@ namespace osmscout {
 
         progress.Info("Loading up to " + NumberToString(block.size()) + " route nodes");
         while (blockCount<block.size() &&
-               node!=nodeObjectsMap.end()) {
+               node!=nodeObjectsList.end()) {
           block[blockCount]=node;
 
           blockCount++;
@@ -1659,8 +2110,8 @@ namespace osmscout {
 
         // Collect way ids of all ways in current block and load them
 
-        std::set<FileOffset> wayOffsets;
-        std::set<FileOffset> areaOffsets;
+        std::vector<FileOffset> wayOffsets;
+        std::vector<FileOffset> areaOffsets;
 
         for (size_t b=0; b<blockCount; b++) {
           for (const auto& ref : block[b]->second) {
@@ -1672,15 +2123,18 @@ namespace osmscout {
               assert(false);
               break;
             case refWay:
-              wayOffsets.insert(ref.GetFileOffset());
+              wayOffsets.push_back(ref.GetFileOffset());
               break;
             case refArea:
-              areaOffsets.insert(ref.GetFileOffset());
+              areaOffsets.push_back(ref.GetFileOffset());
               break;
             }
           }
         }
 
+        SortUnique(wayOffsets);
+        SortUnique(areaOffsets);
+
         std::unordered_map<FileOffset,WayRef>  waysMap;
 
         if (!LoadWays(typeConfig,
@@ -1708,14 +2162,14 @@ namespace osmscout {
         progress.Info("Storing route nodes");
 
         for (size_t b=0; b<blockCount; b++) {
-          NodeIdObjectsMap::const_iterator node=block[b];
-          FileOffset                       routeNodeOffset;
+          NodeIdObjectsList::const_iterator node=block[b];
+          FileOffset                        routeNodeOffset;
 
           routeNodeOffset=writer.GetPos();
 
           handledRouteNodeCount++;
           progress.SetProgress(handledRouteNodeCount,
-                               (uint32_t)nodeObjectsMap.size());
+                               (uint32_t)nodeObjectsList.size());
 
           //
           // Find out if any of the areas/ways at the intersection is routable
@@ -1777,7 +2231,7 @@ namespace osmscout {
                                           *way,
                                           objectVariantIndex,
                                           routeNodeOffset,
-                                          nodeObjectsMap,
+                                          nodeObjectsList,
                                           routeNodeIdOffsetMap,
                                           pendingOffsetsMap);
               }
@@ -1787,7 +2241,7 @@ namespace osmscout {
                                   *way,
                                   objectVariantIndex,
                                   routeNodeOffset,
-                                  nodeObjectsMap,
+                                  nodeObjectsList,
                                   routeNodeIdOffsetMap,
                                   pendingOffsetsMap);
               }
@@ -1818,7 +2272,7 @@ namespace osmscout {
                                  *area,
                                  objectVariantIndex,
                                  routeNodeOffset,
-                                 nodeObjectsMap,
+                                 nodeObjectsList,
                                  routeNodeIdOffsetMap,
                                  pendingOffsetsMap);
             }
@@ -1894,6 +2348,214 @@ namespace osmscout {
     return true;
   }
 
+  /**
+   * Write a copy of the (complete) routing graph in the format of
+   * CompactRouteGraph.
+   */
+  bool RouteDataGenerator::WriteCompactRouteGraph(Progress& progress,
+                                                  VehicleMask vehicleMask,
+                                                  const std::string& dataFilename,
+                                                  const std::string& variantFilename,
+                                                  const std::string& compactFilename)
+  {
+    FileScanner                          scanner;
+    FileWriter                           writer;
+    uint32_t                             variantCount;
+    std::vector<CompactRouteGraph::Node> nodes;
+    std::vector<CompactRouteGraph::Edge> edges;
+    std::vector<FileOffset>              edgeTargets;
+    std::vector<ObjectFileRef>           edgeObjects;
+    std::vector<ObjectFileRef>           excludeObjects; // Source and target object for each exclude
+    std::vector<ObjectFileRef>           objects;
+
+    try {
+      uint32_t nodeCount;
+
+      scanner.Open(variantFilename,
+                   FileScanner::Sequential,
+                   false);
+
+      scanner.Read(variantCount);
+
+      scanner.Close();
+
+      scanner.Open(dataFilename,
+                   FileScanner::Sequential,
+                   true);
+
+      scanner.Read(nodeCount);
+
+      nodes.reserve(nodeCount+1);
+
+      for (uint32_t n=0; n<nodeCount; n++) {
+        RouteNode               routeNode;
+        CompactRouteGraph::Node node;
+
+        progress.SetProgress(n,nodeCount);
+
+        routeNode.Read(scanner);
+
+        if (!nodes.empty() &&
+            nodes.back().routeNodeOffset>=routeNode.GetFileOffset()) {
+          progress.Error("Route nodes are not ordered by file offset");
+          scanner.Close();
+          return false;
+        }
+
+        node.routeNodeOffset=routeNode.GetFileOffset();
+        node.lat=routeNode.GetCoord().GetLat();
+        node.lon=routeNode.GetCoord().GetLon();
+        node.firstEdge=(uint32_t)edges.size();
+        node.firstExclude=(uint32_t)(excludeObjects.size()/2);
+
+        nodes.push_back(node);
+
+        for (const auto& path : routeNode.paths) {
+          CompactRouteGraph::Edge edge;
+
+          std::memset(&edge,0,sizeof(edge));
+
+          edge.distance=path.distance;
+          edge.variant=routeNode.objects[path.objectIndex].objectVariantIndex;
+          edge.flags=path.flags;
+
+          edges.push_back(edge);
+          edgeTargets.push_back(path.offset);
+          edgeObjects.push_back(routeNode.objects[path.objectIndex].object);
+        }
+
+        for (const auto& exclude : routeNode.excludes) {
+          if (exclude.targetIndex>=routeNode.paths.size()) {
+            progress.Error("Exclude of route node "+NumberToString(routeNode.GetId())+" references path "+
+                           NumberToString(exclude.targetIndex)+" of "+NumberToString(routeNode.paths.size()));
+            scanner.Close();
+            return false;
+          }
+
+          // The target of an exclude is the index of a path, not of an object
+          excludeObjects.push_back(exclude.source);
+          excludeObjects.push_back(routeNode.objects[routeNode.paths[exclude.targetIndex].objectIndex].object);
+        }
+      }
+
+      scanner.Close();
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
+      scanner.CloseFailsafe();
+      return false;
+    }
+
+    CompactRouteGraph::Node sentinel;
+
+    std::memset(&sentinel,0,sizeof(sentinel));
+
+    sentinel.firstEdge=(uint32_t)edges.size();
+    sentinel.firstExclude=(uint32_t)(excludeObjects.size()/2);
+
+    nodes.push_back(sentinel);
+
+    // Objects are stored in the order of ObjectFileRef, so that they can be searched
+    objects.reserve(edgeObjects.size()+excludeObjects.size());
+    objects.insert(objects.end(),
+                   edgeObjects.begin(),
+                   edgeObjects.end());
+    objects.insert(objects.end(),
+                   excludeObjects.begin(),
+                   excludeObjects.end());
+
+    std::sort(objects.begin(),
+              objects.end());
+
+    objects.erase(std::unique(objects.begin(),
+                              objects.end()),
+                  objects.end());
+
+    auto getObjectIndex=[&objects](const ObjectFileRef& object) {
+      return (uint32_t)(std::lower_bound(objects.begin(),
+                                         objects.end(),
+                                         object)-objects.begin());
+    };
+
+    for (size_t e=0; e<edges.size(); e++) {
+      auto target=std::lower_bound(nodes.begin(),
+                                   nodes.end()-1,
+                                   edgeTargets[e],
+                                   [](const CompactRouteGraph::Node& node, FileOffset offset) {
+                                     return node.routeNodeOffset<offset;
+                                   });
+
+      if (target==nodes.end()-1 ||
+          target->routeNodeOffset!=edgeTargets[e]) {
+        progress.Error("Cannot resolve target route node "+NumberToString(edgeTargets[e]));
+        return false;
+      }
+
+      edges[e].target=(uint32_t)(target-nodes.begin());
+      edges[e].object=getObjectIndex(edgeObjects[e]);
+    }
+
+    try {
+      CompactRouteGraph::Header header;
+
+      std::memset(&header,0,sizeof(header));
+
+      header.magic=CompactRouteGraph::FILE_MAGIC;
+      header.version=CompactRouteGraph::FILE_VERSION;
+      header.nodeCount=(uint32_t)(nodes.size()-1);
+      header.edgeCount=(uint32_t)edges.size();
+      header.objectCount=(uint32_t)objects.size();
+      header.excludeCount=(uint32_t)(excludeObjects.size()/2);
+      header.variantCount=variantCount;
+      header.vehicles=vehicleMask;
+
+      writer.Open(compactFilename);
+
+      writer.Write((const char*)&header,
+                   sizeof(header));
+      writer.Write((const char*)nodes.data(),
+                   nodes.size()*sizeof(CompactRouteGraph::Node));
+      writer.Write((const char*)edges.data(),
+                   edges.size()*sizeof(CompactRouteGraph::Edge));
+
+      for (const auto& entry : objects) {
+        CompactRouteGraph::Object object;
+
+        std::memset(&object,0,sizeof(object));
+
+        object.offset=entry.GetFileOffset();
+        object.type=(uint8_t)entry.GetType();
+
+        writer.Write((const char*)&object,
+                     sizeof(object));
+      }
+
+      for (size_t i=0; i<excludeObjects.size(); i+=2) {
+        CompactRouteGraph::Exclude exclude;
+
+        exclude.source=getObjectIndex(excludeObjects[i]);
+        exclude.target=getObjectIndex(excludeObjects[i+1]);
+
+        writer.Write((const char*)&exclude,
+                     sizeof(exclude));
+      }
+
+      writer.Close();
+
+      progress.Info(NumberToString(header.nodeCount) + " node(s), " +
+                    NumberToString(header.edgeCount) + " edge(s), " +
+                    NumberToString(header.objectCount) + " object(s) and " +
+                    NumberToString(header.excludeCount) + " exclude(s) written");
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
+      writer.CloseFailsafe();
+      return false;
+    }
+
+    return true;
+  }
+
   bool RouteDataGenerator::Import(const TypeConfigRef& typeConfig,
                                   const ImportParameter& parameter,
                                   Progress& progress)
@@ -1901,8 +2563,8 @@ namespace osmscout {
     // List of restrictions for a way
     ViaTurnRestrictionMap              restrictions;
 
-    NodeUseMap                         nodeUseMap;
-    NodeIdObjectsMap                   nodeObjectsMap;
+    std::vector<Id>                    junctionIds;
+    NodeIdObjectsList                  nodeObjectsList;
     AccessRestrictedFeatureValueReader accessRestrictedReader(*typeConfig);
     AccessFeatureValueReader           accessReader(*typeConfig);
     MaxSpeedFeatureValueReader         maxSpeedReader(*typeConfig);
@@ -1936,7 +2598,7 @@ namespace osmscout {
     if (!ReadIntersections(parameter,
                            progress,
                            *typeConfig,
-                           nodeUseMap)) {
+                           junctionIds)) {
       return false;
     }
 
@@ -1949,28 +2611,31 @@ namespace osmscout {
     if (!ReadObjectsAtIntersections(parameter,
                                     progress,
                                     *typeConfig,
-                                    nodeUseMap,
-                                    nodeObjectsMap)) {
+                                    junctionIds,
+                                    nodeObjectsList)) {
       return false;
     }
 
-    // We now have the nodeObjectsMap, we do not need this information anymore
-    nodeUseMap.Clear();
+    // We now have the nodeObjectsList, we do not need this information anymore
+    junctionIds.clear();
+    junctionIds.shrink_to_fit();
 
     progress.SetAction("Postprocessing intersections");
 
 
     // We sort objects by increasing file offset, for more efficient storage
     // in route node
-    for (auto& entry : nodeObjectsMap) {
-      entry.second.sort(ObjectFileRefByFileOffsetComparator());
+    for (auto& entry : nodeObjectsList) {
+      std::stable_sort(entry.second.begin(),
+                       entry.second.end(),
+                       ObjectFileRefByFileOffsetComparator());
     }
 
     progress.SetAction(std::string("Writing intersection file '")+RoutingService::FILENAME_INTERSECTIONS_DAT+"'");
 
     if (!WriteIntersections(parameter,
                             progress,
-                            nodeObjectsMap)) {
+                            nodeObjectsList)) {
       return false;
     }
 
@@ -1987,7 +2652,7 @@ namespace osmscout {
       WriteRouteGraph(parameter,
                       progress,
                       *typeConfig,
-                      nodeObjectsMap,
+                      nodeObjectsList,
                       restrictions,
                       router.GetVehicleMask(),
                       dataFilename,
@@ -2002,11 +2667,26 @@ namespace osmscout {
                                  progress)) {
         return false;
       }
+
+      if (parameter.GetRouteCompactGraph()) {
+        std::string compactFilename=AppendFileToDir(parameter.GetDestinationDirectory(),
+                                                    CompactRouteGraph::GetFilename(router.GetFilenamebase()));
+
+        progress.SetAction(std::string("Writing compact route graph '")+compactFilename+"'");
+
+        if (!WriteCompactRouteGraph(progress,
+                                    router.GetVehicleMask(),
+                                    dataFilename,
+                                    variantFilename,
+                                    compactFilename)) {
+          return false;
+        }
+      }
     }
 
     // Cleaning up...
 
-    nodeObjectsMap.clear();
+    nodeObjectsList.clear();
     restrictions.clear();
 
     return true;
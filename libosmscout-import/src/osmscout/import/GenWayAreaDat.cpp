@@ -249,7 +249,7 @@ namespace osmscout {
     FileScanner               scanner;
     uint32_t                  rawWayCount=0;
     std::vector<RawWayRef>    rawWays;
-    std::set<OSMId>           nodeIds;
+    std::vector<OSMId>        nodeIds;
 
     FileWriter                areaWriter;
     uint32_t                  writtenWayCount=0;
@@ -315,7 +315,7 @@ namespace osmscout {
         }
 
         for (size_t n=0; n<way->GetNodeCount(); n++) {
-          nodeIds.insert(way->GetNodeId(n));
+          nodeIds.push_back(way->GetNodeId(n));
         }
 
         rawWays.push_back(way);
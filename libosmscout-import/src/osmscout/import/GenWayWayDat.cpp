@@ -647,11 +647,11 @@ namespace osmscout {
 
       collectedAreasCount++;
 
-      std::set<OSMId>          nodeIds;
+      std::vector<OSMId>       nodeIds;
       CoordDataFile::ResultMap coordsMap;
 
       for (size_t n=0; n<way->GetNodeCount(); n++) {
-        nodeIds.insert(way->GetNodeId(n));
+        nodeIds.push_back(way->GetNodeId(n));
       }
 
       if (!coordDataFile.Get(nodeIds,
@@ -791,13 +791,13 @@ namespace osmscout {
 
         progress.SetAction("Collecting node ids");
 
-        std::set<OSMId>          nodeIds;
+        std::vector<OSMId>       nodeIds;
         CoordDataFile::ResultMap coordsMap;
 
         for (size_t type=0; type<waysByType.size(); type++) {
           for (const auto &rawWay : waysByType[type]) {
             for (size_t n=0; n<rawWay->GetNodeCount(); n++) {
-              nodeIds.insert(rawWay->GetNodeId(n));
+              nodeIds.push_back(rawWay->GetNodeId(n));
             }
           }
         }
@@ -69,6 +69,8 @@
 
 // Routing
 #include <osmscout/import/GenRouteDat.h>
+#include <osmscout/import/GenRouteCH.h>
+#include <osmscout/import/GenRoutableSegmentIndex.h>
 #include <osmscout/import/GenIntersectionIndex.h>
 
 #if defined(OSMSCOUT_IMPORT_HAVE_LIB_MARISA)
@@ -83,9 +85,9 @@ namespace osmscout {
 
   static const size_t defaultStartStep=1;
 #if defined(OSMSCOUT_IMPORT_HAVE_LIB_MARISA)
-  static const size_t defaultEndStep=24;
+  static const size_t defaultEndStep=26;
 #else
-  static const size_t defaultEndStep=23;
+  static const size_t defaultEndStep=25;
 #endif
 
   ImportParameter::Router::Router(uint8_t vehicleMask,
@@ -103,9 +105,10 @@ namespace osmscout {
      eco(false),
      strictAreas(false),
      sortObjects(true),
-     sortBlockSize(40000000),
+     sortMemoryBudget(1024*1024*1024),
      sortTileMag(14),
      numericIndexPageSize(1024),
+     processingQueueSize(50),
      rawCoordBlockSize(60000000),
      rawNodeDataMemoryMaped(false),
      rawWayIndexMemoryMaped(true),
@@ -113,6 +116,7 @@ namespace osmscout {
      rawWayIndexCacheSize(10000),
      rawWayBlockSize(500000),
      coordDataMemoryMaped(false),
+     coordDataDense(false),
      coordIndexCacheSize(1000000),
      coordBlockSize(250000),
      areaDataMemoryMaped(false),
@@ -135,6 +139,11 @@ namespace osmscout {
      optimizationCellSizeMax(255),
      optimizationWayMethod(TransPolygon::quality),
      routeNodeBlockSize(500000),
+     routeNodeMemoryBudget(1024*1024*1024),
+     routeCompactGraph(false),
+     routeContractionHierarchy(false),
+     routeContractionHierarchyCarMaxSpeed(160.0),
+     routeSegmentIndex(false),
      assumeLand(true),
      langOrder({"#"})
   {
@@ -196,9 +205,9 @@ namespace osmscout {
     return sortObjects;
   }
 
-  size_t ImportParameter::GetSortBlockSize() const
+  size_t ImportParameter::GetSortMemoryBudget() const
   {
-    return sortBlockSize;
+    return sortMemoryBudget;
   }
 
   size_t ImportParameter::GetSortTileMag() const
@@ -211,6 +220,11 @@ namespace osmscout {
     return numericIndexPageSize;
   }
 
+  size_t ImportParameter::GetProcessingQueueSize() const
+  {
+    return processingQueueSize;
+  }
+
   size_t ImportParameter::GetRawCoordBlockSize() const
   {
     return rawCoordBlockSize;
@@ -246,6 +260,11 @@ namespace osmscout {
     return coordDataMemoryMaped;
   }
 
+  bool ImportParameter::GetCoordDataDense() const
+  {
+    return coordDataDense;
+  }
+
   size_t ImportParameter::GetCoordIndexCacheSize() const
   {
     return coordIndexCacheSize;
@@ -356,6 +375,36 @@ namespace osmscout {
     return routeNodeBlockSize;
   }
 
+  size_t ImportParameter::GetRouteNodeMemoryBudget() const
+  {
+    return routeNodeMemoryBudget;
+  }
+
+  bool ImportParameter::GetRouteCompactGraph() const
+  {
+    return routeCompactGraph;
+  }
+
+  bool ImportParameter::GetRouteContractionHierarchy() const
+  {
+    return routeContractionHierarchy;
+  }
+
+  const std::map<std::string,double>& ImportParameter::GetRouteContractionHierarchyCarSpeeds() const
+  {
+    return routeContractionHierarchyCarSpeeds;
+  }
+
+  double ImportParameter::GetRouteContractionHierarchyCarMaxSpeed() const
+  {
+    return routeContractionHierarchyCarMaxSpeed;
+  }
+
+  bool ImportParameter::GetRouteSegmentIndex() const
+  {
+    return routeSegmentIndex;
+  }
+
   bool ImportParameter::GetAssumeLand() const
   {
     return assumeLand;
@@ -428,9 +477,9 @@ namespace osmscout {
     this->sortObjects=renumberIds;
   }
 
-  void ImportParameter::SetSortBlockSize(size_t sortBlockSize)
+  void ImportParameter::SetSortMemoryBudget(size_t sortMemoryBudget)
   {
-    this->sortBlockSize=sortBlockSize;
+    this->sortMemoryBudget=sortMemoryBudget;
   }
 
   void ImportParameter::SetSortTileMag(size_t sortTileMag)
@@ -443,6 +492,11 @@ namespace osmscout {
     this->numericIndexPageSize=numericIndexPageSize;
   }
 
+  void ImportParameter::SetProcessingQueueSize(size_t processingQueueSize)
+  {
+    this->processingQueueSize=processingQueueSize;
+  }
+
   void ImportParameter::SetRawCoordBlockSize(size_t blockSize)
   {
     this->rawCoordBlockSize=blockSize;
@@ -478,6 +532,11 @@ namespace osmscout {
     this->coordDataMemoryMaped=memoryMaped;
   }
 
+  void ImportParameter::SetCoordDataDense(bool coordDataDense)
+  {
+    this->coordDataDense=coordDataDense;
+  }
+
   void ImportParameter::SetCoordIndexCacheSize(size_t coordIndexCacheSize)
   {
     this->coordIndexCacheSize=coordIndexCacheSize;
@@ -590,6 +649,38 @@ namespace osmscout {
     this->routeNodeBlockSize=blockSize;
   }
 
+  void ImportParameter::SetRouteNodeMemoryBudget(size_t routeNodeMemoryBudget)
+  {
+    this->routeNodeMemoryBudget=routeNodeMemoryBudget;
+  }
+
+  void ImportParameter::SetRouteCompactGraph(bool routeCompactGraph)
+  {
+    this->routeCompactGraph=routeCompactGraph;
+  }
+
+  void ImportParameter::SetRouteContractionHierarchy(bool routeContractionHierarchy)
+  {
+    this->routeContractionHierarchy=routeContractionHierarchy;
+  }
+
+  /**
+   * Set the speed table (type name => speed in km/h) and the maximum speed
+   * of the car. If set, the contraction hierarchy for cars is build for
+   * the fastest route using these speeds, else for the shortest route.
+   */
+  void ImportParameter::SetRouteContractionHierarchyCarSpeeds(const std::map<std::string,double>& speeds,
+                                                              double maxSpeed)
+  {
+    this->routeContractionHierarchyCarSpeeds=speeds;
+    this->routeContractionHierarchyCarMaxSpeed=maxSpeed;
+  }
+
+  void ImportParameter::SetRouteSegmentIndex(bool routeSegmentIndex)
+  {
+    this->routeSegmentIndex=routeSegmentIndex;
+  }
+
   void ImportParameter::SetAssumeLand(bool assumeLand)
   {
     this->assumeLand=assumeLand;
@@ -786,10 +877,16 @@ namespace osmscout {
     modules.push_back(std::make_shared<RouteDataGenerator>());
 
     /* 23 */
+    modules.push_back(std::make_shared<RouteContractionHierarchyGenerator>());
+
+    /* 24 */
+    modules.push_back(std::make_shared<RoutableSegmentIndexGenerator>());
+
+    /* 25 */
     modules.push_back(std::make_shared<IntersectionIndexGenerator>());
 
 #if defined(OSMSCOUT_IMPORT_HAVE_LIB_MARISA)
-    /* 24 */
+    /* 26 */
     modules.push_back(std::make_shared<TextIndexGenerator>());
 #endif
   }
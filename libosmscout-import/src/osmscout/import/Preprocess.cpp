@@ -843,8 +843,12 @@ namespace osmscout {
                                 Callback& callback)
   {
     for (const auto& filename : parameter.GetMapfiles()) {
-      if (filename.length()>=4 &&
-          filename.substr(filename.length()-4)==".osm")  {
+      if ((filename.length()>=4 &&
+           filename.substr(filename.length()-4)==".osm") ||
+          (filename.length()>=7 &&
+           filename.substr(filename.length()-7)==".osm.gz") ||
+          (filename.length()>=8 &&
+           filename.substr(filename.length()-8)==".osm.bz2"))  {
 
 #if defined(HAVE_LIB_XML)
         PreprocessOSM preprocess(callback);
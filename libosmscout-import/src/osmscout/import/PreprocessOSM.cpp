@@ -19,16 +19,32 @@
 
 #include <osmscout/import/PreprocessOSM.h>
 
+#include <osmscout/private/Config.h>
+
 #include <algorithm>
-#include <iostream>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <deque>
+#include <functional>
 #include <map>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <string.h>
 
 #include <libxml/parser.h>
 
+#if defined(HAVE_LIB_ZLIB)
+  #include <zlib.h>
+#endif
+
+#if defined(HAVE_LIB_BZIP2)
+  #include <bzlib.h>
+#endif
+
 #include <osmscout/util/File.h>
 #include <osmscout/util/String.h>
 
@@ -38,6 +54,15 @@
 
 namespace osmscout {
 
+  static std::string ToString(const xmlChar* value)
+  {
+    return value!=NULL ? std::string((const char*)value) : std::string();
+  }
+
+  /**
+   * Parses the elements of a chunk. Since chunks are parsed in parallel, warnings
+   * and errors are collected and reported later on in the order of the file.
+   */
   class Parser
   {
     enum Context {
@@ -49,7 +74,8 @@ namespace osmscout {
 
   private:
     const TypeConfig&                     typeConfig;
-    Progress&                             progress;
+    std::vector<std::string>&             warnings;
+    std::vector<std::string>&             errors;
     PreprocessorCallback&                 callback;
     Context                               context;
     OSMId                                 id;
@@ -62,16 +88,28 @@ namespace osmscout {
 
   public:
     Parser(const TypeConfig& typeConfig,
-           Progress& progress,
+           std::vector<std::string>& warnings,
+           std::vector<std::string>& errors,
            PreprocessorCallback& callback)
     : typeConfig(typeConfig),
-      progress(progress),
+      warnings(warnings),
+      errors(errors),
       callback(callback),
       context(contextUnknown)
     {
       // no code
     }
 
+    void Warning(const std::string& text)
+    {
+      warnings.push_back(text);
+    }
+
+    void Error(const std::string& text)
+    {
+      errors.push_back(text);
+    }
+
     void StartElement(const xmlChar *name, const xmlChar **atts)
     {
       if (!blockData) {
@@ -103,19 +141,21 @@ namespace osmscout {
         }
 
         if (idValue==NULL || lonValue==NULL || latValue==NULL) {
-          progress.Error("Not all required attributes found");
+          Error("Not all required attributes found");
+          context=contextUnknown;
+          return;
         }
 
         if (!StringToNumber((const char*)idValue,id)) {
-          std::cerr << "Cannot parse id: '" << idValue << "'" << std::endl;
+          Error("Cannot parse id: '"+ToString(idValue)+"'");
           return;
         }
         if (!StringToNumber((const char*)latValue,lat)) {
-          std::cerr << "Cannot parse latitude: '" << latValue << "'" << std::endl;
+          Error("Cannot parse latitude: '"+ToString(latValue)+"'");
           return;
         }
         if (!StringToNumber((const char*)lonValue,lon)) {
-          std::cerr << "Cannot parse longitude: '" << lonValue << "'" << std::endl;
+          Error("Cannot parse longitude: '"+ToString(lonValue)+"'");
           return;
         }
       }
@@ -134,7 +174,7 @@ namespace osmscout {
         }
 
         if (!StringToNumber((const char*)idValue,id)) {
-          std::cerr << "Cannot parse id: '" << idValue << "'" << std::endl;
+          Error("Cannot parse id: '"+ToString(idValue)+"'");
           return;
         }
       }
@@ -153,7 +193,7 @@ namespace osmscout {
         }
 
         if (!StringToNumber((const char*)idValue,id)) {
-          std::cerr << "Cannot parse id: '" << idValue << "'" << std::endl;
+          Error("Cannot parse id: '"+ToString(idValue)+"'");
           return;
         }
       }
@@ -175,7 +215,7 @@ namespace osmscout {
         }
 
         if (keyValue==NULL || valueValue==NULL) {
-          std::cerr << "Cannot parse tag, skipping..." << std::endl;
+          Error("Cannot parse tag, skipping...");
           return;
         }
 
@@ -200,7 +240,7 @@ namespace osmscout {
         }
 
         if (!StringToNumber((const char*)idValue,node)) {
-          std::cerr << "Cannot parse id: '" << idValue << "'" << std::endl;
+          Error("Cannot parse id: '"+ToString(idValue)+"'");
           return;
         }
 
@@ -229,17 +269,17 @@ namespace osmscout {
         }
 
         if (typeValue==NULL) {
-          std::cerr << "Member of relation " << id << " does not have a type" << std::endl;
+          Error("Member of relation "+NumberToString(id)+" does not have a type");
           return;
         }
 
         if (refValue==NULL) {
-          std::cerr << "Member of relation " << id << " does not have a valid reference" << std::endl;
+          Error("Member of relation "+NumberToString(id)+" does not have a valid reference");
           return;
         }
 
         if (roleValue==NULL) {
-          std::cerr << "Member of relation " << id << " does not have a valid role" << std::endl;
+          Error("Member of relation "+NumberToString(id)+" does not have a valid role");
           return;
         }
 
@@ -253,12 +293,12 @@ namespace osmscout {
           member.type=RawRelation::memberRelation;
         }
         else {
-          std::cerr << "Cannot parse member type: '" << typeValue << "'" << std::endl;
+          Error("Cannot parse member type: '"+ToString(typeValue)+"'");
           return;
         }
 
         if (!StringToNumber((const char*)refValue,member.id)) {
-          std::cerr << "Cannot parse ref '" << refValue << "' for relation " << id << std::endl;
+          Error("Cannot parse ref '"+ToString(refValue)+"' for relation "+NumberToString(id));
         }
 
         if (roleValue!=NULL) {
@@ -315,7 +355,7 @@ namespace osmscout {
         }
       }
       catch (IOException& e) {
-        progress.Error(e.GetDescription());
+        Error(e.GetDescription());
       }
     }
 
@@ -346,53 +386,71 @@ namespace osmscout {
     return xmlGetPredefinedEntity(name);
   }
 
-  static void StructuredErrorHandler(void* /*data*/, xmlErrorPtr error)
+  /**
+   * Messages of libxml end with a line feed
+   */
+  static std::string RemoveLineFeed(std::string message)
   {
-    std::cerr << "XML error, line " << error->line << ": " << error->message << std::endl;
+    while (!message.empty() &&
+           (message.back()=='\n' || message.back()=='\r')) {
+      message.pop_back();
+    }
+
+    return message;
   }
 
-  static void WarningHandler(void* /*data*/, const char* msg,...)
+  static std::string FormatXMLMessage(const char* msg,
+                                      va_list args)
   {
-    std::cerr << "XML warning:" << msg << std::endl;
+    char buffer[1024];
+
+    vsnprintf(buffer,sizeof(buffer),msg,args);
+
+    return RemoveLineFeed(buffer);
   }
 
-  static void ErrorHandler(void* /*data*/, const char* msg,...)
+  static void StructuredErrorHandler(void* data, xmlErrorPtr error)
   {
-    std::cerr << "XML error:" << msg << std::endl;
+    Parser* parser=static_cast<Parser*>(data);
+
+    parser->Error("XML error, line "+NumberToString(error->line)+": "+
+                  RemoveLineFeed(error->message!=NULL ? error->message : ""));
   }
 
-  static void StartDocumentHandler(void* /*data*/)
+  static void WarningHandler(void* data, const char* msg,...)
   {
-    // no code, only for temporary debugging purposes
+    Parser* parser=static_cast<Parser*>(data);
+    va_list args;
+
+    va_start(args,msg);
+    parser->Warning("XML warning: "+FormatXMLMessage(msg,args));
+    va_end(args);
   }
 
-  static void EndDocumentHandler(void* data)
+  static void ErrorHandler(void* data, const char* msg,...)
   {
     Parser* parser=static_cast<Parser*>(data);
+    va_list args;
 
-    parser->EndDocument();
+    va_start(args,msg);
+    parser->Error("XML error: "+FormatXMLMessage(msg,args));
+    va_end(args);
   }
 
-  PreprocessOSM::PreprocessOSM(PreprocessorCallback& callback)
-  : callback(callback)
+  static void StartDocumentHandler(void* /*data*/)
   {
-    // no code
+    // no code, only for temporary debugging purposes
   }
 
-  bool PreprocessOSM::Import(const TypeConfigRef& typeConfig,
-                             const ImportParameter& /*parameter*/,
-                             Progress& progress,
-                             const std::string& filename)
+  static void EndDocumentHandler(void* data)
   {
-    progress.SetAction(std::string("Parsing *.osm file '")+filename+"'");
+    Parser* parser=static_cast<Parser*>(data);
 
-    Parser        parser(*typeConfig,
-                         progress,
-                         callback);
-    FILE             *file;
-    xmlSAXHandler    saxParser;
-    xmlParserCtxtPtr ctxt;
+    parser->EndDocument();
+  }
 
+  static void InitializeSAXHandler(xmlSAXHandler& saxParser)
+  {
     memset(&saxParser,0,sizeof(xmlSAXHandler));
     saxParser.initialized=XML_SAX2_MAGIC;
 
@@ -405,47 +463,928 @@ namespace osmscout {
     saxParser.error=ErrorHandler;
     saxParser.fatalError=ErrorHandler;
     saxParser.serror=StructuredErrorHandler;
+  }
 
-    file=fopen(filename.c_str(),"rb");
+  /**
+   * Collects the blocks generated by the Parser for one chunk, so that they
+   * can be passed to the real callback later on in the right order.
+   */
+  class BlockCollector : public PreprocessorCallback
+  {
+  public:
+    std::vector<RawBlockDataRef> blocks;
 
-    if (file==NULL) {
-      return false;
+  public:
+    void ProcessBlock(RawBlockDataRef data)
+    {
+      blocks.push_back(data);
     }
+  };
 
-    char chars[1024];
+  /**
+   * Reads the (uncompressed) data of an import file in consecutive pieces
+   */
+  class OSMFileReader
+  {
+  protected:
+    static const size_t bufferSize=1024*1024;
 
-    int res=fread(chars,1,4,file);
-    if (res!=4) {
-      fclose(file);
-      return false;
+  protected:
+    std::string error;
+
+  public:
+    virtual ~OSMFileReader()
+    {
+      // no code
     }
 
-    ctxt=xmlCreatePushParserCtxt(&saxParser,&parser,chars,res,NULL);
+    std::string GetError() const
+    {
+      return error;
+    }
 
-    // Resolve entities, do not do any network communication
-    xmlCtxtUseOptions(ctxt,XML_PARSE_NOENT|XML_PARSE_NONET);
+    virtual bool Open(const std::string& filename) = 0;
+
+    /**
+     * Reads the next piece of data. An empty piece signals the end of
+     * the file. Returns false in case of an error.
+     */
+    virtual bool Read(std::string& data) = 0;
+
+    /**
+     * Returns the current position in the (possibly compressed) file
+     */
+    virtual FileOffset GetPosition() const = 0;
+
+    virtual void Close() = 0;
+  };
+
+  class PlainFileReader : public OSMFileReader
+  {
+  private:
+    FILE *file;
+
+  public:
+    PlainFileReader()
+    : file(NULL)
+    {
+      // no code
+    }
+
+    ~PlainFileReader()
+    {
+      Close();
+    }
+
+    bool Open(const std::string& filename)
+    {
+      file=fopen(filename.c_str(),"rb");
+
+      if (file==NULL) {
+        error="Cannot open file!";
+        return false;
+      }
+
+      return true;
+    }
+
+    bool Read(std::string& data)
+    {
+      data.resize(bufferSize);
+
+      size_t size=fread(&data[0],1,bufferSize,file);
+
+      if (size==0 && ferror(file)) {
+        error="Cannot read file!";
+        return false;
+      }
+
+      data.resize(size);
+
+      return true;
+    }
+
+    FileOffset GetPosition() const
+    {
+#if defined(HAVE_FSEEKO)
+      off_t filepos=ftello(file);
+#else
+      long filepos=ftell(file);
+#endif
+
+      return filepos>=0 ? (FileOffset)filepos : 0;
+    }
 
-    while ((res=fread(chars,1,sizeof(chars),file))>0) {
-      if (xmlParseChunk(ctxt,chars,res,0)!=0) {
-        xmlParserError(ctxt,"xmlParseChunk");
-        xmlFreeParserCtxt(ctxt);
+    void Close()
+    {
+      if (file!=NULL) {
         fclose(file);
+        file=NULL;
+      }
+    }
+  };
+
+#if defined(HAVE_LIB_ZLIB)
+  class GZipFileReader : public OSMFileReader
+  {
+  private:
+    gzFile file;
+
+  public:
+    GZipFileReader()
+    : file(NULL)
+    {
+      // no code
+    }
 
+    ~GZipFileReader()
+    {
+      Close();
+    }
+
+    bool Open(const std::string& filename)
+    {
+      file=gzopen(filename.c_str(),"rb");
+
+      if (file==NULL) {
+        error="Cannot open file!";
+        return false;
+      }
+
+      gzbuffer(file,(unsigned int)bufferSize);
+
+      return true;
+    }
+
+    bool Read(std::string& data)
+    {
+      data.resize(bufferSize);
+
+      int size=gzread(file,&data[0],(unsigned int)bufferSize);
+
+      if (size<0) {
+        int errorCode;
+
+        error=std::string("Cannot decode gzip compressed data: ")+gzerror(file,&errorCode);
+        return false;
+      }
+
+      data.resize((size_t)size);
+
+      return true;
+    }
+
+    FileOffset GetPosition() const
+    {
+      z_off_t offset=gzoffset(file);
+
+      return offset>=0 ? (FileOffset)offset : 0;
+    }
+
+    void Close()
+    {
+      if (file!=NULL) {
+        gzclose(file);
+        file=NULL;
+      }
+    }
+  };
+#endif
+
+#if defined(HAVE_LIB_BZIP2)
+  /**
+   * Reader for bzip2 compressed files. Files with multiple concatenated
+   * streams (as generated by parallel compressors) are supported.
+   */
+  class BZip2FileReader : public OSMFileReader
+  {
+  private:
+    FILE   *file;
+    BZFILE *bzFile;
+
+  private:
+    bool OpenStream(void* unused,
+                    int unusedSize)
+    {
+      int bzError;
+
+      bzFile=BZ2_bzReadOpen(&bzError,file,0,0,unused,unusedSize);
+
+      if (bzError!=BZ_OK) {
+        BZ2_bzReadClose(&bzError,bzFile);
+        bzFile=NULL;
+        error="Cannot open bzip2 compressed stream!";
+        return false;
+      }
+
+      return true;
+    }
+
+    void CloseStream()
+    {
+      int bzError;
+
+      BZ2_bzReadClose(&bzError,bzFile);
+      bzFile=NULL;
+    }
+
+  public:
+    BZip2FileReader()
+    : file(NULL),
+      bzFile(NULL)
+    {
+      // no code
+    }
+
+    ~BZip2FileReader()
+    {
+      Close();
+    }
+
+    bool Open(const std::string& filename)
+    {
+      file=fopen(filename.c_str(),"rb");
+
+      if (file==NULL) {
+        error="Cannot open file!";
         return false;
       }
+
+      return OpenStream(NULL,0);
+    }
+
+    bool Read(std::string& data)
+    {
+      data.resize(bufferSize);
+
+      size_t size=0;
+
+      while (size==0 && bzFile!=NULL) {
+        int bzError;
+        int result=BZ2_bzRead(&bzError,bzFile,&data[0],(int)bufferSize);
+
+        if (bzError==BZ_OK) {
+          size=(size_t)result;
+        }
+        else if (bzError==BZ_STREAM_END) {
+          void        *unused;
+          int         unusedSize;
+          std::string unusedData;
+
+          size=(size_t)result;
+
+          BZ2_bzReadGetUnused(&bzError,bzFile,&unused,&unusedSize);
+
+          if (bzError!=BZ_OK) {
+            error="Cannot decode bzip2 compressed data!";
+            return false;
+          }
+
+          // Data of the next stream already read from the file
+          unusedData.assign((const char*)unused,(size_t)unusedSize);
+
+          CloseStream();
+
+          if (unusedData.empty()) {
+            int c=fgetc(file);
+
+            if (c==EOF) {
+              break;
+            }
+
+            ungetc(c,file);
+          }
+
+          if (!OpenStream(unusedData.empty() ? NULL : &unusedData[0],
+                          (int)unusedData.size())) {
+            return false;
+          }
+        }
+        else {
+          error="Cannot decode bzip2 compressed data!";
+          return false;
+        }
+      }
+
+      data.resize(size);
+
+      return true;
+    }
+
+    FileOffset GetPosition() const
+    {
+#if defined(HAVE_FSEEKO)
+      off_t filepos=ftello(file);
+#else
+      long filepos=ftell(file);
+#endif
+
+      return filepos>=0 ? (FileOffset)filepos : 0;
+    }
+
+    void Close()
+    {
+      if (bzFile!=NULL) {
+        CloseStream();
+      }
+
+      if (file!=NULL) {
+        fclose(file);
+        file=NULL;
+      }
     }
+  };
+#endif
+
+  /**
+   * Wraps a reader and executes it in a separate thread, so that decompression
+   * runs in parallel to splitting the data into chunks.
+   */
+  class AsyncFileReader : public OSMFileReader
+  {
+  private:
+    static const size_t maxBuffers=8;
+
+  private:
+    std::unique_ptr<OSMFileReader> reader;
+    std::thread                    thread;
+    std::mutex                     mutex;
+    std::condition_variable        condition;
+    std::deque<std::string>        buffers;
+    bool                           failed;
+    bool                           stopped;
+    std::atomic<FileOffset>        position;
 
-    if (xmlParseChunk(ctxt,chars,0,1)!=0) {
-      xmlParserError(ctxt,"xmlParseChunk");
-      xmlFreeParserCtxt(ctxt);
-      fclose(file);
+  private:
+    void ReaderLoop()
+    {
+      while (true) {
+        std::string data;
+        bool        success=reader->Read(data);
+
+        std::unique_lock<std::mutex> lock(mutex);
+
+        if (!success) {
+          error=reader->GetError();
+          failed=true;
+          condition.notify_all();
+          return;
+        }
 
+        condition.wait(lock,[this]{return buffers.size()<maxBuffers || stopped;});
+
+        if (stopped) {
+          return;
+        }
+
+        bool finished=data.empty();
+
+        buffers.push_back(std::move(data));
+        position=reader->GetPosition();
+
+        condition.notify_all();
+
+        if (finished) {
+          return;
+        }
+      }
+    }
+
+  public:
+    explicit AsyncFileReader(OSMFileReader* reader)
+    : reader(reader),
+      failed(false),
+      stopped(false),
+      position(0)
+    {
+      // no code
+    }
+
+    ~AsyncFileReader()
+    {
+      Close();
+    }
+
+    bool Open(const std::string& filename)
+    {
+      if (!reader->Open(filename)) {
+        error=reader->GetError();
+        return false;
+      }
+
+      thread=std::thread(&AsyncFileReader::ReaderLoop,this);
+
+      return true;
+    }
+
+    bool Read(std::string& data)
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+
+      condition.wait(lock,[this]{return !buffers.empty() || failed;});
+
+      if (buffers.empty()) {
+        return false;
+      }
+
+      data=std::move(buffers.front());
+      buffers.pop_front();
+
+      condition.notify_all();
+
+      return true;
+    }
+
+    FileOffset GetPosition() const
+    {
+      return position;
+    }
+
+    void Close()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        stopped=true;
+        condition.notify_all();
+      }
+
+      if (thread.joinable()) {
+        thread.join();
+      }
+
+      reader->Close();
+    }
+  };
+
+  static bool HasSuffix(const std::string& filename,
+                        const std::string& suffix)
+  {
+    return filename.length()>=suffix.length() &&
+           filename.compare(filename.length()-suffix.length(),suffix.length(),suffix)==0;
+  }
+
+  static OSMFileReader* CreateFileReader(const std::string& filename,
+                                         std::string& error)
+  {
+    if (HasSuffix(filename,".gz")) {
+#if defined(HAVE_LIB_ZLIB)
+      return new AsyncFileReader(new GZipFileReader());
+#else
+      error="Data is gzip compressed but zlib support is not enabled!";
+      return NULL;
+#endif
+    }
+    else if (HasSuffix(filename,".bz2")) {
+#if defined(HAVE_LIB_BZIP2)
+      return new AsyncFileReader(new BZip2FileReader());
+#else
+      error="Data is bzip2 compressed but bzip2 support is not enabled!";
+      return NULL;
+#endif
+    }
+
+    return new PlainFileReader();
+  }
+
+  /**
+   * State of the scanner searching for the start of top level elements
+   */
+  enum ScannerState
+  {
+    scanText,
+    scanComment,
+    scanCData,
+    scanProcessingInstruction
+  };
+
+  static bool IsElementStart(const std::string& data,
+                             size_t pos,
+                             const char* name,
+                             size_t nameLength)
+  {
+    if (data.compare(pos+1,nameLength,name)!=0) {
       return false;
     }
 
+    char next=data[pos+1+nameLength];
+
+    return next==' ' || next=='\t' || next=='\n' || next=='\r' || next=='>' || next=='/';
+  }
+
+  /**
+   * Searches for the start of the next node, way or relation element, starting
+   * at the given position. Comments, CDATA sections and processing instructions
+   * are skipped. Since these elements are never nested, each of them is a
+   * valid boundary to split the document at.
+   *
+   * Returns false, if more data is required. The scanner then continues at the
+   * returned position on the next call.
+   */
+  static bool FindNextElementStart(const std::string& data,
+                                   size_t& pos,
+                                   ScannerState& state,
+                                   size_t& start)
+  {
+    // Length of the longest pattern we have to check ("<relation ")
+    const size_t lookAhead=10;
+
+    while (pos<data.length()) {
+      size_t end;
+
+      switch (state) {
+      case scanText:
+        pos=data.find('<',pos);
+
+        if (pos==std::string::npos) {
+          pos=data.length();
+          return false;
+        }
+
+        if (pos+lookAhead>data.length()) {
+          return false;
+        }
+
+        if (data.compare(pos,4,"<!--")==0) {
+          state=scanComment;
+          pos+=4;
+        }
+        else if (data.compare(pos,9,"<![CDATA[")==0) {
+          state=scanCData;
+          pos+=9;
+        }
+        else if (data.compare(pos,2,"<?")==0) {
+          state=scanProcessingInstruction;
+          pos+=2;
+        }
+        else if (IsElementStart(data,pos,"node",4) ||
+                 IsElementStart(data,pos,"way",3) ||
+                 IsElementStart(data,pos,"relation",8)) {
+          start=pos;
+          pos++;
+
+          return true;
+        }
+        else {
+          pos++;
+        }
+        break;
+      case scanComment:
+      case scanCData:
+      case scanProcessingInstruction: {
+        const char* terminator=state==scanComment ? "-->" : (state==scanCData ? "]]>" : "?>");
+
+        end=data.find(terminator,pos);
+
+        if (end==std::string::npos) {
+          // The terminator may be split between two pieces of data
+          pos=std::max(pos,data.length()-std::min(data.length(),(size_t)2));
+          return false;
+        }
+
+        pos=end+strlen(terminator);
+        state=scanText;
+        break;
+      }
+      }
+    }
+
+    return false;
+  }
+
+  /**
+   * Returns the name of the root element of the document
+   */
+  static std::string GetRootElementName(const std::string& header)
+  {
+    size_t pos=0;
+
+    while ((pos=header.find('<',pos))!=std::string::npos) {
+      pos++;
+
+      if (pos<header.length() &&
+          header[pos]!='?' &&
+          header[pos]!='!') {
+        size_t end=header.find_first_of(" \t\r\n/>",pos);
+
+        if (end==std::string::npos) {
+          end=header.length();
+        }
+
+        return header.substr(pos,end-pos);
+      }
+    }
+
+    return "";
+  }
+
+  PreprocessOSM::PreprocessOSM(PreprocessorCallback& callback)
+  : callback(callback),
+    deliveryError(false)
+  {
+    // no code
+  }
+
+  /**
+   * Parses the given chunk of top level elements. The header (the document start
+   * up to the first top level element) is parsed in front of the chunk and the
+   * closing tag of the root element (if not part of the chunk) is appended,
+   * so that each chunk is a complete document. Executed in parallel
+   * by the chunk worker threads, so warnings and errors are only collected.
+   */
+  PreprocessOSM::ParsedChunkRef PreprocessOSM::ParseChunk(const TypeConfigRef& typeConfig,
+                                                          const std::string& filename,
+                                                          std::shared_ptr<const std::string> header,
+                                                          std::shared_ptr<const std::string> chunk,
+                                                          const std::string& closingTag)
+  {
+    // libxml only accepts chunks with a size fitting into an int
+    const size_t     maxChunkSize=1024*1024;
+    ParsedChunkRef   result=std::make_shared<ParsedChunk>();
+    BlockCollector   collector;
+    Parser           parser(*typeConfig,
+                            result->warnings,
+                            result->errors,
+                            collector);
+    xmlSAXHandler    saxParser;
+    xmlParserCtxtPtr ctxt;
+    bool             success=true;
+
+    InitializeSAXHandler(saxParser);
+
+    ctxt=xmlCreatePushParserCtxt(&saxParser,&parser,NULL,0,NULL);
+
+    if (ctxt==NULL) {
+      throw IOException(filename,"Cannot create XML parser",std::string());
+    }
+
+    // Resolve entities, do not do any network communication
+    xmlCtxtUseOptions(ctxt,XML_PARSE_NOENT|XML_PARSE_NONET);
+
+    for (const std::string* data : { header.get(), chunk.get(), &closingTag }) {
+      for (size_t offset=0;
+           success && offset<data->length();
+           offset+=maxChunkSize) {
+        if (xmlParseChunk(ctxt,
+                          data->data()+offset,
+                          (int)std::min(maxChunkSize,data->length()-offset),
+                          0)!=0) {
+          success=false;
+        }
+      }
+    }
+
+    if (success &&
+        xmlParseChunk(ctxt,NULL,0,1)!=0) {
+      success=false;
+    }
+
     xmlFreeParserCtxt(ctxt);
-    fclose(file);
+
+    result->blocks=std::move(collector.blocks);
+    result->success=success;
+
+    return result;
+  }
+
+  /**
+   * Waits for the given chunk to get parsed, reports the warnings and errors of
+   * the parser and passes the resulting blocks to the callback. Executed by the
+   * delivery thread in the order of the file.
+   */
+  void PreprocessOSM::DeliverBlocks(Progress& progress,
+                                    const std::string& filename,
+                                    std::shared_future<ParsedChunkRef> chunk)
+  {
+    if (deliveryError) {
+      // Skip all remaining chunks after an error, the reader will stop, too
+      return;
+    }
+
+    try {
+      const ParsedChunkRef& parsedChunk=chunk.get();
+
+      for (const auto& warning : parsedChunk->warnings) {
+        progress.Warning(warning);
+      }
+
+      for (const auto& error : parsedChunk->errors) {
+        progress.Error(error);
+      }
+
+      if (!parsedChunk->success) {
+        throw IOException(filename,"Cannot parse XML data",std::string());
+      }
+
+      for (const auto& block : parsedChunk->blocks) {
+        callback.ProcessBlock(block);
+      }
+    }
+    catch (IOException& e) {
+      deliveryErrorMessage=e.GetDescription();
+      deliveryError=true;
+    }
+  }
+
+  void PreprocessOSM::ChunkWorkerLoop(ChunkWorkerQueue& queue)
+  {
+    std::packaged_task<ParsedChunkRef()> task;
+
+    while (queue.PopTask(task)) {
+      task();
+    }
+  }
+
+  void PreprocessOSM::DeliveryLoop(DeliveryQueue& queue)
+  {
+    std::packaged_task<void()> task;
+
+    while (queue.PopTask(task)) {
+      task();
+    }
+  }
+
+  /**
+   * Reads the file, splits it into chunks at the start of top level elements
+   * and pushes the chunks into the pipeline.
+   */
+  bool PreprocessOSM::ReadChunks(const TypeConfigRef& typeConfig,
+                                 Progress& progress,
+                                 const std::string& filename,
+                                 OSMFileReader& reader,
+                                 FileOffset fileSize,
+                                 ChunkWorkerQueue& chunkWorkerQueue,
+                                 DeliveryQueue& deliveryQueue)
+  {
+    // Minimum size of a chunk
+    const size_t                       chunkSize=4*1024*1024;
+    std::shared_ptr<const std::string> header;
+    std::string                        closingTag;
+    std::string                        pending;       // Data read, but not yet passed as chunk
+    std::string                        data;
+    size_t                             scanPos=0;
+    ScannerState                       scanState=scanText;
+    size_t                             lastElementStart=0;
+    bool                               eof=false;
+
+    while (!eof && !deliveryError) {
+      if (!reader.Read(data)) {
+        progress.Error(reader.GetError());
+        return false;
+      }
+
+      progress.SetProgress(reader.GetPosition(),
+                           fileSize);
+
+      eof=data.empty();
+      pending.append(data);
+
+      size_t elementStart;
+
+      while (FindNextElementStart(pending,
+                                  scanPos,
+                                  scanState,
+                                  elementStart)) {
+        if (!header) {
+          // Everything in front of the first top level element is the header
+          header=std::make_shared<const std::string>(pending.substr(0,elementStart));
+          closingTag="</"+GetRootElementName(*header)+">";
+
+          pending.erase(0,elementStart);
+          scanPos-=elementStart;
+          elementStart=0;
+        }
+
+        lastElementStart=elementStart;
+      }
+
+      std::shared_ptr<const std::string> chunk;
+      std::string                        chunkClosingTag;
+
+      if (eof) {
+        // The last chunk contains the end of the document
+        if (!header) {
+          header=std::make_shared<const std::string>();
+        }
+
+        chunk=std::make_shared<const std::string>(std::move(pending));
+      }
+      else if (header &&
+               lastElementStart>0 &&
+               pending.length()>=chunkSize) {
+        chunk=std::make_shared<const std::string>(pending.substr(0,lastElementStart));
+        chunkClosingTag=closingTag;
+
+        pending.erase(0,lastElementStart);
+        scanPos-=lastElementStart;
+        lastElementStart=0;
+      }
+
+      if (!chunk) {
+        continue;
+      }
+
+      std::packaged_task<ParsedChunkRef()> chunkTask(std::bind(&PreprocessOSM::ParseChunk,
+                                                               typeConfig,
+                                                               filename,
+                                                               header,
+                                                               chunk,
+                                                               chunkClosingTag));
+      // We use a shared_future because packaged_task does not work an all system with future, because future
+      // is only moveable.
+      std::shared_future<ParsedChunkRef> parsedChunk(chunkTask.get_future());
+
+      chunk.reset();
+
+      std::packaged_task<void()> deliveryTask(std::bind(&PreprocessOSM::DeliverBlocks,this,
+                                                        std::ref(progress),
+                                                        filename,
+                                                        parsedChunk));
+
+      deliveryQueue.PushTask(deliveryTask);
+      chunkWorkerQueue.PushTask(chunkTask);
+    }
 
     return true;
   }
+
+  bool PreprocessOSM::Import(const TypeConfigRef& typeConfig,
+                             const ImportParameter& parameter,
+                             Progress& progress,
+                             const std::string& filename)
+  {
+    FileOffset fileSize;
+    std::string error;
+
+    progress.SetAction(std::string("Parsing *.osm file '")+filename+"'");
+
+    try {
+      fileSize=GetFileSize(filename);
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
+      return false;
+    }
+
+    std::unique_ptr<OSMFileReader> reader(CreateFileReader(filename,
+                                                           error));
+
+    if (!reader) {
+      progress.Error(error);
+      return false;
+    }
+
+    if (!reader->Open(filename)) {
+      progress.Error(reader->GetError());
+      return false;
+    }
+
+    // Must be called before using libxml from multiple threads
+    xmlInitParser();
+
+    size_t                   queueSize=std::max((size_t)1,parameter.GetProcessingQueueSize());
+    size_t                   chunkWorkerCount=std::max((unsigned int)1,std::thread::hardware_concurrency());
+    ChunkWorkerQueue         chunkWorkerQueue(queueSize);
+    DeliveryQueue            deliveryQueue(queueSize);
+    std::vector<std::thread> chunkWorkerThreads;
+
+    progress.Info("Using "+NumberToString(chunkWorkerCount)+" parser threads");
+
+    deliveryError=false;
+    deliveryErrorMessage.clear();
+
+    std::thread deliveryThread(&PreprocessOSM::DeliveryLoop,std::ref(deliveryQueue));
+
+    for (size_t t=1; t<=chunkWorkerCount; t++) {
+      chunkWorkerThreads.push_back(std::thread(&PreprocessOSM::ChunkWorkerLoop,std::ref(chunkWorkerQueue)));
+    }
+
+    bool result=ReadChunks(typeConfig,
+                           progress,
+                           filename,
+                           *reader,
+                           fileSize,
+                           chunkWorkerQueue,
+                           deliveryQueue);
+
+    reader->Close();
+
+    // Wait until all pending chunks are parsed and delivered
+
+    chunkWorkerQueue.Stop();
+
+    for (auto& thread : chunkWorkerThreads) {
+      thread.join();
+    }
+
+    deliveryQueue.Stop();
+    deliveryThread.join();
+
+    if (deliveryError) {
+      progress.Error(deliveryErrorMessage);
+      return false;
+    }
+
+    return result;
+  }
 }
@@ -21,7 +21,9 @@
 
 #include <osmscout/import/PreprocessPBF.h>
 
+#include <algorithm>
 #include <cstdio>
+#include <thread>
 
 #if defined(HAVE_FCNTL_H)
   #include <fcntl.h>
@@ -80,7 +82,7 @@ namespace osmscout {
       bufferSize=length;
     }
     else if (bufferSize<length) {
-      delete buffer;
+      delete [] buffer;
       buffer=new char[length];
       bufferSize=length;
     }
@@ -111,7 +113,6 @@ namespace osmscout {
 
     if (fread(buffer,sizeof(char),length,file)!=length) {
       progress.Error("Cannot read block header!");
-      delete[] buffer;
       return false;
     }
 
@@ -128,75 +129,25 @@ namespace osmscout {
                                       const PBF::BlockHeader& blockHeader,
                                       PBF::HeaderBlock& headerBlock)
   {
-    PBF::Blob               blob;
-    google::protobuf::int32 length=blockHeader.datasize();
-
-    if (length==0 || length>MAX_BLOB_SIZE) {
-      progress.Error("Blob size invalid!");
+    std::string data;
+    std::string content;
+    std::string error;
+
+    if (!ReadBlob(progress,
+                  file,
+                  blockHeader,
+                  data)) {
       return false;
     }
 
-    AssureBlockSize(length);
-
-    if (fread(buffer,sizeof(char),length,file)!=(size_t)length) {
-      progress.Error("Cannot read blob!");
+    if (!DecodeBlob(data,
+                    content,
+                    error)) {
+      progress.Error(error);
       return false;
     }
 
-    if (!blob.ParseFromArray(buffer,length)) {
-      progress.Error("Cannot parse blob!");
-      return false;
-    }
-
-    if (blob.has_raw()) {
-      length=(uint32_t)blob.raw().length();
-      AssureBlockSize(length);
-      memcpy(buffer,blob.raw().data(),(size_t)length);
-    }
-    else if (blob.has_zlib_data()) {
-#if defined(HAVE_LIB_ZLIB)
-      length=blob.raw_size();
-      AssureBlockSize(length);
-
-      z_stream compressedStream;
-
-      compressedStream.next_in=(Bytef*)const_cast<char*>(blob.zlib_data().data());
-      compressedStream.avail_in=(uint32_t)blob.zlib_data().size();
-      compressedStream.next_out=(Bytef*)buffer;
-      compressedStream.avail_out=(uInt)length;
-      compressedStream.zalloc=Z_NULL;
-      compressedStream.zfree=Z_NULL;
-      compressedStream.opaque=Z_NULL;
-
-      if (inflateInit( &compressedStream)!=Z_OK) {
-        progress.Error("Cannot decode zlib compressed blob data!");
-        return false;
-      }
-
-      if (inflate(&compressedStream,Z_FINISH)!=Z_STREAM_END) {
-        progress.Error("Cannot decode zlib compressed blob data!");
-        return false;
-      }
-
-      if (inflateEnd(&compressedStream)!=Z_OK) {
-        progress.Error("Cannot decode zlib compressed blob data!");
-        return false;
-      }
-#else
-      progress.Error("Data is zlib encoded but zlib support is not enabled!");
-      return false;
-#endif
-    }
-    else if (blob.has_bzip2_data()) {
-      progress.Error("Data is bzip2 encoded but bzip2 support is not enabled!");
-      return false;
-    }
-    else if (blob.has_lzma_data()) {
-      progress.Error("Data is lzma encoded but lzma support is not enabled!");
-      return false;
-    }
-
-    if (!headerBlock.ParseFromArray(buffer,length)) {
+    if (!headerBlock.ParseFromString(content)) {
       progress.Error("Cannot parse header block!");
       return false;
     }
@@ -204,81 +155,97 @@ namespace osmscout {
     return true;
   }
 
-  bool PreprocessPBF::ReadPrimitiveBlock(Progress& progress,
-                                         FILE* file,
-                                         const PBF::BlockHeader& blockHeader,
-                                         PBF::PrimitiveBlock& primitiveBlock)
+  /**
+   * Reads the raw blob data following the given block header. Decoding of the
+   * data is done later on by DecodeBlob().
+   */
+  bool PreprocessPBF::ReadBlob(Progress& progress,
+                               FILE* file,
+                               const PBF::BlockHeader& blockHeader,
+                               std::string& data)
   {
-    PBF::Blob               blob;
     google::protobuf::int32 length=blockHeader.datasize();
 
-    if (length==0 || length>MAX_BLOB_SIZE) {
+    if (length<=0 || length>MAX_BLOB_SIZE) {
       progress.Error("Blob size invalid!");
       return false;
     }
 
-    AssureBlockSize(length);
+    data.resize((size_t)length);
 
-    if (fread(buffer,sizeof(char),length,file)!=(size_t)length) {
+    if (fread(&data[0],sizeof(char),(size_t)length,file)!=(size_t)length) {
       progress.Error("Cannot read blob!");
       return false;
     }
 
-    if (!blob.ParseFromArray(buffer,length)) {
-      progress.Error("Cannot parse blob!");
+    return true;
+  }
+
+  /**
+   * Parses the blob and returns its (uncompressed) content. This method does not
+   * access any state and thus can be called in parallel.
+   */
+  bool PreprocessPBF::DecodeBlob(const std::string& data,
+                                 std::string& content,
+                                 std::string& error)
+  {
+    PBF::Blob blob;
+
+    if (!blob.ParseFromString(data)) {
+      error="Cannot parse blob!";
       return false;
     }
 
     if (blob.has_raw()) {
-      length=(uint32_t)blob.raw().length();
-      AssureBlockSize(length);
-      memcpy(buffer,blob.raw().data(),(size_t)length);
+      content=blob.raw();
     }
     else if (blob.has_zlib_data()) {
 #if defined(HAVE_LIB_ZLIB)
-      length=blob.raw_size();
-      AssureBlockSize(length);
+      google::protobuf::int32 length=blob.raw_size();
+
+      if (length<0 || length>MAX_BLOB_SIZE) {
+        error="Blob size invalid!";
+        return false;
+      }
+
+      content.resize((size_t)length);
 
       z_stream compressedStream;
 
       compressedStream.next_in=(Bytef*)const_cast<char*>(blob.zlib_data().data());
       compressedStream.avail_in=(uint32_t)blob.zlib_data().size();
-      compressedStream.next_out=(Bytef*)buffer;
+      compressedStream.next_out=(Bytef*)&content[0];
       compressedStream.avail_out=(uInt)length;
       compressedStream.zalloc=Z_NULL;
       compressedStream.zfree=Z_NULL;
       compressedStream.opaque=Z_NULL;
 
       if (inflateInit( &compressedStream)!=Z_OK) {
-        progress.Error("Cannot decode zlib compressed blob data!");
+        error="Cannot decode zlib compressed blob data!";
         return false;
       }
 
       if (inflate(&compressedStream,Z_FINISH)!=Z_STREAM_END) {
-        progress.Error("Cannot decode zlib compressed blob data!");
+        inflateEnd(&compressedStream);
+        error="Cannot decode zlib compressed blob data!";
         return false;
       }
 
       if (inflateEnd(&compressedStream)!=Z_OK) {
-        progress.Error("Cannot decode zlib compressed blob data!");
+        error="Cannot decode zlib compressed blob data!";
         return false;
       }
 #else
-      progress.Error("Data is zlib encoded but zlib support is not enabled!");
+      error="Data is zlib encoded but zlib support is not enabled!";
       return false;
 #endif
     }
     else if (blob.has_bzip2_data()) {
-      progress.Error("Data is bzip2 encoded but bzip2 support is not enabled!");
+      error="Data is bzip2 encoded but bzip2 support is not enabled!";
       return false;
     }
     else if (blob.has_lzma_data()) {
-      progress.Error("Data is lzma encoded but lzma support is not enabled!");
-      return false;
-    }
-
-    if (!primitiveBlock.ParseFromArray(buffer,length)) {
-      progress.Error("Cannot parse primitive block!");
+      error="Data is lzma encoded but lzma support is not enabled!";
       return false;
     }
 
@@ -301,8 +268,6 @@ namespace osmscout {
       nodeData.coord.Set((inputNode.lat()*block.granularity()+block.lat_offset())/NANO,
                          (inputNode.lon()*block.granularity()+block.lon_offset())/NANO);
 
-      tagMap.clear();
-
       for (int t=0; t<inputNode.keys_size(); t++) {
         TagId id=typeConfig.GetTagId(block.stringtable().s(inputNode.keys(t)));
 
@@ -411,8 +376,6 @@ namespace osmscout {
 
       relationData.id=inputRelation.id();
 
-      members.clear();
-
       for (int t=0; t<inputRelation.keys_size(); t++) {
         TagId id=typeConfig.GetTagId(block.stringtable().s(inputRelation.keys(t)));
 
@@ -454,174 +417,290 @@ namespace osmscout {
   PreprocessPBF::PreprocessPBF(PreprocessorCallback& callback)
   : buffer(NULL),
     bufferSize(0),
-    callback(callback)
+    callback(callback),
+    deliveryError(false)
   {
     // no code
   }
 
   PreprocessPBF::~PreprocessPBF()
   {
-    delete buffer;
+    delete [] buffer;
   }
 
-  void PreprocessPBF::ProcessBlock(const TypeConfigRef& typeConfig,
-                                   std::unique_ptr<PBF::PrimitiveBlock>&& block)
+  /**
+   * Decodes the given blob and converts the contained primitive block.
+   * Executed in parallel by the block worker threads.
+   */
+  PreprocessorCallback::RawBlockDataRef PreprocessPBF::DecodeBlock(const TypeConfigRef& typeConfig,
+                                                                   const std::string& filename,
+                                                                   BlobDataRef blobData)
   {
+    std::string content;
+    std::string error;
+
+    if (!DecodeBlob(*blobData,
+                    content,
+                    error)) {
+      throw IOException(filename,"Cannot decode data block",error);
+    }
+
+    // Free the raw data as early as possible
+    blobData.reset();
+
+    PBF::PrimitiveBlock block;
+
+    if (!block.ParseFromString(content)) {
+      throw IOException(filename,"Cannot decode data block","Cannot parse primitive block!");
+    }
+
+    content.clear();
+
     PreprocessorCallback::RawBlockDataRef blockData(new PreprocessorCallback::RawBlockData());
 
     for (int currentGroup=0;
-         currentGroup<block->primitivegroup_size();
+         currentGroup<block.primitivegroup_size();
          currentGroup++) {
-      const PBF::PrimitiveGroup &group=block->primitivegroup(currentGroup);
+      const PBF::PrimitiveGroup &group=block.primitivegroup(currentGroup);
 
       if (group.nodes_size()>0) {
         ReadNodes(*typeConfig,
-                  *block,
+                  block,
                   group,
                   *blockData);
       }
       else if (group.has_dense()) {
         ReadDenseNodes(*typeConfig,
-                       *block,
+                       block,
                        group,
                        *blockData);
       }
       else if (group.ways_size()>0) {
         ReadWays(*typeConfig,
-                 *block,
+                 block,
                  group,
                  *blockData);
       }
       else if (group.relations_size()>0) {
         ReadRelations(*typeConfig,
-                      *block,
+                      block,
                       group,
                       *blockData);
       }
     }
 
-    callback.ProcessBlock(std::move(blockData));
+    return blockData;
   }
 
-  bool PreprocessPBF::Import(const TypeConfigRef& typeConfig,
-                             const ImportParameter& /*parameter*/,
-                             Progress& progress,
-                             const std::string& filename)
+  /**
+   * Waits for the given block to get decoded and passes it to the callback.
+   * Executed by the delivery thread in the order the blocks were read.
+   */
+  void PreprocessPBF::DeliverBlock(std::shared_future<PreprocessorCallback::RawBlockDataRef> blockData)
   {
-    FileOffset fileSize;
-    FileOffset currentPosition;
-
-    progress.SetAction(std::string("Parsing *.osm.pbf file '")+filename+"'");
+    if (deliveryError) {
+      // Skip all remaining blocks after an error, the reader will stop, too
+      return;
+    }
 
     try {
-      fileSize=GetFileSize(filename);
+      callback.ProcessBlock(blockData.get());
+    }
+    catch (IOException& e) {
+      deliveryErrorMessage=e.GetDescription();
+      deliveryError=true;
+    }
+  }
 
-      FILE* file;
+  void PreprocessPBF::BlockWorkerLoop(BlockWorkerQueue& queue)
+  {
+    std::packaged_task<PreprocessorCallback::RawBlockDataRef()> task;
 
-      file=fopen(filename.c_str(),"rb");
+    while (queue.PopTask(task)) {
+      task();
+    }
+  }
 
-      if (file==NULL) {
-        progress.Error("Cannot open file!");
-        return false;
-      }
+  void PreprocessPBF::DeliveryLoop(DeliveryQueue& queue)
+  {
+    std::packaged_task<void()> task;
 
-      // BlockHeader
+    while (queue.PopTask(task)) {
+      task();
+    }
+  }
+
+  /**
+   * Reads all data blocks of the file and pushes them into the pipeline.
+   */
+  bool PreprocessPBF::ReadBlocks(const TypeConfigRef& typeConfig,
+                                 Progress& progress,
+                                 const std::string& filename,
+                                 FILE* file,
+                                 FileOffset fileSize,
+                                 BlockWorkerQueue& blockWorkerQueue,
+                                 DeliveryQueue& deliveryQueue)
+  {
+    FileOffset currentPosition;
 
+    while (!deliveryError) {
       PBF::BlockHeader blockHeader;
 
-      if (!ReadBlockHeader(progress,file,blockHeader,false)) {
-        fclose(file);
+      if (!GetPos(file,
+                  currentPosition)) {
+        progress.Error("Cannot read current position in '"+filename+"'!");
         return false;
       }
 
-      if (blockHeader.type()!="OSMHeader") {
+      progress.SetProgress(currentPosition,
+                           fileSize);
+
+      if (!ReadBlockHeader(progress,
+                           file,
+                           blockHeader,
+                           true)) {
+        break;
+      }
+
+      if (blockHeader.type()!="OSMData") {
         progress.Error("File '"+filename+"' is not an OSM PBF file!");
-        fclose(file);
         return false;
       }
 
-      PBF::HeaderBlock headerBlock;
+      BlobDataRef blobData=std::make_shared<std::string>();
 
-      if (!ReadHeaderBlock(progress,
-                           file,
-                           blockHeader,
-                           headerBlock)) {
-        fclose(file);
+      if (!ReadBlob(progress,
+                    file,
+                    blockHeader,
+                    *blobData)) {
         return false;
       }
 
-      for (int i=0; i<headerBlock.required_features_size(); i++) {
-        std::string feature=headerBlock.required_features(i);
-        if (feature!="OsmSchema-V0.6" &&
-            feature!="DenseNodes") {
-          progress.Error(std::string("Unsupported feature '")+feature+"'");
-          fclose(file);
-          return false;
-        }
-      }
+      std::packaged_task<PreprocessorCallback::RawBlockDataRef()> blockTask(std::bind(&PreprocessPBF::DecodeBlock,
+                                                                                      typeConfig,
+                                                                                      filename,
+                                                                                      blobData));
+      // We use a shared_future because packaged_task does not work an all system with future, because future
+      // is only moveable.
+      std::shared_future<PreprocessorCallback::RawBlockDataRef> blockData(blockTask.get_future());
 
-      nodes.reserve(20000);
-      members.reserve(2000);
+      blobData.reset();
 
-      std::future<void> currentBlockTask;
+      // The delivery queue is filled first, so that it blocks the reader
+      // if the maximum number of blocks in flight is reached
+      std::packaged_task<void()> deliveryTask(std::bind(&PreprocessPBF::DeliverBlock,this,
+                                                        blockData));
 
-      while (true) {
-        PBF::BlockHeader blockHeader;
+      deliveryQueue.PushTask(deliveryTask);
+      blockWorkerQueue.PushTask(blockTask);
+    }
 
-        if (!GetPos(file,
-                    currentPosition)) {
-          progress.Error("Cannot read current position in '"+filename+"'!");
-          fclose(file);
-          return false;
-        }
+    return true;
+  }
 
-        progress.SetProgress(currentPosition,
-                             fileSize);
+  bool PreprocessPBF::Import(const TypeConfigRef& typeConfig,
+                             const ImportParameter& parameter,
+                             Progress& progress,
+                             const std::string& filename)
+  {
+    FileOffset fileSize;
+    FILE*      file;
 
-        if (!ReadBlockHeader(progress,
-                             file,
-                             blockHeader,
-                             true)) {
-          fclose(file);
-          break;
-        }
+    progress.SetAction(std::string("Parsing *.osm.pbf file '")+filename+"'");
 
-        if (blockHeader.type()!="OSMData") {
-          progress.Error("File '"+filename+"' is not an OSM PBF file!");
-          fclose(file);
-          return false;
-        }
+    try {
+      fileSize=GetFileSize(filename);
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
+      return false;
+    }
 
-        std::unique_ptr<PBF::PrimitiveBlock> block(new PBF::PrimitiveBlock());
+    file=fopen(filename.c_str(),"rb");
 
-        if (!ReadPrimitiveBlock(progress,
-                                file,
-                                blockHeader,
-                                *block)) {
-          fclose(file);
-          return false;
-        }
+    if (file==NULL) {
+      progress.Error("Cannot open file!");
+      return false;
+    }
 
-        if (currentBlockTask.valid()) {
-          currentBlockTask.get();
-        }
+    // BlockHeader
 
-        currentBlockTask=std::async(std::launch::async,
-                                    &PreprocessPBF::ProcessBlock,this,
-                                    typeConfig,
-                                    std::move(block));
-      }
+    PBF::BlockHeader blockHeader;
+
+    if (!ReadBlockHeader(progress,file,blockHeader,false)) {
+      fclose(file);
+      return false;
+    }
+
+    if (blockHeader.type()!="OSMHeader") {
+      progress.Error("File '"+filename+"' is not an OSM PBF file!");
+      fclose(file);
+      return false;
+    }
 
-      if (currentBlockTask.valid()) {
-        currentBlockTask.get();
+    PBF::HeaderBlock headerBlock;
+
+    if (!ReadHeaderBlock(progress,
+                         file,
+                         blockHeader,
+                         headerBlock)) {
+      fclose(file);
+      return false;
+    }
+
+    for (int i=0; i<headerBlock.required_features_size(); i++) {
+      std::string feature=headerBlock.required_features(i);
+      if (feature!="OsmSchema-V0.6" &&
+          feature!="DenseNodes") {
+        progress.Error(std::string("Unsupported feature '")+feature+"'");
+        fclose(file);
+        return false;
       }
     }
-    catch (IOException& e) {
-      progress.Error(e.GetDescription());
+
+    size_t                   queueSize=std::max((size_t)1,parameter.GetProcessingQueueSize());
+    size_t                   blockWorkerCount=std::max((unsigned int)1,std::thread::hardware_concurrency());
+    BlockWorkerQueue         blockWorkerQueue(queueSize);
+    DeliveryQueue            deliveryQueue(queueSize);
+    std::vector<std::thread> blockWorkerThreads;
+
+    progress.Info("Using "+NumberToString(blockWorkerCount)+" block decoder threads");
+
+    deliveryError=false;
+    deliveryErrorMessage.clear();
+
+    std::thread deliveryThread(&PreprocessPBF::DeliveryLoop,std::ref(deliveryQueue));
+
+    for (size_t t=1; t<=blockWorkerCount; t++) {
+      blockWorkerThreads.push_back(std::thread(&PreprocessPBF::BlockWorkerLoop,std::ref(blockWorkerQueue)));
+    }
+
+    bool result=ReadBlocks(typeConfig,
+                           progress,
+                           filename,
+                           file,
+                           fileSize,
+                           blockWorkerQueue,
+                           deliveryQueue);
+
+    fclose(file);
+
+    // Wait until all pending blocks are decoded and delivered
+
+    blockWorkerQueue.Stop();
+
+    for (auto& thread : blockWorkerThreads) {
+      thread.join();
+    }
+
+    deliveryQueue.Stop();
+    deliveryThread.join();
+
+    if (deliveryError) {
+      progress.Error(deliveryErrorMessage);
       return false;
     }
 
-    return true;
+    return result;
   }
 }
-
@@ -0,0 +1,87 @@
+#ifndef OSMSCOUT_TILEPYRAMIDWORKERAGG_H
+#define OSMSCOUT_TILEPYRAMIDWORKERAGG_H
+
+/*
+  This source is part of the libosmscout-map library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <vector>
+
+#include <osmscout/private/MapAggImportExport.h>
+
+#include <osmscout/MapPainterAgg.h>
+#include <osmscout/TilePyramidRenderer.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Renderer
+   *
+   * TilePyramidWorker for the Agg backend. The worker holds its own painter and
+   * buffer. Meta tiles are rendered in one pass into the buffer, which is then
+   * sliced into the individual tiles. Derived classes get the tiles passed to
+   * WriteTile().
+   */
+  class OSMSCOUT_MAP_AGG_API TilePyramidWorkerAgg : public TilePyramidWorker
+  {
+  private:
+    MapPainterAgg              painter;
+    MapParameter               parameter;
+    std::vector<unsigned char> buffer;
+
+  private:
+    bool Render(const TileProjection& projection,
+                agg::rendering_buffer& renderingBuffer,
+                const MapData& data);
+
+  protected:
+    /**
+     * Called for each rendered tile.
+     *
+     * @param magnification
+     *    Magnification (zoom level) of the tile
+     * @param x
+     *    x coordinate of the tile
+     * @param y
+     *    y coordinate of the tile
+     * @param tile
+     *    Buffer holding the image of the tile (RGB24)
+     * @return
+     *    False, if there was an error, else true.
+     */
+    virtual bool WriteTile(const Magnification& magnification,
+                           size_t x,
+                           size_t y,
+                           const agg::rendering_buffer& tile) = 0;
+
+  public:
+    TilePyramidWorkerAgg(const StyleConfigRef& styleConfig,
+                         const MapParameter& parameter);
+    virtual ~TilePyramidWorkerAgg();
+
+    bool RenderTile(const TileProjection& projection,
+                    size_t x,
+                    size_t y,
+                    const MapData& data);
+
+    bool RenderMetaTile(const MetaTile& metaTile,
+                        const MapData& data);
+  };
+}
+
+#endif
@@ -0,0 +1,119 @@
+/*
+  This source is part of the libosmscout-map library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/TilePyramidWorkerAgg.h>
+
+#include <algorithm>
+
+namespace osmscout {
+
+  TilePyramidWorkerAgg::TilePyramidWorkerAgg(const StyleConfigRef& styleConfig,
+                                             const MapParameter& parameter)
+  : painter(styleConfig),
+    parameter(parameter)
+  {
+    // no code
+  }
+
+  TilePyramidWorkerAgg::~TilePyramidWorkerAgg()
+  {
+    // no code
+  }
+
+  /**
+   * Render the data into the (reused) buffer, that gets resized to the size of the projection
+   */
+  bool TilePyramidWorkerAgg::Render(const TileProjection& projection,
+                                    agg::rendering_buffer& renderingBuffer,
+                                    const MapData& data)
+  {
+    size_t stride=projection.GetWidth()*3;
+
+    buffer.resize(stride*projection.GetHeight());
+    std::fill(buffer.begin(),buffer.end(),0);
+
+    renderingBuffer.attach(buffer.data(),
+                           (unsigned int)projection.GetWidth(),
+                           (unsigned int)projection.GetHeight(),
+                           (int)stride);
+
+    agg::pixfmt_rgb24 pf(renderingBuffer);
+
+    return painter.DrawMap(projection,
+                           parameter,
+                           data,
+                           &pf);
+  }
+
+  bool TilePyramidWorkerAgg::RenderTile(const TileProjection& projection,
+                                        size_t x,
+                                        size_t y,
+                                        const MapData& data)
+  {
+    agg::rendering_buffer renderingBuffer;
+
+    if (!Render(projection,
+                renderingBuffer,
+                data)) {
+      return false;
+    }
+
+    return WriteTile(projection.GetMagnification(),
+                     x,y,
+                     renderingBuffer);
+  }
+
+  /**
+   * Renders the meta tile in one pass. The tiles passed to WriteTile() reference
+   * the part of the meta tile buffer without the margin, so no pixels are copied.
+   */
+  bool TilePyramidWorkerAgg::RenderMetaTile(const MetaTile& metaTile,
+                                            const MapData& data)
+  {
+    agg::rendering_buffer renderingBuffer;
+
+    if (!Render(metaTile.projection,
+                renderingBuffer,
+                data)) {
+      return false;
+    }
+
+    size_t stride=metaTile.projection.GetWidth()*3;
+
+    for (size_t y=0; y<metaTile.yCount; y++) {
+      for (size_t x=0; x<metaTile.xCount; x++) {
+        size_t                offset=(metaTile.margin+y*metaTile.tileHeight)*stride+
+                                     (metaTile.margin+x*metaTile.tileWidth)*3;
+        agg::rendering_buffer tile(buffer.data()+offset,
+                                   (unsigned int)metaTile.tileWidth,
+                                   (unsigned int)metaTile.tileHeight,
+                                   (int)stride);
+
+        if (!WriteTile(metaTile.projection.GetMagnification(),
+                       metaTile.xStart+x,
+                       metaTile.yStart+y,
+                       tile)) {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+}
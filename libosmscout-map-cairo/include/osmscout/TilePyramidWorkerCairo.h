@@ -0,0 +1,84 @@
+#ifndef OSMSCOUT_TILEPYRAMIDWORKERCAIRO_H
+#define OSMSCOUT_TILEPYRAMIDWORKERCAIRO_H
+
+/*
+  This source is part of the libosmscout-map library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/private/MapCairoImportExport.h>
+
+#include <osmscout/MapPainterCairo.h>
+#include <osmscout/TilePyramidRenderer.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Renderer
+   *
+   * TilePyramidWorker for the Cairo backend. The worker holds its own painter and
+   * image surface. Meta tiles are rendered in one pass into the surface, which is
+   * then sliced into the individual tiles. Derived classes get the tiles passed to
+   * WriteTile().
+   */
+  class OSMSCOUT_MAP_CAIRO_API TilePyramidWorkerCairo : public TilePyramidWorker
+  {
+  private:
+    MapPainterCairo painter;    //!< Painter of this worker
+    MapParameter    parameter;  //!< Parameter for drawing
+    cairo_surface_t *surface;   //!< Reused surface for rendering (meta) tiles
+
+  private:
+    bool Render(const TileProjection& projection,
+                const MapData& data);
+
+  protected:
+    /**
+     * Called for each rendered tile.
+     *
+     * @param magnification
+     *    Magnification (zoom level) of the tile
+     * @param x
+     *    x coordinate of the tile
+     * @param y
+     *    y coordinate of the tile
+     * @param tile
+     *    Surface holding the image of the tile, only valid during the call
+     * @return
+     *    False, if there was an error, else true.
+     */
+    virtual bool WriteTile(const Magnification& magnification,
+                           size_t x,
+                           size_t y,
+                           cairo_surface_t* tile) = 0;
+
+  public:
+    TilePyramidWorkerCairo(const StyleConfigRef& styleConfig,
+                           const MapParameter& parameter);
+    virtual ~TilePyramidWorkerCairo();
+
+    bool RenderTile(const TileProjection& projection,
+                    size_t x,
+                    size_t y,
+                    const MapData& data);
+
+    bool RenderMetaTile(const MetaTile& metaTile,
+                        const MapData& data);
+  };
+}
+
+#endif
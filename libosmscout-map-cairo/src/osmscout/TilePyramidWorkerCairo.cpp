@@ -0,0 +1,136 @@
+/*
+  This source is part of the libosmscout-map library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/TilePyramidWorkerCairo.h>
+
+#include <osmscout/util/Logger.h>
+
+namespace osmscout {
+
+  TilePyramidWorkerCairo::TilePyramidWorkerCairo(const StyleConfigRef& styleConfig,
+                                                 const MapParameter& parameter)
+  : painter(styleConfig),
+    parameter(parameter),
+    surface(NULL)
+  {
+    // no code
+  }
+
+  TilePyramidWorkerCairo::~TilePyramidWorkerCairo()
+  {
+    if (surface!=NULL) {
+      cairo_surface_destroy(surface);
+    }
+  }
+
+  /**
+   * Render the data into the (reused) surface, that gets recreated if the size
+   * of the projection changes
+   */
+  bool TilePyramidWorkerCairo::Render(const TileProjection& projection,
+                                      const MapData& data)
+  {
+    if (surface!=NULL &&
+        ((size_t)cairo_image_surface_get_width(surface)!=projection.GetWidth() ||
+         (size_t)cairo_image_surface_get_height(surface)!=projection.GetHeight())) {
+      cairo_surface_destroy(surface);
+      surface=NULL;
+    }
+
+    if (surface==NULL) {
+      surface=cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+                                         (int)projection.GetWidth(),
+                                         (int)projection.GetHeight());
+
+      if (cairo_surface_status(surface)!=CAIRO_STATUS_SUCCESS) {
+        log.Error() << "Cannot create cairo image surface";
+        cairo_surface_destroy(surface);
+        surface=NULL;
+
+        return false;
+      }
+    }
+
+    cairo_t* draw=cairo_create(surface);
+
+    cairo_set_source_rgb(draw,0.0,0.0,0.0);
+    cairo_paint(draw);
+
+    bool result=painter.DrawMap(projection,
+                                parameter,
+                                data,
+                                draw);
+
+    cairo_destroy(draw);
+    cairo_surface_flush(surface);
+
+    return result;
+  }
+
+  bool TilePyramidWorkerCairo::RenderTile(const TileProjection& projection,
+                                          size_t x,
+                                          size_t y,
+                                          const MapData& data)
+  {
+    if (!Render(projection,
+                data)) {
+      return false;
+    }
+
+    return WriteTile(projection.GetMagnification(),
+                     x,y,
+                     surface);
+  }
+
+  /**
+   * Renders the meta tile in one pass. The tiles passed to WriteTile() are
+   * sub surfaces of the meta tile surface without the margin, so no pixels
+   * are copied.
+   */
+  bool TilePyramidWorkerCairo::RenderMetaTile(const MetaTile& metaTile,
+                                              const MapData& data)
+  {
+    if (!Render(metaTile.projection,
+                data)) {
+      return false;
+    }
+
+    for (size_t y=0; y<metaTile.yCount; y++) {
+      for (size_t x=0; x<metaTile.xCount; x++) {
+        cairo_surface_t* tile=cairo_surface_create_for_rectangle(surface,
+                                                                 (double)(metaTile.margin+x*metaTile.tileWidth),
+                                                                 (double)(metaTile.margin+y*metaTile.tileHeight),
+                                                                 (double)metaTile.tileWidth,
+                                                                 (double)metaTile.tileHeight);
+        bool             result=WriteTile(metaTile.projection.GetMagnification(),
+                                          metaTile.xStart+x,
+                                          metaTile.yStart+y,
+                                          tile);
+
+        cairo_surface_destroy(tile);
+
+        if (!result) {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+}
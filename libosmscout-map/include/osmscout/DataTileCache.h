@@ -20,6 +20,10 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
 */
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <list>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -41,6 +45,44 @@
 
 namespace osmscout {
 
+  /**
+   * \ingroup tiledcache
+   *
+   * Estimated memory usage of a node in the cache
+   */
+  inline size_t GetTileObjectMemory(const NodeRef& /*node*/)
+  {
+    return sizeof(Node);
+  }
+
+  /**
+   * \ingroup tiledcache
+   *
+   * Estimated memory usage of a way in the cache
+   */
+  inline size_t GetTileObjectMemory(const WayRef& way)
+  {
+    return sizeof(Way)+
+           way->nodes.capacity()*sizeof(Point);
+  }
+
+  /**
+   * \ingroup tiledcache
+   *
+   * Estimated memory usage of an area in the cache
+   */
+  inline size_t GetTileObjectMemory(const AreaRef& area)
+  {
+    size_t memory=sizeof(Area);
+
+    for (const auto& ring : area->rings) {
+      memory+=sizeof(Area::Ring)+
+              ring.nodes.capacity()*sizeof(Point);
+    }
+
+    return memory;
+  }
+
   /**
    * \ingroup tiledcache
    *
@@ -54,18 +96,34 @@ namespace osmscout {
 
     TypeInfoSet        prefillTypes;
     std::vector<O>     prefillData;
+    size_t             prefillMemory;
 
     TypeInfoSet        types;
     std::vector<O>     data;
+    size_t             memory;
 
     bool               complete;
 
+  private:
+    static size_t GetMemory(const std::vector<O>& data)
+    {
+      size_t memory=data.capacity()*sizeof(O);
+
+      for (const auto& object : data) {
+        memory+=GetTileObjectMemory(object);
+      }
+
+      return memory;
+    }
+
   public:
     /**
      * Create an empty and unassigned TileData
      */
     TileData()
-    : complete(false)
+    : prefillMemory(0),
+      memory(0),
+      complete(false)
     {
       // no code
     }
@@ -76,10 +134,13 @@ namespace osmscout {
     void SetPrefillData(const TypeInfoSet& types,
                         const std::vector<O>& data)
     {
+      size_t memory=GetMemory(data);
+
       std::lock_guard<std::mutex> guard(mutex);
 
       this->prefillData=data;
       this->prefillTypes=types;
+      this->prefillMemory=memory;
     }
 
     /**
@@ -88,10 +149,13 @@ namespace osmscout {
     void SetData(const TypeInfoSet& types,
                  const std::vector<O>& data)
     {
+      size_t memory=GetMemory(data);
+
       std::lock_guard<std::mutex> guard(mutex);
 
       this->data=data;
       this->types=types;
+      this->memory=memory;
     }
 
     void SetComplete()
@@ -164,6 +228,17 @@ namespace osmscout {
 
       std::for_each(data.begin(),data.end(),function);
     }
+
+    /**
+     * Return the estimated memory usage of the (prefill) data in bytes.
+     * Objects shared with other tiles are counted for each tile.
+     */
+    size_t GetMemory() const
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+
+      return prefillMemory+memory;
+    }
   };
 
   /**
@@ -323,6 +398,19 @@ namespace osmscout {
              optimizedAreaData.IsComplete();
     }
 
+    /**
+     * Return the estimated memory usage of the tile in bytes
+     */
+    inline size_t GetMemory() const
+    {
+      return sizeof(Tile)+
+             nodeData.GetMemory()+
+             wayData.GetMemory()+
+             areaData.GetMemory()+
+             optimizedWayData.GetMemory()+
+             optimizedAreaData.GetMemory();
+    }
+
     /**
      * Return 'true' if no data at all has been assigned
      */
@@ -346,49 +434,65 @@ namespace osmscout {
   /**
    * \ingroup tiledcache
    *
-   * Data cache using tile based cache pages. The cache holds a number of of tiles. The
-   * maximum number of tiles hold can be configured. Tiles however will only be freed
-   * if a cleanup is explicitely triggered. So temporary overbooking can happen. This should
-   * assure that prefilling of tiles is possible even with a very low limit.
+   * Data cache using tile based cache pages. The cache is either limited by the number of
+   * tiles or - if a memory budget is set - by the estimated memory usage of the tiles
+   * (see Tile::GetMemory()). Tiles however will only be freed if a cleanup is explicitely
+   * triggered. So temporary overbooking can happen. This should assure that prefilling of
+   * tiles is possible even with a very low limit. Tiles still referenced outside of the
+   * cache are never freed.
    *
-   * The cache will free least recently used tiles first,
+   * The cache will free least recently used tiles first.
    *
+   * The cache is thread safe. The tiles are distributed over a number of shards, each
+   * protected by its own mutex, so that concurrent lookups of different tiles
+   * do not block each other.
    */
   class OSMSCOUT_MAP_API DataTileCache
   {
   private:
+    //! Number of shards, the tiles are distributed over
+    static const size_t SHARD_COUNT=16;
+
     /**
      * Internally used cache entry
      */
     struct OSMSCOUT_MAP_API CacheEntry
     {
-      TileId  id;
-      //TileWeakRef tile;
       TileRef tile;
+      size_t  lastAccess; //!< Value of the access counter at the last access of the tile
 
-      CacheEntry(const TileId& id,
-                 const TileRef /*TileWeakRef*/& tile)
-              : id(id),
-                tile(tile)
+      CacheEntry(const TileRef& tile,
+                 size_t lastAccess)
+      : tile(tile),
+        lastAccess(lastAccess)
       {
         // no code
       }
     };
 
-    //! A list of cached tiles
-    typedef std::list<CacheEntry>     Cache;
-
-    //! References to a tile in above list
-    typedef Cache::iterator           CacheRef;
-
     //! An index from TileIds to cache entries
-    typedef std::map<TileId,CacheRef> CacheIndex;
+    typedef std::map<TileId,CacheEntry> CacheIndex;
+
+    /**
+     * Part of the cache, protected by its own mutex
+     */
+    struct OSMSCOUT_MAP_API Shard
+    {
+      std::mutex mutex;
+      CacheIndex tileIndex;
+    };
 
   private:
-    size_t             cacheSize;
+    std::atomic<size_t> cacheSize;
+    std::atomic<size_t> memoryBudget;
+
+    mutable std::atomic<size_t> accessCounter;
+    mutable Shard               shards[SHARD_COUNT];
 
-    mutable CacheIndex tileIndex;
-    mutable Cache      tileCache;
+    std::mutex                  cleanupMutex;
+
+  private:
+    Shard& GetShard(const TileId& id) const;
 
     void ResolveNodesFromParent(Tile& tile,
                                 const Tile& parentTile,
@@ -417,6 +521,10 @@ namespace osmscout {
     DataTileCache(size_t cacheSize);
 
     void SetSize(size_t cacheSize);
+    void SetMemoryBudget(size_t memoryBudget);
+
+    size_t GetSize() const;
+    size_t GetMemory() const;
 
     void CleanupCache();
 
@@ -17,8 +17,9 @@
  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
  */
 
+#include <list>
 #include <memory>
-#include <set>
+#include <vector>
 
 #include <osmscout/private/MapImportExport.h>
 
@@ -50,53 +51,47 @@ namespace osmscout {
     
     typedef std::list<LabelData>::iterator LabelDataRef;
     
-    struct OSMSCOUT_MAP_API LabelEvent
-    {
-        double       y;
-        double       x;
-        LabelDataRef label;
-        
-        inline bool operator<(const LabelEvent& other) const
-        {
-            if (y!=other.y) {
-                return y<other.y;
-            }
-            
-            if (x!=other.x) {
-                return x<other.x;
-            }
-            
-            if (label->id!=other.label->id){
-                return label->id<other.label->id;
-            }
-            
-            if (label->y!=other.label->y){
-                return label->y<other.label->y;
-            }
-            
-            return label->x<other.label->x;
-        }
-    };
-    
+    /**
+     * Places labels without overlapping. Already placed labels are stored in a uniform
+     * grid over the visible area, so that the collision check for a new label only
+     * has to look at the labels in the grid cells covered by the new label.
+     *
+     * Labels can either be placed one after the other using Placelabel() (a label with
+     * a higher priority evicts already placed labels with a lower priority) or collected
+     * using AddLabel() and placed all at once in the order of their priority using Layout().
+     */
     class OSMSCOUT_MAP_API LabelLayouter
     {
     private:
-        
+        typedef std::vector<LabelDataRef> Cell;
         
     private:
-        std::list<LabelData> labels;
-        std::set<LabelEvent> events;
-        double               width;
-        double               height;
-        double               labelSpace;
-        double               shieldLabelSpace;
-        double               sameLabelSpace;
-        double               maxSpace;
-        bool                 dropNotVisiblePointLabels;
-        size_t               labelsAdded;
+        std::list<LabelData>      labels;
+        std::vector<LabelData>    candidates;  //!< Labels added by AddLabel(), not yet placed
+        std::vector<Cell>         cells;       //!< Placed labels by grid cell (row by row)
+        std::vector<LabelDataRef> neighbours;  //!< Temporary result of CollectNeighbours()
+        size_t                    xCells;
+        size_t                    yCells;
+        double                    width;
+        double                    height;
+        double                    labelSpace;
+        double                    shieldLabelSpace;
+        double                    sameLabelSpace;
+        double                    maxSpace;
+        bool                      dropNotVisiblePointLabels;
+        size_t                    labelsAdded;
         
     private:
-        void DeleteEventsForLabel(const std::set<LabelEvent>::iterator& eventRef);
+        bool IsVisible(const LabelData& label) const;
+        void GetCellRange(const LabelData& label,
+                          double space,
+                          size_t& x1, size_t& y1,
+                          size_t& x2, size_t& y2) const;
+        void InsertLabel(const LabelData& label,
+                         LabelDataRef& labelRef);
+        void RemoveLabel(const LabelDataRef& labelRef);
+        void CollectNeighbours(const LabelData& label);
+        bool HasIntersection(const LabelData& label) const;
         bool Intersects(const LabelData& first, const LabelData& second) const;
         
     public:
@@ -109,6 +104,9 @@ namespace osmscout {
         bool Placelabel(const LabelData& label,
                         LabelDataRef& labelRef);
         
+        bool AddLabel(const LabelData& label);
+        void Layout();
+        
         inline std::list<LabelData>::const_iterator begin() const
         {
             return labels.begin();
@@ -100,6 +100,69 @@ namespace osmscout {
       }
     };
 
+    /**
+     * Number of objects and coordinates of one type in the rendered data
+     */
+    struct OSMSCOUT_MAP_API TypeStatistic
+    {
+      TypeInfoRef type;       //!< Type
+      size_t      nodeCount;  //!< Number of Node objects
+      size_t      wayCount;   //!< Number of Way objects
+      size_t      areaCount;  //!< Number of Area objects
+      size_t      coordCount; //!< Number of coordinates
+
+      TypeStatistic()
+      : nodeCount(0),
+        wayCount(0),
+        areaCount(0),
+        coordCount(0)
+      {
+        // no code
+      }
+    };
+
+    /**
+     * Statistics of the last call to Draw(). All times are in milliseconds.
+     */
+    struct OSMSCOUT_MAP_API DrawStatistics
+    {
+      double                     prepareAreasTime;       //!< Style resolution and transformation of areas
+      double                     prepareWaysTime;        //!< Style resolution and transformation of ways
+      double                     groundTime;             //!< Drawing of ground tiles and OSM tile borders
+      double                     areasTime;              //!< Drawing of areas
+      double                     pathsTime;              //!< Drawing of ways
+      double                     pathDecorationsTime;    //!< Drawing of way decorations
+      double                     pathShieldLabelsTime;   //!< Registration of way shield labels
+      double                     pathContourLabelsTime;  //!< Drawing of way contour labels
+      double                     nodesTime;              //!< Drawing and label registration of nodes
+      double                     areaLabelsTime;         //!< Label registration of areas
+      double                     poisTime;               //!< Drawing and label registration of POI nodes
+      double                     labelLayoutTime;        //!< Placement of all registered labels
+      double                     labelsTime;             //!< Drawing of the placed labels
+      double                     totalTime;              //!< Overall time of Draw()
+
+      size_t                     nodeCount;              //!< Number of nodes in the data
+      size_t                     wayCount;               //!< Number of ways in the data
+      size_t                     areaCount;              //!< Number of areas in the data
+      size_t                     coordCount;             //!< Number of coordinates of all objects in the data
+
+      size_t                     areasSegments;          //!< Number of prepared area rings
+      size_t                     areasDrawn;             //!< Number of drawn area rings
+      size_t                     waysSegments;           //!< Number of prepared way segments
+      size_t                     waysDrawn;              //!< Number of drawn way segments
+      size_t                     waysLabelDrawn;         //!< Number of drawn way contour labels
+      size_t                     nodesDrawn;             //!< Number of drawn nodes
+      size_t                     labelsAdded;            //!< Number of registered labels
+      size_t                     labelsPlaced;           //!< Number of placed (not overlapping) labels
+      size_t                     labelsDrawn;            //!< Number of drawn labels
+
+      std::vector<TypeStatistic> types;                  //!< Types with objects in the data, by decreasing object count
+
+      DrawStatistics();
+
+      void Reset();
+    };
+
     struct OSMSCOUT_MAP_API WayData
     {
       ObjectFileRef            ref;
@@ -219,6 +282,8 @@ namespace osmscout {
     size_t                       nodesDrawn;
 
     size_t                       labelsDrawn;
+
+    DrawStatistics               statistics;
     //@}
 
     /**
@@ -278,6 +343,7 @@ namespace osmscout {
     //@{
     void DumpDataStatistics(const Projection& projection,
                             const MapData& data);
+    void CollectTypeStatistics(const MapData& data);
     //@}
 
     /**
@@ -613,6 +679,14 @@ namespace osmscout {
     MapPainter(const StyleConfigRef& styleConfig,
                CoordBuffer *buffer);
     virtual ~MapPainter();
+
+    /**
+     * Return the statistics of the last call to Draw()
+     */
+    inline const DrawStatistics& GetStatistics() const
+    {
+      return statistics;
+    }
   };
 
   /**
@@ -20,7 +20,11 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
 */
 
+#include <atomic>
+#include <condition_variable>
+#include <future>
 #include <list>
+#include <map>
 #include <memory>
 #include <thread>
 #include <vector>
@@ -28,6 +32,7 @@
 #include <osmscout/private/MapImportExport.h>
 
 #include <osmscout/Database.h>
+#include <osmscout/Pixel.h>
 #include <osmscout/TypeConfig.h>
 
 #include <osmscout/MapPainter.h>
@@ -36,7 +41,7 @@
 #include <osmscout/util/Breaker.h>
 #include <osmscout/util/GeoBox.h>
 #include <osmscout/util/StopClock.h>
-#include <osmscout/util/WorkQueue.h>
+#include <osmscout/util/WorkerPool.h>
 
 #include <osmscout/DataTileCache.h>
 
@@ -88,6 +93,12 @@ namespace osmscout {
    * - Get objects of a certain type in a given area and impose certain
    * limits on the resulting data (size of area, number of objects,
    * low zoom optimizations,...).
+   * - Prefetch the data of tiles, that will likely be requested next, in the
+   * background.
+   *
+   * Lookup and loading of tiles can be called concurrently from multiple threads.
+   * A tile is only loaded once, even if it is requested by multiple threads
+   * at the same time.
    */
   class OSMSCOUT_MAP_API MapService
   {
@@ -104,36 +115,65 @@ namespace osmscout {
 
     typedef std::shared_ptr<TypeDefinition> TypeDefinitionRef;
 
+    /**
+     * Results of the loading tasks of a tile currently being loaded
+     */
+    typedef std::vector<std::shared_future<bool>> TileLoadingState;
+
   public:
     typedef size_t                              CallbackId;
     typedef std::function<void(const TileRef&)> TileStateCallback;
 
+    /**
+     * Statistics of the tile data cache
+     */
+    struct OSMSCOUT_MAP_API CacheStatistics
+    {
+      size_t tileCount; //!< Number of cached tiles
+      size_t memory;    //!< Estimated memory usage of the cached tiles in bytes
+      size_t hitCount;  //!< Number of requested tiles, that were already completely loaded
+      size_t missCount; //!< Number of requested tiles, that had to be loaded (or were still loading)
+
+      /**
+       * Return the ratio of requested tiles, that were already completely loaded
+       */
+      inline double GetHitRate() const
+      {
+        if (hitCount+missCount==0) {
+          return 0.0;
+        }
+
+        return (double)hitCount/(hitCount+missCount);
+      }
+    };
+
   private:
     mutable std::mutex           stateMutex;           //!< Mutex to protect internal state
 
     DatabaseRef                  database;             //!< The reference to the database
     mutable DataTileCache       cache;                //!< Data cache
     TypeDefinitionRef            typeDefinition;       //<! Last used and cached TypeDefinition
+    mutable std::map<TileId,TileLoadingState> loadingTiles; //<! Tiles currently being loaded
 
-    mutable WorkQueue<bool>      nodeWorkerQueue;
-    std::thread                  nodeWorkerThread;
-
-    mutable WorkQueue<bool>      wayWorkerQueue;
-    std::thread                  wayWorkerThread;
-
-    mutable WorkQueue<bool>      wayLowZoomWorkerQueue;
-    std::thread                  wayLowZoomWorkerThread;
-
-    mutable WorkQueue<bool>      areaWorkerQueue;
-    std::thread                  areaWorkerThread;
-
-    mutable WorkQueue<bool>      areaLowZoomWorkerQueue;
-    std::thread                  areaLowZoomWorkerThread;
+    mutable WorkerPool           workerPool;           //<! Pool of threads loading the tile data
 
     CallbackId                   nextCallbackId;
     std::map<CallbackId,TileStateCallback> tileStateCallbacks;
     mutable std::mutex           callbackMutex;        //<! Mutex to protect callback (de)registering
 
+    mutable std::atomic<size_t>  activeLoads;          //<! Number of running (non prefetch) loads
+    mutable std::atomic<size_t>  cacheHits;            //<! Number of requested tiles already loaded
+    mutable std::atomic<size_t>  cacheMisses;          //<! Number of requested tiles not yet loaded
+
+    std::mutex                   prefetchMutex;        //<! Mutex to protect the prefetch state
+    std::condition_variable      prefetchCondition;
+    bool                         prefetchStop;
+    size_t                       prefetchGeneration;   //<! Incremented for each prefetch request
+    AreaSearchParameter          prefetchParameter;
+    StyleConfigRef               prefetchStyleConfig;
+    std::shared_ptr<ThreadedBreaker> prefetchBreaker;
+    std::list<TileRef>           prefetchTiles;        //<! Tiles still to prefetch
+    std::thread                  prefetchThread;
 
   private:
     TypeDefinitionRef GetTypeDefinition(const AreaSearchParameter& parameter,
@@ -168,55 +208,67 @@ namespace osmscout {
                  const GeoBox& boundingBox,
                  const TileRef& tile) const;
 
-    void NodeWorkerLoop();
-    void WayWorkerLoop();
-    void WayLowZoomWorkerLoop();
-    void AreaWorkerLoop();
-    void AreaLowZoomWorkerLoop();
-
-    std::future<bool> PushNodeTask(const AreaSearchParameter& parameter,
-                                   const TypeInfoSet& nodeTypes,
-                                   const GeoBox& boundingBox,
-                                   const TileRef& tile) const;
-
-    std::future<bool> PushAreaLowZoomTask(const AreaSearchParameter& parameter,
-                                          const TypeInfoSet& areaTypes,
-                                          const Magnification& magnification,
-                                          const GeoBox& boundingBox,
-                                          const TileRef& tile) const;
-
-    std::future<bool> PushAreaTask(const AreaSearchParameter& parameter,
-                                   const TypeInfoSet& areaTypes,
-                                   const Magnification& magnification,
-                                   const GeoBox& boundingBox,
-                                   const TileRef& tile) const;
-
-    std::future<bool> PushWayLowZoomTask(const AreaSearchParameter& parameter,
-                                         const TypeInfoSet& wayTypes,
+    std::future<bool> AddNodeTask(WorkerTaskGroup& group,
+                                  const AreaSearchParameter& parameter,
+                                  const TypeInfoSet& nodeTypes,
+                                  const GeoBox& boundingBox,
+                                  const TileRef& tile) const;
+
+    std::future<bool> AddAreaLowZoomTask(WorkerTaskGroup& group,
+                                         const AreaSearchParameter& parameter,
+                                         const TypeInfoSet& areaTypes,
                                          const Magnification& magnification,
                                          const GeoBox& boundingBox,
                                          const TileRef& tile) const;
 
-    std::future<bool> PushWayTask(const AreaSearchParameter& parameter,
-                                  const TypeInfoSet& wayTypes,
+    std::future<bool> AddAreaTask(WorkerTaskGroup& group,
+                                  const AreaSearchParameter& parameter,
+                                  const TypeInfoSet& areaTypes,
+                                  const Magnification& magnification,
                                   const GeoBox& boundingBox,
                                   const TileRef& tile) const;
 
+    std::future<bool> AddWayLowZoomTask(WorkerTaskGroup& group,
+                                        const AreaSearchParameter& parameter,
+                                        const TypeInfoSet& wayTypes,
+                                        const Magnification& magnification,
+                                        const GeoBox& boundingBox,
+                                        const TileRef& tile) const;
+
+    std::future<bool> AddWayTask(WorkerTaskGroup& group,
+                                 const AreaSearchParameter& parameter,
+                                 const TypeInfoSet& wayTypes,
+                                 const GeoBox& boundingBox,
+                                 const TileRef& tile) const;
+
     void NotifyTileStateCallbacks(const TileRef& tile) const;
 
+    void PruneLoadingTiles() const;
+    bool IsLoading() const;
+
+    void PrefetchLoop();
+
+    void CountCacheHits(const std::list<TileRef>& tiles) const;
+
     bool LoadMissingTileDataInternal(const AreaSearchParameter& parameter,
                                      const StyleConfig& styleConfig,
                                      std::list<TileRef>& tiles,
+                                     WorkerPool::Priority priority,
                                      bool async) const;
 
   public:
-    MapService(const DatabaseRef& database);
+    MapService(const DatabaseRef& database,
+               size_t workerCount=0);
     virtual ~MapService();
 
     void SetCacheSize(size_t cacheSize);
+    void SetCacheMemoryBudget(size_t memoryBudget);
 
     void FlushTileCache();
 
+    CacheStatistics GetCacheStatistics() const;
+    void ResetCacheStatistics();
+
     void LookupTiles(const Magnification& magnification,
                      const GeoBox& boundingBox,
                      std::list<TileRef>& tiles) const;
@@ -234,6 +286,14 @@ namespace osmscout {
                                   const StyleConfig& styleConfig,
                                   std::list<TileRef>& tiles) const;
 
+    void PrefetchTiles(const AreaSearchParameter& parameter,
+                       const StyleConfigRef& styleConfig,
+                       const Magnification& magnification,
+                       const GeoBox& boundingBox,
+                       const Vertex2D& direction);
+
+    void CancelPrefetch();
+
     void ConvertTilesToMapData(std::list<TileRef>& tiles,
                                MapData& data) const;
 
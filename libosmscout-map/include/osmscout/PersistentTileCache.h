@@ -0,0 +1,160 @@
+#ifndef OSMSCOUT_PERSISTENTTILECACHE_H
+#define OSMSCOUT_PERSISTENTTILECACHE_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <osmscout/private/MapImportExport.h>
+
+#include <osmscout/Types.h>
+
+#include <osmscout/TileId.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Renderer
+   *
+   * A persistent cache for rendered tiles, so that tiles survive a restart
+   * of the application. Tiles are stored as opaque data (for example an encoded
+   * image) and are identified by their TileId and a hash of the style (and all
+   * other parameters influencing the result of rendering).
+   *
+   * All tiles are stored in a single pack file. The file is only appended to:
+   * a tile is written as one record including a checksum, replacing a tile
+   * or evicting it appends a new record. On opening, the file is scanned
+   * to build the index. Incomplete or damaged records at the end of the file
+   * (for example, because of a crash while writing) are dropped.
+   *
+   * The cache has a budget for the size of the tile data. If the budget is
+   * exceeded, the least recently used tiles are evicted. If the file holds
+   * more obsolete than live data, it is compacted by writing the live tiles
+   * to a new file, which then atomically replaces the old file. Compacting
+   * also stores the current usage order, else after opening, the tiles are
+   * ordered by the time they were written.
+   *
+   * All methods are thread safe. The file must not be used by multiple
+   * instances (or processes) at the same time.
+   */
+  class OSMSCOUT_MAP_API PersistentTileCache
+  {
+  private:
+    /**
+     * Key of a tile in the cache
+     */
+    struct Key
+    {
+      uint64_t styleHash;
+      uint32_t level;
+      uint32_t x;
+      uint32_t y;
+
+      bool operator<(const Key& other) const;
+    };
+
+    /**
+     * Internally used cache entry
+     */
+    struct CacheEntry
+    {
+      Key        key;
+      FileOffset offset; //!< Offset of the tile data in the file
+      uint32_t   size;   //!< Size of the tile data
+    };
+
+    //! A list of cached tiles, the most recently used tile first
+    typedef std::list<CacheEntry>     Cache;
+
+    //! References to a tile in above list
+    typedef Cache::iterator           CacheRef;
+
+    //! An index from keys to cache entries
+    typedef std::map<Key,CacheRef>    CacheIndex;
+
+  private:
+    mutable std::mutex mutex;
+    std::string        filename;
+    FILE*              file;
+    size_t             byteBudget;  //!< Maximum size of the tile data
+    Cache              cache;
+    CacheIndex         index;
+    size_t             tileBytes;   //!< Size of the tile data of all cached tiles
+    FileOffset         fileSize;
+
+  private:
+    static Key GetKey(const TileId& id,
+                      uint64_t styleHash);
+
+    bool Scan(FileOffset& validSize);
+    bool AppendRecord(uint32_t type,
+                      const Key& key,
+                      const char* data,
+                      uint32_t size);
+    bool ReadData(const CacheEntry& entry,
+                  std::string& data) const;
+    bool Remove(CacheRef entry);
+    bool Evict();
+    bool CompactFile();
+    FileOffset GetGarbageSize() const;
+
+  public:
+    explicit PersistentTileCache(size_t byteBudget);
+    virtual ~PersistentTileCache();
+
+    bool Open(const std::string& filename);
+    bool Close();
+    bool IsOpen() const;
+
+    bool SetByteBudget(size_t byteBudget);
+    size_t GetByteBudget() const;
+
+    bool HasTile(const TileId& id,
+                 uint64_t styleHash) const;
+    bool GetTile(const TileId& id,
+                 uint64_t styleHash,
+                 std::string& data);
+    bool PutTile(const TileId& id,
+                 uint64_t styleHash,
+                 const std::string& data);
+    bool RemoveTile(const TileId& id,
+                    uint64_t styleHash);
+
+    bool Compact();
+
+    size_t GetTileCount() const;
+    size_t GetTileBytes() const;
+    FileOffset GetFileSize() const;
+
+    static uint64_t CalculateHash(const std::string& data);
+  };
+
+  //! \ingroup Renderer
+  //! Reference counted reference to a PersistentTileCache instance
+  typedef std::shared_ptr<PersistentTileCache> PersistentTileCacheRef;
+}
+
+#endif
@@ -166,6 +166,13 @@ namespace osmscout {
    */
   class OSMSCOUT_MAP_API StyleResolveContext
   {
+  public:
+    //! Bit masks of the features checked by style criteria
+    static const uint8_t FEATURE_BRIDGE=1 << 0;
+    static const uint8_t FEATURE_TUNNEL=1 << 1;
+    static const uint8_t FEATURE_ONEWAY=1 << 2;
+    static const uint8_t FEATURE_ALL=FEATURE_BRIDGE | FEATURE_TUNNEL | FEATURE_ONEWAY;
+
   private:
     BridgeFeatureReader      bridgeReader;
     TunnelFeatureReader      tunnelReader;
@@ -185,6 +192,9 @@ namespace osmscout {
     }
 
     bool IsOneway(const FeatureValueBuffer& buffer) const;
+
+    uint8_t GetFeatures(const FeatureValueBuffer& buffer,
+                        uint8_t features) const;
   };
 
   /**
@@ -414,6 +424,13 @@ namespace osmscout {
       return oneway;
     }
 
+    uint8_t GetFeatures() const;
+
+    inline const SizeConditionRef& GetSizeCondition() const
+    {
+      return sizeCondition;
+    }
+
     bool Matches(double meterInPixel,
                  double meterInMM) const;
     bool Matches(const StyleResolveContext& context,
@@ -1455,9 +1472,33 @@ namespace osmscout {
    * * Fastpath: Fastpath means, that we can directly return the style definition from the style sheet. This is normally
    * the case, if there is excactly one match in the style sheet. If there are multiple matches a new style has to be
    * allocated and composed from all matches.
+   * * Selector lists: For each list of selectors (given by type, magnification level and slot), the matching
+   * selectors for each combination of object features (bridge, tunnel, oneway) and the styles for all combinations
+   * of matching selectors are precomputed while postprocessing the style sheet. Resolving a style thus reads the
+   * features of an object once, evaluates only the size conditions (which depend on the projection) of the
+   * selectors matching the features and returns the style without allocation.
    */
   class OSMSCOUT_MAP_API StyleConfig
   {
+  public:
+    //! Maximum number of selectors in a list, for which matches and composed styles are precomputed
+    static const size_t MAX_COMPOSED_SELECTORS=8;
+
+    /**
+     * Precomputed data of a list of selectors
+     */
+    struct SelectorListData
+    {
+      uint8_t                             features;          //!< Features checked by any selector of the list
+      std::vector<size_t>                 featureMatches;    //!< Bit mask of the selectors matching each combination of features
+      size_t                              sizeConditionMask; //!< Bit mask of the selectors with a size condition
+      std::vector<SizeConditionRef>       sizeConditions;    //!< Size condition of each selector, if any
+      std::vector<std::shared_ptr<void> > styles;            //!< Style for each bit mask of matching selectors
+    };
+
+    //! Precomputed data by list of selectors
+    typedef std::unordered_map<const void*,SelectorListData> SelectorListDataMap;
+
   private:
     TypeConfigRef                              typeConfig;             //!< Reference to the type configuration
     StyleResolveContext                        styleResolveContext;    //!< Instance of helper class that can get passed around to templated helper methods
@@ -1521,6 +1562,8 @@ namespace osmscout {
     std::unordered_map<std::string,bool>       flags;
     std::unordered_map<std::string,StyleConstantRef> constants;
     std::list<std::string>                     errors;
+
+    SelectorListDataMap                        selectorListData;       //!< Precomputed data of selector lists with criteria or multiple entries
  
   private:
     void GetAllNodeTypes(std::list<TypeId>& types);
@@ -1532,6 +1575,7 @@ namespace osmscout {
     void PostprocessAreas();
     void PostprocessIconId();
     void PostprocessPatternId();
+    void PostprocessSelectorLists();
 
   public:
     StyleConfig(const TypeConfigRef& typeConfig);
@@ -0,0 +1,245 @@
+#ifndef OSMSCOUT_TILEPYRAMIDRENDERER_H
+#define OSMSCOUT_TILEPYRAMIDRENDERER_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+
+#include <osmscout/private/MapImportExport.h>
+
+#include <osmscout/util/GeoBox.h>
+#include <osmscout/util/Magnification.h>
+#include <osmscout/util/Projection.h>
+#include <osmscout/util/WorkQueue.h>
+
+#include <osmscout/MapPainter.h>
+#include <osmscout/MapService.h>
+#include <osmscout/StyleConfig.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Renderer
+   *
+   * Parameter of the TilePyramidRenderer.
+   *
+   * The following groups attributes are currently available:
+   * - Number of render threads
+   * - Size and resolution of the tiles
+   * - Number of neighbouring tiles, whose data is loaded, too
+   * - Size of the blocks of tiles rendered in sequence
+   * - Number of tiles loaded in advance of rendering
+   * - Size and margin of meta tiles
+   */
+  class OSMSCOUT_MAP_API TilePyramidRendererParameter
+  {
+  private:
+    size_t threadCount;
+    size_t tileWidth;
+    size_t tileHeight;
+    double dpi;
+    size_t dataMargin;
+    size_t blockSize;
+    size_t queueSize;
+    size_t metaTileSize;
+    size_t metaTileMargin;
+
+  public:
+    TilePyramidRendererParameter();
+
+    void SetThreadCount(size_t threadCount);
+    void SetTileWidth(size_t tileWidth);
+    void SetTileHeight(size_t tileHeight);
+    void SetDPI(double dpi);
+    void SetDataMargin(size_t dataMargin);
+    void SetBlockSize(size_t blockSize);
+    void SetQueueSize(size_t queueSize);
+    void SetMetaTileSize(size_t metaTileSize);
+    void SetMetaTileMargin(size_t metaTileMargin);
+
+    size_t GetThreadCount() const;
+    size_t GetTileWidth() const;
+    size_t GetTileHeight() const;
+    double GetDPI() const;
+    size_t GetDataMargin() const;
+    size_t GetBlockSize() const;
+    size_t GetQueueSize() const;
+    size_t GetMetaTileSize() const;
+    size_t GetMetaTileMargin() const;
+  };
+
+  /**
+   * \ingroup Renderer
+   *
+   * A block of neighbouring tiles, that is rendered in one pass and then
+   * sliced into the individual tiles. The projection covers all tiles and
+   * a margin around the tiles, so that labels at the borders of the tiles
+   * are placed consistently.
+   */
+  struct OSMSCOUT_MAP_API MetaTile
+  {
+    TileProjection projection; //!< Projection of the meta tile, including the margin
+    size_t         xStart;     //!< x coordinate of the top left tile
+    size_t         yStart;     //!< y coordinate of the top left tile
+    size_t         xCount;     //!< Number of tiles in horizontal direction
+    size_t         yCount;     //!< Number of tiles in vertical direction
+    size_t         tileWidth;  //!< Width of a tile in pixel
+    size_t         tileHeight; //!< Height of a tile in pixel
+    size_t         margin;     //!< Margin around the tiles in pixel
+  };
+
+  /**
+   * \ingroup Renderer
+   *
+   * Backend specific part of the TilePyramidRenderer. The TilePyramidRenderer
+   * creates one instance for each render thread, so an instance can
+   * hold its own painter and buffer and does not need to be thread safe.
+   */
+  class OSMSCOUT_MAP_API TilePyramidWorker
+  {
+  public:
+    virtual ~TilePyramidWorker();
+
+    /**
+     * Render the given tile.
+     *
+     * @param projection
+     *    Projection of the tile
+     * @param x
+     *    x coordinate of the tile
+     * @param y
+     *    y coordinate of the tile
+     * @param data
+     *    Map data of the tile and its neighbouring tiles
+     * @return
+     *    False, if there was an error, else true.
+     */
+    virtual bool RenderTile(const TileProjection& projection,
+                            size_t x,
+                            size_t y,
+                            const MapData& data) = 0;
+
+    virtual bool RenderMetaTile(const MetaTile& metaTile,
+                                const MapData& data);
+  };
+
+  //! \ingroup Renderer
+  //! Reference counted reference to a TilePyramidWorker instance
+  typedef std::shared_ptr<TilePyramidWorker> TilePyramidWorkerRef;
+
+  //! \ingroup Renderer
+  //! Factory for the TilePyramidWorker instances of the render threads
+  typedef std::function<TilePyramidWorkerRef()> TilePyramidWorkerFactory;
+
+  //! \ingroup Renderer
+  //! Filter for the tiles to render, returns false for tiles, that do not need
+  //! to be rendered (for example, because they are already cached)
+  typedef std::function<bool(const Magnification&,size_t,size_t)> TilePyramidTileFilter;
+
+  /**
+   * \ingroup Renderer
+   *
+   * Renders all (OSM) tiles covering a given area for one or multiple zoom levels.
+   *
+   * The data of the tiles is loaded by the calling thread using the
+   * MapService, while a number of render threads converts the data
+   * and renders the tiles using their own TilePyramidWorker instance. Loading
+   * and rendering thus overlap. Tiles are processed in blocks of neighbouring
+   * tiles, so that the data tiles in the DataTileCache of the MapService
+   * are reused for neighbouring tiles.
+   *
+   * If a meta tile size greater than one or a meta tile margin is given, blocks
+   * of NxN tiles are rendered in one pass (see TilePyramidWorker::RenderMetaTile()).
+   * Meta tiles are aligned to multiples of the meta tile size. This amortizes
+   * the preparation of the data and gives consistent labels across tile borders.
+   *
+   * An optional filter allows to skip tiles, that do not need to be rendered. A
+   * (meta) tile is only loaded and rendered, if the filter returns true for at
+   * least one of its tiles.
+   *
+   * The data of each tile is sorted by file offset before rendering, so
+   * the result for a tile does not depend on the number of threads or the
+   * state of the cache.
+   */
+  class OSMSCOUT_MAP_API TilePyramidRenderer
+  {
+  private:
+    /**
+     * Data of one (meta) tile to render
+     */
+    struct Job
+    {
+      MetaTile metaTile;
+      MapData  data;
+    };
+
+    typedef std::shared_ptr<Job> JobRef;
+
+  private:
+    MapServiceRef  mapService;
+    StyleConfigRef styleConfig;
+    size_t         threadCount;
+    size_t         tileWidth;
+    size_t         tileHeight;
+    double         dpi;
+    size_t         dataMargin;
+    size_t         blockSize;
+    size_t         queueSize;
+    size_t         metaTileSize;
+    size_t         metaTileMargin;
+
+  private:
+    static bool IsRenderRequired(const MetaTile& metaTile,
+                                 const Magnification& magnification,
+                                 const TilePyramidTileFilter& tileFilter);
+
+    void WorkerLoop(WorkQueue<JobRef>& queue,
+                    TilePyramidWorker& worker,
+                    std::atomic<bool>& success) const;
+
+  public:
+    TilePyramidRenderer(const MapServiceRef& mapService,
+                        const StyleConfigRef& styleConfig,
+                        const TilePyramidRendererParameter& parameter);
+    virtual ~TilePyramidRenderer();
+
+    bool RenderTiles(const GeoBox& boundingBox,
+                     const Magnification& magnification,
+                     const AreaSearchParameter& searchParameter,
+                     const TilePyramidWorkerFactory& workerFactory,
+                     const TilePyramidTileFilter& tileFilter=TilePyramidTileFilter()) const;
+
+    bool RenderPyramid(const GeoBox& boundingBox,
+                       size_t startLevel,
+                       size_t endLevel,
+                       const AreaSearchParameter& searchParameter,
+                       const TilePyramidWorkerFactory& workerFactory,
+                       const TilePyramidTileFilter& tileFilter=TilePyramidTileFilter()) const;
+  };
+
+  //! \ingroup Renderer
+  //! Reference counted reference to a TilePyramidRenderer instance
+  typedef std::shared_ptr<TilePyramidRenderer> TilePyramidRendererRef;
+}
+
+#endif
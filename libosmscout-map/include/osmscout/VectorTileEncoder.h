@@ -0,0 +1,160 @@
+#ifndef OSMSCOUT_VECTORTILEENCODER_H
+#define OSMSCOUT_VECTORTILEENCODER_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <osmscout/private/MapImportExport.h>
+
+#include <osmscout/TypeConfig.h>
+#include <osmscout/TypeFeatures.h>
+
+#include <osmscout/util/Magnification.h>
+#include <osmscout/util/Projection.h>
+#include <osmscout/util/Transformation.h>
+
+#include <osmscout/MapPainter.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Renderer
+   *
+   * Encodes the MapData of an (OSM) tile as a vector tile following the
+   * Mapbox vector tile specification (version 2), so that the tile can be
+   * rendered by the client.
+   *
+   * Geometries are transformed to tile coordinates in the range [0..extent],
+   * simplified using TransPolygon, clipped to the tile plus a buffer around it
+   * and quantized to integer coordinates. Each object type results in a layer
+   * of the same name. The features have the attributes "name", "ref" and
+   * "layer", if the object has the corresponding feature.
+   *
+   * The protobuf messages are written directly, so there is no dependency
+   * to a protobuf library.
+   *
+   * Encode() does not modify the encoder, so one instance can be used by
+   * multiple threads in parallel.
+   */
+  class OSMSCOUT_MAP_API VectorTileEncoder
+  {
+  public:
+    struct Layer; //!< Features and attributes of one layer, while encoding a tile
+
+    /**
+     * A quantized point in tile coordinates
+     */
+    struct TilePoint
+    {
+      int32_t x;
+      int32_t y;
+
+      inline bool operator==(const TilePoint& other) const
+      {
+        return x==other.x && y==other.y;
+      }
+
+      inline bool operator!=(const TilePoint& other) const
+      {
+        return x!=other.x || y!=other.y;
+      }
+    };
+
+    typedef std::vector<TilePoint> TileLine;
+
+  private:
+    TypeConfigRef                typeConfig;
+    uint32_t                     extent;
+    uint32_t                     buffer;
+    TransPolygon::OptimizeMethod optimizeMethod;
+    double                       optimizeErrorTolerance;
+    NameFeatureValueReader       nameReader;
+    RefFeatureValueReader        refReader;
+    LayerFeatureValueReader      layerReader;
+
+  private:
+    void ClipLine(const TransPolygon& polygon,
+                  std::vector<TileLine>& lines) const;
+    bool ClipRing(const TransPolygon& polygon,
+                  bool outer,
+                  TileLine& ring) const;
+
+    void AddAttributes(Layer& layer,
+                       const FeatureValueBuffer& buffer,
+                       std::vector<uint32_t>& tags) const;
+
+    void EncodeNodes(const TileProjection& projection,
+                     const MapData& data,
+                     std::vector<Layer>& layers) const;
+    void EncodeWays(const TileProjection& projection,
+                    const MapData& data,
+                    TransPolygon& polygon,
+                    std::vector<Layer>& layers) const;
+    void EncodeAreas(const TileProjection& projection,
+                     const MapData& data,
+                     TransPolygon& polygon,
+                     std::vector<Layer>& layers) const;
+
+  public:
+    explicit VectorTileEncoder(const TypeConfigRef& typeConfig);
+    virtual ~VectorTileEncoder();
+
+    void SetExtent(uint32_t extent);
+    void SetBuffer(uint32_t buffer);
+    void SetOptimizeMethod(TransPolygon::OptimizeMethod optimizeMethod);
+    void SetOptimizeErrorTolerance(double optimizeErrorTolerance);
+
+    inline uint32_t GetExtent() const
+    {
+      return extent;
+    }
+
+    inline uint32_t GetBuffer() const
+    {
+      return buffer;
+    }
+
+    inline TransPolygon::OptimizeMethod GetOptimizeMethod() const
+    {
+      return optimizeMethod;
+    }
+
+    inline double GetOptimizeErrorTolerance() const
+    {
+      return optimizeErrorTolerance;
+    }
+
+    bool Encode(const Magnification& magnification,
+                size_t x,
+                size_t y,
+                const MapData& data,
+                std::string& tile) const;
+  };
+
+  //! \ingroup Renderer
+  //! Reference counted reference to a VectorTileEncoder instance
+  typedef std::shared_ptr<VectorTileEncoder> VectorTileEncoderRef;
+}
+
+#endif
@@ -23,7 +23,9 @@
 #include <osmscout/util/String.h>
 #include <osmscout/util/Tiling.h>
 
+#include <algorithm>
 #include <iostream>
+
 namespace osmscout {
 
   /**
@@ -44,11 +46,18 @@ namespace osmscout {
    * Create a new tile cache with the given cache size
    */
   DataTileCache::DataTileCache(size_t cacheSize)
-  : cacheSize(cacheSize)
+  : cacheSize(cacheSize),
+    memoryBudget(0),
+    accessCounter(0)
   {
     // no code
   }
 
+  DataTileCache::Shard& DataTileCache::GetShard(const TileId& id) const
+  {
+    return shards[(id.GetX()+id.GetY()*7+id.GetLevel()*13)%SHARD_COUNT];
+  }
+
   /**
    * Change the size of the cache. Cache will be cleaned immediately.
    */
@@ -63,28 +72,121 @@ namespace osmscout {
     }
   }
 
+  /**
+   * Set the memory budget of the cache in bytes. If a memory budget is set,
+   * the cache is limited by the estimated memory usage of the tiles
+   * instead of the number of tiles. Passing 0 switches back to the
+   * number of tiles. Cache will be cleaned immediately.
+   */
+  void DataTileCache::SetMemoryBudget(size_t memoryBudget)
+  {
+    this->memoryBudget=memoryBudget;
+
+    CleanupCache();
+  }
+
+  /**
+   * Return the number of cached tiles
+   */
+  size_t DataTileCache::GetSize() const
+  {
+    size_t size=0;
+
+    for (auto& shard : shards) {
+      std::lock_guard<std::mutex> guard(shard.mutex);
+
+      size+=shard.tileIndex.size();
+    }
+
+    return size;
+  }
+
+  /**
+   * Return the estimated memory usage of all cached tiles in bytes
+   */
+  size_t DataTileCache::GetMemory() const
+  {
+    size_t memory=0;
+
+    for (auto& shard : shards) {
+      std::lock_guard<std::mutex> guard(shard.mutex);
+
+      for (const auto& entry : shard.tileIndex) {
+        memory+=entry.second.tile->GetMemory();
+      }
+    }
+
+    return memory;
+  }
+
   /**
    * Cleanup the cache. Free least recently used tiles until the given maximum cache
-   * size is reached again.
+   * size (or memory budget) is reached again. Tiles that are still referenced
+   * or have been accessed since the cleanup started are not freed.
    */
   void DataTileCache::CleanupCache()
   {
-    if (tileCache.size()>cacheSize) {
-      auto currentEntry=tileCache.rbegin();
-
-      while (currentEntry!=tileCache.rend() &&
-              tileCache.size()>cacheSize) {
-        //if (currentEntry->tile.expired()) {
-        if (currentEntry->tile.use_count()==1) {
-          //std::cout << "Dropping tile " << (std::string)currentEntry->id << " from cache " << cache.size() << "/" << cacheSize << std::endl;
-          tileIndex.erase(currentEntry->id);
-
-          ++currentEntry;
-          currentEntry=std::reverse_iterator<Cache::iterator>(tileCache.erase(currentEntry.base()));
-        }
-        else {
-          ++currentEntry;
-        }
+    struct Candidate
+    {
+      size_t lastAccess;
+      TileId id;
+      size_t memory;
+
+      Candidate(size_t lastAccess,
+                const TileId& id,
+                size_t memory)
+      : lastAccess(lastAccess),
+        id(id),
+        memory(memory)
+      {
+        // no code
+      }
+    };
+
+    std::lock_guard<std::mutex> cleanupGuard(cleanupMutex);
+    size_t                      budget=memoryBudget;
+    size_t                      limit=budget>0 ? budget : cacheSize.load();
+    size_t                      current=0;
+    std::vector<Candidate>      candidates;
+
+    for (auto& shard : shards) {
+      std::lock_guard<std::mutex> guard(shard.mutex);
+
+      for (const auto& entry : shard.tileIndex) {
+        size_t memory=budget>0 ? entry.second.tile->GetMemory() : 1;
+
+        candidates.push_back(Candidate(entry.second.lastAccess,
+                                       entry.first,
+                                       memory));
+        current+=memory;
+      }
+    }
+
+    if (current<=limit) {
+      return;
+    }
+
+    std::sort(candidates.begin(),
+              candidates.end(),
+              [](const Candidate& a,
+                 const Candidate& b) {
+      return a.lastAccess<b.lastAccess;
+    });
+
+    for (const auto& candidate : candidates) {
+      if (current<=limit) {
+        break;
+      }
+
+      Shard&                      shard=GetShard(candidate.id);
+      std::lock_guard<std::mutex> guard(shard.mutex);
+      auto                        entry=shard.tileIndex.find(candidate.id);
+
+      if (entry!=shard.tileIndex.end() &&
+          entry->second.lastAccess==candidate.lastAccess &&
+          entry->second.tile.use_count()==1) {
+        shard.tileIndex.erase(entry);
+        current-=candidate.memory;
       }
     }
   }
@@ -95,13 +197,14 @@ namespace osmscout {
    */
   TileRef DataTileCache::GetCachedTile(const TileId& id) const
   {
-    std::map<TileId,CacheRef>::iterator existingEntry=tileIndex.find(id);
+    Shard&                      shard=GetShard(id);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    auto                        existingEntry=shard.tileIndex.find(id);
 
-    if (existingEntry!=tileIndex.end()) {
-      tileCache.splice(tileCache.begin(),tileCache,existingEntry->second);
-      existingEntry->second=tileCache.begin();
+    if (existingEntry!=shard.tileIndex.end()) {
+      existingEntry->second.lastAccess=++accessCounter;
 
-      return existingEntry->second->tile;//.lock();
+      return existingEntry->second.tile;
     }
 
     return NULL;
@@ -109,28 +212,25 @@ namespace osmscout {
 
   /**
    * Return the tile with the given id. If the tile is not currently cached
-   * return an empty and unassigned tile and move it to the front of the cache.
+   * return an empty and unassigned tile and add it to the cache.
    */
   TileRef DataTileCache::GetTile(const TileId& id) const
   {
-    std::map<TileId,CacheRef>::iterator existingEntry=tileIndex.find(id);
+    Shard&                      shard=GetShard(id);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    auto                        existingEntry=shard.tileIndex.find(id);
 
-    if (existingEntry==tileIndex.end()) {
+    if (existingEntry==shard.tileIndex.end()) {
       TileRef tile(new Tile(id));
 
-      // Updating cache
-      CacheEntry cacheEntry(id,tile);
-
-      tileCache.push_front(cacheEntry);
-      tileIndex[id]=tileCache.begin();
+      shard.tileIndex.insert(std::make_pair(id,CacheEntry(tile,++accessCounter)));
 
       return tile;
     }
     else {
-      tileCache.splice(tileCache.begin(),tileCache,existingEntry->second);
-      existingEntry->second=tileCache.begin();
+      existingEntry->second.lastAccess=++accessCounter;
 
-      return existingEntry->second->tile;
+      return existingEntry->second.tile;
     }
   }
 
@@ -19,8 +19,14 @@
 
 #include <osmscout/LabelLayouter.h>
 
+#include <algorithm>
+#include <cmath>
+
 namespace osmscout {
 
+  //< Width and height of a grid cell in pixel
+  static const double cellSize=64.0;
+
   LabelData::LabelData()
   {
     // no code
@@ -32,6 +38,9 @@ namespace osmscout {
   }
 
   LabelLayouter::LabelLayouter()
+  : xCells(0),
+    yCells(0),
+    labelsAdded(0)
   {
     // no code
   }
@@ -41,42 +50,133 @@ namespace osmscout {
     // no code
   }
 
-  void LabelLayouter::DeleteEventsForLabel(const std::set<LabelEvent>::iterator& eventRef)
+  bool LabelLayouter::IsVisible(const LabelData& label) const
+  {
+    if (label.bx2<0 || label.bx1>=width) {
+      return false;
+    }
+
+    if (label.by2<0 || label.by1>=height) {
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Return the range of grid cells covered by the bounding box of the label,
+   * enlarged by the given space. Parts outside of the grid are mapped to the border cells.
+   */
+  void LabelLayouter::GetCellRange(const LabelData& label,
+                                   double space,
+                                   size_t& x1, size_t& y1,
+                                   size_t& x2, size_t& y2) const
+  {
+    double maxX=(double)(xCells-1);
+    double maxY=(double)(yCells-1);
+
+    x1=(size_t)std::min(std::max(std::floor((label.bx1-space)/cellSize),0.0),maxX);
+    x2=(size_t)std::min(std::max(std::floor((label.bx2+space)/cellSize),0.0),maxX);
+    y1=(size_t)std::min(std::max(std::floor((label.by1-space)/cellSize),0.0),maxY);
+    y2=(size_t)std::min(std::max(std::floor((label.by2+space)/cellSize),0.0),maxY);
+  }
+
+  void LabelLayouter::InsertLabel(const LabelData& label,
+                                  LabelDataRef& labelRef)
+  {
+    size_t x1,y1,x2,y2;
+
+    labels.push_front(label);
+    labelRef=labels.begin();
+
+    GetCellRange(label,0.0,x1,y1,x2,y2);
+
+    for (size_t y=y1; y<=y2; y++) {
+      for (size_t x=x1; x<=x2; x++) {
+        cells[y*xCells+x].push_back(labelRef);
+      }
+    }
+  }
+
+  void LabelLayouter::RemoveLabel(const LabelDataRef& labelRef)
   {
-    LabelEvent searchEventTop;
-    LabelEvent searchEventBottom;
+    size_t x1,y1,x2,y2;
 
-    searchEventTop.y=eventRef->label->by1;
-    searchEventTop.x=eventRef->label->bx1;
+    GetCellRange(*labelRef,0.0,x1,y1,x2,y2);
 
-    searchEventBottom.y=eventRef->label->by2;
-    searchEventBottom.x=eventRef->label->bx1;
+    for (size_t y=y1; y<=y2; y++) {
+      for (size_t x=x1; x<=x2; x++) {
+        Cell& cell=cells[y*xCells+x];
 
-    std::set<LabelEvent>::iterator event;
+        cell.erase(std::find(cell.begin(),cell.end(),labelRef));
+      }
+    }
 
-    event=events.find(searchEventTop);
+    labels.erase(labelRef);
+  }
 
-    assert(event!=events.end());
+  /**
+   * Collect all placed labels, that are near enough to the given label to possibly
+   * intersect with it. The labels are ordered from top to bottom and from left to right.
+   */
+  void LabelLayouter::CollectNeighbours(const LabelData& label)
+  {
+    size_t x1,y1,x2,y2;
 
-    /*
-    std::cout << "Removing event: ";
-    std::cout << event->label->text << " ";
-    std::cout << event->x << "," << event->y << " | ";
-    std::cout << event->label->bx1 << " - " << event->label->bx2 << ", "  << event->label->by1 << " - " << event->label->by2 << std::endl;*/
+    neighbours.clear();
 
-    events.erase(event);
+    GetCellRange(label,maxSpace,x1,y1,x2,y2);
 
-    event=events.find(searchEventBottom);
+    for (size_t y=y1; y<=y2; y++) {
+      for (size_t x=x1; x<=x2; x++) {
+        const Cell& cell=cells[y*xCells+x];
 
-    assert(event!=events.end());
+        neighbours.insert(neighbours.end(),
+                          cell.begin(),
+                          cell.end());
+      }
+    }
 
-    /*
-    std::cout << "Removing event: ";
-    std::cout << event->label->text << " ";
-    std::cout << event->x << "," << event->y << " | ";
-    std::cout << event->label->bx1 << " - " << event->label->bx2 << ", "  << event->label->by1 << " - " << event->label->by2 << std::endl;*/
+    // Labels covering multiple cells are found multiple times
+    std::sort(neighbours.begin(),
+              neighbours.end(),
+              [](const LabelDataRef& a, const LabelDataRef& b) {
+      if (a->by1!=b->by1) {
+        return a->by1<b->by1;
+      }
 
-    events.erase(event);
+      if (a->bx1!=b->bx1) {
+        return a->bx1<b->bx1;
+      }
+
+      return &*a<&*b;
+    });
+
+    neighbours.erase(std::unique(neighbours.begin(),
+                                 neighbours.end()),
+                     neighbours.end());
+  }
+
+  /**
+   * Return true, if the label intersects with any of the placed labels.
+   */
+  bool LabelLayouter::HasIntersection(const LabelData& label) const
+  {
+    size_t x1,y1,x2,y2;
+
+    GetCellRange(label,maxSpace,x1,y1,x2,y2);
+
+    for (size_t y=y1; y<=y2; y++) {
+      for (size_t x=x1; x<=x2; x++) {
+        for (const auto& placedLabel : cells[y*xCells+x]) {
+          if (Intersects(*placedLabel,label)) {
+            return true;
+          }
+        }
+      }
+    }
+
+    return false;
   }
 
   bool LabelLayouter::Intersects(const LabelData& first, const LabelData& second) const
@@ -154,7 +254,8 @@ namespace osmscout {
                                  const MapParameter& parameter)
   {
     labels.clear();
-    events.clear();
+    candidates.clear();
+    labelsAdded=0;
 
     width=projection.GetWidth();
     height=projection.GetHeight();
@@ -167,94 +268,93 @@ namespace osmscout {
     maxSpace=std::max(maxSpace,labelSpace);
     maxSpace=std::max(maxSpace,shieldLabelSpace);
     maxSpace=std::max(maxSpace,sameLabelSpace);
+
+    xCells=std::max((size_t)std::ceil(width/cellSize),(size_t)1);
+    yCells=std::max((size_t)std::ceil(height/cellSize),(size_t)1);
+
+    // Keep the allocated memory of the cells for the next run
+    for (auto& cell : cells) {
+      cell.clear();
+    }
+
+    cells.resize(xCells*yCells);
   }
 
+  /**
+   * Place the label, if it does not intersect with already placed labels with
+   * the same or a higher priority (a lower priority value). Intersecting labels
+   * with a lower priority are removed.
+   */
   bool LabelLayouter::Placelabel(const LabelData& label,
                                  LabelDataRef& labelRef)
   {
-    LabelEvent searchEvent;
+    labelsAdded++;
 
-      if (label.bx2<0 || label.bx1>=width) {
+    if (!IsVisible(label)) {
       return false;
     }
 
-    if (label.by2<0 || label.by1>=height) {
-      return false;
-    }
+    CollectNeighbours(label);
 
-    searchEvent.y=label.by1-maxSpace;
-    searchEvent.x=label.bx1;
-
-    std::set<LabelEvent>::iterator event=events.lower_bound(searchEvent);
-
-    /*
-    std::cout << "--- Placing: ";
-    std::cout << label.text << " ";
-    std::cout << label.bx1 << " - " << label.bx2 << ", "  << label.by1 << " - " << label.by2;
-    std::cout << std::endl;
-
-    for (const auto& ev ent : events) {
-      std::cout << "Event: ";
-      std::cout << event.label->text << " ";
-      std::cout << event.x << "," << event.y << " | ";
-      std::cout << event.label->bx1 << " - " << event.label->bx2 << ", "  << event.label->by1 << " - " << event.label->by2 << std::endl;
-    }*/
-
-    while (event!=events.end() &&
-           label.by2+maxSpace>=event->y) {
-      /*
-      std::cout << event->label->text << " ";
-      std::cout << event->x << "," << event->y << " | ";
-      std::cout << event->label->bx1 << " - " << event->label->bx2 << ", "  << event->label->by1 << " - " << event->label->by2 << std::endl;*/
-      if (Intersects(*event->label,label)) {
-        if (label.priority<event->label->priority) {
-          LabelDataRef oldLabel=event->label;
-
-          //std::cout << "DROPPING lower prio " << event->label->text << " " << label.priority << " vs. " << event->label->priority << std::endl;
-          DeleteEventsForLabel(event);
-          labels.erase(oldLabel);
-
-          // Restart the search :-/
-          event=events.lower_bound(searchEvent);
-        }
-        else if (label.priority>event->label->priority) {
-          LabelDataRef oldLabel=event->label;
-
-          //std::cout << "DROPPING same prio and exit " << event->label->text << " " << label.priority << " vs. " << event->label->priority << std::endl;
-          DeleteEventsForLabel(event);
-          labels.erase(oldLabel);
+    for (const auto& neighbour : neighbours) {
+      if (!Intersects(*neighbour,label)) {
+        continue;
+      }
 
-          return false;
-        }
-        else {
-          //std::cout << "CANCEL since higher prio " << event->label->text << " " << label.priority << " vs. " << event->label->priority << std::endl;
-          return false;
-        }
+      if (label.priority<neighbour->priority) {
+        RemoveLabel(neighbour);
       }
       else {
-        //std::cout << "IGNORING " << event->label->text << std::endl;
-        event++;
+        return false;
       }
     }
 
-    //std::cout << "INSERT" << std::endl;
+    InsertLabel(label,
+                labelRef);
 
-    labels.push_front(label);
-    labelRef=labels.begin();
-
-    LabelEvent insertEvent;
+    return true;
+  }
 
-    insertEvent.x=label.bx1;
-    insertEvent.label=labelRef;
+  /**
+   * Add a label candidate, that gets placed by the next call to Layout().
+   * Returns false, if the label is not visible at all.
+   */
+  bool LabelLayouter::AddLabel(const LabelData& label)
+  {
+    labelsAdded++;
 
-    insertEvent.y=label.by1;
+    if (!IsVisible(label)) {
+      return false;
+    }
 
-    events.insert(insertEvent);
+    candidates.push_back(label);
 
-    insertEvent.y=label.by2;
+    return true;
+  }
 
-    events.insert(insertEvent);
+  /**
+   * Place all labels added by AddLabel() ordered by their priority. Since all
+   * already placed labels have the same or a higher priority, a label is
+   * simply dropped, if it intersects with any of them. Labels with the same
+   * priority are placed in the order they were added.
+   */
+  void LabelLayouter::Layout()
+  {
+    std::stable_sort(candidates.begin(),
+                     candidates.end(),
+                     [](const LabelData& a, const LabelData& b) {
+      return a.priority<b.priority;
+    });
+
+    for (const auto& candidate : candidates) {
+      if (!HasIntersection(candidate)) {
+        LabelDataRef labelRef;
+
+        InsertLabel(candidate,
+                    labelRef);
+      }
+    }
 
-    return true;
+    candidates.clear();
   }
 }
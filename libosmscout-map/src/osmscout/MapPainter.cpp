@@ -71,6 +71,46 @@ namespace osmscout {
     return a.position<b.position;
   }
 
+  MapPainter::DrawStatistics::DrawStatistics()
+  {
+    Reset();
+  }
+
+  void MapPainter::DrawStatistics::Reset()
+  {
+    prepareAreasTime=0.0;
+    prepareWaysTime=0.0;
+    groundTime=0.0;
+    areasTime=0.0;
+    pathsTime=0.0;
+    pathDecorationsTime=0.0;
+    pathShieldLabelsTime=0.0;
+    pathContourLabelsTime=0.0;
+    nodesTime=0.0;
+    areaLabelsTime=0.0;
+    poisTime=0.0;
+    labelLayoutTime=0.0;
+    labelsTime=0.0;
+    totalTime=0.0;
+
+    nodeCount=0;
+    wayCount=0;
+    areaCount=0;
+    coordCount=0;
+
+    areasSegments=0;
+    areasDrawn=0;
+    waysSegments=0;
+    waysDrawn=0;
+    waysLabelDrawn=0;
+    nodesDrawn=0;
+    labelsAdded=0;
+    labelsPlaced=0;
+    labelsDrawn=0;
+
+    types.clear();
+  }
+
   MapPainter::MapPainter(const StyleConfigRef& styleConfig,
                          CoordBuffer *buffer)
   : coordBuffer(buffer),
@@ -319,6 +359,87 @@ namespace osmscout {
     }
   }
 
+  /**
+   * Collect the number of objects and coordinates per type of the data
+   */
+  void MapPainter::CollectTypeStatistics(const MapData& data)
+  {
+    std::vector<TypeStatistic> types(styleConfig->GetTypeConfig()->GetTypeCount());
+
+    for (const auto& node : data.nodes) {
+      TypeStatistic& entry=types[node->GetType()->GetIndex()];
+
+      entry.type=node->GetType();
+      entry.nodeCount++;
+      entry.coordCount++;
+    }
+
+    for (const auto& node : data.poiNodes) {
+      TypeStatistic& entry=types[node->GetType()->GetIndex()];
+
+      entry.type=node->GetType();
+      entry.nodeCount++;
+      entry.coordCount++;
+    }
+
+    for (const auto& way : data.ways) {
+      TypeStatistic& entry=types[way->GetType()->GetIndex()];
+
+      entry.type=way->GetType();
+      entry.wayCount++;
+      entry.coordCount+=way->nodes.size();
+    }
+
+    for (const auto& way : data.poiWays) {
+      TypeStatistic& entry=types[way->GetType()->GetIndex()];
+
+      entry.type=way->GetType();
+      entry.wayCount++;
+      entry.coordCount+=way->nodes.size();
+    }
+
+    for (const auto& area : data.areas) {
+      TypeStatistic& entry=types[area->GetType()->GetIndex()];
+
+      entry.type=area->GetType();
+      entry.areaCount++;
+
+      for (const auto& ring : area->rings) {
+        entry.coordCount+=ring.nodes.size();
+      }
+    }
+
+    for (const auto& area : data.poiAreas) {
+      TypeStatistic& entry=types[area->GetType()->GetIndex()];
+
+      entry.type=area->GetType();
+      entry.areaCount++;
+
+      for (const auto& ring : area->rings) {
+        entry.coordCount+=ring.nodes.size();
+      }
+    }
+
+    for (const auto& entry : types) {
+      if (!entry.type) {
+        continue;
+      }
+
+      statistics.nodeCount+=entry.nodeCount;
+      statistics.wayCount+=entry.wayCount;
+      statistics.areaCount+=entry.areaCount;
+      statistics.coordCount+=entry.coordCount;
+
+      statistics.types.push_back(entry);
+    }
+
+    std::stable_sort(statistics.types.begin(),
+                     statistics.types.end(),
+                     [](const TypeStatistic& a, const TypeStatistic& b)->bool {
+      return a.nodeCount+a.wayCount+a.areaCount>b.nodeCount+b.wayCount+b.areaCount;
+    });
+  }
+
   bool MapPainter::IsVisibleArea(const Projection& projection,
                                  const std::vector<Point>& nodes,
                                  double pixelOffset) const
@@ -778,10 +899,7 @@ namespace osmscout {
       labelBox.style=style;
       labelBox.text=text;
 
-      LabelDataRef label;
-
-      labels.Placelabel(labelBox,
-                        label);
+      labels.AddLabel(labelBox);
 
       i+=stepSizeInPixel;
     }
@@ -791,6 +909,7 @@ namespace osmscout {
    * Register a label with the given parameter.The given coordinates
    * define the center of the label. The resulting label will be
    * vertically and horizontally alligned to the given coordinate.
+   * Labels are only collected here, they are placed by priority before DrawLabels() is called.
    */
   bool MapPainter::RegisterPointLabel(const Projection& projection,
                                       const MapParameter& parameter,
@@ -835,22 +954,11 @@ namespace osmscout {
     labelBox.style=style;
     labelBox.text=text;
 
-    LabelDataRef label;
-
     if (overlay) {
-      if (!overlayLabels.Placelabel(labelBox,
-                                    label)) {
-        return false;
-      }
-    }
-    else {
-      if (!labels.Placelabel(labelBox,
-                             label)) {
-        return false;
-      }
+      return overlayLabels.AddLabel(labelBox);
     }
 
-    return true;
+    return labels.AddLabel(labelBox);
   }
 
   void MapPainter::LayoutPointLabels(const Projection& projection,
@@ -1875,6 +1983,10 @@ namespace osmscout {
                         const MapParameter& parameter,
                         const MapData& data)
   {
+    StopClock totalTimer;
+
+    statistics.Reset();
+
     errorTolerancePixel=projection.ConvertWidthToPixel(parameter.GetOptimizeErrorToleranceMm());
     areaMinDimension=projection.ConvertWidthToPixel(parameter.GetAreaMinDimensionMM());
     contourLabelOffset=projection.ConvertWidthToPixel(parameter.GetContourLabelOffset());
@@ -1923,6 +2035,8 @@ namespace osmscout {
                          data);
     }
 
+    CollectTypeStatistics(data);
+
     //
     // Setup and Precalculation
     //
@@ -1936,6 +2050,8 @@ namespace osmscout {
 
     prepareAreasTimer.Stop();
 
+    statistics.prepareAreasTime=prepareAreasTimer.GetMilliseconds();
+
     if (parameter.IsAborted()) {
       return false;
     }
@@ -1949,6 +2065,8 @@ namespace osmscout {
 
     prepareWaysTimer.Stop();
 
+    statistics.prepareWaysTime=prepareWaysTimer.GetMilliseconds();
+
     if (parameter.IsAborted()) {
       return false;
     }
@@ -1969,6 +2087,8 @@ namespace osmscout {
     // Clear area with background color
     //
 
+    StopClock groundTimer;
+
     DrawGroundTiles(*styleConfig,
                     projection,
                     parameter,
@@ -1982,6 +2102,10 @@ namespace osmscout {
                  projection,
                  parameter);
 
+    groundTimer.Stop();
+
+    statistics.groundTime=groundTimer.GetMilliseconds();
+
     if (parameter.IsAborted()) {
       return false;
     }
@@ -1998,6 +2122,8 @@ namespace osmscout {
 
     areasTimer.Stop();
 
+    statistics.areasTime=areasTimer.GetMilliseconds();
+
     if (parameter.IsAborted()) {
       return false;
     }
@@ -2014,6 +2140,8 @@ namespace osmscout {
 
     pathsTimer.Stop();
 
+    statistics.pathsTime=pathsTimer.GetMilliseconds();
+
     if (parameter.IsAborted()) {
       return false;
     }
@@ -2031,6 +2159,8 @@ namespace osmscout {
 
     pathDecorationsTimer.Stop();
 
+    statistics.pathDecorationsTime=pathDecorationsTimer.GetMilliseconds();
+
     if (parameter.IsAborted()) {
       return false;
     }
@@ -2050,6 +2180,8 @@ namespace osmscout {
 
     pathShieldLabelsTimer.Stop();
 
+    statistics.pathShieldLabelsTime=pathShieldLabelsTimer.GetMilliseconds();
+
     if (parameter.IsAborted()) {
       return false;
     }
@@ -2062,6 +2194,8 @@ namespace osmscout {
 
     pathContourLabelsTimer.Stop();
 
+    statistics.pathContourLabelsTime=pathContourLabelsTimer.GetMilliseconds();
+
     if (parameter.IsAborted()) {
       return false;
     }
@@ -2079,6 +2213,8 @@ namespace osmscout {
 
     nodesTimer.Stop();
 
+    statistics.nodesTime=nodesTimer.GetMilliseconds();
+
     if (parameter.IsAborted()) {
       return false;
     }
@@ -2095,6 +2231,8 @@ namespace osmscout {
 
     areaLabelsTimer.Stop();
 
+    statistics.areaLabelsTime=areaLabelsTimer.GetMilliseconds();
+
     if (parameter.IsAborted()) {
       return false;
     }
@@ -2112,10 +2250,25 @@ namespace osmscout {
 
     poisTimer.Stop();
 
+    statistics.poisTime=poisTimer.GetMilliseconds();
+
     if (parameter.IsAborted()) {
       return false;
     }
 
+    //
+    // Label placement & drawing
+    //
+
+    StopClock labelLayoutTimer;
+
+    labels.Layout();
+    overlayLabels.Layout();
+
+    labelLayoutTimer.Stop();
+
+    statistics.labelLayoutTime=labelLayoutTimer.GetMilliseconds();
+
     StopClock labelsTimer;
 
     DrawLabels(*styleConfig,
@@ -2124,11 +2277,26 @@ namespace osmscout {
 
     labelsTimer.Stop();
 
+    statistics.labelsTime=labelsTimer.GetMilliseconds();
+
     AfterDrawing(*styleConfig,
                  projection,
                  parameter,
                  data);
 
+    totalTimer.Stop();
+
+    statistics.totalTime=totalTimer.GetMilliseconds();
+    statistics.areasSegments=areasSegments;
+    statistics.areasDrawn=areasDrawn;
+    statistics.waysSegments=waysSegments;
+    statistics.waysDrawn=waysDrawn;
+    statistics.waysLabelDrawn=waysLabelDrawn;
+    statistics.nodesDrawn=nodesDrawn;
+    statistics.labelsAdded=labels.GetLabelsAdded()+overlayLabels.GetLabelsAdded();
+    statistics.labelsPlaced=labels.Size()+overlayLabels.Size();
+    statistics.labelsDrawn=labelsDrawn;
+
     if (parameter.IsDebugPerformance()) {
       log.Info()
           << "Paths: "
@@ -2147,7 +2315,7 @@ namespace osmscout {
 
       log.Info()
           << "Labels: " << labels.Size() << "/" << overlayLabels.Size() << "/" << labelsDrawn << " (pcs) "
-          << labelsTimer << " (sec)";
+          << labelLayoutTimer << "/" << labelsTimer << " (sec)";
     }
 
     return true;
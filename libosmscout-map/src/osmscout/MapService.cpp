@@ -27,6 +27,7 @@
 
 #include <osmscout/util/Geometry.h>
 #include <osmscout/util/Logger.h>
+#include <osmscout/util/Tiling.h>
 
 namespace osmscout {
 
@@ -83,32 +84,42 @@ namespace osmscout {
     }
   }
 
-  MapService::MapService(const DatabaseRef& database)
+  /**
+   * Create a new map service. The tile data is loaded by a pool of workerCount
+   * threads. If 0 is passed, the number of hardware threads is used, but at least
+   * one thread for each of the five kinds of loading tasks of a tile.
+   */
+  MapService::MapService(const DatabaseRef& database,
+                         size_t workerCount)
    : database(database),
      cache(25),
-     nodeWorkerThread(&MapService::NodeWorkerLoop,this),
-     wayWorkerThread(&MapService::WayWorkerLoop,this),
-     wayLowZoomWorkerThread(&MapService::WayLowZoomWorkerLoop,this),
-     areaWorkerThread(&MapService::AreaWorkerLoop,this),
-     areaLowZoomWorkerThread(&MapService::AreaLowZoomWorkerLoop,this),
-     nextCallbackId(0)
+     workerPool(workerCount>0 ? workerCount : std::max<size_t>(std::thread::hardware_concurrency(),5)),
+     nextCallbackId(0),
+     activeLoads(0),
+     cacheHits(0),
+     cacheMisses(0),
+     prefetchStop(false),
+     prefetchGeneration(0),
+     prefetchThread(&MapService::PrefetchLoop,this)
   {
     // no code
   }
 
   MapService::~MapService()
   {
-    nodeWorkerQueue.Stop();
-    wayWorkerQueue.Stop();
-    wayLowZoomWorkerQueue.Stop();
-    areaWorkerQueue.Stop();
-    areaLowZoomWorkerQueue.Stop();
-
-    nodeWorkerThread.join();
-    wayWorkerThread.join();
-    wayLowZoomWorkerThread.join();
-    areaWorkerThread.join();
-    areaLowZoomWorkerThread.join();
+    {
+      std::lock_guard<std::mutex> lock(prefetchMutex);
+
+      prefetchStop=true;
+      prefetchTiles.clear();
+
+      if (prefetchBreaker) {
+        prefetchBreaker->Break();
+      }
+    }
+
+    prefetchCondition.notify_all();
+    prefetchThread.join();
   }
 
   /**
@@ -116,18 +127,58 @@ namespace osmscout {
    */
   void MapService::SetCacheSize(size_t cacheSize)
   {
-    std::lock_guard<std::mutex> lock(stateMutex);
-
     cache.SetSize(cacheSize);
   }
 
-  void MapService::FlushTileCache()
+  /**
+   * Set the memory budget of the tile data cache in bytes. If set, the cache
+   * is limited by the estimated memory usage of the tiles instead of the
+   * number of tiles (see DataTileCache::SetMemoryBudget()).
+   */
+  void MapService::SetCacheMemoryBudget(size_t memoryBudget)
   {
-    std::lock_guard<std::mutex> lock(stateMutex);
+    cache.SetMemoryBudget(memoryBudget);
+  }
 
+  void MapService::FlushTileCache()
+  {
     cache.CleanupCache();
   }
 
+  /**
+   * Return the current size of the tile data cache and the hit statistics of
+   * LoadMissingTileData() and LoadMissingTileDataAsync() (prefetching is not counted).
+   */
+  MapService::CacheStatistics MapService::GetCacheStatistics() const
+  {
+    CacheStatistics statistics;
+
+    statistics.tileCount=cache.GetSize();
+    statistics.memory=cache.GetMemory();
+    statistics.hitCount=cacheHits;
+    statistics.missCount=cacheMisses;
+
+    return statistics;
+  }
+
+  void MapService::ResetCacheStatistics()
+  {
+    cacheHits=0;
+    cacheMisses=0;
+  }
+
+  void MapService::CountCacheHits(const std::list<TileRef>& tiles) const
+  {
+    for (const auto& tile : tiles) {
+      if (tile->IsComplete()) {
+        cacheHits++;
+      }
+      else {
+        cacheMisses++;
+      }
+    }
+  }
+
   MapService::TypeDefinitionRef MapService::GetTypeDefinition(const AreaSearchParameter& parameter,
                                                               const StyleConfig& styleConfig,
                                                               const Magnification& magnification) const
@@ -264,6 +315,8 @@ namespace osmscout {
     }
 
     if (!optimizeAreasLowZoom->HasOptimizations(magnification.GetMagnification())) {
+      tile->GetOptimizedAreaData().SetComplete();
+
       return true;
     }
 
@@ -398,6 +451,8 @@ namespace osmscout {
     }
 
     if (!optimizeWaysLowZoom->HasOptimizations(magnification.GetMagnification())) {
+      tile->GetOptimizedWayData().SetComplete();
+
       return true;
     }
 
@@ -515,124 +570,54 @@ namespace osmscout {
     return !parameter.IsAborted();
   }
 
-  void MapService::NodeWorkerLoop()
-  {
-    std::packaged_task<bool()> task;
-
-    while (nodeWorkerQueue.PopTask(task)) {
-      task();
-    }
-  }
-
-  void MapService::WayWorkerLoop()
-  {
-    std::packaged_task<bool()> task;
-
-    while (wayWorkerQueue.PopTask(task)) {
-      task();
-    }
-  }
-
-  void MapService::WayLowZoomWorkerLoop()
-  {
-    std::packaged_task<bool()> task;
-
-    while (wayLowZoomWorkerQueue.PopTask(task)) {
-      task();
-    }
-  }
-
-  void MapService::AreaWorkerLoop()
-  {
-    std::packaged_task<bool()> task;
-
-    while (areaWorkerQueue.PopTask(task)) {
-      task();
-    }
-  }
-
-  void MapService::AreaLowZoomWorkerLoop()
-  {
-    std::packaged_task<bool()> task;
-
-    while (areaLowZoomWorkerQueue.PopTask(task)) {
-      task();
-    }
-  }
-
-  std::future<bool> MapService::PushNodeTask(const AreaSearchParameter& parameter,
-                                             const TypeInfoSet& nodeTypes,
-                                             const GeoBox& boundingBox,
-                                             const TileRef& tile) const
-  {
-    std::packaged_task<bool()> task(std::bind(&MapService::GetNodes,this,parameter,nodeTypes,boundingBox,tile));
-
-    std::future<bool> future=task.get_future();
-
-    nodeWorkerQueue.PushTask(task);
-
-    return future;
-  }
-
-  std::future<bool> MapService::PushAreaLowZoomTask(const AreaSearchParameter& parameter,
-                                                    const TypeInfoSet& areaTypes,
-                                                    const Magnification& magnification,
-                                                    const GeoBox& boundingBox,
-                                                    const TileRef& tile) const
-  {
-    std::packaged_task<bool()> task(std::bind(&MapService::GetAreasLowZoom,this,parameter,areaTypes,magnification,boundingBox,tile));
-
-    std::future<bool> future=task.get_future();
-
-    areaLowZoomWorkerQueue.PushTask(task);
-
-    return future;
-  }
-
-  std::future<bool> MapService::PushAreaTask(const AreaSearchParameter& parameter,
-                                             const TypeInfoSet& areaTypes,
-                                             const Magnification& magnification,
-                                             const GeoBox& boundingBox,
-                                             const TileRef& tile) const
+  std::future<bool> MapService::AddNodeTask(WorkerTaskGroup& group,
+                                            const AreaSearchParameter& parameter,
+                                            const TypeInfoSet& nodeTypes,
+                                            const GeoBox& boundingBox,
+                                            const TileRef& tile) const
   {
-    std::packaged_task<bool()> task(std::bind(&MapService::GetAreas,this,parameter,areaTypes,magnification,boundingBox,tile));
-
-    std::future<bool> future=task.get_future();
-
-    areaWorkerQueue.PushTask(task);
-
-    return future;
+    return group.Add<bool>(std::bind(&MapService::GetNodes,this,parameter,nodeTypes,boundingBox,tile));
   }
 
-  std::future<bool> MapService::PushWayLowZoomTask(const AreaSearchParameter& parameter,
-                                                   const TypeInfoSet& wayTypes,
+  std::future<bool> MapService::AddAreaLowZoomTask(WorkerTaskGroup& group,
+                                                   const AreaSearchParameter& parameter,
+                                                   const TypeInfoSet& areaTypes,
                                                    const Magnification& magnification,
                                                    const GeoBox& boundingBox,
                                                    const TileRef& tile) const
   {
-    std::packaged_task<bool()> task(std::bind(&MapService::GetWaysLowZoom,this,parameter,
-                                              wayTypes,magnification,boundingBox,tile));
-
-    std::future<bool> future=task.get_future();
-
-    wayLowZoomWorkerQueue.PushTask(task);
-
-    return future;
+    return group.Add<bool>(std::bind(&MapService::GetAreasLowZoom,this,parameter,areaTypes,magnification,boundingBox,tile));
   }
 
-  std::future<bool> MapService::PushWayTask(const AreaSearchParameter& parameter,
-                                            const TypeInfoSet& wayTypes,
+  std::future<bool> MapService::AddAreaTask(WorkerTaskGroup& group,
+                                            const AreaSearchParameter& parameter,
+                                            const TypeInfoSet& areaTypes,
+                                            const Magnification& magnification,
                                             const GeoBox& boundingBox,
                                             const TileRef& tile) const
   {
-    std::packaged_task<bool()> task(std::bind(&MapService::GetWays,this,parameter,
-                                              wayTypes,boundingBox,tile));
-
-    std::future<bool> future=task.get_future();
+    return group.Add<bool>(std::bind(&MapService::GetAreas,this,parameter,areaTypes,magnification,boundingBox,tile));
+  }
 
-    wayWorkerQueue.PushTask(task);
+  std::future<bool> MapService::AddWayLowZoomTask(WorkerTaskGroup& group,
+                                                  const AreaSearchParameter& parameter,
+                                                  const TypeInfoSet& wayTypes,
+                                                  const Magnification& magnification,
+                                                  const GeoBox& boundingBox,
+                                                  const TileRef& tile) const
+  {
+    return group.Add<bool>(std::bind(&MapService::GetWaysLowZoom,this,parameter,
+                                     wayTypes,magnification,boundingBox,tile));
+  }
 
-    return future;
+  std::future<bool> MapService::AddWayTask(WorkerTaskGroup& group,
+                                           const AreaSearchParameter& parameter,
+                                           const TypeInfoSet& wayTypes,
+                                           const GeoBox& boundingBox,
+                                           const TileRef& tile) const
+  {
+    return group.Add<bool>(std::bind(&MapService::GetWays,this,parameter,
+                                     wayTypes,boundingBox,tile));
   }
 
   void MapService::NotifyTileStateCallbacks(const TileRef& tile) const
@@ -654,8 +639,6 @@ namespace osmscout {
   void MapService::LookupTiles(const Projection& projection,
                                std::list<TileRef>& tiles) const
   {
-    std::lock_guard<std::mutex> lock(stateMutex);
-
     StopClock cacheRetrievalTime;
 
     GeoBox boundingBox;
@@ -681,8 +664,6 @@ namespace osmscout {
                                const GeoBox& boundingBox,
                                std::list<TileRef>& tiles) const
   {
-    std::lock_guard<std::mutex> lock(stateMutex);
-
     StopClock cacheRetrievalTime;
 
     cache.GetTilesForBoundingBox(magnification,
@@ -702,8 +683,6 @@ namespace osmscout {
    */
   TileRef MapService::LookupTile(const TileId& id) const
   {
-    std::lock_guard<std::mutex> lock(stateMutex);
-
     StopClock cacheRetrievalTime;
 
     TileRef tile=cache.GetTile(id);
@@ -715,107 +694,197 @@ namespace osmscout {
     return tile;
   }
 
+  /**
+   * Remove all tiles from the list of loading tiles, that have been loaded
+   * completely. Must be called while holding the stateMutex.
+   */
+  void MapService::PruneLoadingTiles() const
+  {
+    auto entry=loadingTiles.begin();
+
+    while (entry!=loadingTiles.end()) {
+      bool ready=true;
+
+      for (const auto& result : entry->second) {
+        if (result.wait_for(std::chrono::seconds(0))!=std::future_status::ready) {
+          ready=false;
+          break;
+        }
+      }
+
+      if (ready) {
+        entry=loadingTiles.erase(entry);
+      }
+      else {
+        ++entry;
+      }
+    }
+  }
+
+  /**
+   * Return true, if there are tiles currently being loaded or a load has been
+   * requested.
+   */
+  bool MapService::IsLoading() const
+  {
+    std::lock_guard<std::mutex> lock(stateMutex);
+
+    PruneLoadingTiles();
+
+    return activeLoads>0 ||
+           !loadingTiles.empty();
+  }
+
   /**
    * Load all missing data for the given tiles based on the given style config.
+   *
+   * The stateMutex is only hold while scheduling the loading tasks. If a tile is
+   * already being loaded by another call, its tasks are not scheduled again,
+   * instead the call waits for the other tasks. If the other call was aborted,
+   * the tile gets scheduled again.
    */
   bool MapService::LoadMissingTileDataInternal(const AreaSearchParameter& parameter,
                                                const StyleConfig& styleConfig,
                                                std::list<TileRef>& tiles,
+                                               WorkerPool::Priority priority,
                                                bool async) const
   {
-    std::lock_guard<std::mutex>  lock(stateMutex);
-
-    StopClock                    overallTime;
-
-    TypeDefinitionRef            typeDefinition;
-
-    std::list<std::future<bool>> results;
-
-    for (auto& tile : tiles) {
-      GeoBox          tileBoundingBox(tile->GetBoundingBox());
-
-      if (!tile->IsComplete()) {
-        StopClock         tileLoadingTime;
-        Magnification     magnification;
-        std::future<bool> nodeResult;
-        std::future<bool> areasLowZoomResult;
-        std::future<bool> areasResult;
-        std::future<bool> waysLowZoomResult;
-        std::future<bool> waysResult;
-
-        //std::cout << "Loading tile: " << (std::string)tile->GetId() << std::endl;
-
-        magnification.SetLevel(tile->GetId().GetLevel());
-          
-        // TODO: Cache the type definitions, perhaps already in the StyleConfig?
-        typeDefinition=GetTypeDefinition(parameter,
-                                         styleConfig,
-                                         magnification);
-
-        cache.PrefillDataFromCache(*tile,
-                                   typeDefinition->nodeTypes,
-                                   typeDefinition->wayTypes,
-                                   typeDefinition->areaTypes,
-                                   typeDefinition->optimizedWayTypes,
-                                   typeDefinition->optimizedAreaTypes);
-
-        NotifyTileStateCallbacks(tile);
-
-        results.push_back(PushNodeTask(parameter,
-                                       typeDefinition->nodeTypes,
-                                       tileBoundingBox,
-                                       tile));
-
-        if (parameter.GetUseLowZoomOptimization()) {
-          results.push_back(PushAreaLowZoomTask(parameter,
-                                                typeDefinition->optimizedAreaTypes,
-                                                magnification,
-                                                tileBoundingBox,
-                                                tile));
-        }
-
-        results.push_back(PushAreaTask(parameter,
-                                       typeDefinition->areaTypes,
-                                       magnification,
-                                       tileBoundingBox,
-                                       tile));
-
-        if (parameter.GetUseLowZoomOptimization()) {
-          results.push_back(PushWayLowZoomTask(parameter,
-                                               typeDefinition->optimizedWayTypes,
-                                               magnification,
-                                               tileBoundingBox,
-                                               tile));
+    StopClock          overallTime;
+    bool               success=true;
+    std::list<TileRef> pendingTiles(tiles);
+
+    while (!pendingTiles.empty()) {
+      std::list<std::shared_future<bool>> results;
+      std::list<std::shared_future<bool>> foreignResults;
+      std::list<TileRef>                  foreignTiles;
+
+      {
+        std::lock_guard<std::mutex> lock(stateMutex);
+
+        PruneLoadingTiles();
+
+        for (auto& tile : pendingTiles) {
+          if (tile->IsComplete()) {
+            //std::cout << "Using cached tile: " << (std::string)tile->GetId() << std::endl;
+            continue;
+          }
+
+          auto loadingTile=loadingTiles.find(tile->GetId());
+
+          if (loadingTile!=loadingTiles.end()) {
+            foreignResults.insert(foreignResults.end(),
+                                  loadingTile->second.begin(),
+                                  loadingTile->second.end());
+            foreignTiles.push_back(tile);
+            continue;
+          }
+
+          GeoBox            tileBoundingBox(tile->GetBoundingBox());
+          StopClock         tileLoadingTime;
+          Magnification     magnification;
+          TileLoadingState& loadingState=loadingTiles[tile->GetId()];
+
+          //std::cout << "Loading tile: " << (std::string)tile->GetId() << std::endl;
+
+          magnification.SetLevel(tile->GetId().GetLevel());
+
+          // TODO: Cache the type definitions, perhaps already in the StyleConfig?
+          TypeDefinitionRef typeDefinition=GetTypeDefinition(parameter,
+                                                             styleConfig,
+                                                             magnification);
+
+          cache.PrefillDataFromCache(*tile,
+                                     typeDefinition->nodeTypes,
+                                     typeDefinition->wayTypes,
+                                     typeDefinition->areaTypes,
+                                     typeDefinition->optimizedWayTypes,
+                                     typeDefinition->optimizedAreaTypes);
+
+          NotifyTileStateCallbacks(tile);
+
+          WorkerTaskGroup group;
+
+          loadingState.push_back(AddNodeTask(group,
+                                             parameter,
+                                             typeDefinition->nodeTypes,
+                                             tileBoundingBox,
+                                             tile).share());
+
+          if (parameter.GetUseLowZoomOptimization()) {
+            loadingState.push_back(AddAreaLowZoomTask(group,
+                                                      parameter,
+                                                      typeDefinition->optimizedAreaTypes,
+                                                      magnification,
+                                                      tileBoundingBox,
+                                                      tile).share());
+          }
+
+          loadingState.push_back(AddAreaTask(group,
+                                             parameter,
+                                             typeDefinition->areaTypes,
+                                             magnification,
+                                             tileBoundingBox,
+                                             tile).share());
+
+          if (parameter.GetUseLowZoomOptimization()) {
+            loadingState.push_back(AddWayLowZoomTask(group,
+                                                     parameter,
+                                                     typeDefinition->optimizedWayTypes,
+                                                     magnification,
+                                                     tileBoundingBox,
+                                                     tile).share());
+          }
+
+          loadingState.push_back(AddWayTask(group,
+                                            parameter,
+                                            typeDefinition->wayTypes,
+                                            tileBoundingBox,
+                                            tile).share());
+
+          workerPool.Push(group,
+                          priority);
+
+          results.insert(results.end(),
+                         loadingState.begin(),
+                         loadingState.end());
+
+          tileLoadingTime.Stop();
+
+          //std::cout << "Tile loading time: " << tileLoadingTime.ResultString() << std::endl;
+
+          if (tileLoadingTime.GetMilliseconds()>150) {
+            log.Warn() << "Retrieving tile data for tile " << tile->GetId().DisplayText() << " took " << tileLoadingTime.ResultString();
+          }
         }
+      }
 
-        results.push_back(PushWayTask(parameter,
-                                      typeDefinition->wayTypes,
-                                      tileBoundingBox,
-                                      tile));
-
-        tileLoadingTime.Stop();
+      pendingTiles.clear();
 
-        //std::cout << "Tile loading time: " << tileLoadingTime.ResultString() << std::endl;
+      if (async) {
+        break;
+      }
 
-        if (tileLoadingTime.GetMilliseconds()>150) {
-          log.Warn() << "Retrieving tile data for tile " << tile->GetId().DisplayText() << " took " << tileLoadingTime.ResultString();
+      for (auto& result : results) {
+        if (!result.get()) {
+          success=false;
         }
-
       }
-      else {
-        //std::cout << "Using cached tile: " << (std::string)tile->GetId() << std::endl;
+
+      // The result of foreign tasks depends on the parameter of the other call,
+      // so we only wait for them and check the state of the tiles afterwards
+      for (auto& result : foreignResults) {
+        result.wait();
       }
-    }
 
-    bool success=true;
+      if (!success ||
+          parameter.IsAborted()) {
+        success=false;
+        break;
+      }
 
-    if (async) {
-      results.clear();
-    }
-    else {
-      for (auto& result : results) {
-        if (!result.get()) {
-          success=false;
+      for (auto& tile : foreignTiles) {
+        if (!tile->IsComplete()) {
+          pendingTiles.push_back(tile);
         }
       }
     }
@@ -840,7 +909,15 @@ namespace osmscout {
                                        const StyleConfig& styleConfig,
                                        std::list<TileRef>& tiles) const
   {
-    return LoadMissingTileDataInternal(parameter,styleConfig,tiles,false);
+    activeLoads++;
+
+    CountCacheHits(tiles);
+
+    bool result=LoadMissingTileDataInternal(parameter,styleConfig,tiles,WorkerPool::priorityNormal,false);
+
+    activeLoads--;
+
+    return result;
   }
 
   /**
@@ -855,17 +932,220 @@ namespace osmscout {
                                             const StyleConfig& styleConfig,
                                             std::list<TileRef>& tiles) const
   {
+    activeLoads++;
+
+    CountCacheHits(tiles);
+
     auto result=std::async(std::launch::async,
                            &MapService::LoadMissingTileDataInternal,this,
                            std::ref(parameter),
                            std::ref(styleConfig),
                            std::ref(tiles),
+                           WorkerPool::priorityNormal,
                            true);
 
-    return result.get();
+    bool success=result.get();
+
+    activeLoads--;
+
+    return success;
     //return LoadMissingTileData(parameter,styleConfig,tiles,true);
   }
 
+  /**
+   * Prefetch the data of the tiles around the given bounding box in the background.
+   *
+   * First the ring of neighbouring tiles of the given magnification is loaded, tiles in the
+   * given direction of movement first. Afterwards the tiles of the next zoom level covering
+   * the bounding box are loaded.
+   *
+   * Prefetching has low priority: a tile is only loaded, if no other loading is
+   * active. Tiles are loaded one after the other, so a prefetch does not block other loads
+   * for long. Each call (and CancelPrefetch()) cancels the previous prefetch
+   * request, so the method can be called each time the viewport changes.
+   *
+   * @param parameter
+   *    Parameter for loading the data. The breaker of the parameter is replaced.
+   * @param styleConfig
+   *    The style config to use
+   * @param magnification
+   *    Magnification of the current viewport
+   * @param boundingBox
+   *    Bounding box of the current viewport
+   * @param direction
+   *    Direction of movement of the viewport (x=longitude, y=latitude), or (0,0)
+   */
+  void MapService::PrefetchTiles(const AreaSearchParameter& parameter,
+                                 const StyleConfigRef& styleConfig,
+                                 const Magnification& magnification,
+                                 const GeoBox& boundingBox,
+                                 const Vertex2D& direction)
+  {
+    std::list<TileRef> tiles;
+    size_t             level=magnification.GetLevel();
+
+    if (level<CELL_DIMENSION_COUNT) {
+      double width=cellDimension[level].width;
+      double height=cellDimension[level].height;
+      long   xCount=(long)round(360.0/width);
+      long   yCount=(long)round(180.0/height);
+      long   cx1=(long)floor((boundingBox.GetMinLon()+180.0)/width);
+      long   cy1=(long)floor((boundingBox.GetMinLat()+90.0)/height);
+      long   cx2=(long)floor((boundingBox.GetMaxLon()+180.0)/width);
+      long   cy2=(long)floor((boundingBox.GetMaxLat()+90.0)/height);
+      double centerX=(cx1+cx2)/2.0;
+      double centerY=(cy1+cy2)/2.0;
+
+      std::vector<std::pair<double,TileId>> neighbours;
+
+      for (long y=cy1-1; y<=cy2+1; y++) {
+        for (long x=cx1-1; x<=cx2+1; x++) {
+          if (x<0 || x>=xCount ||
+              y<0 || y>=yCount) {
+            continue;
+          }
+
+          if (x>=cx1 && x<=cx2 &&
+              y>=cy1 && y<=cy2) {
+            continue;
+          }
+
+          double dx=x-centerX;
+          double dy=y-centerY;
+          double score=(dx*direction.GetX()+dy*direction.GetY())/sqrt(dx*dx+dy*dy);
+
+          neighbours.push_back(std::make_pair(score,
+                                              TileId(magnification,(size_t)x,(size_t)y)));
+        }
+      }
+
+      std::stable_sort(neighbours.begin(),
+                       neighbours.end(),
+                       [](const std::pair<double,TileId>& a,
+                          const std::pair<double,TileId>& b) {
+        return a.first>b.first;
+      });
+
+      for (const auto& neighbour : neighbours) {
+        TileRef tile=cache.GetTile(neighbour.second);
+
+        if (!tile->IsComplete()) {
+          tiles.push_back(tile);
+        }
+      }
+    }
+
+    if (level+1<CELL_DIMENSION_COUNT) {
+      Magnification      nextMagnification;
+      std::list<TileRef> nextTiles;
+
+      nextMagnification.SetLevel((uint32_t)(level+1));
+
+      cache.GetTilesForBoundingBox(nextMagnification,
+                                   boundingBox,
+                                   nextTiles);
+
+      for (const auto& tile : nextTiles) {
+        if (!tile->IsComplete()) {
+          tiles.push_back(tile);
+        }
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(prefetchMutex);
+
+      if (prefetchBreaker) {
+        prefetchBreaker->Break();
+      }
+
+      prefetchBreaker=std::make_shared<ThreadedBreaker>();
+      prefetchParameter=parameter;
+      prefetchParameter.SetBreaker(prefetchBreaker);
+      prefetchStyleConfig=styleConfig;
+      prefetchTiles=tiles;
+      prefetchGeneration++;
+    }
+
+    prefetchCondition.notify_one();
+  }
+
+  /**
+   * Cancel the current prefetch request. A tile currently being prefetched
+   * is aborted.
+   */
+  void MapService::CancelPrefetch()
+  {
+    {
+      std::lock_guard<std::mutex> lock(prefetchMutex);
+
+      if (prefetchBreaker) {
+        prefetchBreaker->Break();
+        prefetchBreaker.reset();
+      }
+
+      prefetchTiles.clear();
+      prefetchStyleConfig.reset();
+      prefetchGeneration++;
+    }
+
+    prefetchCondition.notify_one();
+  }
+
+  void MapService::PrefetchLoop()
+  {
+    std::unique_lock<std::mutex> lock(prefetchMutex);
+
+    while (true) {
+      prefetchCondition.wait(lock,[this] {
+        return prefetchStop || !prefetchTiles.empty();
+      });
+
+      if (prefetchStop) {
+        return;
+      }
+
+      size_t generation=prefetchGeneration;
+
+      lock.unlock();
+
+      bool loading=IsLoading();
+
+      lock.lock();
+
+      if (loading) {
+        // Other loads have priority, check again later
+        prefetchCondition.wait_for(lock,std::chrono::milliseconds(10));
+        continue;
+      }
+
+      if (prefetchStop ||
+          generation!=prefetchGeneration ||
+          prefetchTiles.empty()) {
+        continue;
+      }
+
+      std::list<TileRef>  tiles;
+      AreaSearchParameter parameter(prefetchParameter);
+      StyleConfigRef      styleConfig(prefetchStyleConfig);
+
+      tiles.push_back(prefetchTiles.front());
+      prefetchTiles.pop_front();
+
+      lock.unlock();
+
+      LoadMissingTileDataInternal(parameter,
+                                  *styleConfig,
+                                  tiles,
+                                  WorkerPool::priorityLow,
+                                  false);
+
+      tiles.clear();
+
+      lock.lock();
+    }
+  }
+
   /**
    * Convert the data hold by the given tiles to the given MapData class instance.
    */
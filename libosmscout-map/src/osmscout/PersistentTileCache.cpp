@@ -0,0 +1,852 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/PersistentTileCache.h>
+
+#include <osmscout/private/Config.h>
+
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+#if defined(HAVE_UNISTD_H)
+  #include <unistd.h>
+#endif
+
+#if defined(HAVE_FCNTL_H)
+  #include <fcntl.h>
+#endif
+
+#if defined(__WIN32__) || defined(WIN32)
+  #include <io.h>
+#endif
+
+#include <osmscout/util/Exception.h>
+#include <osmscout/util/File.h>
+#include <osmscout/util/Logger.h>
+
+namespace osmscout {
+
+  /*
+   * File layout (all numbers little endian):
+   *
+   * File header:
+   *   char[8]  "OSMTILES"
+   *   uint32   version
+   *   uint32   reserved
+   *
+   * Followed by any number of records:
+   *   uint32   record magic
+   *   uint32   record type (tile or removed tile)
+   *   uint64   style hash
+   *   uint32   level
+   *   uint32   x
+   *   uint32   y
+   *   uint32   size of the tile data
+   *   uint32   checksum of the record header (without the checksum) and the tile data
+   *   char[]   tile data
+   */
+  static const char     fileMagic[8]     = {'O','S','M','T','I','L','E','S'};
+  static const uint32_t fileVersion      = 1;
+  static const size_t   fileHeaderSize   = 16;
+
+  static const uint32_t recordMagic      = 0x454c4954;
+  static const uint32_t recordTile       = 1;
+  static const uint32_t recordRemoved    = 2;
+  static const size_t   recordHeaderSize = 36;
+
+  //! Minimum size of obsolete data in the file before it is compacted
+  static const FileOffset minCompactionSize=1024*1024;
+
+  static void EncodeUInt32(char* buffer,
+                           uint32_t value)
+  {
+    for (size_t i=0; i<4; i++) {
+      buffer[i]=(char)((value >> (i*8)) & 0xff);
+    }
+  }
+
+  static void EncodeUInt64(char* buffer,
+                           uint64_t value)
+  {
+    for (size_t i=0; i<8; i++) {
+      buffer[i]=(char)((value >> (i*8)) & 0xff);
+    }
+  }
+
+  static uint32_t DecodeUInt32(const char* buffer)
+  {
+    uint32_t value=0;
+
+    for (size_t i=0; i<4; i++) {
+      value|=(uint32_t)(unsigned char)buffer[i] << (i*8);
+    }
+
+    return value;
+  }
+
+  static uint64_t DecodeUInt64(const char* buffer)
+  {
+    uint64_t value=0;
+
+    for (size_t i=0; i<8; i++) {
+      value|=(uint64_t)(unsigned char)buffer[i] << (i*8);
+    }
+
+    return value;
+  }
+
+  /**
+   * FNV-1a hash (32 bit), used as checksum of the records
+   */
+  static uint32_t UpdateChecksum(uint32_t checksum,
+                                 const char* data,
+                                 size_t size)
+  {
+    for (size_t i=0; i<size; i++) {
+      checksum^=(unsigned char)data[i];
+      checksum*=16777619u;
+    }
+
+    return checksum;
+  }
+
+  static const uint32_t initialChecksum=2166136261u;
+
+  static bool SeekFile(FILE* file,
+                       FileOffset offset)
+  {
+#if defined(HAVE_FSEEKO)
+    return fseeko(file,(off_t)offset,SEEK_SET)==0;
+#else
+    return fseek(file,(long)offset,SEEK_SET)==0;
+#endif
+  }
+
+  /**
+   * Flush the buffers of the file and make sure, that the data is written to disk
+   */
+  static bool SyncFile(FILE* file)
+  {
+    if (fflush(file)!=0) {
+      return false;
+    }
+
+#if defined(__WIN32__) || defined(WIN32)
+    return _commit(_fileno(file))==0;
+#elif defined(HAVE_UNISTD_H)
+    return fsync(fileno(file))==0;
+#else
+    return true;
+#endif
+  }
+
+  /**
+   * Make sure, that the directory entry of the given file (for example after
+   * a rename) is written to disk. Windows does not support this.
+   */
+  static bool SyncDirectory(const std::string& filename)
+  {
+#if defined(HAVE_UNISTD_H) && defined(HAVE_FCNTL_H) && !(defined(__WIN32__) || defined(WIN32))
+    std::string::size_type pos=filename.find_last_of('/');
+    std::string            directory;
+
+    if (pos==std::string::npos) {
+      directory=".";
+    }
+    else if (pos==0) {
+      directory="/";
+    }
+    else {
+      directory=filename.substr(0,pos);
+    }
+
+    int handle=open(directory.c_str(),O_RDONLY);
+
+    if (handle<0) {
+      return false;
+    }
+
+    bool success=fsync(handle)==0;
+
+    return close(handle)==0 && success;
+#else
+    return true;
+#endif
+  }
+
+  static bool WriteFileHeader(FILE* file)
+  {
+    char header[fileHeaderSize];
+
+    std::memcpy(header,fileMagic,sizeof(fileMagic));
+    EncodeUInt32(header+8,fileVersion);
+    EncodeUInt32(header+12,0);
+
+    return fwrite(header,1,fileHeaderSize,file)==fileHeaderSize;
+  }
+
+  /**
+   * Write a complete record with a single write call
+   */
+  static bool WriteRecord(FILE* file,
+                          uint32_t type,
+                          uint64_t styleHash,
+                          uint32_t level,
+                          uint32_t x,
+                          uint32_t y,
+                          const char* data,
+                          uint32_t size)
+  {
+    std::vector<char> record(recordHeaderSize+size);
+
+    EncodeUInt32(&record[0],recordMagic);
+    EncodeUInt32(&record[4],type);
+    EncodeUInt64(&record[8],styleHash);
+    EncodeUInt32(&record[16],level);
+    EncodeUInt32(&record[20],x);
+    EncodeUInt32(&record[24],y);
+    EncodeUInt32(&record[28],size);
+
+    if (size>0) {
+      std::memcpy(&record[recordHeaderSize],data,size);
+    }
+
+    uint32_t checksum=UpdateChecksum(initialChecksum,&record[0],32);
+
+    checksum=UpdateChecksum(checksum,data,size);
+    EncodeUInt32(&record[32],checksum);
+
+    return fwrite(record.data(),1,record.size(),file)==record.size();
+  }
+
+  bool PersistentTileCache::Key::operator<(const Key& other) const
+  {
+    if (styleHash!=other.styleHash) {
+      return styleHash<other.styleHash;
+    }
+
+    if (level!=other.level) {
+      return level<other.level;
+    }
+
+    if (y!=other.y) {
+      return y<other.y;
+    }
+
+    return x<other.x;
+  }
+
+  /**
+   * Create a new, not yet opened cache with the given budget (in bytes) for the tile data
+   */
+  PersistentTileCache::PersistentTileCache(size_t byteBudget)
+  : file(NULL),
+    byteBudget(byteBudget),
+    tileBytes(0),
+    fileSize(0)
+  {
+    // no code
+  }
+
+  PersistentTileCache::~PersistentTileCache()
+  {
+    Close();
+  }
+
+  PersistentTileCache::Key PersistentTileCache::GetKey(const TileId& id,
+                                                       uint64_t styleHash)
+  {
+    Key key;
+
+    key.styleHash=styleHash;
+    key.level=(uint32_t)id.GetLevel();
+    key.x=(uint32_t)id.GetX();
+    key.y=(uint32_t)id.GetY();
+
+    return key;
+  }
+
+  /**
+   * Read all records of the file and build the index. validSize returns the size of
+   * the file up to the last valid record.
+   */
+  bool PersistentTileCache::Scan(FileOffset& validSize)
+  {
+    char header[fileHeaderSize];
+
+    validSize=0;
+
+    if (!SeekFile(file,0) ||
+        fread(header,1,fileHeaderSize,file)!=fileHeaderSize ||
+        std::memcmp(header,fileMagic,sizeof(fileMagic))!=0) {
+      log.Error() << "'" << filename << "' is not a tile cache file";
+      return false;
+    }
+
+    if (DecodeUInt32(header+8)!=fileVersion) {
+      log.Error() << "Tile cache file '" << filename << "' has an unsupported version";
+      return false;
+    }
+
+    FileOffset        offset=fileHeaderSize;
+    char              recordHeader[recordHeaderSize];
+    std::vector<char> data;
+
+    while (fread(recordHeader,1,recordHeaderSize,file)==recordHeaderSize) {
+      uint32_t type=DecodeUInt32(recordHeader+4);
+      uint32_t size=DecodeUInt32(recordHeader+28);
+
+      if (DecodeUInt32(recordHeader)!=recordMagic ||
+          (type!=recordTile && type!=recordRemoved) ||
+          offset+recordHeaderSize+size>fileSize) {
+        break;
+      }
+
+      data.resize(size);
+
+      if (size>0 &&
+          fread(data.data(),1,size,file)!=size) {
+        break;
+      }
+
+      uint32_t checksum=UpdateChecksum(initialChecksum,recordHeader,32);
+
+      checksum=UpdateChecksum(checksum,data.data(),size);
+
+      if (checksum!=DecodeUInt32(recordHeader+32)) {
+        break;
+      }
+
+      Key key;
+
+      key.styleHash=DecodeUInt64(recordHeader+8);
+      key.level=DecodeUInt32(recordHeader+16);
+      key.x=DecodeUInt32(recordHeader+20);
+      key.y=DecodeUInt32(recordHeader+24);
+
+      auto existingEntry=index.find(key);
+
+      if (existingEntry!=index.end()) {
+        tileBytes-=existingEntry->second->size;
+        cache.erase(existingEntry->second);
+        index.erase(existingEntry);
+      }
+
+      if (type==recordTile) {
+        CacheEntry entry;
+
+        entry.key=key;
+        entry.offset=offset+recordHeaderSize;
+        entry.size=size;
+
+        cache.push_front(entry);
+        index[key]=cache.begin();
+        tileBytes+=size;
+      }
+
+      offset+=recordHeaderSize+size;
+    }
+
+    validSize=offset;
+
+    return true;
+  }
+
+  /**
+   * Open the cache file with the given name. If the file does not exist, it is created.
+   */
+  bool PersistentTileCache::Open(const std::string& filename)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (file!=NULL) {
+      log.Error() << "Tile cache '" << this->filename << "' is already open";
+      return false;
+    }
+
+    this->filename=filename;
+
+    if (!ExistsInFilesystem(filename)) {
+      FILE* newFile=fopen(filename.c_str(),"wb");
+
+      if (newFile==NULL) {
+        log.Error() << "Cannot create tile cache file '" << filename << "'";
+        return false;
+      }
+
+      bool success=WriteFileHeader(newFile);
+
+      if (fclose(newFile)!=0 ||
+          !success) {
+        log.Error() << "Cannot write tile cache file '" << filename << "'";
+        return false;
+      }
+    }
+
+    // Writes always append to the end of the file
+    file=fopen(filename.c_str(),"a+b");
+
+    if (file==NULL) {
+      log.Error() << "Cannot open tile cache file '" << filename << "'";
+      return false;
+    }
+
+    FileOffset validSize;
+
+    try {
+      fileSize=osmscout::GetFileSize(filename);
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      fclose(file);
+      file=NULL;
+
+      return false;
+    }
+
+    if (!Scan(validSize)) {
+      cache.clear();
+      index.clear();
+      tileBytes=0;
+      fclose(file);
+      file=NULL;
+
+      return false;
+    }
+
+    bool success=true;
+
+    if (validSize<fileSize) {
+      // Records appended after damaged records would not be found
+      // when opening the file next time, so we have to rewrite the file
+      log.Warn() << "Dropping " << (fileSize-validSize) << " bytes of damaged data from tile cache '" << filename << "'";
+      fileSize=validSize;
+
+      success=CompactFile();
+    }
+
+    success=success && Evict();
+
+    if (!success) {
+      cache.clear();
+      index.clear();
+      tileBytes=0;
+      fileSize=0;
+
+      // The file is still open, if compacting failed before replacing the file
+      if (file!=NULL) {
+        fclose(file);
+        file=NULL;
+      }
+    }
+
+    return success;
+  }
+
+  bool PersistentTileCache::Close()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    bool success=true;
+
+    if (file!=NULL) {
+      success=fclose(file)==0;
+      file=NULL;
+
+      if (!success) {
+        log.Error() << "Cannot close tile cache file '" << filename << "'";
+      }
+    }
+
+    cache.clear();
+    index.clear();
+    tileBytes=0;
+    fileSize=0;
+
+    return success;
+  }
+
+  bool PersistentTileCache::IsOpen() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return file!=NULL;
+  }
+
+  bool PersistentTileCache::AppendRecord(uint32_t type,
+                                         const Key& key,
+                                         const char* data,
+                                         uint32_t size)
+  {
+    // Switching from reading to writing requires positioning the stream
+    if (!SeekFile(file,fileSize) ||
+        !WriteRecord(file,
+                     type,
+                     key.styleHash,
+                     key.level,
+                     key.x,
+                     key.y,
+                     data,
+                     size) ||
+        fflush(file)!=0) {
+      log.Error() << "Cannot write to tile cache file '" << filename << "'";
+      return false;
+    }
+
+    fileSize+=recordHeaderSize+size;
+
+    return true;
+  }
+
+  bool PersistentTileCache::ReadData(const CacheEntry& entry,
+                                     std::string& data) const
+  {
+    data.resize(entry.size);
+
+    if (!SeekFile(file,entry.offset) ||
+        (entry.size>0 && fread(&data[0],1,entry.size,file)!=entry.size)) {
+      log.Error() << "Cannot read from tile cache file '" << filename << "'";
+      data.clear();
+
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Remove the given entry from the cache and mark it as removed in the file
+   */
+  bool PersistentTileCache::Remove(CacheRef entry)
+  {
+    Key key=entry->key;
+
+    tileBytes-=entry->size;
+    index.erase(key);
+    cache.erase(entry);
+
+    return AppendRecord(recordRemoved,
+                        key,
+                        NULL,
+                        0);
+  }
+
+  /**
+   * Evict the least recently used tiles until the tile data fits into the budget and
+   * compact the file, if there is more obsolete than live data.
+   */
+  bool PersistentTileCache::Evict()
+  {
+    while (tileBytes>byteBudget &&
+           !cache.empty()) {
+      if (!Remove(std::prev(cache.end()))) {
+        return false;
+      }
+    }
+
+    FileOffset garbageSize=GetGarbageSize();
+
+    if (garbageSize>=minCompactionSize &&
+        garbageSize>fileSize-garbageSize) {
+      return CompactFile();
+    }
+
+    return true;
+  }
+
+  /**
+   * Size of the records in the file, that are not referenced by the index anymore
+   */
+  FileOffset PersistentTileCache::GetGarbageSize() const
+  {
+    return fileSize-fileHeaderSize-cache.size()*recordHeaderSize-tileBytes;
+  }
+
+  /**
+   * Write all tiles to a new file, the least recently used tile first, and replace
+   * the current file with the new file.
+   */
+  bool PersistentTileCache::CompactFile()
+  {
+    std::string tmpFilename=filename+".tmp";
+    FILE*       tmpFile=fopen(tmpFilename.c_str(),"wb");
+
+    if (tmpFile==NULL) {
+      log.Error() << "Cannot create file '" << tmpFilename << "'";
+      return false;
+    }
+
+    bool                    success=WriteFileHeader(tmpFile);
+    std::vector<FileOffset> offsets;
+    FileOffset              offset=fileHeaderSize;
+    std::string             data;
+
+    offsets.reserve(cache.size());
+
+    for (auto entry=cache.rbegin(); entry!=cache.rend() && success; ++entry) {
+      success=ReadData(*entry,data) &&
+              WriteRecord(tmpFile,
+                          recordTile,
+                          entry->key.styleHash,
+                          entry->key.level,
+                          entry->key.x,
+                          entry->key.y,
+                          data.data(),
+                          entry->size);
+
+      offsets.push_back(offset+recordHeaderSize);
+      offset+=recordHeaderSize+entry->size;
+    }
+
+    // The data must be on disk before the file replaces the current file,
+    // else a crash may leave an empty or incomplete cache file
+    success=success && SyncFile(tmpFile);
+
+    if (fclose(tmpFile)!=0 ||
+        !success) {
+      log.Error() << "Cannot write file '" << tmpFilename << "'";
+      RemoveFile(tmpFilename);
+
+      return false;
+    }
+
+    fclose(file);
+    file=NULL;
+
+#if defined(__WIN32__) || defined(WIN32)
+    // rename() does not replace existing files
+    RemoveFile(filename);
+#endif
+
+    if (!RenameFile(tmpFilename,filename)) {
+      log.Error() << "Cannot rename '" << tmpFilename << "' to '" << filename << "'";
+      cache.clear();
+      index.clear();
+      tileBytes=0;
+
+      return false;
+    }
+
+    if (!SyncDirectory(filename)) {
+      log.Warn() << "Cannot sync directory of tile cache file '" << filename << "'";
+    }
+
+    file=fopen(filename.c_str(),"a+b");
+
+    if (file==NULL) {
+      log.Error() << "Cannot open tile cache file '" << filename << "'";
+      cache.clear();
+      index.clear();
+      tileBytes=0;
+
+      return false;
+    }
+
+    size_t i=0;
+
+    for (auto entry=cache.rbegin(); entry!=cache.rend(); ++entry) {
+      entry->offset=offsets[i];
+      i++;
+    }
+
+    fileSize=offset;
+
+    return true;
+  }
+
+  /**
+   * Change the budget for the tile data. Tiles are evicted immediately.
+   */
+  bool PersistentTileCache::SetByteBudget(size_t byteBudget)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    this->byteBudget=byteBudget;
+
+    if (file==NULL) {
+      return true;
+    }
+
+    return Evict();
+  }
+
+  size_t PersistentTileCache::GetByteBudget() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return byteBudget;
+  }
+
+  /**
+   * Return true, if the tile is in the cache. Does not change the usage order.
+   */
+  bool PersistentTileCache::HasTile(const TileId& id,
+                                    uint64_t styleHash) const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return index.find(GetKey(id,styleHash))!=index.end();
+  }
+
+  /**
+   * Read the data of the given tile from the cache and make it the most recently
+   * used tile. Returns false, if the tile is not in the cache or in case of an error.
+   */
+  bool PersistentTileCache::GetTile(const TileId& id,
+                                    uint64_t styleHash,
+                                    std::string& data)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (file==NULL) {
+      return false;
+    }
+
+    auto existingEntry=index.find(GetKey(id,styleHash));
+
+    if (existingEntry==index.end()) {
+      return false;
+    }
+
+    cache.splice(cache.begin(),cache,existingEntry->second);
+    existingEntry->second=cache.begin();
+
+    return ReadData(*existingEntry->second,
+                    data);
+  }
+
+  /**
+   * Store the data of the given tile in the cache. An existing tile is replaced.
+   * If the budget is exceeded, the least recently used tiles are evicted.
+   */
+  bool PersistentTileCache::PutTile(const TileId& id,
+                                    uint64_t styleHash,
+                                    const std::string& data)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (file==NULL) {
+      log.Error() << "Tile cache is not open";
+      return false;
+    }
+
+    Key        key=GetKey(id,styleHash);
+    FileOffset offset=fileSize+recordHeaderSize;
+
+    if (!AppendRecord(recordTile,
+                      key,
+                      data.data(),
+                      (uint32_t)data.length())) {
+      return false;
+    }
+
+    auto existingEntry=index.find(key);
+
+    if (existingEntry!=index.end()) {
+      tileBytes-=existingEntry->second->size;
+      cache.erase(existingEntry->second);
+      index.erase(existingEntry);
+    }
+
+    CacheEntry entry;
+
+    entry.key=key;
+    entry.offset=offset;
+    entry.size=(uint32_t)data.length();
+
+    cache.push_front(entry);
+    index[key]=cache.begin();
+    tileBytes+=entry.size;
+
+    return Evict();
+  }
+
+  /**
+   * Remove the given tile from the cache
+   */
+  bool PersistentTileCache::RemoveTile(const TileId& id,
+                                       uint64_t styleHash)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (file==NULL) {
+      return false;
+    }
+
+    auto existingEntry=index.find(GetKey(id,styleHash));
+
+    if (existingEntry==index.end()) {
+      return true;
+    }
+
+    return Remove(existingEntry->second);
+  }
+
+  /**
+   * Drop all obsolete data from the file and store the current usage order.
+   */
+  bool PersistentTileCache::Compact()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (file==NULL) {
+      return false;
+    }
+
+    return CompactFile();
+  }
+
+  size_t PersistentTileCache::GetTileCount() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return cache.size();
+  }
+
+  size_t PersistentTileCache::GetTileBytes() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return tileBytes;
+  }
+
+  FileOffset PersistentTileCache::GetFileSize() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return fileSize;
+  }
+
+  /**
+   * Calculate a hash (FNV-1a, 64 bit) of the given data, for example
+   * of the style sheet and the render parameters, for use as style hash.
+   */
+  uint64_t PersistentTileCache::CalculateHash(const std::string& data)
+  {
+    uint64_t hash=14695981039346656037ull;
+
+    for (const auto c : data) {
+      hash^=(unsigned char)c;
+      hash*=1099511628211ull;
+    }
+
+    return hash;
+  }
+}
@@ -191,6 +191,33 @@ namespace osmscout {
     }
   }
 
+  /**
+   * Return the subset of the given features (see FEATURE_BRIDGE,
+   * FEATURE_TUNNEL and FEATURE_ONEWAY) that are set for the object.
+   */
+  uint8_t StyleResolveContext::GetFeatures(const FeatureValueBuffer& buffer,
+                                           uint8_t features) const
+  {
+    uint8_t result=0;
+
+    if ((features & FEATURE_BRIDGE)!=0 &&
+        IsBridge(buffer)) {
+      result|=FEATURE_BRIDGE;
+    }
+
+    if ((features & FEATURE_TUNNEL)!=0 &&
+        IsTunnel(buffer)) {
+      result|=FEATURE_TUNNEL;
+    }
+
+    if ((features & FEATURE_ONEWAY)!=0 &&
+        IsOneway(buffer)) {
+      result|=FEATURE_ONEWAY;
+    }
+
+    return result;
+  }
+
   StyleConstant::StyleConstant()
   {
     // no code
@@ -1561,6 +1588,29 @@ namespace osmscout {
            sizeCondition!=other.sizeCondition;
   }
 
+  /**
+   * Return the features (see StyleResolveContext) an object must have to
+   * match the criteria.
+   */
+  uint8_t StyleCriteria::GetFeatures() const
+  {
+    uint8_t features=0;
+
+    if (bridge) {
+      features|=StyleResolveContext::FEATURE_BRIDGE;
+    }
+
+    if (tunnel) {
+      features|=StyleResolveContext::FEATURE_TUNNEL;
+    }
+
+    if (oneway) {
+      features|=StyleResolveContext::FEATURE_ONEWAY;
+    }
+
+    return features;
+  }
+
   bool StyleCriteria::Matches(double meterInPixel,
                               double meterInMM) const
   {
@@ -1674,6 +1724,8 @@ namespace osmscout {
     areaTypeSets.clear();
 
     constants.clear();
+
+    selectorListData.clear();
   }
 
   bool StyleConfig::RegisterLabelProviderFactory(const std::string& name,
@@ -2192,6 +2244,123 @@ namespace osmscout {
     }
   }
 
+  /**
+   * For each list of selectors with criteria or more than one entry (and at most
+   * MAX_COMPOSED_SELECTORS entries), precompute:
+   * * The bit mask of the selectors matching each combination of object features,
+   *   where bit i is set if the features of the i-th selector of the list match.
+   *   Selectors with a size condition match, if their features match.
+   * * The size conditions of the selectors.
+   * * The style for each combination of matching selectors, given by the bit mask.
+   *   Single matches use the style of the selector (fastpath), for multiple matches
+   *   the style is composed.
+   */
+  template <class S, class A>
+  void PrecomputeSelectorLists(const std::vector<std::vector<std::list<StyleSelector<S,A> > > >& styleSelectors,
+                               StyleConfig::SelectorListDataMap& selectorListData)
+  {
+    for (const auto& typeEntry : styleSelectors) {
+      for (const auto& selectors : typeEntry) {
+        if (selectors.empty() ||
+            selectors.size()>StyleConfig::MAX_COMPOSED_SELECTORS ||
+            (selectors.size()==1 &&
+             !selectors.front().criteria.HasCriteria())) {
+          continue;
+        }
+
+        StyleConfig::SelectorListData& data=selectorListData[&selectors];
+        size_t                         index=0;
+
+        data.features=0;
+        data.featureMatches.assign((size_t)StyleResolveContext::FEATURE_ALL+1,0);
+        data.sizeConditionMask=0;
+        data.sizeConditions.clear();
+        data.styles.assign((size_t)1 << selectors.size(),NULL);
+
+        for (const auto& selector : selectors) {
+          uint8_t features=selector.criteria.GetFeatures();
+
+          data.features|=features;
+
+          for (size_t objectFeatures=0; objectFeatures<data.featureMatches.size(); objectFeatures++) {
+            if ((objectFeatures & features)==features) {
+              data.featureMatches[objectFeatures]|=(size_t)1 << index;
+            }
+          }
+
+          if (selector.criteria.GetSizeCondition()) {
+            data.sizeConditionMask|=(size_t)1 << index;
+          }
+
+          data.sizeConditions.push_back(selector.criteria.GetSizeCondition());
+
+          index++;
+        }
+
+        for (size_t matches=1; matches<data.styles.size(); matches++) {
+          std::shared_ptr<S> style;
+          size_t             matchCount=0;
+
+          index=0;
+
+          for (const auto& selector : selectors) {
+            if ((matches & ((size_t)1 << index))!=0) {
+              if (matchCount==0) {
+                style=selector.style;
+              }
+              else {
+                if (matchCount==1) {
+                  style=std::make_shared<S>(*style);
+                }
+
+                style->CopyAttributes(*selector.style,
+                                      selector.attributes);
+              }
+
+              matchCount++;
+            }
+
+            index++;
+          }
+
+          if (matchCount==1 ||
+              style->IsVisible()) {
+            data.styles[matches]=style;
+          }
+        }
+      }
+    }
+  }
+
+  void StyleConfig::PostprocessSelectorLists()
+  {
+    selectorListData.clear();
+
+    for (const auto& table : nodeTextStyleSelectors) {
+      PrecomputeSelectorLists(table,selectorListData);
+    }
+
+    PrecomputeSelectorLists(nodeIconStyleSelectors,selectorListData);
+
+    for (const auto& table : wayLineStyleSelectors) {
+      PrecomputeSelectorLists(table,selectorListData);
+    }
+
+    PrecomputeSelectorLists(wayPathTextStyleSelectors,selectorListData);
+    PrecomputeSelectorLists(wayPathSymbolStyleSelectors,selectorListData);
+    PrecomputeSelectorLists(wayPathShieldStyleSelectors,selectorListData);
+
+    PrecomputeSelectorLists(areaFillStyleSelectors,selectorListData);
+
+    for (const auto& table : areaTextStyleSelectors) {
+      PrecomputeSelectorLists(table,selectorListData);
+    }
+
+    PrecomputeSelectorLists(areaIconStyleSelectors,selectorListData);
+    PrecomputeSelectorLists(areaBorderTextStyleSelectors,selectorListData);
+    PrecomputeSelectorLists(areaBorderSymbolStyleSelectors,selectorListData);
+  }
+
   void StyleConfig::Postprocess()
   {
     PostprocessNodes();
@@ -2200,6 +2369,8 @@ namespace osmscout {
 
     PostprocessIconId();
     PostprocessPatternId();
+
+    PostprocessSelectorLists();
   }
 
   TypeConfigRef StyleConfig::GetTypeConfig() const
@@ -2332,55 +2503,140 @@ namespace osmscout {
     }
   }
 
+  /**
+   * Features of an object relevant for the style criteria. Each feature is
+   * read on first use only, so all selector lists of an object share the
+   * feature lookups.
+   */
+  class StyleObjectFeatures
+  {
+  private:
+    const StyleResolveContext& context;
+    const FeatureValueBuffer&  buffer;
+    uint8_t                    read;
+    uint8_t                    set;
+
+  public:
+    StyleObjectFeatures(const StyleResolveContext& context,
+                        const FeatureValueBuffer& buffer)
+    : context(context),
+      buffer(buffer),
+      read(0),
+      set(0)
+    {
+      // no code
+    }
+
+    /**
+     * Return the subset of the given features, that are set for the object
+     */
+    inline uint8_t Get(uint8_t features)
+    {
+      uint8_t missing=features & ~read;
+
+      if (missing!=0) {
+        set|=context.GetFeatures(buffer,
+                                 missing);
+        read|=missing;
+      }
+
+      return set & features;
+    }
+  };
+
   /**
    * Get the style data based on the given features of an object,
    * a given style (S) and its style attributes (A).
+   *
+   * For lists of selectors precomputed by StyleConfig::PostprocessSelectorLists()
+   * the matching selectors are taken from the precomputed feature matches, only
+   * the size conditions of these selectors are evaluated. The style is taken from
+   * the precomputed styles using the bit mask of the matching selectors as index.
+   * Only if the list of selectors is too long to be precomputed, the style is
+   * composed on the fly.
    */
   template <class S, class A>
-  void GetFeatureStyle(const StyleResolveContext& context,
+  void GetFeatureStyle(StyleObjectFeatures& features,
                        const std::vector<std::list<StyleSelector<S,A> > >& styleSelectors,
-                       const FeatureValueBuffer& buffer,
                        const Projection& projection,
+                       const StyleConfig::SelectorListDataMap& selectorListData,
                        std::shared_ptr<S>& style)
   {
-    bool   fastpath=false;
-    bool   composed=false;
     size_t level=projection.GetMagnification().GetLevel();
-    double meterInPixel=projection.GetMeterInPixel();
-    double meterInMM=projection.GetMeterInMM();
 
     if (level>=styleSelectors.size()) {
       level=styleSelectors.size()-1;
     }
 
+    const std::list<StyleSelector<S,A> >& selectors=styleSelectors[level];
+
     style=NULL;
 
-    for (const auto& selector : styleSelectors[level]) {
-      if (!selector.criteria.Matches(context,
-                                     buffer,
-                                     meterInPixel,
-                                     meterInMM)) {
-        continue;
+    if (selectors.empty()) {
+      return;
+    }
+
+    // Fastpath, a single selector without criteria
+    if (selectors.size()==1 &&
+        !selectors.front().criteria.HasCriteria()) {
+      style=selectors.front().style;
+
+      return;
+    }
+
+    double meterInPixel=projection.GetMeterInPixel();
+    double meterInMM=projection.GetMeterInMM();
+    auto   entry=selectorListData.find(&selectors);
+
+    if (entry!=selectorListData.end()) {
+      const StyleConfig::SelectorListData& data=entry->second;
+      size_t                               matches=data.featureMatches[features.Get(data.features)];
+      size_t                               conditions=matches & data.sizeConditionMask;
+
+      for (size_t index=0; conditions!=0; index++) {
+        size_t bit=(size_t)1 << index;
+
+        if ((conditions & bit)!=0) {
+          if (!data.sizeConditions[index]->Evaluate(meterInPixel,meterInMM)) {
+            matches&=~bit;
+          }
+
+          conditions&=~bit;
+        }
       }
 
-      if (!style) {
-        style=selector.style;
-        fastpath=true;
+      style=std::static_pointer_cast<S>(data.styles[matches]);
 
+      return;
+    }
+
+    size_t matchCount=0;
+
+    for (const auto& selector : selectors) {
+      uint8_t selectorFeatures=selector.criteria.GetFeatures();
+
+      if (features.Get(selectorFeatures)!=selectorFeatures ||
+          (selector.criteria.GetSizeCondition() &&
+           !selector.criteria.GetSizeCondition()->Evaluate(meterInPixel,meterInMM))) {
         continue;
       }
 
-      if (fastpath) {
-        style=std::make_shared<S>(*style);
-        fastpath=false;
+      if (matchCount==0) {
+        style=selector.style;
+      }
+      else {
+        if (matchCount==1) {
+          style=std::make_shared<S>(*style);
+        }
+
+        style->CopyAttributes(*selector.style,
+                              selector.attributes);
       }
 
-      style->CopyAttributes(*selector.style,
-                            selector.attributes);
-      composed=true;
+      matchCount++;
     }
 
-    if (composed &&
+    if (matchCount>1 &&
         !style->IsVisible()) {
       style=NULL;
     }
@@ -2390,7 +2646,9 @@ namespace osmscout {
                                       const Projection& projection,
                                       std::vector<TextStyleRef>& textStyles) const
   {
-    TextStyleRef style;
+    TextStyleRef        style;
+    size_t              typeIndex=buffer.GetType()->GetIndex();
+    StyleObjectFeatures features(styleResolveContext,buffer);
 
     textStyles.clear();
     textStyles.reserve(nodeTextStyleSelectors.size());
@@ -2398,10 +2656,10 @@ namespace osmscout {
     for (size_t slot=0; slot<nodeTextStyleSelectors.size(); slot++) {
       style=NULL;
 
-      GetFeatureStyle(styleResolveContext,
-                      nodeTextStyleSelectors[slot][buffer.GetType()->GetIndex()],
-                      buffer,
+      GetFeatureStyle(features,
+                      nodeTextStyleSelectors[slot][typeIndex],
                       projection,
+                      selectorListData,
                       style);
 
       if (style) {
@@ -2414,10 +2672,13 @@ namespace osmscout {
                                      const Projection& projection,
                                      IconStyleRef& iconStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    nodeIconStyleSelectors[buffer.GetType()->GetIndex()],
-                    buffer,
+    size_t              typeIndex=buffer.GetType()->GetIndex();
+    StyleObjectFeatures features(styleResolveContext,buffer);
+
+    GetFeatureStyle(features,
+                    nodeIconStyleSelectors[typeIndex],
                     projection,
+                    selectorListData,
                     iconStyle);
   }
 
@@ -2425,7 +2686,9 @@ namespace osmscout {
                                      const Projection& projection,
                                      std::vector<LineStyleRef>& lineStyles) const
   {
-    LineStyleRef style;
+    LineStyleRef        style;
+    size_t              typeIndex=buffer.GetType()->GetIndex();
+    StyleObjectFeatures features(styleResolveContext,buffer);
 
     lineStyles.clear();
     lineStyles.reserve(wayLineStyleSelectors.size());
@@ -2433,10 +2696,10 @@ namespace osmscout {
     for (size_t slot=0; slot<wayLineStyleSelectors.size(); slot++) {
       style=NULL;
 
-      GetFeatureStyle(styleResolveContext,
-                      wayLineStyleSelectors[slot][buffer.GetType()->GetIndex()],
-                      buffer,
+      GetFeatureStyle(features,
+                      wayLineStyleSelectors[slot][typeIndex],
                       projection,
+                      selectorListData,
                       style);
 
       if (style) {
@@ -2449,10 +2712,13 @@ namespace osmscout {
                                         const Projection& projection,
                                         PathTextStyleRef& pathTextStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    wayPathTextStyleSelectors[buffer.GetType()->GetIndex()],
-                    buffer,
+    size_t              typeIndex=buffer.GetType()->GetIndex();
+    StyleObjectFeatures features(styleResolveContext,buffer);
+
+    GetFeatureStyle(features,
+                    wayPathTextStyleSelectors[typeIndex],
                     projection,
+                    selectorListData,
                     pathTextStyle);
   }
 
@@ -2460,10 +2726,13 @@ namespace osmscout {
                                           const Projection& projection,
                                           PathSymbolStyleRef& pathSymbolStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    wayPathSymbolStyleSelectors[buffer.GetType()->GetIndex()],
-                    buffer,
+    size_t              typeIndex=buffer.GetType()->GetIndex();
+    StyleObjectFeatures features(styleResolveContext,buffer);
+
+    GetFeatureStyle(features,
+                    wayPathSymbolStyleSelectors[typeIndex],
                     projection,
+                    selectorListData,
                     pathSymbolStyle);
   }
 
@@ -2471,10 +2740,13 @@ namespace osmscout {
                                           const Projection& projection,
                                           PathShieldStyleRef& pathShieldStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    wayPathShieldStyleSelectors[buffer.GetType()->GetIndex()],
-                    buffer,
+    size_t              typeIndex=buffer.GetType()->GetIndex();
+    StyleObjectFeatures features(styleResolveContext,buffer);
+
+    GetFeatureStyle(features,
+                    wayPathShieldStyleSelectors[typeIndex],
                     projection,
+                    selectorListData,
                     pathShieldStyle);
   }
 
@@ -2483,10 +2755,13 @@ namespace osmscout {
                                      const Projection& projection,
                                      FillStyleRef& fillStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    areaFillStyleSelectors[type->GetIndex()],
-                    buffer,
+    size_t              typeIndex=type->GetIndex();
+    StyleObjectFeatures features(styleResolveContext,buffer);
+
+    GetFeatureStyle(features,
+                    areaFillStyleSelectors[typeIndex],
                     projection,
+                    selectorListData,
                     fillStyle);
   }
 
@@ -2495,7 +2770,9 @@ namespace osmscout {
                                       const Projection& projection,
                                       std::vector<TextStyleRef>& textStyles) const
   {
-    TextStyleRef style;
+    TextStyleRef        style;
+    size_t              typeIndex=type->GetIndex();
+    StyleObjectFeatures features(styleResolveContext,buffer);
 
     textStyles.clear();
     textStyles.reserve(areaTextStyleSelectors.size());
@@ -2503,10 +2780,10 @@ namespace osmscout {
     for (size_t slot=0; slot<areaTextStyleSelectors.size(); slot++) {
       style=NULL;
 
-      GetFeatureStyle(styleResolveContext,
-                      areaTextStyleSelectors[slot][type->GetIndex()],
-                      buffer,
+      GetFeatureStyle(features,
+                      areaTextStyleSelectors[slot][typeIndex],
                       projection,
+                      selectorListData,
                       style);
 
       if (style) {
@@ -2520,10 +2797,13 @@ namespace osmscout {
                                      const Projection& projection,
                                      IconStyleRef& iconStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    areaIconStyleSelectors[type->GetIndex()],
-                    buffer,
+    size_t              typeIndex=type->GetIndex();
+    StyleObjectFeatures features(styleResolveContext,buffer);
+
+    GetFeatureStyle(features,
+                    areaIconStyleSelectors[typeIndex],
                     projection,
+                    selectorListData,
                     iconStyle);
   }
 
@@ -2532,10 +2812,13 @@ namespace osmscout {
                                            const Projection& projection,
                                            PathTextStyleRef& pathTextStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    areaBorderTextStyleSelectors[type->GetIndex()],
-                    buffer,
+    size_t              typeIndex=type->GetIndex();
+    StyleObjectFeatures features(styleResolveContext,buffer);
+
+    GetFeatureStyle(features,
+                    areaBorderTextStyleSelectors[typeIndex],
                     projection,
+                    selectorListData,
                     pathTextStyle);
   }
 
@@ -2544,61 +2827,79 @@ namespace osmscout {
                                              const Projection& projection,
                                              PathSymbolStyleRef& pathSymbolStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    areaBorderSymbolStyleSelectors[type->GetIndex()],
-                    buffer,
+    size_t              typeIndex=type->GetIndex();
+    StyleObjectFeatures features(styleResolveContext,buffer);
+
+    GetFeatureStyle(features,
+                    areaBorderSymbolStyleSelectors[typeIndex],
                     projection,
+                    selectorListData,
                     pathSymbolStyle);
   }
 
   void StyleConfig::GetLandFillStyle(const Projection& projection,
                                      FillStyleRef& fillStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    areaFillStyleSelectors[tileLandBuffer.GetType()->GetIndex()],
-                    tileLandBuffer,
+    size_t              typeIndex=tileLandBuffer.GetType()->GetIndex();
+    StyleObjectFeatures features(styleResolveContext,tileLandBuffer);
+
+    GetFeatureStyle(features,
+                    areaFillStyleSelectors[typeIndex],
                     projection,
+                    selectorListData,
                     fillStyle);
   }
 
   void StyleConfig::GetSeaFillStyle(const Projection& projection,
                                     FillStyleRef& fillStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    areaFillStyleSelectors[tileSeaBuffer.GetType()->GetIndex()],
-                    tileSeaBuffer,
+    size_t              typeIndex=tileSeaBuffer.GetType()->GetIndex();
+    StyleObjectFeatures features(styleResolveContext,tileSeaBuffer);
+
+    GetFeatureStyle(features,
+                    areaFillStyleSelectors[typeIndex],
                     projection,
+                    selectorListData,
                     fillStyle);
   }
 
   void StyleConfig::GetCoastFillStyle(const Projection& projection,
                                       FillStyleRef& fillStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    areaFillStyleSelectors[tileCoastBuffer.GetType()->GetIndex()],
-                    tileCoastBuffer,
+    size_t              typeIndex=tileCoastBuffer.GetType()->GetIndex();
+    StyleObjectFeatures features(styleResolveContext,tileCoastBuffer);
+
+    GetFeatureStyle(features,
+                    areaFillStyleSelectors[typeIndex],
                     projection,
+                    selectorListData,
                     fillStyle);
   }
 
   void StyleConfig::GetUnknownFillStyle(const Projection& projection,
                                         FillStyleRef& fillStyle) const
   {
-    GetFeatureStyle(styleResolveContext,
-                    areaFillStyleSelectors[tileUnknownBuffer.GetType()->GetIndex()],
-                    tileUnknownBuffer,
+    size_t              typeIndex=tileUnknownBuffer.GetType()->GetIndex();
+    StyleObjectFeatures features(styleResolveContext,tileUnknownBuffer);
+
+    GetFeatureStyle(features,
+                    areaFillStyleSelectors[typeIndex],
                     projection,
+                    selectorListData,
                     fillStyle);
   }
 
   void StyleConfig::GetCoastlineLineStyle(const Projection& projection,
                                           LineStyleRef& lineStyle) const
   {
+    size_t              typeIndex=coastlineBuffer.GetType()->GetIndex();
+    StyleObjectFeatures features(styleResolveContext,coastlineBuffer);
+
     for (size_t slot=0; slot<wayLineStyleSelectors.size(); slot++) {
-      GetFeatureStyle(styleResolveContext,
-                      wayLineStyleSelectors[slot][coastlineBuffer.GetType()->GetIndex()],
-                      coastlineBuffer,
+      GetFeatureStyle(features,
+                      wayLineStyleSelectors[slot][typeIndex],
                       projection,
+                      selectorListData,
                       lineStyle);
 
       if (lineStyle) {
@@ -2610,11 +2911,14 @@ namespace osmscout {
   void StyleConfig::GetOSMTileBorderLineStyle(const Projection& projection,
                                               LineStyleRef& lineStyle) const
   {
+    size_t              typeIndex=osmTileBorderBuffer.GetType()->GetIndex();
+    StyleObjectFeatures features(styleResolveContext,osmTileBorderBuffer);
+
     for (size_t slot=0; slot<wayLineStyleSelectors.size(); slot++) {
-      GetFeatureStyle(styleResolveContext,
-                      wayLineStyleSelectors[slot][osmTileBorderBuffer.GetType()->GetIndex()],
-                      osmTileBorderBuffer,
+      GetFeatureStyle(features,
+                      wayLineStyleSelectors[slot][typeIndex],
                       projection,
+                      selectorListData,
                       lineStyle);
 
       if (lineStyle) {
@@ -2626,11 +2930,14 @@ namespace osmscout {
   void StyleConfig::GetOSMSubTileBorderLineStyle(const Projection& projection,
                                                  LineStyleRef& lineStyle) const
   {
+    size_t              typeIndex=osmSubTileBorderBuffer.GetType()->GetIndex();
+    StyleObjectFeatures features(styleResolveContext,osmSubTileBorderBuffer);
+
     for (size_t slot=0; slot<wayLineStyleSelectors.size(); slot++) {
-      GetFeatureStyle(styleResolveContext,
-                      wayLineStyleSelectors[slot][osmSubTileBorderBuffer.GetType()->GetIndex()],
-                      osmSubTileBorderBuffer,
+      GetFeatureStyle(features,
+                      wayLineStyleSelectors[slot][typeIndex],
                       projection,
+                      selectorListData,
                       lineStyle);
 
       if (lineStyle) {
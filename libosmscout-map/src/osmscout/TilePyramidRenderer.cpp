@@ -0,0 +1,487 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/TilePyramidRenderer.h>
+
+#include <algorithm>
+#include <thread>
+
+#include <osmscout/system/Math.h>
+
+#include <osmscout/util/Logger.h>
+#include <osmscout/util/Tiling.h>
+
+namespace osmscout {
+
+  TilePyramidRendererParameter::TilePyramidRendererParameter()
+  : threadCount(std::max(1u,std::thread::hardware_concurrency())),
+    tileWidth(256),
+    tileHeight(256),
+    dpi(96.0),
+    dataMargin(1),
+    blockSize(8),
+    queueSize(16),
+    metaTileSize(1),
+    metaTileMargin(0)
+  {
+    // no code
+  }
+
+  void TilePyramidRendererParameter::SetThreadCount(size_t threadCount)
+  {
+    this->threadCount=threadCount;
+  }
+
+  void TilePyramidRendererParameter::SetTileWidth(size_t tileWidth)
+  {
+    this->tileWidth=tileWidth;
+  }
+
+  void TilePyramidRendererParameter::SetTileHeight(size_t tileHeight)
+  {
+    this->tileHeight=tileHeight;
+  }
+
+  void TilePyramidRendererParameter::SetDPI(double dpi)
+  {
+    this->dpi=dpi;
+  }
+
+  void TilePyramidRendererParameter::SetDataMargin(size_t dataMargin)
+  {
+    this->dataMargin=dataMargin;
+  }
+
+  void TilePyramidRendererParameter::SetBlockSize(size_t blockSize)
+  {
+    this->blockSize=blockSize;
+  }
+
+  void TilePyramidRendererParameter::SetQueueSize(size_t queueSize)
+  {
+    this->queueSize=queueSize;
+  }
+
+  void TilePyramidRendererParameter::SetMetaTileSize(size_t metaTileSize)
+  {
+    this->metaTileSize=metaTileSize;
+  }
+
+  void TilePyramidRendererParameter::SetMetaTileMargin(size_t metaTileMargin)
+  {
+    this->metaTileMargin=metaTileMargin;
+  }
+
+  size_t TilePyramidRendererParameter::GetThreadCount() const
+  {
+    return threadCount;
+  }
+
+  size_t TilePyramidRendererParameter::GetTileWidth() const
+  {
+    return tileWidth;
+  }
+
+  size_t TilePyramidRendererParameter::GetTileHeight() const
+  {
+    return tileHeight;
+  }
+
+  double TilePyramidRendererParameter::GetDPI() const
+  {
+    return dpi;
+  }
+
+  size_t TilePyramidRendererParameter::GetDataMargin() const
+  {
+    return dataMargin;
+  }
+
+  size_t TilePyramidRendererParameter::GetBlockSize() const
+  {
+    return blockSize;
+  }
+
+  size_t TilePyramidRendererParameter::GetQueueSize() const
+  {
+    return queueSize;
+  }
+
+  size_t TilePyramidRendererParameter::GetMetaTileSize() const
+  {
+    return metaTileSize;
+  }
+
+  size_t TilePyramidRendererParameter::GetMetaTileMargin() const
+  {
+    return metaTileMargin;
+  }
+
+  TilePyramidWorker::~TilePyramidWorker()
+  {
+    // no code
+  }
+
+  /**
+   * Render the given meta tile and slice it into the individual tiles.
+   *
+   * The default implementation renders each tile of the meta tile on its own
+   * using RenderTile(). Backends should overwrite this method to render
+   * the meta tile in one pass.
+   *
+   * @param metaTile
+   *    The meta tile
+   * @param data
+   *    Map data of the meta tile and its neighbouring tiles
+   * @return
+   *    False, if there was an error, else true.
+   */
+  bool TilePyramidWorker::RenderMetaTile(const MetaTile& metaTile,
+                                         const MapData& data)
+  {
+    for (size_t y=metaTile.yStart; y<metaTile.yStart+metaTile.yCount; y++) {
+      for (size_t x=metaTile.xStart; x<metaTile.xStart+metaTile.xCount; x++) {
+        TileProjection projection;
+
+        projection.Set(x,y,
+                       metaTile.projection.GetMagnification(),
+                       metaTile.projection.GetDPI(),
+                       metaTile.tileWidth,
+                       metaTile.tileHeight);
+
+        if (!RenderTile(projection,x,y,data)) {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Longitude of the given (fractional) tile x coordinate
+   */
+  static double FractionalTileXToLon(double x,
+                                     const Magnification& magnification)
+  {
+    return x/magnification.GetMagnification()*360.0-180.0;
+  }
+
+  /**
+   * Latitude of the given (fractional) tile y coordinate
+   */
+  static double FractionalTileYToLat(double y,
+                                     const Magnification& magnification)
+  {
+    return atan(sinh(M_PI-2.0*M_PI*y/magnification.GetMagnification()))*180.0/M_PI;
+  }
+
+  template<class O>
+  static void SortByFileOffset(std::vector<O>& objects)
+  {
+    std::stable_sort(objects.begin(),
+                     objects.end(),
+                     [](const O& a, const O& b) {
+                       return a->GetFileOffset()<b->GetFileOffset();
+                     });
+  }
+
+  TilePyramidRenderer::TilePyramidRenderer(const MapServiceRef& mapService,
+                                           const StyleConfigRef& styleConfig,
+                                           const TilePyramidRendererParameter& parameter)
+  : mapService(mapService),
+    styleConfig(styleConfig),
+    threadCount(std::max((size_t)1,parameter.GetThreadCount())),
+    tileWidth(parameter.GetTileWidth()),
+    tileHeight(parameter.GetTileHeight()),
+    dpi(parameter.GetDPI()),
+    dataMargin(parameter.GetDataMargin()),
+    blockSize(std::max((size_t)1,parameter.GetBlockSize())),
+    queueSize(std::max((size_t)1,parameter.GetQueueSize())),
+    metaTileSize(std::max((size_t)1,parameter.GetMetaTileSize())),
+    metaTileMargin(parameter.GetMetaTileMargin())
+  {
+    // no code
+  }
+
+  TilePyramidRenderer::~TilePyramidRenderer()
+  {
+    // no code
+  }
+
+  /**
+   * Return true, if the filter returns true for at least one tile of the meta tile.
+   * The filter is called for all tiles.
+   */
+  bool TilePyramidRenderer::IsRenderRequired(const MetaTile& metaTile,
+                                             const Magnification& magnification,
+                                             const TilePyramidTileFilter& tileFilter)
+  {
+    bool required=false;
+
+    for (size_t y=metaTile.yStart; y<metaTile.yStart+metaTile.yCount; y++) {
+      for (size_t x=metaTile.xStart; x<metaTile.xStart+metaTile.xCount; x++) {
+        if (tileFilter(magnification,x,y)) {
+          required=true;
+        }
+      }
+    }
+
+    return required;
+  }
+
+  void TilePyramidRenderer::WorkerLoop(WorkQueue<JobRef>& queue,
+                                       TilePyramidWorker& worker,
+                                       std::atomic<bool>& success) const
+  {
+    std::packaged_task<JobRef()> task;
+
+    while (queue.PopTask(task)) {
+      std::future<JobRef> result=task.get_future();
+
+      // Converts the loaded tile data to map data in the context of this thread
+      task();
+
+      JobRef job=result.get();
+
+      if (!success) {
+        // Drain the queue, so that the loading thread does not block
+        continue;
+      }
+
+      const MetaTile& metaTile=job->metaTile;
+      bool            rendered;
+
+      if (metaTileSize==1 &&
+          metaTileMargin==0) {
+        rendered=worker.RenderTile(metaTile.projection,
+                                   metaTile.xStart,
+                                   metaTile.yStart,
+                                   job->data);
+      }
+      else {
+        rendered=worker.RenderMetaTile(metaTile,
+                                       job->data);
+      }
+
+      if (!rendered) {
+        log.Error() << "Cannot render tile " << metaTile.projection.GetMagnification().GetLevel() << "." << metaTile.yStart << "." << metaTile.xStart;
+        success=false;
+      }
+    }
+  }
+
+  /**
+   * Render all tiles of the given magnification covering the given bounding box.
+   *
+   * @param boundingBox
+   *    Area to render
+   * @param magnification
+   *    Magnification (zoom level) of the tiles
+   * @param searchParameter
+   *    Parameter for loading the data of the tiles
+   * @param workerFactory
+   *    Factory for the backend specific worker of each render thread
+   * @param tileFilter
+   *    Optional filter, returning false for tiles, that do not need to be rendered
+   * @return
+   *    False, if there was an error loading or rendering a tile, else true.
+   */
+  bool TilePyramidRenderer::RenderTiles(const GeoBox& boundingBox,
+                                        const Magnification& magnification,
+                                        const AreaSearchParameter& searchParameter,
+                                        const TilePyramidWorkerFactory& workerFactory,
+                                        const TilePyramidTileFilter& tileFilter) const
+  {
+    size_t xTileStart=LonToTileX(boundingBox.GetMinLon(),magnification);
+    size_t xTileEnd=LonToTileX(boundingBox.GetMaxLon(),magnification);
+    size_t yTileStart=LatToTileY(boundingBox.GetMaxLat(),magnification);
+    size_t yTileEnd=LatToTileY(boundingBox.GetMinLat(),magnification);
+
+    std::vector<TilePyramidWorkerRef> workers;
+
+    workers.reserve(threadCount);
+
+    for (size_t i=0; i<threadCount; i++) {
+      TilePyramidWorkerRef worker=workerFactory();
+
+      if (!worker) {
+        log.Error() << "Cannot create tile render worker";
+        return false;
+      }
+
+      workers.push_back(worker);
+    }
+
+    WorkQueue<JobRef>        queue(queueSize);
+    std::atomic<bool>        success(true);
+    std::vector<std::thread> threads;
+
+    threads.reserve(threadCount);
+
+    for (const auto& worker : workers) {
+      threads.push_back(std::thread(&TilePyramidRenderer::WorkerLoop,
+                                    this,
+                                    std::ref(queue),
+                                    std::ref(*worker),
+                                    std::ref(success)));
+    }
+
+    // Margin in tiles, that is required to cover the meta tile margin
+    size_t marginTiles=std::max(dataMargin,
+                                std::max((metaTileMargin+tileWidth-1)/tileWidth,
+                                         (metaTileMargin+tileHeight-1)/tileHeight));
+
+    // Highest tile coordinate of the level
+    size_t maxTile=(size_t)magnification.GetMagnification()-1;
+
+    // Meta tiles are aligned to multiples of the meta tile size (a meta tile size of one
+    // results in single tiles) and are loaded in blocks, so that neighbouring meta tiles
+    // can reuse the cached data tiles
+    size_t xMetaStart=xTileStart/metaTileSize;
+    size_t xMetaEnd=xTileEnd/metaTileSize;
+    size_t yMetaStart=yTileStart/metaTileSize;
+    size_t yMetaEnd=yTileEnd/metaTileSize;
+
+    for (size_t yBlock=yMetaStart; yBlock<=yMetaEnd && success; yBlock+=blockSize) {
+      for (size_t xBlock=xMetaStart; xBlock<=xMetaEnd && success; xBlock+=blockSize) {
+        for (size_t yMeta=yBlock; yMeta<=std::min(yBlock+blockSize-1,yMetaEnd) && success; yMeta++) {
+          for (size_t xMeta=xBlock; xMeta<=std::min(xBlock+blockSize-1,xMetaEnd) && success; xMeta++) {
+            JobRef             job=std::make_shared<Job>();
+            MetaTile&          metaTile=job->metaTile;
+            std::list<TileRef> tiles;
+
+            metaTile.xStart=std::max(xMeta*metaTileSize,xTileStart);
+            metaTile.yStart=std::max(yMeta*metaTileSize,yTileStart);
+            metaTile.xCount=std::min((xMeta+1)*metaTileSize-1,xTileEnd)-metaTile.xStart+1;
+            metaTile.yCount=std::min((yMeta+1)*metaTileSize-1,yTileEnd)-metaTile.yStart+1;
+            metaTile.tileWidth=tileWidth;
+            metaTile.tileHeight=tileHeight;
+            metaTile.margin=metaTileMargin;
+
+            if (tileFilter &&
+                !IsRenderRequired(metaTile,magnification,tileFilter)) {
+              continue;
+            }
+
+            if (metaTileMargin==0) {
+              metaTile.projection.Set(metaTile.xStart,
+                                      metaTile.yStart,
+                                      metaTile.xStart+metaTile.xCount-1,
+                                      metaTile.yStart+metaTile.yCount-1,
+                                      magnification,
+                                      dpi,
+                                      metaTile.xCount*tileWidth,
+                                      metaTile.yCount*tileHeight);
+            }
+            else {
+              double xMargin=metaTileMargin/(double)tileWidth;
+              double yMargin=metaTileMargin/(double)tileHeight;
+
+              metaTile.projection.SetInternal(FractionalTileXToLon(metaTile.xStart-xMargin,magnification),
+                                              FractionalTileYToLat(metaTile.yStart+metaTile.yCount+yMargin,magnification),
+                                              FractionalTileXToLon(metaTile.xStart+metaTile.xCount+xMargin,magnification),
+                                              FractionalTileYToLat(metaTile.yStart-yMargin,magnification),
+                                              magnification,
+                                              dpi,
+                                              metaTile.xCount*tileWidth+2*metaTileMargin,
+                                              metaTile.yCount*tileHeight+2*metaTileMargin);
+            }
+
+            // The margin must not exceed the tiles of the level for meta tiles at the border of the map
+            size_t xDataStart=metaTile.xStart-std::min(metaTile.xStart,marginTiles);
+            size_t xDataEnd=std::min(metaTile.xStart+metaTile.xCount-1+marginTiles,maxTile);
+            size_t yDataStart=metaTile.yStart-std::min(metaTile.yStart,marginTiles);
+            size_t yDataEnd=std::min(metaTile.yStart+metaTile.yCount-1+marginTiles,maxTile);
+
+            GeoBox dataBoundingBox(GeoCoord(TileYToLat((int)(yDataEnd+1),magnification),
+                                            TileXToLon((int)xDataStart,magnification)),
+                                   GeoCoord(TileYToLat((int)yDataStart,magnification),
+                                            TileXToLon((int)(xDataEnd+1),magnification)));
+
+            mapService->LookupTiles(magnification,
+                                    dataBoundingBox,
+                                    tiles);
+
+            if (!mapService->LoadMissingTileData(searchParameter,
+                                                 *styleConfig,
+                                                 tiles)) {
+              log.Error() << "Cannot load data of tile " << magnification.GetLevel() << "." << metaTile.yStart << "." << metaTile.xStart;
+              success=false;
+              break;
+            }
+
+            // The tiles hold a reference to the data, even if the cache drops them
+            std::packaged_task<JobRef()> task([this,job,tiles]() mutable {
+              mapService->ConvertTilesToMapData(tiles,
+                                                job->data);
+
+              SortByFileOffset(job->data.nodes);
+              SortByFileOffset(job->data.ways);
+              SortByFileOffset(job->data.areas);
+
+              return job;
+            });
+
+            queue.PushTask(task);
+          }
+        }
+      }
+    }
+
+    queue.Stop();
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    return success;
+  }
+
+  /**
+   * Render all tiles of the given zoom levels covering the given bounding box.
+   *
+   * The levels are rendered one after another, starting with the lowest level.
+   */
+  bool TilePyramidRenderer::RenderPyramid(const GeoBox& boundingBox,
+                                          size_t startLevel,
+                                          size_t endLevel,
+                                          const AreaSearchParameter& searchParameter,
+                                          const TilePyramidWorkerFactory& workerFactory,
+                                          const TilePyramidTileFilter& tileFilter) const
+  {
+    for (size_t level=std::min(startLevel,endLevel);
+         level<=std::max(startLevel,endLevel);
+         level++) {
+      Magnification magnification;
+
+      magnification.SetLevel(level);
+
+      if (!RenderTiles(boundingBox,
+                       magnification,
+                       searchParameter,
+                       workerFactory,
+                       tileFilter)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+}
@@ -0,0 +1,786 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/VectorTileEncoder.h>
+
+#include <algorithm>
+#include <unordered_map>
+
+#include <osmscout/system/Math.h>
+
+#include <osmscout/util/Logger.h>
+
+namespace osmscout {
+
+  /**
+   * Field numbers and constants of the vector tile protobuf schema
+   */
+  static const uint32_t tileLayers         = 3;
+
+  static const uint32_t layerName          = 1;
+  static const uint32_t layerFeatures      = 2;
+  static const uint32_t layerKeys          = 3;
+  static const uint32_t layerValues        = 4;
+  static const uint32_t layerExtent        = 5;
+  static const uint32_t layerVersion       = 15;
+
+  static const uint32_t valueString        = 1;
+  static const uint32_t valueSInt          = 6;
+
+  static const uint32_t featureId          = 1;
+  static const uint32_t featureTags        = 2;
+  static const uint32_t featureType        = 3;
+  static const uint32_t featureGeometry    = 4;
+
+  static const uint32_t geomTypePoint      = 1;
+  static const uint32_t geomTypeLineString = 2;
+  static const uint32_t geomTypePolygon    = 3;
+
+  static const uint32_t commandMoveTo      = 1;
+  static const uint32_t commandLineTo      = 2;
+  static const uint32_t commandClosePath   = 7;
+
+  static const uint32_t wireTypeVarint     = 0;
+  static const uint32_t wireTypeBytes      = 2;
+
+  static const uint32_t tileVersion        = 2;
+
+  /**
+   * Data of one layer of the tile
+   */
+  struct VectorTileEncoder::Layer
+  {
+    std::string                               features;     //!< Encoded features
+    size_t                                    featureCount;
+    std::vector<std::string>                  keys;
+    std::unordered_map<std::string,uint32_t>  keyIndex;
+    std::vector<std::string>                  values;       //!< Encoded values
+    std::unordered_map<std::string,uint32_t>  valueIndex;
+
+    Layer()
+    : featureCount(0)
+    {
+      // no code
+    }
+
+    uint32_t GetKey(const std::string& key)
+    {
+      auto entry=keyIndex.find(key);
+
+      if (entry!=keyIndex.end()) {
+        return entry->second;
+      }
+
+      uint32_t index=(uint32_t)keys.size();
+
+      keys.push_back(key);
+      keyIndex[key]=index;
+
+      return index;
+    }
+
+    uint32_t GetValue(const std::string& value)
+    {
+      auto entry=valueIndex.find(value);
+
+      if (entry!=valueIndex.end()) {
+        return entry->second;
+      }
+
+      uint32_t index=(uint32_t)values.size();
+
+      values.push_back(value);
+      valueIndex[value]=index;
+
+      return index;
+    }
+  };
+
+  static void WriteVarint(std::string& buffer,
+                          uint64_t value)
+  {
+    while (value>=0x80) {
+      buffer.push_back((char)((value & 0x7f) | 0x80));
+      value>>=7;
+    }
+
+    buffer.push_back((char)value);
+  }
+
+  static void WriteKey(std::string& buffer,
+                       uint32_t field,
+                       uint32_t wireType)
+  {
+    WriteVarint(buffer,(field << 3) | wireType);
+  }
+
+  static void WriteVarintField(std::string& buffer,
+                               uint32_t field,
+                               uint64_t value)
+  {
+    WriteKey(buffer,field,wireTypeVarint);
+    WriteVarint(buffer,value);
+  }
+
+  static void WriteBytesField(std::string& buffer,
+                              uint32_t field,
+                              const std::string& value)
+  {
+    WriteKey(buffer,field,wireTypeBytes);
+    WriteVarint(buffer,value.length());
+    buffer.append(value);
+  }
+
+  static void WritePackedField(std::string& buffer,
+                               uint32_t field,
+                               const std::vector<uint32_t>& values)
+  {
+    std::string packed;
+
+    for (const auto value : values) {
+      WriteVarint(packed,value);
+    }
+
+    WriteBytesField(buffer,field,packed);
+  }
+
+  static inline uint32_t ZigZag(int32_t value)
+  {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+  }
+
+  static inline uint32_t Command(uint32_t command,
+                                 size_t count)
+  {
+    return command | ((uint32_t)count << 3);
+  }
+
+  /**
+   * Append the commands for the given line to the geometry. The cursor is
+   * moved to the last point of the line.
+   */
+  static void AppendLine(const std::vector<VectorTileEncoder::TilePoint>& line,
+                         bool closed,
+                         int32_t& cursorX,
+                         int32_t& cursorY,
+                         std::vector<uint32_t>& geometry)
+  {
+    geometry.push_back(Command(commandMoveTo,1));
+    geometry.push_back(ZigZag(line[0].x-cursorX));
+    geometry.push_back(ZigZag(line[0].y-cursorY));
+
+    geometry.push_back(Command(commandLineTo,line.size()-1));
+
+    for (size_t i=1; i<line.size(); i++) {
+      geometry.push_back(ZigZag(line[i].x-line[i-1].x));
+      geometry.push_back(ZigZag(line[i].y-line[i-1].y));
+    }
+
+    if (closed) {
+      geometry.push_back(Command(commandClosePath,1));
+    }
+
+    cursorX=line.back().x;
+    cursorY=line.back().y;
+  }
+
+  static void AppendFeature(VectorTileEncoder::Layer& layer,
+                            FileOffset id,
+                            const std::vector<uint32_t>& tags,
+                            uint32_t type,
+                            const std::vector<uint32_t>& geometry)
+  {
+    std::string feature;
+
+    WriteVarintField(feature,featureId,id);
+
+    if (!tags.empty()) {
+      WritePackedField(feature,featureTags,tags);
+    }
+
+    WriteVarintField(feature,featureType,type);
+    WritePackedField(feature,featureGeometry,geometry);
+
+    WriteBytesField(layer.features,layerFeatures,feature);
+    layer.featureCount++;
+  }
+
+  /**
+   * Append the point to the quantized line, if it differs from the last point
+   */
+  static inline void AddTilePoint(std::vector<VectorTileEncoder::TilePoint>& line,
+                                  double x,
+                                  double y)
+  {
+    VectorTileEncoder::TilePoint point;
+
+    point.x=(int32_t)lround(x);
+    point.y=(int32_t)lround(y);
+
+    if (line.empty() ||
+        line.back()!=point) {
+      line.push_back(point);
+    }
+  }
+
+  VectorTileEncoder::VectorTileEncoder(const TypeConfigRef& typeConfig)
+  : typeConfig(typeConfig),
+    extent(4096),
+    buffer(64),
+    optimizeMethod(TransPolygon::quality),
+    optimizeErrorTolerance(1.0),
+    nameReader(*typeConfig),
+    refReader(*typeConfig),
+    layerReader(*typeConfig)
+  {
+    // no code
+  }
+
+  VectorTileEncoder::~VectorTileEncoder()
+  {
+    // no code
+  }
+
+  /**
+   * Set the size of the tile in tile coordinates (default: 4096)
+   */
+  void VectorTileEncoder::SetExtent(uint32_t extent)
+  {
+    this->extent=extent;
+  }
+
+  /**
+   * Set the size of the buffer around the tile in tile coordinates (default: 64).
+   * Geometries are clipped to the tile including the buffer, so that lines
+   * and borders at the tile border are drawn seamlessly.
+   */
+  void VectorTileEncoder::SetBuffer(uint32_t buffer)
+  {
+    this->buffer=buffer;
+  }
+
+  /**
+   * Set the method used to simplify ways and areas (default: quality)
+   */
+  void VectorTileEncoder::SetOptimizeMethod(TransPolygon::OptimizeMethod optimizeMethod)
+  {
+    this->optimizeMethod=optimizeMethod;
+  }
+
+  /**
+   * Set the error tolerance of the simplification in tile coordinates (default: 1.0)
+   */
+  void VectorTileEncoder::SetOptimizeErrorTolerance(double optimizeErrorTolerance)
+  {
+    this->optimizeErrorTolerance=optimizeErrorTolerance;
+  }
+
+  /**
+   * Clip the drawn points of the polygon as a line against the tile including
+   * the buffer (Liang-Barsky). Since the line may leave and enter the tile
+   * multiple times, it may result in multiple lines.
+   */
+  void VectorTileEncoder::ClipLine(const TransPolygon& polygon,
+                                   std::vector<TileLine>& lines) const
+  {
+    double   min=-(double)buffer;
+    double   max=(double)extent+(double)buffer;
+    TileLine line;
+    size_t   last=polygon.GetStart();
+
+    for (size_t i=polygon.GetStart()+1; i<=polygon.GetEnd(); i++) {
+      if (!polygon.points[i].draw) {
+        continue;
+      }
+
+      double x0=polygon.points[last].x;
+      double y0=polygon.points[last].y;
+      double dx=polygon.points[i].x-x0;
+      double dy=polygon.points[i].y-y0;
+      double p[4]={-dx,dx,-dy,dy};
+      double q[4]={x0-min,max-x0,y0-min,max-y0};
+      double t0=0.0;
+      double t1=1.0;
+      bool   visible=true;
+
+      last=i;
+
+      for (size_t edge=0; edge<4; edge++) {
+        if (p[edge]==0.0) {
+          if (q[edge]<0.0) {
+            visible=false;
+            break;
+          }
+        }
+        else {
+          double t=q[edge]/p[edge];
+
+          if (p[edge]<0.0) {
+            t0=std::max(t0,t);
+          }
+          else {
+            t1=std::min(t1,t);
+          }
+        }
+      }
+
+      if (!visible ||
+          t0>t1) {
+        continue;
+      }
+
+      if (t0>0.0 &&
+          line.size()>=2) {
+        // The line enters the tile again
+        lines.push_back(line);
+        line.clear();
+      }
+      else if (t0>0.0) {
+        line.clear();
+      }
+
+      AddTilePoint(line,x0+t0*dx,y0+t0*dy);
+      AddTilePoint(line,x0+t1*dx,y0+t1*dy);
+
+      if (t1<1.0) {
+        // The line leaves the tile
+        if (line.size()>=2) {
+          lines.push_back(line);
+        }
+
+        line.clear();
+      }
+    }
+
+    if (line.size()>=2) {
+      lines.push_back(line);
+    }
+  }
+
+  /**
+   * Clip the drawn points of the polygon as a ring against the tile including
+   * the buffer (Sutherland-Hodgman) and quantize it. The winding order
+   * is adapted to the requirements of the vector tile specification (outer rings
+   * have a positive area in tile coordinates, inner rings a negative).
+   *
+   * Return false, if nothing of the ring is left.
+   */
+  bool VectorTileEncoder::ClipRing(const TransPolygon& polygon,
+                                   bool outer,
+                                   TileLine& ring) const
+  {
+    struct Coord
+    {
+      double x;
+      double y;
+    };
+
+    double             min=-(double)buffer;
+    double             max=(double)extent+(double)buffer;
+    std::vector<Coord> input;
+    std::vector<Coord> output;
+
+    for (size_t i=polygon.GetStart(); i<=polygon.GetEnd(); i++) {
+      if (polygon.points[i].draw) {
+        output.push_back(Coord{polygon.points[i].x,polygon.points[i].y});
+      }
+    }
+
+    for (size_t edge=0; edge<4 && !output.empty(); edge++) {
+      std::swap(input,output);
+      output.clear();
+
+      // Signed distance to the edge, positive for points inside
+      auto distance=[edge,min,max](const Coord& coord) {
+        switch (edge) {
+        case 0:
+          return coord.x-min;
+        case 1:
+          return max-coord.x;
+        case 2:
+          return coord.y-min;
+        default:
+          return max-coord.y;
+        }
+      };
+
+      Coord  previous=input.back();
+      double previousDistance=distance(previous);
+
+      for (const auto& current : input) {
+        double currentDistance=distance(current);
+
+        if ((currentDistance>=0.0)!=(previousDistance>=0.0)) {
+          double t=previousDistance/(previousDistance-currentDistance);
+
+          output.push_back(Coord{previous.x+t*(current.x-previous.x),
+                                 previous.y+t*(current.y-previous.y)});
+        }
+
+        if (currentDistance>=0.0) {
+          output.push_back(current);
+        }
+
+        previous=current;
+        previousDistance=currentDistance;
+      }
+    }
+
+    ring.clear();
+
+    for (const auto& coord : output) {
+      AddTilePoint(ring,coord.x,coord.y);
+    }
+
+    // The ring is closed implicitly
+    while (ring.size()>1 &&
+           ring.front()==ring.back()) {
+      ring.pop_back();
+    }
+
+    if (ring.size()<3) {
+      return false;
+    }
+
+    int64_t area=0;
+
+    for (size_t i=0; i<ring.size(); i++) {
+      const TilePoint& a=ring[i];
+      const TilePoint& b=ring[(i+1)%ring.size()];
+
+      area+=(int64_t)a.x*b.y-(int64_t)b.x*a.y;
+    }
+
+    if (area==0) {
+      return false;
+    }
+
+    if ((area>0)!=outer) {
+      std::reverse(ring.begin(),ring.end());
+    }
+
+    return true;
+  }
+
+  void VectorTileEncoder::AddAttributes(Layer& layer,
+                                        const FeatureValueBuffer& buffer,
+                                        std::vector<uint32_t>& tags) const
+  {
+    NameFeatureValue  *nameValue=nameReader.GetValue(buffer);
+    RefFeatureValue   *refValue=refReader.GetValue(buffer);
+    LayerFeatureValue *layerValue=layerReader.GetValue(buffer);
+    std::string       value;
+
+    tags.clear();
+
+    if (nameValue!=NULL) {
+      value.clear();
+      WriteBytesField(value,valueString,nameValue->GetName());
+
+      tags.push_back(layer.GetKey("name"));
+      tags.push_back(layer.GetValue(value));
+    }
+
+    if (refValue!=NULL) {
+      value.clear();
+      WriteBytesField(value,valueString,refValue->GetRef());
+
+      tags.push_back(layer.GetKey("ref"));
+      tags.push_back(layer.GetValue(value));
+    }
+
+    if (layerValue!=NULL &&
+        layerValue->GetLayer()!=0) {
+      value.clear();
+      WriteVarintField(value,valueSInt,ZigZag(layerValue->GetLayer()));
+
+      tags.push_back(layer.GetKey("layer"));
+      tags.push_back(layer.GetValue(value));
+    }
+  }
+
+  void VectorTileEncoder::EncodeNodes(const TileProjection& projection,
+                                      const MapData& data,
+                                      std::vector<Layer>& layers) const
+  {
+    double                min=-(double)buffer;
+    double                max=(double)extent+(double)buffer;
+    std::vector<uint32_t> tags;
+    std::vector<uint32_t> geometry;
+
+    for (const auto& node : data.nodes) {
+      double x;
+      double y;
+
+      if (node->GetType()->GetIgnore()) {
+        continue;
+      }
+
+      projection.GeoToPixel(node->GetCoords(),x,y);
+
+      if (x<min || x>max ||
+          y<min || y>max) {
+        continue;
+      }
+
+      Layer& layer=layers[node->GetType()->GetIndex()];
+
+      geometry.clear();
+      geometry.push_back(Command(commandMoveTo,1));
+      geometry.push_back(ZigZag((int32_t)lround(x)));
+      geometry.push_back(ZigZag((int32_t)lround(y)));
+
+      AddAttributes(layer,
+                    node->GetFeatureValueBuffer(),
+                    tags);
+
+      AppendFeature(layer,
+                    node->GetFileOffset(),
+                    tags,
+                    geomTypePoint,
+                    geometry);
+    }
+  }
+
+  void VectorTileEncoder::EncodeWays(const TileProjection& projection,
+                                     const MapData& data,
+                                     TransPolygon& polygon,
+                                     std::vector<Layer>& layers) const
+  {
+    std::vector<TileLine> lines;
+    std::vector<uint32_t> tags;
+    std::vector<uint32_t> geometry;
+
+    for (const auto& way : data.ways) {
+      if (way->GetType()->GetIgnore() ||
+          way->nodes.size()<2) {
+        continue;
+      }
+
+      polygon.TransformWay(projection,
+                           optimizeMethod,
+                           way->nodes,
+                           optimizeErrorTolerance);
+
+      if (polygon.IsEmpty()) {
+        continue;
+      }
+
+      lines.clear();
+      ClipLine(polygon,
+               lines);
+
+      if (lines.empty()) {
+        continue;
+      }
+
+      int32_t cursorX=0;
+      int32_t cursorY=0;
+
+      geometry.clear();
+
+      for (const auto& line : lines) {
+        AppendLine(line,false,cursorX,cursorY,geometry);
+      }
+
+      Layer& layer=layers[way->GetType()->GetIndex()];
+
+      AddAttributes(layer,
+                    way->GetFeatureValueBuffer(),
+                    tags);
+
+      AppendFeature(layer,
+                    way->GetFileOffset(),
+                    tags,
+                    geomTypeLineString,
+                    geometry);
+    }
+  }
+
+  /**
+   * Areas are handled the same way as by the MapPainter: Each outer ring and
+   * each inner ring with a type of its own is a polygon. The directly following
+   * inner rings of the next level without a type are the holes of the polygon.
+   */
+  void VectorTileEncoder::EncodeAreas(const TileProjection& projection,
+                                      const MapData& data,
+                                      TransPolygon& polygon,
+                                      std::vector<Layer>& layers) const
+  {
+    TileLine              ring;
+    std::vector<uint32_t> tags;
+    std::vector<uint32_t> geometry;
+
+    for (const auto& area : data.areas) {
+      for (size_t i=0; i<area->rings.size(); i++) {
+        const Area::Ring& outerRing=area->rings[i];
+        TypeInfoRef       type;
+
+        // The master ring does not have any nodes, skipping...
+        if (outerRing.IsMasterRing()) {
+          continue;
+        }
+
+        if (outerRing.IsOuterRing()) {
+          type=area->GetType();
+        }
+        else if (!outerRing.GetType()->GetIgnore()) {
+          type=outerRing.GetType();
+        }
+        else {
+          continue;
+        }
+
+        if (type->GetIgnore()) {
+          continue;
+        }
+
+        polygon.TransformArea(projection,
+                              optimizeMethod,
+                              outerRing.nodes,
+                              optimizeErrorTolerance);
+
+        if (polygon.IsEmpty() ||
+            !ClipRing(polygon,true,ring)) {
+          continue;
+        }
+
+        int32_t cursorX=0;
+        int32_t cursorY=0;
+
+        geometry.clear();
+        AppendLine(ring,true,cursorX,cursorY,geometry);
+
+        for (size_t j=i+1;
+             j<area->rings.size() &&
+             area->rings[j].GetRing()==outerRing.GetRing()+1 &&
+             area->rings[j].GetType()->GetIgnore();
+             j++) {
+          polygon.TransformArea(projection,
+                                optimizeMethod,
+                                area->rings[j].nodes,
+                                optimizeErrorTolerance);
+
+          if (!polygon.IsEmpty() &&
+              ClipRing(polygon,false,ring)) {
+            AppendLine(ring,true,cursorX,cursorY,geometry);
+          }
+        }
+
+        Layer& layer=layers[type->GetIndex()];
+
+        AddAttributes(layer,
+                      outerRing.GetFeatureValueBuffer(),
+                      tags);
+
+        AppendFeature(layer,
+                      area->GetFileOffset(),
+                      tags,
+                      geomTypePolygon,
+                      geometry);
+      }
+    }
+  }
+
+  /**
+   * Encode the given data as vector tile.
+   *
+   * @param magnification
+   *    Magnification (zoom level) of the tile
+   * @param x
+   *    x coordinate of the tile
+   * @param y
+   *    y coordinate of the tile
+   * @param data
+   *    Map data of the tile, for example as returned by MapService::ConvertTilesToMapData().
+   *    Objects outside the tile are clipped.
+   * @param tile
+   *    The encoded tile. A tile without any objects results in an empty string.
+   * @return
+   *    False, if there was an error, else true.
+   */
+  bool VectorTileEncoder::Encode(const Magnification& magnification,
+                                 size_t x,
+                                 size_t y,
+                                 const MapData& data,
+                                 std::string& tile) const
+  {
+    TileProjection     projection;
+    TransPolygon       polygon;
+    std::vector<Layer> layers(typeConfig->GetTypes().size());
+
+    tile.clear();
+
+    if (!projection.Set(x,y,
+                        magnification,
+                        96.0,
+                        extent,
+                        extent)) {
+      log.Error() << "Cannot create projection for tile " << magnification.GetLevel() << "." << y << "." << x;
+      return false;
+    }
+
+    polygon.SetClipRect(-(double)buffer,
+                        -(double)buffer,
+                        (double)extent+(double)buffer,
+                        (double)extent+(double)buffer);
+
+    EncodeNodes(projection,
+                data,
+                layers);
+
+    EncodeWays(projection,
+               data,
+               polygon,
+               layers);
+
+    EncodeAreas(projection,
+                data,
+                polygon,
+                layers);
+
+    for (size_t i=0; i<layers.size(); i++) {
+      const Layer& layer=layers[i];
+
+      if (layer.featureCount==0) {
+        continue;
+      }
+
+      std::string layerBuffer;
+
+      WriteBytesField(layerBuffer,layerName,typeConfig->GetTypes()[i]->GetName());
+      layerBuffer.append(layer.features);
+
+      for (const auto& key : layer.keys) {
+        WriteBytesField(layerBuffer,layerKeys,key);
+      }
+
+      for (const auto& value : layer.values) {
+        WriteBytesField(layerBuffer,layerValues,value);
+      }
+
+      WriteVarintField(layerBuffer,layerExtent,extent);
+      WriteVarintField(layerBuffer,layerVersion,tileVersion);
+
+      WriteBytesField(tile,tileLayers,layerBuffer);
+    }
+
+    return true;
+  }
+}
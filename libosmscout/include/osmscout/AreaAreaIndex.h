@@ -26,7 +26,7 @@
 
 #include <osmscout/DataFile.h>
 
-#include <osmscout/util/Cache.h>
+#include <osmscout/util/ConcurrentCache.h>
 #include <osmscout/util/Geometry.h>
 #include <osmscout/util/FileScanner.h>
 
@@ -61,7 +61,7 @@ namespace osmscout {
       FileOffset data;        //!< The file index at which the data payload starts
     };
 
-    typedef Cache<FileOffset,IndexCell> IndexCache;
+    typedef ConcurrentCache<FileOffset,IndexCell> IndexCache;
 
     struct IndexCacheValueSizer : public IndexCache::ValueSizer
     {
@@ -69,6 +69,7 @@ namespace osmscout {
       {
         size_t memory=0;
 
+        memory+=sizeof(FileOffset); // Key
         memory+=sizeof(value);
 
         return memory;
@@ -93,15 +94,16 @@ namespace osmscout {
     };
 
   private:
-    std::string           datafilename;   //!< Full path and name of the data file
-    mutable FileScanner   scanner;        //!< Scanner instance for reading this file
+    std::string           datafilename;    //!< Full path and name of the data file
+    mutable FileScanner   scanner;         //!< Scanner instance for reading this file
 
-    uint32_t              maxLevel;       //!< Maximum level in index
-    FileOffset            topLevelOffset; //!< File offset of the top level index entry
+    uint32_t              maxLevel;        //!< Maximum level in index
+    FileOffset            topLevelOffset;  //!< File offset of the top level index entry
 
-    mutable IndexCache    indexCache;     //!< Cached map of all index entries by file offset
+    IndexCacheValueSizer  indexCacheSizer; //!< Sizer for the index cache, if it has a memory budget
+    mutable IndexCache    indexCache;      //!< Cached map of all index entries by file offset, thread-safe
 
-    mutable std::mutex    lookupMutex;
+    mutable std::mutex    lookupMutex;     //!< Mutex to secure multi-thread access to the scanner
 
   private:
     bool GetIndexCell(uint32_t level,
@@ -125,7 +127,8 @@ namespace osmscout {
                                std::vector<CellRef>& nextCellRefs) const;
 
   public:
-    AreaAreaIndex(size_t cacheSize);
+    AreaAreaIndex(size_t cacheSize,
+                  size_t cacheMemory=0);
     virtual ~AreaAreaIndex();
 
     void Close();
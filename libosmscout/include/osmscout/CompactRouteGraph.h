@@ -0,0 +1,273 @@
+#ifndef OSMSCOUT_COMPACTROUTEGRAPH_H
+#define OSMSCOUT_COMPACTROUTEGRAPH_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <osmscout/CoreFeatures.h>
+
+#include <osmscout/GeoCoord.h>
+#include <osmscout/ObjectRef.h>
+#include <osmscout/RoutingProfile.h>
+#include <osmscout/Types.h>
+
+#include <osmscout/util/MemoryMappedFile.h>
+
+#include <osmscout/private/CoreImportExport.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Routing
+   *
+   * Copy of the routing graph in router.dat in a format that can be used
+   * without any decoding.
+   *
+   * The graph is stored in compressed sparse row (CSR) layout: an array of
+   * fixed size node records, each holding the index of its first outgoing
+   * edge in one contiguous array of fixed size edge records. Nodes are
+   * referenced by their index, so following an edge does not need any lookup.
+   * Objects (ways and areas) and turn restrictions are stored in two further
+   * arrays.
+   *
+   * The file is memory mapped and accessed in place. Records are stored in
+   * the native byte order of the platform that generated the file; files
+   * of a different byte order are rejected when loading.
+   *
+   * Edges store the distance and the object variant index. Costs are
+   * evaluated during the query using a table of costs per km for each object
+   * variant (see GetVariantCosts()), so the graph can be used for every
+   * profile whose costs are proportional to the distance per object variant
+   * and whose vehicle is part of the routing graph.
+   *
+   * File format:
+   * - Header
+   * - nodeCount+1 Node records (the last one is a sentinel, only holding
+   *   the end indexes of the edges and excludes of the last node)
+   * - edgeCount Edge records, ordered by source node
+   * - objectCount Object records, sorted like ObjectFileRef
+   * - excludeCount Exclude records, ordered by node
+   *
+   * Instances are read only after loading, so queries are thread-safe.
+   */
+  class OSMSCOUT_API CompactRouteGraph
+  {
+  public:
+    static const uint32_t INVALID_INDEX=0xffffffff;
+    static const uint32_t FILE_MAGIC=0x4752534f;   //!< "OSRG" in little endian byte order
+    static const uint32_t FILE_VERSION=2;
+
+    struct OSMSCOUT_API Header
+    {
+      uint32_t magic;
+      uint32_t version;
+      uint32_t nodeCount;
+      uint32_t edgeCount;
+      uint32_t objectCount;
+      uint32_t excludeCount;
+      uint32_t variantCount;  //!< Number of object variants of the routing graph
+      uint8_t  vehicles;      //!< VehicleMask of the vehicles the routing graph has been generated for
+      uint8_t  padding[3];
+    };
+
+    struct OSMSCOUT_API Node
+    {
+      FileOffset routeNodeOffset; //!< FileOffset of the route node in the routing graph
+      double     lat;
+      double     lon;
+      uint32_t   firstEdge;       //!< Index of the first outgoing edge
+      uint32_t   firstExclude;    //!< Index of the first exclude
+    };
+
+    struct OSMSCOUT_API Edge
+    {
+      double   distance;   //!< Distance of the path in km
+      uint32_t target;     //!< Index of the target node
+      uint32_t object;     //!< Index of the object of the path
+      uint16_t variant;    //!< Index of the object variant of the object
+      uint8_t  flags;      //!< RouteNode::Path flags
+      uint8_t  padding[5];
+    };
+
+    struct OSMSCOUT_API Object
+    {
+      FileOffset offset;
+      uint8_t    type;       //!< RefType
+      uint8_t    padding[7];
+    };
+
+    /**
+     * You cannot use the object with the index target, if you come from the
+     * object with the index source
+     */
+    struct OSMSCOUT_API Exclude
+    {
+      uint32_t source;
+      uint32_t target;
+    };
+
+    /**
+     * Route node to start from together with the initial costs and the
+     * object the route node is reached with
+     */
+    struct OSMSCOUT_API Terminal
+    {
+      FileOffset    routeNodeOffset;
+      ObjectFileRef object;
+      double        cost;
+    };
+
+    /**
+     * Route node on the resulting route, together with the object used
+     * to reach it
+     */
+    struct OSMSCOUT_API Step
+    {
+      FileOffset    routeNodeOffset;
+      ObjectFileRef object;
+    };
+
+  private:
+    /**
+     * State of a node during a query
+     */
+    struct Label
+    {
+      uint32_t node;
+      uint32_t prev;         //!< Index of the previous node or INVALID_INDEX
+      uint32_t object;       //!< Index of the object the node has been reached with
+      bool     access;       //!< We had access to the path leading to this node
+      bool     closed;
+      double   currentCost;
+      double   overallCost;
+      size_t   heapIndex;
+
+      explicit Label(uint32_t node)
+      : node(node),
+        prev(INVALID_INDEX),
+        object(INVALID_INDEX),
+        access(true),
+        closed(false),
+        currentCost(0.0),
+        overallCost(0.0),
+        heapIndex(std::numeric_limits<size_t>::max())
+      {
+        // no code
+      }
+    };
+
+    struct LabelCostCompare
+    {
+      inline bool operator()(const Label* a,
+                             const Label* b) const
+      {
+        if (a->overallCost==b->overallCost) {
+          // Node indexes are ordered like the file offsets of the route nodes
+          return a->node<b->node;
+        }
+        else {
+          return a->overallCost<b->overallCost;
+        }
+      }
+    };
+
+  private:
+    bool             isLoaded;
+    MemoryMappedFile file;
+    Header           header;
+    const Node*      nodes;
+    const Edge*      edges;
+    const Object*    objects;
+    const Exclude*   excludes;
+
+  private:
+    uint32_t GetNodeIndex(FileOffset routeNodeOffset) const;
+    uint32_t GetObjectIndex(const ObjectFileRef& object) const;
+
+    inline ObjectFileRef GetObject(uint32_t index) const
+    {
+      return ObjectFileRef(objects[index].offset,
+                           (RefType)objects[index].type);
+    }
+
+    bool IsExcluded(uint32_t node,
+                    uint32_t source,
+                    uint32_t target) const;
+
+  public:
+    CompactRouteGraph();
+    virtual ~CompactRouteGraph();
+
+    static std::string GetFilename(const std::string& filenamebase);
+
+    bool Load(const std::string& filename);
+    void Close();
+
+    inline bool IsLoaded() const
+    {
+      return isLoaded;
+    }
+
+    inline std::string GetFilename() const
+    {
+      return file.GetFilename();
+    }
+
+    inline size_t GetNodeCount() const
+    {
+      return header.nodeCount;
+    }
+
+    inline size_t GetEdgeCount() const
+    {
+      return header.edgeCount;
+    }
+
+    inline size_t GetVariantCount() const
+    {
+      return header.variantCount;
+    }
+
+    inline VehicleMask GetVehicles() const
+    {
+      return header.vehicles;
+    }
+
+    bool GetVariantCosts(const RoutingProfile& profile,
+                         const std::vector<ObjectVariantData>& objectVariantData,
+                         std::vector<double>& variantCosts) const;
+
+    bool CalculateRoute(const RoutingProfile& profile,
+                        const std::vector<double>& variantCosts,
+                        const std::vector<Terminal>& starts,
+                        const std::vector<FileOffset>& targets,
+                        const GeoCoord& target,
+                        std::vector<Step>& steps,
+                        size_t& expandedNodeCount) const;
+  };
+
+  typedef std::shared_ptr<CompactRouteGraph> CompactRouteGraphRef;
+}
+
+#endif
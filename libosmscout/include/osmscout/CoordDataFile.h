@@ -20,6 +20,8 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
 */
 
+#include <vector>
+
 #include <osmscout/DataFile.h>
 #include <osmscout/Coord.h>
 
@@ -29,6 +31,15 @@ namespace osmscout {
 
   /**
    * \ingroup Database
+   *
+   * Access to the coordinates of all nodes by their OSM id.
+   *
+   * The file is either stored in pages of coordinates (with an index of all
+   * non-empty pages loaded on opening) or as one dense array holding the
+   * coordinates of all ids between the smallest and the highest node id.
+   * Each entry has a size of 8 bytes. Ranges without nodes are not written and
+   * thus do not take disk space on file systems supporting sparse files.
+   * Files with dense layout are always accessed memory mapped.
    */
   class OSMSCOUT_API CoordDataFile
   {
@@ -47,6 +58,14 @@ namespace osmscout {
     mutable FileScanner scanner;            //!< File stream to the data file
     uint32_t            pageSize;
     PageIdFileOffsetMap pageFileOffsetMap;
+    bool                dense;              //!< If true, the file has dense layout
+    OSMId               minId;              //!< Lowest id in a file with dense layout
+    OSMId               maxId;              //!< Highest id in a file with dense layout
+    FileOffset          dataOffset;         //!< Offset of the first entry in a file with dense layout
+
+  private:
+    void GetCoord(OSMId id,
+                  ResultMap& resultMap) const;
 
   public:
     CoordDataFile();
@@ -58,7 +77,10 @@ namespace osmscout {
 
     std::string GetFilename() const;
 
+    bool IsDense() const;
+
     bool Get(const std::set<OSMId>& ids, ResultMap& resultMap) const;
+    bool Get(std::vector<OSMId>& ids, ResultMap& resultMap) const;
   };
 }
 
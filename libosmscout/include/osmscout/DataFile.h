@@ -20,9 +20,12 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
 */
 
+#include <algorithm>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <set>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -66,6 +69,13 @@ namespace osmscout {
    * Access to standard format data files.
    *
    * Allows to load data objects by offset using various standard library data structures.
+   *
+   * Reading is thread-safe without serializing I/O: each reading thread
+   * takes its own FileScanner from an internal pool, so multiple threads can
+   * decode objects in parallel. In mmap mode the individual mappings of the
+   * scanners share the same pages in the OS page cache. The number of
+   * scanners is limited, if all scanners are in use, further readers wait
+   * until a scanner is returned.
    */
   template <class N>
   class DataFile
@@ -74,17 +84,49 @@ namespace osmscout {
     typedef std::shared_ptr<N> ValueType;
 
   private:
-    std::string         datafile;        //!< Basename part of the data file name
-    std::string         datafilename;    //!< complete filename for data file
+    /**
+     * Scoped access to a scanner of the pool. The scanner is returned to the
+     * pool on destruction, so also in case of an exception.
+     */
+    class ScannerHolder
+    {
+    private:
+      const DataFile<N>& dataFile;
+      FileScanner*       scanner;
+
+    public:
+      explicit ScannerHolder(const DataFile<N>& dataFile);
+      ~ScannerHolder();
+
+      ScannerHolder(const ScannerHolder& other) = delete;
+      ScannerHolder& operator=(const ScannerHolder& other) = delete;
+
+      inline FileScanner* Get() const
+      {
+        return scanner;
+      }
+    };
+
+  private:
+    std::string                                   datafile;        //!< Basename part of the data file name
+    std::string                                   datafilename;    //!< complete filename for data file
+    bool                                          memoryMapedData; //!< Open scanners using mmap
+    bool                                          isOpen;          //!< The data file has been opened successfully
+    size_t                                        maxScannerCount; //!< Maximum number of open scanners
 
-    mutable FileScanner scanner;         //!< File stream to the data file
+    mutable std::vector<std::unique_ptr<FileScanner>> scanners;    //!< Pool of currently unused file streams to the data file
+    mutable size_t                                scannerCount;    //!< Number of open scanners, in the pool and in use
 
-    mutable std::mutex  accessMutex;     //!< Mutex to secure multi-thread access
+    mutable std::mutex                            accessMutex;     //!< Mutex to secure multi-thread access to the scanner pool
+    mutable std::condition_variable               scannerReleased; //!< Signaled if a scanner was returned to the pool
 
   protected:
-    TypeConfigRef       typeConfig;
+    TypeConfigRef                                 typeConfig;
 
   private:
+    FileScanner* AcquireScanner() const;
+    void ReleaseScanner(FileScanner* scanner) const;
+
     bool ReadData(const TypeConfig& typeConfig,
                   FileScanner& scanner,
                   N& data) const;
@@ -104,6 +146,8 @@ namespace osmscout {
     virtual bool IsOpen() const;
     virtual bool Close();
 
+    void SetMaxScannerCount(size_t maxScannerCount);
+
     bool GetByOffset(const std::vector<FileOffset>& offsets,
                      std::vector<ValueType>& data) const;
     bool GetByOffset(const std::list<FileOffset>& offsets,
@@ -125,7 +169,11 @@ namespace osmscout {
 
   template <class N>
   DataFile<N>::DataFile(const std::string& datafile)
-  : datafile(datafile)
+  : datafile(datafile),
+    memoryMapedData(false),
+    isOpen(false),
+    maxScannerCount(std::max(2u,2*std::thread::hardware_concurrency())),
+    scannerCount(0)
   {
     // no code
   }
@@ -138,19 +186,112 @@ namespace osmscout {
     }
   }
 
+  template <class N>
+  DataFile<N>::ScannerHolder::ScannerHolder(const DataFile<N>& dataFile)
+  : dataFile(dataFile),
+    scanner(dataFile.AcquireScanner())
+  {
+    // no code
+  }
+
+  template <class N>
+  DataFile<N>::ScannerHolder::~ScannerHolder()
+  {
+    if (scanner!=NULL) {
+      dataFile.ReleaseScanner(scanner);
+    }
+  }
+
   /**
-   * Read one data value from the given file offset.
+   * Return a file scanner for exclusive use by the calling thread. Scanners are
+   * taken from the pool of unused scanners. If the pool is empty, a
+   * new scanner for the data file is opened. If the maximum number of scanners
+   * is already open, the method waits until a scanner is returned. The scanner
+   * must be returned using ReleaseScanner() after use, use ScannerHolder
+   * to do this automatically.
+   *
+   * This way multiple threads can read from the data file in parallel, the mutex
+   * is only hold while taking or returning a scanner from or to the pool.
+   *
+   * Returns NULL, if the data file is not open or a new scanner cannot be opened.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  FileScanner* DataFile<N>::AcquireScanner() const
+  {
+    {
+      std::unique_lock<std::mutex> lock(accessMutex);
+
+      scannerReleased.wait(lock,[this] {
+        return !isOpen ||
+               !scanners.empty() ||
+               scannerCount<maxScannerCount;
+      });
+
+      if (!isOpen) {
+        log.Error() << "Data file " << datafilename << " is not open";
+        return NULL;
+      }
+
+      if (!scanners.empty()) {
+        FileScanner* scanner=scanners.back().release();
+
+        scanners.pop_back();
+
+        return scanner;
+      }
+
+      scannerCount++;
+    }
+
+    std::unique_ptr<FileScanner> scanner(new FileScanner());
+
+    try {
+      scanner->Open(datafilename,
+                    FileScanner::LowMemRandom,
+                    memoryMapedData);
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      scanner->CloseFailsafe();
+
+      std::lock_guard<std::mutex> lock(accessMutex);
+
+      scannerCount--;
+      scannerReleased.notify_all();
+
+      return NULL;
+    }
+
+    return scanner.release();
+  }
+
+  /**
+   * Return a scanner retrieved by AcquireScanner() back to the pool.
    *
    * Method is thread-safe.
    */
   template <class N>
+  void DataFile<N>::ReleaseScanner(FileScanner* scanner) const
+  {
+    std::lock_guard<std::mutex> lock(accessMutex);
+
+    scanners.push_back(std::unique_ptr<FileScanner>(scanner));
+    scannerReleased.notify_all();
+  }
+
+  /**
+   * Read one data value from the given file offset.
+   *
+   * Method is not thread-safe, the scanner must be exclusively owned by the caller.
+   */
+  template <class N>
   bool DataFile<N>::ReadData(const TypeConfig& typeConfig,
                              FileScanner& scanner,
                              FileOffset offset,
                              N& data) const
   {
-    std::lock_guard<std::mutex> lock(accessMutex);
-
     try {
       scanner.SetPos(offset);
 
@@ -198,20 +339,29 @@ namespace osmscout {
                          bool memoryMapedData)
   {
     this->typeConfig=typeConfig;
+    this->memoryMapedData=memoryMapedData;
 
     datafilename=AppendFileToDir(path,datafile);
 
+    std::unique_ptr<FileScanner> scanner(new FileScanner());
+
     try {
-      scanner.Open(datafilename,
-                   FileScanner::LowMemRandom,
-                   memoryMapedData);
+      scanner->Open(datafilename,
+                    FileScanner::LowMemRandom,
+                    memoryMapedData);
     }
     catch (IOException& e) {
       log.Error() << e.GetDescription();
-      scanner.CloseFailsafe();
+      scanner->CloseFailsafe();
       return false;
     }
 
+    std::lock_guard<std::mutex> lock(accessMutex);
+
+    scanners.push_back(std::move(scanner));
+    scannerCount=1;
+    isOpen=true;
+
     return true;
   }
 
@@ -223,31 +373,62 @@ namespace osmscout {
   template <class N>
   bool DataFile<N>::IsOpen() const
   {
-    return scanner.IsOpen();
+    return isOpen;
   }
 
   /**
-   * Close the index.
+   * Close the index. Further reads fail, the method waits until all
+   * scanners currently in use are returned.
    *
    * Method is not thread-safe.
    */
   template <class N>
   bool DataFile<N>::Close()
   {
+    bool                         result=true;
+    std::unique_lock<std::mutex> lock(accessMutex);
+
+    isOpen=false;
+    scannerReleased.notify_all();
+
+    scannerReleased.wait(lock,[this] {
+      return scanners.size()==scannerCount;
+    });
+
     typeConfig=NULL;
 
-    try  {
-      if (scanner.IsOpen()) {
-        scanner.Close();
+    for (auto& scanner : scanners) {
+      try  {
+        if (scanner->IsOpen()) {
+          scanner->Close();
+        }
+      }
+      catch (IOException& e) {
+        log.Error() << e.GetDescription();
+        scanner->CloseFailsafe();
+        result=false;
       }
-    }
-    catch (IOException& e) {
-      log.Error() << e.GetDescription();
-      scanner.CloseFailsafe();
-      return false;
     }
 
-    return true;
+    scanners.clear();
+    scannerCount=0;
+
+    return result;
+  }
+
+  /**
+   * Set the maximum number of scanners, that are open at the same time and
+   * thus the maximum number of parallel reads.
+   *
+   * Method is not thread-safe.
+   */
+  template <class N>
+  void DataFile<N>::SetMaxScannerCount(size_t maxScannerCount)
+  {
+    std::lock_guard<std::mutex> lock(accessMutex);
+
+    this->maxScannerCount=std::max((size_t)1,maxScannerCount);
+    scannerReleased.notify_all();
   }
 
   /**
@@ -259,13 +440,20 @@ namespace osmscout {
   bool DataFile<N>::GetByOffset(const std::vector<FileOffset>& offsets,
                                 std::vector<ValueType>& data) const
   {
+    ScannerHolder holder(*this);
+    FileScanner*  scanner=holder.Get();
+
+    if (scanner==NULL) {
+      return false;
+    }
+
     data.reserve(data.size()+offsets.size());
 
     for (const auto& offset : offsets) {
       ValueType value=std::make_shared<N>();
 
       if (!ReadData(*typeConfig,
-                    scanner,
+                    *scanner,
                     offset,
                     *value)) {
         log.Error() << "Error while reading data from offset " << offset << " of file " << datafilename << "!";
@@ -287,13 +475,20 @@ namespace osmscout {
   bool DataFile<N>::GetByOffset(const std::list<FileOffset>& offsets,
                                 std::vector<ValueType>& data) const
   {
+    ScannerHolder holder(*this);
+    FileScanner*  scanner=holder.Get();
+
+    if (scanner==NULL) {
+      return false;
+    }
+
     data.reserve(data.size()+offsets.size());
 
     for (const auto& offset : offsets) {
       ValueType value=std::make_shared<N>();
 
       if (!ReadData(*typeConfig,
-                    scanner,
+                    *scanner,
                     offset,
                     *value)) {
         log.Error() << "Error while reading data from offset " << offset << " of file " << datafilename << "!";
@@ -316,13 +511,20 @@ namespace osmscout {
   bool DataFile<N>::GetByOffset(const std::set<FileOffset>& offsets,
                                 std::vector<ValueType>& data) const
   {
+    ScannerHolder holder(*this);
+    FileScanner*  scanner=holder.Get();
+
+    if (scanner==NULL) {
+      return false;
+    }
+
     data.reserve(data.size()+offsets.size());
 
     for (const auto& offset : offsets) {
       ValueType value=std::make_shared<N>();
 
       if (!ReadData(*typeConfig,
-                    scanner,
+                    *scanner,
                     offset,
                     *value)) {
         log.Error() << "Error while reading data from offset " << offset << " of file " << datafilename << "!";
@@ -367,10 +569,17 @@ namespace osmscout {
   bool DataFile<N>::GetByOffset(const FileOffset& offset,
                                 ValueType& entry) const
   {
+    ScannerHolder holder(*this);
+    FileScanner*  scanner=holder.Get();
+
+    if (scanner==NULL) {
+      return false;
+    }
+
     ValueType value=std::make_shared<N>();
 
     if (!ReadData(*typeConfig,
-                  scanner,
+                  *scanner,
                   offset,
                   *value)) {
       log.Error() << "Error while reading data from offset " << offset << " of file " << datafilename << "!";
@@ -396,10 +605,15 @@ namespace osmscout {
       return true;
     }
 
-    std::lock_guard<std::mutex> lock(accessMutex);
+    ScannerHolder holder(*this);
+    FileScanner*  scanner=holder.Get();
+
+    if (scanner==NULL) {
+      return false;
+    }
 
     try {
-      scanner.SetPos(span.startOffset);
+      scanner->SetPos(span.startOffset);
 
       area.reserve(area.size()+span.count);
 
@@ -407,7 +621,7 @@ namespace osmscout {
         ValueType value=std::make_shared<N>();
 
         if (!ReadData(*typeConfig,
-                      scanner,
+                      *scanner,
                       *value)) {
           log.Error() << "Error while reading data #" << i << " starting from offset " << span.startOffset << " of file " << datafilename << "!";
           return false;
@@ -415,13 +629,13 @@ namespace osmscout {
 
         area.push_back(value);
       }
-
-      return true;
     }
     catch (IOException& e) {
       log.Error() << e.GetDescription();
       return false;
     }
+
+    return true;
   }
 
   /**
@@ -441,21 +655,26 @@ namespace osmscout {
 
     data.reserve(data.size()+overallCount);
 
+    ScannerHolder holder(*this);
+    FileScanner*  scanner=holder.Get();
+
+    if (scanner==NULL) {
+      return false;
+    }
+
     try {
       for (const auto& span : spans) {
         if (span.count==0) {
           continue;
         }
 
-        std::lock_guard<std::mutex> lock(accessMutex);
-
-        scanner.SetPos(span.startOffset);
+        scanner->SetPos(span.startOffset);
 
         for (uint32_t i=1; i<=span.count; i++) {
           ValueType value=std::make_shared<N>();
 
           if (!ReadData(*typeConfig,
-                        scanner,
+                        *scanner,
                         *value)) {
             log.Error() << "Error while reading data #" << i << " starting from offset " << span.startOffset <<
             " of file " << datafilename << "!";
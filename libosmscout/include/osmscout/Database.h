@@ -72,20 +72,24 @@ namespace osmscout {
 
     The following attributes are currently available:
     * cache sizes.
+    * cache memory budgets in bytes (0 means, that the cache is limited by its size).
     */
   class OSMSCOUT_API DatabaseParameter
   {
   private:
     unsigned long areaAreaIndexCacheSize;
+    unsigned long areaAreaIndexCacheMemory;
     unsigned long areaNodeIndexCacheSize;
 
   public:
     DatabaseParameter();
 
     void SetAreaAreaIndexCacheSize(unsigned long areaAreaIndexCacheSize);
+    void SetAreaAreaIndexCacheMemory(unsigned long areaAreaIndexCacheMemory);
     void SetAreaNodeIndexCacheSize(unsigned long areaNodeIndexCacheSize);
 
     unsigned long GetAreaAreaIndexCacheSize() const;
+    unsigned long GetAreaAreaIndexCacheMemory() const;
     unsigned long GetAreaNodeIndexCacheSize() const;
   };
 
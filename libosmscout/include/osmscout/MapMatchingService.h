@@ -0,0 +1,218 @@
+#ifndef OSMSCOUT_MAPMATCHINGSERVICE_H
+#define OSMSCOUT_MAPMATCHINGSERVICE_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <memory>
+#include <vector>
+
+#include <osmscout/CoreFeatures.h>
+
+#include <osmscout/Database.h>
+#include <osmscout/GeoCoord.h>
+#include <osmscout/RouteData.h>
+#include <osmscout/RoutingProfile.h>
+#include <osmscout/RoutingService.h>
+
+#include <osmscout/util/ConcurrentCache.h>
+
+#include <osmscout/private/CoreImportExport.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Routing
+   * Parameter of the MapMatchingService.
+   *
+   * The following groups attributes are currently available:
+   * - Search radius and maximum number of candidate ways for each point
+   * - Parameters of the probability model (GPS noise and tolerated detours)
+   * - Minimum distance between points considered for matching
+   * - Number of threads used for matching a batch of traces
+   * - Cache size for the candidate ways of points
+   */
+  class OSMSCOUT_API MapMatchingParameter
+  {
+  private:
+    double searchRadius;
+    size_t maxCandidates;
+    double gpsSigma;
+    double transitionBeta;
+    double maxDistanceFactor;
+    double minPointDistance;
+    size_t threadCount;
+    size_t candidateCacheSize;
+
+  public:
+    MapMatchingParameter();
+
+    void SetSearchRadius(double searchRadius);
+    void SetMaxCandidates(size_t maxCandidates);
+    void SetGpsSigma(double gpsSigma);
+    void SetTransitionBeta(double transitionBeta);
+    void SetMaxDistanceFactor(double maxDistanceFactor);
+    void SetMinPointDistance(double minPointDistance);
+    void SetThreadCount(size_t threadCount);
+    void SetCandidateCacheSize(size_t candidateCacheSize);
+
+    double GetSearchRadius() const;
+    size_t GetMaxCandidates() const;
+    double GetGpsSigma() const;
+    double GetTransitionBeta() const;
+    double GetMaxDistanceFactor() const;
+    double GetMinPointDistance() const;
+    size_t GetThreadCount() const;
+    size_t GetCandidateCacheSize() const;
+  };
+
+  /**
+   * \ingroup Routing
+   * Result of matching a GPS trace using the MapMatchingService.
+   */
+  struct OSMSCOUT_API MatchedTrace
+  {
+    std::vector<RoutePosition> positions;  //!< Matched position for each point of the trace, the object is invalid for unmatched points
+    RouteData                  route;      //!< The route through all matched positions
+    size_t                     breakCount; //!< Number of points at which matching had to be restarted
+    size_t                     gapCount;   //!< Number of consecutive matched positions that could not be connected by a route
+
+    inline MatchedTrace()
+    : breakCount(0),
+      gapCount(0)
+    {
+      // no code
+    }
+  };
+
+  /**
+   * \ingroup Service
+   * \ingroup Routing
+   * The MapMatchingService matches GPS traces to the ways of the routing
+   * graph of a RoutingService.
+   *
+   * Matching uses a hidden Markov model: for each point of the trace the
+   * routable ways within the search radius are candidates (see
+   * RoutingService::GetRouteCandidates()). The probability of a candidate
+   * decreases with its distance to the point (normal distribution of the
+   * GPS noise). The probability of a transition between candidates of
+   * consecutive points decreases with the difference between the route
+   * distance of both candidates and the distance of both points
+   * (exponential distribution). Route distances are calculated using a
+   * distance bounded matrix search (see RoutingService::CalculateMatrix()).
+   * The most likely sequence of candidates is calculated using the Viterbi
+   * algorithm.
+   *
+   * Points without candidates are ignored. If no candidate of a point can
+   * be reached from the candidates of the previous point, matching restarts
+   * at that point.
+   *
+   * The candidates of points are cached and shared between all traces
+   * matched by the same service, the route nodes loaded by the matrix
+   * searches are cached by the RoutingService (see
+   * RouterParameter::SetRouteNodeCacheSize()).
+   */
+  class OSMSCOUT_API MapMatchingService
+  {
+  private:
+    /**
+     * Candidates of a point. The point and the vehicle are stored, too, since
+     * the cache key is only the id of the point.
+     */
+    struct CandidateList
+    {
+      GeoCoord                    coord;
+      Vehicle                     vehicle;
+      std::vector<RouteCandidate> candidates;
+    };
+
+    typedef std::shared_ptr<CandidateList> CandidateListRef;
+
+    //! Candidates of points, key is the id of the coordinate
+    typedef ConcurrentCache<Id,CandidateListRef> CandidateCache;
+
+    /**
+     * State of the Viterbi algorithm for one matched point
+     */
+    struct Step
+    {
+      size_t                      pointIndex;   //!< Index of the point in the trace
+      CandidateListRef            candidates;   //!< Candidates of the point
+      std::vector<double>         scores;       //!< Log probability of the most likely sequence ending in each candidate
+      std::vector<size_t>         predecessors; //!< Candidate of the previous step on the most likely sequence
+    };
+
+  private:
+    DatabaseRef       database;          //!< Database object, holding all index and data files
+    RoutingServiceRef router;            //!< Router used for candidates, transitions and routes
+    double            searchRadius;
+    size_t            maxCandidates;
+    double            gpsSigma;
+    double            transitionBeta;
+    double            maxDistanceFactor;
+    double            minPointDistance;
+    size_t            threadCount;
+
+    CandidateCache    candidateCache;    //!< Recently calculated candidates
+
+  private:
+    bool GetCandidates(const GeoCoord& coord,
+                       Vehicle vehicle,
+                       CandidateListRef& candidates);
+
+    bool GetWayDistance(const RoutingProfile& profile,
+                        const RoutePosition& from,
+                        const RoutePosition& to,
+                        double& distance) const;
+
+    bool GetTransitionDistances(const RoutingProfile& profile,
+                                const std::vector<RouteCandidate>& from,
+                                const std::vector<RouteCandidate>& to,
+                                double maxDistance,
+                                std::vector<double>& distances) const;
+
+    void ResolveSteps(const std::vector<Step>& steps,
+                      std::vector<RoutePosition>& positions) const;
+
+    void ResolveRoute(const RoutingProfile& profile,
+                      MatchedTrace& result) const;
+
+  public:
+    MapMatchingService(const DatabaseRef& database,
+                       const RoutingServiceRef& router,
+                       const MapMatchingParameter& parameter);
+    virtual ~MapMatchingService();
+
+    bool MatchTrace(const RoutingProfile& profile,
+                    const std::vector<GeoCoord>& trace,
+                    MatchedTrace& result);
+
+    bool MatchTraces(const RoutingProfile& profile,
+                     const std::vector<std::vector<GeoCoord>>& traces,
+                     std::vector<MatchedTrace>& results);
+
+    void FlushCache();
+  };
+
+  //! \ingroup Service
+  //! Reference counted reference to a MapMatchingService instance
+  typedef std::shared_ptr<MapMatchingService> MapMatchingServiceRef;
+}
+
+#endif
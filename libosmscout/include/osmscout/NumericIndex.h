@@ -25,7 +25,7 @@
 
 #include <osmscout/TypeConfig.h>
 
-#include <osmscout/util/Cache.h>
+#include <osmscout/util/ConcurrentCache.h>
 #include <osmscout/util/File.h>
 #include <osmscout/util/FileScanner.h>
 #include <osmscout/util/Logger.h>
@@ -63,7 +63,7 @@ namespace osmscout {
     };
 
     typedef std::shared_ptr<Page>         PageRef;
-    typedef Cache<N,PageRef>              PageCache;
+    typedef ConcurrentCache<N,PageRef>    PageCache;
     typedef std::unordered_map<N,PageRef> PageSimpleCache;
 
     /**
@@ -92,13 +92,15 @@ namespace osmscout {
     PageRef                              root;                //!< Reference to the root page
     size_t                               simpleCacheMaxLevel; //!< Maximum level for simple caching
     mutable std::vector<PageSimpleCache> simplePageCache;     //!< Simple map to cache all entries
-    mutable std::vector<PageCache>       pageCaches;          //!< Complex cache with LRU characteristics
+    mutable std::vector<PageCache>       pageCaches;          //!< Complex, thread-safe cache with CLOCK characteristics
 
-    mutable std::mutex                   accessMutex;         //!< Mutex to secure multi-thread access
+    mutable std::mutex                   simpleCacheMutex;    //!< Mutex to secure multi-thread access to the simple page caches
+    mutable std::mutex                   accessMutex;         //!< Mutex to secure multi-thread access to scanner and buffer
 
   private:
     size_t GetPageIndex(const Page& page, N id) const;
     void ReadPage(FileOffset offset, PageRef& page) const;
+    PageRef GetPage(size_t level, N startId, FileOffset offset) const;
     void InitializeCache();
 
   public:
@@ -230,6 +232,60 @@ namespace osmscout {
     }
   }
 
+  /**
+   * Return the page of the given level starting with the given id, either from
+   * cache or by reading it from the given file offset.
+   *
+   * The file is only locked for actually reading pages, lookups in the
+   * page caches can happen in parallel.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  typename NumericIndex<N>::PageRef NumericIndex<N>::GetPage(size_t level,
+                                                             N startId,
+                                                             FileOffset offset) const
+  {
+    PageRef pageRef;
+
+    if (level<=simpleCacheMaxLevel) {
+      {
+        std::lock_guard<std::mutex> lock(simpleCacheMutex);
+
+        auto cacheRef=simplePageCache[level].find(startId);
+
+        if (cacheRef!=simplePageCache[level].end()) {
+          return cacheRef->second;
+        }
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(accessMutex);
+
+        ReadPage(offset,pageRef);
+      }
+
+      std::lock_guard<std::mutex> lock(simpleCacheMutex);
+
+      // Another thread might have loaded the same page in parallel
+      return simplePageCache[level].insert(std::make_pair(startId,pageRef)).first->second;
+    }
+
+    if (pageCaches[level].GetEntry(startId,pageRef)) {
+      return pageRef;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(accessMutex);
+
+      ReadPage(offset,pageRef);
+    }
+
+    pageCaches[level].SetEntry(startId,pageRef);
+
+    return pageRef;
+  }
+
   template <class N>
   void NumericIndex<N>::InitializeCache()
   {
@@ -353,12 +409,9 @@ namespace osmscout {
   {
     try
     {
-      std::lock_guard<std::mutex> lock(accessMutex);
-
       //std::cout << "Looking up " << id << " in index...." << std::endl;
 
-      size_t                      r=GetPageIndex(*root,id);
-      PageRef                     pageRef;
+      size_t r=GetPageIndex(*root,id);
 
       if (!root->IndexIsValid(r)) {
         //std::cerr << "Id " << id << " not found in root index, " << root->entries.front().startId << "-" << root->entries.back().startId << std::endl;
@@ -374,33 +427,9 @@ namespace osmscout {
       N startId=rootEntry.startId;
       for (size_t level=0; level+2<=levels; level++) {
         //std::cout << "Level " << level << "/" << levels << std::endl;
-        if (level<=simpleCacheMaxLevel) {
-          auto cacheRef=simplePageCache[level].find(startId);
-
-          if (cacheRef==simplePageCache[level].end()) {
-            pageRef=NULL; // Make sure, that we allocate a new page and not reuse an old one
-
-            ReadPage(offset,pageRef);
-
-            simplePageCache[level].insert(std::make_pair(startId,pageRef));
-          }
-          else {
-            pageRef=cacheRef->second;
-          }
-        }
-        else {
-          typename PageCache::CacheRef cacheRef;
-
-          if (!pageCaches[level].GetEntry(startId,cacheRef)) {
-            typename PageCache::CacheEntry cacheEntry(startId);
-
-            cacheRef=pageCaches[level].SetEntry(cacheEntry);
-
-            ReadPage(offset,cacheRef->value);
-          }
-
-          pageRef=cacheRef->value;
-        }
+        PageRef pageRef=GetPage(level,
+                                startId,
+                                offset);
 
         Page& page=*pageRef;
 
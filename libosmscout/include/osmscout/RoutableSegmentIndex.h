@@ -0,0 +1,183 @@
+#ifndef OSMSCOUT_ROUTABLESEGMENTINDEX_H
+#define OSMSCOUT_ROUTABLESEGMENTINDEX_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <osmscout/CoreFeatures.h>
+
+#include <osmscout/GeoCoord.h>
+#include <osmscout/ObjectRef.h>
+#include <osmscout/Types.h>
+
+#include <osmscout/util/GeoBox.h>
+#include <osmscout/util/MemoryMappedFile.h>
+
+#include <osmscout/private/CoreImportExport.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Routing
+   *
+   * Index for finding the closest node of a routable way or area to a given
+   * coordinate without loading any ways or areas.
+   *
+   * The index is a regular grid of cells (with the cell size of the given
+   * magnification level). Each cell holds the nodes of all segments of
+   * routable ways and areas, that intersect the cell, together with the
+   * object and the index of the node within the object and a mask of the
+   * vehicles that can route on the object.
+   *
+   * The file is memory mapped and accessed in place. Records are stored in
+   * the native byte order of the platform that generated the file; files
+   * of a different byte order are rejected when loading.
+   *
+   * File format:
+   * - Header
+   * - entryCount Entry records, ordered by cell
+   * - cellCount Cell records, sorted by y and x
+   *
+   * The cells follow the entries, so the generator can stream the entries
+   * without knowing the cells in advance.
+   *
+   * Instances are read only after loading, so lookups are thread-safe.
+   */
+  class OSMSCOUT_API RoutableSegmentIndex
+  {
+  public:
+    static const char* const ROUTABLE_SEGMENT_IDX;
+
+    static const uint32_t FILE_MAGIC=0x4753524f;   //!< "ORSG" in little endian byte order
+    static const uint32_t FILE_VERSION=2;
+
+    struct OSMSCOUT_API Header
+    {
+      uint32_t magic;
+      uint32_t version;
+      uint32_t level;       //!< Magnification level defining the cell size
+      uint32_t cellCount;
+      uint32_t entryCount;
+      uint32_t reserved[3];
+    };
+
+    struct OSMSCOUT_API Cell
+    {
+      uint32_t x;
+      uint32_t y;
+      uint32_t firstEntry;  //!< Index of the first entry of the cell
+      uint32_t entryCount;  //!< Number of entries of the cell
+    };
+
+    struct OSMSCOUT_API Entry
+    {
+      double     lat;
+      double     lon;
+      FileOffset offset;     //!< File offset of the way or area
+      uint32_t   nodeIndex;  //!< Index of the node within the way or (outer ring of the) area
+      uint8_t    type;       //!< RefType of the object
+      uint8_t    vehicles;   //!< VehicleMask of the vehicles that can route on the object
+      uint8_t    padding[2];
+    };
+
+    /**
+     * A segment of a way or area, given by its two consecutive nodes
+     */
+    struct OSMSCOUT_API Segment
+    {
+      const Entry* from;
+      const Entry* to;
+    };
+
+  private:
+    bool             isLoaded;
+    MemoryMappedFile file;
+    Header           header;
+    double           cellDimension;
+    const Cell*      cells;
+    const Entry*     entries;
+
+  public:
+    RoutableSegmentIndex();
+    virtual ~RoutableSegmentIndex();
+
+    bool Load(const std::string& filename);
+    void Close();
+
+    inline bool IsLoaded() const
+    {
+      return isLoaded;
+    }
+
+    inline std::string GetFilename() const
+    {
+      return file.GetFilename();
+    }
+
+    inline size_t GetCellCount() const
+    {
+      return header.cellCount;
+    }
+
+    inline size_t GetEntryCount() const
+    {
+      return header.entryCount;
+    }
+
+    /**
+     * Return the width and height of a cell in degrees for the given
+     * magnification level
+     */
+    static inline double GetCellDimension(uint32_t level)
+    {
+      return 360.0/std::pow(2.0,(double)level);
+    }
+
+    static inline uint32_t GetCellX(double lon,
+                                    double cellDimension)
+    {
+      return (uint32_t)std::floor((lon+180.0)/cellDimension);
+    }
+
+    static inline uint32_t GetCellY(double lat,
+                                    double cellDimension)
+    {
+      return (uint32_t)std::floor((lat+90.0)/cellDimension);
+    }
+
+    bool GetClosestNode(const GeoCoord& coord,
+                        Vehicle vehicle,
+                        double radius,
+                        ObjectFileRef& object,
+                        size_t& nodeIndex) const;
+
+    bool GetSegments(const GeoBox& boundingBox,
+                     Vehicle vehicle,
+                     std::vector<Segment>& segments) const;
+  };
+
+  typedef std::shared_ptr<RoutableSegmentIndex> RoutableSegmentIndexRef;
+}
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef OSMSCOUT_ROUTECONTRACTIONHIERARCHY_H
+#define OSMSCOUT_ROUTECONTRACTIONHIERARCHY_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <osmscout/CoreFeatures.h>
+
+#include <osmscout/ObjectRef.h>
+#include <osmscout/RouteNode.h>
+#include <osmscout/RoutingProfile.h>
+#include <osmscout/Types.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Routing
+   *
+   * Contraction hierarchy for the routing graph of one vehicle, as generated
+   * by the importer.
+   *
+   * Route nodes are contracted in order of importance. For every contracted
+   * node, shortcut edges between its remaining neighbours are added if the
+   * path over the contracted node is the only shortest path. A query then
+   * runs a bidirectional Dijkstra that only follows edges to more important
+   * nodes, which touches only a tiny fraction of the graph.
+   *
+   * Route nodes that have turn restrictions (excludes) or that are
+   * connected to access restricted paths are never contracted. They form the
+   * "core" of the hierarchy, which is searched without rank restrictions
+   * and where excludes and access restrictions are evaluated the same way
+   * as by the A* router.
+   *
+   * The hierarchy is built for a concrete cost function. It can be used for
+   * any profile that has the same vehicle, the same set of usable object
+   * variants and costs proportional to the costs used during the build.
+   *
+   * File format:
+   * - vehicle (uint8_t)
+   * - number of object variants (uint32_t) and the cost per meter for each
+   *   variant (or a negative value if the variant was not usable)
+   * - number of nodes (uint32_t) and for each node the file offset of the
+   *   route node, its excludes and the indexes of its forward and backward
+   *   upward edges
+   * - number of edges (uint32_t) and for each edge its source and target
+   *   node index, costs, flags, first and last object and for shortcuts the
+   *   two child edges
+   *
+   * Instances are read only after loading, so queries are thread-safe.
+   */
+  class OSMSCOUT_API RouteContractionHierarchy
+  {
+  public:
+    static const uint32_t INVALID_INDEX=0xffffffff;
+
+    static const uint8_t  restricted=1 << 0; //!< Edge is access restricted for the vehicle
+
+    /**
+     * Turn restriction at a core node. You cannot use the target object
+     * if you come from the source object.
+     */
+    struct OSMSCOUT_API Exclude
+    {
+      ObjectFileRef source;
+      ObjectFileRef target;
+    };
+
+    /**
+     * An edge of the hierarchy, either a path of the original routing graph
+     * or a shortcut over a contracted node.
+     */
+    struct OSMSCOUT_API Edge
+    {
+      uint32_t      from;        //!< Index of the source node
+      uint32_t      to;          //!< Index of the target node
+      double        cost;        //!< Costs for traveling the edge
+      uint8_t       flags;       //!< Flags
+      ObjectFileRef firstObject; //!< Object of the first original path
+      ObjectFileRef lastObject;  //!< Object of the last original path
+      uint32_t      firstChild;  //!< Index of the first child edge (from -> contracted node) or INVALID_INDEX
+      uint32_t      secondChild; //!< Index of the second child edge (contracted node -> to) or INVALID_INDEX
+
+      inline bool IsShortcut() const
+      {
+        return firstChild!=INVALID_INDEX;
+      }
+
+      inline bool IsRestricted() const
+      {
+        return (flags & restricted)!=0;
+      }
+    };
+
+    /**
+     * Entry point (start) or exit point (target) of a query with the
+     * initial costs
+     */
+    struct OSMSCOUT_API Terminal
+    {
+      FileOffset    routeNodeOffset; //!< FileOffset of the route node
+      ObjectFileRef object;          //!< For start terminals the object the route node is reached with
+      double        cost;            //!< Initial costs
+    };
+
+    /**
+     * Route node on the resulting route, together with the object used
+     * to reach it
+     */
+    struct OSMSCOUT_API Step
+    {
+      FileOffset    routeNodeOffset;
+      ObjectFileRef object;
+    };
+
+  private:
+    bool                     isLoaded;
+    std::string              filename;
+    Vehicle                  vehicle;
+    std::vector<double>      variantCosts;    //!< Cost per meter for each object variant as used for the build
+
+    std::vector<FileOffset>  nodeOffsets;     //!< Route node file offset for each node, sorted
+    std::vector<uint32_t>    excludeStart;    //!< Start index into excludes for each node (plus sentinel)
+    std::vector<Exclude>     excludes;
+    std::vector<uint32_t>    forwardStart;    //!< Start index into forwardEdges for each node (plus sentinel)
+    std::vector<uint32_t>    forwardEdges;    //!< Outgoing edges to more important nodes
+    std::vector<uint32_t>    backwardStart;   //!< Start index into backwardEdges for each node (plus sentinel)
+    std::vector<uint32_t>    backwardEdges;   //!< Incoming edges from more important nodes
+    std::vector<Edge>        edges;
+
+  private:
+    uint32_t GetNodeIndex(FileOffset routeNodeOffset) const;
+
+    bool IsExcluded(uint32_t node,
+                    const ObjectFileRef& source,
+                    const ObjectFileRef& target) const;
+
+    void UnpackEdge(uint32_t edge,
+                    std::vector<Step>& steps) const;
+
+  public:
+    RouteContractionHierarchy();
+
+    static std::string GetFilename(const std::string& filenamebase,
+                                   Vehicle vehicle);
+
+    static void GetVariantCosts(const RoutingProfile& profile,
+                                const std::vector<ObjectVariantData>& objectVariantData,
+                                std::vector<double>& costs);
+
+    /**
+     * Costs are stored with full precision to get exactly the same results as
+     * when evaluating the profile at runtime.
+     */
+    static inline uint64_t EncodeCost(double cost)
+    {
+      uint64_t value;
+
+      std::memcpy(&value,&cost,sizeof(value));
+
+      return value;
+    }
+
+    static inline double DecodeCost(uint64_t value)
+    {
+      double cost;
+
+      std::memcpy(&cost,&value,sizeof(cost));
+
+      return cost;
+    }
+
+    bool Load(const std::string& filename);
+
+    inline bool IsLoaded() const
+    {
+      return isLoaded;
+    }
+
+    inline std::string GetFilename() const
+    {
+      return filename;
+    }
+
+    inline Vehicle GetVehicle() const
+    {
+      return vehicle;
+    }
+
+    inline size_t GetNodeCount() const
+    {
+      return nodeOffsets.size();
+    }
+
+    inline size_t GetEdgeCount() const
+    {
+      return edges.size();
+    }
+
+    bool GetCostFactor(const RoutingProfile& profile,
+                       const std::vector<ObjectVariantData>& objectVariantData,
+                       double& costFactor) const;
+
+    bool CalculateRoute(const std::vector<Terminal>& starts,
+                        const std::vector<Terminal>& targets,
+                        double costFactor,
+                        std::vector<Step>& steps,
+                        size_t& settledNodeCount) const;
+  };
+
+  typedef std::shared_ptr<RouteContractionHierarchy> RouteContractionHierarchyRef;
+}
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef OSMSCOUT_ROUTEISOCHRONE_H
+#define OSMSCOUT_ROUTEISOCHRONE_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <vector>
+
+#include <osmscout/CoreFeatures.h>
+
+#include <osmscout/GeoCoord.h>
+#include <osmscout/Types.h>
+
+#include <osmscout/private/CoreImportExport.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Routing
+   * Result of RoutingService::CalculateIsochrone(): all route nodes reachable
+   * from a start position within a maximum cost and optionally the outline
+   * of the reachable area for a number of cost thresholds.
+   *
+   * Time is in hours and distance in km. Costs are the costs as defined by the
+   * routing profile used for the calculation.
+   */
+  class OSMSCOUT_API RouteIsochrone
+  {
+  public:
+    /**
+     * A reachable route node
+     */
+    struct OSMSCOUT_API Node
+    {
+      FileOffset routeNodeOffset; //!< FileOffset of the route node
+      Id         id;              //!< Id of the route node
+      GeoCoord   coord;           //!< Coordinate of the route node
+      double     cost;            //!< Minimum costs to reach the route node
+      double     time;            //!< Time needed on the cheapest path
+      double     distance;        //!< Distance of the cheapest path
+    };
+
+    /**
+     * Outline of the area reachable within the given costs
+     */
+    struct OSMSCOUT_API Area
+    {
+      double                maxCost; //!< Cost threshold
+      std::vector<GeoCoord> outline; //!< Outline (counter-clockwise, not closed) of the area
+    };
+
+  private:
+    std::vector<Node> nodes;
+    std::vector<Area> areas;
+
+  public:
+    RouteIsochrone();
+
+    void Clear();
+
+    void AddNode(const Node& node);
+    void AddArea(const Area& area);
+
+    /**
+     * Return all reachable route nodes in the order of increasing costs
+     */
+    inline const std::vector<Node>& GetNodes() const
+    {
+      return nodes;
+    }
+
+    /**
+     * Return the area outlines in the order of increasing cost thresholds
+     */
+    inline const std::vector<Area>& GetAreas() const
+    {
+      return areas;
+    }
+  };
+}
+
+#endif
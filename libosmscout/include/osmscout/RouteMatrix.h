@@ -0,0 +1,110 @@
+#ifndef OSMSCOUT_ROUTEMATRIX_H
+#define OSMSCOUT_ROUTEMATRIX_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <cstddef>
+#include <vector>
+
+#include <osmscout/CoreFeatures.h>
+
+#include <osmscout/private/CoreImportExport.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Routing
+   * Dense matrix of the costs, travel times and distances from a number of
+   * sources to a number of targets as calculated by
+   * RoutingService::CalculateMatrix().
+   *
+   * Time is in hours and distance in km. Costs are the costs as defined by the
+   * routing profile used for the calculation. If a target is not reachable
+   * from a source, all three values are infinite.
+   */
+  class OSMSCOUT_API RouteMatrix
+  {
+  private:
+    size_t              sourceCount;
+    size_t              targetCount;
+    std::vector<double> costs;
+    std::vector<double> times;
+    std::vector<double> distances;
+
+  private:
+    inline size_t GetIndex(size_t source,
+                           size_t target) const
+    {
+      return source*targetCount+target;
+    }
+
+  public:
+    RouteMatrix();
+
+    void Initialize(size_t sourceCount,
+                    size_t targetCount);
+
+    inline size_t GetSourceCount() const
+    {
+      return sourceCount;
+    }
+
+    inline size_t GetTargetCount() const
+    {
+      return targetCount;
+    }
+
+    bool IsReachable(size_t source,
+                     size_t target) const;
+
+    inline double GetCost(size_t source,
+                          size_t target) const
+    {
+      return costs[GetIndex(source,target)];
+    }
+
+    inline double GetTime(size_t source,
+                          size_t target) const
+    {
+      return times[GetIndex(source,target)];
+    }
+
+    inline double GetDistance(size_t source,
+                              size_t target) const
+    {
+      return distances[GetIndex(source,target)];
+    }
+
+    inline void Set(size_t source,
+                    size_t target,
+                    double cost,
+                    double time,
+                    double distance)
+    {
+      size_t index=GetIndex(source,target);
+
+      costs[index]=cost;
+      times[index]=time;
+      distances[index]=distance;
+    }
+  };
+}
+
+#endif
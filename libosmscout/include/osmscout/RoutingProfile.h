@@ -65,6 +65,9 @@ namespace osmscout {
                             double distance) const = 0;
     virtual double GetCosts(double distance) const = 0;
 
+    virtual double GetTime(const RouteNode& currentNode,
+                           const std::vector<ObjectVariantData>& objectVariantData,
+                           size_t pathIndex) const;
     virtual double GetTime(const Area& area,
                            double distance) const = 0;
     virtual double GetTime(const Way& way,
@@ -120,6 +123,27 @@ namespace osmscout {
     bool CanUseForward(const Way& way) const;
     bool CanUseBackward(const Way& way) const;
 
+    inline double GetTime(const RouteNode& currentNode,
+                          const std::vector<ObjectVariantData>& objectVariantData,
+                          size_t pathIndex) const
+    {
+      double speed;
+      size_t index=currentNode.paths[pathIndex].objectIndex;
+
+      if (objectVariantData[currentNode.objects[index].objectVariantIndex].maxSpeed>0) {
+        speed=objectVariantData[currentNode.objects[index].objectVariantIndex].maxSpeed;
+      }
+      else {
+        TypeInfoRef type=objectVariantData[currentNode.objects[index].objectVariantIndex].type;
+
+        speed=speeds[type->GetIndex()];
+      }
+
+      speed=std::min(vehicleMaxSpeed,speed);
+
+      return currentNode.paths[pathIndex].distance/speed;
+    }
+
     inline double GetTime(const Area& area,
                           double distance) const
     {
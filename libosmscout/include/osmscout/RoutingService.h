@@ -21,11 +21,12 @@
 */
 
 #include <functional>
+#include <limits>
 #include <list>
 #include <memory>
-#include <set>
+#include <mutex>
 #include <unordered_map>
-#include <unordered_set>
+#include <vector>
 
 #include <osmscout/CoreFeatures.h>
 
@@ -41,12 +42,21 @@
 #include <osmscout/ObjectVariantDataFile.h>
 
 // Routing
+#include <osmscout/CompactRouteGraph.h>
 #include <osmscout/Intersection.h>
+#include <osmscout/RoutableSegmentIndex.h>
 #include <osmscout/Route.h>
+#include <osmscout/RouteContractionHierarchy.h>
 #include <osmscout/RouteData.h>
+#include <osmscout/RouteIsochrone.h>
+#include <osmscout/RouteMatrix.h>
 #include <osmscout/RoutingProfile.h>
 
+#include <osmscout/util/Arena.h>
 #include <osmscout/util/Cache.h>
+#include <osmscout/util/ConcurrentCache.h>
+#include <osmscout/util/DAryHeap.h>
+#include <osmscout/util/OpenHashMap.h>
 
 namespace osmscout {
 
@@ -58,19 +68,94 @@ namespace osmscout {
    * instance.
    *
    * The following groups attributes are currently available:
-   * - Switch for showing debug information
+   * - Switch for showing debug information (including search statistics like
+   *   the number of expanded route nodes and the peak memory usage of a query)
+   * - Switch for using contraction hierarchies (if available)
+   * - Switch for using the compact route graph (if available)
+   * - Switch for using the routable segment index (if available)
+   * - Number of threads used for calculations that run in parallel
+   * - Cache sizes for snapped via points, calculated route legs and route
+   *   nodes loaded by matrix calculations
    */
   class OSMSCOUT_API RouterParameter
   {
   private:
     bool          debugPerformance;
+    bool          useContractionHierarchy;
+    bool          useCompactRouteGraph;
+    bool          useRoutableSegmentIndex;
+    size_t        threadCount;
+    size_t        snappedPointCacheSize;
+    size_t        routeLegCacheSize;
+    size_t        routeNodeCacheSize;
+    double        isochroneCellSize;
 
   public:
     RouterParameter();
 
     void SetDebugPerformance(bool debug);
+    void SetUseContractionHierarchy(bool useContractionHierarchy);
+    void SetUseCompactRouteGraph(bool useCompactRouteGraph);
+    void SetUseRoutableSegmentIndex(bool useRoutableSegmentIndex);
+    void SetThreadCount(size_t threadCount);
+    void SetSnappedPointCacheSize(size_t snappedPointCacheSize);
+    void SetRouteLegCacheSize(size_t routeLegCacheSize);
+    void SetRouteNodeCacheSize(size_t routeNodeCacheSize);
+    void SetIsochroneCellSize(double isochroneCellSize);
 
     bool IsDebugPerformance() const;
+    bool IsUseContractionHierarchy() const;
+    bool IsUseCompactRouteGraph() const;
+    bool IsUseRoutableSegmentIndex() const;
+    size_t GetThreadCount() const;
+    size_t GetSnappedPointCacheSize() const;
+    size_t GetRouteLegCacheSize() const;
+    size_t GetRouteNodeCacheSize() const;
+    double GetIsochroneCellSize() const;
+  };
+
+  /**
+   * \ingroup Routing
+   * A position in the routing graph, given by a routable object and the index
+   * of a node of that object (as for example returned by
+   * RoutingService::GetClosestRoutableNode()).
+   */
+  struct OSMSCOUT_API RoutePosition
+  {
+    ObjectFileRef object;
+    size_t        nodeIndex;
+
+    inline RoutePosition()
+    : nodeIndex(0)
+    {
+      // no code
+    }
+
+    inline RoutePosition(const ObjectFileRef& object,
+                         size_t nodeIndex)
+    : object(object),
+      nodeIndex(nodeIndex)
+    {
+      // no code
+    }
+  };
+
+  /**
+   * \ingroup Routing
+   * A way close to a given coordinate, as returned by
+   * RoutingService::GetRouteCandidates().
+   */
+  struct OSMSCOUT_API RouteCandidate
+  {
+    RoutePosition position;  //!< The node of the closest segment of the way that is closer to the coordinate
+    GeoCoord      coord;     //!< The point on the closest segment of the way closest to the coordinate
+    double        distance;  //!< The distance between the coordinate and the way in km
+
+    inline RouteCandidate()
+    : distance(0.0)
+    {
+      // no code
+    }
   };
 
   /**
@@ -84,6 +169,10 @@ namespace osmscout {
    * - Transformation of the resulting route to a routing description with is the base
    * for further transformations to a textual or visual description of the route
    * - Returning the closest routeable node to  given geolocation
+   * - Returning the routable ways close to a given geolocation (candidates
+   * for map matching, see MapMatchingService)
+   * - Calculation of cost, time and distance matrices between a number of
+   * sources and targets
    */
   class OSMSCOUT_API RoutingService
   {
@@ -105,8 +194,11 @@ namespace osmscout {
 
       bool          access;        //!< Flags to signal, if we had access ("access restrictions") to this node
 
+      size_t        heapIndex;     //!< Position in the open list, maintained by the open list
+
       RNode()
-      : nodeOffset(0)
+      : nodeOffset(0),
+        heapIndex(std::numeric_limits<size_t>::max())
       {
         // no code
       }
@@ -121,7 +213,8 @@ namespace osmscout {
         currentCost(0),
         estimateCost(0),
         overallCost(0),
-        access(true)
+        access(true),
+        heapIndex(std::numeric_limits<size_t>::max())
       {
         // no code
       }
@@ -137,7 +230,8 @@ namespace osmscout {
         currentCost(0),
         estimateCost(0),
         overallCost(0),
-        access(true)
+        access(true),
+        heapIndex(std::numeric_limits<size_t>::max())
       {
         // no code
       }
@@ -153,12 +247,16 @@ namespace osmscout {
       }
     };
 
-    typedef std::shared_ptr<RNode> RNodeRef;
+    /**
+     * RNodes are allocated from an arena, that is reset at the start of
+     * each route calculation.
+     */
+    typedef RNode* RNodeRef;
 
     struct RNodeCostCompare
     {
-      inline bool operator()(const RNodeRef& a,
-                             const RNodeRef& b) const
+      inline bool operator()(const RNode* a,
+                             const RNode* b) const
       {
         if (a->overallCost==b->overallCost) {
          return a->nodeOffset<b->nodeOffset;
@@ -198,14 +296,10 @@ namespace osmscout {
       }
 
       /**
-       * Simple inline constructor for searching for VNodes in the
-       * ClosedSet.
-       *
-       * @param currentNode
-       *    Offset of the node to search for
+       * Default constructor for empty slots in the ClosedSet
        */
-      inline VNode(FileOffset currentNode)
-        : currentNode(currentNode),
+      inline VNode()
+        : currentNode(0),
           previousNode(0)
       {
         // no code
@@ -232,23 +326,126 @@ namespace osmscout {
       }
     };
 
+    //! Sorted list (smallest cost first) of route nodes to expand
+    typedef DAryHeap<RNode*,RNodeCostCompare>  OpenList;
+    //! Route nodes in the OpenList by their file offset
+    typedef OpenHashMap<FileOffset,RNode*>     OpenMap;
+    //! Already expanded route nodes by their file offset
+    typedef OpenHashMap<FileOffset,VNode>      ClosedSet;
+
+    /**
+     * Entry (for sources) or exit (for targets) of a matrix search: a route
+     * node together with the costs, time and distance between the position
+     * and the route node.
+     */
+    struct MatrixTerminal
+    {
+      size_t        index;           //!< Index of the source or target
+      FileOffset    routeNodeOffset; //!< FileOffset of the route node
+      ObjectFileRef object;          //!< The object of the position
+      double        cost;
+      double        time;
+      double        distance;
+    };
+
+    //! Target terminals by the file offset of their route node
+    typedef std::unordered_map<FileOffset,std::vector<MatrixTerminal>> MatrixTargetMap;
+
+    /**
+     * Label of a route node during a matrix or isochrone search
+     */
+    struct MatrixNode
+    {
+      FileOffset    nodeOffset;    //!< The file offset of the route node
+      FileOffset    prev;          //!< The file offset of the previous route node
+      ObjectFileRef object;        //!< The object used to reach the route node
+      double        cost;          //!< The costs from the source to the route node
+      double        time;          //!< The time from the source to the route node
+      double        distance;      //!< The distance from the source to the route node
+      bool          access;        //!< Flags to signal, if we had access ("access restrictions") to this node
+      bool          settled;       //!< The costs to the route node are final
+      size_t        heapIndex;     //!< Position in the open list, maintained by the open list
+
+      explicit MatrixNode(FileOffset nodeOffset)
+      : nodeOffset(nodeOffset),
+        prev(0),
+        cost(0),
+        time(0),
+        distance(0),
+        access(true),
+        settled(false),
+        heapIndex(std::numeric_limits<size_t>::max())
+      {
+        // no code
+      }
+    };
+
+    struct MatrixNodeCostCompare
+    {
+      inline bool operator()(const MatrixNode* a,
+                             const MatrixNode* b) const
+      {
+        if (a->cost==b->cost) {
+         return a->nodeOffset<b->nodeOffset;
+        }
+        else {
+          return a->cost<b->cost;
+        }
+      }
+    };
+
     /**
-     * Helper class for calculating hash codes for
-     * VNode instances to make it usable in std::unordered_set.
+     * State of a Dijkstra search (without target) as used for matrix and
+     * isochrone calculation
      */
-    struct ClosedNodeHasher
+    struct MatrixSearch
     {
-      inline size_t operator()(const VNode& node) const
+      Arena<MatrixNode>                           nodes;
+      OpenHashMap<FileOffset,MatrixNode*>         nodeMap;
+      DAryHeap<MatrixNode*,MatrixNodeCostCompare> openList;
+
+      MatrixSearch()
+      : nodes(1024)
       {
-        return std::hash<FileOffset>()(node.currentNode);
+        // no code
       }
     };
 
-    typedef std::set<RNodeRef,RNodeCostCompare>           OpenList;
-    typedef std::set<RNodeRef,RNodeCostCompare>::iterator OpenListRef;
+    //! Route nodes loaded by one search, shared with the other matrix searches
+    typedef ConcurrentCache<FileOffset,RouteNodeRef> MatrixRouteNodeCache;
+
+    /**
+     * Result of GetClosestRoutableNode() for a via point. The query parameters
+     * are stored, too, since the cache key is only a hash of them.
+     */
+    struct SnappedPoint
+    {
+      GeoCoord      coord;
+      Vehicle       vehicle;
+      double        radius;
+      RoutePosition position;
+    };
+
+    /**
+     * Route between two consecutive via points. The profile is identified by
+     * its vehicle and its costs per object variant (see
+     * RouteContractionHierarchy::GetVariantCosts()).
+     */
+    struct RouteLeg
+    {
+      RoutePosition       start;
+      RoutePosition       target;
+      Vehicle             vehicle;
+      std::vector<double> variantCosts;
+      RouteData           route;
+    };
+
+    typedef std::shared_ptr<RouteLeg> RouteLegRef;
 
-    typedef std::unordered_map<FileOffset,OpenListRef>    OpenMap;
-    typedef std::unordered_set<VNode,ClosedNodeHasher>    ClosedSet;
+    //! Snapped via points, key is the hash of the query parameters
+    typedef ConcurrentCache<uint64_t,SnappedPoint> SnappedPointCache;
+    //! Calculated route legs, key is the hash of start, target and profile
+    typedef ConcurrentCache<uint64_t,RouteLegRef>  RouteLegCache;
 
   public:
     //! Relative filename of the intersection data file
@@ -265,12 +462,28 @@ namespace osmscout {
     AccessFeatureValueReader             accessReader;          //!< Read access information from objects
     bool                                 isOpen;                //!< true, if opened
     bool                                 debugPerformance;
+    bool                                 useContractionHierarchy;
+    bool                                 useCompactRouteGraph;
+    bool                                 useRoutableSegmentIndex;
+    size_t                               threadCount;
+    double                               isochroneCellSize;
 
     std::string                          path;                  //!< Path to the directory containing all files
 
     IndexedDataFile<Id,RouteNode>        routeNodeDataFile;     //!< Cached access to the 'route.dat' file
     IndexedDataFile<Id,Intersection>     junctionDataFile;      //!< Cached access to the 'junctions.dat' file
     ObjectVariantDataFile                objectVariantDataFile; //!< DataFile class for loadinfg object variant data
+    std::list<RouteContractionHierarchyRef> contractionHierarchies; //!< Contraction hierarchies available for this router
+    CompactRouteGraphRef                 compactRouteGraph;     //!< Compact copy of the routing graph, if available
+    RoutableSegmentIndexRef              routableSegmentIndex;  //!< Index for GetClosestRoutableNode(), if available
+
+    std::mutex                           rnodeArenaMutex;       //!< Mutex to secure multi-thread access to the arena pool
+    std::vector<std::unique_ptr<Arena<RNode>>> rnodeArenas;    //!< Memory for the RNodes of route calculations, reused between calculations
+    std::mutex                           junctionMutex;         //!< Mutex to secure multi-thread access to the junction data file
+
+    SnappedPointCache                    snappedPointCache;     //!< Recently snapped via points
+    RouteLegCache                        routeLegCache;         //!< Recently calculated route legs
+    MatrixRouteNodeCache                 routeNodeCache;        //!< Route nodes loaded by matrix searches
 
   private:
     std::string GetDataFilename(const std::string& filenamebase) const;
@@ -299,6 +512,7 @@ namespace osmscout {
                                     RouteNodeRef& routeNode);
 
     bool GetStartNodes(const RoutingProfile& profile,
+                       Arena<RNode>& rnodeArena,
                        const ObjectFileRef& object,
                        size_t nodeIndex,
                        double& targetLon,
@@ -329,6 +543,96 @@ namespace osmscout {
 
     bool ResolveRouteDataJunctions(RouteData& route);
 
+    bool GetContractionHierarchy(const RoutingProfile& profile,
+                                 RouteContractionHierarchyRef& hierarchy,
+                                 double& costFactor) const;
+
+    bool CalculateRouteUsingContractionHierarchy(const RoutingProfile& profile,
+                                                 const RouteContractionHierarchy& hierarchy,
+                                                 double costFactor,
+                                                 const ObjectFileRef& startObject,
+                                                 size_t startNodeIndex,
+                                                 const RNodeRef& startForwardNode,
+                                                 const RNodeRef& startBackwardNode,
+                                                 const ObjectFileRef& targetObject,
+                                                 size_t targetNodeIndex,
+                                                 const RouteNodeRef& targetForwardRouteNode,
+                                                 const RouteNodeRef& targetBackwardRouteNode,
+                                                 double targetLon,
+                                                 double targetLat,
+                                                 RouteData& route);
+
+    bool CalculateRouteUsingCompactRouteGraph(const RoutingProfile& profile,
+                                              const std::vector<double>& variantCosts,
+                                              const ObjectFileRef& startObject,
+                                              size_t startNodeIndex,
+                                              const RNodeRef& startForwardNode,
+                                              const RNodeRef& startBackwardNode,
+                                              const ObjectFileRef& targetObject,
+                                              size_t targetNodeIndex,
+                                              const RouteNodeRef& targetForwardRouteNode,
+                                              const RouteNodeRef& targetBackwardRouteNode,
+                                              double targetLon,
+                                              double targetLat,
+                                              RouteData& route);
+
+    std::unique_ptr<Arena<RNode>> AcquireRNodeArena();
+    void ReleaseRNodeArena(std::unique_ptr<Arena<RNode>>& arena);
+
+    bool CalculateRoute(const RoutingProfile& profile,
+                        Arena<RNode>& rnodeArena,
+                        const ObjectFileRef& startObject,
+                        size_t startNodeIndex,
+                        const ObjectFileRef& targetObject,
+                        size_t targetNodeIndex,
+                        RouteData& route);
+
+    size_t GetWorkerCount(size_t threadCount,
+                          size_t taskCount) const;
+    bool RunTasks(const std::vector<std::function<bool()>>& tasks,
+                  size_t threadCount) const;
+
+    bool GetSnappedPoint(const GeoCoord& coord,
+                         Vehicle vehicle,
+                         double radius,
+                         RoutePosition& position);
+
+    bool CalculateRouteLeg(const RoutingProfile& profile,
+                           const std::vector<double>& variantCosts,
+                           uint64_t profileHash,
+                           const RoutePosition& start,
+                           const RoutePosition& target,
+                           RouteData& route);
+
+    bool GetMatrixTerminals(const RoutingProfile& profile,
+                            const RoutePosition& position,
+                            size_t index,
+                            bool isSource,
+                            std::vector<MatrixTerminal>& terminals);
+
+    bool GetMatrixRouteNode(FileOffset offset,
+                            MatrixRouteNodeCache& routeNodeCache,
+                            RouteNodeRef& routeNode,
+                            size_t& loadedCount);
+
+    void AddMatrixStart(MatrixSearch& search,
+                        const MatrixTerminal& terminal) const;
+
+    void ExpandMatrixNode(const RoutingProfile& profile,
+                          MatrixSearch& search,
+                          MatrixNode* current,
+                          const RouteNode& routeNode,
+                          double maxDistance) const;
+
+    bool CalculateMatrixRow(const RoutingProfile& profile,
+                            const std::vector<MatrixTerminal>& sourceTerminals,
+                            const MatrixTargetMap& targetTerminals,
+                            MatrixRouteNodeCache& routeNodeCache,
+                            double maxDistance,
+                            RouteMatrix& matrix,
+                            size_t& settledCount,
+                            size_t& loadedCount);
+
     void AddNodes(RouteData& route,
                   Id startNodeId,
                   size_t startNodeIndex,
@@ -349,6 +653,8 @@ namespace osmscout {
 
     TypeConfigRef GetTypeConfig() const;
 
+    bool HasContractionHierarchy(const RoutingProfile& profile) const;
+
     bool CalculateRoute(const RoutingProfile& profile,
                         const ObjectFileRef& startObject,
                         size_t startNodeIndex,
@@ -362,6 +668,30 @@ namespace osmscout {
                         std::vector<GeoCoord> via,
                         RouteData& route);
 
+    bool CalculateMatrix(const RoutingProfile& profile,
+                         const std::vector<RoutePosition>& sources,
+                         const std::vector<RoutePosition>& targets,
+                         RouteMatrix& matrix);
+
+    bool CalculateMatrix(const RoutingProfile& profile,
+                         const std::vector<RoutePosition>& sources,
+                         const std::vector<RoutePosition>& targets,
+                         double maxDistance,
+                         RouteMatrix& matrix);
+
+    bool CalculateMatrix(const RoutingProfile& profile,
+                         const std::vector<RoutePosition>& sources,
+                         const std::vector<RoutePosition>& targets,
+                         double maxDistance,
+                         size_t threadCount,
+                         RouteMatrix& matrix);
+
+    bool CalculateIsochrone(const RoutingProfile& profile,
+                            const RoutePosition& start,
+                            double maxCost,
+                            const std::vector<double>& thresholds,
+                            RouteIsochrone& isochrone);
+
     bool TransformRouteDataToWay(const RouteData& data,
                                  Way& way);
 
@@ -382,6 +712,17 @@ namespace osmscout {
                                 ObjectFileRef& object,
                                 size_t& nodeIndex) const;
 
+    bool SnapPoints(const std::vector<GeoCoord>& coords,
+                    Vehicle vehicle,
+                    double radius,
+                    std::vector<RoutePosition>& positions) const;
+
+    bool GetRouteCandidates(const GeoCoord& coord,
+                            Vehicle vehicle,
+                            double radius,
+                            size_t maxCount,
+                            std::vector<RouteCandidate>& candidates) const;
+
     void DumpStatistics();
   };
 
@@ -0,0 +1,112 @@
+#ifndef OSMSCOUT_UTIL_ARENA_H
+#define OSMSCOUT_UTIL_ARENA_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/CoreFeatures.h>
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Util
+   * Simple arena allocator for objects of class T that all have the same
+   * lifetime, like temporary objects of one calculation.
+   *
+   * Objects are allocated in blocks of a fixed number of objects. Allocating
+   * an object only constructs it in place in the current block. All objects
+   * are destroyed at once by calling Reset(). The memory of the blocks is kept
+   * and reused by following allocations.
+   *
+   * Pointers returned by Allocate() stay valid until the next call to Reset().
+   */
+  template <class T>
+  class Arena
+  {
+  private:
+    size_t                      blockSize;
+    std::vector<std::vector<T>> blocks;
+    size_t                      currentBlock;
+    size_t                      size;
+
+  public:
+    explicit Arena(size_t blockSize=4096)
+    : blockSize(blockSize),
+      currentBlock(0),
+      size(0)
+    {
+      // no code
+    }
+
+    template<typename... Args>
+    T* Allocate(Args&&... args)
+    {
+      if (currentBlock<blocks.size() &&
+          blocks[currentBlock].size()==blockSize) {
+        currentBlock++;
+      }
+
+      if (currentBlock==blocks.size()) {
+        blocks.push_back(std::vector<T>());
+        blocks.back().reserve(blockSize);
+      }
+
+      // The block never reallocates, since its capacity is never exceeded
+      blocks[currentBlock].emplace_back(std::forward<Args>(args)...);
+      size++;
+
+      return &blocks[currentBlock].back();
+    }
+
+    /**
+     * Destroys all allocated objects. Allocated memory is kept.
+     */
+    void Reset()
+    {
+      for (auto& block : blocks) {
+        block.clear();
+      }
+
+      currentBlock=0;
+      size=0;
+    }
+
+    /**
+     * Returns the number of objects allocated since the last Reset()
+     */
+    inline size_t Size() const
+    {
+      return size;
+    }
+
+    /**
+     * Returns the size of the memory allocated by the arena in bytes
+     */
+    inline size_t GetMemoryUsage() const
+    {
+      return blocks.size()*blockSize*sizeof(T);
+    }
+  };
+}
+
+#endif
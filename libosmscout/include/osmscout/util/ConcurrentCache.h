@@ -0,0 +1,422 @@
+#ifndef OSMSCOUT_CONCURRENTCACHE_H
+#define OSMSCOUT_CONCURRENTCACHE_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/CoreFeatures.h>
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <osmscout/util/Cache.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Util
+   * Thread-safe cache with CLOCK (second chance) eviction.
+   *
+   * Template parameter class K holds the key value, parameter class V
+   * holds the data class that is to be cached. Values are returned by copy, so
+   * V should be cheap to copy (a std::shared_ptr or a small struct).
+   *
+   * * The cache is threadsafe. Keys are distributed over a number of shards,
+   *   each shard is protected by its own mutex (lock striping), so threads
+   *   accessing different keys rarely contend.
+   * * A cache hit only sets a "referenced" flag on the entry instead of
+   *   reordering a list, entries stay at their position in a contiguous
+   *   slot array.
+   * * On insertion the clock hand of the shard sweeps over the slots, clearing
+   *   the referenced flag of recently used entries and evicting the first entry
+   *   that has not been referenced since the last sweep.
+   * * If a ValueSizer is passed, the maximum size is a budget in bytes as
+   *   returned by the sizer, else it is the maximum number of entries.
+   *   The budget is split evenly between the shards.
+   */
+  template <class K, class V>
+  class ConcurrentCache
+  {
+  public:
+    /**
+     * ValueSizer returns the size (in bytes) of an individual cache value.
+     * Sizers written for Cache can be used unchanged.
+     */
+    typedef typename Cache<K,V>::ValueSizer ValueSizer;
+
+    static const size_t DEFAULT_SHARD_COUNT=16;
+
+  private:
+    struct Slot
+    {
+      K      key;
+      V      value;
+      size_t size;
+      bool   referenced;
+      bool   used;
+    };
+
+    struct Shard
+    {
+      std::mutex                   mutex;
+      std::unordered_map<K,size_t> map;       //!< Index of the slot holding the given key
+      std::vector<Slot>            slots;
+      std::vector<size_t>          freeSlots; //!< Index of currently unused slots
+      size_t                       hand;      //!< Current position of the clock hand
+      size_t                       size;      //!< Current size of the shard in entries or bytes
+      size_t                       maxSize;   //!< Maximum size of the shard in entries or bytes
+      size_t                       hits;      //!< Number of successful lookups
+      size_t                       misses;    //!< Number of failed lookups
+
+      Shard()
+      : hand(0),
+        size(0),
+        maxSize(0),
+        hits(0),
+        misses(0)
+      {
+        // no code
+      }
+    };
+
+  private:
+    size_t                              maxSize;
+    const ValueSizer*                   sizer;
+    std::vector<std::unique_ptr<Shard>> shards;
+    size_t                              shardMask;
+
+  private:
+    inline Shard& GetShard(const K& key) const
+    {
+      uint64_t hash=(uint64_t)std::hash<K>()(key);
+
+      // Mix the bits, since std::hash is often the identity function for numbers
+      hash^=hash >> 33;
+      hash*=0xff51afd7ed558ccdULL;
+      hash^=hash >> 33;
+
+      return *shards[(size_t)hash & shardMask];
+    }
+
+    inline size_t GetEntrySize(const V& value) const
+    {
+      if (sizer!=NULL) {
+        return sizer->GetSize(value);
+      }
+
+      return 1;
+    }
+
+    /**
+     * Remove the entry at the current clock hand position, giving entries
+     * with the referenced flag set a second chance.
+     *
+     * Must be called with the shard mutex locked and at least one entry in
+     * the shard.
+     */
+    void EvictEntry(Shard& shard)
+    {
+      while (true) {
+        Slot& slot=shard.slots[shard.hand];
+        size_t index=shard.hand;
+
+        shard.hand=(shard.hand+1)%shard.slots.size();
+
+        if (!slot.used) {
+          continue;
+        }
+
+        if (slot.referenced) {
+          slot.referenced=false;
+          continue;
+        }
+
+        shard.map.erase(slot.key);
+        shard.size-=slot.size;
+
+        slot.value=V();
+        slot.used=false;
+
+        shard.freeSlots.push_back(index);
+
+        return;
+      }
+    }
+
+    void StripShard(Shard& shard, size_t requiredSize)
+    {
+      while (!shard.map.empty() &&
+             shard.size+requiredSize>shard.maxSize) {
+        EvictEntry(shard);
+      }
+    }
+
+    void DistributeMaxSize()
+    {
+      size_t shardMaxSize=(maxSize+shards.size()-1)/shards.size();
+
+      for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+
+        shard->maxSize=shardMaxSize;
+
+        StripShard(*shard,0);
+      }
+    }
+
+  public:
+    /**
+     * Create a new cache object with the given max size.
+     *
+     * If sizer is not NULL, maxSize is a budget in bytes. The sizer must
+     * stay valid during the lifetime of the cache.
+     */
+    ConcurrentCache(size_t maxSize,
+                    const ValueSizer* sizer=NULL,
+                    size_t shardCount=DEFAULT_SHARD_COUNT)
+    : maxSize(maxSize),
+      sizer(sizer)
+    {
+      size_t count=1;
+
+      // Use a power of two and do not create more shards than entries
+      while (count*2<=shardCount &&
+             (sizer!=NULL || count*2<=maxSize)) {
+        count*=2;
+      }
+
+      shards.reserve(count);
+
+      for (size_t i=0; i<count; i++) {
+        shards.push_back(std::unique_ptr<Shard>(new Shard()));
+      }
+
+      shardMask=count-1;
+
+      DistributeMaxSize();
+    }
+
+    /**
+     * Returns if the cache is active (maxSize > 0)
+     */
+    bool IsActive() const
+    {
+      return maxSize>0;
+    }
+
+    /**
+     * Copy the value with the given key from the cache into value.
+     *
+     * If there is no valued stored with the given key, false will be
+     * returned and value will be untouched.
+     */
+    bool GetEntry(const K& key,
+                  V& value) const
+    {
+      if (!IsActive()) {
+        return false;
+      }
+
+      Shard&                      shard=GetShard(key);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto                        entry=shard.map.find(key);
+
+      if (entry==shard.map.end()) {
+        shard.misses++;
+
+        return false;
+      }
+
+      Slot& slot=shard.slots[entry->second];
+
+      slot.referenced=true;
+      value=slot.value;
+
+      shard.hits++;
+
+      return true;
+    }
+
+    /**
+     * Set or update the cache with the given value for the given key,
+     * evicting entries if the budget of the shard is exceeded.
+     */
+    void SetEntry(const K& key,
+                  const V& value)
+    {
+      if (!IsActive()) {
+        return;
+      }
+
+      size_t                      entrySize=GetEntrySize(value);
+      Shard&                      shard=GetShard(key);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto                        entry=shard.map.find(key);
+
+      if (entry!=shard.map.end()) {
+        Slot& slot=shard.slots[entry->second];
+
+        shard.size-=slot.size;
+        slot.value=value;
+        slot.size=entrySize;
+        slot.referenced=true;
+        shard.size+=entrySize;
+
+        StripShard(shard,0);
+
+        return;
+      }
+
+      StripShard(shard,entrySize);
+
+      size_t index;
+
+      if (!shard.freeSlots.empty()) {
+        index=shard.freeSlots.back();
+        shard.freeSlots.pop_back();
+      }
+      else {
+        index=shard.slots.size();
+        shard.slots.push_back(Slot());
+      }
+
+      Slot& slot=shard.slots[index];
+
+      slot.key=key;
+      slot.value=value;
+      slot.size=entrySize;
+      slot.referenced=false;
+      slot.used=true;
+
+      shard.map[key]=index;
+      shard.size+=entrySize;
+    }
+
+    /**
+     * Set a new cache max size, possibly evicting entries
+     * from cache if the new size is smaller than the old one.
+     *
+     * The number of shards is not changed.
+     */
+    void SetMaxSize(size_t maxSize)
+    {
+      this->maxSize=maxSize;
+
+      DistributeMaxSize();
+    }
+
+    /**
+     * Returns the maximum size of the cache
+     */
+    size_t GetMaxSize() const
+    {
+      return maxSize;
+    }
+
+    /**
+     * Completely flush the cache removing all entries from it.
+     */
+    void Flush()
+    {
+      for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+
+        shard->map.clear();
+        shard->slots.clear();
+        shard->freeSlots.clear();
+        shard->hand=0;
+        shard->size=0;
+      }
+    }
+
+    /**
+     * Returns the current number of entries in the cache.
+     */
+    size_t GetSize() const
+    {
+      size_t size=0;
+
+      for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+
+        size+=shard->map.size();
+      }
+
+      return size;
+    }
+
+    size_t GetMemory(const ValueSizer& sizer) const
+    {
+      size_t memory=0;
+
+      for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+
+        memory+=shard->map.size()*(sizeof(K)+sizeof(size_t));
+        memory+=shard->slots.size()*sizeof(Slot);
+
+        for (const auto& slot : shard->slots) {
+          if (slot.used) {
+            memory+=sizer.GetSize(slot.value);
+          }
+        }
+      }
+
+      return memory;
+    }
+
+    /**
+     * Return the number of cache hits and misses since creation of the cache.
+     */
+    void GetHitStatistics(size_t& hits,
+                          size_t& misses) const
+    {
+      hits=0;
+      misses=0;
+
+      for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+
+        hits+=shard->hits;
+        misses+=shard->misses;
+      }
+    }
+
+    /**
+     * Dump some cache statistics to std::cout.
+     */
+    void DumpStatistics(const char* cacheName, const ValueSizer& sizer) const
+    {
+      size_t hits;
+      size_t misses;
+
+      GetHitStatistics(hits,misses);
+
+      std::cout << cacheName << " entries: " << GetSize() << ", memory " << GetMemory(sizer);
+      std::cout << ", hits " << hits << ", misses " << misses << std::endl;
+    }
+  };
+}
+
+#endif
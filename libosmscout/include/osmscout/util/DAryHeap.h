@@ -0,0 +1,233 @@
+#ifndef OSMSCOUT_UTIL_DARYHEAP_H
+#define OSMSCOUT_UTIL_DARYHEAP_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/CoreFeatures.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Util
+   * Priority queue implemented as implicit d-ary heap with decrease-key
+   * support.
+   *
+   * Class T must be a pointer to a struct or class that has a member
+   * 'size_t heapIndex'. The heap stores the current position of each element
+   * in this member, so that the position of an element with changed priority
+   * can be updated in O(log n) without searching it. The heap does not own the
+   * elements.
+   *
+   * Compare must be a strict weak ordering, the element for which Compare
+   * returns true against all other elements is at the top of the heap. For a
+   * deterministic order of elements with equal priority Compare should
+   * define a total order.
+   *
+   * A higher arity D reduces the height of the heap and improves cache
+   * locality for Push() and DecreaseKey() at the cost of more comparisons
+   * during Pop().
+   */
+  template <class T, class Compare, size_t D=4>
+  class DAryHeap
+  {
+  public:
+    //! Value of heapIndex for elements not in the heap
+    static const size_t INVALID_INDEX=std::numeric_limits<size_t>::max();
+
+  private:
+    std::vector<T> heap;
+    Compare        compare;
+
+  private:
+    inline void Set(size_t index,
+                    T element)
+    {
+      heap[index]=element;
+      element->heapIndex=index;
+    }
+
+    void SiftUp(size_t index)
+    {
+      T element=heap[index];
+
+      while (index>0) {
+        size_t parent=(index-1)/D;
+
+        if (!compare(element,heap[parent])) {
+          break;
+        }
+
+        Set(index,heap[parent]);
+        index=parent;
+      }
+
+      Set(index,element);
+    }
+
+    void SiftDown(size_t index)
+    {
+      T      element=heap[index];
+      size_t size=heap.size();
+
+      while (true) {
+        size_t firstChild=index*D+1;
+
+        if (firstChild>=size) {
+          break;
+        }
+
+        size_t lastChild=std::min(firstChild+D,size);
+        size_t bestChild=firstChild;
+
+        for (size_t child=firstChild+1; child<lastChild; child++) {
+          if (compare(heap[child],heap[bestChild])) {
+            bestChild=child;
+          }
+        }
+
+        if (!compare(heap[bestChild],element)) {
+          break;
+        }
+
+        Set(index,heap[bestChild]);
+        index=bestChild;
+      }
+
+      Set(index,element);
+    }
+
+  public:
+    explicit DAryHeap(const Compare& compare=Compare())
+    : compare(compare)
+    {
+      // no code
+    }
+
+    inline bool Empty() const
+    {
+      return heap.empty();
+    }
+
+    inline size_t Size() const
+    {
+      return heap.size();
+    }
+
+    inline void Reserve(size_t size)
+    {
+      heap.reserve(size);
+    }
+
+    /**
+     * Removes all elements from the heap. Allocated memory is kept.
+     */
+    void Clear()
+    {
+      for (const auto& element : heap) {
+        element->heapIndex=INVALID_INDEX;
+      }
+
+      heap.clear();
+    }
+
+    /**
+     * Returns the size of the memory allocated by the heap in bytes
+     */
+    inline size_t GetMemoryUsage() const
+    {
+      return heap.capacity()*sizeof(T);
+    }
+
+    inline bool Contains(const T& element) const
+    {
+      return element->heapIndex<heap.size() &&
+             heap[element->heapIndex]==element;
+    }
+
+    void Push(T element)
+    {
+      heap.push_back(element);
+      SiftUp(heap.size()-1);
+    }
+
+    inline T Top() const
+    {
+      assert(!heap.empty());
+
+      return heap.front();
+    }
+
+    T Pop()
+    {
+      assert(!heap.empty());
+
+      T top=heap.front();
+      T last=heap.back();
+
+      heap.pop_back();
+
+      if (!heap.empty()) {
+        Set(0,last);
+        SiftDown(0);
+      }
+
+      top->heapIndex=INVALID_INDEX;
+
+      return top;
+    }
+
+    /**
+     * Must be called after the priority of an element that is part of the
+     * heap has been increased (that means, Compare now orders it further
+     * to the top).
+     */
+    void DecreaseKey(T element)
+    {
+      assert(Contains(element));
+
+      SiftUp(element->heapIndex);
+    }
+
+    /**
+     * Must be called after the priority of an element that is part of the
+     * heap has been changed in an unknown direction.
+     */
+    void Update(T element)
+    {
+      assert(Contains(element));
+
+      size_t index=element->heapIndex;
+
+      SiftUp(index);
+
+      if (heap[index]==element) {
+        SiftDown(index);
+      }
+    }
+  };
+}
+
+#endif
@@ -72,7 +72,7 @@ namespace osmscout {
     std::FILE            *file;          //!< Internal low level file handle
     mutable bool         hasError;       //!< Flag to signal errors in the stream
 
-    // For mmap usage
+    // For mmap usage or reading from memory
     char                 *buffer;        //!< Pointer to the file memory
     FileOffset           size;           //!< Size of the memory/file
     FileOffset           offset;         //!< Current offset into the file memory
@@ -97,19 +97,22 @@ namespace osmscout {
     void Open(const std::string& filename,
               Mode mode,
               bool useMmap);
+    void Open(const std::string& filename,
+              const char* data,
+              size_t size);
     void Close();
     void CloseFailsafe();
 
     inline bool IsOpen() const
     {
-      return file!=NULL;
+      return file!=NULL || buffer!=NULL;
     }
 
     bool IsEOF() const;
 
     inline  bool HasError() const
     {
-      return file==NULL || hasError;
+      return !IsOpen() || hasError;
     }
 
     std::string GetFilename() const;
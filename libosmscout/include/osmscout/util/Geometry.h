@@ -878,6 +878,25 @@ namespace osmscout {
    */
   extern OSMSCOUT_API double NormalizeRelativeAngel(double angle);
 
+  /**
+   * \ingroup Geometry
+   * Calculates the outline of the area covered by the given line segments
+   * (treating longitude and latitude as cartesian coordinates) on a grid with
+   * cells of the given width (longitude) and height (latitude).
+   *
+   * All grid cells touched by a segment are covered, holes are filled.
+   * Concave parts of the area not covered by any segment are not part of the
+   * outline. The segments should form a connected network, else only the
+   * outline of one part is returned.
+   *
+   * The outline follows the cell borders and is returned in counter-clockwise
+   * order without repeating the first point.
+   */
+  extern OSMSCOUT_API void GetGridOutline(const std::vector<std::pair<GeoCoord,GeoCoord>>& segments,
+                                          double cellWidth,
+                                          double cellHeight,
+                                          std::vector<GeoCoord>& outline);
+
   struct OSMSCOUT_API ScanCell
   {
     int x;
@@ -0,0 +1,113 @@
+#ifndef OSMSCOUT_UTIL_MEMORYMAPPEDFILE_H
+#define OSMSCOUT_UTIL_MEMORYMAPPEDFILE_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <osmscout/private/CoreImportExport.h>
+
+#include <osmscout/CoreFeatures.h>
+
+#include <osmscout/Types.h>
+
+#include <osmscout/util/Exception.h>
+
+#if defined(__WIN32__) || defined(WIN32)
+  #include <windows.h>
+  #undef max
+  #undef min
+#endif
+
+namespace osmscout {
+
+  /**
+    \ingroup File
+
+    Read only access to the complete content of a file as one block of memory.
+
+    In contrast to FileScanner, which decodes data while reading, this class is
+    meant for files that store fixed size records, that can be accessed in
+    place without any parsing.
+
+    The file is mapped into the memory of the process if mmap (or the
+    corresponding Windows API) is available. If mapping fails, the content of
+    the file is read into a heap allocated buffer instead, so callers do not
+    have to care about the difference.
+    */
+  class OSMSCOUT_API MemoryMappedFile
+  {
+  private:
+    std::string       filename;   //!< Filename
+    std::FILE         *file;      //!< Internal low level file handle
+    FileOffset        size;       //!< Size of the memory/file
+    char              *buffer;    //!< Pointer to the mapped file memory
+    std::vector<char> fallback;   //!< File content, if mapping is not possible
+
+#if defined(__WIN32__) || defined(WIN32)
+    HANDLE            mmfHandle;
+#endif
+
+  private:
+    void FreeBuffer();
+
+  public:
+    MemoryMappedFile();
+    virtual ~MemoryMappedFile();
+
+    void Open(const std::string& filename);
+    void Close();
+    void CloseFailsafe();
+
+    inline bool IsOpen() const
+    {
+      return file!=NULL;
+    }
+
+    /**
+     * Returns true, if the file content is memory mapped and not copied
+     * into the heap
+     */
+    inline bool IsMemoryMapped() const
+    {
+      return buffer!=NULL;
+    }
+
+    std::string GetFilename() const;
+
+    /**
+     * Return a pointer to the content of the file. The pointer stays valid
+     * until the file is closed.
+     */
+    inline const char* GetData() const
+    {
+      return buffer!=NULL ? buffer : fallback.data();
+    }
+
+    inline FileOffset GetSize() const
+    {
+      return size;
+    }
+  };
+}
+
+#endif
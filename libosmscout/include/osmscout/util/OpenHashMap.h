@@ -0,0 +1,329 @@
+#ifndef OSMSCOUT_UTIL_OPENHASHMAP_H
+#define OSMSCOUT_UTIL_OPENHASHMAP_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/CoreFeatures.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Util
+   * Hash map with open addressing (linear probing) for integral keys like
+   * FileOffset or Id.
+   *
+   * In contrast to std::unordered_map all entries are stored in one
+   * contiguous slot array, so inserting an entry does not allocate memory
+   * (besides growing the array) and lookups do not have to follow pointers.
+   * Deleted entries are removed by shifting following entries of the same
+   * probe sequence backwards, so the map does not degrade with tombstones.
+   *
+   * Pointers returned by Find() and operator[] are invalidated by any
+   * following insertion or deletion.
+   */
+  template <class K, class V>
+  class OpenHashMap
+  {
+    static_assert(std::is_integral<K>::value,"OpenHashMap requires an integral key type");
+
+  private:
+    struct Slot
+    {
+      K    key;
+      V    value;
+      bool used;
+
+      Slot()
+      : key(0),
+        value(),
+        used(false)
+      {
+        // no code
+      }
+    };
+
+    static const size_t MIN_CAPACITY=16;
+
+  private:
+    std::vector<Slot> slots;
+    size_t            mask;
+    size_t            size;
+
+  private:
+    inline size_t GetHomeSlot(K key) const
+    {
+      // Fibonacci hashing, spreads sequential keys over the whole table
+      uint64_t hash=static_cast<uint64_t>(key)*UINT64_C(0x9E3779B97F4A7C15);
+
+      return static_cast<size_t>(hash ^ (hash >> 32)) & mask;
+    }
+
+    inline bool NeedsGrowth() const
+    {
+      // Maximum load factor of 0.7
+      return (size+1)*10>slots.size()*7;
+    }
+
+    void Rehash(size_t capacity)
+    {
+      std::vector<Slot> oldSlots(capacity);
+
+      oldSlots.swap(slots);
+      mask=capacity-1;
+
+      for (auto& slot : oldSlots) {
+        if (slot.used) {
+          size_t index=GetHomeSlot(slot.key);
+
+          while (slots[index].used) {
+            index=(index+1) & mask;
+          }
+
+          slots[index].key=slot.key;
+          slots[index].value=std::move(slot.value);
+          slots[index].used=true;
+        }
+      }
+    }
+
+    inline size_t FindSlot(K key) const
+    {
+      if (size==0) {
+        return slots.size();
+      }
+
+      size_t index=GetHomeSlot(key);
+
+      while (slots[index].used) {
+        if (slots[index].key==key) {
+          return index;
+        }
+
+        index=(index+1) & mask;
+      }
+
+      return slots.size();
+    }
+
+  public:
+    OpenHashMap()
+    : mask(0),
+      size(0)
+    {
+      // no code
+    }
+
+    inline bool Empty() const
+    {
+      return size==0;
+    }
+
+    inline size_t Size() const
+    {
+      return size;
+    }
+
+    /**
+     * Make sure that the map can hold the given number of entries without
+     * rehashing
+     */
+    void Reserve(size_t entries)
+    {
+      size_t capacity=MIN_CAPACITY;
+
+      while (capacity*7<entries*10) {
+        capacity*=2;
+      }
+
+      if (capacity>slots.size()) {
+        Rehash(capacity);
+      }
+    }
+
+    /**
+     * Removes all entries. Allocated memory is kept.
+     */
+    void Clear()
+    {
+      if (size==0) {
+        return;
+      }
+
+      for (auto& slot : slots) {
+        if (slot.used) {
+          slot.value=V();
+          slot.used=false;
+        }
+      }
+
+      size=0;
+    }
+
+    /**
+     * Returns the size of the memory allocated by the map in bytes
+     */
+    inline size_t GetMemoryUsage() const
+    {
+      return slots.capacity()*sizeof(Slot);
+    }
+
+    inline bool Contains(K key) const
+    {
+      return FindSlot(key)!=slots.size();
+    }
+
+    inline V* Find(K key)
+    {
+      size_t index=FindSlot(key);
+
+      return index!=slots.size() ? &slots[index].value : nullptr;
+    }
+
+    inline const V* Find(K key) const
+    {
+      size_t index=FindSlot(key);
+
+      return index!=slots.size() ? &slots[index].value : nullptr;
+    }
+
+    /**
+     * Inserts the value for the given key, if the key is not already part of
+     * the map.
+     *
+     * @return
+     *    true, if the value was inserted, false if the map already had an
+     *    entry for the key (which is left unchanged)
+     */
+    bool Insert(K key,
+                const V& value)
+    {
+      if (NeedsGrowth()) {
+        Rehash(slots.empty() ? MIN_CAPACITY : slots.size()*2);
+      }
+
+      size_t index=GetHomeSlot(key);
+
+      while (slots[index].used) {
+        if (slots[index].key==key) {
+          return false;
+        }
+
+        index=(index+1) & mask;
+      }
+
+      slots[index].key=key;
+      slots[index].value=value;
+      slots[index].used=true;
+      size++;
+
+      return true;
+    }
+
+    /**
+     * Returns the value for the given key, inserting a default constructed
+     * value if the key is not yet part of the map.
+     */
+    V& operator[](K key)
+    {
+      if (NeedsGrowth()) {
+        Rehash(slots.empty() ? MIN_CAPACITY : slots.size()*2);
+      }
+
+      size_t index=GetHomeSlot(key);
+
+      while (slots[index].used) {
+        if (slots[index].key==key) {
+          return slots[index].value;
+        }
+
+        index=(index+1) & mask;
+      }
+
+      slots[index].key=key;
+      slots[index].value=V();
+      slots[index].used=true;
+      size++;
+
+      return slots[index].value;
+    }
+
+    /**
+     * Removes the entry for the given key
+     *
+     * @return
+     *    true, if there was an entry, else false
+     */
+    bool Erase(K key)
+    {
+      size_t hole=FindSlot(key);
+
+      if (hole==slots.size()) {
+        return false;
+      }
+
+      slots[hole].value=V();
+      slots[hole].used=false;
+      size--;
+
+      // Move following entries of the probe sequence into the hole, if
+      // the hole lies between their home slot and their current slot
+      size_t index=hole;
+
+      while (true) {
+        index=(index+1) & mask;
+
+        if (!slots[index].used) {
+          break;
+        }
+
+        size_t home=GetHomeSlot(slots[index].key);
+        bool   canMove;
+
+        if (hole<=index) {
+          canMove=home<=hole || home>index;
+        }
+        else {
+          canMove=home<=hole && home>index;
+        }
+
+        if (canMove) {
+          slots[hole].key=slots[index].key;
+          slots[hole].value=std::move(slots[index].value);
+          slots[hole].used=true;
+
+          slots[index].value=V();
+          slots[index].used=false;
+
+          hole=index;
+        }
+      }
+
+      return true;
+    }
+  };
+}
+
+#endif
@@ -23,6 +23,7 @@
 #include <osmscout/private/CoreImportExport.h>
 
 #include <osmscout/GeoCoord.h>
+#include <osmscout/Point.h>
 
 #include <osmscout/util/GeoBox.h>
 #include <osmscout/util/Magnification.h>
@@ -136,12 +137,84 @@ namespace osmscout {
       }
     };
 
+    /**
+     * Description of the transformation of a projection, used by the ArrayTransformer.
+     * Geo coordinates are transformed to pixel coordinates by
+     *
+     *   u=lon*lonScale+lonOffset
+     *   v=f(lat)*latScale+latOffset
+     *   x=u*xu+v*xv+x0
+     *   y=u*yu+v*yv+y0
+     *
+     * with f(lat)=atanh(sin(lat*gradtorad)) or f(lat)=lat, if linear is true.
+     */
+    struct OSMSCOUT_API ArrayTransformation
+    {
+      bool   linear;
+      double lonScale;
+      double lonOffset;
+      double latScale;
+      double latOffset;
+      double xu;
+      double xv;
+      double x0;
+      double yu;
+      double yv;
+      double y0;
+    };
+
+    /**
+     * Transforms arrays of points to pixel coordinates in one call.
+     *
+     * If the projection can describe itself as an ArrayTransformation, the points
+     * are transformed by a SIMD implementation (AVX2 or SSE2, depending on
+     * the CPU), else GeoToPixel() of the projection is called for each point.
+     *
+     * The SIMD implementations use their own polynomial approximation of the mercator
+     * function, the result differs from GeoToPixel() by less than a thousandth pixel.
+     */
+    class OSMSCOUT_API ArrayTransformer
+    {
+    public:
+      enum Implementation
+      {
+        implementationScalar = 0, //!< Scalar reference implementation
+        implementationSSE2   = 1, //!< 2 points at once using SSE2
+        implementationAVX2   = 2  //!< 4 points at once using AVX2 and FMA
+      };
+
+    private:
+      const Projection&   projection;
+      ArrayTransformation transformation;
+      bool                hasTransformation;
+      Implementation      implementation;
+
+    public:
+      explicit ArrayTransformer(const Projection& projection);
+
+      void SetImplementation(Implementation implementation);
+
+      inline Implementation GetImplementation() const
+      {
+        return implementation;
+      }
+
+      static Implementation GetBestImplementation();
+
+      void GeoToPixel(const Point* points,
+                      size_t count,
+                      double* x,
+                      double* y) const;
+    };
+
     Projection();
     virtual ~Projection();
 
     virtual bool CanBatch() const = 0;
     virtual bool IsValid() const = 0;
 
+    virtual bool GetArrayTransformation(ArrayTransformation& transformation) const;
+
     inline GeoCoord GetCenter() const
     {
       return GeoCoord(lat,lon);
@@ -514,6 +587,8 @@ namespace osmscout {
       this->useLinearInterpolation=useLinearInterpolation;
     }
 
+    bool GetArrayTransformation(ArrayTransformation& transformation) const;
+
   protected:
     void GeoToPixel(const BatchTransformer& transformData) const;
   };
@@ -607,6 +682,8 @@ namespace osmscout {
       useLinearInterpolation = b;
     }
 
+    bool GetArrayTransformation(ArrayTransformation& transformation) const;
+
   protected:
 
     void GeoToPixel(const BatchTransformer& transformData) const;
@@ -45,10 +45,17 @@ namespace osmscout {
   class OSMSCOUT_API TransPolygon
   {
   private:
-    size_t  pointsSize;
-    size_t  length;
-    size_t  start;
-    size_t  end;
+    size_t              pointsSize;
+    size_t              length;
+    size_t              start;
+    size_t              end;
+    std::vector<double> xBuffer;    //!< Result of the array transformation (x)
+    std::vector<double> yBuffer;    //!< Result of the array transformation (y)
+    bool                clip;       //!< Drop points outside the clipping rectangle
+    double              clipXMin;
+    double              clipYMin;
+    double              clipXMax;
+    double              clipYMax;
 
   public:
     enum OptimizeMethod
@@ -70,10 +77,12 @@ namespace osmscout {
 
   private:
     void TransformGeoToPixel(const Projection& projection,
-                             const std::vector<Point>& nodes);
-    void DropSimilarPoints(double optimizeErrorTolerance);
+                             const std::vector<Point>& nodes,
+                             bool dropSimilarPoints,
+                             double optimizeErrorTolerance);
     void DropRedundantPointsFast(double optimizeErrorTolerance);
     void DropRedundantPointsDouglasPeucker(double optimizeErrorTolerance, bool isArea);
+    void CalculateStartEndLength(size_t count);
 
   public:
     TransPolygon();
@@ -99,6 +108,10 @@ namespace osmscout {
       return end;
     }
 
+    void SetClipRect(double xMin, double yMin,
+                     double xMax, double yMax);
+    void ResetClipRect();
+
     void TransformArea(const Projection& projection,
                        OptimizeMethod optimize,
                        const std::vector<Point>& nodes,
@@ -0,0 +1,140 @@
+#ifndef OSMSCOUT_UTIL_WORKERPOOL_H
+#define OSMSCOUT_UTIL_WORKERPOOL_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/CoreFeatures.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <osmscout/private/CoreImportExport.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Util
+   *
+   * A group of tasks, that are pushed to a WorkerPool together. All tasks of a group
+   * are queued at the same worker, so related tasks (like the loading tasks
+   * of one tile) are likely processed by the same thread. Idle workers steal single
+   * tasks from other workers.
+   */
+  class OSMSCOUT_API WorkerTaskGroup
+  {
+  public:
+    typedef std::function<void()> Task;
+
+  private:
+    std::vector<Task> tasks;
+
+  public:
+    /**
+     * Add a task to the group and return a future for its result.
+     */
+    template<typename R>
+    std::future<R> Add(const std::function<R()>& function)
+    {
+      auto           task=std::make_shared<std::packaged_task<R()>>(function);
+      std::future<R> result=task->get_future();
+
+      tasks.push_back([task]() {
+        (*task)();
+      });
+
+      return result;
+    }
+
+    inline bool IsEmpty() const
+    {
+      return tasks.empty();
+    }
+
+    friend class WorkerPool;
+  };
+
+  /**
+   * \ingroup Util
+   *
+   * A pool of worker threads, processing tasks with a given priority.
+   *
+   * Each worker has its own queue for each priority. Task groups are distributed round
+   * robin over the workers. A worker processes the tasks of its own queue first, if it is
+   * empty it steals tasks from the end of the queues of the other workers. Tasks with a
+   * higher priority are always processed before tasks with a lower priority.
+   *
+   * On destruction all queued tasks are processed before the workers stop.
+   */
+  class OSMSCOUT_API WorkerPool
+  {
+  public:
+    enum Priority
+    {
+      priorityHigh   = 0,
+      priorityNormal = 1,
+      priorityLow    = 2
+    };
+
+  private:
+    static const size_t PRIORITY_COUNT=3;
+
+    typedef WorkerTaskGroup::Task Task;
+
+    /**
+     * Queues of a worker
+     */
+    struct Worker
+    {
+      std::mutex       mutex;
+      std::deque<Task> tasks[PRIORITY_COUNT];
+      std::thread      thread;
+    };
+
+  private:
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::mutex                           mutex;        //!< Mutex protecting the following state
+    std::condition_variable              condition;
+    size_t                               pendingTasks; //!< Number of queued tasks
+    size_t                               nextWorker;   //!< Worker the next group is pushed to
+    bool                                 running;
+
+  private:
+    bool PopTask(size_t workerIndex,
+                 Task& task);
+    void WorkerLoop(size_t workerIndex);
+
+  public:
+    explicit WorkerPool(size_t workerCount);
+    ~WorkerPool();
+
+    void Push(WorkerTaskGroup& group,
+              Priority priority=priorityNormal);
+
+    size_t GetWorkerCount() const;
+  };
+}
+
+#endif
@@ -33,10 +33,16 @@ namespace osmscout {
 
   const char* AreaAreaIndex::AREA_AREA_IDX="areaarea.idx";
 
-  AreaAreaIndex::AreaAreaIndex(size_t cacheSize)
+  /**
+   * Create a new index. The index cell cache is limited to cacheSize entries.
+   * If cacheMemory is not 0, it is limited to cacheMemory bytes instead.
+   */
+  AreaAreaIndex::AreaAreaIndex(size_t cacheSize,
+                               size_t cacheMemory)
   : maxLevel(0),
     topLevelOffset(0),
-    indexCache(cacheSize)
+    indexCache(cacheMemory!=0 ? cacheMemory : cacheSize,
+               cacheMemory!=0 ? &indexCacheSizer : NULL)
   {
     // no code
   }
@@ -65,42 +71,36 @@ namespace osmscout {
                                    FileOffset &dataOffset) const
   {
     if (level<maxLevel) {
-      std::lock_guard<std::mutex> guard(lookupMutex);
-      IndexCache::CacheRef        cacheRef;
-
 #if defined(ANALYZE_CACHE)
       if (indexCache.GetSize()==indexCache.GetMaxSize()) {
         log.Warn() << "areaarea.index cache of " << indexCache.GetSize() << "/" << indexCache.GetMaxSize()<< " is too small";
-        indexCache.DumpStatistics("areaarea.idx",IndexCacheValueSizer());
+        indexCache.DumpStatistics("areaarea.idx",indexCacheSizer);
       }
 #endif
 
-      if (!indexCache.GetEntry(offset,cacheRef)) {
-        IndexCache::CacheEntry cacheEntry(offset);
-
-        cacheRef=indexCache.SetEntry(cacheEntry);
+      if (!indexCache.GetEntry(offset,indexCell)) {
+        {
+          std::lock_guard<std::mutex> guard(lookupMutex);
 
-        scanner.SetPos(offset);
+          scanner.SetPos(offset);
 
-        for (size_t c=0; c<4; c++) {
-          FileOffset childOffset;
+          for (size_t c=0; c<4; c++) {
+            FileOffset childOffset;
 
-          scanner.ReadNumber(childOffset);
+            scanner.ReadNumber(childOffset);
 
-          if (childOffset==0) {
-            cacheRef->value.children[c]=0;
+            if (childOffset==0) {
+              indexCell.children[c]=0;
+            }
+            else {
+              indexCell.children[c]=offset-childOffset;
+            }
           }
-          else {
-            cacheRef->value.children[c]=offset-childOffset;
-          }
-        }
 
-        cacheRef->value.data=scanner.GetPos();
+          indexCell.data=scanner.GetPos();
+        }
 
-        indexCell=cacheRef->value;
-      }
-      else {
-        indexCell=cacheRef->value;
+        indexCache.SetEntry(offset,indexCell);
       }
     }
     else {
@@ -358,6 +358,6 @@ namespace osmscout {
 
   void AreaAreaIndex::DumpStatistics()
   {
-    indexCache.DumpStatistics(AREA_AREA_IDX,IndexCacheValueSizer());
+    indexCache.DumpStatistics(AREA_AREA_IDX,indexCacheSizer);
   }
 }
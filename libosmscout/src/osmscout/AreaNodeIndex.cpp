@@ -241,6 +241,12 @@ namespace osmscout {
           continue;
         }
 
+        // Types with an id beyond the last indexed type do not have any nodes
+        if (type->GetNodeId()>=nodeTypeData.size()) {
+          loadedTypes.Set(type);
+          continue;
+        }
+
         if (!GetOffsets(nodeTypeData[type->GetNodeId()],
                         boundingBox,
                         offsets)) {
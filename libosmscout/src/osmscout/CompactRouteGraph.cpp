@@ -0,0 +1,502 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/CompactRouteGraph.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <osmscout/RouteNode.h>
+
+#include <osmscout/system/Assert.h>
+#include <osmscout/system/Math.h>
+
+#include <osmscout/util/Arena.h>
+#include <osmscout/util/DAryHeap.h>
+#include <osmscout/util/Geometry.h>
+#include <osmscout/util/Logger.h>
+#include <osmscout/util/OpenHashMap.h>
+
+namespace osmscout {
+
+  // The records are accessed in place, so their layout must not depend on the compiler
+  static_assert(sizeof(CompactRouteGraph::Header)==32,"Unexpected size of CompactRouteGraph::Header");
+  static_assert(sizeof(CompactRouteGraph::Node)==32,"Unexpected size of CompactRouteGraph::Node");
+  static_assert(sizeof(CompactRouteGraph::Edge)==24,"Unexpected size of CompactRouteGraph::Edge");
+  static_assert(sizeof(CompactRouteGraph::Object)==16,"Unexpected size of CompactRouteGraph::Object");
+  static_assert(sizeof(CompactRouteGraph::Exclude)==8,"Unexpected size of CompactRouteGraph::Exclude");
+
+  CompactRouteGraph::CompactRouteGraph()
+  : isLoaded(false),
+    nodes(NULL),
+    edges(NULL),
+    objects(NULL),
+    excludes(NULL)
+  {
+    std::memset(&header,0,sizeof(header));
+  }
+
+  CompactRouteGraph::~CompactRouteGraph()
+  {
+    Close();
+  }
+
+  std::string CompactRouteGraph::GetFilename(const std::string& filenamebase)
+  {
+    return filenamebase+"_csr.dat";
+  }
+
+  /**
+   * Map the given file into memory and validate its header.
+   *
+   * @return
+   *    True on success, else false
+   */
+  bool CompactRouteGraph::Load(const std::string& filename)
+  {
+    Close();
+
+    try {
+      file.Open(filename);
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      return false;
+    }
+
+    if (file.GetSize()<sizeof(Header)) {
+      log.Error() << "File '" << filename << "' is too small for a compact route graph";
+      file.CloseFailsafe();
+      return false;
+    }
+
+    std::memcpy(&header,file.GetData(),sizeof(header));
+
+    if (header.magic!=FILE_MAGIC) {
+      if (header.magic==((FILE_MAGIC >> 24) | ((FILE_MAGIC >> 8) & 0xff00) | ((FILE_MAGIC << 8) & 0xff0000) | (FILE_MAGIC << 24))) {
+        log.Error() << "File '" << filename << "' has been generated on a platform with a different byte order";
+      }
+      else {
+        log.Error() << "File '" << filename << "' is not a compact route graph";
+      }
+
+      file.CloseFailsafe();
+      return false;
+    }
+
+    if (header.version!=FILE_VERSION) {
+      log.Error() << "File '" << filename << "' has version " << header.version << " but version " << (uint32_t)FILE_VERSION << " is expected";
+      file.CloseFailsafe();
+      return false;
+    }
+
+    FileOffset nodesOffset=sizeof(Header);
+    FileOffset edgesOffset=nodesOffset+((FileOffset)header.nodeCount+1)*sizeof(Node);
+    FileOffset objectsOffset=edgesOffset+(FileOffset)header.edgeCount*sizeof(Edge);
+    FileOffset excludesOffset=objectsOffset+(FileOffset)header.objectCount*sizeof(Object);
+    FileOffset size=excludesOffset+(FileOffset)header.excludeCount*sizeof(Exclude);
+
+    if (size!=file.GetSize()) {
+      log.Error() << "File '" << filename << "' has size " << file.GetSize() << " but size " << size << " is expected";
+      file.CloseFailsafe();
+      return false;
+    }
+
+    nodes=reinterpret_cast<const Node*>(file.GetData()+nodesOffset);
+    edges=reinterpret_cast<const Edge*>(file.GetData()+edgesOffset);
+    objects=reinterpret_cast<const Object*>(file.GetData()+objectsOffset);
+    excludes=reinterpret_cast<const Exclude*>(file.GetData()+excludesOffset);
+
+    isLoaded=true;
+
+    return true;
+  }
+
+  void CompactRouteGraph::Close()
+  {
+    isLoaded=false;
+    nodes=NULL;
+    edges=NULL;
+    objects=NULL;
+    excludes=NULL;
+
+    std::memset(&header,0,sizeof(header));
+
+    if (file.IsOpen()) {
+      file.CloseFailsafe();
+    }
+  }
+
+  uint32_t CompactRouteGraph::GetNodeIndex(FileOffset routeNodeOffset) const
+  {
+    const Node* end=nodes+header.nodeCount;
+    const Node* entry=std::lower_bound(nodes,
+                                       end,
+                                       routeNodeOffset,
+                                       [](const Node& node, FileOffset offset) {
+                                         return node.routeNodeOffset<offset;
+                                       });
+
+    if (entry==end ||
+        entry->routeNodeOffset!=routeNodeOffset) {
+      return INVALID_INDEX;
+    }
+
+    return (uint32_t)(entry-nodes);
+  }
+
+  uint32_t CompactRouteGraph::GetObjectIndex(const ObjectFileRef& object) const
+  {
+    const Object* end=objects+header.objectCount;
+    const Object* entry=std::lower_bound(objects,
+                                         end,
+                                         object,
+                                         [](const Object& entry, const ObjectFileRef& object) {
+                                           return ObjectFileRef(entry.offset,(RefType)entry.type)<object;
+                                         });
+
+    if (entry==end ||
+        entry->offset!=object.GetFileOffset() ||
+        entry->type!=object.GetType()) {
+      return INVALID_INDEX;
+    }
+
+    return (uint32_t)(entry-objects);
+  }
+
+  bool CompactRouteGraph::IsExcluded(uint32_t node,
+                                     uint32_t source,
+                                     uint32_t target) const
+  {
+    for (uint32_t i=nodes[node].firstExclude; i<nodes[node+1].firstExclude; i++) {
+      if (excludes[i].source==source &&
+          excludes[i].target==target) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /**
+   * Check if the graph can be used for the given profile and return the
+   * costs per km for each object variant (negative if the variant cannot be
+   * used) as expected by CalculateRoute().
+   *
+   * The graph can only be used if the vehicle of the profile is part of the
+   * routing graph it has been generated from, if the object variants match
+   * the object variants of the routing graph and if the costs of the profile
+   * are proportional to the distance for each object variant.
+   *
+   * @return
+   *    True, if the graph can be used for the profile, else false
+   */
+  bool CompactRouteGraph::GetVariantCosts(const RoutingProfile& profile,
+                                          const std::vector<ObjectVariantData>& objectVariantData,
+                                          std::vector<double>& variantCosts) const
+  {
+    variantCosts.clear();
+
+    if (!isLoaded ||
+        (header.vehicles & profile.GetVehicle())==0 ||
+        objectVariantData.size()!=header.variantCount) {
+      return false;
+    }
+
+    RouteNode node;
+
+    node.objects.resize(1);
+    node.paths.resize(1);
+
+    node.paths[0].offset=0;
+    node.paths[0].objectIndex=0;
+    node.paths[0].flags=RouteNode::usableByFoot|RouteNode::usableByBicycle|RouteNode::usableByCar;
+
+    variantCosts.resize(objectVariantData.size());
+
+    for (size_t i=0; i<objectVariantData.size(); i++) {
+      node.objects[0].objectVariantIndex=(uint16_t)i;
+      node.paths[0].distance=1.0;
+
+      if (!profile.CanUse(node,objectVariantData,0)) {
+        variantCosts[i]=-1.0;
+        continue;
+      }
+
+      variantCosts[i]=profile.GetCosts(node,objectVariantData,0);
+
+      node.paths[0].distance=10.0;
+
+      if (std::fabs(profile.GetCosts(node,objectVariantData,0)-10.0*variantCosts[i])>variantCosts[i]*1e-9) {
+        variantCosts.clear();
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Calculate the cheapest route from one of the given start route nodes
+   * to one of the given target route nodes using the A* algorithm.
+   *
+   * The search follows the same rules (no direct u-turns, access restrictions
+   * and turn restrictions) as RoutingService::CalculateRoute().
+   *
+   * @param profile
+   *    Profile used to estimate the costs to the target
+   * @param variantCosts
+   *    Costs per km for each object variant, negative if the variant cannot
+   *    be used, as returned by GetVariantCosts()
+   * @param starts
+   *    Route nodes to start from
+   * @param targets
+   *    Route nodes to stop at
+   * @param target
+   *    Coordinate of the target, used to estimate the remaining costs
+   * @param steps
+   *    The start route node (with the object of the start terminal) followed
+   *    by all route nodes on the route. Empty, if no route could be found.
+   * @return
+   *    False, if start or target nodes are not part of the graph or the
+   *    route cannot be resolved, else true
+   */
+  bool CompactRouteGraph::CalculateRoute(const RoutingProfile& profile,
+                                         const std::vector<double>& variantCosts,
+                                         const std::vector<Terminal>& starts,
+                                         const std::vector<FileOffset>& targets,
+                                         const GeoCoord& target,
+                                         std::vector<Step>& steps,
+                                         size_t& expandedNodeCount) const
+  {
+    Arena<Label>                              labels(1024);
+    OpenHashMap<uint32_t,Label*>              labelMap;
+    DAryHeap<Label*,LabelCostCompare>         openList;
+    std::vector<uint32_t>                     targetNodes;
+    uint8_t                                   usableBit=0;
+    uint8_t                                   restrictedBit=0;
+
+    steps.clear();
+    expandedNodeCount=0;
+
+    assert(isLoaded);
+    assert(variantCosts.size()==header.variantCount);
+
+    switch (profile.GetVehicle()) {
+    case vehicleFoot:
+      usableBit=RouteNode::usableByFoot;
+      restrictedBit=RouteNode::restrictedForFoot;
+      break;
+    case vehicleBicycle:
+      usableBit=RouteNode::usableByBicycle;
+      restrictedBit=RouteNode::restrictedForBicycle;
+      break;
+    case vehicleCar:
+      usableBit=RouteNode::usableByCar;
+      restrictedBit=RouteNode::restrictedForCar;
+      break;
+    }
+
+    for (const auto& offset : targets) {
+      uint32_t node=GetNodeIndex(offset);
+
+      if (node==INVALID_INDEX) {
+        log.Error() << "Target route node " << offset << " is not part of the compact route graph";
+        return false;
+      }
+
+      targetNodes.push_back(node);
+    }
+
+    for (const auto& terminal : starts) {
+      uint32_t node=GetNodeIndex(terminal.routeNodeOffset);
+      uint32_t object=GetObjectIndex(terminal.object);
+
+      if (node==INVALID_INDEX ||
+          object==INVALID_INDEX) {
+        log.Error() << "Start route node " << terminal.routeNodeOffset << " is not part of the compact route graph";
+        return false;
+      }
+
+      Label** entry=labelMap.Find(node);
+      Label*  label;
+
+      if (entry!=nullptr) {
+        label=*entry;
+
+        if (label->currentCost<=terminal.cost) {
+          continue;
+        }
+      }
+      else {
+        label=labels.Allocate(node);
+        labelMap.Insert(node,label);
+      }
+
+      label->object=object;
+      label->currentCost=terminal.cost;
+      label->overallCost=terminal.cost+profile.GetCosts(GetSphericalDistance(nodes[node].lon,
+                                                                             nodes[node].lat,
+                                                                             target.GetLon(),
+                                                                             target.GetLat()));
+
+      if (openList.Contains(label)) {
+        openList.Update(label);
+      }
+      else {
+        openList.Push(label);
+      }
+    }
+
+    Label* current=nullptr;
+
+    while (!openList.Empty()) {
+      current=openList.Pop();
+
+      expandedNodeCount++;
+
+      if (std::find(targetNodes.begin(),
+                    targetNodes.end(),
+                    current->node)!=targetNodes.end()) {
+        break;
+      }
+
+      bool     accessViolation=false;
+      uint32_t lastEdge=nodes[current->node+1].firstEdge;
+
+      for (uint32_t e=nodes[current->node].firstEdge; e<lastEdge; e++) {
+        const Edge& edge=edges[e];
+
+        if (edge.target==current->prev) {
+          continue;
+        }
+
+        bool restricted=(edge.flags & restrictedBit)!=0;
+
+        if (!current->access &&
+            !restricted) {
+          accessViolation=true;
+          continue;
+        }
+
+        double costPerKm=variantCosts[edge.variant];
+
+        if ((edge.flags & usableBit)==0 ||
+            costPerKm<0.0) {
+          continue;
+        }
+
+        Label** entry=labelMap.Find(edge.target);
+
+        if (entry!=nullptr &&
+            (*entry)->closed) {
+          continue;
+        }
+
+        if (IsExcluded(current->node,
+                       current->object,
+                       edge.object)) {
+          continue;
+        }
+
+        double currentCost=current->currentCost+edge.distance*costPerKm;
+        Label* next;
+
+        if (entry!=nullptr) {
+          next=*entry;
+
+          if (openList.Contains(next) &&
+              next->currentCost<=currentCost) {
+            continue;
+          }
+        }
+        else {
+          next=labels.Allocate(edge.target);
+          labelMap.Insert(edge.target,next);
+        }
+
+        const Node& nextNode=nodes[edge.target];
+
+        next->prev=current->node;
+        next->object=edge.object;
+        next->access=!restricted;
+        next->currentCost=currentCost;
+        next->overallCost=currentCost+profile.GetCosts(GetSphericalDistance(nextNode.lon,
+                                                                            nextNode.lat,
+                                                                            target.GetLon(),
+                                                                            target.GetLat()));
+
+        if (openList.Contains(next)) {
+          // The estimate for the node is unchanged, so lower current costs
+          // always result in lower overall costs
+          openList.DecreaseKey(next);
+        }
+        else {
+          openList.Push(next);
+        }
+      }
+
+      if (!accessViolation) {
+        current->closed=true;
+      }
+
+      current=nullptr;
+    }
+
+    if (current==nullptr) {
+      return true;
+    }
+
+    // Follow the chain of previous nodes back to the start
+    while (true) {
+      Step step;
+
+      // Every node can only be part of the route once
+      if (steps.size()>=labels.Size()) {
+        log.Error() << "Route to route node " << steps.front().routeNodeOffset << " contains a cycle";
+        steps.clear();
+        return false;
+      }
+
+      step.routeNodeOffset=nodes[current->node].routeNodeOffset;
+      step.object=GetObject(current->object);
+
+      steps.push_back(step);
+
+      if (current->prev==INVALID_INDEX) {
+        break;
+      }
+
+      Label** entry=labelMap.Find(current->prev);
+
+      if (entry==nullptr) {
+        log.Error() << "Cannot resolve previous route node of route node " << step.routeNodeOffset;
+        steps.clear();
+        return false;
+      }
+
+      current=*entry;
+    }
+
+    std::reverse(steps.begin(),
+                 steps.end());
+
+    return true;
+  }
+}
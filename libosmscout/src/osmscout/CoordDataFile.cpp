@@ -19,6 +19,8 @@
 
 #include <osmscout/CoordDataFile.h>
 
+#include <algorithm>
+
 #include <osmscout/system/Assert.h>
 
 #include <osmscout/util/File.h>
@@ -30,7 +32,11 @@ namespace osmscout {
 
   CoordDataFile::CoordDataFile()
     : isOpen(false),
-      pageSize(0)
+      pageSize(0),
+      dense(false),
+      minId(0),
+      maxId(0),
+      dataOffset(0)
   {
     // no code
   }
@@ -48,6 +54,7 @@ namespace osmscout {
     datafilename=AppendFileToDir(path,COORD_DAT);
 
     isOpen=false;
+    dense=false;
     pageFileOffsetMap.clear();
 
     try {
@@ -60,6 +67,26 @@ namespace osmscout {
       scanner.Read(mapOffset);
       scanner.Read(pageSize);
 
+      if (mapOffset==0) {
+        // Dense layout, there is no page index
+        dense=true;
+
+        scanner.Read(minId);
+        scanner.Read(maxId);
+        scanner.Read(dataOffset);
+
+        // The file is (nearly) as big as the range of node ids, so prefetching
+        // the whole file (as done for FastRandom) is not an option
+        scanner.Close();
+        scanner.Open(datafilename,
+                     FileScanner::LowMemRandom,
+                     true);
+
+        isOpen=true;
+
+        return true;
+      }
+
       scanner.SetPos(mapOffset);
 
       uint32_t mapSize;
@@ -105,6 +132,68 @@ namespace osmscout {
     return true;
   }
 
+  bool CoordDataFile::IsDense() const
+  {
+    return dense;
+  }
+
+  /**
+   * Reads the coordinate of the given node (if it exists) and adds it
+   * to the result map.
+   *
+   * @throws IOException
+   */
+  void CoordDataFile::GetCoord(OSMId id,
+                               ResultMap& resultMap) const
+  {
+    uint8_t  serial;
+    GeoCoord coord;
+
+    if (dense) {
+      if (id<minId || id>maxId) {
+        return;
+      }
+
+      scanner.SetPos(dataOffset+(FileOffset)(id-minId)*(coordByteSize+1));
+
+      scanner.Read(serial);
+
+      // Serial 0 marks an entry without node (this includes holes in the file)
+      if (serial==0) {
+        return;
+      }
+
+      scanner.ReadCoord(coord);
+    }
+    else {
+      PageId relatedId=id+std::numeric_limits<OSMId>::min();
+      PageId pageId=relatedId/pageSize;
+
+      PageIdFileOffsetMap::const_iterator pageOffset=pageFileOffsetMap.find(pageId);
+
+      if (pageOffset==pageFileOffsetMap.end()) {
+        return;
+      }
+
+      FileOffset offset=pageOffset->second+(relatedId%pageSize)*(coordByteSize+1);
+      bool       isSet;
+
+      scanner.SetPos(offset);
+
+      scanner.Read(serial);
+      scanner.ReadConditionalCoord(coord,
+                                   isSet);
+
+      if (!isSet) {
+        return;
+      }
+    }
+
+    resultMap.insert(std::make_pair(id,
+                                    Coord(serial,
+                                          coord)));
+  }
+
   bool CoordDataFile::Get(const std::set<OSMId>& ids, ResultMap& resultMap) const
   {
     assert(isOpen);
@@ -114,34 +203,41 @@ namespace osmscout {
 
     try {
       for (const auto& id : ids) {
-        PageId relatedId=id+std::numeric_limits<OSMId>::min();
-        PageId pageId=relatedId/pageSize;
-
-        PageIdFileOffsetMap::const_iterator pageOffset=pageFileOffsetMap.find(pageId);
-
-        if (pageOffset==pageFileOffsetMap.end()) {
-          continue;
-        }
+        GetCoord(id,
+                 resultMap);
+      }
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      return false;
+    }
 
-        FileOffset offset=pageOffset->second+(relatedId%pageSize)*(coordByteSize+1);
+    return true;
+  }
 
-        scanner.SetPos(offset);
+  /**
+   * Batch lookup of coordinates. The ids may contain duplicates. The ids get
+   * sorted (and duplicates get removed), so that the data file is accessed in
+   * file order.
+   */
+  bool CoordDataFile::Get(std::vector<OSMId>& ids, ResultMap& resultMap) const
+  {
+    assert(isOpen);
 
-        uint8_t  serial;
-        bool     isSet;
-        GeoCoord coord;
+    std::sort(ids.begin(),
+              ids.end());
 
-        scanner.Read(serial);
-        scanner.ReadConditionalCoord(coord,
-                                     isSet);
+    ids.erase(std::unique(ids.begin(),
+                          ids.end()),
+              ids.end());
 
-        if (!isSet) {
-          continue;
-        }
+    resultMap.clear();
+    resultMap.reserve(ids.size());
 
-        resultMap.insert(std::make_pair(id,
-                                        Coord(serial,
-                                              coord)));
+    try {
+      for (const auto& id : ids) {
+        GetCoord(id,
+                 resultMap);
       }
     }
     catch (IOException& e) {
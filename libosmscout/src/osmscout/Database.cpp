@@ -36,6 +36,7 @@ namespace osmscout {
 
   DatabaseParameter::DatabaseParameter()
   : areaAreaIndexCacheSize(5000),
+    areaAreaIndexCacheMemory(0),
     areaNodeIndexCacheSize(1000)
   {
     // no code
@@ -46,6 +47,11 @@ namespace osmscout {
     this->areaAreaIndexCacheSize=areaAreaIndexCacheSize;
   }
 
+  void DatabaseParameter::SetAreaAreaIndexCacheMemory(unsigned long areaAreaIndexCacheMemory)
+  {
+    this->areaAreaIndexCacheMemory=areaAreaIndexCacheMemory;
+  }
+
   void DatabaseParameter::SetAreaNodeIndexCacheSize(unsigned long areaNodeIndexCacheSize)
   {
     this->areaNodeIndexCacheSize=areaNodeIndexCacheSize;
@@ -56,6 +62,11 @@ namespace osmscout {
     return areaAreaIndexCacheSize;
   }
 
+  unsigned long DatabaseParameter::GetAreaAreaIndexCacheMemory() const
+  {
+    return areaAreaIndexCacheMemory;
+  }
+
   unsigned long DatabaseParameter::GetAreaNodeIndexCacheSize() const
   {
     return areaNodeIndexCacheSize;
@@ -324,7 +335,8 @@ namespace osmscout {
     }
 
     if (!areaAreaIndex) {
-      areaAreaIndex=std::make_shared<AreaAreaIndex>(parameter.GetAreaAreaIndexCacheSize());
+      areaAreaIndex=std::make_shared<AreaAreaIndex>(parameter.GetAreaAreaIndexCacheSize(),
+                                                    parameter.GetAreaAreaIndexCacheMemory());
 
       StopClock timer;
 
@@ -0,0 +1,652 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/MapMatchingService.h>
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <thread>
+#include <unordered_map>
+
+#include <osmscout/RouteMatrix.h>
+
+#include <osmscout/system/Assert.h>
+
+#include <osmscout/util/Geometry.h>
+#include <osmscout/util/Logger.h>
+#include <osmscout/util/WorkQueue.h>
+
+namespace osmscout {
+
+  MapMatchingParameter::MapMatchingParameter()
+  : searchRadius(50.0),
+    maxCandidates(8),
+    gpsSigma(10.0),
+    transitionBeta(50.0),
+    maxDistanceFactor(3.0),
+    minPointDistance(0.0),
+    threadCount(0),
+    candidateCacheSize(100000)
+  {
+    // no code
+  }
+
+  /**
+   * Maximum distance in meter between a point of the trace and a candidate
+   * way (default 50m).
+   */
+  void MapMatchingParameter::SetSearchRadius(double searchRadius)
+  {
+    this->searchRadius=searchRadius;
+  }
+
+  /**
+   * Maximum number of candidate ways for each point of the trace, the
+   * closest ways are taken (default 8).
+   */
+  void MapMatchingParameter::SetMaxCandidates(size_t maxCandidates)
+  {
+    this->maxCandidates=maxCandidates;
+  }
+
+  /**
+   * Standard deviation of the GPS noise in meter (default 10m).
+   */
+  void MapMatchingParameter::SetGpsSigma(double gpsSigma)
+  {
+    this->gpsSigma=gpsSigma;
+  }
+
+  /**
+   * Expected difference in meter between the route distance of two
+   * candidates and the distance of the points (default 50m). Bigger values
+   * make transitions with detours more likely.
+   */
+  void MapMatchingParameter::SetTransitionBeta(double transitionBeta)
+  {
+    this->transitionBeta=transitionBeta;
+  }
+
+  /**
+   * Transitions between candidates of consecutive points are only
+   * considered if the route distance is not greater than the distance of
+   * the points multiplied by this factor plus two times the search radius
+   * (default 3). This bounds the search for the route distances.
+   */
+  void MapMatchingParameter::SetMaxDistanceFactor(double maxDistanceFactor)
+  {
+    this->maxDistanceFactor=maxDistanceFactor;
+  }
+
+  /**
+   * Points closer than the given distance in meter to the previous matched
+   * point are not matched (default 0, all points are matched). Dropping
+   * points within the GPS noise speeds up matching of dense traces.
+   */
+  void MapMatchingParameter::SetMinPointDistance(double minPointDistance)
+  {
+    this->minPointDistance=minPointDistance;
+  }
+
+  /**
+   * Number of threads used by MapMatchingService::MatchTraces(). 0 (the
+   * default) means one thread per core.
+   */
+  void MapMatchingParameter::SetThreadCount(size_t threadCount)
+  {
+    this->threadCount=threadCount;
+  }
+
+  /**
+   * Number of points for which the candidate ways are cached. 0 disables
+   * the cache.
+   */
+  void MapMatchingParameter::SetCandidateCacheSize(size_t candidateCacheSize)
+  {
+    this->candidateCacheSize=candidateCacheSize;
+  }
+
+  double MapMatchingParameter::GetSearchRadius() const
+  {
+    return searchRadius;
+  }
+
+  size_t MapMatchingParameter::GetMaxCandidates() const
+  {
+    return maxCandidates;
+  }
+
+  double MapMatchingParameter::GetGpsSigma() const
+  {
+    return gpsSigma;
+  }
+
+  double MapMatchingParameter::GetTransitionBeta() const
+  {
+    return transitionBeta;
+  }
+
+  double MapMatchingParameter::GetMaxDistanceFactor() const
+  {
+    return maxDistanceFactor;
+  }
+
+  double MapMatchingParameter::GetMinPointDistance() const
+  {
+    return minPointDistance;
+  }
+
+  size_t MapMatchingParameter::GetThreadCount() const
+  {
+    return threadCount;
+  }
+
+  size_t MapMatchingParameter::GetCandidateCacheSize() const
+  {
+    return candidateCacheSize;
+  }
+
+  /**
+   * Create a new instance of the map matching service.
+   *
+   * @param database
+   *    A valid reference to a database instance
+   * @param router
+   *    A valid reference to an opened routing service for the same database.
+   *    Transitions are calculated in the thread matching the trace, the
+   *    thread count of the router is not used.
+   * @param parameter
+   *    Parameterization of the service
+   */
+  MapMatchingService::MapMatchingService(const DatabaseRef& database,
+                                         const RoutingServiceRef& router,
+                                         const MapMatchingParameter& parameter)
+  : database(database),
+    router(router),
+    searchRadius(parameter.GetSearchRadius()),
+    maxCandidates(parameter.GetMaxCandidates()),
+    gpsSigma(parameter.GetGpsSigma()),
+    transitionBeta(parameter.GetTransitionBeta()),
+    maxDistanceFactor(parameter.GetMaxDistanceFactor()),
+    minPointDistance(parameter.GetMinPointDistance()),
+    threadCount(parameter.GetThreadCount()),
+    candidateCache(parameter.GetCandidateCacheSize())
+  {
+    assert(database);
+    assert(router);
+  }
+
+  MapMatchingService::~MapMatchingService()
+  {
+    // no code
+  }
+
+  /**
+   * Return the candidates of the given point, using the cache of recently
+   * calculated candidates.
+   *
+   * Method is thread-safe.
+   */
+  bool MapMatchingService::GetCandidates(const GeoCoord& coord,
+                                         Vehicle vehicle,
+                                         CandidateListRef& candidates)
+  {
+    Id key=coord.GetId();
+
+    if (candidateCache.GetEntry(key,
+                                candidates) &&
+        candidates->coord==coord &&
+        candidates->vehicle==vehicle) {
+      return true;
+    }
+
+    candidates=std::make_shared<CandidateList>();
+
+    candidates->coord=coord;
+    candidates->vehicle=vehicle;
+
+    if (!router->GetRouteCandidates(coord,
+                                    vehicle,
+                                    searchRadius,
+                                    maxCandidates,
+                                    candidates->candidates)) {
+      return false;
+    }
+
+    candidateCache.SetEntry(key,
+                            candidates);
+
+    return true;
+  }
+
+  /**
+   * Return the distance in km between two positions on the same way, if the
+   * way can be used in the required direction.
+   *
+   * @return
+   *    False, if the way cannot be used in the required direction or cannot
+   *    be loaded, else true
+   */
+  bool MapMatchingService::GetWayDistance(const RoutingProfile& profile,
+                                          const RoutePosition& from,
+                                          const RoutePosition& to,
+                                          double& distance) const
+  {
+    WayDataFileRef wayDataFile(database->GetWayDataFile());
+    WayRef         way;
+
+    if (!wayDataFile ||
+        !wayDataFile->GetByOffset(from.object.GetFileOffset(),
+                                  way)) {
+      return false;
+    }
+
+    if (from.nodeIndex>=way->nodes.size() ||
+        to.nodeIndex>=way->nodes.size()) {
+      return false;
+    }
+
+    if ((to.nodeIndex>=from.nodeIndex && !profile.CanUseForward(*way)) ||
+        (to.nodeIndex<from.nodeIndex && !profile.CanUseBackward(*way))) {
+      return false;
+    }
+
+    size_t start=std::min(from.nodeIndex,to.nodeIndex);
+    size_t end=std::max(from.nodeIndex,to.nodeIndex);
+
+    distance=0.0;
+
+    for (size_t i=start; i<end; i++) {
+      distance+=GetSphericalDistance(way->nodes[i].GetCoord(),
+                                     way->nodes[i+1].GetCoord());
+    }
+
+    return true;
+  }
+
+  /**
+   * Calculate the route distance in km from each candidate in from to each
+   * candidate in to. Distances greater than maxDistance are infinite.
+   *
+   * The matrix search only leaves and reaches a way at its route nodes, so
+   * for candidates on the same way the distance along the way is used, if
+   * it is shorter.
+   */
+  bool MapMatchingService::GetTransitionDistances(const RoutingProfile& profile,
+                                                  const std::vector<RouteCandidate>& from,
+                                                  const std::vector<RouteCandidate>& to,
+                                                  double maxDistance,
+                                                  std::vector<double>& distances) const
+  {
+    std::vector<RoutePosition> sources;
+    std::vector<RoutePosition> targets;
+    RouteMatrix                matrix;
+
+    sources.reserve(from.size());
+    targets.reserve(to.size());
+
+    for (const auto& candidate : from) {
+      sources.push_back(candidate.position);
+    }
+
+    for (const auto& candidate : to) {
+      targets.push_back(candidate.position);
+    }
+
+    // The matrices are small and MatchTraces() already runs in parallel,
+    // so calculate the matrix in the calling thread
+    if (!router->CalculateMatrix(profile,
+                                 sources,
+                                 targets,
+                                 maxDistance,
+                                 1,
+                                 matrix)) {
+      return false;
+    }
+
+    distances.assign(from.size()*to.size(),
+                     std::numeric_limits<double>::infinity());
+
+    for (size_t f=0; f<from.size(); f++) {
+      for (size_t t=0; t<to.size(); t++) {
+        double& distance=distances[f*to.size()+t];
+
+        if (matrix.IsReachable(f,t) &&
+            matrix.GetDistance(f,t)<=maxDistance) {
+          distance=matrix.GetDistance(f,t);
+        }
+
+        double wayDistance;
+
+        if (sources[f].object==targets[t].object &&
+            GetWayDistance(profile,
+                           sources[f],
+                           targets[t],
+                           wayDistance) &&
+            wayDistance<=maxDistance &&
+            wayDistance<distance) {
+          distance=wayDistance;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Follow the most likely sequence of candidates back from the last step and
+   * store the matched positions.
+   */
+  void MapMatchingService::ResolveSteps(const std::vector<Step>& steps,
+                                        std::vector<RoutePosition>& positions) const
+  {
+    if (steps.empty()) {
+      return;
+    }
+
+    const Step& last=steps.back();
+    size_t      current=std::max_element(last.scores.begin(),
+                                         last.scores.end())-last.scores.begin();
+
+    for (size_t s=steps.size(); s>0; s--) {
+      const Step& step=steps[s-1];
+
+      positions[step.pointIndex]=step.candidates->candidates[current].position;
+      current=step.predecessors[current];
+    }
+  }
+
+  /**
+   * Calculate the route through all matched positions of the result.
+   * Consecutive matched positions on the same way in the same direction are
+   * connected by one route. Consecutive matched positions that cannot be
+   * connected are counted as gaps, the route continues with the next
+   * position.
+   */
+  void MapMatchingService::ResolveRoute(const RoutingProfile& profile,
+                                        MatchedTrace& result) const
+  {
+    std::vector<RoutePosition> path;
+
+    for (const auto& position : result.positions) {
+      if (!position.object.Valid()) {
+        continue;
+      }
+
+      if (!path.empty() &&
+          path.back().object==position.object &&
+          path.back().nodeIndex==position.nodeIndex) {
+        continue;
+      }
+
+      // Drop the previous position, if it is just a position on the way
+      // between its predecessor and the new position
+      if (path.size()>=2) {
+        const RoutePosition& first=path[path.size()-2];
+        const RoutePosition& middle=path.back();
+
+        if (first.object==middle.object &&
+            middle.object==position.object &&
+            ((first.nodeIndex<middle.nodeIndex && middle.nodeIndex<position.nodeIndex) ||
+             (first.nodeIndex>middle.nodeIndex && middle.nodeIndex>position.nodeIndex))) {
+          path.pop_back();
+        }
+      }
+
+      path.push_back(position);
+    }
+
+    bool connected=false;
+
+    for (size_t i=1; i<path.size(); i++) {
+      RouteData leg;
+
+      if (!router->CalculateRoute(profile,
+                                  path[i-1].object,
+                                  path[i-1].nodeIndex,
+                                  path[i].object,
+                                  path[i].nodeIndex,
+                                  leg) ||
+          leg.IsEmpty()) {
+        result.gapCount++;
+        connected=false;
+        continue;
+      }
+
+      /* The end of the previous leg is the start of this leg, we need to */
+      /* remove the duplicate point */
+      if (connected) {
+        result.route.PopEntry();
+      }
+
+      result.route.Append(leg);
+      connected=true;
+    }
+  }
+
+  /**
+   * Match the given GPS trace to the routing graph.
+   *
+   * Method is thread-safe.
+   *
+   * @param profile
+   *    Profile to use, defines the vehicle and the ways that can be used
+   * @param trace
+   *    The points of the trace in chronological order
+   * @param result
+   *    The matched position for each point and the route through all
+   *    matched positions
+   * @return
+   *    False, if there was an error (for example while loading data), else true
+   */
+  bool MapMatchingService::MatchTrace(const RoutingProfile& profile,
+                                      const std::vector<GeoCoord>& trace,
+                                      MatchedTrace& result)
+  {
+    Vehicle           vehicle=profile.GetVehicle();
+    std::vector<Step> steps;
+    double            emissionFactor=-0.5/((gpsSigma/1000.0)*(gpsSigma/1000.0));
+    double            transitionFactor=-1.0/(transitionBeta/1000.0);
+
+    result.positions.clear();
+    result.positions.resize(trace.size());
+    result.route.Clear();
+    result.breakCount=0;
+    result.gapCount=0;
+
+    for (size_t p=0; p<trace.size(); p++) {
+      if (!steps.empty() &&
+          minPointDistance>0.0 &&
+          GetSphericalDistance(trace[steps.back().pointIndex],
+                               trace[p])*1000.0<minPointDistance) {
+        continue;
+      }
+
+      Step step;
+
+      if (!GetCandidates(trace[p],
+                         vehicle,
+                         step.candidates)) {
+        return false;
+      }
+
+      const std::vector<RouteCandidate>& candidates=step.candidates->candidates;
+
+      if (candidates.empty()) {
+        continue;
+      }
+
+      step.pointIndex=p;
+      step.scores.resize(candidates.size());
+      step.predecessors.assign(candidates.size(),
+                               std::numeric_limits<size_t>::max());
+
+      bool reachable=false;
+
+      if (!steps.empty()) {
+        const Step&                        previous=steps.back();
+        const std::vector<RouteCandidate>& previousCandidates=previous.candidates->candidates;
+        double                             pointDistance=GetSphericalDistance(trace[previous.pointIndex],
+                                                                              trace[p]);
+        double                             maxDistance=pointDistance*maxDistanceFactor+2*searchRadius/1000.0;
+        std::vector<double>                distances;
+
+        if (!GetTransitionDistances(profile,
+                                    previousCandidates,
+                                    candidates,
+                                    maxDistance,
+                                    distances)) {
+          return false;
+        }
+
+        for (size_t c=0; c<candidates.size(); c++) {
+          double bestScore=-std::numeric_limits<double>::infinity();
+
+          for (size_t pc=0; pc<previousCandidates.size(); pc++) {
+            double distance=distances[pc*candidates.size()+c];
+
+            if (std::isinf(distance)) {
+              continue;
+            }
+
+            double score=previous.scores[pc]+transitionFactor*std::fabs(distance-pointDistance);
+
+            if (score>bestScore) {
+              bestScore=score;
+              step.predecessors[c]=pc;
+            }
+          }
+
+          if (step.predecessors[c]!=std::numeric_limits<size_t>::max()) {
+            step.scores[c]=bestScore+emissionFactor*candidates[c].distance*candidates[c].distance;
+            reachable=true;
+          }
+          else {
+            step.scores[c]=-std::numeric_limits<double>::infinity();
+          }
+        }
+
+        if (!reachable) {
+          // No candidate is reachable from the previous point, restart
+          ResolveSteps(steps,
+                       result.positions);
+          steps.clear();
+          result.breakCount++;
+        }
+      }
+
+      if (!reachable) {
+        for (size_t c=0; c<candidates.size(); c++) {
+          step.scores[c]=emissionFactor*candidates[c].distance*candidates[c].distance;
+          step.predecessors[c]=std::numeric_limits<size_t>::max();
+        }
+      }
+
+      steps.push_back(step);
+    }
+
+    ResolveSteps(steps,
+                 result.positions);
+
+    ResolveRoute(profile,
+                 result);
+
+    return true;
+  }
+
+  /**
+   * Match a batch of GPS traces (see MatchTrace()). The traces are matched
+   * in parallel (see MapMatchingParameter::SetThreadCount()) and share
+   * the cached candidates and route nodes.
+   *
+   * @param profile
+   *    Profile to use, defines the vehicle and the ways that can be used
+   * @param traces
+   *    The traces to match
+   * @param results
+   *    One result for each trace
+   * @return
+   *    False, if there was an error while matching at least one trace, else
+   *    true
+   */
+  bool MapMatchingService::MatchTraces(const RoutingProfile& profile,
+                                       const std::vector<std::vector<GeoCoord>>& traces,
+                                       std::vector<MatchedTrace>& results)
+  {
+    WorkQueue<bool>                queue;
+    std::vector<std::thread>       workers;
+    std::vector<std::future<bool>> futures;
+    size_t                         workerCount=threadCount;
+
+    results.clear();
+    results.resize(traces.size());
+
+    if (workerCount==0) {
+      workerCount=std::max((unsigned int)1,std::thread::hardware_concurrency());
+    }
+
+    workerCount=std::max((size_t)1,std::min(workerCount,traces.size()));
+
+    for (size_t i=0; i<workerCount; i++) {
+      workers.push_back(std::thread([&queue]() {
+        std::packaged_task<bool()> task;
+
+        while (queue.PopTask(task)) {
+          task();
+        }
+      }));
+    }
+
+    for (size_t i=0; i<traces.size(); i++) {
+      std::packaged_task<bool()> task([this,&profile,&traces,&results,i]() {
+        return MatchTrace(profile,
+                          traces[i],
+                          results[i]);
+      });
+
+      futures.push_back(task.get_future());
+      queue.PushTask(task);
+    }
+
+    queue.Stop();
+
+    for (auto& worker : workers) {
+      worker.join();
+    }
+
+    bool success=true;
+
+    for (auto& future : futures) {
+      success=future.get() && success;
+    }
+
+    return success;
+  }
+
+  /**
+   * Remove all cached candidates, for example after the router has been
+   * reopened.
+   */
+  void MapMatchingService::FlushCache()
+  {
+    candidateCache.Flush();
+  }
+}
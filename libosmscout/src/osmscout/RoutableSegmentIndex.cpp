@@ -0,0 +1,328 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/RoutableSegmentIndex.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <osmscout/util/Logger.h>
+
+namespace osmscout {
+
+  const char* const RoutableSegmentIndex::ROUTABLE_SEGMENT_IDX="routablesegment.idx";
+
+  static_assert(sizeof(RoutableSegmentIndex::Header)==32,"Unexpected size of RoutableSegmentIndex::Header");
+  static_assert(sizeof(RoutableSegmentIndex::Cell)==16,"Unexpected size of RoutableSegmentIndex::Cell");
+  static_assert(sizeof(RoutableSegmentIndex::Entry)==32,"Unexpected size of RoutableSegmentIndex::Entry");
+
+  RoutableSegmentIndex::RoutableSegmentIndex()
+  : isLoaded(false),
+    cellDimension(0.0),
+    cells(NULL),
+    entries(NULL)
+  {
+    std::memset(&header,0,sizeof(header));
+  }
+
+  RoutableSegmentIndex::~RoutableSegmentIndex()
+  {
+    Close();
+  }
+
+  /**
+   * Map the given file into memory and validate its header.
+   *
+   * @return
+   *    True on success, else false
+   */
+  bool RoutableSegmentIndex::Load(const std::string& filename)
+  {
+    Close();
+
+    try {
+      file.Open(filename);
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      return false;
+    }
+
+    if (file.GetSize()<sizeof(Header)) {
+      log.Error() << "File '" << filename << "' is too small for a routable segment index";
+      file.CloseFailsafe();
+      return false;
+    }
+
+    std::memcpy(&header,file.GetData(),sizeof(header));
+
+    if (header.magic!=FILE_MAGIC) {
+      if (header.magic==((FILE_MAGIC >> 24) | ((FILE_MAGIC >> 8) & 0xff00) | ((FILE_MAGIC << 8) & 0xff0000) | (FILE_MAGIC << 24))) {
+        log.Error() << "File '" << filename << "' has been generated on a platform with a different byte order";
+      }
+      else {
+        log.Error() << "File '" << filename << "' is not a routable segment index";
+      }
+
+      file.CloseFailsafe();
+      return false;
+    }
+
+    if (header.version!=FILE_VERSION) {
+      log.Error() << "File '" << filename << "' has version " << header.version << " but version " << (uint32_t)FILE_VERSION << " is expected";
+      file.CloseFailsafe();
+      return false;
+    }
+
+    FileOffset entriesOffset=sizeof(Header);
+    FileOffset cellsOffset=entriesOffset+(FileOffset)header.entryCount*sizeof(Entry);
+    FileOffset size=cellsOffset+(FileOffset)header.cellCount*sizeof(Cell);
+
+    if (size!=file.GetSize()) {
+      log.Error() << "File '" << filename << "' has size " << file.GetSize() << " but size " << size << " is expected";
+      file.CloseFailsafe();
+      return false;
+    }
+
+    cellDimension=GetCellDimension(header.level);
+    cells=reinterpret_cast<const Cell*>(file.GetData()+cellsOffset);
+    entries=reinterpret_cast<const Entry*>(file.GetData()+entriesOffset);
+
+    isLoaded=true;
+
+    return true;
+  }
+
+  void RoutableSegmentIndex::Close()
+  {
+    isLoaded=false;
+    cellDimension=0.0;
+    cells=NULL;
+    entries=NULL;
+
+    std::memset(&header,0,sizeof(header));
+
+    if (file.IsOpen()) {
+      file.CloseFailsafe();
+    }
+  }
+
+  /**
+   * Return the node of a way or area routable by the given vehicle, that
+   * is closest to the given coordinate.
+   *
+   * All nodes of segments intersecting the cells covered by the given radius
+   * are checked, so the resulting node may be outside the radius. Distances
+   * are compared in degrees, like RoutingService::GetClosestRoutableNode()
+   * does. If two nodes have the same distance, nodes of areas are preferred
+   * over nodes of ways, then the lower file offset and the lower node index
+   * wins.
+   *
+   * @param coord
+   *    Search center
+   * @param vehicle
+   *    Vehicle that must be able to route on the object
+   * @param radius
+   *    Radius of the search area in meter
+   * @param object
+   *    The resulting object or an invalid object, if no node was found
+   * @param nodeIndex
+   *    The index of the resulting node within the object
+   * @return
+   *    False, if the index is not loaded, else true
+   */
+  bool RoutableSegmentIndex::GetClosestNode(const GeoCoord& coord,
+                                            Vehicle vehicle,
+                                            double radius,
+                                            ObjectFileRef& object,
+                                            size_t& nodeIndex) const
+  {
+    object.Invalidate();
+    nodeIndex=std::numeric_limits<size_t>::max();
+
+    if (!isLoaded) {
+      return false;
+    }
+
+    GeoBox       boundingBox=GeoBox::BoxByCenterAndRadius(coord,radius);
+    uint32_t     xStart=GetCellX(std::max(-180.0,boundingBox.GetMinLon()),cellDimension);
+    uint32_t     xEnd=GetCellX(std::min(180.0,boundingBox.GetMaxLon()),cellDimension);
+    uint32_t     yStart=GetCellY(std::max(-90.0,boundingBox.GetMinLat()),cellDimension);
+    uint32_t     yEnd=GetCellY(std::min(90.0,boundingBox.GetMaxLat()),cellDimension);
+    const Cell*  cellsEnd=cells+header.cellCount;
+    const Entry* best=NULL;
+    double       minDistance=std::numeric_limits<double>::max();
+
+    for (uint32_t y=yStart; y<=yEnd; y++) {
+      const Cell* cell=std::lower_bound(cells,
+                                        cellsEnd,
+                                        std::make_pair(y,xStart),
+                                        [](const Cell& cell, const std::pair<uint32_t,uint32_t>& key) {
+                                          return cell.y<key.first ||
+                                                 (cell.y==key.first && cell.x<key.second);
+                                        });
+
+      while (cell!=cellsEnd &&
+             cell->y==y &&
+             cell->x<=xEnd) {
+        const Entry* entry=entries+cell->firstEntry;
+        const Entry* entryEnd=entry+cell->entryCount;
+
+        for (; entry!=entryEnd; ++entry) {
+          if ((entry->vehicles & vehicle)==0) {
+            continue;
+          }
+
+          double distance=sqrt((entry->lat-coord.GetLat())*(entry->lat-coord.GetLat())+
+                               (entry->lon-coord.GetLon())*(entry->lon-coord.GetLon()));
+
+          if (distance<minDistance ||
+              (distance==minDistance &&
+               ((entry->type==refArea && best->type!=refArea) ||
+                (entry->type==best->type &&
+                 (entry->offset<best->offset ||
+                  (entry->offset==best->offset && entry->nodeIndex<best->nodeIndex)))))) {
+            minDistance=distance;
+            best=entry;
+          }
+        }
+
+        ++cell;
+      }
+    }
+
+    if (best!=NULL) {
+      object.Set(best->offset,(RefType)best->type);
+      nodeIndex=best->nodeIndex;
+    }
+
+    return true;
+  }
+
+  /**
+   * Return all segments of objects routable by the given vehicle, whose
+   * bounding box intersects the given bounding box.
+   *
+   * Since both nodes of a segment are stored in every cell intersected by
+   * the bounding box of the segment, the segments are reconstructed from the
+   * entries of each cell (the entries of a cell are sorted by object and
+   * node index). The closing segment of areas is not returned.
+   *
+   * @param boundingBox
+   *    Area to return the segments for
+   * @param vehicle
+   *    Vehicle that must be able to route on the object
+   * @param segments
+   *    The segments without duplicates, sorted by object type, object file
+   *    offset and node index. The entries of the segments point into the
+   *    index and are valid as long as the index is loaded.
+   * @return
+   *    False, if the index is not loaded, else true
+   */
+  bool RoutableSegmentIndex::GetSegments(const GeoBox& boundingBox,
+                                         Vehicle vehicle,
+                                         std::vector<Segment>& segments) const
+  {
+    segments.clear();
+
+    if (!isLoaded) {
+      return false;
+    }
+
+    uint32_t    xStart=GetCellX(std::max(-180.0,boundingBox.GetMinLon()),cellDimension);
+    uint32_t    xEnd=GetCellX(std::min(180.0,boundingBox.GetMaxLon()),cellDimension);
+    uint32_t    yStart=GetCellY(std::max(-90.0,boundingBox.GetMinLat()),cellDimension);
+    uint32_t    yEnd=GetCellY(std::min(90.0,boundingBox.GetMaxLat()),cellDimension);
+    const Cell* cellsEnd=cells+header.cellCount;
+    size_t      cellCount=0;
+
+    for (uint32_t y=yStart; y<=yEnd; y++) {
+      const Cell* cell=std::lower_bound(cells,
+                                        cellsEnd,
+                                        std::make_pair(y,xStart),
+                                        [](const Cell& cell, const std::pair<uint32_t,uint32_t>& key) {
+                                          return cell.y<key.first ||
+                                                 (cell.y==key.first && cell.x<key.second);
+                                        });
+
+      while (cell!=cellsEnd &&
+             cell->y==y &&
+             cell->x<=xEnd) {
+        const Entry* entryEnd=entries+cell->firstEntry+cell->entryCount;
+
+        for (const Entry* to=entries+cell->firstEntry+1; to<entryEnd; ++to) {
+          const Entry* from=to-1;
+
+          if ((to->vehicles & vehicle)==0 ||
+              from->offset!=to->offset ||
+              from->type!=to->type ||
+              from->nodeIndex+1!=to->nodeIndex) {
+            continue;
+          }
+
+          if (std::max(from->lat,to->lat)<boundingBox.GetMinLat() ||
+              std::min(from->lat,to->lat)>boundingBox.GetMaxLat() ||
+              std::max(from->lon,to->lon)<boundingBox.GetMinLon() ||
+              std::min(from->lon,to->lon)>boundingBox.GetMaxLon()) {
+            continue;
+          }
+
+          Segment segment;
+
+          segment.from=from;
+          segment.to=to;
+
+          segments.push_back(segment);
+        }
+
+        cellCount++;
+        ++cell;
+      }
+    }
+
+    // Segments crossing cell borders are returned once for each cell
+    std::sort(segments.begin(),
+              segments.end(),
+              [](const Segment& a, const Segment& b) {
+                if (a.from->type!=b.from->type) {
+                  return a.from->type<b.from->type;
+                }
+
+                if (a.from->offset!=b.from->offset) {
+                  return a.from->offset<b.from->offset;
+                }
+
+                return a.from->nodeIndex<b.from->nodeIndex;
+              });
+
+    if (cellCount>1) {
+      segments.erase(std::unique(segments.begin(),
+                                 segments.end(),
+                                 [](const Segment& a, const Segment& b) {
+                                   return a.from->type==b.from->type &&
+                                          a.from->offset==b.from->offset &&
+                                          a.from->nodeIndex==b.from->nodeIndex;
+                                 }),
+                     segments.end());
+    }
+
+    return true;
+  }
+}
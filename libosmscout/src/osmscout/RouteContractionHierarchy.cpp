@@ -0,0 +1,562 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/RouteContractionHierarchy.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/Logger.h>
+
+#include <osmscout/system/Assert.h>
+
+namespace osmscout {
+
+  namespace {
+
+    /**
+     * Label of a node in the forward or backward search
+     */
+    struct Label
+    {
+      double        cost;
+      uint32_t      edge;     //!< Edge the node was reached by
+      ObjectFileRef object;   //!< Forward: object we arrived with, backward: object we leave with
+      bool          access;   //!< Forward: we still have access, backward: we passed an unrestricted edge
+      bool          settled;
+    };
+
+    typedef std::unordered_map<uint32_t,Label>     LabelMap;
+    typedef std::pair<double,uint32_t>             QueueEntry;
+    typedef std::priority_queue<QueueEntry,
+                                std::vector<QueueEntry>,
+                                std::greater<QueueEntry> > Queue;
+  }
+
+  RouteContractionHierarchy::RouteContractionHierarchy()
+  : isLoaded(false),
+    vehicle(vehicleCar)
+  {
+    // no code
+  }
+
+  /**
+   * Return the name of the contraction hierarchy file for the given
+   * router and vehicle.
+   */
+  std::string RouteContractionHierarchy::GetFilename(const std::string& filenamebase,
+                                                     Vehicle vehicle)
+  {
+    switch (vehicle) {
+    case vehicleFoot:
+      return filenamebase+"_ch_foot.dat";
+    case vehicleBicycle:
+      return filenamebase+"_ch_bicycle.dat";
+    case vehicleCar:
+      return filenamebase+"_ch_car.dat";
+    }
+
+    return filenamebase+"_ch.dat";
+  }
+
+  /**
+   * Evaluate the costs of one meter for every object variant. If the
+   * variant cannot be used, a negative value is returned for it.
+   *
+   * Two profiles result in the same routes, if their variant costs
+   * are proportional.
+   */
+  void RouteContractionHierarchy::GetVariantCosts(const RoutingProfile& profile,
+                                                  const std::vector<ObjectVariantData>& objectVariantData,
+                                                  std::vector<double>& costs)
+  {
+    RouteNode node;
+
+    node.objects.resize(1);
+    node.paths.resize(1);
+
+    node.paths[0].distance=1.0;
+    node.paths[0].offset=0;
+    node.paths[0].objectIndex=0;
+    node.paths[0].flags=RouteNode::usableByFoot|RouteNode::usableByBicycle|RouteNode::usableByCar;
+
+    costs.resize(objectVariantData.size());
+
+    for (size_t i=0; i<objectVariantData.size(); i++) {
+      node.objects[0].objectVariantIndex=(uint16_t)i;
+
+      if (profile.CanUse(node,objectVariantData,0)) {
+        costs[i]=profile.GetCosts(node,objectVariantData,0);
+      }
+      else {
+        costs[i]=-1.0;
+      }
+    }
+  }
+
+  /**
+   * Load the contraction hierarchy from the given file.
+   *
+   * @return
+   *    True on success, else false
+   */
+  bool RouteContractionHierarchy::Load(const std::string& filename)
+  {
+    FileScanner scanner;
+
+    isLoaded=false;
+    this->filename=filename;
+
+    try {
+      uint8_t  vehicleValue;
+      uint32_t variantCount;
+      uint32_t nodeCount;
+      uint32_t edgeCount;
+
+      scanner.Open(filename,
+                   FileScanner::Sequential,
+                   true);
+
+      scanner.Read(vehicleValue);
+
+      vehicle=(Vehicle)vehicleValue;
+
+      scanner.Read(variantCount);
+
+      variantCosts.resize(variantCount);
+
+      for (size_t i=0; i<variantCount; i++) {
+        uint64_t value;
+
+        scanner.Read(value);
+
+        variantCosts[i]=DecodeCost(value);
+      }
+
+      scanner.Read(nodeCount);
+
+      nodeOffsets.resize(nodeCount);
+      excludeStart.resize(nodeCount+1);
+      forwardStart.resize(nodeCount+1);
+      backwardStart.resize(nodeCount+1);
+
+      excludes.clear();
+      forwardEdges.clear();
+      backwardEdges.clear();
+
+      for (size_t n=0; n<nodeCount; n++) {
+        uint32_t count;
+
+        scanner.ReadFileOffset(nodeOffsets[n]);
+
+        excludeStart[n]=(uint32_t)excludes.size();
+        scanner.ReadNumber(count);
+
+        for (size_t i=0; i<count; i++) {
+          Exclude exclude;
+
+          scanner.Read(exclude.source);
+          scanner.Read(exclude.target);
+
+          excludes.push_back(exclude);
+        }
+
+        forwardStart[n]=(uint32_t)forwardEdges.size();
+        scanner.ReadNumber(count);
+
+        for (size_t i=0; i<count; i++) {
+          uint32_t edge;
+
+          scanner.ReadNumber(edge);
+          forwardEdges.push_back(edge);
+        }
+
+        backwardStart[n]=(uint32_t)backwardEdges.size();
+        scanner.ReadNumber(count);
+
+        for (size_t i=0; i<count; i++) {
+          uint32_t edge;
+
+          scanner.ReadNumber(edge);
+          backwardEdges.push_back(edge);
+        }
+      }
+
+      excludeStart[nodeCount]=(uint32_t)excludes.size();
+      forwardStart[nodeCount]=(uint32_t)forwardEdges.size();
+      backwardStart[nodeCount]=(uint32_t)backwardEdges.size();
+
+      scanner.Read(edgeCount);
+
+      edges.resize(edgeCount);
+
+      for (auto& edge : edges) {
+        uint64_t cost;
+
+        scanner.ReadNumber(edge.from);
+        scanner.ReadNumber(edge.to);
+        scanner.Read(cost);
+        scanner.Read(edge.flags);
+        scanner.Read(edge.firstObject);
+        scanner.Read(edge.lastObject);
+        scanner.ReadNumber(edge.firstChild);
+        scanner.ReadNumber(edge.secondChild);
+
+        edge.cost=DecodeCost(cost);
+      }
+
+      scanner.Close();
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      scanner.CloseFailsafe();
+      return false;
+    }
+
+    isLoaded=true;
+
+    return true;
+  }
+
+  /**
+   * Check if the hierarchy can be used for the given profile. If this is the
+   * case, costFactor is set to the factor the costs stored in the hierarchy
+   * have to be multiplied with to get the costs of the profile.
+   */
+  bool RouteContractionHierarchy::GetCostFactor(const RoutingProfile& profile,
+                                                const std::vector<ObjectVariantData>& objectVariantData,
+                                                double& costFactor) const
+  {
+    if (!isLoaded ||
+        profile.GetVehicle()!=vehicle ||
+        objectVariantData.size()!=variantCosts.size()) {
+      return false;
+    }
+
+    std::vector<double> profileCosts;
+
+    GetVariantCosts(profile,
+                    objectVariantData,
+                    profileCosts);
+
+    costFactor=0.0;
+
+    for (size_t i=0; i<variantCosts.size(); i++) {
+      if ((variantCosts[i]<0.0)!=(profileCosts[i]<0.0)) {
+        return false;
+      }
+
+      if (variantCosts[i]<=0.0) {
+        continue;
+      }
+
+      double factor=profileCosts[i]/variantCosts[i];
+
+      if (costFactor==0.0) {
+        costFactor=factor;
+      }
+      else if (std::fabs(factor-costFactor)>costFactor*1e-9) {
+        return false;
+      }
+    }
+
+    if (costFactor==0.0) {
+      costFactor=1.0;
+    }
+
+    return true;
+  }
+
+  uint32_t RouteContractionHierarchy::GetNodeIndex(FileOffset routeNodeOffset) const
+  {
+    auto entry=std::lower_bound(nodeOffsets.begin(),
+                                nodeOffsets.end(),
+                                routeNodeOffset);
+
+    if (entry==nodeOffsets.end() ||
+        *entry!=routeNodeOffset) {
+      return INVALID_INDEX;
+    }
+
+    return (uint32_t)(entry-nodeOffsets.begin());
+  }
+
+  bool RouteContractionHierarchy::IsExcluded(uint32_t node,
+                                             const ObjectFileRef& source,
+                                             const ObjectFileRef& target) const
+  {
+    for (uint32_t i=excludeStart[node]; i<excludeStart[node+1]; i++) {
+      if (excludes[i].source==source &&
+          excludes[i].target==target) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /**
+   * Recursively replace the given edge by the original paths it is
+   * composed of and append the target route nodes of these paths.
+   */
+  void RouteContractionHierarchy::UnpackEdge(uint32_t edge,
+                                             std::vector<Step>& steps) const
+  {
+    std::vector<uint32_t> stack;
+
+    stack.push_back(edge);
+
+    while (!stack.empty()) {
+      const Edge& current=edges[stack.back()];
+
+      stack.pop_back();
+
+      if (current.IsShortcut()) {
+        stack.push_back(current.secondChild);
+        stack.push_back(current.firstChild);
+      }
+      else {
+        Step step;
+
+        step.routeNodeOffset=nodeOffsets[current.to];
+        step.object=current.firstObject;
+
+        steps.push_back(step);
+      }
+    }
+  }
+
+  /**
+   * Calculate the cheapest route from one of the given start route nodes
+   * to one of the given target route nodes.
+   *
+   * The resulting steps contain the start route node (with the object of
+   * the start terminal) followed by all route nodes on the route. If no route
+   * could be found, steps is empty.
+   *
+   * @return
+   *    False, if start or target nodes are not part of the hierarchy, else true
+   */
+  bool RouteContractionHierarchy::CalculateRoute(const std::vector<Terminal>& starts,
+                                                 const std::vector<Terminal>& targets,
+                                                 double costFactor,
+                                                 std::vector<Step>& steps,
+                                                 size_t& settledNodeCount) const
+  {
+    LabelMap forwardLabels;
+    LabelMap backwardLabels;
+    Queue    forwardQueue;
+    Queue    backwardQueue;
+    double   bestCost=std::numeric_limits<double>::infinity();
+    uint32_t meetingNode=INVALID_INDEX;
+
+    steps.clear();
+    settledNodeCount=0;
+
+    for (const auto& terminal : starts) {
+      uint32_t node=GetNodeIndex(terminal.routeNodeOffset);
+
+      if (node==INVALID_INDEX) {
+        log.Error() << "Start route node " << terminal.routeNodeOffset << " is not part of the contraction hierarchy";
+        return false;
+      }
+
+      auto entry=forwardLabels.find(node);
+
+      if (entry==forwardLabels.end() ||
+          terminal.cost<entry->second.cost) {
+        forwardLabels[node]={terminal.cost,INVALID_INDEX,terminal.object,true,false};
+        forwardQueue.push(QueueEntry(terminal.cost,node));
+      }
+    }
+
+    for (const auto& terminal : targets) {
+      uint32_t node=GetNodeIndex(terminal.routeNodeOffset);
+
+      if (node==INVALID_INDEX) {
+        log.Error() << "Target route node " << terminal.routeNodeOffset << " is not part of the contraction hierarchy";
+        return false;
+      }
+
+      auto entry=backwardLabels.find(node);
+
+      if (entry==backwardLabels.end() ||
+          terminal.cost<entry->second.cost) {
+        backwardLabels[node]={terminal.cost,INVALID_INDEX,ObjectFileRef(),false,false};
+        backwardQueue.push(QueueEntry(terminal.cost,node));
+      }
+    }
+
+    while (!forwardQueue.empty() ||
+           !backwardQueue.empty()) {
+      double forwardMin=forwardQueue.empty() ? std::numeric_limits<double>::infinity() : forwardQueue.top().first;
+      double backwardMin=backwardQueue.empty() ? std::numeric_limits<double>::infinity() : backwardQueue.top().first;
+
+      if (std::min(forwardMin,backwardMin)>=bestCost) {
+        break;
+      }
+
+      bool     forward=forwardMin<=backwardMin;
+      Queue&   queue=forward ? forwardQueue : backwardQueue;
+      LabelMap &labels=forward ? forwardLabels : backwardLabels;
+      LabelMap &otherLabels=forward ? backwardLabels : forwardLabels;
+      uint32_t node=queue.top().second;
+      double   cost=queue.top().first;
+
+      queue.pop();
+
+      Label& label=labels[node];
+
+      if (label.settled ||
+          cost>label.cost) {
+        continue;
+      }
+
+      label.settled=true;
+      settledNodeCount++;
+
+      // Check if we found a (better) connection of both searches
+
+      auto other=otherLabels.find(node);
+
+      if (other!=otherLabels.end()) {
+        const Label& forwardLabel=forward ? label : other->second;
+        const Label& backwardLabel=forward ? other->second : label;
+
+        // Moving from a restricted path back to an unrestricted path is not allowed
+        bool valid=forwardLabel.access || !backwardLabel.access;
+
+        if (valid &&
+            backwardLabel.object.Valid() &&
+            IsExcluded(node,forwardLabel.object,backwardLabel.object)) {
+          valid=false;
+        }
+
+        if (valid &&
+            forwardLabel.cost+backwardLabel.cost<bestCost) {
+          bestCost=forwardLabel.cost+backwardLabel.cost;
+          meetingNode=node;
+        }
+      }
+
+      // Copy, since inserting new labels may invalidate the reference
+      Label current=label;
+
+      if (forward) {
+        for (uint32_t i=forwardStart[node]; i<forwardStart[node+1]; i++) {
+          const Edge& edge=edges[forwardEdges[i]];
+
+          if (!current.access &&
+              !edge.IsRestricted()) {
+            continue;
+          }
+
+          if (IsExcluded(node,current.object,edge.firstObject)) {
+            continue;
+          }
+
+          double newCost=current.cost+edge.cost*costFactor;
+          auto   entry=forwardLabels.find(edge.to);
+
+          if (entry!=forwardLabels.end() &&
+              (entry->second.settled || entry->second.cost<=newCost)) {
+            continue;
+          }
+
+          forwardLabels[edge.to]={newCost,forwardEdges[i],edge.lastObject,!edge.IsRestricted(),false};
+          forwardQueue.push(QueueEntry(newCost,edge.to));
+        }
+      }
+      else {
+        for (uint32_t i=backwardStart[node]; i<backwardStart[node+1]; i++) {
+          const Edge& edge=edges[backwardEdges[i]];
+
+          if (current.access &&
+              edge.IsRestricted()) {
+            continue;
+          }
+
+          if (current.object.Valid() &&
+              IsExcluded(node,edge.lastObject,current.object)) {
+            continue;
+          }
+
+          double newCost=current.cost+edge.cost*costFactor;
+          auto   entry=backwardLabels.find(edge.from);
+
+          if (entry!=backwardLabels.end() &&
+              (entry->second.settled || entry->second.cost<=newCost)) {
+            continue;
+          }
+
+          backwardLabels[edge.from]={newCost,backwardEdges[i],edge.firstObject,current.access || !edge.IsRestricted(),false};
+          backwardQueue.push(QueueEntry(newCost,edge.from));
+        }
+      }
+    }
+
+    if (meetingNode==INVALID_INDEX) {
+      return true;
+    }
+
+    // Collect the edges from the start to the meeting node...
+
+    std::vector<uint32_t> path;
+    uint32_t              node=meetingNode;
+
+    while (forwardLabels[node].edge!=INVALID_INDEX) {
+      uint32_t edge=forwardLabels[node].edge;
+
+      path.push_back(edge);
+      node=edges[edge].from;
+    }
+
+    std::reverse(path.begin(),path.end());
+
+    Step start;
+
+    start.routeNodeOffset=nodeOffsets[node];
+    start.object=forwardLabels[node].object;
+
+    steps.push_back(start);
+
+    // ...and from the meeting node to the target
+
+    node=meetingNode;
+
+    while (backwardLabels[node].edge!=INVALID_INDEX) {
+      uint32_t edge=backwardLabels[node].edge;
+
+      path.push_back(edge);
+      node=edges[edge].to;
+    }
+
+    for (const auto edge : path) {
+      UnpackEdge(edge,
+                 steps);
+    }
+
+    return true;
+  }
+}
@@ -0,0 +1,55 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/RouteMatrix.h>
+
+#include <limits>
+
+namespace osmscout {
+
+  RouteMatrix::RouteMatrix()
+  : sourceCount(0),
+    targetCount(0)
+  {
+    // no code
+  }
+
+  /**
+   * Resizes the matrix to the given dimensions and marks all entries as
+   * unreachable.
+   */
+  void RouteMatrix::Initialize(size_t sourceCount,
+                               size_t targetCount)
+  {
+    double infinity=std::numeric_limits<double>::infinity();
+
+    this->sourceCount=sourceCount;
+    this->targetCount=targetCount;
+
+    costs.assign(sourceCount*targetCount,infinity);
+    times.assign(sourceCount*targetCount,infinity);
+    distances.assign(sourceCount*targetCount,infinity);
+  }
+
+  bool RouteMatrix::IsReachable(size_t source,
+                                size_t target) const
+  {
+    return costs[GetIndex(source,target)]!=std::numeric_limits<double>::infinity();
+  }
+}
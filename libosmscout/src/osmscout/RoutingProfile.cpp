@@ -32,6 +32,19 @@ namespace osmscout {
     // no code
   }
 
+  /**
+   * Return the time in hours needed to travel the given path of the route node.
+   *
+   * The default implementation is for profiles written before this method was
+   * added. It does not know about speeds and thus returns 0 (no time information).
+   */
+  double RoutingProfile::GetTime(const RouteNode& /*currentNode*/,
+                                 const std::vector<ObjectVariantData>& /*objectVariantData*/,
+                                 size_t /*pathIndex*/) const
+  {
+    return 0.0;
+  }
+
   AbstractRoutingProfile::AbstractRoutingProfile(const TypeConfigRef& typeConfig)
    : typeConfig(typeConfig),
      accessReader(*typeConfig),
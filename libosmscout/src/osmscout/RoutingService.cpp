@@ -20,21 +20,36 @@
 #include <osmscout/RoutingService.h>
 
 #include <algorithm>
+#include <cstring>
+#include <future>
+#include <mutex>
+#include <thread>
 
 #include <osmscout/RoutingProfile.h>
 
 #include <osmscout/system/Assert.h>
 
+#include <osmscout/util/File.h>
 #include <osmscout/util/Geometry.h>
 #include <osmscout/util/Logger.h>
 #include <osmscout/util/StopClock.h>
+#include <osmscout/util/String.h>
+#include <osmscout/util/WorkQueue.h>
 
 //#define DEBUG_ROUTING
 
 namespace osmscout {
 
   RouterParameter::RouterParameter()
-  : debugPerformance(false)
+  : debugPerformance(false),
+    useContractionHierarchy(true),
+    useCompactRouteGraph(true),
+    useRoutableSegmentIndex(true),
+    threadCount(0),
+    snappedPointCacheSize(1000),
+    routeLegCacheSize(100),
+    routeNodeCacheSize(100000),
+    isochroneCellSize(0.0)
   {
     // no code
   }
@@ -44,11 +59,136 @@ namespace osmscout {
     debugPerformance=debug;
   }
 
+  /**
+   * If set to true (the default), routes are calculated using a contraction
+   * hierarchy if one has been generated during import for the vehicle and it
+   * matches the given routing profile. Else the A* algorithm is used.
+   */
+  void RouterParameter::SetUseContractionHierarchy(bool useContractionHierarchy)
+  {
+    this->useContractionHierarchy=useContractionHierarchy;
+  }
+
+  /**
+   * If set to true (the default), routes that cannot be calculated using a
+   * contraction hierarchy are calculated on the compact route graph, if it
+   * has been generated during import and can be used for the given routing
+   * profile (see CompactRouteGraph::GetVariantCosts()). Else the A* algorithm
+   * reads the route nodes from the routing graph.
+   */
+  void RouterParameter::SetUseCompactRouteGraph(bool useCompactRouteGraph)
+  {
+    this->useCompactRouteGraph=useCompactRouteGraph;
+  }
+
+  /**
+   * If set to true (the default), GetClosestRoutableNode() and SnapPoints()
+   * use the routable segment index, if it has been generated during import.
+   * Else ways and areas are loaded using the area indexes of the database.
+   */
+  void RouterParameter::SetUseRoutableSegmentIndex(bool useRoutableSegmentIndex)
+  {
+    this->useRoutableSegmentIndex=useRoutableSegmentIndex;
+  }
+
+  /**
+   * Number of threads used for calculations that can run in parallel, like
+   * CalculateMatrix() or the legs of a route via a list of coordinates.
+   * 0 (the default) means one thread per core.
+   */
+  void RouterParameter::SetThreadCount(size_t threadCount)
+  {
+    this->threadCount=threadCount;
+  }
+
+  /**
+   * Number of via points for which the result of GetClosestRoutableNode() is
+   * cached while calculating routes via a list of coordinates. 0 disables
+   * the cache.
+   */
+  void RouterParameter::SetSnappedPointCacheSize(size_t snappedPointCacheSize)
+  {
+    this->snappedPointCacheSize=snappedPointCacheSize;
+  }
+
+  /**
+   * Number of route legs (routes between two consecutive via points) that are
+   * cached while calculating routes via a list of coordinates. Recalculating
+   * a route after changing one via point then only calculates the changed
+   * legs. 0 disables the cache.
+   */
+  void RouterParameter::SetRouteLegCacheSize(size_t routeLegCacheSize)
+  {
+    this->routeLegCacheSize=routeLegCacheSize;
+  }
+
+  /**
+   * Number of route nodes cached by CalculateMatrix(). The cache is kept
+   * between calls, so repeated matrix calculations in the same region (like
+   * the transitions calculated by the MapMatchingService) do not load the
+   * same route nodes again. 0 disables the cache.
+   */
+  void RouterParameter::SetRouteNodeCacheSize(size_t routeNodeCacheSize)
+  {
+    this->routeNodeCacheSize=routeNodeCacheSize;
+  }
+
+  /**
+   * Size in km of the grid cells used by CalculateIsochrone() to calculate
+   * the outline of the reachable area. Smaller cells follow the reachable
+   * ways more closely. 0 (the default) means 1/100 of the extent of the area
+   * reachable within the maximum costs.
+   */
+  void RouterParameter::SetIsochroneCellSize(double isochroneCellSize)
+  {
+    this->isochroneCellSize=isochroneCellSize;
+  }
+
   bool RouterParameter::IsDebugPerformance() const
   {
     return debugPerformance;
   }
 
+  bool RouterParameter::IsUseContractionHierarchy() const
+  {
+    return useContractionHierarchy;
+  }
+
+  bool RouterParameter::IsUseCompactRouteGraph() const
+  {
+    return useCompactRouteGraph;
+  }
+
+  bool RouterParameter::IsUseRoutableSegmentIndex() const
+  {
+    return useRoutableSegmentIndex;
+  }
+
+  size_t RouterParameter::GetThreadCount() const
+  {
+    return threadCount;
+  }
+
+  size_t RouterParameter::GetSnappedPointCacheSize() const
+  {
+    return snappedPointCacheSize;
+  }
+
+  size_t RouterParameter::GetRouteLegCacheSize() const
+  {
+    return routeLegCacheSize;
+  }
+
+  size_t RouterParameter::GetRouteNodeCacheSize() const
+  {
+    return routeNodeCacheSize;
+  }
+
+  double RouterParameter::GetIsochroneCellSize() const
+  {
+    return isochroneCellSize;
+  }
+
   const char* const RoutingService::FILENAME_INTERSECTIONS_DAT   = "intersections.dat";
   const char* const RoutingService::FILENAME_INTERSECTIONS_IDX   = "intersections.idx";
 
@@ -73,12 +213,20 @@ namespace osmscout {
      accessReader(*database->GetTypeConfig()),
      isOpen(false),
      debugPerformance(parameter.IsDebugPerformance()),
+     useContractionHierarchy(parameter.IsUseContractionHierarchy()),
+     useCompactRouteGraph(parameter.IsUseCompactRouteGraph()),
+     useRoutableSegmentIndex(parameter.IsUseRoutableSegmentIndex()),
+     threadCount(parameter.GetThreadCount()),
+     isochroneCellSize(parameter.GetIsochroneCellSize()),
      routeNodeDataFile(GetDataFilename(filenamebase),
                        GetIndexFilename(filenamebase),
                        12000),
      junctionDataFile(RoutingService::FILENAME_INTERSECTIONS_DAT,
                       RoutingService::FILENAME_INTERSECTIONS_IDX,
-                      10000)
+                      10000),
+     snappedPointCache(parameter.GetSnappedPointCacheSize()),
+     routeLegCache(parameter.GetRouteLegCacheSize()),
+     routeNodeCache(parameter.GetRouteNodeCacheSize())
   {
     assert(database);
   }
@@ -148,6 +296,85 @@ namespace osmscout {
       return false;
     }
 
+    contractionHierarchies.clear();
+
+    if (useContractionHierarchy) {
+      Vehicle vehicles[]={vehicleFoot,vehicleBicycle,vehicleCar};
+
+      for (const auto vehicle : vehicles) {
+        std::string filename=AppendFileToDir(path,
+                                             RouteContractionHierarchy::GetFilename(filenamebase,
+                                                                                    vehicle));
+
+        if (!ExistsInFilesystem(filename)) {
+          continue;
+        }
+
+        RouteContractionHierarchyRef hierarchy=std::make_shared<RouteContractionHierarchy>();
+        StopClock                    hierarchyTimer;
+
+        if (!hierarchy->Load(filename)) {
+          log.Error() << "Cannot load contraction hierarchy '" << filename << "'!";
+          continue;
+        }
+
+        hierarchyTimer.Stop();
+
+        log.Debug() << "Opening contraction hierarchy '" << filename << "': " << hierarchyTimer.ResultString();
+
+        contractionHierarchies.push_back(hierarchy);
+      }
+    }
+
+    compactRouteGraph=nullptr;
+
+    if (useCompactRouteGraph) {
+      std::string filename=AppendFileToDir(path,
+                                           CompactRouteGraph::GetFilename(filenamebase));
+
+      if (ExistsInFilesystem(filename)) {
+        CompactRouteGraphRef graph=std::make_shared<CompactRouteGraph>();
+        StopClock            graphTimer;
+
+        if (!graph->Load(filename)) {
+          log.Error() << "Cannot load compact route graph '" << filename << "'!";
+        }
+        else if (graph->GetVariantCount()!=objectVariantDataFile.GetData().size()) {
+          log.Error() << "Compact route graph '" << filename << "' does not match the routing graph, ignoring it";
+        }
+        else {
+          graphTimer.Stop();
+
+          log.Debug() << "Opening compact route graph '" << filename << "': " << graphTimer.ResultString();
+
+          compactRouteGraph=graph;
+        }
+      }
+    }
+
+    routableSegmentIndex=nullptr;
+
+    if (useRoutableSegmentIndex) {
+      std::string filename=AppendFileToDir(path,
+                                           RoutableSegmentIndex::ROUTABLE_SEGMENT_IDX);
+
+      if (ExistsInFilesystem(filename)) {
+        RoutableSegmentIndexRef index=std::make_shared<RoutableSegmentIndex>();
+        StopClock               indexTimer;
+
+        if (!index->Load(filename)) {
+          log.Error() << "Cannot load routable segment index '" << filename << "'!";
+        }
+        else {
+          indexTimer.Stop();
+
+          log.Debug() << "Opening routable segment index '" << filename << "': " << indexTimer.ResultString();
+
+          routableSegmentIndex=index;
+        }
+      }
+    }
+
     isOpen=true;
 
     return true;
@@ -170,6 +397,12 @@ namespace osmscout {
   void RoutingService::Close()
   {
     routeNodeDataFile.Close();
+    contractionHierarchies.clear();
+    compactRouteGraph=nullptr;
+    routableSegmentIndex=nullptr;
+    snappedPointCache.Flush();
+    routeLegCache.Flush();
+    routeNodeCache.Flush();
 
     isOpen=false;
   }
@@ -299,14 +532,14 @@ namespace osmscout {
                                                const ClosedSet& closedSet,
                                                std::list<VNode>& nodes)
   {
-    ClosedSet::const_iterator current=closedSet.find(VNode(finalRouteNode));
+    const VNode* current=closedSet.Find(finalRouteNode);
 
-    assert(current!=closedSet.end());
+    assert(current!=nullptr);
 
     while (current->previousNode!=0) {
-      ClosedSet::const_iterator prev=closedSet.find(VNode(current->previousNode));
+      const VNode* prev=closedSet.Find(current->previousNode);
 
-      assert(prev!=closedSet.end());
+      assert(prev!=nullptr);
 
       nodes.push_back(*current);
 
@@ -691,6 +924,9 @@ namespace osmscout {
       }
     }
 
+    // The junction data file is opened and closed for each call
+    std::lock_guard<std::mutex> lock(junctionMutex);
+
     if (!junctionDataFile.IsOpen()) {
       StopClock timer;
 
@@ -742,6 +978,7 @@ namespace osmscout {
   }
 
   bool RoutingService::GetStartNodes(const RoutingProfile& profile,
+                                     Arena<RNode>& rnodeArena,
                                      const ObjectFileRef& object,
                                      size_t nodeIndex,
                                      double& targetLon,
@@ -821,9 +1058,9 @@ namespace osmscout {
           return false;
         }
 
-        RNodeRef node=std::make_shared<RNode>(forwardOffset,
-                                              forwardRouteNode,
-                                              object);
+        RNodeRef node=rnodeArena.Allocate(forwardOffset,
+                                          forwardRouteNode,
+                                          object);
 
         node->currentCost=profile.GetCosts(*way,
                                            GetSphericalDistance(startLon,
@@ -848,9 +1085,9 @@ namespace osmscout {
           return false;
         }
 
-        RNodeRef node=std::make_shared<RNode>(backwardOffset,
-                                              backwardRouteNode,
-                                              object);
+        RNodeRef node=rnodeArena.Allocate(backwardOffset,
+                                          backwardRouteNode,
+                                          object);
 
         node->currentCost=profile.GetCosts(*way,
                                            GetSphericalDistance(startLon,
@@ -958,205 +1195,796 @@ namespace osmscout {
   }
 
   /**
-   * Calculate a route
+   * Return a contraction hierarchy that can be used for the given profile
+   * together with the factor to convert its costs into the costs of the profile.
    *
-   * @param profile
-   *    Profile to use
-   * @param route
-   *    The route object holding the resulting route on success
    * @return
-   *    True, if the engine was able to find a route, else false
+   *    False, if no matching contraction hierarchy is available
    */
-
-  bool RoutingService::CalculateRoute(const RoutingProfile& profile,
-                                      Vehicle vehicle,
-                                      double radius,
-                                      std::vector<osmscout::GeoCoord> via,
-                                      RouteData& route)
+  bool RoutingService::GetContractionHierarchy(const RoutingProfile& profile,
+                                               RouteContractionHierarchyRef& hierarchy,
+                                               double& costFactor) const
   {
-      std::vector<size_t>                  nodeIndexes;
-      std::vector<osmscout::ObjectFileRef> objects;
-
-      for (const auto& etap : via) {
-        size_t                  targetNodeIndex;
-        osmscout::ObjectFileRef targetObject;
+    for (const auto& candidate : contractionHierarchies) {
+      if (candidate->GetCostFactor(profile,
+                                   objectVariantDataFile.GetData(),
+                                   costFactor)) {
+        hierarchy=candidate;
 
-        if (!GetClosestRoutableNode(etap.GetLat(),
-                                    etap.GetLon(),
-                                    vehicle,
-                                    radius,
-                                    targetObject,
-                                    targetNodeIndex)) {
-          return false;
-        }
-
-        nodeIndexes.push_back(targetNodeIndex);
-        objects.push_back(targetObject);
+        return true;
       }
+    }
 
-      for (int index=0; index<(int)nodeIndexes.size()-1; index++) {
-        size_t                  fromNodeIndex=nodeIndexes.at(index);
-        osmscout::ObjectFileRef fromObject=objects.at(index);
-        size_t                  toNodeIndex=nodeIndexes.at(index+1);
-        osmscout::ObjectFileRef toObject=objects.at(index+1);
-        RouteData               *routePart=new RouteData;
-
-        if (!CalculateRoute(profile,
-                            fromObject,
-                            fromNodeIndex,
-                            toObject,
-                            toNodeIndex,
-                            *routePart)) {
-            return false;
-        }
-
-        if (routePart->IsEmpty()) {
-          return false;
-        }
-
-        /* In intermediary via points the end of the previous part is the start of the */
-        /* next part, we need to remove the duplicate point in the calculated route */
-        if (index<(int)nodeIndexes.size()-2) {
-          routePart->PopEntry();
-        }
-
-        route.Append(*routePart);
+    return false;
+  }
 
-        delete routePart;
-      }
+  /**
+   * Return true, if routes for the given profile are calculated using a
+   * contraction hierarchy.
+   */
+  bool RoutingService::HasContractionHierarchy(const RoutingProfile& profile) const
+  {
+    RouteContractionHierarchyRef hierarchy;
+    double                       costFactor;
 
-      return true;
+    return GetContractionHierarchy(profile,
+                                   hierarchy,
+                                   costFactor);
   }
 
   /**
-   * Calculate a route
-   *
-   * @param profile
-   *    Profile to use
-   * @param startObject
-   *    Start object
-   * @param startNodeIndex
-   *    Index of the node within the start object used as starting point
-   * @param targetObject
-   *    Target object
-   * @param targetNodeIndex
-   *    Index of the node within the target object used as target point
-   * @param route
-   *    The route object holding the resulting route on success
-   * @return
-   *    True, if the engine was able to find a route, else false
+   * Calculate a route using a bidirectional search in the given contraction
+   * hierarchy. The result is equal to the result of the A* algorithm
+   * as used by CalculateRoute().
    */
-  bool RoutingService::CalculateRoute(const RoutingProfile& profile,
-                                      const ObjectFileRef& startObject,
-                                      size_t startNodeIndex,
-                                      const ObjectFileRef& targetObject,
-                                      size_t targetNodeIndex,
-                                      RouteData& route)
+  bool RoutingService::CalculateRouteUsingContractionHierarchy(const RoutingProfile& profile,
+                                                               const RouteContractionHierarchy& hierarchy,
+                                                               double costFactor,
+                                                               const ObjectFileRef& startObject,
+                                                               size_t startNodeIndex,
+                                                               const RNodeRef& startForwardNode,
+                                                               const RNodeRef& startBackwardNode,
+                                                               const ObjectFileRef& targetObject,
+                                                               size_t targetNodeIndex,
+                                                               const RouteNodeRef& targetForwardRouteNode,
+                                                               const RouteNodeRef& targetBackwardRouteNode,
+                                                               double targetLon,
+                                                               double targetLat,
+                                                               RouteData& route)
   {
-    Vehicle                  vehicle=profile.GetVehicle();
-    RouteNodeRef             startForwardRouteNode;
-    RouteNodeRef             startBackwardRouteNode;
-    RNodeRef                 startForwardNode;
-    RNodeRef                 startBackwardNode;
+    std::vector<RouteContractionHierarchy::Terminal> starts;
+    std::vector<RouteContractionHierarchy::Terminal> targets;
+    std::vector<RouteContractionHierarchy::Step>     steps;
+    size_t                                           settledNodeCount;
 
-    double                   targetLon=0.0L;
-    double                   targetLat=0.0L;
+    for (const auto& node : {startForwardNode,startBackwardNode}) {
+      if (node) {
+        RouteContractionHierarchy::Terminal terminal;
 
-    RouteNodeRef             targetForwardRouteNode;
-    RouteNodeRef             targetBackwardRouteNode;
+        terminal.routeNodeOffset=node->nodeOffset;
+        terminal.object=node->object;
+        terminal.cost=node->currentCost;
 
-    // Sorted list (smallest cost first) of ways to check (we are using a std::set)
-    OpenList                 openList;
-    // Map routing nodes by id
-    OpenMap                  openMap;
-    ClosedSet                closedSet;
+        starts.push_back(terminal);
+      }
+    }
 
-    size_t                   nodesLoadedCount=0;
-    size_t                   nodesIgnoredCount=0;
-    size_t                   maxOpenList=0;
-    size_t                   maxClosedSet=0;
+    // Like the A* algorithm we take the estimated costs of the remaining distance
+    // to the target into account to choose between both target route nodes
+    for (const auto& node : {targetForwardRouteNode,targetBackwardRouteNode}) {
+      if (node) {
+        RouteContractionHierarchy::Terminal terminal;
 
-    route.Clear();
+        terminal.routeNodeOffset=node->GetFileOffset();
+        terminal.cost=profile.GetCosts(GetSphericalDistance(node->GetCoord().GetLon(),
+                                                            node->GetCoord().GetLat(),
+                                                            targetLon,
+                                                            targetLat));
 
-    openMap.reserve(10000);
-    closedSet.reserve(300000);
+        targets.push_back(terminal);
+      }
+    }
 
-    if (!GetTargetNodes(profile,
-                        targetObject,
-                        targetNodeIndex,
-                        targetLon,
-                        targetLat,
-                        targetForwardRouteNode,
-                        targetBackwardRouteNode)) {
+    StopClock clock;
+
+    if (!hierarchy.CalculateRoute(starts,
+                                  targets,
+                                  costFactor,
+                                  steps,
+                                  settledNodeCount)) {
       return false;
     }
 
-    if (!GetStartNodes(profile,
-                       startObject,
-                       startNodeIndex,
-                       targetLon,
-                       targetLat,
-                       startForwardRouteNode,
-                       startBackwardRouteNode,
-                       startForwardNode,
-                       startBackwardNode)) {
-      return false;
+    clock.Stop();
+
+    if (debugPerformance) {
+      std::cout << "From:                " << startObject.GetTypeName() << " " << startObject.GetFileOffset();
+      std::cout << "[" << startNodeIndex << "]" << std::endl;
+      std::cout << "To:                  " << targetObject.GetTypeName() <<  " " << targetObject.GetFileOffset();
+      std::cout << "[" << targetNodeIndex << "]" << std::endl;
+      std::cout << "Contraction hierarchy: " << hierarchy.GetFilename() << std::endl;
+      std::cout << "Time:                " << clock << std::endl;
+      std::cout << "Route nodes settled: " << settledNodeCount << std::endl;
     }
 
-    if (startForwardNode) {
-      std::pair<OpenListRef,bool> result=openList.insert(startForwardNode);
+    if (steps.empty()) {
+      route.Clear();
 
-      openMap[startForwardNode->nodeOffset]=result.first;
+      return true;
     }
 
-    if (startBackwardNode) {
-      std::pair<OpenListRef,bool> result=openList.insert(startBackwardNode);
+    std::list<VNode> nodes;
+    FileOffset       previousNode=0;
+
+    for (const auto& step : steps) {
+      nodes.push_back(VNode(step.routeNodeOffset,
+                            step.object,
+                            previousNode));
 
-      openMap[startBackwardNode->nodeOffset]=result.first;
+      previousNode=step.routeNodeOffset;
     }
 
-    StopClock    clock;
-    RNodeRef     current;
-    RouteNodeRef currentRouteNode;
+    if (!ResolveRNodesToRouteData(profile,
+                                  nodes,
+                                  startObject,
+                                  startNodeIndex,
+                                  targetObject,
+                                  targetNodeIndex,
+                                  route)) {
+      return false;
+    }
 
-    do {
-      //
-      // Take entry from open list with lowest cost
-      //
+    ResolveRouteDataJunctions(route);
 
-      current=*openList.begin();
+    return true;
+  }
 
-      openMap.erase(current->nodeOffset);
-      openList.erase(openList.begin());
+  /**
+   * Calculate a route using the A* algorithm on the compact route graph. The
+   * result is equal to the result of the A* algorithm reading the route nodes
+   * from the routing graph.
+   *
+   * variantCosts are the costs per object variant as returned by
+   * CompactRouteGraph::GetVariantCosts() for the profile.
+   */
+  bool RoutingService::CalculateRouteUsingCompactRouteGraph(const RoutingProfile& profile,
+                                                            const std::vector<double>& variantCosts,
+                                                            const ObjectFileRef& startObject,
+                                                            size_t startNodeIndex,
+                                                            const RNodeRef& startForwardNode,
+                                                            const RNodeRef& startBackwardNode,
+                                                            const ObjectFileRef& targetObject,
+                                                            size_t targetNodeIndex,
+                                                            const RouteNodeRef& targetForwardRouteNode,
+                                                            const RouteNodeRef& targetBackwardRouteNode,
+                                                            double targetLon,
+                                                            double targetLat,
+                                                            RouteData& route)
+  {
+    std::vector<CompactRouteGraph::Terminal> starts;
+    std::vector<FileOffset>                  targets;
+    std::vector<CompactRouteGraph::Step>     steps;
+    size_t                                   expandedNodeCount;
 
-      currentRouteNode=current->node;
+    for (const auto& node : {startForwardNode,startBackwardNode}) {
+      if (node) {
+        CompactRouteGraph::Terminal terminal;
 
-      nodesLoadedCount++;
+        terminal.routeNodeOffset=node->nodeOffset;
+        terminal.object=node->object;
+        terminal.cost=node->currentCost;
 
-      bool accessViolation=false;
+        starts.push_back(terminal);
+      }
+    }
 
-      // Get potential follower in the current way
+    for (const auto& node : {targetForwardRouteNode,targetBackwardRouteNode}) {
+      if (node) {
+        targets.push_back(node->GetFileOffset());
+      }
+    }
 
-#if defined(DEBUG_ROUTING)
-      std::cout << "Analysing follower of node " << currentRouteNode->GetFileOffset();
-      std::cout << " (" << current->object.GetTypeName() << " " << current->object.GetFileOffset() << "["  << currentRouteNode->GetId() << "]" << ")";
-      std::cout << " " << current->currentCost << " " << current->estimateCost << " " << current->overallCost << std::endl;
-#endif
-      size_t i=0;
-      for (const auto& path : currentRouteNode->paths) {
-        if (path.offset==current->prev) {
-#if defined(DEBUG_ROUTING)
-          std::cout << "  Skipping route";
-          std::cout << " to " << path.offset;
-          std::cout << " (" << currentRouteNode->objects[path.objectIndex].object.GetTypeName() << " " << currentRouteNode->objects[path.objectIndex].object.GetFileOffset() << ")";
-          std::cout << " => back to the last node visited" << std::endl;
-#endif
-          nodesIgnoredCount++;
-          i++;
-          continue;
-        }
+    StopClock clock;
 
-        if (!current->access &&
+    if (!compactRouteGraph->CalculateRoute(profile,
+                                           variantCosts,
+                                           starts,
+                                           targets,
+                                           GeoCoord(targetLat,targetLon),
+                                           steps,
+                                           expandedNodeCount)) {
+      return false;
+    }
+
+    clock.Stop();
+
+    if (debugPerformance) {
+      std::cout << "From:                " << startObject.GetTypeName() << " " << startObject.GetFileOffset();
+      std::cout << "[" << startNodeIndex << "]" << std::endl;
+      std::cout << "To:                  " << targetObject.GetTypeName() <<  " " << targetObject.GetFileOffset();
+      std::cout << "[" << targetNodeIndex << "]" << std::endl;
+      std::cout << "Compact route graph: " << compactRouteGraph->GetFilename() << std::endl;
+      std::cout << "Time:                " << clock << std::endl;
+      std::cout << "Expanded nodes:      " << expandedNodeCount << std::endl;
+    }
+
+    if (steps.empty()) {
+      route.Clear();
+
+      return true;
+    }
+
+    std::list<VNode> nodes;
+    FileOffset       previousNode=0;
+
+    for (const auto& step : steps) {
+      nodes.push_back(VNode(step.routeNodeOffset,
+                            step.object,
+                            previousNode));
+
+      previousNode=step.routeNodeOffset;
+    }
+
+    if (!ResolveRNodesToRouteData(profile,
+                                  nodes,
+                                  startObject,
+                                  startNodeIndex,
+                                  targetObject,
+                                  targetNodeIndex,
+                                  route)) {
+      return false;
+    }
+
+    ResolveRouteDataJunctions(route);
+
+    return true;
+  }
+
+  static inline uint64_t HashValue(uint64_t hash,
+                                   uint64_t value)
+  {
+    // FNV-1a over the bytes of the value
+    for (size_t i=0; i<sizeof(value); i++) {
+      hash^=(value >> (i*8)) & 0xff;
+      hash*=1099511628211ULL;
+    }
+
+    return hash;
+  }
+
+  static inline uint64_t HashValue(uint64_t hash,
+                                   double value)
+  {
+    uint64_t bits;
+
+    std::memcpy(&bits,&value,sizeof(bits));
+
+    return HashValue(hash,bits);
+  }
+
+  static inline uint64_t HashValue(uint64_t hash,
+                                   const RoutePosition& position)
+  {
+    hash=HashValue(hash,(uint64_t)position.object.GetType());
+    hash=HashValue(hash,(uint64_t)position.object.GetFileOffset());
+
+    return HashValue(hash,(uint64_t)position.nodeIndex);
+  }
+
+  static inline bool IsSamePosition(const RoutePosition& a,
+                                    const RoutePosition& b)
+  {
+    return a.object==b.object &&
+           a.nodeIndex==b.nodeIndex;
+  }
+
+  /**
+   * Return the number of threads to use for the given number of
+   * independent tasks. A thread count of 0 means one thread per core.
+   */
+  size_t RoutingService::GetWorkerCount(size_t threadCount,
+                                        size_t taskCount) const
+  {
+    size_t workerCount=threadCount;
+
+    if (workerCount==0) {
+      workerCount=std::max((unsigned int)1,std::thread::hardware_concurrency());
+    }
+
+    return std::max((size_t)1,std::min(workerCount,taskCount));
+  }
+
+  /**
+   * Execute the given tasks in parallel using the given number of threads
+   * (see RouterParameter::SetThreadCount()) and wait until all of them have
+   * finished. If only one thread is used, the tasks are executed in the
+   * calling thread.
+   *
+   * @return
+   *    True, if all tasks returned true, else false
+   */
+  bool RoutingService::RunTasks(const std::vector<std::function<bool()>>& tasks,
+                                size_t threadCount) const
+  {
+    WorkQueue<bool>                queue;
+    std::vector<std::thread>       workers;
+    std::vector<std::future<bool>> results;
+    size_t                         workerCount=GetWorkerCount(threadCount,
+                                                              tasks.size());
+
+    if (workerCount==1) {
+      bool success=true;
+
+      for (const auto& function : tasks) {
+        success=function() && success;
+      }
+
+      return success;
+    }
+
+    for (size_t i=0; i<workerCount; i++) {
+      workers.push_back(std::thread([&queue]() {
+        std::packaged_task<bool()> task;
+
+        while (queue.PopTask(task)) {
+          task();
+        }
+      }));
+    }
+
+    for (const auto& function : tasks) {
+      std::packaged_task<bool()> task(function);
+
+      results.push_back(task.get_future());
+      queue.PushTask(task);
+    }
+
+    queue.Stop();
+
+    for (auto& worker : workers) {
+      worker.join();
+    }
+
+    bool success=true;
+
+    for (auto& result : results) {
+      success=result.get() && success;
+    }
+
+    return success;
+  }
+
+  /**
+   * Return the closest routable node for the given via point (see
+   * GetClosestRoutableNode()), using the cache of recently snapped points.
+   *
+   * Method is thread-safe.
+   */
+  bool RoutingService::GetSnappedPoint(const GeoCoord& coord,
+                                       Vehicle vehicle,
+                                       double radius,
+                                       RoutePosition& position)
+  {
+    uint64_t     key=14695981039346656037ULL;
+    SnappedPoint point;
+
+    key=HashValue(key,coord.GetLat());
+    key=HashValue(key,coord.GetLon());
+    key=HashValue(key,(uint64_t)vehicle);
+    key=HashValue(key,radius);
+
+    if (snappedPointCache.GetEntry(key,
+                                   point) &&
+        point.coord==coord &&
+        point.vehicle==vehicle &&
+        point.radius==radius) {
+      position=point.position;
+
+      return true;
+    }
+
+    if (!GetClosestRoutableNode(coord.GetLat(),
+                                coord.GetLon(),
+                                vehicle,
+                                radius,
+                                position.object,
+                                position.nodeIndex)) {
+      return false;
+    }
+
+    point.coord=coord;
+    point.vehicle=vehicle;
+    point.radius=radius;
+    point.position=position;
+
+    snappedPointCache.SetEntry(key,
+                               point);
+
+    return true;
+  }
+
+  /**
+   * Calculate the route from start to target, using the cache of recently
+   * calculated route legs.
+   *
+   * Method is thread-safe.
+   */
+  bool RoutingService::CalculateRouteLeg(const RoutingProfile& profile,
+                                         const std::vector<double>& variantCosts,
+                                         uint64_t profileHash,
+                                         const RoutePosition& start,
+                                         const RoutePosition& target,
+                                         RouteData& route)
+  {
+    uint64_t    key=profileHash;
+    RouteLegRef leg;
+
+    key=HashValue(key,start);
+    key=HashValue(key,target);
+
+    if (routeLegCache.GetEntry(key,
+                               leg) &&
+        IsSamePosition(leg->start,start) &&
+        IsSamePosition(leg->target,target) &&
+        leg->vehicle==profile.GetVehicle() &&
+        leg->variantCosts==variantCosts) {
+      route=leg->route;
+
+      return true;
+    }
+
+    if (!CalculateRoute(profile,
+                        start.object,
+                        start.nodeIndex,
+                        target.object,
+                        target.nodeIndex,
+                        route)) {
+      return false;
+    }
+
+    leg=std::make_shared<RouteLeg>();
+
+    leg->start=start;
+    leg->target=target;
+    leg->vehicle=profile.GetVehicle();
+    leg->variantCosts=variantCosts;
+    leg->route=route;
+
+    routeLegCache.SetEntry(key,
+                           leg);
+
+    return true;
+  }
+
+  /**
+   * Calculate a route via the given list of coordinates.
+   *
+   * The coordinates are snapped to the closest routable nodes and the routes
+   * between consecutive via points (legs) are calculated in parallel (see
+   * RouterParameter::SetThreadCount()). Snapped via points and calculated
+   * legs are cached (see RouterParameter::SetSnappedPointCacheSize() and
+   * RouterParameter::SetRouteLegCacheSize()), so recalculating a route after
+   * moving one via point only calculates the two legs touching it.
+   *
+   * @param profile
+   *    Profile to use
+   * @param vehicle
+   *    Vehicle to find the closest routable nodes for
+   * @param radius
+   *    Maximum distance of the via points to the closest routable node
+   * @param via
+   *    List of coordinates to route through, including start and target
+   * @param route
+   *    The route object holding the resulting route on success
+   * @return
+   *    True, if the engine was able to find a route, else false
+   */
+  bool RoutingService::CalculateRoute(const RoutingProfile& profile,
+                                      Vehicle vehicle,
+                                      double radius,
+                                      std::vector<osmscout::GeoCoord> via,
+                                      RouteData& route)
+  {
+    std::vector<RoutePosition>         positions(via.size());
+    std::vector<std::function<bool()>> snapTasks;
+
+    for (size_t index=0; index<via.size(); index++) {
+      snapTasks.push_back([this,&via,&positions,vehicle,radius,index]() {
+        return GetSnappedPoint(via[index],
+                               vehicle,
+                               radius,
+                               positions[index]);
+      });
+    }
+
+    if (!RunTasks(snapTasks,
+                  threadCount)) {
+      return false;
+    }
+
+    if (positions.size()<2) {
+      return true;
+    }
+
+    std::vector<double> variantCosts;
+    uint64_t            profileHash=14695981039346656037ULL;
+
+    RouteContractionHierarchy::GetVariantCosts(profile,
+                                               objectVariantDataFile.GetData(),
+                                               variantCosts);
+
+    profileHash=HashValue(profileHash,(uint64_t)profile.GetVehicle());
+
+    for (const auto cost : variantCosts) {
+      profileHash=HashValue(profileHash,cost);
+    }
+
+    std::vector<RouteData>             legs(positions.size()-1);
+    std::vector<std::function<bool()>> legTasks;
+
+    for (size_t index=0; index<legs.size(); index++) {
+      legTasks.push_back([this,&profile,&variantCosts,profileHash,&positions,&legs,index]() {
+        return CalculateRouteLeg(profile,
+                                 variantCosts,
+                                 profileHash,
+                                 positions[index],
+                                 positions[index+1],
+                                 legs[index]);
+      });
+    }
+
+    if (!RunTasks(legTasks,
+                  threadCount)) {
+      return false;
+    }
+
+    for (size_t index=0; index<legs.size(); index++) {
+      RouteData& routePart=legs[index];
+
+      if (routePart.IsEmpty()) {
+        return false;
+      }
+
+      /* In intermediary via points the end of the previous part is the start of the */
+      /* next part, we need to remove the duplicate point in the calculated route */
+      if (index<legs.size()-1) {
+        routePart.PopEntry();
+      }
+
+      route.Append(routePart);
+    }
+
+    return true;
+  }
+
+  /**
+   * Calculate a route
+   *
+   * @param profile
+   *    Profile to use
+   * @param startObject
+   *    Start object
+   * @param startNodeIndex
+   *    Index of the node within the start object used as starting point
+   * @param targetObject
+   *    Target object
+   * @param targetNodeIndex
+   *    Index of the node within the target object used as target point
+   * @param route
+   *    The route object holding the resulting route on success
+   * @return
+   *    True, if the engine was able to find a route, else false
+   */
+  bool RoutingService::CalculateRoute(const RoutingProfile& profile,
+                                      const ObjectFileRef& startObject,
+                                      size_t startNodeIndex,
+                                      const ObjectFileRef& targetObject,
+                                      size_t targetNodeIndex,
+                                      RouteData& route)
+  {
+    std::unique_ptr<Arena<RNode>> rnodeArena=AcquireRNodeArena();
+    bool                          result=CalculateRoute(profile,
+                                                        *rnodeArena,
+                                                        startObject,
+                                                        startNodeIndex,
+                                                        targetObject,
+                                                        targetNodeIndex,
+                                                        route);
+
+    ReleaseRNodeArena(rnodeArena);
+
+    return result;
+  }
+
+  /**
+   * Take an arena for the RNodes of a route calculation from the pool or
+   * create a new one, if all arenas are in use by other route calculations.
+   *
+   * Method is thread-safe.
+   */
+  std::unique_ptr<Arena<RoutingService::RNode>> RoutingService::AcquireRNodeArena()
+  {
+    std::lock_guard<std::mutex> lock(rnodeArenaMutex);
+
+    if (rnodeArenas.empty()) {
+      return std::unique_ptr<Arena<RNode>>(new Arena<RNode>());
+    }
+
+    std::unique_ptr<Arena<RNode>> arena=std::move(rnodeArenas.back());
+
+    rnodeArenas.pop_back();
+
+    return arena;
+  }
+
+  /**
+   * Return the arena to the pool. The memory of the arena is kept for the
+   * next route calculation.
+   *
+   * Method is thread-safe.
+   */
+  void RoutingService::ReleaseRNodeArena(std::unique_ptr<Arena<RNode>>& arena)
+  {
+    arena->Reset();
+
+    std::lock_guard<std::mutex> lock(rnodeArenaMutex);
+
+    rnodeArenas.push_back(std::move(arena));
+  }
+
+  bool RoutingService::CalculateRoute(const RoutingProfile& profile,
+                                      Arena<RNode>& rnodeArena,
+                                      const ObjectFileRef& startObject,
+                                      size_t startNodeIndex,
+                                      const ObjectFileRef& targetObject,
+                                      size_t targetNodeIndex,
+                                      RouteData& route)
+  {
+    Vehicle                  vehicle=profile.GetVehicle();
+    RouteNodeRef             startForwardRouteNode;
+    RouteNodeRef             startBackwardRouteNode;
+    RNodeRef                 startForwardNode=nullptr;
+    RNodeRef                 startBackwardNode=nullptr;
+
+    double                   targetLon=0.0L;
+    double                   targetLat=0.0L;
+
+    RouteNodeRef             targetForwardRouteNode;
+    RouteNodeRef             targetBackwardRouteNode;
+
+    OpenList                 openList;
+    OpenMap                  openMap;
+    ClosedSet                closedSet;
+
+    size_t                   nodesExpandedCount=0;
+    size_t                   nodesLoadedCount=0;
+    size_t                   nodesIgnoredCount=0;
+    size_t                   maxOpenList=0;
+    size_t                   maxClosedSet=0;
+
+    route.Clear();
+
+    openList.Reserve(10000);
+    openMap.Reserve(10000);
+    closedSet.Reserve(10000);
+
+    if (!GetTargetNodes(profile,
+                        targetObject,
+                        targetNodeIndex,
+                        targetLon,
+                        targetLat,
+                        targetForwardRouteNode,
+                        targetBackwardRouteNode)) {
+      return false;
+    }
+
+    if (!GetStartNodes(profile,
+                       rnodeArena,
+                       startObject,
+                       startNodeIndex,
+                       targetLon,
+                       targetLat,
+                       startForwardRouteNode,
+                       startBackwardRouteNode,
+                       startForwardNode,
+                       startBackwardNode)) {
+      return false;
+    }
+
+    RouteContractionHierarchyRef hierarchy;
+    double                       costFactor;
+
+    if (GetContractionHierarchy(profile,
+                                hierarchy,
+                                costFactor)) {
+      return CalculateRouteUsingContractionHierarchy(profile,
+                                                     *hierarchy,
+                                                     costFactor,
+                                                     startObject,
+                                                     startNodeIndex,
+                                                     startForwardNode,
+                                                     startBackwardNode,
+                                                     targetObject,
+                                                     targetNodeIndex,
+                                                     targetForwardRouteNode,
+                                                     targetBackwardRouteNode,
+                                                     targetLon,
+                                                     targetLat,
+                                                     route);
+    }
+
+    std::vector<double> variantCosts;
+
+    if (compactRouteGraph &&
+        compactRouteGraph->GetVariantCosts(profile,
+                                           objectVariantDataFile.GetData(),
+                                           variantCosts)) {
+      return CalculateRouteUsingCompactRouteGraph(profile,
+                                                  variantCosts,
+                                                  startObject,
+                                                  startNodeIndex,
+                                                  startForwardNode,
+                                                  startBackwardNode,
+                                                  targetObject,
+                                                  targetNodeIndex,
+                                                  targetForwardRouteNode,
+                                                  targetBackwardRouteNode,
+                                                  targetLon,
+                                                  targetLat,
+                                                  route);
+    }
+
+    if (startForwardNode) {
+      openList.Push(startForwardNode);
+      openMap[startForwardNode->nodeOffset]=startForwardNode;
+    }
+
+    if (startBackwardNode) {
+      openList.Push(startBackwardNode);
+      openMap[startBackwardNode->nodeOffset]=startBackwardNode;
+    }
+
+    StopClock    clock;
+    RNodeRef     current=nullptr;
+    RouteNodeRef currentRouteNode;
+
+    do {
+      //
+      // Take entry from open list with lowest cost
+      //
+
+      current=openList.Pop();
+
+      openMap.Erase(current->nodeOffset);
+
+      currentRouteNode=current->node;
+
+      nodesExpandedCount++;
+
+      bool accessViolation=false;
+
+      // Get potential follower in the current way
+
+#if defined(DEBUG_ROUTING)
+      std::cout << "Analysing follower of node " << currentRouteNode->GetFileOffset();
+      std::cout << " (" << current->object.GetTypeName() << " " << current->object.GetFileOffset() << "["  << currentRouteNode->GetId() << "]" << ")";
+      std::cout << " " << current->currentCost << " " << current->estimateCost << " " << current->overallCost << std::endl;
+#endif
+      size_t i=0;
+      for (const auto& path : currentRouteNode->paths) {
+        if (path.offset==current->prev) {
+#if defined(DEBUG_ROUTING)
+          std::cout << "  Skipping route";
+          std::cout << " to " << path.offset;
+          std::cout << " (" << currentRouteNode->objects[path.objectIndex].object.GetTypeName() << " " << currentRouteNode->objects[path.objectIndex].object.GetFileOffset() << ")";
+          std::cout << " => back to the last node visited" << std::endl;
+#endif
+          nodesIgnoredCount++;
+          i++;
+          continue;
+        }
+
+        if (!current->access &&
             !path.IsRestricted(vehicle)) {
 #if defined(DEBUG_ROUTING)
           std::cout << "  Skipping route";
@@ -1167,243 +1995,1035 @@ namespace osmscout {
           nodesIgnoredCount++;
           i++;
 
-          accessViolation=true;
+          accessViolation=true;
+
+          continue;
+        }
+
+        if (!profile.CanUse(*currentRouteNode,objectVariantDataFile.GetData(),i)) {
+#if defined(DEBUG_ROUTING)
+          std::cout << "  Skipping route";
+          std::cout << " to " << path.offset;
+          std::cout << " (" << currentRouteNode->objects[path.objectIndex].object.GetTypeName() << " " << currentRouteNode->objects[path.objectIndex].object.GetFileOffset() << ")";
+          std::cout << " => Cannot be used"<< std::endl;
+#endif
+          nodesIgnoredCount++;
+          i++;
+          continue;
+        }
+
+        if (closedSet.Contains(path.offset)) {
+#if defined(DEBUG_ROUTING)
+          std::cout << "  Skipping route";
+          std::cout << " to " << path.offset;
+          std::cout << " (" << currentRouteNode->objects[path.objectIndex].object.GetTypeName() << " " << currentRouteNode->objects[path.objectIndex].object.GetFileOffset() << ")";
+          std::cout << " => already calculated" << std::endl;
+#endif
+          i++;
+          continue;
+        }
+
+        if (!currentRouteNode->excludes.empty()) {
+          bool canTurnedInto=true;
+
+          for (const auto& exclude : currentRouteNode->excludes) {
+            if (exclude.source==current->object &&
+                currentRouteNode->objects[currentRouteNode->paths[exclude.targetIndex].objectIndex].object==currentRouteNode->objects[path.objectIndex].object) {
+#if defined(DEBUG_ROUTING)
+              std::cout << "  Skipping route";
+              std::cout << " to " << path.offset;
+              std::cout << " (" << currentRouteNode->objects[path.objectIndex].object.GetTypeName() << " " << currentRouteNode->objects[path.objectIndex].object.GetFileOffset() << ")";
+              std::cout << " => turn not allowed" << std::endl;
+#endif
+              canTurnedInto=false;
+              break;
+            }
+          }
+
+          if (!canTurnedInto) {
+            nodesIgnoredCount++;
+            i++;
+            continue;
+          }
+        }
+
+        double currentCost=current->currentCost+
+                           profile.GetCosts(*currentRouteNode,objectVariantDataFile.GetData(),i);
+
+        RNode** openEntry=openMap.Find(path.offset);
+
+        // Check, if we already have a cheaper path to the new node. If yes, do not put the new path
+        // into the open list
+        if (openEntry!=nullptr &&
+            (*openEntry)->currentCost<=currentCost) {
+#if defined(DEBUG_ROUTING)
+          std::cout << "  Skipping route";
+          std::cout << " to " << path.offset;
+          std::cout << " (" << currentRouteNode->objects[path.objectIndex].object.GetTypeName() << " " << currentRouteNode->objects[path.objectIndex].object.GetFileOffset() << ")";
+          std::cout << "  => cheaper route exists " << currentCost << "<=>" << (*openEntry)->currentCost << std::endl;
+#endif
+          i++;
+          continue;
+        }
+
+        RouteNodeRef nextNode;
+
+        if (openEntry!=nullptr) {
+          nextNode=(*openEntry)->node;
+        }
+        else {
+          if (!routeNodeDataFile.GetByOffset(path.offset,
+                                             nextNode)) {
+            log.Error() << "Cannot load route node with id " << path.offset;
+            return false;
+          }
+
+          nodesLoadedCount++;
+        }
+
+        double distanceToTarget=GetSphericalDistance(nextNode->GetCoord().GetLon(),
+                                                     nextNode->GetCoord().GetLat(),
+                                                     targetLon,
+                                                     targetLat);
+        // Estimate costs for the rest of the distance to the target
+        double estimateCost=profile.GetCosts(distanceToTarget);
+        double overallCost=currentCost+estimateCost;
+
+        // If we already have the node in the open list, but the new path is cheaper,
+        // update the existing entry
+        if (openEntry!=nullptr) {
+          RNodeRef node=*openEntry;
+
+          node->prev=current->nodeOffset;
+          node->object=currentRouteNode->objects[path.objectIndex].object;
+
+          node->currentCost=currentCost;
+          node->estimateCost=estimateCost;
+          node->overallCost=overallCost;
+          node->access=!currentRouteNode->paths[i].IsRestricted(vehicle);
+
+#if defined(DEBUG_ROUTING)
+          std::cout << "  Updating route " << current->nodeOffset << " via " << node->object.GetTypeName() << " " << node->object.GetFileOffset() << " " << currentCost << " " << estimateCost << " " << overallCost << " " << currentRouteNode->GetId() << std::endl;
+#endif
+
+          // The estimate for the node is unchanged, so lower current costs
+          // always result in lower overall costs
+          openList.DecreaseKey(node);
+        }
+        else {
+          RNodeRef node=rnodeArena.Allocate(path.offset,
+                                            nextNode,
+                                            currentRouteNode->objects[path.objectIndex].object,
+                                            current->nodeOffset);
+
+          node->currentCost=currentCost;
+          node->estimateCost=estimateCost;
+          node->overallCost=overallCost;
+          node->access=!path.IsRestricted(vehicle);
+
+#if defined(DEBUG_ROUTING)
+          std::cout << "  Inserting route to " << path.offset;
+          std::cout <<  " (" << node->object.GetTypeName() << " " << node->object.GetFileOffset() << ")";
+          std::cout << " " << currentCost << " " << estimateCost << " " << overallCost << " " << currentRouteNode->GetId() << std::endl;
+#endif
+
+          openList.Push(node);
+          openMap[node->nodeOffset]=node;
+        }
+
+        i++;
+      }
+
+      //
+      // Added current node to close map
+      //
+
+      if (!accessViolation) {
+        closedSet.Insert(current->nodeOffset,
+                         VNode(current->nodeOffset,
+                               current->object,
+                               current->prev));
+      }
+
+      current->node=NULL;
+
+      maxOpenList=std::max(maxOpenList,openMap.Size());
+      maxClosedSet=std::max(maxClosedSet,closedSet.Size());
+
+#if defined(DEBUG_ROUTING)
+      if (openList.Empty()) {
+        std::cout << "No more alternatives, stopping" << std::endl;
+      }
+
+      if ((targetForwardRouteNode && current->nodeOffset==targetForwardRouteNode->GetFileOffset())) {
+        std::cout << "Reached target: " << current->nodeOffset << " == " << targetForwardRouteNode->GetFileOffset() << " (forward)" << std::endl;
+      }
+
+      if (targetBackwardRouteNode && current->nodeOffset==targetBackwardRouteNode->GetFileOffset()) {
+        std::cout << "Reached target: " << current->nodeOffset << " == " << targetBackwardRouteNode->GetFileOffset() << " (backward)" << std::endl;
+      }
+#endif
+    } while (!openList.Empty() &&
+             (!targetForwardRouteNode || current->nodeOffset!=targetForwardRouteNode->GetFileOffset()) &&
+             (!targetBackwardRouteNode || current->nodeOffset!=targetBackwardRouteNode->GetFileOffset()));
+
+    // If we have keep the last node open because of access violations, add it
+    // afte rrouting is done
+    closedSet.Insert(current->nodeOffset,
+                     VNode(current->nodeOffset,
+                           current->object,
+                           current->prev));
+
+    clock.Stop();
+
+    if (debugPerformance) {
+      std::cout << "From:                " << startObject.GetTypeName() << " " << startObject.GetFileOffset();
+      std::cout << "[";
+      if (startBackwardRouteNode) {
+        std::cout << startBackwardRouteNode->GetId() << " >* ";
+      }
+      std::cout << startNodeIndex;
+      if (startForwardRouteNode) {
+        std::cout << " *> " << startForwardRouteNode->GetId();
+      }
+      std::cout << "]" << std::endl;
+
+      std::cout << "To:                  " << targetObject.GetTypeName() <<  " " << targetObject.GetFileOffset();
+      std::cout << "[";
+      if (targetForwardRouteNode) {
+        std::cout << targetForwardRouteNode->GetId() << " >* ";
+      }
+      std::cout << targetNodeIndex;
+      if (targetBackwardRouteNode) {
+        std::cout << " *> " << targetBackwardRouteNode->GetId();
+      }
+      std::cout << "]" << std::endl;
+
+      std::cout << "Time:                " << clock << std::endl;
+
+      std::cout << "Expanded nodes:      " << nodesExpandedCount << std::endl;
+      std::cout << "Route nodes loaded:  " << nodesLoadedCount << std::endl;
+      std::cout << "Route nodes ignored: " << nodesIgnoredCount << std::endl;
+      std::cout << "Max. OpenList size:  " << maxOpenList << std::endl;
+      std::cout << "Max. ClosedSet size: " << maxClosedSet << std::endl;
+      std::cout << "Peak memory:         " << ByteSizeToString((double)(rnodeArena.GetMemoryUsage()+
+                                                                      openList.GetMemoryUsage()+
+                                                                      openMap.GetMemoryUsage()+
+                                                                      closedSet.GetMemoryUsage())) << std::endl;
+    }
+
+    if (!((targetForwardRouteNode && currentRouteNode->GetId()==targetForwardRouteNode->GetId()) ||
+          (targetBackwardRouteNode && currentRouteNode->GetId()==targetBackwardRouteNode->GetId()))) {
+      std::cout << "No route found!" << std::endl;
+      route.Clear();
+
+      return true;
+    }
+
+    std::list<VNode> nodes;
+
+    ResolveRNodeChainToList(current->nodeOffset,
+                            closedSet,
+                            nodes);
+
+    if (!ResolveRNodesToRouteData(profile,
+                                  nodes,
+                                  startObject,
+                                  startNodeIndex,
+                                  targetObject,
+                                  targetNodeIndex,
+                                  route)) {
+      //std::cerr << "Cannot convert routing result to route data" << std::endl;
+      return false;
+    }
+
+    ResolveRouteDataJunctions(route);
 
-          continue;
-        }
+    return true;
+  }
 
-        if (!profile.CanUse(*currentRouteNode,objectVariantDataFile.GetData(),i)) {
-#if defined(DEBUG_ROUTING)
-          std::cout << "  Skipping route";
-          std::cout << " to " << path.offset;
-          std::cout << " (" << currentRouteNode->objects[path.objectIndex].object.GetTypeName() << " " << currentRouteNode->objects[path.objectIndex].object.GetFileOffset() << ")";
-          std::cout << " => Cannot be used"<< std::endl;
-#endif
-          nodesIgnoredCount++;
-          i++;
-          continue;
+  /**
+   * Collect the route nodes through which the given position can be left
+   * (if isSource is true) or reached (if isSource is false), together with the
+   * costs, time and distance between the position and the route node.
+   *
+   * Positions without a usable route node do not result in any terminal.
+   * Like for CalculateRoute() only positions on ways are supported, positions
+   * on areas result in an error.
+   */
+  bool RoutingService::GetMatrixTerminals(const RoutingProfile& profile,
+                                          const RoutePosition& position,
+                                          size_t index,
+                                          bool isSource,
+                                          std::vector<MatrixTerminal>& terminals)
+  {
+    WayDataFileRef wayDataFile(database->GetWayDataFile());
+
+    if (!wayDataFile) {
+      return false;
+    }
+
+    if (position.object.GetType()!=refWay) {
+      log.Error() << "Cannot use " << position.object.GetName() << " as matrix " << (isSource ? "source" : "target") << ", only ways are supported";
+      return false;
+    }
+
+    WayRef way;
+
+    if (!wayDataFile->GetByOffset(position.object.GetFileOffset(),
+                                  way)) {
+      log.Error() << "Cannot get way " << position.object.GetFileOffset() << "!";
+      return false;
+    }
+
+    if (position.nodeIndex>=way->nodes.size()) {
+      log.Error() << "Given node index " << position.nodeIndex << " is not within valid range [0," << way->nodes.size()-1;
+      return false;
+    }
+
+    RouteNodeRef routeNodes[2];
+    size_t       routeNodeIndex;
+
+    // Check, if the current node is already the route node
+    routeNodeDataFile.Get(way->GetId(position.nodeIndex),
+                          routeNodes[0]);
+
+    if (!routeNodes[0]) {
+      if (isSource) {
+        GetStartForwardRouteNode(profile,
+                                 way,
+                                 position.nodeIndex,
+                                 routeNodes[0],
+                                 routeNodeIndex);
+        GetStartBackwardRouteNode(profile,
+                                  way,
+                                  position.nodeIndex,
+                                  routeNodes[1],
+                                  routeNodeIndex);
+      }
+      else {
+        GetTargetForwardRouteNode(profile,
+                                  way,
+                                  position.nodeIndex,
+                                  routeNodes[0]);
+        GetTargetBackwardRouteNode(profile,
+                                   way,
+                                   position.nodeIndex,
+                                   routeNodes[1]);
+      }
+    }
+
+    for (const auto& routeNode : routeNodes) {
+      if (!routeNode) {
+        continue;
+      }
+
+      MatrixTerminal terminal;
+
+      terminal.index=index;
+      terminal.routeNodeOffset=routeNode->GetFileOffset();
+      terminal.object=position.object;
+      terminal.distance=GetSphericalDistance(way->nodes[position.nodeIndex].GetCoord(),
+                                             routeNode->GetCoord());
+      terminal.cost=profile.GetCosts(*way,
+                                     terminal.distance);
+      terminal.time=profile.GetTime(*way,
+                                    terminal.distance);
+
+      terminals.push_back(terminal);
+    }
+
+    return true;
+  }
+
+  bool RoutingService::GetMatrixRouteNode(FileOffset offset,
+                                          MatrixRouteNodeCache& routeNodeCache,
+                                          RouteNodeRef& routeNode,
+                                          size_t& loadedCount)
+  {
+    if (routeNodeCache.GetEntry(offset,
+                                routeNode)) {
+      return true;
+    }
+
+    if (!routeNodeDataFile.GetByOffset(offset,
+                                       routeNode)) {
+      log.Error() << "Cannot load route node with offset " << offset;
+      return false;
+    }
+
+    loadedCount++;
+
+    routeNodeCache.SetEntry(offset,
+                            routeNode);
+
+    return true;
+  }
+
+  void RoutingService::AddMatrixStart(MatrixSearch& search,
+                                      const MatrixTerminal& terminal) const
+  {
+    MatrixNode*  node;
+    MatrixNode** entry=search.nodeMap.Find(terminal.routeNodeOffset);
+
+    if (entry!=nullptr) {
+      node=*entry;
+
+      if (node->cost<=terminal.cost) {
+        return;
+      }
+    }
+    else {
+      node=search.nodes.Allocate(terminal.routeNodeOffset);
+      search.nodeMap[terminal.routeNodeOffset]=node;
+    }
+
+    node->object=terminal.object;
+    node->cost=terminal.cost;
+    node->time=terminal.time;
+    node->distance=terminal.distance;
+
+    if (search.openList.Contains(node)) {
+      search.openList.DecreaseKey(node);
+    }
+    else {
+      search.openList.Push(node);
+    }
+  }
+
+  /**
+   * Relax all paths leaving the given route node, which has just been taken
+   * from the open list, and mark the node as settled.
+   *
+   * The search follows the same rules (no direct u-turns, access restrictions
+   * and turn restrictions) as the A* algorithm in CalculateRoute(). Like there
+   * nodes left because of an access violation stay open and can be reached
+   * again. Paths leading to a distance from the source greater than
+   * maxDistance are ignored.
+   */
+  void RoutingService::ExpandMatrixNode(const RoutingProfile& profile,
+                                        MatrixSearch& search,
+                                        MatrixNode* current,
+                                        const RouteNode& routeNode,
+                                        double maxDistance) const
+  {
+    Vehicle                               vehicle=profile.GetVehicle();
+    const std::vector<ObjectVariantData>& objectVariantData=objectVariantDataFile.GetData();
+    bool                                  accessViolation=false;
+
+    for (size_t i=0; i<routeNode.paths.size(); i++) {
+      const RouteNode::Path& path=routeNode.paths[i];
+
+      if (path.offset==current->prev) {
+        continue;
+      }
+
+      if (!current->access &&
+          !path.IsRestricted(vehicle)) {
+        accessViolation=true;
+        continue;
+      }
+
+      if (!profile.CanUse(routeNode,objectVariantData,i)) {
+        continue;
+      }
+
+      if (current->distance+path.distance>maxDistance) {
+        continue;
+      }
+
+      MatrixNode** entry=search.nodeMap.Find(path.offset);
+
+      if (entry!=nullptr &&
+          (*entry)->settled) {
+        continue;
+      }
+
+      bool canTurnedInto=true;
+
+      for (const auto& exclude : routeNode.excludes) {
+        if (exclude.source==current->object &&
+            routeNode.objects[routeNode.paths[exclude.targetIndex].objectIndex].object==routeNode.objects[path.objectIndex].object) {
+          canTurnedInto=false;
+          break;
         }
+      }
 
-        if (closedSet.find(VNode(path.offset))!=closedSet.end()) {
-#if defined(DEBUG_ROUTING)
-          std::cout << "  Skipping route";
-          std::cout << " to " << path.offset;
-          std::cout << " (" << currentRouteNode->objects[path.objectIndex].object.GetTypeName() << " " << currentRouteNode->objects[path.objectIndex].object.GetFileOffset() << ")";
-          std::cout << " => already calculated" << std::endl;
-#endif
-          i++;
+      if (!canTurnedInto) {
+        continue;
+      }
+
+      double      cost=current->cost+profile.GetCosts(routeNode,objectVariantData,i);
+      MatrixNode* next;
+
+      if (entry!=nullptr) {
+        next=*entry;
+
+        if (search.openList.Contains(next) &&
+            next->cost<=cost) {
           continue;
         }
+      }
+      else {
+        next=search.nodes.Allocate(path.offset);
+        search.nodeMap[path.offset]=next;
+      }
 
-        if (!currentRouteNode->excludes.empty()) {
-          bool canTurnedInto=true;
+      next->prev=current->nodeOffset;
+      next->object=routeNode.objects[path.objectIndex].object;
+      next->cost=cost;
+      next->time=current->time+profile.GetTime(routeNode,objectVariantData,i);
+      next->distance=current->distance+path.distance;
+      next->access=!path.IsRestricted(vehicle);
 
-          for (const auto& exclude : currentRouteNode->excludes) {
-            if (exclude.source==current->object &&
-                currentRouteNode->objects[exclude.targetIndex].object==currentRouteNode->objects[path.objectIndex].object) {
-#if defined(DEBUG_ROUTING)
-              std::cout << "  Skipping route";
-              std::cout << " to " << path.offset;
-              std::cout << " (" << currentRouteNode->objects[path.objectIndex].object.GetTypeName() << " " << currentRouteNode->objects[path.objectIndex].object.GetFileOffset() << ")";
-              std::cout << " => turn not allowed" << std::endl;
-#endif
-              canTurnedInto=false;
-              break;
-            }
+      if (search.openList.Contains(next)) {
+        search.openList.DecreaseKey(next);
+      }
+      else {
+        search.openList.Push(next);
+      }
+    }
+
+    if (!accessViolation) {
+      current->settled=true;
+    }
+  }
+
+  /**
+   * Calculate one row of the matrix using a one-to-many Dijkstra search from
+   * the route nodes of the source to the route nodes of all targets.
+   *
+   * The search stops, as soon as the route nodes of all targets have been
+   * visited or no route node within maxDistance is left.
+   */
+  bool RoutingService::CalculateMatrixRow(const RoutingProfile& profile,
+                                          const std::vector<MatrixTerminal>& sourceTerminals,
+                                          const MatrixTargetMap& targetTerminals,
+                                          MatrixRouteNodeCache& routeNodeCache,
+                                          double maxDistance,
+                                          RouteMatrix& matrix,
+                                          size_t& settledCount,
+                                          size_t& loadedCount)
+  {
+    MatrixSearch                 search;
+    OpenHashMap<FileOffset,bool> visitedTargets;
+    size_t                       sourceIndex=sourceTerminals.front().index;
+
+    for (const auto& terminal : sourceTerminals) {
+      if (terminal.distance<=maxDistance) {
+        AddMatrixStart(search,
+                       terminal);
+      }
+    }
+
+    while (!search.openList.Empty() &&
+           visitedTargets.Size()<targetTerminals.size()) {
+      MatrixNode*  current=search.openList.Pop();
+      RouteNodeRef routeNode;
+
+      if (!GetMatrixRouteNode(current->nodeOffset,
+                              routeNodeCache,
+                              routeNode,
+                              loadedCount)) {
+        return false;
+      }
+
+      ExpandMatrixNode(profile,
+                       search,
+                       current,
+                       *routeNode,
+                       maxDistance);
+
+      settledCount++;
+
+      MatrixTargetMap::const_iterator targetEntry=targetTerminals.find(current->nodeOffset);
+
+      if (targetEntry!=targetTerminals.end() &&
+          visitedTargets.Insert(current->nodeOffset,true)) {
+        for (const auto& terminal : targetEntry->second) {
+          double cost=current->cost+terminal.cost;
+
+          if (current->distance+terminal.distance>maxDistance) {
+            continue;
+          }
+
+          if (cost<matrix.GetCost(sourceIndex,terminal.index)) {
+            matrix.Set(sourceIndex,
+                       terminal.index,
+                       cost,
+                       current->time+terminal.time,
+                       current->distance+terminal.distance);
           }
+        }
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Calculate the costs, travel time and distance from every source to every
+   * target without resolving the actual routes.
+   *
+   * For each source a one-to-many Dijkstra search is run. The searches
+   * run in parallel (see RouterParameter::SetThreadCount()) and share
+   * route nodes already loaded by other searches (see
+   * RouterParameter::SetRouteNodeCacheSize()).
+   *
+   * Contraction hierarchies are not used. Method is thread-safe. Sources
+   * and targets must be positions on ways, areas are not supported.
+   *
+   * @param profile
+   *    Profile to use
+   * @param sources
+   *    Positions to start from
+   * @param targets
+   *    Positions to reach
+   * @param matrix
+   *    Matrix with one row for each source and one column for each target.
+   *    Targets not reachable from a source are marked as unreachable.
+   * @return
+   *    False, if there was an error (for example while loading data), else true
+   */
+  bool RoutingService::CalculateMatrix(const RoutingProfile& profile,
+                                       const std::vector<RoutePosition>& sources,
+                                       const std::vector<RoutePosition>& targets,
+                                       RouteMatrix& matrix)
+  {
+    return CalculateMatrix(profile,
+                           sources,
+                           targets,
+                           std::numeric_limits<double>::max(),
+                           matrix);
+  }
+
+  /**
+   * Calculate the costs, travel time and distance from every source to every
+   * target like CalculateMatrix() above, but only consider routes with a
+   * distance not greater than maxDistance.
+   *
+   * The searches stop as soon as all route nodes within maxDistance have
+   * been visited, so short distance queries in a large graph (like the
+   * transitions between consecutive points of a GPS trace) only visit a
+   * small part of the graph.
+   *
+   * @param profile
+   *    Profile to use
+   * @param sources
+   *    Positions to start from
+   * @param targets
+   *    Positions to reach
+   * @param maxDistance
+   *    Maximum distance of a route in km
+   * @param matrix
+   *    Matrix with one row for each source and one column for each target.
+   *    Targets not reachable from a source within the given distance are
+   *    marked as unreachable.
+   * @return
+   *    False, if there was an error (for example while loading data), else true
+   */
+  bool RoutingService::CalculateMatrix(const RoutingProfile& profile,
+                                       const std::vector<RoutePosition>& sources,
+                                       const std::vector<RoutePosition>& targets,
+                                       double maxDistance,
+                                       RouteMatrix& matrix)
+  {
+    return CalculateMatrix(profile,
+                           sources,
+                           targets,
+                           maxDistance,
+                           threadCount,
+                           matrix);
+  }
+
+  /**
+   * Calculate the costs, travel time and distance from every source to every
+   * target like CalculateMatrix() above, but calculate the rows using the
+   * given number of threads instead of the number of threads of the
+   * RouterParameter.
+   *
+   * Callers that already run in parallel (like
+   * MapMatchingService::MatchTraces()) should pass 1, which calculates all
+   * rows in the calling thread instead of starting new threads for every
+   * matrix.
+   *
+   * @param profile
+   *    Profile to use
+   * @param sources
+   *    Positions to start from
+   * @param targets
+   *    Positions to reach
+   * @param maxDistance
+   *    Maximum distance of a route in km
+   * @param threadCount
+   *    Number of threads used to calculate the rows, 0 means one thread
+   *    per core
+   * @param matrix
+   *    Matrix with one row for each source and one column for each target.
+   *    Targets not reachable from a source within the given distance are
+   *    marked as unreachable.
+   * @return
+   *    False, if there was an error (for example while loading data), else true
+   */
+  bool RoutingService::CalculateMatrix(const RoutingProfile& profile,
+                                       const std::vector<RoutePosition>& sources,
+                                       const std::vector<RoutePosition>& targets,
+                                       double maxDistance,
+                                       size_t threadCount,
+                                       RouteMatrix& matrix)
+  {
+    std::vector<std::vector<MatrixTerminal>> sourceTerminals(sources.size());
+    MatrixTargetMap                          targetTerminals;
+    StopClock                                clock;
+
+    matrix.Initialize(sources.size(),
+                      targets.size());
+
+    for (size_t s=0; s<sources.size(); s++) {
+      if (!GetMatrixTerminals(profile,
+                              sources[s],
+                              s,
+                              true,
+                              sourceTerminals[s])) {
+        return false;
+      }
+    }
+
+    for (size_t t=0; t<targets.size(); t++) {
+      std::vector<MatrixTerminal> terminals;
+
+      if (!GetMatrixTerminals(profile,
+                              targets[t],
+                              t,
+                              false,
+                              terminals)) {
+        return false;
+      }
+
+      for (const auto& terminal : terminals) {
+        targetTerminals[terminal.routeNodeOffset].push_back(terminal);
+      }
+    }
+
+    std::vector<std::function<bool()>> tasks;
+    std::mutex                         statisticsMutex;
+    size_t                             settledCount=0;
+    size_t                             loadedCount=0;
+
+    for (size_t s=0; s<sources.size(); s++) {
+      if (sourceTerminals[s].empty() ||
+          targetTerminals.empty()) {
+        continue;
+      }
+
+      tasks.push_back([this,&profile,&sourceTerminals,&targetTerminals,maxDistance,&matrix,&statisticsMutex,&settledCount,&loadedCount,s]() {
+        size_t rowSettledCount=0;
+        size_t rowLoadedCount=0;
+        bool   result=CalculateMatrixRow(profile,
+                                         sourceTerminals[s],
+                                         targetTerminals,
+                                         routeNodeCache,
+                                         maxDistance,
+                                         matrix,
+                                         rowSettledCount,
+                                         rowLoadedCount);
+
+        std::lock_guard<std::mutex> lock(statisticsMutex);
+
+        settledCount+=rowSettledCount;
+        loadedCount+=rowLoadedCount;
+
+        return result;
+      });
+    }
+
+    bool success=RunTasks(tasks,
+                          threadCount);
+
+    // Source and target at the same position
+    for (size_t s=0; s<sources.size(); s++) {
+      for (size_t t=0; t<targets.size(); t++) {
+        if (sources[s].object==targets[t].object &&
+            sources[s].nodeIndex==targets[t].nodeIndex) {
+          matrix.Set(s,t,0.0,0.0,0.0);
+        }
+      }
+    }
+
+    clock.Stop();
+
+    if (debugPerformance) {
+      std::cout << "Matrix:              " << sources.size() << "x" << targets.size() << std::endl;
+      std::cout << "Threads:             " << GetWorkerCount(threadCount,tasks.size()) << std::endl;
+      std::cout << "Time:                " << clock << std::endl;
+      std::cout << "Route nodes settled: " << settledCount << std::endl;
+      std::cout << "Route nodes loaded:  " << loadedCount << std::endl;
+    }
+
+    return success;
+  }
+
+  /**
+   * Calculate all route nodes reachable from the given start position with
+   * costs not greater than maxCost using a bounded Dijkstra search.
+   *
+   * For every given cost threshold (thresholds greater than maxCost are
+   * ignored) the outline of the reachable area is calculated from the
+   * same search. The area consists of all paths (straight lines between
+   * route nodes) reachable within the threshold. Paths that can only be
+   * traveled partially end at the point (linear interpolation between both
+   * route nodes) at which the threshold is exceeded. The outline is the
+   * border of the grid cells touched by these paths (see
+   * RouterParameter::SetIsochroneCellSize()), so unreachable concave
+   * parts are left out while enclosed holes are filled.
+   *
+   * @param profile
+   *    Profile to use
+   * @param start
+   *    Position to start from
+   * @param maxCost
+   *    Maximum costs (as defined by the profile)
+   * @param thresholds
+   *    Cost thresholds to calculate area outlines for, may be empty
+   * @param isochrone
+   *    The reachable route nodes and the area outlines
+   * @return
+   *    False, if there was an error (for example while loading data), else true
+   */
+  bool RoutingService::CalculateIsochrone(const RoutingProfile& profile,
+                                          const RoutePosition& start,
+                                          double maxCost,
+                                          const std::vector<double>& thresholds,
+                                          RouteIsochrone& isochrone)
+  {
+    std::vector<MatrixTerminal>                            terminals;
+    MatrixSearch                                           search;
+    std::vector<std::pair<const MatrixNode*,RouteNodeRef>> visitedNodes;
+    OpenHashMap<FileOffset,bool>                           visitedMap;
+    StopClock                                              clock;
+
+    isochrone.Clear();
+
+    if (!GetMatrixTerminals(profile,
+                            start,
+                            0,
+                            true,
+                            terminals)) {
+      return false;
+    }
+
+    for (const auto& terminal : terminals) {
+      if (terminal.cost<=maxCost) {
+        AddMatrixStart(search,
+                       terminal);
+      }
+    }
+
+    while (!search.openList.Empty()) {
+      MatrixNode*  current=search.openList.Pop();
+      RouteNodeRef routeNode;
 
-          if (!canTurnedInto) {
-            nodesIgnoredCount++;
-            i++;
-            continue;
-          }
-        }
+      if (current->cost>maxCost) {
+        break;
+      }
 
-        double currentCost=current->currentCost+
-                           profile.GetCosts(*currentRouteNode,objectVariantDataFile.GetData(),i);
+      if (!routeNodeDataFile.GetByOffset(current->nodeOffset,
+                                         routeNode)) {
+        log.Error() << "Cannot load route node with offset " << current->nodeOffset;
+        return false;
+      }
 
-        OpenMap::iterator openEntry=openMap.find(path.offset);
+      ExpandMatrixNode(profile,
+                       search,
+                       current,
+                       *routeNode,
+                       std::numeric_limits<double>::max());
 
-        // Check, if we already have a cheaper path to the new node. If yes, do not put the new path
-        // into the open list
-        if (openEntry!=openMap.end() &&
-            (*openEntry->second)->currentCost<=currentCost) {
-#if defined(DEBUG_ROUTING)
-          std::cout << "  Skipping route";
-          std::cout << " to " << path.offset;
-          std::cout << " (" << currentRouteNode->objects[path.objectIndex].object.GetTypeName() << " " << currentRouteNode->objects[path.objectIndex].object.GetFileOffset() << ")";
-          std::cout << "  => cheaper route exists " << currentCost << "<=>" << (*openEntry->second)->currentCost << std::endl;
-#endif
-          i++;
-          continue;
-        }
+      // Nodes left because of an access violation might get visited twice,
+      // the first visit is the cheapest one
+      if (!visitedMap.Insert(current->nodeOffset,true)) {
+        continue;
+      }
 
-        RouteNodeRef nextNode;
+      RouteIsochrone::Node node;
 
-        if (openEntry!=openMap.end()) {
-          nextNode=(*openEntry->second)->node;
-        }
-        else {
-          if (!routeNodeDataFile.GetByOffset(path.offset,
-                                             nextNode)) {
-            log.Error() << "Cannot load route node with id " << path.offset;
-            return false;
-          }
-        }
+      node.routeNodeOffset=current->nodeOffset;
+      node.id=routeNode->GetId();
+      node.coord=routeNode->GetCoord();
+      node.cost=current->cost;
+      node.time=current->time;
+      node.distance=current->distance;
 
-        double distanceToTarget=GetSphericalDistance(nextNode->GetCoord().GetLon(),
-                                                     nextNode->GetCoord().GetLat(),
-                                                     targetLon,
-                                                     targetLat);
-        // Estimate costs for the rest of the distance to the target
-        double estimateCost=profile.GetCosts(distanceToTarget);
-        double overallCost=currentCost+estimateCost;
+      isochrone.AddNode(node);
+      visitedNodes.push_back(std::make_pair(current,routeNode));
+    }
 
-        // If we already have the node in the open list, but the new path is cheaper,
-        // update the existing entry
-        if (openEntry!=openMap.end()) {
-          RNodeRef node=*openEntry->second;
+    clock.Stop();
 
-          node->prev=current->nodeOffset;
-          node->object=currentRouteNode->objects[path.objectIndex].object;
+    if (debugPerformance) {
+      std::cout << "From:                " << start.object.GetTypeName() << " " << start.object.GetFileOffset();
+      std::cout << "[" << start.nodeIndex << "]" << std::endl;
+      std::cout << "Time:                " << clock << std::endl;
+      std::cout << "Route nodes reached: " << visitedNodes.size() << std::endl;
+    }
 
-          node->currentCost=currentCost;
-          node->estimateCost=estimateCost;
-          node->overallCost=overallCost;
-          node->access=!currentRouteNode->paths[i].IsRestricted(vehicle);
+    if (thresholds.empty() ||
+        terminals.empty()) {
+      return true;
+    }
 
-#if defined(DEBUG_ROUTING)
-          std::cout << "  Updating route " << current->nodeOffset << " via " << node->object.GetTypeName() << " " << node->object.GetFileOffset() << " " << currentCost << " " << estimateCost << " " << overallCost << " " << currentRouteNode->GetId() << std::endl;
-#endif
+    WayDataFileRef                    wayDataFile(database->GetWayDataFile());
+    WayRef                            startWay;
+    OpenHashMap<FileOffset,GeoCoord>  coords;
+    std::vector<double>               sortedThresholds(thresholds);
 
-          openList.erase(openEntry->second);
+    // GetMatrixTerminals() has already validated the start position
+    if (!wayDataFile->GetByOffset(start.object.GetFileOffset(),
+                                  startWay)) {
+      log.Error() << "Cannot get way " << start.object.GetFileOffset() << "!";
+      return false;
+    }
 
-          std::pair<OpenListRef,bool> result=openList.insert(node);
-          openEntry->second=result.first;
-        }
-        else {
-          RNodeRef node=std::make_shared<RNode>(path.offset,
-                                                nextNode,
-                                                currentRouteNode->objects[path.objectIndex].object,
-                                                current->nodeOffset);
+    GeoCoord startCoord=startWay->nodes[start.nodeIndex].GetCoord();
+    double   minLat=startCoord.GetLat();
+    double   maxLat=startCoord.GetLat();
+    double   minLon=startCoord.GetLon();
+    double   maxLon=startCoord.GetLon();
 
-          node->currentCost=currentCost;
-          node->estimateCost=estimateCost;
-          node->overallCost=overallCost;
-          node->access=!path.IsRestricted(vehicle);
+    for (const auto& entry : visitedNodes) {
+      GeoCoord coord=entry.second->GetCoord();
 
-#if defined(DEBUG_ROUTING)
-          std::cout << "  Inserting route to " << path.offset;
-          std::cout <<  " (" << node->object.GetTypeName() << " " << node->object.GetFileOffset() << ")";
-          std::cout << " " << currentCost << " " << estimateCost << " " << overallCost << " " << currentRouteNode->GetId() << std::endl;
-#endif
+      coords.Insert(entry.first->nodeOffset,
+                    coord);
 
-          std::pair<OpenListRef,bool> result=openList.insert(node);
-          openMap[node->nodeOffset]=result.first;
-        }
+      minLat=std::min(minLat,coord.GetLat());
+      maxLat=std::max(maxLat,coord.GetLat());
+      minLon=std::min(minLon,coord.GetLon());
+      maxLon=std::max(maxLon,coord.GetLon());
+    }
 
-        i++;
+    auto getCoord=[&](FileOffset offset,
+                      GeoCoord& coord) {
+      GeoCoord* knownCoord=coords.Find(offset);
+
+      if (knownCoord!=nullptr) {
+        coord=*knownCoord;
+        return true;
       }
 
-      //
-      // Added current node to close map
-      //
+      RouteNodeRef routeNode;
 
-      if (!accessViolation) {
-        closedSet.insert(VNode(current->nodeOffset,
-                                    current->object,
-                                    current->prev));
+      if (!routeNodeDataFile.GetByOffset(offset,
+                                         routeNode)) {
+        log.Error() << "Cannot load route node with offset " << offset;
+        return false;
       }
 
-      current->node=NULL;
+      coord=routeNode->GetCoord();
+      coords.Insert(offset,
+                    coord);
 
-      maxOpenList=std::max(maxOpenList,openMap.size());
-      maxClosedSet=std::max(maxClosedSet,closedSet.size());
+      return true;
+    };
 
-#if defined(DEBUG_ROUTING)
-      if (openList.empty()) {
-        std::cout << "No more alternatives, stopping" << std::endl;
-      }
+    // Convert the cell size from km to degrees at the start position
+    double cellSize=isochroneCellSize;
 
-      if ((targetForwardRouteNode && current->nodeOffset==targetForwardRouteNode->GetFileOffset())) {
-        std::cout << "Reached target: " << current->nodeOffset << " == " << targetForwardRouteNode->GetFileOffset() << " (forward)" << std::endl;
-      }
+    if (cellSize<=0.0) {
+      cellSize=std::max(GetSphericalDistance(GeoCoord(minLat,minLon),GeoCoord(minLat,maxLon)),
+                        GetSphericalDistance(GeoCoord(minLat,minLon),GeoCoord(maxLat,minLon)))/100.0;
 
-      if (targetBackwardRouteNode && current->nodeOffset==targetBackwardRouteNode->GetFileOffset()) {
-        std::cout << "Reached target: " << current->nodeOffset << " == " << targetBackwardRouteNode->GetFileOffset() << " (backward)" << std::endl;
+      if (cellSize<=0.0) {
+        // Only the start position is reachable
+        cellSize=0.01;
       }
-#endif
-    } while (!openList.empty() &&
-             (!targetForwardRouteNode || current->nodeOffset!=targetForwardRouteNode->GetFileOffset()) &&
-             (!targetBackwardRouteNode || current->nodeOffset!=targetBackwardRouteNode->GetFileOffset()));
-
-    // If we have keep the last node open because of access violations, add it
-    // afte rrouting is done
-    if (closedSet.find(VNode(current->nodeOffset))==closedSet.end()) {
-      closedSet.insert(VNode(current->nodeOffset,
-                             current->object,
-                             current->prev));
     }
 
-    clock.Stop();
+    double cellWidth=cellSize/GetSphericalDistance(startCoord,
+                                                   GeoCoord(startCoord.GetLat(),startCoord.GetLon()+1.0));
+    double cellHeight=cellSize/GetSphericalDistance(startCoord,
+                                                    GeoCoord(startCoord.GetLat()+1.0,startCoord.GetLon()));
 
-    if (debugPerformance) {
-      std::cout << "From:                " << startObject.GetTypeName() << " " << startObject.GetFileOffset();
-      std::cout << "[";
-      if (startBackwardRouteNode) {
-        std::cout << startBackwardRouteNode->GetId() << " >* ";
-      }
-      std::cout << startNodeIndex;
-      if (startForwardRouteNode) {
-        std::cout << " *> " << startForwardRouteNode->GetId();
-      }
-      std::cout << "]" << std::endl;
+    std::sort(sortedThresholds.begin(),
+              sortedThresholds.end());
 
-      std::cout << "To:                  " << targetObject.GetTypeName() <<  " " << targetObject.GetFileOffset();
-      std::cout << "[";
-      if (targetForwardRouteNode) {
-        std::cout << targetForwardRouteNode->GetId() << " >* ";
+    const std::vector<ObjectVariantData>& objectVariantData=objectVariantDataFile.GetData();
+
+    for (const auto threshold : sortedThresholds) {
+      if (threshold>maxCost) {
+        break;
       }
-      std::cout << targetNodeIndex;
-      if (targetBackwardRouteNode) {
-        std::cout << " *> " << targetBackwardRouteNode->GetId();
+
+      std::vector<std::pair<GeoCoord,GeoCoord>> segments;
+      RouteIsochrone::Area                      area;
+
+      // The way between the start position and the first route nodes
+      for (const auto& terminal : terminals) {
+        GeoCoord coord;
+
+        if (!getCoord(terminal.routeNodeOffset,
+                      coord)) {
+          return false;
+        }
+
+        if (terminal.cost>threshold) {
+          double fraction=threshold/terminal.cost;
+
+          coord=GeoCoord(startCoord.GetLat()+(coord.GetLat()-startCoord.GetLat())*fraction,
+                         startCoord.GetLon()+(coord.GetLon()-startCoord.GetLon())*fraction);
+        }
+
+        segments.push_back(std::make_pair(startCoord,
+                                          coord));
       }
-      std::cout << "]" << std::endl;
 
-      std::cout << "Time:                " << clock << std::endl;
+      for (const auto& entry : visitedNodes) {
+        const MatrixNode*   node=entry.first;
+        const RouteNodeRef& routeNode=entry.second;
 
-      std::cout << "Route nodes loaded:  " << nodesLoadedCount << std::endl;
-      std::cout << "Route nodes ignored: " << nodesIgnoredCount << std::endl;
-      std::cout << "Max. OpenList size:  " << maxOpenList << std::endl;
-      std::cout << "Max. ClosedSet size: " << maxClosedSet << std::endl;
-    }
+        if (node->cost>threshold) {
+          // Nodes are visited in the order of increasing costs
+          break;
+        }
 
-    if (!((targetForwardRouteNode && currentRouteNode->GetId()==targetForwardRouteNode->GetId()) ||
-          (targetBackwardRouteNode && currentRouteNode->GetId()==targetBackwardRouteNode->GetId()))) {
-      std::cout << "No route found!" << std::endl;
-      route.Clear();
+        GeoCoord from=routeNode->GetCoord();
 
-      return true;
-    }
+        for (size_t i=0; i<routeNode->paths.size(); i++) {
+          if (!profile.CanUse(*routeNode,objectVariantData,i)) {
+            continue;
+          }
 
-    std::list<VNode> nodes;
+          GeoCoord targetCoord;
 
-    ResolveRNodeChainToList(current->nodeOffset,
-                            closedSet,
-                            nodes);
+          if (!getCoord(routeNode->paths[i].offset,
+                        targetCoord)) {
+            return false;
+          }
 
-    if (!ResolveRNodesToRouteData(profile,
-                                  nodes,
-                                  startObject,
-                                  startNodeIndex,
-                                  targetObject,
-                                  targetNodeIndex,
-                                  route)) {
-      //std::cerr << "Cannot convert routing result to route data" << std::endl;
-      return false;
-    }
+          double pathCost=profile.GetCosts(*routeNode,objectVariantData,i);
 
-    ResolveRouteDataJunctions(route);
+          if (node->cost+pathCost>threshold) {
+            // The path can only be traveled partially
+            double fraction=(threshold-node->cost)/pathCost;
+
+            targetCoord=GeoCoord(from.GetLat()+(targetCoord.GetLat()-from.GetLat())*fraction,
+                                 from.GetLon()+(targetCoord.GetLon()-from.GetLon())*fraction);
+          }
+
+          segments.push_back(std::make_pair(from,
+                                            targetCoord));
+        }
+      }
+
+      area.maxCost=threshold;
+
+      GetGridOutline(segments,
+                     cellWidth,
+                     cellHeight,
+                     area.outline);
+
+      isochrone.AddArea(area);
+    }
 
     return true;
   }
@@ -1621,6 +3241,10 @@ namespace osmscout {
    * @note The actual object may not be within the given radius
    * due to internal search index resolution.
    *
+   * @note If the routable segment index has been generated during import
+   * (and is not disabled, see RouterParameter::SetUseRoutableSegmentIndex()),
+   * it is used instead of loading the ways and areas in the search area.
+   *
    * @param lat
    *    Latitude value of the search center
    * @param lon
@@ -1647,6 +3271,14 @@ namespace osmscout {
     object.Invalidate();
     nodeIndex=std::numeric_limits<size_t>::max();
 
+    if (routableSegmentIndex) {
+      return routableSegmentIndex->GetClosestNode(GeoCoord(lat,lon),
+                                                  vehicle,
+                                                  radius,
+                                                  object,
+                                                  nodeIndex);
+    }
+
     TypeConfigRef    typeConfig=database->GetTypeConfig();
     AreaAreaIndexRef areaAreaIndex=database->GetAreaAreaIndex();
     AreaWayIndexRef  areaWayIndex=database->GetAreaWayIndex();
@@ -1756,4 +3388,236 @@ namespace osmscout {
 
     return true;
   }
+
+  /**
+   * Return the closest routable node (see GetClosestRoutableNode()) for each
+   * of the given coordinates.
+   *
+   * If the routable segment index is available, no ways or areas have to be
+   * loaded, so snapping a large number of points (like the points of a GPS
+   * track) is fast.
+   *
+   * @param coords
+   *    The coordinates to snap
+   * @param vehicle
+   *    Vehicle to use
+   * @param radius
+   *    The maximum radius to search in from each coordinate in meter
+   * @param positions
+   *    One position for each coordinate. The object of the position is
+   *    invalid, if no routable node was found for the coordinate.
+   * @return
+   *    False, if there was an error, else true
+   */
+  bool RoutingService::SnapPoints(const std::vector<GeoCoord>& coords,
+                                  Vehicle vehicle,
+                                  double radius,
+                                  std::vector<RoutePosition>& positions) const
+  {
+    positions.clear();
+    positions.resize(coords.size());
+
+    for (size_t i=0; i<coords.size(); i++) {
+      if (!GetClosestRoutableNode(coords[i].GetLat(),
+                                  coords[i].GetLon(),
+                                  vehicle,
+                                  radius,
+                                  positions[i].object,
+                                  positions[i].nodeIndex)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Update the candidate for the way of the given segment, if the segment is
+   * closer to the coordinate than all segments of the way seen before.
+   * Candidates of the same way must be passed consecutively.
+   */
+  static void AddSegmentCandidate(const GeoCoord& coord,
+                                  const ObjectFileRef& object,
+                                  size_t fromIndex,
+                                  const GeoCoord& from,
+                                  size_t toIndex,
+                                  const GeoCoord& to,
+                                  std::vector<RouteCandidate>& candidates)
+  {
+    GeoCoord intersection;
+
+    CalculateDistancePointToLineSegment(coord,
+                                        from,
+                                        to,
+                                        intersection);
+
+    double distance=GetSphericalDistance(coord,
+                                         intersection);
+
+    if (!candidates.empty() &&
+        candidates.back().position.object==object) {
+      if (distance>=candidates.back().distance) {
+        return;
+      }
+    }
+    else {
+      candidates.push_back(RouteCandidate());
+      candidates.back().position.object=object;
+    }
+
+    RouteCandidate& candidate=candidates.back();
+
+    candidate.coord=intersection;
+    candidate.distance=distance;
+
+    if (GetSphericalDistance(intersection,from)<=GetSphericalDistance(intersection,to)) {
+      candidate.position.nodeIndex=fromIndex;
+    }
+    else {
+      candidate.position.nodeIndex=toIndex;
+    }
+  }
+
+  /**
+   * Return the ways routable by the given vehicle within the given radius
+   * around the coordinate, ordered by increasing distance (candidates for
+   * matching a GPS position to the routing graph).
+   *
+   * For each way the segment closest to the coordinate is determined. The
+   * position of the candidate is the node of that segment closer to the
+   * coordinate. Areas are not returned, since routes cannot start or end on
+   * areas, yet.
+   *
+   * If the routable segment index is available (see
+   * RouterParameter::SetUseRoutableSegmentIndex()), no ways have to be
+   * loaded. Method is thread-safe.
+   *
+   * @param coord
+   *    The search center
+   * @param vehicle
+   *    Vehicle to use
+   * @param radius
+   *    The maximum distance of a way to the search center in meter
+   * @param maxCount
+   *    The maximum number of candidates to return
+   * @param candidates
+   *    The closest ways, the closest first
+   * @return
+   *    False, if there was an error, else true
+   */
+  bool RoutingService::GetRouteCandidates(const GeoCoord& coord,
+                                          Vehicle vehicle,
+                                          double radius,
+                                          size_t maxCount,
+                                          std::vector<RouteCandidate>& candidates) const
+  {
+    // The corners of the box returned by BoxByCenterAndRadius() are on the circle, enlarge
+    // the box to contain the whole circle (with some margin for the different distance functions)
+    GeoBox boundingBox=GeoBox::BoxByCenterAndRadius(coord,radius*1.5);
+
+    candidates.clear();
+
+    if (routableSegmentIndex) {
+      std::vector<RoutableSegmentIndex::Segment> segments;
+
+      routableSegmentIndex->GetSegments(boundingBox,
+                                        vehicle,
+                                        segments);
+
+      for (const auto& segment : segments) {
+        if (segment.from->type!=refWay) {
+          continue;
+        }
+
+        AddSegmentCandidate(coord,
+                            ObjectFileRef(segment.from->offset,refWay),
+                            segment.from->nodeIndex,
+                            GeoCoord(segment.from->lat,segment.from->lon),
+                            segment.to->nodeIndex,
+                            GeoCoord(segment.to->lat,segment.to->lon),
+                            candidates);
+      }
+    }
+    else {
+      TypeConfigRef   typeConfig=database->GetTypeConfig();
+      AreaWayIndexRef areaWayIndex=database->GetAreaWayIndex();
+      WayDataFileRef  wayDataFile=database->GetWayDataFile();
+
+      if (!typeConfig ||
+          !areaWayIndex ||
+          !wayDataFile) {
+        log.Error() << "At least one index file is invalid!";
+        return false;
+      }
+
+      TypeInfoSet             wayRoutableTypes;
+      TypeInfoSet             wayLoadedTypes;
+      std::vector<FileOffset> wayOffsets;
+      std::vector<WayRef>     ways;
+
+      for (const auto& type : typeConfig->GetTypes()) {
+        if (!type->GetIgnore() &&
+            type->CanBeWay() &&
+            type->CanRoute(vehicle)) {
+          wayRoutableTypes.Set(type);
+        }
+      }
+
+      if (!areaWayIndex->GetOffsets(boundingBox,
+                                    wayRoutableTypes,
+                                    wayOffsets,
+                                    wayLoadedTypes)) {
+        log.Error() << "Error getting ways from area way index!";
+        return false;
+      }
+
+      std::sort(wayOffsets.begin(),
+                wayOffsets.end());
+
+      if (!wayDataFile->GetByOffset(wayOffsets,
+                                    ways)) {
+        log.Error() << "Error reading ways in area!";
+        return false;
+      }
+
+      for (const auto& way : ways) {
+        if (!HasNodeWithId(way->nodes)) {
+          continue;
+        }
+
+        for (size_t i=1; i<way->nodes.size(); i++) {
+          AddSegmentCandidate(coord,
+                              ObjectFileRef(way->GetFileOffset(),refWay),
+                              i-1,
+                              way->nodes[i-1].GetCoord(),
+                              i,
+                              way->nodes[i].GetCoord(),
+                              candidates);
+        }
+      }
+    }
+
+    candidates.erase(std::remove_if(candidates.begin(),
+                                    candidates.end(),
+                                    [radius](const RouteCandidate& candidate) {
+                                      return candidate.distance*1000.0>radius;
+                                    }),
+                     candidates.end());
+
+    std::sort(candidates.begin(),
+              candidates.end(),
+              [](const RouteCandidate& a, const RouteCandidate& b) {
+                if (a.distance!=b.distance) {
+                  return a.distance<b.distance;
+                }
+
+                return a.position.object<b.position.object;
+              });
+
+    if (candidates.size()>maxCount) {
+      candidates.resize(maxCount);
+    }
+
+    return true;
+  }
 }
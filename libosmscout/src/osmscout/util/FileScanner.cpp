@@ -120,7 +120,7 @@ namespace osmscout {
     // L4C:
     useMmap=false;
       
-    if (file!=NULL) {
+    if (IsOpen()) {
       throw IOException(filename,"Error opening file for reading","File already opened");
     }
 
@@ -255,6 +255,36 @@ namespace osmscout {
     hasError=false;
   }
 
+  /**
+   * Opens the given block of memory for reading as if it was the content of
+   * a file with the given name. The memory is neither copied nor freed, so it
+   * must stay valid until the scanner is closed.
+   *
+   * throws IOException on error
+   */
+  void FileScanner::Open(const std::string& filename,
+                         const char* data,
+                         size_t size)
+  {
+    if (IsOpen()) {
+      throw IOException(filename,"Error opening memory for reading","File already opened");
+    }
+
+    hasError=true;
+    this->filename=filename;
+
+    if (data==NULL ||
+        size==0) {
+      throw IOException(filename,"Cannot open memory for reading","Memory is empty");
+    }
+
+    buffer=const_cast<char*>(data);
+    this->size=(FileOffset)size;
+    offset=0;
+
+    hasError=false;
+  }
+
   /**
    * Closes the file.
    *
@@ -264,10 +294,16 @@ namespace osmscout {
    */
   void FileScanner::Close()
   {
-    if (file==NULL) {
+    if (!IsOpen()) {
       throw IOException(filename,"Cannot close file","File already closed");
     }
 
+    // Memory passed by the caller is not freed
+    if (file==NULL) {
+      buffer=NULL;
+      return;
+    }
+
     FreeBuffer();
 
     if (fclose(file)!=0) {
@@ -287,7 +323,12 @@ namespace osmscout {
    */
   void FileScanner::CloseFailsafe()
   {
+    if (!IsOpen()) {
+      return;
+    }
+
     if (file==NULL) {
+      buffer=NULL;
       return;
     }
 
@@ -308,11 +349,9 @@ namespace osmscout {
       return true;
     }
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       return offset>=size;
     }
-#endif
 
     return feof(file)!=0;
   }
@@ -343,7 +382,6 @@ namespace osmscout {
       throw IOException(filename,"Cannot set position in file","File already in error state");
     }
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (pos>=size) {
         hasError=true;
@@ -354,7 +392,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     clearerr(file);
 
@@ -380,11 +417,9 @@ namespace osmscout {
       throw IOException(filename,"Cannot read position in file","File already in error state");
     }
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       return offset;
     }
-#endif
 
 #if defined(HAVE_FSEEKO)
     off_t filepos=ftello(file);
@@ -413,7 +448,6 @@ namespace osmscout {
       throw IOException(filename,"Cannot read byte array","File already in error state");
     }
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (this->buffer!=NULL) {
       if (offset+(FileOffset)bytes-1>=size) {
         hasError=true;
@@ -426,7 +460,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     hasError=fread(buffer,1,bytes,file)!=bytes;
 
@@ -443,7 +476,6 @@ namespace osmscout {
 
     value.clear();
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset>=size) {
         hasError=true;
@@ -468,7 +500,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     char character;
 
@@ -495,7 +526,6 @@ namespace osmscout {
       throw IOException(filename,"Cannot read bool","File already in error state");
     }
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset>=size) {
         hasError=true;
@@ -508,7 +538,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     char value;
 
@@ -529,7 +558,6 @@ namespace osmscout {
 
     number=0;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset>=size) {
         hasError=true;
@@ -542,7 +570,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     hasError=fread(&number,1,1,file)!=1;
 
@@ -559,7 +586,6 @@ namespace osmscout {
 
     number=0;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset+2-1>=size) {
         hasError=true;
@@ -582,7 +608,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     unsigned char buffer[2];
 
@@ -613,7 +638,6 @@ namespace osmscout {
 
     number=0;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset+4-1>=size) {
         hasError=true;
@@ -646,7 +670,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     unsigned char buffer[4];
 
@@ -687,7 +710,6 @@ namespace osmscout {
 
     number=0;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset+8-1>=size) {
         hasError=true;
@@ -740,7 +762,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     unsigned char buffer[8];
 
@@ -801,7 +822,6 @@ namespace osmscout {
 
     number=0;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset>=size) {
         hasError=true;
@@ -814,7 +834,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     hasError=fread(&number,1,1,file)!=1;
 
@@ -831,7 +850,6 @@ namespace osmscout {
 
     number=0;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset+2-1>=size) {
         hasError=true;
@@ -854,7 +872,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     unsigned char buffer[2];
 
@@ -885,7 +902,6 @@ namespace osmscout {
 
     number=0;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset+4-1>=size) {
         hasError=true;
@@ -918,7 +934,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     unsigned char buffer[4];
 
@@ -959,7 +974,6 @@ namespace osmscout {
 
     number=0;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset+8-1>=size) {
         hasError=true;
@@ -1012,7 +1026,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     unsigned char buffer[8];
 
@@ -1074,7 +1087,6 @@ namespace osmscout {
 
     number=0;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset+bytes-1>=size) {
         hasError=true;
@@ -1099,7 +1111,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     unsigned char buffer[2];
 
@@ -1133,7 +1144,6 @@ namespace osmscout {
 
     number=0;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset+bytes-1>=size) {
         hasError=true;
@@ -1172,7 +1182,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     unsigned char buffer[4];
 
@@ -1220,7 +1229,6 @@ namespace osmscout {
 
     number=0;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset+bytes-1>=size) {
         hasError=true;
@@ -1287,7 +1295,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     unsigned char buffer[8];
 
@@ -1373,7 +1380,6 @@ namespace osmscout {
 
     fileOffset=0;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset+8-1>=size) {
         hasError=true;
@@ -1426,7 +1432,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     unsigned char buffer[8];
 
@@ -1490,7 +1495,6 @@ namespace osmscout {
 
     fileOffset=0;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset+bytes-1>=size) {
         hasError=true;
@@ -1557,7 +1561,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     unsigned char buffer[8];
 
@@ -1632,7 +1635,6 @@ namespace osmscout {
 
     number=0;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset>=size) {
         hasError=true;
@@ -1645,7 +1647,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     char buffer;
 
@@ -1712,7 +1713,6 @@ namespace osmscout {
 
     number=0;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset>=size) {
         hasError=true;
@@ -1725,7 +1725,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     char buffer;
 
@@ -1793,7 +1792,6 @@ namespace osmscout {
 
     number=0;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset>=size) {
         hasError=true;
@@ -1806,7 +1804,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     char buffer;
 
@@ -1873,7 +1870,6 @@ namespace osmscout {
 
     number=0;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       unsigned int shift=0;
 
@@ -1891,7 +1887,6 @@ namespace osmscout {
       hasError=true;
       throw IOException(filename,"Cannot read uint16_t number","Cannot read beyond end of file");
     }
-#endif
 
     char buffer;
 
@@ -1926,7 +1921,6 @@ namespace osmscout {
 
     number=0;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       unsigned int shift=0;
 
@@ -1944,7 +1938,6 @@ namespace osmscout {
       hasError=true;
       throw IOException(filename,"Cannot read uint32_t number","Cannot read beyond end of file");
     }
-#endif
 
     char buffer;
 
@@ -1979,7 +1972,6 @@ namespace osmscout {
 
     number=0;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       unsigned int shift=0;
 
@@ -1997,7 +1989,6 @@ namespace osmscout {
       hasError=true;
       throw IOException(filename,"Cannot read uint64_t number","Cannot read beyond end of file");
     }
-#endif
 
     char buffer;
 
@@ -2033,7 +2024,6 @@ namespace osmscout {
     uint32_t latDat;
     uint32_t lonDat;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset+coordByteSize-1>=size) {
         hasError=true;
@@ -2060,7 +2050,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     unsigned char buffer[coordByteSize];
 
@@ -2094,7 +2083,6 @@ namespace osmscout {
     uint32_t latDat;
     uint32_t lonDat;
 
-#if defined(HAVE_MMAP) || defined(__WIN32__) || defined(WIN32)
     if (buffer!=NULL) {
       if (offset+coordByteSize-1>=size) {
         hasError=true;
@@ -2128,7 +2116,6 @@ namespace osmscout {
 
       return;
     }
-#endif
 
     unsigned char buffer[coordByteSize];
 
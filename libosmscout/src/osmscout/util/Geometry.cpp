@@ -20,6 +20,7 @@
 #include <osmscout/util/Geometry.h>
 
 #include <cstdlib>
+#include <limits>
 
 #include <osmscout/system/Math.h>
 #include <osmscout/system/SSEMathPublic.h>
@@ -440,6 +441,221 @@ namespace osmscout {
     return angle;
   }
 
+  /**
+   * Rasterizes the segments, fills cells that only touch diagonally (so that
+   * every corner of the outline belongs to exactly one border), fills holes by
+   * flooding the outside from the (always empty) grid border and finally
+   * follows the border between covered and outside cells.
+   */
+  void GetGridOutline(const std::vector<std::pair<GeoCoord,GeoCoord>>& segments,
+                      double cellWidth,
+                      double cellHeight,
+                      std::vector<GeoCoord>& outline)
+  {
+    static const size_t maxCellCount=16*1024*1024;
+
+    outline.clear();
+
+    if (segments.empty() ||
+        cellWidth<=0.0 ||
+        cellHeight<=0.0) {
+      return;
+    }
+
+    double minLon=segments.front().first.GetLon();
+    double maxLon=minLon;
+    double minLat=segments.front().first.GetLat();
+    double maxLat=minLat;
+
+    for (const auto& segment : segments) {
+      minLon=std::min(minLon,std::min(segment.first.GetLon(),segment.second.GetLon()));
+      maxLon=std::max(maxLon,std::max(segment.first.GetLon(),segment.second.GetLon()));
+      minLat=std::min(minLat,std::min(segment.first.GetLat(),segment.second.GetLat()));
+      maxLat=std::max(maxLat,std::max(segment.first.GetLat(),segment.second.GetLat()));
+    }
+
+    size_t width;
+    size_t height;
+
+    // One empty row or column of cells on each side
+    while (true) {
+      width=(size_t)floor((maxLon-minLon)/cellWidth)+3;
+      height=(size_t)floor((maxLat-minLat)/cellHeight)+3;
+
+      if (width*height<=maxCellCount) {
+        break;
+      }
+
+      cellWidth*=2;
+      cellHeight*=2;
+    }
+
+    double originLon=minLon-cellWidth;
+    double originLat=minLat-cellHeight;
+
+    enum : uint8_t
+    {
+      empty   = 0,
+      covered = 1,
+      outside = 2
+    };
+
+    std::vector<uint8_t>  grid(width*height,empty);
+    std::vector<ScanCell> cells;
+
+    // Rounding must not move a point into the empty border
+    auto getX=[&](const GeoCoord& coord) {
+      return std::max(1,std::min((int)width-2,(int)floor((coord.GetLon()-originLon)/cellWidth)));
+    };
+    auto getY=[&](const GeoCoord& coord) {
+      return std::max(1,std::min((int)height-2,(int)floor((coord.GetLat()-originLat)/cellHeight)));
+    };
+
+    for (const auto& segment : segments) {
+      cells.clear();
+
+      ScanConvertLine(getX(segment.first),
+                      getY(segment.first),
+                      getX(segment.second),
+                      getY(segment.second),
+                      cells);
+
+      for (size_t i=0; i<cells.size(); i++) {
+        grid[cells[i].y*width+cells[i].x]=covered;
+
+        // Keep the cells of a line connected by their edges, not only by their corners
+        if (i>0 &&
+            cells[i].x!=cells[i-1].x &&
+            cells[i].y!=cells[i-1].y) {
+          grid[cells[i-1].y*width+cells[i].x]=covered;
+        }
+      }
+    }
+
+    bool changed=true;
+
+    while (changed) {
+      changed=false;
+
+      for (size_t y=0; y+1<height; y++) {
+        for (size_t x=0; x+1<width; x++) {
+          uint8_t& bottomLeft=grid[y*width+x];
+          uint8_t& bottomRight=grid[y*width+x+1];
+          uint8_t& topLeft=grid[(y+1)*width+x];
+          uint8_t& topRight=grid[(y+1)*width+x+1];
+
+          if (bottomLeft==covered &&
+              topRight==covered &&
+              bottomRight==empty &&
+              topLeft==empty) {
+            topLeft=covered;
+            changed=true;
+          }
+          else if (bottomRight==covered &&
+                   topLeft==covered &&
+                   bottomLeft==empty &&
+                   topRight==empty) {
+            bottomLeft=covered;
+            changed=true;
+          }
+        }
+      }
+    }
+
+    std::vector<size_t> stack;
+
+    grid[0]=outside;
+    stack.push_back(0);
+
+    while (!stack.empty()) {
+      size_t index=stack.back();
+      size_t x=index%width;
+      size_t y=index/width;
+
+      stack.pop_back();
+
+      size_t neighbours[4];
+      size_t neighbourCount=0;
+
+      if (x>0) {
+        neighbours[neighbourCount++]=index-1;
+      }
+      if (x+1<width) {
+        neighbours[neighbourCount++]=index+1;
+      }
+      if (y>0) {
+        neighbours[neighbourCount++]=index-width;
+      }
+      if (y+1<height) {
+        neighbours[neighbourCount++]=index+width;
+      }
+
+      for (size_t n=0; n<neighbourCount; n++) {
+        if (grid[neighbours[n]]==empty) {
+          grid[neighbours[n]]=outside;
+          stack.push_back(neighbours[n]);
+        }
+      }
+    }
+
+    // For every corner of the grid the next corner on the outline, such that
+    // the covered cells are on the left side
+    size_t              cornerWidth=width+1;
+    size_t              noCorner=std::numeric_limits<size_t>::max();
+    std::vector<size_t> next(cornerWidth*(height+1),noCorner);
+    size_t              start=noCorner;
+
+    for (size_t y=1; y+1<height; y++) {
+      for (size_t x=1; x+1<width; x++) {
+        if (grid[y*width+x]==outside) {
+          continue;
+        }
+
+        size_t bottomLeft=y*cornerWidth+x;
+        size_t bottomRight=bottomLeft+1;
+        size_t topLeft=bottomLeft+cornerWidth;
+        size_t topRight=topLeft+1;
+
+        if (grid[(y-1)*width+x]==outside) {
+          next[bottomLeft]=bottomRight;
+
+          if (start==noCorner) {
+            start=bottomLeft;
+          }
+        }
+        if (grid[y*width+x+1]==outside) {
+          next[bottomRight]=topRight;
+        }
+        if (grid[(y+1)*width+x]==outside) {
+          next[topRight]=topLeft;
+        }
+        if (grid[y*width+x-1]==outside) {
+          next[topLeft]=bottomLeft;
+        }
+      }
+    }
+
+    if (start==noCorner) {
+      return;
+    }
+
+    size_t previous=start;
+    size_t current=next[start];
+
+    do {
+      size_t following=next[current];
+
+      // Only keep corners at which the direction changes
+      if (following-current!=current-previous) {
+        outline.push_back(GeoCoord(originLat+(current/cornerWidth)*cellHeight,
+                                   originLon+(current%cornerWidth)*cellWidth));
+      }
+
+      previous=current;
+      current=following;
+    } while (previous!=start);
+  }
+
   ScanCell::ScanCell(int x, int y)
   : x(x),
     y(y)
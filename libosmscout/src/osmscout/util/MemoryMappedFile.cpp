@@ -0,0 +1,195 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/private/Config.h>
+
+#include <osmscout/util/MemoryMappedFile.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(HAVE_MMAP)
+  #include <unistd.h>
+  #include <sys/mman.h>
+#endif
+
+#if defined(__WIN32__) || defined(WIN32)
+  #include<io.h>
+#endif
+
+#include <osmscout/util/File.h>
+#include <osmscout/util/Logger.h>
+
+namespace osmscout {
+
+  MemoryMappedFile::MemoryMappedFile()
+   : file(NULL),
+     size(0),
+     buffer(NULL)
+#if defined(__WIN32__) || defined(WIN32)
+     ,mmfHandle((HANDLE)0)
+#endif
+  {
+    // no code
+  }
+
+  MemoryMappedFile::~MemoryMappedFile()
+  {
+    if (IsOpen()) {
+      log.Warn() << "Automatically closing MemoryMappedFile for file '" << filename << "'!";
+      CloseFailsafe();
+    }
+  }
+
+  void MemoryMappedFile::FreeBuffer()
+  {
+#if defined(HAVE_MMAP)
+    if (buffer!=NULL) {
+      if (munmap(buffer,size)!=0) {
+        log.Error() << "Error while calling munmap: "<< strerror(errno) << " for file '" << filename << "'";
+      }
+
+      buffer=NULL;
+    }
+#elif  defined(__WIN32__) || defined(WIN32)
+    if (buffer!=NULL) {
+      UnmapViewOfFile(buffer);
+      buffer=NULL;
+    }
+    if (mmfHandle!=NULL) {
+      CloseHandle(mmfHandle);
+      mmfHandle=NULL;
+    }
+#endif
+
+    fallback.clear();
+    fallback.shrink_to_fit();
+  }
+
+  /**
+   * Opens the given file and makes its complete content accessible via
+   * GetData().
+   *
+   * If the file cannot be opened or read, an IOException is thrown.
+   */
+  void MemoryMappedFile::Open(const std::string& filename)
+  {
+    if (file!=NULL) {
+      throw IOException(filename,"Error opening file for reading","File already opened");
+    }
+
+    this->filename=filename;
+
+    size=GetFileSize(filename);
+
+    file=fopen(filename.c_str(),"rb");
+
+    if (file==NULL) {
+      throw IOException(filename,"Cannot open file for reading");
+    }
+
+    if (size==0) {
+      return;
+    }
+
+#if defined(HAVE_MMAP)
+    buffer=(char*)mmap(NULL,(size_t)size,PROT_READ,MAP_PRIVATE,fileno(file),0);
+
+    if (buffer==MAP_FAILED) {
+      log.Warn() << "Cannot mmap file '" << filename << "' of size " << size << " (" << strerror(errno) << "), reading it instead";
+      buffer=NULL;
+    }
+#elif  defined(__WIN32__) || defined(WIN32)
+    mmfHandle=CreateFileMapping((HANDLE)_get_osfhandle(fileno(file)),
+                                (LPSECURITY_ATTRIBUTES)NULL,
+                                PAGE_READONLY,
+                                0,0,
+                                (LPCTSTR)NULL);
+
+    if (mmfHandle!=NULL) {
+      buffer=(char*)MapViewOfFile(mmfHandle,
+                                  FILE_MAP_READ,
+                                  0,
+                                  0,
+                                  0);
+
+      if (buffer==NULL) {
+        log.Warn() << "Cannot map view for file '" << filename << "' of size " << size << " (" << GetLastError() << "), reading it instead";
+      }
+    }
+    else {
+      log.Warn() << "Cannot create file mapping for file '" << filename << "' of size " << size << " (" << GetLastError() << "), reading it instead";
+    }
+#endif
+
+    if (buffer==NULL) {
+      fallback.resize((size_t)size);
+
+      if (fread(fallback.data(),1,(size_t)size,file)!=(size_t)size) {
+        CloseFailsafe();
+        throw IOException(filename,"Cannot read file");
+      }
+    }
+  }
+
+  /**
+   * Closes the file and releases the memory.
+   *
+   * If the file was never opened or was already closed an exception is thrown.
+   */
+  void MemoryMappedFile::Close()
+  {
+    if (file==NULL) {
+      throw IOException(filename,"Cannot close file","File already closed");
+    }
+
+    FreeBuffer();
+
+    if (fclose(file)!=0) {
+      file=NULL;
+      throw IOException(filename,"Cannot close file");
+    }
+
+    file=NULL;
+    size=0;
+  }
+
+  /**
+   * Closes the file. Does not throw any exceptions even if an error occurs.
+   */
+  void MemoryMappedFile::CloseFailsafe()
+  {
+    if (file==NULL) {
+      return;
+    }
+
+    FreeBuffer();
+
+    fclose(file);
+
+    file=NULL;
+    size=0;
+  }
+
+  std::string MemoryMappedFile::GetFilename() const
+  {
+    return filename;
+  }
+}
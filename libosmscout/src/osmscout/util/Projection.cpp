@@ -31,6 +31,19 @@
 #include <osmscout/util/Tiling.h>
 
 #include <iostream>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OSMSCOUT_ARRAY_TRANSFORMER_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define OSMSCOUT_ARRAY_TRANSFORMER_SSE2
+#endif
+
+#if defined(OSMSCOUT_ARRAY_TRANSFORMER_SSE2) || defined(OSMSCOUT_ARRAY_TRANSFORMER_AVX2)
+#include <immintrin.h>
+#endif
+
 namespace osmscout {
 
   /*
@@ -55,6 +68,40 @@ namespace osmscout {
 
   static const double gradtorad=2*M_PI/360;
 
+  //< Coefficients of the taylor series of sin(x)/x in x^2, exact enough for |x|<=pi/2
+  static const double sinCoefficients[]={
+     1.0,
+    -1.0/6.0,
+     1.0/120.0,
+    -1.0/5040.0,
+     1.0/362880.0,
+    -1.0/39916800.0,
+     1.0/6227020800.0,
+    -1.0/1307674368000.0,
+     1.0/355687428096000.0,
+    -1.0/121645100408832000.0,
+     1.0/51090942171709440000.0
+  };
+
+  static const size_t sinCoefficientCount=sizeof(sinCoefficients)/sizeof(double);
+
+  //< Coefficients of the series of atanh(t)/t in t^2, exact enough for |t|<=0.1716
+  static const double atanhCoefficients[]={
+    1.0,
+    1.0/3.0,
+    1.0/5.0,
+    1.0/7.0,
+    1.0/9.0,
+    1.0/11.0,
+    1.0/13.0,
+    1.0/15.0,
+    1.0/17.0,
+    1.0/19.0,
+    1.0/21.0
+  };
+
+  static const size_t atanhCoefficientCount=sizeof(atanhCoefficients)/sizeof(double);
+
   Projection::Projection()
   : lon(0),
     lat(0),
@@ -79,6 +126,257 @@ namespace osmscout {
     // no code
   }
 
+  /**
+   * Return the description of the transformation for the ArrayTransformer. Returns
+   * false, if the projection cannot be described this way (the default).
+   */
+  bool Projection::GetArrayTransformation(ArrayTransformation& /*transformation*/) const
+  {
+    return false;
+  }
+
+  static void TransformArrayScalar(const Projection::ArrayTransformation& t,
+                                   const Point* points,
+                                   size_t count,
+                                   double* x,
+                                   double* y)
+  {
+    for (size_t i=0; i<count; i++) {
+      double lat=points[i].GetLat();
+      double u=points[i].GetLon()*t.lonScale+t.lonOffset;
+      double v=(t.linear ? lat : atanh(sin(lat*gradtorad)))*t.latScale+t.latOffset;
+
+      x[i]=u*t.xu+v*t.xv+t.x0;
+      y[i]=u*t.yu+v*t.yv+t.y0;
+    }
+  }
+
+#ifdef OSMSCOUT_ARRAY_TRANSFORMER_SSE2
+  /**
+   * atanh(sin(x)) for 2 values with |x|<pi/2, as log((1+sin(x))/(1-sin(x)))/2
+   */
+  static inline __m128d AtanhSinSSE2(__m128d x)
+  {
+    // sin(x)
+    __m128d z=_mm_mul_pd(x,x);
+    __m128d p=_mm_set1_pd(sinCoefficients[sinCoefficientCount-1]);
+
+    for (size_t i=sinCoefficientCount-1; i>0; i--) {
+      p=_mm_add_pd(_mm_mul_pd(p,z),_mm_set1_pd(sinCoefficients[i-1]));
+    }
+
+    __m128d one=_mm_set1_pd(1.0);
+    __m128d s=_mm_mul_pd(p,x);
+    __m128d r=_mm_div_pd(_mm_add_pd(one,s),_mm_sub_pd(one,s));
+
+    // log(r)=e*log(2)+log(m) with m in [sqrt(2)/2,sqrt(2)]
+    __m128i bits=_mm_castpd_si128(r);
+    __m128d e=_mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(bits,52),
+                                                       _mm_set1_epi64x(0x4330000000000000LL))),
+                         _mm_set1_pd(4503599627370496.0+1023.0));
+    __m128d m=_mm_castsi128_pd(_mm_or_si128(_mm_and_si128(bits,_mm_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+                                            _mm_set1_epi64x(0x3FF0000000000000LL)));
+    __m128d mask=_mm_cmpgt_pd(m,_mm_set1_pd(M_SQRT2));
+
+    m=_mm_or_pd(_mm_and_pd(mask,_mm_mul_pd(m,_mm_set1_pd(0.5))),
+                _mm_andnot_pd(mask,m));
+    e=_mm_add_pd(e,_mm_and_pd(mask,one));
+
+    __m128d t=_mm_div_pd(_mm_sub_pd(m,one),_mm_add_pd(m,one));
+
+    z=_mm_mul_pd(t,t);
+    p=_mm_set1_pd(atanhCoefficients[atanhCoefficientCount-1]);
+
+    for (size_t i=atanhCoefficientCount-1; i>0; i--) {
+      p=_mm_add_pd(_mm_mul_pd(p,z),_mm_set1_pd(atanhCoefficients[i-1]));
+    }
+
+    // log(m)=2*atanh(t), we return log(r)/2
+    return _mm_add_pd(_mm_mul_pd(e,_mm_set1_pd(M_LN2/2)),
+                      _mm_mul_pd(p,t));
+  }
+
+  static void TransformArraySSE2(const Projection::ArrayTransformation& t,
+                                 const Point* points,
+                                 size_t count,
+                                 double* x,
+                                 double* y)
+  {
+    __m128d lonScale=_mm_set1_pd(t.lonScale);
+    __m128d lonOffset=_mm_set1_pd(t.lonOffset);
+    __m128d latScale=_mm_set1_pd(t.latScale);
+    __m128d latOffset=_mm_set1_pd(t.latOffset);
+    __m128d toRad=_mm_set1_pd(gradtorad);
+    size_t  i=0;
+
+    for (; i+2<=count; i+=2) {
+      __m128d lon=_mm_set_pd(points[i+1].GetLon(),points[i].GetLon());
+      __m128d lat=_mm_set_pd(points[i+1].GetLat(),points[i].GetLat());
+      __m128d f=t.linear ? lat : AtanhSinSSE2(_mm_mul_pd(lat,toRad));
+      __m128d u=_mm_add_pd(_mm_mul_pd(lon,lonScale),lonOffset);
+      __m128d v=_mm_add_pd(_mm_mul_pd(f,latScale),latOffset);
+
+      _mm_storeu_pd(x+i,_mm_add_pd(_mm_add_pd(_mm_mul_pd(u,_mm_set1_pd(t.xu)),
+                                              _mm_mul_pd(v,_mm_set1_pd(t.xv))),
+                                   _mm_set1_pd(t.x0)));
+      _mm_storeu_pd(y+i,_mm_add_pd(_mm_add_pd(_mm_mul_pd(u,_mm_set1_pd(t.yu)),
+                                              _mm_mul_pd(v,_mm_set1_pd(t.yv))),
+                                   _mm_set1_pd(t.y0)));
+    }
+
+    TransformArrayScalar(t,points+i,count-i,x+i,y+i);
+  }
+#endif
+
+#ifdef OSMSCOUT_ARRAY_TRANSFORMER_AVX2
+  /**
+   * atanh(sin(x)) for 4 values with |x|<pi/2, see AtanhSinSSE2()
+   */
+  __attribute__((target("avx2,fma")))
+  static inline __m256d AtanhSinAVX2(__m256d x)
+  {
+    __m256d z=_mm256_mul_pd(x,x);
+    __m256d p=_mm256_set1_pd(sinCoefficients[sinCoefficientCount-1]);
+
+    for (size_t i=sinCoefficientCount-1; i>0; i--) {
+      p=_mm256_fmadd_pd(p,z,_mm256_set1_pd(sinCoefficients[i-1]));
+    }
+
+    __m256d one=_mm256_set1_pd(1.0);
+    __m256d s=_mm256_mul_pd(p,x);
+    __m256d r=_mm256_div_pd(_mm256_add_pd(one,s),_mm256_sub_pd(one,s));
+
+    __m256i bits=_mm256_castpd_si256(r);
+    __m256d e=_mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits,52),
+                                                                _mm256_set1_epi64x(0x4330000000000000LL))),
+                            _mm256_set1_pd(4503599627370496.0+1023.0));
+    __m256d m=_mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits,_mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+                                                  _mm256_set1_epi64x(0x3FF0000000000000LL)));
+    __m256d mask=_mm256_cmp_pd(m,_mm256_set1_pd(M_SQRT2),_CMP_GT_OQ);
+
+    m=_mm256_blendv_pd(m,_mm256_mul_pd(m,_mm256_set1_pd(0.5)),mask);
+    e=_mm256_add_pd(e,_mm256_and_pd(mask,one));
+
+    __m256d t=_mm256_div_pd(_mm256_sub_pd(m,one),_mm256_add_pd(m,one));
+
+    z=_mm256_mul_pd(t,t);
+    p=_mm256_set1_pd(atanhCoefficients[atanhCoefficientCount-1]);
+
+    for (size_t i=atanhCoefficientCount-1; i>0; i--) {
+      p=_mm256_fmadd_pd(p,z,_mm256_set1_pd(atanhCoefficients[i-1]));
+    }
+
+    return _mm256_fmadd_pd(e,_mm256_set1_pd(M_LN2/2),_mm256_mul_pd(p,t));
+  }
+
+  __attribute__((target("avx2,fma")))
+  static void TransformArrayAVX2(const Projection::ArrayTransformation& t,
+                                 const Point* points,
+                                 size_t count,
+                                 double* x,
+                                 double* y)
+  {
+    __m256d lonScale=_mm256_set1_pd(t.lonScale);
+    __m256d lonOffset=_mm256_set1_pd(t.lonOffset);
+    __m256d latScale=_mm256_set1_pd(t.latScale);
+    __m256d latOffset=_mm256_set1_pd(t.latOffset);
+    __m256d toRad=_mm256_set1_pd(gradtorad);
+    size_t  i=0;
+
+    for (; i+4<=count; i+=4) {
+      __m256d lon=_mm256_set_pd(points[i+3].GetLon(),points[i+2].GetLon(),
+                                points[i+1].GetLon(),points[i].GetLon());
+      __m256d lat=_mm256_set_pd(points[i+3].GetLat(),points[i+2].GetLat(),
+                                points[i+1].GetLat(),points[i].GetLat());
+      __m256d f=t.linear ? lat : AtanhSinAVX2(_mm256_mul_pd(lat,toRad));
+      __m256d u=_mm256_fmadd_pd(lon,lonScale,lonOffset);
+      __m256d v=_mm256_fmadd_pd(f,latScale,latOffset);
+
+      _mm256_storeu_pd(x+i,_mm256_fmadd_pd(u,_mm256_set1_pd(t.xu),
+                                           _mm256_fmadd_pd(v,_mm256_set1_pd(t.xv),
+                                                           _mm256_set1_pd(t.x0))));
+      _mm256_storeu_pd(y+i,_mm256_fmadd_pd(u,_mm256_set1_pd(t.yu),
+                                           _mm256_fmadd_pd(v,_mm256_set1_pd(t.yv),
+                                                           _mm256_set1_pd(t.y0))));
+    }
+
+    TransformArrayScalar(t,points+i,count-i,x+i,y+i);
+  }
+#endif
+
+  Projection::ArrayTransformer::ArrayTransformer(const Projection& projection)
+  : projection(projection),
+    implementation(GetBestImplementation())
+  {
+    hasTransformation=projection.GetArrayTransformation(transformation);
+  }
+
+  /**
+   * Return the fastest implementation supported by the CPU
+   */
+  Projection::ArrayTransformer::Implementation Projection::ArrayTransformer::GetBestImplementation()
+  {
+#ifdef OSMSCOUT_ARRAY_TRANSFORMER_AVX2
+    static const bool hasAVX2=__builtin_cpu_supports("avx2") &&
+                              __builtin_cpu_supports("fma");
+
+    if (hasAVX2) {
+      return implementationAVX2;
+    }
+#endif
+
+#ifdef OSMSCOUT_ARRAY_TRANSFORMER_SSE2
+    return implementationSSE2;
+#else
+    return implementationScalar;
+#endif
+  }
+
+  /**
+   * Select the implementation to use (for testing). If the implementation
+   * is not supported by the CPU, the best supported implementation is used.
+   */
+  void Projection::ArrayTransformer::SetImplementation(Implementation implementation)
+  {
+    this->implementation=std::min(implementation,
+                                  GetBestImplementation());
+  }
+
+  /**
+   * Transform count points to pixel coordinates, storing the result in the
+   * arrays x and y.
+   */
+  void Projection::ArrayTransformer::GeoToPixel(const Point* points,
+                                                size_t count,
+                                                double* x,
+                                                double* y) const
+  {
+    if (!hasTransformation) {
+      for (size_t i=0; i<count; i++) {
+        projection.GeoToPixel(points[i].GetCoord(),
+                              x[i],y[i]);
+      }
+
+      return;
+    }
+
+    switch (implementation) {
+#ifdef OSMSCOUT_ARRAY_TRANSFORMER_AVX2
+    case implementationAVX2:
+      TransformArrayAVX2(transformation,points,count,x,y);
+      break;
+#endif
+#ifdef OSMSCOUT_ARRAY_TRANSFORMER_SSE2
+    case implementationSSE2:
+      TransformArraySSE2(transformation,points,count,x,y);
+      break;
+#endif
+    default:
+      TransformArrayScalar(transformation,points,count,x,y);
+      break;
+    }
+  }
+
   MercatorProjectionOld::MercatorProjectionOld()
     : valid(false),
       latOffset(0.0),
@@ -461,6 +759,42 @@ namespace osmscout {
     assert(false); //should not be called
   }
 
+  bool MercatorProjection::GetArrayTransformation(ArrayTransformation& transformation) const
+  {
+    assert(valid);
+
+    transformation.linear=useLinearInterpolation;
+    transformation.lonScale=scaleGradtorad;
+    transformation.lonOffset=-lon*scaleGradtorad;
+
+    if (useLinearInterpolation) {
+      transformation.latScale=scaledLatDeriv;
+      transformation.latOffset=-lat*scaledLatDeriv;
+    }
+    else {
+      transformation.latScale=scale;
+      transformation.latOffset=-latOffset*scale;
+    }
+
+    if (angle!=0.0) {
+      transformation.xu=angleNegCos;
+      transformation.xv=-angleNegSin;
+      transformation.yu=-angleNegSin;
+      transformation.yv=-angleNegCos;
+    }
+    else {
+      transformation.xu=1.0;
+      transformation.xv=0.0;
+      transformation.yu=0.0;
+      transformation.yv=-1.0;
+    }
+
+    transformation.x0=(double)(width/2);
+    transformation.y0=(double)(height/2);
+
+    return true;
+  }
+
   bool MercatorProjection::Move(double horizPixel,
                                 double vertPixel)
   {
@@ -546,7 +880,9 @@ namespace osmscout {
     lonOffset=lonMin*scaleGradtorad;
     latOffset=scale*atanh(sin(latMin*gradtorad));
 
-    pixelSize=earthExtentMeter/magnification.GetMagnification()/width;
+    // The projection may cover multiple tiles (or parts of tiles), so we cannot
+    // derive the pixel size from the size of a single tile
+    pixelSize=earthExtentMeter*(lonMax-lonMin)/360.0/width;
     meterInPixel=1/pixelSize;
     meterInMM=meterInPixel*25.4/pixelSize;
 
@@ -656,4 +992,33 @@ namespace osmscout {
 
   #endif
 
+  bool TileProjection::GetArrayTransformation(ArrayTransformation& transformation) const
+  {
+    transformation.lonScale=scaleGradtorad;
+    transformation.lonOffset=-lonOffset;
+    transformation.xu=1.0;
+    transformation.xv=0.0;
+    transformation.x0=0.0;
+    transformation.yu=0.0;
+    transformation.yv=-1.0;
+
+#ifndef OSMSCOUT_HAVE_SSE2
+    if (useLinearInterpolation) {
+      transformation.linear=true;
+      transformation.latScale=scaledLatDeriv;
+      transformation.latOffset=-lat*scaledLatDeriv;
+      transformation.y0=(double)(height/2);
+
+      return true;
+    }
+#endif
+
+    transformation.linear=false;
+    transformation.latScale=scale;
+    transformation.latOffset=-latOffset;
+    transformation.y0=(double)height;
+
+    return true;
+  }
+
 }
@@ -172,6 +172,11 @@ namespace osmscout {
     length(0),
     start(0),
     end(0),
+    clip(false),
+    clipXMin(0.0),
+    clipYMin(0.0),
+    clipXMax(0.0),
+    clipYMax(0.0),
     points(NULL)
   {
     // no code
@@ -182,52 +187,153 @@ namespace osmscout {
     delete [] points;
   }
 
-  void TransPolygon::TransformGeoToPixel(const Projection& projection,
-                                         const std::vector<Point>& nodes)
+  /**
+   * Points outside the given rectangle (in pixel) are dropped, if they are not needed
+   * to draw the parts of the way or area within the rectangle. A point is dropped, if it
+   * is on the same outer side of the rectangle as its drawn predecessor and its successor.
+   *
+   * Since the resulting path differs outside of the rectangle, the clipping rectangle
+   * should be a bit larger than the visible area (line width, dashes, labels along the path).
+   */
+  void TransPolygon::SetClipRect(double xMin, double yMin,
+                                 double xMax, double yMax)
   {
-    Projection::BatchTransformer batchTransformer(projection);
+    clip=true;
+    clipXMin=xMin;
+    clipYMin=yMin;
+    clipXMax=xMax;
+    clipYMax=yMax;
+  }
 
-    if (!nodes.empty()) {
-      start=0;
-      length=nodes.size();
-      end=length-1;
-
-      for (size_t i=start; i<=end; i++) {
-         batchTransformer.GeoToPixel(nodes[i].GetLon(),
-                                     nodes[i].GetLat(),
-                                     points[i].x,
-                                     points[i].y);
-        points[i].draw=true;
-      }
-    }
-    else {
+  void TransPolygon::ResetClipRect()
+  {
+    clip=false;
+  }
+
+  /**
+   * Transforms all nodes to pixel coordinates using the Projection::ArrayTransformer and
+   * drops similar and clipped points in the same pass.
+   *
+   * A point is similar, if it has a distance of at most optimizeErrorTolerance in x and y
+   * to the last not similar point. The first and the last point are never dropped.
+   *
+   * Afterwards length is the number of nodes (not the number of drawn points), so the
+   * simplification passes see all points. Call CalculateStartEndLength() after the last pass.
+   */
+  void TransPolygon::TransformGeoToPixel(const Projection& projection,
+                                         const std::vector<Point>& nodes,
+                                         bool dropSimilarPoints,
+                                         double optimizeErrorTolerance)
+  {
+    if (nodes.empty()) {
       start=0;
       end=0;
       length=0;
+
+      return;
+    }
+
+    size_t count=nodes.size();
+
+    if (xBuffer.size()<count) {
+      xBuffer.resize(count);
+      yBuffer.resize(count);
+    }
+
+    Projection::ArrayTransformer transformer(projection);
+
+    transformer.GeoToPixel(nodes.data(),
+                           count,
+                           xBuffer.data(),
+                           yBuffer.data());
+
+    size_t   anchor=0;         // Last point, that was not similar to its predecessor
+    size_t   drawn=0;          // Number of drawn points
+    size_t   last=0;           // Last drawn point
+    unsigned lastCode=0;       // Outcode of the last drawn point
+    unsigned beforeLastCode=0; // Outcode of the drawn point before the last drawn point
+
+    for (size_t i=0; i<count; i++) {
+      points[i].x=xBuffer[i];
+      points[i].y=yBuffer[i];
+      points[i].draw=true;
+
+      if (dropSimilarPoints &&
+          i>0 &&
+          i<count-1 &&
+          std::fabs(points[i].x-points[anchor].x)<=optimizeErrorTolerance &&
+          std::fabs(points[i].y-points[anchor].y)<=optimizeErrorTolerance) {
+        points[i].draw=false;
+
+        continue;
+      }
+
+      anchor=i;
+
+      if (clip) {
+        unsigned code=0;
+
+        if (points[i].x<clipXMin) {
+          code|=1;
+        }
+        else if (points[i].x>clipXMax) {
+          code|=2;
+        }
+
+        if (points[i].y<clipYMin) {
+          code|=4;
+        }
+        else if (points[i].y>clipYMax) {
+          code|=8;
+        }
+
+        if (drawn>=2 &&
+            (beforeLastCode & lastCode & code)!=0) {
+          // The segment from the point before the last drawn point to the current
+          // point is outside the rectangle on the same side as the last drawn point
+          points[last].draw=false;
+          drawn--;
+        }
+        else {
+          beforeLastCode=lastCode;
+        }
+
+        lastCode=code;
+        last=i;
+      }
+
+      drawn++;
     }
+
+    start=0;
+    end=count-1;
+    length=count;
   }
 
-  void TransPolygon::DropSimilarPoints(double optimizeErrorTolerance)
+  /**
+   * Calculate start, end and length from the draw flags of the points.
+   */
+  void TransPolygon::CalculateStartEndLength(size_t count)
   {
-    for (size_t i=0; i<length; i++) {
+    length=0;
+    start=count;
+    end=0;
+
+    for (size_t i=0; i<count; i++) {
       if (points[i].draw) {
-        size_t j=i+1;
-        while (j<length-1) {
-          if (points[j].draw)
-          {
-            if (std::fabs(points[j].x-points[i].x)<=optimizeErrorTolerance &&
-                std::fabs(points[j].y-points[i].y)<=optimizeErrorTolerance) {
-              points[j].draw=false;
-            }
-            else {
-              break;
-            }
-          }
+        length++;
 
-          j++;
+        if (i<start) {
+          start=i;
         }
+
+        end=i;
       }
     }
+
+    if (length==0) {
+      start=0;
+    }
   }
 
   void TransPolygon::DropRedundantPointsFast(double optimizeErrorTolerance)
@@ -369,37 +475,28 @@ namespace osmscout {
 
     if (optimize!=none) {
       TransformGeoToPixel(projection,
-                          nodes);
-
+                          nodes,
+                          optimize==fast,
+                          optimizeErrorTolerance);
 
       if (optimize==fast) {
-        DropSimilarPoints(optimizeErrorTolerance);
         DropRedundantPointsFast(optimizeErrorTolerance);
       }
       else {
         DropRedundantPointsDouglasPeucker(optimizeErrorTolerance,true);
       }
 
-      length=0;
-      start=nodes.size();
-      end=0;
-
-      // Calculate start, end and length
-      for (size_t i=0; i<nodes.size(); i++) {
-        if (points[i].draw) {
-          length++;
-
-          if (i<start) {
-            start=i;
-          }
-
-          end=i;
-        }
-      }
+      CalculateStartEndLength(nodes.size());
     }
     else {
       TransformGeoToPixel(projection,
-                          nodes);
+                          nodes,
+                          false,
+                          optimizeErrorTolerance);
+
+      if (clip) {
+        CalculateStartEndLength(nodes.size());
+      }
     }
   }
 
@@ -423,9 +520,9 @@ namespace osmscout {
 
     if (optimize!=none) {
       TransformGeoToPixel(projection,
-                          nodes);
-
-      DropSimilarPoints(optimizeErrorTolerance);
+                          nodes,
+                          true,
+                          optimizeErrorTolerance);
 
       if (optimize==fast) {
         DropRedundantPointsFast(optimizeErrorTolerance);
@@ -434,25 +531,17 @@ namespace osmscout {
         DropRedundantPointsDouglasPeucker(optimizeErrorTolerance,false);
       }
 
-      length=0;
-      start=nodes.size();
-      end=0;
-
-      // Calculate start & end
-      for (size_t i=0; i<nodes.size(); i++) {
-        if (points[i].draw) {
-          length++;
-
-          if (i<start) {
-            start=i;
-          }
-          end=i;
-        }
-      }
+      CalculateStartEndLength(nodes.size());
     }
     else {
       TransformGeoToPixel(projection,
-                          nodes);
+                          nodes,
+                          false,
+                          optimizeErrorTolerance);
+
+      if (clip) {
+        CalculateStartEndLength(nodes.size());
+      }
     }
   }
 
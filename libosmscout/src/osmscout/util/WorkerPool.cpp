@@ -0,0 +1,183 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2016  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/util/WorkerPool.h>
+
+#include <algorithm>
+
+namespace osmscout {
+
+  /**
+   * Create a pool with the given number of worker threads. If 0 is passed,
+   * the number of hardware threads is used.
+   */
+  WorkerPool::WorkerPool(size_t workerCount)
+  : pendingTasks(0),
+    nextWorker(0),
+    running(true)
+  {
+    if (workerCount==0) {
+      workerCount=std::max(std::thread::hardware_concurrency(),1u);
+    }
+
+    workers.reserve(workerCount);
+
+    for (size_t i=0; i<workerCount; i++) {
+      workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    }
+
+    // Start the threads after all workers exist, since they steal from each other
+    for (size_t i=0; i<workerCount; i++) {
+      workers[i]->thread=std::thread(&WorkerPool::WorkerLoop,this,i);
+    }
+  }
+
+  WorkerPool::~WorkerPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      running=false;
+    }
+
+    condition.notify_all();
+
+    for (auto& worker : workers) {
+      worker->thread.join();
+    }
+  }
+
+  /**
+   * Queue all tasks of the group at one worker with the given priority.
+   * The group is empty afterwards.
+   */
+  void WorkerPool::Push(WorkerTaskGroup& group,
+                        Priority priority)
+  {
+    if (group.tasks.empty()) {
+      return;
+    }
+
+    size_t taskCount=group.tasks.size();
+    size_t workerIndex;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      workerIndex=nextWorker;
+      nextWorker=(nextWorker+1)%workers.size();
+    }
+
+    {
+      Worker&                     worker=*workers[workerIndex];
+      std::lock_guard<std::mutex> lock(worker.mutex);
+
+      for (auto& task : group.tasks) {
+        worker.tasks[priority].push_back(std::move(task));
+      }
+    }
+
+    group.tasks.clear();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      pendingTasks+=taskCount;
+    }
+
+    if (taskCount==1) {
+      condition.notify_one();
+    }
+    else {
+      condition.notify_all();
+    }
+  }
+
+  /**
+   * Return the number of worker threads
+   */
+  size_t WorkerPool::GetWorkerCount() const
+  {
+    return workers.size();
+  }
+
+  /**
+   * Take the next task from the own queues or steal one from another worker,
+   * the highest priority first. Returns false, if there is no task.
+   */
+  bool WorkerPool::PopTask(size_t workerIndex,
+                           Task& task)
+  {
+    for (size_t priority=0; priority<PRIORITY_COUNT; priority++) {
+      {
+        Worker&                     worker=*workers[workerIndex];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+
+        if (!worker.tasks[priority].empty()) {
+          task=std::move(worker.tasks[priority].front());
+          worker.tasks[priority].pop_front();
+
+          return true;
+        }
+      }
+
+      for (size_t i=1; i<workers.size(); i++) {
+        Worker&                     victim=*workers[(workerIndex+i)%workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (!victim.tasks[priority].empty()) {
+          task=std::move(victim.tasks[priority].back());
+          victim.tasks[priority].pop_back();
+
+          return true;
+        }
+      }
+    }
+
+    return false;
+  }
+
+  void WorkerPool::WorkerLoop(size_t workerIndex)
+  {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        condition.wait(lock,[this]{return pendingTasks>0 || !running;});
+
+        if (pendingTasks==0) {
+          // Not running anymore and all tasks are processed
+          return;
+        }
+
+        // Reserve a task, so that idle workers do not spin on an already taken task
+        pendingTasks--;
+      }
+
+      Task task;
+
+      // The reserved task is guaranteed to be in one of the queues
+      while (!PopTask(workerIndex,task)) {
+        std::this_thread::yield();
+      }
+
+      task();
+    }
+  }
+}